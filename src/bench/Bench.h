@@ -0,0 +1,262 @@
+#ifndef QLIBS_BENCH_H
+#define QLIBS_BENCH_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+namespace bench {
+
+/**
+ * Keep a value alive, so the compiler doesn't drop the measured code which computes it.
+ */
+template<typename T>
+inline void keep(const T& value) noexcept {
+	asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/**
+ * The state of a run, a benchmark does its setup, then repeats the measured operation iterations() times.
+ * The setup may be excluded from the time by pause() and resume().
+ *
+ * Using sample:
+ * static void bm_find(bench::State& state) {
+ *     Map map(...);                              // the setup is not measured
+ *     for(state.start(); state.running(); state.next()) {
+ *         bench::keep(map.find(key++));
+ *     }
+ * }
+ */
+class State {
+	using Clock_t = std::chrono::steady_clock;
+
+	const uint64_t m_iterations;
+	const uint64_t m_arg;
+	uint64_t m_iteration;
+	uint64_t m_items; // the items processed by an iteration
+	Clock_t::time_point m_start;
+	Clock_t::duration m_elapsed;
+
+public:
+	State(uint64_t iterations, uint64_t arg) noexcept
+		: m_iterations(iterations), m_arg(arg), m_iteration(0), m_items(1), m_start(), m_elapsed(0) {}
+
+	inline void start() noexcept {
+		m_iteration = 0;
+		m_start = Clock_t::now();
+	}
+
+	inline bool running() noexcept {
+		if(m_iteration < m_iterations) {
+			return true;
+		}
+		m_elapsed += Clock_t::now() - m_start;
+		return false;
+	}
+
+	inline void next() noexcept {
+		m_iteration++;
+	}
+
+	inline void pause() noexcept {
+		m_elapsed += Clock_t::now() - m_start;
+	}
+
+	inline void resume() noexcept {
+		m_start = Clock_t::now();
+	}
+
+	inline uint64_t iterations() const noexcept {
+		return m_iterations;
+	}
+
+	/**
+	 * @return the argument of the registered variant, e.g. a load factor or a bit width.
+	 */
+	inline uint64_t arg() const noexcept {
+		return m_arg;
+	}
+
+	/**
+	 * @param items - amount of the items an iteration processes, e.g. the keys of a burst.
+	 */
+	inline void set_items(uint64_t items) noexcept {
+		m_items = items;
+	}
+
+	inline uint64_t items() const noexcept {
+		return m_items;
+	}
+
+	inline double seconds() const noexcept {
+		return std::chrono::duration<double>(m_elapsed).count();
+	}
+};
+
+struct Result {
+	std::string name;
+	uint64_t iterations;
+	double ns_min; // per item of the fastest repetition
+	double ns_median;
+	double items_per_second; // of the fastest repetition
+};
+
+/**
+ * A registry and runner of the benchmarks.
+ * The iterations of a benchmark are doubled until a run takes min_time, then the benchmark is repeated
+ * with that count and the fastest and the median repetitions are reported, so the load of the machine
+ * spoils the fastest one the least. The results are printed as a table or as JSON for the regression tracking.
+ */
+class Runner {
+public:
+	using Function_t = std::function<void(State&)>;
+
+private:
+	struct Entry {
+		std::string name;
+		Function_t function;
+		uint64_t arg;
+	};
+
+	std::vector<Entry> m_entries;
+	double m_min_time;
+	unsigned m_repetitions;
+	std::string m_filter;
+
+public:
+	Runner() noexcept : m_entries(), m_min_time(0.1), m_repetitions(5), m_filter() {}
+
+	/**
+	 * @param name - the printed name, "/<arg>" is appended to it.
+	 */
+	void add(const std::string& name, const Function_t& function, uint64_t arg) noexcept(false) {
+		m_entries.push_back(Entry{name + "/" + std::to_string(arg), function, arg});
+	}
+
+	void add(const std::string& name, const Function_t& function) noexcept(false) {
+		m_entries.push_back(Entry{name, function, 0});
+	}
+
+	/**
+	 * @param seconds - the least time of a repetition.
+	 */
+	inline void set_min_time(double seconds) noexcept {
+		m_min_time = seconds;
+	}
+
+	inline void set_repetitions(unsigned repetitions) noexcept {
+		m_repetitions = repetitions ? repetitions : 1;
+	}
+
+	/**
+	 * @param filter - a substring of the names of the benchmarks to run, empty - all of them.
+	 */
+	inline void set_filter(const std::string& filter) noexcept(false) {
+		m_filter = filter;
+	}
+
+	std::vector<Result> run(FILE* progress) noexcept(false) {
+		std::vector<Result> results;
+		for(const auto& entry : m_entries) {
+			if(not m_filter.empty() && entry.name.find(m_filter) == std::string::npos) {
+				continue;
+			}
+			results.push_back(run(entry));
+			if(progress) {
+				print(progress, results.back());
+			}
+		}
+		return results;
+	}
+
+	static void print_header(FILE* out) noexcept {
+		fprintf(out, "%-40s %14s %12s %12s %14s\n", "benchmark", "iterations", "ns/op min", "ns/op med", "items/s");
+	}
+
+	static void print(FILE* out, const Result& result) noexcept {
+		fprintf(out, "%-40s %14llu %12.2f %12.2f %14.4g\n", result.name.c_str(),
+			(unsigned long long)result.iterations, result.ns_min, result.ns_median, result.items_per_second);
+	}
+
+	/**
+	 * The layout of the google-benchmark JSON, so its compare tools take it.
+	 */
+	void print_json(FILE* out, const std::vector<Result>& results) const noexcept {
+		char host[64] = {0};
+		gethostname(host, sizeof(host) - 1);
+		char date[32] = {0};
+		const std::time_t now = std::time(nullptr);
+		std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+
+		fprintf(out, "{\n  \"context\": {\n");
+		fprintf(out, "    \"date\": \"%s\",\n", date);
+		fprintf(out, "    \"host_name\": \"%s\",\n", host);
+		fprintf(out, "    \"num_cpus\": %ld,\n", sysconf(_SC_NPROCESSORS_ONLN));
+		fprintf(out, "    \"repetitions\": %u,\n", m_repetitions);
+		fprintf(out, "    \"min_time\": %g\n", m_min_time);
+		fprintf(out, "  },\n  \"benchmarks\": [\n");
+		for(size_t i = 0; i < results.size(); i++) {
+			const Result& result = results[i];
+			fprintf(out, "    {\n");
+			fprintf(out, "      \"name\": \"%s\",\n", result.name.c_str());
+			fprintf(out, "      \"iterations\": %llu,\n", (unsigned long long)result.iterations);
+			fprintf(out, "      \"real_time\": %.3f,\n", result.ns_min);
+			fprintf(out, "      \"cpu_time\": %.3f,\n", result.ns_min);
+			fprintf(out, "      \"median_time\": %.3f,\n", result.ns_median);
+			fprintf(out, "      \"time_unit\": \"ns\",\n");
+			fprintf(out, "      \"items_per_second\": %.6g\n", result.items_per_second);
+			fprintf(out, "    }%s\n", i + 1 < results.size() ? "," : "");
+		}
+		fprintf(out, "  ]\n}\n");
+	}
+
+private:
+
+	Result run(const Entry& entry) const noexcept(false) {
+		uint64_t iterations = 1;
+		double seconds = 0;
+		uint64_t items = 1;
+		while(true) {
+			State state(iterations, entry.arg);
+			entry.function(state);
+			seconds = state.seconds();
+			items = state.items();
+			if(seconds >= m_min_time || iterations >= (uint64_t(1) << 40)) {
+				break;
+			}
+			// aim a bit over min_time, but never grow more than 10 times a step
+			const double factor = seconds > 0 ? std::min(10.0, 1.4 * m_min_time / seconds) : 10.0;
+			iterations = std::max(iterations + 1, uint64_t(double(iterations) * factor));
+		}
+
+		std::vector<double> times;
+		times.push_back(seconds);
+		for(unsigned i = 1; i < m_repetitions; i++) {
+			State state(iterations, entry.arg);
+			entry.function(state);
+			times.push_back(state.seconds());
+		}
+		std::sort(times.begin(), times.end());
+
+		const double per_item = 1e9 / double(iterations * items);
+		Result result;
+		result.name = entry.name;
+		result.iterations = iterations;
+		result.ns_min = times.front() * per_item;
+		result.ns_median = times[times.size() / 2] * per_item;
+		result.items_per_second = times.front() > 0 ? double(iterations * items) / times.front() : 0;
+		return result;
+	}
+};
+
+}; // namespace bench
+
+#endif /* QLIBS_BENCH_H */
@@ -0,0 +1,565 @@
+#include "Bench.h"
+
+#include <containers/BitArrayT.h>
+#include <containers/intrusive/HashMap.h>
+#include <containers/intrusive/ConcurrentHashMap.h>
+#include <containers/intrusive_pool/HashQueuePool.h>
+#include <containers/storage/TimedQueue.h>
+#include <containers/storage/RateLimiter.h>
+#include <containers/storage/IpTable.h>
+#include <containers/storage/Pyramid.h>
+#include <containers/storage/Snapshot.h>
+#include <proto/parsers/HeaderParser.h>
+#include <proto/parsers/StaticHeaderParser.h>
+#include <pcapwrap/MappedReader.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace proto;
+
+constexpr size_t KEYS = size_t(1) << 16; // fits L2 in the chained layout, the most of the runs are cache bound anyway
+constexpr size_t KEY_MASK = KEYS - 1;
+constexpr size_t BURST = 32;
+constexpr size_t PACKET_BYTES = 64;
+
+/**
+ * xorshift64*, the keys are the same from run to run.
+ */
+struct Random {
+	uint64_t state;
+
+	explicit Random(uint64_t seed = 0x9E3779B97F4A7C15ull) noexcept : state(seed) {}
+
+	inline uint64_t next() noexcept {
+		state ^= state >> 12;
+		state ^= state << 25;
+		state ^= state >> 27;
+		return state * 0x2545F4914F6CDD1Dull;
+	}
+};
+
+static std::vector<uint32_t> make_keys(size_t count, uint64_t seed) noexcept(false) {
+	std::vector<uint32_t> result(count);
+	Random random(seed);
+	for(auto& key : result) {
+		key = uint32_t(random.next());
+	}
+	return result;
+}
+
+/**
+ * The packets of a benchmark, either synthetic or read from a pcap file, PACKET_BYTES apart.
+ */
+struct Packets {
+	std::vector<uint8_t> data;
+	std::vector<uint16_t> lengths;
+
+	inline size_t size() const noexcept {
+		return lengths.size();
+	}
+
+	inline const uint8_t* at(size_t i) const noexcept {
+		return &data[i * PACKET_BYTES];
+	}
+};
+
+static Packets packets;
+
+/**
+ * Ethernet -> VLAN -> IPv4 -> UDP frames of PACKET_BYTES with different ports, see proto-bench.cpp.
+ */
+static void make_packets(size_t count) noexcept(false) {
+	packets.data.assign(count * PACKET_BYTES, 0);
+	packets.lengths.assign(count, uint16_t(PACKET_BYTES));
+	for(size_t i = 0; i < count; i++) {
+		uint8_t* pkt = &packets.data[i * PACKET_BYTES];
+		const uint16_t eth_vlan = htons(ETH_P_8021Q);
+		memcpy(pkt + 12, &eth_vlan, sizeof(eth_vlan));
+		const uint16_t tci = htons(uint16_t(i & 0x0FFF));
+		const uint16_t vlan_ip = htons(ETH_P_IP);
+		memcpy(pkt + 14, &tci, sizeof(tci));
+		memcpy(pkt + 16, &vlan_ip, sizeof(vlan_ip));
+
+		IPv4::Header ip;
+		memset(&ip, 0, sizeof(ip));
+		ip.version = 4;
+		ip.ihl = 5;
+		ip.tot_len = htons(uint16_t(PACKET_BYTES - 18));
+		ip.ttl = 64;
+		ip.protocol = IPv4::PROTO_UDP;
+		ip.saddr = IPv4::addr_net(10, 0, 0, 1);
+		ip.daddr = IPv4::addr_net(10, 0, 0, 2);
+		memcpy(pkt + 18, &ip, sizeof(ip));
+
+		Udp::Header udp;
+		memset(&udp, 0, sizeof(udp));
+		udp.source = htons(uint16_t(1024 + i % 60000));
+		udp.dest = htons(53);
+		udp.len = htons(uint16_t(PACKET_BYTES - 18 - sizeof(ip)));
+		memcpy(pkt + 38, &udp, sizeof(udp));
+	}
+}
+
+/**
+ * Take the first PACKET_BYTES of up to @count frames of a pcap file, as the headers are all the parsers look at.
+ */
+static void read_packets(const std::string& file_name, size_t count) noexcept(false) {
+	auto reader = pcapwrap::MappedReader::open(file_name);
+	pcapwrap::Frame frame;
+	packets.data.clear();
+	packets.lengths.clear();
+	while(packets.size() < count && reader.next(frame)) {
+		const size_t bytes = frame.m_hdr.caplen < PACKET_BYTES ? frame.m_hdr.caplen : PACKET_BYTES;
+		packets.data.resize(packets.data.size() + PACKET_BYTES, 0);
+		memcpy(&packets.data[packets.data.size() - PACKET_BYTES], frame.m_data, bytes);
+		packets.lengths.push_back(uint16_t(bytes));
+	}
+	if(packets.size() == 0) {
+		throw std::runtime_error(file_name + ": there are no frames");
+	}
+}
+
+// HashMap, the argument is the load factor in percents
+
+struct MapNode : public intrusive::HashMapHook<uint32_t, MapNode> {
+};
+
+using Map_t = intrusive::HashMap<uint32_t, MapNode, intrusive::HashMix<uint32_t> >;
+
+struct MapFixture {
+	std::unique_ptr<MapNode[]> nodes;
+	std::vector<uint32_t> keys;
+	Map_t map;
+
+	explicit MapFixture(uint64_t load_percents) noexcept(false)
+		: nodes(new MapNode[KEYS])
+		, keys(make_keys(KEYS * 2, 1))
+		, map(KEYS * 100 / load_percents, intrusive::HashMapSizing::POW2) {
+		map.allocate();
+		for(size_t i = 0; i < KEYS; i++) {
+			map.link(keys[i], nodes[i]);
+		}
+	}
+
+	~MapFixture() noexcept {
+		map.clear();
+	}
+};
+
+static void bm_map_find_hit(bench::State& state) {
+	MapFixture fixture(state.arg());
+	size_t i = 0;
+	for(state.start(); state.running(); state.next()) {
+		bench::keep(fixture.map.find(fixture.keys[i++ & KEY_MASK]).get());
+	}
+}
+
+static void bm_map_find_miss(bench::State& state) {
+	MapFixture fixture(state.arg());
+	size_t i = 0;
+	for(state.start(); state.running(); state.next()) {
+		bench::keep(fixture.map.find(fixture.keys[KEYS + (i++ & KEY_MASK)]).get());
+	}
+}
+
+static void bm_map_find_bulk(bench::State& state) {
+	MapFixture fixture(state.arg());
+	Map_t::Iterator_t out[BURST];
+	size_t i = 0;
+	state.set_items(BURST);
+	for(state.start(); state.running(); state.next()) {
+		fixture.map.find_bulk(&fixture.keys[i], BURST, out);
+		i = (i + BURST) & KEY_MASK;
+		bench::keep(out[0].get());
+	}
+}
+
+/**
+ * Remove a node and link it with another key, the map keeps its load.
+ */
+static void bm_map_link_remove(bench::State& state) {
+	MapFixture fixture(state.arg());
+	size_t i = 0;
+	for(state.start(); state.running(); state.next()) {
+		const size_t id = i++ & KEY_MASK;
+		fixture.map.remove(fixture.nodes[id]);
+		fixture.map.link(fixture.keys[KEYS + id], fixture.nodes[id]);
+		std::swap(fixture.keys[id], fixture.keys[KEYS + id]);
+	}
+}
+
+// the shared maps, the argument is amount of the threads
+
+constexpr unsigned SHARED_UPDATE_MASK = 15; // one operation of 16 relinks a key, the other ones look a key up
+constexpr size_t SHARED_RETIRED_MAX = 32; // the removed nodes a thread keeps until a grace period
+
+/**
+ * Run @body(thread, iterations) on state.arg() threads at once, the time is from the start of all of them
+ * to the end of the last one, so the items per second are the throughput of all the threads.
+ */
+template<typename F>
+static void run_threads(bench::State& state, const F& body) noexcept(false) {
+	const unsigned threads = unsigned(state.arg());
+	std::atomic<bool> go(false);
+	std::vector<std::thread> workers;
+	for(unsigned t = 0; t < threads; t++) {
+		workers.emplace_back([&, t]() {
+			while(not go.load(std::memory_order_acquire)) {
+				std::this_thread::yield();
+			}
+			body(t, state.iterations());
+		});
+	}
+	state.set_items(threads);
+	state.start();
+	go.store(true, std::memory_order_release);
+	for(std::thread& worker : workers) {
+		worker.join();
+	}
+	state.pause();
+}
+
+/**
+ * HashMap behind a mutex, the baseline of ConcurrentHashMap.
+ */
+static void bm_mutex_map(bench::State& state) {
+	MapFixture fixture(100);
+	std::mutex mutex;
+	run_threads(state, [&](unsigned thread, uint64_t iterations) {
+		Random random(thread + 1);
+		const size_t owned = KEYS / state.arg();
+		for(uint64_t i = 0; i < iterations; i++) {
+			if((i & SHARED_UPDATE_MASK) == SHARED_UPDATE_MASK) {
+				const size_t id = thread * owned + random.next() % owned;
+				std::lock_guard<std::mutex> guard(mutex);
+				fixture.map.remove(fixture.nodes[id]);
+				fixture.map.link(fixture.keys[id], fixture.nodes[id]);
+			} else {
+				std::lock_guard<std::mutex> guard(mutex);
+				bench::keep(fixture.map.find(fixture.keys[random.next() & KEY_MASK]).get());
+			}
+		}
+	});
+}
+
+struct SharedNode : public intrusive::ConcurrentHashMapHook<uint32_t, SharedNode> {
+};
+
+using SharedMap_t = intrusive::ConcurrentHashMap<uint32_t, SharedNode, intrusive::HashMix<uint32_t> >;
+
+/**
+ * ConcurrentHashMap, a key is relinked with a spare node and the removed one is reused after a grace period.
+ */
+static void bm_concurrent_map(bench::State& state) {
+	const unsigned threads = unsigned(state.arg());
+	const size_t owned = KEYS / threads;
+	std::unique_ptr<SharedNode[]> nodes(new SharedNode[KEYS + threads * SHARED_RETIRED_MAX]);
+	const std::vector<uint32_t> keys = make_keys(KEYS, 1);
+	std::vector<SharedNode*> linked(KEYS);
+	SharedMap_t map(KEYS);
+	map.allocate();
+	for(size_t i = 0; i < KEYS; i++) {
+		linked[i] = map.link(keys[i], nodes[i]);
+	}
+	storage::Qsbr<> qsbr;
+	run_threads(state, [&](unsigned thread, uint64_t iterations) {
+		Random random(thread + 1);
+		std::vector<SharedNode*> spare;
+		std::vector<SharedNode*> retired;
+		for(size_t i = 0; i < SHARED_RETIRED_MAX; i++) {
+			spare.push_back(&nodes[KEYS + thread * SHARED_RETIRED_MAX + i]);
+		}
+		qsbr.online(thread);
+		for(uint64_t i = 0; i < iterations; i++) {
+			if((i & SHARED_UPDATE_MASK) == SHARED_UPDATE_MASK) {
+				const size_t id = thread * owned + random.next() % owned;
+				map.remove(*linked[id]);
+				retired.push_back(linked[id]);
+				linked[id] = map.link(keys[id], *spare.back());
+				spare.pop_back();
+				qsbr.quiescent(thread);
+				if(spare.empty()) {
+					qsbr.offline(thread);
+					qsbr.synchronize();
+					qsbr.online(thread);
+					spare.swap(retired);
+				}
+			} else {
+				bench::keep(map.find(keys[random.next() & KEY_MASK]));
+			}
+		}
+		qsbr.offline(thread);
+	});
+	map.clear();
+}
+
+// HashQueuePool, the argument is the load factor in percents
+
+using PoolNode_t = intrusive::HashQueuePoolEmptyNode<uint32_t>;
+using Pool_t = intrusive::HashQueuePool<PoolNode_t, intrusive::HashMix<uint32_t> >;
+
+/**
+ * A full pool evicts its oldest key to push a new one, as a flow cache does.
+ */
+static void bm_pool_churn(bench::State& state) {
+	Pool_t pool(KEYS, float(state.arg()) / 100.0f, intrusive::HashMapSizing::POW2);
+	pool.allocate();
+	const std::vector<uint32_t> keys = make_keys(KEYS * 4, 2);
+	for(size_t i = 0; i < KEYS; i++) {
+		pool.push_back(keys[i]);
+	}
+	size_t i = KEYS;
+	for(state.start(); state.running(); state.next()) {
+		pool.pop_front();
+		bench::keep(pool.push_back(keys[i++ & (KEYS * 4 - 1)]).get());
+	}
+}
+
+static void bm_pool_find_or_insert(bench::State& state) {
+	Pool_t pool(KEYS, float(state.arg()) / 100.0f, intrusive::HashMapSizing::POW2);
+	pool.allocate();
+	const std::vector<uint32_t> keys = make_keys(KEYS * 2, 3);
+	Random random(3);
+	bool inserted = false;
+	for(state.start(); state.running(); state.next()) {
+		if(not pool.available()) {
+			pool.pop_front();
+		}
+		bench::keep(pool.find_or_insert(keys[random.next() & (KEYS * 2 - 1)], inserted).get());
+	}
+}
+
+// TimedQueue
+
+using QueueNode_t = storage::TimedQueueNode<uint32_t, uint32_t>;
+using Queue_t = storage::TimedQueue<QueueNode_t, intrusive::HashMix<uint32_t>, intrusive::HashMapBucket<QueueNode_t>,
+	storage::BurstClock<> >;
+
+/**
+ * Refresh or push the key of every packet and expire the idle keys, twice as many keys as the queue holds.
+ */
+static void bm_timed_queue(bench::State& state) {
+	Queue_t queue(KEYS, 1.0f, intrusive::HashMapSizing::POW2);
+	queue.allocate();
+	const std::vector<uint32_t> keys = make_keys(KEYS * 2, 4);
+	Random random(4);
+	bool pushed = false;
+	uint64_t now = 0;
+	for(state.start(); state.running(); state.next()) {
+		queue.clock().set(++now);
+		if(queue.size() == KEYS) {
+			queue.pop_front(0);
+		}
+		bench::keep(queue.touch_or_push(keys[random.next() & (KEYS * 2 - 1)], pushed).get());
+	}
+}
+
+// RateLimiter
+
+using LimiterNode_t = storage::RateLimiterNode<uint32_t>;
+using Limiter_t = storage::RateLimiter<LimiterNode_t, intrusive::HashMix<uint32_t>, intrusive::HashMapBucket<LimiterNode_t>,
+	storage::BurstClock<> >;
+
+static void bm_rate_limiter_check(bench::State& state) {
+	Limiter_t limiter(KEYS, 1.0f, intrusive::HashMapSizing::POW2);
+	limiter.allocate();
+	limiter.set_period(1000);
+	const std::vector<uint32_t> keys = make_keys(KEYS * 2, 5);
+	Random random(5);
+	uint64_t now = 0;
+	for(state.start(); state.running(); state.next()) {
+		bench::keep(limiter.check(keys[random.next() & (KEYS * 2 - 1)], 1, ++now));
+	}
+}
+
+// IpTable, the argument is amount of the networks
+
+static void bm_ip_table_find(bench::State& state) {
+	storage::IpTable table(KEYS, 1.0f, unsigned(state.arg()));
+	table.allocate();
+	const std::vector<uint32_t> keys = make_keys(KEYS * 2, 6);
+	for(size_t i = 0; i < KEYS; i++) {
+		table.append_addr(keys[i]);
+	}
+	Random random(6);
+	for(size_t i = 0; i < state.arg(); i++) {
+		const unsigned depth = 8 + unsigned(random.next() % 17);
+		const uint32_t mask = ~uint32_t(0) << (32 - depth);
+		table.append_net(uint32_t(random.next()) & mask, mask);
+	}
+	for(state.start(); state.running(); state.next()) {
+		bench::keep(table.find(keys[random.next() & (KEYS * 2 - 1)]));
+	}
+}
+
+// BitArrayT, the argument is the bit width
+
+template<BitArrayTWidth_t Width>
+static void bm_bit_array_load(bench::State& state) {
+	BitArrayT<Width> array;
+	array.allocate(KEYS);
+	array.fill(1);
+	size_t i = 0;
+	BitArrayTChunk_t sum = 0;
+	for(state.start(); state.running(); state.next()) {
+		sum += array.load(i++ & KEY_MASK);
+	}
+	bench::keep(sum);
+}
+
+template<BitArrayTWidth_t Width>
+static void bm_bit_array_store(bench::State& state) {
+	BitArrayT<Width> array;
+	array.allocate(KEYS);
+	size_t i = 0;
+	for(state.start(); state.running(); state.next()) {
+		array.store(i & KEY_MASK, BitArrayTChunk_t(i) & BitArrayT<Width>::value_max());
+		i++;
+	}
+	bench::keep(array.load(0));
+}
+
+// Pyramid, the argument is the arity
+
+template<unsigned D>
+static void bm_pyramid_pop_insert(bench::State& state) {
+	std::vector<uint32_t> storage(KEYS);
+	storage::Pyramid<uint32_t, std::less<uint32_t>, D> pyramid(storage.data(), KEYS);
+	Random random(7);
+	for(size_t i = 0; i < KEYS; i++) {
+		pyramid.insert(uint32_t(random.next()));
+	}
+	for(state.start(); state.running(); state.next()) {
+		pyramid.pop();
+		pyramid.insert(uint32_t(random.next()));
+	}
+	bench::keep(*pyramid.peek());
+}
+
+template<unsigned D>
+static void bm_pyramid_push_top(bench::State& state) {
+	std::vector<uint32_t> storage(1024);
+	storage::Pyramid<uint32_t, std::less<uint32_t>, D> pyramid(storage.data(), storage.size());
+	Random random(8);
+	for(state.start(); state.running(); state.next()) {
+		bench::keep(pyramid.push_top(uint32_t(random.next())));
+	}
+}
+
+// HeaderParser, over the synthetic packets or the packets of --pcap
+
+template<typename Parser>
+static void bm_parser(bench::State& state) {
+	const size_t count = packets.size();
+	size_t i = 0;
+	uint64_t check = 0;
+	for(state.start(); state.running(); state.next()) {
+		Parser hp(packets.at(i), packets.lengths[i]);
+		while(hp.protocol() != END) {
+			check += hp.protocol();
+			hp.next();
+		}
+		i = i + 1 < count ? i + 1 : 0;
+	}
+	bench::keep(check);
+}
+
+static void usage(const char* name) noexcept {
+	printf("qlibs micro-benchmarks\n");
+	printf("usage: %s [--json] [--filter=<substring>] [--min-time=<seconds>] [--repetitions=<n>] [--pcap=<file>]\n", name);
+	printf("  the arguments of the HashMap and HashQueuePool benchmarks are the load factors in percents,\n");
+	printf("  of IpTable - the networks, of BitArrayT - the bit widths, of Pyramid - the arities,\n");
+	printf("  of SharedMap - the threads which look the keys up and relink 1/16 of them.\n");
+}
+
+int main(int argc, char** argv) {
+	bench::Runner runner;
+	bool json = false;
+	std::string pcap;
+	for(int i = 1; i < argc; i++) {
+		const std::string arg(argv[i]);
+		if(arg == "--json") {
+			json = true;
+		} else if(arg.compare(0, 9, "--filter=") == 0) {
+			runner.set_filter(arg.substr(9));
+		} else if(arg.compare(0, 11, "--min-time=") == 0) {
+			runner.set_min_time(strtod(arg.c_str() + 11, nullptr));
+		} else if(arg.compare(0, 14, "--repetitions=") == 0) {
+			runner.set_repetitions(unsigned(strtoul(arg.c_str() + 14, nullptr, 10)));
+		} else if(arg.compare(0, 7, "--pcap=") == 0) {
+			pcap = arg.substr(7);
+		} else {
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	try {
+		if(pcap.empty()) {
+			make_packets(KEYS);
+		} else {
+			read_packets(pcap, KEYS);
+		}
+	} catch(const std::exception& e) {
+		fprintf(stderr, "%s\n", e.what());
+		return EXIT_FAILURE;
+	}
+
+	for(uint64_t load : {50, 100, 200, 400}) {
+		runner.add("HashMap/find_hit", bm_map_find_hit, load);
+		runner.add("HashMap/find_miss", bm_map_find_miss, load);
+		runner.add("HashMap/find_bulk", bm_map_find_bulk, load);
+		runner.add("HashMap/link_remove", bm_map_link_remove, load);
+	}
+	for(uint64_t threads : {1, 2, 4, 8, 16, 32, 64}) {
+		runner.add("SharedMap/mutex", bm_mutex_map, threads);
+		runner.add("SharedMap/concurrent", bm_concurrent_map, threads);
+	}
+	for(uint64_t load : {50, 100, 200}) {
+		runner.add("HashQueuePool/churn", bm_pool_churn, load);
+		runner.add("HashQueuePool/find_or_insert", bm_pool_find_or_insert, load);
+	}
+	runner.add("TimedQueue/touch_or_push", bm_timed_queue);
+	runner.add("RateLimiter/check", bm_rate_limiter_check);
+	for(uint64_t nets : {16, 1024}) {
+		runner.add("IpTable/find", bm_ip_table_find, nets);
+	}
+	runner.add("BitArrayT/load", bm_bit_array_load<1>, 1);
+	runner.add("BitArrayT/load", bm_bit_array_load<7>, 7);
+	runner.add("BitArrayT/load", bm_bit_array_load<13>, 13);
+	runner.add("BitArrayT/load", bm_bit_array_load<32>, 32);
+	runner.add("BitArrayT/load", bm_bit_array_load<63>, 63);
+	runner.add("BitArrayT/store", bm_bit_array_store<1>, 1);
+	runner.add("BitArrayT/store", bm_bit_array_store<7>, 7);
+	runner.add("BitArrayT/store", bm_bit_array_store<13>, 13);
+	runner.add("BitArrayT/store", bm_bit_array_store<32>, 32);
+	runner.add("BitArrayT/store", bm_bit_array_store<63>, 63);
+	runner.add("Pyramid/pop_insert", bm_pyramid_pop_insert<2>, 2);
+	runner.add("Pyramid/pop_insert", bm_pyramid_pop_insert<4>, 4);
+	runner.add("Pyramid/pop_insert", bm_pyramid_pop_insert<8>, 8);
+	runner.add("Pyramid/push_top", bm_pyramid_push_top<2>, 2);
+	runner.add("Pyramid/push_top", bm_pyramid_push_top<4>, 4);
+	runner.add("Pyramid/push_top", bm_pyramid_push_top<8>, 8);
+	const std::string source = pcap.empty() ? "/synthetic" : "/pcap";
+	runner.add("HeaderParser" + source, bm_parser<HeaderParser>);
+	runner.add("SafeHeaderParser" + source, bm_parser<SafeHeaderParser>);
+	runner.add("StaticHeaderParser" + source, bm_parser<StaticHeaderParser<Ethernet, Vlan, IPv4, IPv6, Tcp, Udp> >);
+
+	// the table goes to stderr with JSON, so stdout takes the JSON only
+	FILE* progress = json ? stderr : stdout;
+	bench::Runner::print_header(progress);
+	const std::vector<bench::Result> results = runner.run(progress);
+	if(json) {
+		runner.print_json(stdout, results);
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,506 @@
+#include <containers/storage/Clock.h>
+#include <containers/storage/FlowTable.h>
+#include <containers/storage/IpTable.h>
+#include <containers/storage/RateLimiter.h>
+#include <proto/Deduplicator.h>
+#include <proto/PatternMatcher.h>
+#include <proto/parsers/HeaderParser.h>
+#include <proto/parsers/ParsedPacket.h>
+#include <pcapwrap/Reader.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <pthread.h>
+#include <sched.h>
+
+using namespace proto;
+
+/**
+ * The end-to-end replay of a capture through the stages of a packet pipeline.
+ * The capture is loaded into memory once, then every thread replays all of it loops times through its own
+ * stages, as a core behind RSS with the per-core tables does, so the rate of N threads is the capacity of N cores.
+ * The time of every stage is taken by the TSC per burst and divided by the packets of the burst,
+ * the percentiles of the stages are of these per packet cycles.
+ */
+
+constexpr size_t BURST = 32;
+constexpr size_t SAMPLES_MAX = size_t(1) << 20; // per stage and thread, the later bursts are sampled with a stride
+
+enum Stage : unsigned {
+	HEADERS, // HeaderParser walks the whole stack
+	PARSE, // PacketParser takes the 5-tuples, the following stages need it
+	DEDUP, // Deduplicator drops the copies of the mirrored packets, the following stages skip them
+	IPTABLE, // IpTable::find() of the IPv4 source
+	RATELIMIT, // RateLimiter::check() of the IPv4 source
+	MATCH, // PatternMatcher::match_burst() of the TCP and UDP payloads
+	FLOW, // FlowTable::update() and expire()
+	STAGES
+};
+
+static const char* STAGE_NAMES[STAGES] = {"headers", "parse", "dedup", "iptable", "ratelimit", "match", "flow"};
+
+// the patterns of the match stage without --patterns
+static const char* DEFAULT_PATTERNS[] = {"GET /", "POST /", "PUT /", "HEAD /", "HTTP/1.", "Host: ", "User-Agent: ",
+	"Cookie: ", "Authorization: Basic ", "Content-Type: ", "\r\n\r\n", "SSH-2.0-", "\x16\x03\x01", "\x16\x03\x03",
+	"USER ", "PASS ", "RETR ", "EHLO ", "MAIL FROM:", "/etc/passwd", "cmd.exe", "<script", "SELECT ", "UNION "};
+
+struct Options {
+	std::string pcap;
+	unsigned loops = 10;
+	unsigned threads = 1;
+	unsigned stages = (1u << STAGES) - 1;
+	size_t flows = size_t(1) << 20;
+	size_t addrs = size_t(1) << 16;
+	uint64_t period_us = 1000; // of RateLimiter
+	std::string patterns_file;
+	std::vector<std::string> patterns; // of PatternMatcher
+	bool pin = false;
+};
+
+/**
+ * The capture in one buffer, the frames point into it.
+ */
+struct Capture {
+	std::vector<uint8_t> data;
+	std::vector<pcapwrap::Frame> frames;
+	uint64_t bytes = 0; // the wire lengths
+	uint64_t first_ns = 0;
+	uint64_t span_ns = 0; // from the first frame to the last one
+
+	void load(const std::string& file_name) noexcept(false) {
+		auto reader = pcapwrap::Reader::open(file_name);
+		pcapwrap::Frame frame;
+		std::vector<size_t> offsets;
+		while(reader.next(frame)) {
+			offsets.push_back(data.size());
+			data.insert(data.end(), frame.m_data, frame.m_data + frame.m_hdr.caplen);
+			frames.push_back(frame);
+			bytes += frame.m_hdr.len;
+		}
+		if(frames.empty()) {
+			throw std::runtime_error(file_name + ": there are no frames");
+		}
+		for(size_t i = 0; i < frames.size(); i++) {
+			frames[i].m_data = data.data() + offsets[i];
+		}
+		first_ns = ns(frames.front());
+		const uint64_t last_ns = ns(frames.back());
+		span_ns = last_ns > first_ns ? last_ns - first_ns : 0;
+	}
+
+	static inline uint64_t ns(const pcapwrap::Frame& frame) noexcept {
+		// Reader opens the captures with the nanosecond precision
+		return uint64_t(frame.m_hdr.ts.tv_sec) * 1000000000u + uint64_t(frame.m_hdr.ts.tv_usec);
+	}
+};
+
+struct NullExporter {
+	uint64_t records = 0;
+
+	inline void operator()(const storage::FlowRecord*, size_t n) noexcept {
+		records += n;
+	}
+};
+
+using LimiterNode_t = storage::RateLimiterNode<uint32_t>;
+using Limiter_t = storage::RateLimiter<LimiterNode_t, intrusive::HashMix<uint32_t>, intrusive::HashMapBucket<LimiterNode_t>,
+	storage::BurstClock<> >;
+using Flows_t = storage::FlowTable<NullExporter, storage::BurstClock<> >;
+using Dedup_t = proto::Deduplicator<16, storage::BurstClock<> >;
+
+static size_t pattern_bytes(const std::vector<std::string>& patterns) noexcept {
+	size_t result = 0;
+	for(const std::string& pattern : patterns) {
+		result += pattern.size();
+	}
+	return result;
+}
+
+/**
+ * The patterns of a file, a pattern per line, the empty lines are skipped.
+ */
+static std::vector<std::string> load_patterns(const std::string& file_name) noexcept(false) {
+	std::ifstream in(file_name);
+	if(not in) {
+		throw std::runtime_error(file_name + ": can't be opened");
+	}
+	std::vector<std::string> result;
+	std::string line;
+	while(std::getline(in, line)) {
+		if(not line.empty()) {
+			result.push_back(line);
+		}
+	}
+	if(result.empty()) {
+		throw std::runtime_error(file_name + ": there are no patterns");
+	}
+	return result;
+}
+
+struct StageResult {
+	uint64_t cycles = 0;
+	std::vector<uint32_t> samples; // cycles per packet of the bursts
+	size_t stride = 1;
+	size_t skipped = 0;
+
+	inline void add(uint64_t burst_cycles, size_t n) noexcept {
+		cycles += burst_cycles;
+		if(++skipped < stride) {
+			return;
+		}
+		skipped = 0;
+		samples.push_back(uint32_t(std::min<uint64_t>(burst_cycles / n, UINT32_MAX)));
+		if(samples.size() == SAMPLES_MAX) {
+			// keep every second sample and take the following ones twice as rarely
+			for(size_t i = 0; i < SAMPLES_MAX / 2; i++) {
+				samples[i] = samples[i * 2];
+			}
+			samples.resize(SAMPLES_MAX / 2);
+			stride *= 2;
+		}
+	}
+};
+
+/**
+ * The stages of a thread.
+ */
+class Worker {
+	const Options& m_options;
+	const Capture& m_capture;
+	storage::IpTable m_ip_table;
+	Limiter_t m_limiter;
+	std::unique_ptr<Flows_t> m_flows;
+	Dedup_t m_dedup;
+	PatternMatcher m_matcher;
+	storage::TscClock m_tsc;
+	ParsedPacket m_parsed[BURST];
+	bool m_parsed_ok[BURST];
+
+public:
+	StageResult stages[STAGES];
+	uint64_t packets = 0;
+	uint64_t bytes = 0;
+	uint64_t matched = 0; // by IpTable
+	uint64_t passed = 0; // by RateLimiter
+	uint64_t duplicates = 0; // by Deduplicator
+	uint64_t payloads = 0; // matched by PatternMatcher
+	uint64_t check = 0; // keeps HeaderParser from being optimized out
+	double seconds = 0;
+
+	Worker(const Options& options, const Capture& capture) noexcept(false)
+		: m_options(options)
+		, m_capture(capture)
+		, m_ip_table(unsigned(options.addrs), 1.0f, 16)
+		, m_limiter(options.addrs, 1.0f, intrusive::HashMapSizing::POW2)
+		, m_flows(new Flows_t(options.flows))
+		, m_dedup(size_t(1) << 16)
+		, m_matcher(options.patterns.size(), pattern_bytes(options.patterns))
+		, m_tsc() {
+		if(m_ip_table.allocate() != 0 || m_limiter.allocate() != 0 || m_flows->allocate() != 0 || m_dedup.allocate() != 0
+		   || m_matcher.allocate() != 0) {
+			throw std::runtime_error("the tables can't be allocated");
+		}
+		std::vector<MatchPattern> patterns;
+		for(size_t i = 0; i < options.patterns.size(); i++) {
+			const std::string& pattern = options.patterns[i];
+			patterns.push_back({reinterpret_cast<const uint8_t*>(pattern.data()), pattern.size(), uint32_t(i)});
+		}
+		m_matcher.build(patterns.data(), patterns.size());
+		m_limiter.set_period(options.period_us * 1000);
+		// every second IPv4 source of the capture is in the table
+		ParsedPacket pkt;
+		for(size_t i = 0; i < capture.frames.size() && m_ip_table.size_addr() < options.addrs; i += 2) {
+			const pcapwrap::Frame& frame = capture.frames[i];
+			if(PacketParser::parse(frame.m_data, frame.m_hdr.caplen, pkt) && pkt.ip_version == 4) {
+				m_ip_table.append_addr(pkt.src.addr32[0]);
+			}
+		}
+	}
+
+	void run() noexcept {
+		const auto start = std::chrono::steady_clock::now();
+		const std::vector<pcapwrap::Frame>& frames = m_capture.frames;
+		// the replays go on in time, so the timeouts work as they do on the live traffic
+		const uint64_t loop_ns = m_capture.span_ns + 1000000;
+		for(unsigned loop = 0; loop < m_options.loops; loop++) {
+			for(size_t first = 0; first < frames.size(); first += BURST) {
+				const size_t n = std::min(BURST, frames.size() - first);
+				const uint64_t now = Capture::ns(frames[first]) - m_capture.first_ns + loop * loop_ns;
+				burst(&frames[first], n, now);
+			}
+		}
+		seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	inline uint64_t hz() const noexcept {
+		return m_tsc.hz();
+	}
+
+private:
+
+	inline bool enabled(Stage stage) const noexcept {
+		return m_options.stages & (1u << stage);
+	}
+
+	void burst(const pcapwrap::Frame* frames, size_t n, uint64_t now) noexcept {
+		uint64_t tsc = m_tsc.now();
+		if(enabled(HEADERS)) {
+			for(size_t i = 0; i < n; i++) {
+				HeaderParser hp(frames[i].m_data, frames[i].m_hdr.caplen);
+				while(hp.protocol() != END) {
+					check += hp.protocol();
+					hp.next();
+				}
+			}
+			tsc = stage(HEADERS, tsc, n);
+		}
+		if(enabled(PARSE)) {
+			PacketParser::parse_burst(frames, n, m_parsed);
+			for(size_t i = 0; i < n; i++) {
+				m_parsed_ok[i] = m_parsed[i].ip_version != 0;
+			}
+			tsc = stage(PARSE, tsc, n);
+
+			if(enabled(DEDUP)) {
+				m_dedup.clock().set(now);
+				bool keep[BURST];
+				duplicates += n - m_dedup.filter_burst(frames, m_parsed, n, keep);
+				for(size_t i = 0; i < n; i++) {
+					m_parsed_ok[i] = m_parsed_ok[i] && keep[i];
+				}
+				tsc = stage(DEDUP, tsc, n);
+			}
+			if(enabled(IPTABLE)) {
+				for(size_t i = 0; i < n; i++) {
+					matched += m_parsed_ok[i] && m_parsed[i].ip_version == 4 && m_ip_table.find(m_parsed[i].src.addr32[0]);
+				}
+				tsc = stage(IPTABLE, tsc, n);
+			}
+			if(enabled(RATELIMIT)) {
+				for(size_t i = 0; i < n; i++) {
+					passed += m_parsed_ok[i] && m_parsed[i].ip_version == 4 && m_limiter.check(m_parsed[i].src.addr32[0], 1, now);
+				}
+				tsc = stage(RATELIMIT, tsc, n);
+			}
+			if(enabled(MATCH)) {
+				uint32_t ids[BURST];
+				m_matcher.match_burst(frames, m_parsed, n, ids);
+				for(size_t i = 0; i < n; i++) {
+					payloads += m_parsed_ok[i] && ids[i] != PatternMatcher::NO_MATCH;
+				}
+				tsc = stage(MATCH, tsc, n);
+			}
+			if(enabled(FLOW)) {
+				m_flows->clock().set(now);
+				for(size_t i = 0; i < n; i++) {
+					if(m_parsed_ok[i]) {
+						m_flows->update(frames[i].m_data, m_parsed[i], frames[i].m_hdr.len);
+					}
+				}
+				m_flows->expire();
+				tsc = stage(FLOW, tsc, n);
+			}
+		}
+		packets += n;
+		for(size_t i = 0; i < n; i++) {
+			bytes += frames[i].m_hdr.len;
+		}
+	}
+
+	inline uint64_t stage(Stage stage, uint64_t start, size_t n) noexcept {
+		const uint64_t now = m_tsc.now();
+		stages[stage].add(now - start, n);
+		return now;
+	}
+};
+
+static uint32_t percentile(const std::vector<uint32_t>& sorted, double q) noexcept {
+	if(sorted.empty()) {
+		return 0;
+	}
+	const size_t index = std::min(sorted.size() - 1, size_t(q * double(sorted.size())));
+	return sorted[index];
+}
+
+static void report(const Options& options, const Capture& capture, std::vector<std::unique_ptr<Worker> >& workers) noexcept {
+	uint64_t packets = 0, bytes = 0, matched = 0, passed = 0, duplicates = 0, payloads = 0;
+	double seconds = 0;
+	for(const auto& worker : workers) {
+		packets += worker->packets;
+		bytes += worker->bytes;
+		matched += worker->matched;
+		passed += worker->passed;
+		duplicates += worker->duplicates;
+		payloads += worker->payloads;
+		seconds = std::max(seconds, worker->seconds);
+	}
+	const double hz = double(workers.front()->hz());
+	printf("%zu frames (%.1f MB), %u loops, %u threads, TSC %.3f GHz\n",
+		capture.frames.size(), double(capture.data.size()) / 1e6, options.loops, options.threads, hz / 1e9);
+	printf("total: %.3f Mpps %.3f Gbit/s in %.3f s", seconds > 0 ? double(packets) / seconds / 1e6 : 0,
+		seconds > 0 ? double(bytes) * 8 / seconds / 1e9 : 0, seconds);
+	for(unsigned t = 0; t < workers.size(); t++) {
+		const Worker& worker = *workers[t];
+		printf("%s%.3f", t == 0 ? " (Mpps per thread: " : " ", worker.seconds > 0 ? double(worker.packets) / worker.seconds / 1e6 : 0);
+	}
+	printf(")\n");
+	if(options.stages & (1u << DEDUP)) {
+		printf("dedup dropped %.2f%%, ", packets ? 100.0 * double(duplicates) / double(packets) : 0);
+	}
+	if(options.stages & (1u << IPTABLE)) {
+		printf("iptable matched %.2f%%, ", packets ? 100.0 * double(matched) / double(packets) : 0);
+	}
+	if(options.stages & (1u << RATELIMIT)) {
+		printf("ratelimit passed %.2f%%, ", packets ? 100.0 * double(passed) / double(packets) : 0);
+	}
+	if(options.stages & (1u << MATCH)) {
+		printf("match found %.2f%% (%zu patterns)", packets ? 100.0 * double(payloads) / double(packets) : 0,
+			options.patterns.size());
+	}
+	printf("\n\n%-10s %12s %10s %10s %10s %10s %10s\n", "stage", "cycles/pkt", "ns/pkt", "p50", "p90", "p99", "p99.9");
+
+	uint64_t total_cycles = 0;
+	for(unsigned s = 0; s < STAGES; s++) {
+		if(not (options.stages & (1u << s))) {
+			continue;
+		}
+		uint64_t cycles = 0;
+		std::vector<uint32_t> samples;
+		for(const auto& worker : workers) {
+			cycles += worker->stages[s].cycles;
+			samples.insert(samples.end(), worker->stages[s].samples.begin(), worker->stages[s].samples.end());
+		}
+		std::sort(samples.begin(), samples.end());
+		total_cycles += cycles;
+		const double per_packet = packets ? double(cycles) / double(packets) : 0;
+		printf("%-10s %12.1f %10.1f %10u %10u %10u %10u\n", STAGE_NAMES[s], per_packet, per_packet * 1e9 / hz,
+			percentile(samples, 0.5), percentile(samples, 0.9), percentile(samples, 0.99), percentile(samples, 0.999));
+	}
+	const double per_packet = packets ? double(total_cycles) / double(packets) : 0;
+	printf("%-10s %12.1f %10.1f\n", "all", per_packet, per_packet * 1e9 / hz);
+	printf("(the percentiles are in cycles per packet of the bursts of %zu)\n", BURST);
+}
+
+static unsigned parse_stages(const std::string& list) noexcept {
+	unsigned result = 0;
+	size_t begin = 0;
+	while(begin <= list.size()) {
+		const size_t end = std::min(list.find(',', begin), list.size());
+		const std::string name = list.substr(begin, end - begin);
+		unsigned s = 0;
+		while(s < STAGES && name != STAGE_NAMES[s]) {
+			s++;
+		}
+		if(s == STAGES) {
+			return 0;
+		}
+		result |= 1u << s;
+		begin = end + 1;
+	}
+	if(result & ((1u << DEDUP) | (1u << IPTABLE) | (1u << RATELIMIT) | (1u << MATCH) | (1u << FLOW))) {
+		result |= 1u << PARSE;
+	}
+	return result;
+}
+
+static void usage(const char* name) noexcept {
+	printf("qlibs pcap replay benchmark\n");
+	printf("usage: %s --pcap=<file> [--loops=<n>] [--threads=<n>] [--stages=<list>] [--flows=<n>] [--addrs=<n>]\n", name);
+	printf("       [--period-us=<n>] [--patterns=<file>] [--pin]\n");
+	printf("  --stages - a comma separated subset of headers,parse,dedup,iptable,ratelimit,match,flow (all by default),\n");
+	printf("             the stages past parse take it in, they skip the duplicates if dedup is on\n");
+	printf("  --patterns - the payload patterns of match, one per line (a few of HTTP, TLS, SSH and mail by default)\n");
+	printf("  --flows - the FlowTable capacity per thread, --addrs - the IpTable and RateLimiter capacity per thread\n");
+	printf("  --pin - pin the thread N to the CPU N\n");
+}
+
+int main(int argc, char** argv) {
+	Options options;
+	for(int i = 1; i < argc; i++) {
+		const std::string arg(argv[i]);
+		const size_t eq = arg.find('=');
+		const std::string key = arg.substr(0, eq);
+		const std::string value = eq == std::string::npos ? std::string() : arg.substr(eq + 1);
+		if(key == "--pcap") {
+			options.pcap = value;
+		} else if(key == "--loops") {
+			options.loops = unsigned(strtoul(value.c_str(), nullptr, 10));
+		} else if(key == "--threads") {
+			options.threads = unsigned(strtoul(value.c_str(), nullptr, 10));
+		} else if(key == "--stages") {
+			options.stages = parse_stages(value);
+		} else if(key == "--flows") {
+			options.flows = strtoul(value.c_str(), nullptr, 10);
+		} else if(key == "--addrs") {
+			options.addrs = strtoul(value.c_str(), nullptr, 10);
+		} else if(key == "--period-us") {
+			options.period_us = strtoull(value.c_str(), nullptr, 10);
+		} else if(key == "--patterns") {
+			options.patterns_file = value;
+		} else if(key == "--pin") {
+			options.pin = true;
+		} else {
+			options.pcap.clear();
+			break;
+		}
+	}
+	if(options.pcap.empty() || options.loops == 0 || options.threads == 0 || options.stages == 0
+		|| options.flows == 0 || options.addrs == 0) {
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	Capture capture;
+	std::vector<std::unique_ptr<Worker> > workers;
+	try {
+		capture.load(options.pcap);
+		if(options.patterns_file.empty()) {
+			options.patterns.assign(std::begin(DEFAULT_PATTERNS), std::end(DEFAULT_PATTERNS));
+		} else {
+			options.patterns = load_patterns(options.patterns_file);
+		}
+		for(unsigned t = 0; t < options.threads; t++) {
+			workers.emplace_back(new Worker(options, capture));
+		}
+	} catch(const std::exception& e) {
+		fprintf(stderr, "%s\n", e.what());
+		return EXIT_FAILURE;
+	}
+
+	std::atomic<unsigned> ready(0);
+	std::vector<std::thread> threads;
+	for(unsigned t = 0; t < options.threads; t++) {
+		threads.emplace_back([&options, &workers, &ready, t]() {
+			if(options.pin) {
+				cpu_set_t cpus;
+				CPU_ZERO(&cpus);
+				CPU_SET(t % CPU_SETSIZE, &cpus);
+				pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+			}
+			// start all together, so the threads compete for the caches and the memory as they do in production
+			ready.fetch_add(1);
+			while(ready.load() < options.threads) {
+				std::this_thread::yield();
+			}
+			workers[t]->run();
+		});
+	}
+	for(auto& thread : threads) {
+		thread.join();
+	}
+
+	report(options, capture, workers);
+	return EXIT_SUCCESS;
+}
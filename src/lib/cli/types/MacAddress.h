@@ -3,10 +3,15 @@
 #include <cstdlib>
 #include <cstdint>
 #include <cstdio>
-#include <cctype>
+#include <cstring>
+#include <functional>
 
 namespace cli {
 
+/**
+ * An Ethernet address, value() packs it into the low 48 bits of an integer in the wire order,
+ * so the addresses are compared and hashed as integers (see MacHash).
+ */
 struct MacAddress {
 	static constexpr size_t ADDR_SIZE = 6;
 	using ADDR_TYPE = uint8_t;
@@ -26,40 +31,47 @@ struct MacAddress {
 		}
 	}
 
-	bool operator<(const MacAddress& rv) const noexcept {
-		for(size_t i = 0; i < ADDR_SIZE; ++i) {
-			if(addr[i] < rv.addr[i]){
-				return true;
-			}
-		}
-		return false;
+	/**
+	 * @return the address as a 48-bit integer, addr[0] is the most significant byte.
+	 */
+	inline uint64_t value() const noexcept {
+		uint32_t hi;
+		uint16_t lo;
+		memcpy(&hi, addr, sizeof(hi));
+		memcpy(&lo, addr + sizeof(hi), sizeof(lo));
+		return (uint64_t(__builtin_bswap32(hi)) << 16) | __builtin_bswap16(lo);
 	}
 
-	bool operator==(const MacAddress& rv) const noexcept {
-		for(size_t i = 0; i < ADDR_SIZE; ++i) {
-			if(addr[i] != rv.addr[i]){
-				return false;
-			}
-		}
-		return true;
+	/**
+	 * @param value - an address in the low 48 bits, see value().
+	 */
+	static MacAddress from_value(uint64_t value) noexcept {
+		MacAddress result;
+		const uint32_t hi = __builtin_bswap32(uint32_t(value >> 16));
+		const uint16_t lo = __builtin_bswap16(uint16_t(value));
+		memcpy(result.addr, &hi, sizeof(hi));
+		memcpy(result.addr + sizeof(hi), &lo, sizeof(lo));
+		return result;
+	}
+
+	inline bool operator<(const MacAddress& rv) const noexcept {
+		return value() < rv.value();
 	}
 
-	bool operator!=(const MacAddress& rv) const noexcept {
+	inline bool operator==(const MacAddress& rv) const noexcept {
+		return memcmp(addr, rv.addr, ADDR_SIZE) == 0;
+	}
+
+	inline bool operator!=(const MacAddress& rv) const noexcept {
 		return not operator==(rv);
 	}
 
 	void clear() noexcept {
-		for(size_t i = 0; i < ADDR_SIZE; ++i) {
-			addr[i] = 0;
-		}
+		memset(addr, 0, ADDR_SIZE);
 	}
 
-	bool empty() const noexcept {
-		size_t sum = 0;
-		for(size_t i = 0; i < ADDR_SIZE; ++i) {
-			sum += addr[i];
-		}
-		return sum == 0;
+	inline bool empty() const noexcept {
+		return value() == 0;
 	}
 
 	void print(FILE* out = stdout) const noexcept {
@@ -71,16 +83,24 @@ struct MacAddress {
 		}
 	}
 
+	/**
+	 * [h]h[sep][h]h[sep]...[h]h, sep - '.' or ':' or skipped.
+	 */
 	ssize_t parse(const char* str) noexcept {
 		size_t offset = 0;
 		for(size_t i = 0; i < ADDR_SIZE; ++i) {
-			uint64_t acc = 0;
-			size_t read = read_hex_byte(str + offset, acc);
-			if(read == 0){
+			const int high = hex_digit(str[offset]);
+			if(high < 0) {
 				return -1;
 			}
-			offset += read;
-			addr[i] = acc;
+			offset++;
+			const int low = hex_digit(str[offset]);
+			if(low < 0) {
+				addr[i] = ADDR_TYPE(high);
+			} else {
+				addr[i] = ADDR_TYPE((high << 4) | low);
+				offset++;
+			}
 			if(str[offset] == '.' || str[offset] == ':'){
 				offset++;
 			}
@@ -88,6 +108,27 @@ struct MacAddress {
 		return offset;
 	}
 
+	/**
+	 * Parse a list of addresses separated by ',' or the spaces, e.g. the addresses of an L2 table.
+	 * @param macs - up to @n parsed addresses.
+	 * @param offset - the offset of the first char which is not parsed, it is the terminal zero
+	 * if the list has been parsed up to its end.
+	 * @return amount of the parsed addresses.
+	 */
+	static size_t parse_list(const char* str, MacAddress* macs, size_t n, size_t& offset) noexcept {
+		size_t result = 0;
+		offset = skip_list_delims(str, 0);
+		while(result < n && str[offset]) {
+			const ssize_t read = macs[result].parse(str + offset);
+			if(read < 0 || not list_delim(str[offset + read])) {
+				break;
+			}
+			result++;
+			offset = skip_list_delims(str, offset + size_t(read));
+		}
+		return result;
+	}
+
 	template <typename T>
 	size_t copy_to(T* ar, size_t ar_nb) const noexcept {
 		const auto size = ADDR_SIZE < ar_nb ? ADDR_SIZE : ar_nb;
@@ -99,28 +140,50 @@ struct MacAddress {
 
 private:
 
-	static size_t read_hex(const char* str, uint64_t& acc) noexcept {
-		int ch = tolower(str[0]);
-		if(isxdigit(ch)){
-			if(ch >= '0' && ch <= '9'){
-				acc <<= 4;
-				acc |= (ch - '0');
-				return 1;
-			}
-			if(ch >= 'a' && ch <= 'f'){
-				acc <<= 4;
-				acc |= ch - 'a' + 10;
-				return 1;
-			}
+	static inline int hex_digit(char ch) noexcept {
+		if(ch >= '0' && ch <= '9') {
+			return ch - '0';
+		}
+		const char lower = char(ch | 0x20);
+		if(lower >= 'a' && lower <= 'f') {
+			return lower - 'a' + 10;
 		}
-		return 0;
+		return -1;
+	}
+
+	static inline bool list_delim(char ch) noexcept {
+		return ch == 0 || ch == ',' || ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r';
 	}
 
-	static size_t read_hex_byte(const char* str, uint64_t& acc) noexcept {
-		size_t offset = read_hex(str, acc);
-		return offset + read_hex(str + offset, acc);
+	static inline size_t skip_list_delims(const char* str, size_t offset) noexcept {
+		while(str[offset] && list_delim(str[offset])) {
+			offset++;
+		}
+		return offset;
 	}
 
 };
 
+/**
+ * The fmix64 finalizer of MurmurHash3 over value(), e.g. the H parameter of HashQueuePool.
+ */
+struct MacHash {
+	inline size_t operator()(const MacAddress& mac) const noexcept {
+		uint64_t h = mac.value();
+		h = (h ^ (h >> 33)) * 0xff51afd7ed558ccdull;
+		h = (h ^ (h >> 33)) * 0xc4ceb9fe1a85ec53ull;
+		return size_t(h ^ (h >> 33));
+	}
+};
+
 }; // namespace cli
+
+namespace std {
+
+/**
+ * The containers default to std::hash<Key_t>.
+ */
+template<>
+struct hash<cli::MacAddress> : public cli::MacHash {};
+
+}; // namespace std
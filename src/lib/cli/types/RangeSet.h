@@ -1,33 +1,103 @@
 #pragma once
 
 #include "Integer.h"
+#include "../../containers/BitArrayT.h"
 
+#include <algorithm>
 #include <vector>
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <cassert>
-#include <set>
 
 namespace cli {
 
 /**
  * [item[-item][,item[-item][,...]]]
+ * The items are kept as the sorted [lo, hi] ranges, the overlapping and the adjacent ones are merged,
+ * so a range takes a pair regardless of its length. A dense domain (the ports, the VLAN IDs) may be turned
+ * into a bitmap by fill() for a check per packet.
  */
 struct RangeSet {
 	using ITEM_TYPE = uint32_t;
-	std::set<ITEM_TYPE> items;
+	struct Range {
+		ITEM_TYPE lo;
+		ITEM_TYPE hi;
+	};
+	std::vector<Range> ranges;
 	static constexpr char DELIM = ',';
 	static constexpr char RANGE = '-';
 
 	void print(FILE* out = stdout) const noexcept {
-		for(const auto item : items) {
-			fprintf(out, "%u,", item);
+		for(const auto& range : ranges) {
+			if(range.lo == range.hi) {
+				fprintf(out, "%u,", range.lo);
+			} else {
+				fprintf(out, "%u-%u,", range.lo, range.hi);
+			}
+		}
+	}
+
+	/**
+	 * A binary search by the conditional moves, it takes log2(ranges) steps without branches.
+	 */
+	inline bool contains(ITEM_TYPE item) const noexcept {
+		size_t n = ranges.size();
+		if(not n) {
+			return false;
+		}
+		const Range* base = ranges.data();
+		while(n > 1) {
+			const size_t half = n / 2;
+			base = base[half].lo <= item ? base + half : base;
+			n -= half;
+		}
+		return (base->lo <= item) & (item <= base->hi);
+	}
+
+	/**
+	 * @return amount of the items.
+	 */
+	uint64_t size() const noexcept {
+		uint64_t result = 0;
+		for(const auto& range : ranges) {
+			result += uint64_t(range.hi) - range.lo + 1;
 		}
+		return result;
+	}
+
+	inline bool empty() const noexcept {
+		return ranges.empty();
+	}
+
+	/**
+	 * Set the bits of the items and clear the others, the items over bits.items_capacity() are dropped.
+	 * E.g. a port set in a bitmap of 65536 bits is checked by bits.load(port). A bitmap of no capacity stays empty.
+	 */
+	void fill(BitArrayT<1>& bits) const noexcept {
+		bits.fill(0);
+		const uint64_t capacity = bits.items_capacity();
+		if(not capacity) {
+			return;
+		}
+		for(const auto& range : ranges) {
+			const uint64_t hi = std::min<uint64_t>(range.hi, capacity - 1);
+			for(uint64_t item = range.lo; item <= hi; ++item) {
+				bits.store(size_t(item), 1);
+			}
+		}
+	}
+
+	/**
+	 * Add the items [lo, hi] to the set.
+	 */
+	void insert(ITEM_TYPE lo, ITEM_TYPE hi) noexcept {
+		ranges.push_back(Range{lo, hi});
+		merge();
 	}
 
 	ssize_t parse(const char* arg) noexcept {
-		items.clear();
+		ranges.clear();
 		enum State : unsigned {
 			WF_PAIR, WF_FIRST, WF_SECOND, WF_DELIM, END, ERR
 		};
@@ -53,14 +123,14 @@ struct RangeSet {
 					const char ch = arg[offset++];
 					switch(ch) {
 						case DELIM:
-							items.insert(item);
+							ranges.push_back(Range{item, item});
 							state = WF_PAIR;
 							break;
 						case RANGE:
 							state = WF_SECOND;
 							break;
 						default:
-							items.insert(item);
+							ranges.push_back(Range{item, item});
 							state = END;
 							break;
 					}
@@ -70,9 +140,7 @@ struct RangeSet {
 				case WF_SECOND: {
 					const size_t read = Integer::parse_offset(arg + offset, item_range, 10);
 					if(read && item_range >= item) {
-						for(ITEM_TYPE i = item; i <= item_range; ++i) {
-							items.insert(i);
-						}
+						ranges.push_back(Range{item, item_range});
 						offset += read;
 						state = WF_DELIM;
 					} else {
@@ -90,6 +158,7 @@ struct RangeSet {
 					break;
 
 				case END:
+					merge();
 					return offset;
 
 				case ERR:
@@ -101,6 +170,28 @@ struct RangeSet {
 		assert(false);
 	}
 
+private:
+
+	/**
+	 * Sort the ranges and merge the overlapping and the adjacent ones.
+	 */
+	void merge() noexcept {
+		std::sort(ranges.begin(), ranges.end(), [](const Range& a, const Range& b) {
+			return a.lo < b.lo;
+		});
+		size_t last = 0;
+		for(size_t i = 1; i < ranges.size(); ++i) {
+			if(uint64_t(ranges[i].lo) <= uint64_t(ranges[last].hi) + 1) {
+				ranges[last].hi = std::max(ranges[last].hi, ranges[i].hi);
+			} else {
+				ranges[++last] = ranges[i];
+			}
+		}
+		if(not ranges.empty()) {
+			ranges.resize(last + 1);
+		}
+	}
+
 };
 
 }; // namespace cli
@@ -166,13 +166,81 @@ public:
 		}
 	}
 
+	/**
+	 * Prefetch the chunk of @item_index item, e.g. before a burst of random updates.
+	 * @param item_index - MUST be in [0:items_capacity() - 1] range.
+	 */
+	inline void prefetch(const size_t item_index) const noexcept {
+		__builtin_prefetch(m_chunks + item_index * Width / CHUNK_BIT_WIDTH);
+	}
+
+	/**
+	 * Load @item_number items from @item_index'th index to @dst.
+	 * The whole periods of items (see PERIOD_ITEMS) are unpacked with compile-time shifts,
+	 * the items before the first period and after the last one are loaded one by one.
+	 * @param item_index - MUST be in [0:items_capacity() - @item_number] range.
+	 * @param item_number - how many items to load.
+	 * @param dst - an array of @item_number values.
+	 */
+	void load_range(size_t item_index, size_t item_number, Chunk_t* dst) const noexcept {
+		assert(item_index + item_number <= m_items_capacity);
+		const size_t item_end = item_index + item_number;
+		for(; item_index < item_end && item_index % PERIOD_ITEMS; ++item_index) {
+			*dst++ = load(item_index);
+		}
+		const Chunk_t* chunk = m_chunks + item_index / PERIOD_ITEMS * PERIOD_CHUNKS;
+		for(; item_index + PERIOD_ITEMS <= item_end; item_index += PERIOD_ITEMS) {
+			Period<0>::unpack(chunk, dst);
+			chunk += PERIOD_CHUNKS;
+			dst += PERIOD_ITEMS;
+		}
+		for(; item_index < item_end; ++item_index) {
+			*dst++ = load(item_index);
+		}
+	}
+
+	/**
+	 * Store @item_number values from @src to @item_index'th index.
+	 * The chunks of the whole periods of items are packed from scratch and written once without loading them.
+	 * @param item_index - MUST be in [0:items_capacity() - @item_number] range.
+	 * @param item_number - how many items to store.
+	 * @param src - an array of @item_number values, every value MUST be in [0:range() - 1] range.
+	 */
+	void store_range(size_t item_index, size_t item_number, const Chunk_t* src) noexcept {
+		assert(item_index + item_number <= m_items_capacity);
+		const size_t item_end = item_index + item_number;
+		for(; item_index < item_end && item_index % PERIOD_ITEMS; ++item_index) {
+			store(item_index, *src++);
+		}
+		Chunk_t* chunk = m_chunks + item_index / PERIOD_ITEMS * PERIOD_CHUNKS;
+		for(; item_index + PERIOD_ITEMS <= item_end; item_index += PERIOD_ITEMS) {
+			pack_period(src, chunk);
+			chunk += PERIOD_CHUNKS;
+			src += PERIOD_ITEMS;
+		}
+		for(; item_index < item_end; ++item_index) {
+			store(item_index, *src++);
+		}
+	}
+
 	/**
 	 * Fill the array with given value @value.
+	 * The chunks of one period of items are packed once and the pattern is copied over the chunk array.
 	 * @param value - value to fill with.
 	 */
 	void fill(Chunk_t value) noexcept {
-		for(size_t i = 0; i < m_items_capacity; ++i) {
-			store(i, value);
+		Chunk_t values[PERIOD_ITEMS];
+		Chunk_t pattern[PERIOD_CHUNKS];
+		for(size_t i = 0; i < PERIOD_ITEMS; ++i) {
+			values[i] = value;
+		}
+		pack_period(values, pattern);
+
+		size_t chunk_index = 0;
+		while(chunk_index < m_chunks_capacity) {
+			for(size_t i = 0; i < PERIOD_CHUNKS && chunk_index < m_chunks_capacity; ++i) {
+				m_chunks[chunk_index++] = pattern[i];
+			}
 		}
 	}
 
@@ -192,6 +260,68 @@ public:
 
 private:
 
+	static constexpr size_t gcd(size_t a, size_t b) noexcept {
+		return b ? gcd(b, a % b) : a;
+	}
+
+	/**
+	 * The items repeat their bit offsets every PERIOD_ITEMS items which take PERIOD_CHUNKS whole chunks,
+	 * e.g. 64 items on 3 chunks for Width 3 or 16 items on 1 chunk for Width 4.
+	 */
+	static constexpr size_t PERIOD_ITEMS = CHUNK_BIT_WIDTH / gcd(Width, CHUNK_BIT_WIDTH);
+	static constexpr size_t PERIOD_CHUNKS = Width / gcd(Width, CHUNK_BIT_WIDTH);
+
+	/**
+	 * The unrolled unpacking/packing of the items [I:PERIOD_ITEMS - 1] of a period,
+	 * the chunk index and the offset of every item are compile-time constants.
+	 * An item which straddles two chunks keeps its high bits in the first chunk as load_bits()/store_bits() do.
+	 */
+	template<size_t I, bool END = (I == PERIOD_ITEMS)>
+	struct Period {
+		static constexpr size_t CHUNK = I * Width / CHUNK_BIT_WIDTH;
+		static constexpr size_t OFFSET = I * Width % CHUNK_BIT_WIDTH;
+		static constexpr size_t LOW_BITS = OFFSET + Width > CHUNK_BIT_WIDTH ? OFFSET + Width - CHUNK_BIT_WIDTH : 0;
+		static constexpr Chunk_t MASK = ~((~0ull) << Width);
+		static constexpr Chunk_t LOW_MASK = ~((~0ull) << LOW_BITS);
+
+		static inline void unpack(const Chunk_t* chunks, Chunk_t* dst) noexcept {
+			if(LOW_BITS) {
+				dst[I] = ((chunks[CHUNK] >> OFFSET) << LOW_BITS) | (chunks[CHUNK + 1] & LOW_MASK);
+			} else {
+				dst[I] = (chunks[CHUNK] >> OFFSET) & MASK;
+			}
+			Period<I + 1>::unpack(chunks, dst);
+		}
+
+		static inline void pack(const Chunk_t* src, Chunk_t* chunks) noexcept {
+			if(LOW_BITS) {
+				chunks[CHUNK] |= (src[I] >> LOW_BITS) << OFFSET;
+				chunks[CHUNK + 1] |= src[I] & LOW_MASK;
+			} else {
+				chunks[CHUNK] |= src[I] << OFFSET;
+			}
+			Period<I + 1>::pack(src, chunks);
+		}
+	};
+
+	template<size_t I>
+	struct Period<I, true> {
+		static inline void unpack(const Chunk_t*, Chunk_t*) noexcept {}
+
+		static inline void pack(const Chunk_t*, Chunk_t*) noexcept {}
+	};
+
+	/**
+	 * Pack PERIOD_ITEMS values from @src to PERIOD_CHUNKS chunks.
+	 */
+	static inline void pack_period(const Chunk_t* src, Chunk_t* chunks) noexcept {
+		Chunk_t packed[PERIOD_CHUNKS] = {};
+		Period<0>::pack(src, packed);
+		for(size_t i = 0; i < PERIOD_CHUNKS; ++i) {
+			chunks[i] = packed[i];
+		}
+	}
+
 	/**
 	 * Try to load @bit_width bits from @chunk_offset offset to @dst.
 	 * @param chunk - a chunk to load from.
@@ -0,0 +1,217 @@
+#pragma once
+
+#include "BitArrayT.h"
+
+/**
+ * Header-only. No dependencies.
+ *
+ * ConcurrentBitArrayT template class implements an array of bits sized unsigned counters called Items
+ * which several threads update without locks, e.g. the packed counters of a count-min sketch.
+ * Unlike BitArrayT an Item never straddles two chunks: a chunk keeps CHUNK_ITEMS items
+ * and its (CHUNK_BIT_WIDTH % Width) high bits are unused, so every update is a CAS of one chunk.
+ * For the widths which divide CHUNK_BIT_WIDTH the packing is as dense as the BitArrayT one.
+ * The updates are relaxed atomics, they don't order the other memory accesses of the threads.
+ *
+ * Sample of packing 3-bit items on 8-bit chunks.
+ *
+ * iZ:X - X'th bit of the Z'th item, -- unused bit.
+ * chunk index | <----           8 bit chunk            ---- > |
+ *           0 | --  | --  |i1:2 |i1:1 |i1:0 |i0:2 |i0:1 |i0:0 |
+ *           1 | --  | --  |i3:2 |i3:1 |i3:0 |i2:2 |i2:1 |i2:0 |
+ * 			...
+ *
+ */
+template<BitArrayTWidth_t Width>
+class ConcurrentBitArrayT {
+
+	// short aliases
+	using Chunk_t = BitArrayTChunk_t;
+	using Width_t = BitArrayTWidth_t;
+
+	// calculate the limit constants which are based on the types section
+	static constexpr Width_t CHUNK_BYTE_WIDTH = sizeof(Chunk_t);
+	static constexpr Width_t CHUNK_BIT_WIDTH = CHUNK_BYTE_WIDTH << 3ull;
+	static constexpr Width_t BIT_WIDTH_MIN = 1u;
+	static constexpr Width_t BIT_WIDTH_MAX = CHUNK_BIT_WIDTH - 1u;
+	static constexpr size_t CHUNK_ITEMS = CHUNK_BIT_WIDTH / Width;
+	static constexpr size_t CHUNK_CAPACITY_MIN = 1ull;
+	static constexpr size_t CHUNK_CAPACITY_MAX = (~(0ull)) / CHUNK_BIT_WIDTH;
+	static constexpr size_t ITEM_CAPACITY_MIN = 1ull;
+	static constexpr size_t ITEM_CAPACITY_MAX = (~(0ull)) / CHUNK_BIT_WIDTH;
+	static constexpr Chunk_t ITEM_MASK = ~((~0ull) << Width);
+
+	Chunk_t* m_chunks = nullptr;
+	size_t m_chunks_capacity = 0;
+	size_t m_items_capacity = 0;
+	bool m_internal_mem = false;
+
+public:
+	ConcurrentBitArrayT(const ConcurrentBitArrayT&) = delete;
+	ConcurrentBitArrayT(ConcurrentBitArrayT&&) = delete;
+
+	ConcurrentBitArrayT& operator=(const ConcurrentBitArrayT&) = delete;
+	ConcurrentBitArrayT& operator=(ConcurrentBitArrayT&&) = delete;
+
+	ConcurrentBitArrayT() noexcept = default;
+
+	~ConcurrentBitArrayT() noexcept {
+		destroy();
+	}
+
+	/**
+	 * Create a ConcurrentBitArrayT instance using an external memory space.
+	 * @param buffer - An external memory array aligned to CHUNK_BYTE_WIDTH. MUST NOT be NULL.
+	 * @param buffer_bytes - Size of @buffer in bytes. MUST be in [1:@buffer_bytes / CHUNK_WIDTH_BYTES]
+	 */
+	void allocate(void* buffer, const size_t buffer_bytes) noexcept {
+		static_assert(Width >= BIT_WIDTH_MIN, "Template argument 'Width' must be greater than BIT_WIDTH_MIN.");
+		static_assert(Width <= BIT_WIDTH_MAX, "Template argument 'Width' must be less than BIT_WIDTH_MAX.");
+		const size_t chunk_capacity = buffer_bytes / CHUNK_BYTE_WIDTH;
+
+		assert(m_chunks == nullptr);
+		assert(buffer);
+		assert(reinterpret_cast<uintptr_t>(buffer) % CHUNK_BYTE_WIDTH == 0);
+		assert(chunk_capacity >= CHUNK_CAPACITY_MIN);
+		assert(chunk_capacity <= CHUNK_CAPACITY_MAX);
+
+		m_chunks = reinterpret_cast<Chunk_t*>(buffer);
+		m_chunks_capacity = chunk_capacity;
+		m_items_capacity = m_chunks_capacity * CHUNK_ITEMS;
+	}
+
+	/**
+	 * Create a ConcurrentBitArrayT instance using its own memory space.
+	 * @param item_capacity - the array size in items. MUST be greater than zero.
+	 */
+	void allocate(size_t item_capacity) noexcept {
+		static_assert(Width >= BIT_WIDTH_MIN, "Template argument 'Width' must be greater than BIT_WIDTH_MIN.");
+		static_assert(Width <= BIT_WIDTH_MAX, "Template argument 'Width' must be less than BIT_WIDTH_MAX.");
+
+		assert(m_chunks == nullptr);
+		assert(item_capacity >= ITEM_CAPACITY_MIN);
+		assert(item_capacity <= ITEM_CAPACITY_MAX);
+
+		size_t chunk_capacity = item_capacity / CHUNK_ITEMS;
+		chunk_capacity += (item_capacity % CHUNK_ITEMS) ? 1u : 0u;
+		m_chunks = new Chunk_t[chunk_capacity];
+		assert(m_chunks);
+		m_chunks_capacity = chunk_capacity;
+		m_items_capacity = m_chunks_capacity * CHUNK_ITEMS;
+		m_internal_mem = true;
+	}
+
+	void destroy() noexcept {
+		if(m_internal_mem && m_chunks) {
+			delete[] m_chunks;
+		}
+		m_chunks = nullptr;
+		m_chunks_capacity = 0;
+		m_items_capacity = 0;
+	}
+
+	// getter collection
+	inline size_t chunk_capacity() const noexcept {
+		return m_chunks_capacity;
+	}
+
+	inline size_t items_capacity() const noexcept {
+		return m_items_capacity;
+	}
+
+	inline size_t byte_capacity() const noexcept {
+		return m_chunks_capacity * CHUNK_BYTE_WIDTH;
+	}
+
+	inline size_t bits_capacity() const noexcept {
+		return m_chunks_capacity * CHUNK_BIT_WIDTH;
+	}
+
+	/**
+	 * Load @item_index item, it may be called concurrently with the updates.
+	 * @param item_index - MUST be in [0:items_capacity() - 1] range.
+	 * @return - a loaded value in [0:range() - 1] range.
+	 */
+	Chunk_t load(const size_t item_index) const noexcept {
+		const Chunk_t chunk = __atomic_load_n(m_chunks + chunk_index(item_index), __ATOMIC_RELAXED);
+		return (chunk >> chunk_offset(item_index)) & ITEM_MASK;
+	}
+
+	/**
+	 * Store @value to the @item_index'th index, the neighbour items may be updated concurrently.
+	 * @param item_index - MUST be in [0:items_capacity() - 1] range.
+	 * @param value - MUST be in [0:range() - 1] range.
+	 */
+	void store(size_t item_index, Chunk_t value) noexcept {
+		Chunk_t* chunk = m_chunks + chunk_index(item_index);
+		const size_t offset = chunk_offset(item_index);
+		const Chunk_t mask = ITEM_MASK << offset;
+		Chunk_t expected = __atomic_load_n(chunk, __ATOMIC_RELAXED);
+		Chunk_t desired;
+		do {
+			desired = (expected & ~mask) | ((value << offset) & mask);
+		} while(not __atomic_compare_exchange_n(chunk, &expected, desired, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+	}
+
+	/**
+	 * Add @delta to the @item_index'th item saturating at value_max(), no concurrent update is lost.
+	 * @param item_index - MUST be in [0:items_capacity() - 1] range.
+	 * @param delta - a value to add.
+	 * @return - the value of the item before the addition.
+	 */
+	Chunk_t fetch_add_sat(size_t item_index, Chunk_t delta) noexcept {
+		Chunk_t* chunk = m_chunks + chunk_index(item_index);
+		const size_t offset = chunk_offset(item_index);
+		const Chunk_t mask = ITEM_MASK << offset;
+		Chunk_t expected = __atomic_load_n(chunk, __ATOMIC_RELAXED);
+		Chunk_t value;
+		Chunk_t desired;
+		do {
+			value = (expected >> offset) & ITEM_MASK;
+			if(value == value_max())
+				return value;
+
+			const Chunk_t sum = delta < value_max() - value ? value + delta : value_max();
+			desired = (expected & ~mask) | (sum << offset);
+		} while(not __atomic_compare_exchange_n(chunk, &expected, desired, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+		return value;
+	}
+
+	/**
+	 * Fill the array with given value @value, it must not be called concurrently with the updates.
+	 * @param value - value to fill with.
+	 */
+	void fill(Chunk_t value) noexcept {
+		Chunk_t pattern = 0;
+		for(size_t i = 0; i < CHUNK_ITEMS; ++i) {
+			pattern |= (value & ITEM_MASK) << (i * Width);
+		}
+		for(size_t i = 0; i < m_chunks_capacity; ++i) {
+			__atomic_store_n(m_chunks + i, pattern, __ATOMIC_RELAXED);
+		}
+	}
+
+	/**
+	 * The range limit of the item which the template can contain.
+	 */
+	static constexpr Chunk_t range() noexcept {
+		return (1ull << Width);
+	}
+
+	/**
+	 * The maximum value that the template can contain.
+	 */
+	static constexpr Chunk_t value_max() noexcept {
+		return range() - 1ull;
+	}
+
+private:
+
+	static inline size_t chunk_index(size_t item_index) noexcept {
+		return item_index / CHUNK_ITEMS;
+	}
+
+	static inline size_t chunk_offset(size_t item_index) noexcept {
+		return (item_index % CHUNK_ITEMS) * Width;
+	}
+
+};
@@ -0,0 +1,88 @@
+#ifndef DPDK_ALLOCATOR_H
+#define DPDK_ALLOCATOR_H
+
+#include <cstddef>
+#include <new>
+#include <utility>
+
+#if defined(__has_include)
+#if __has_include(<rte_malloc.h>)
+#define DPDK_ALLOCATOR_RTE_MALLOC 1
+#endif
+#endif
+
+#ifdef DPDK_ALLOCATOR_RTE_MALLOC
+#include <rte_lcore.h>
+#include <rte_malloc.h>
+#else
+#include "../memory/PageAllocator.h"
+#endif
+
+namespace dpdk {
+
+#ifdef DPDK_ALLOCATOR_RTE_MALLOC
+
+/**
+ * The allocator of the DPDK heap, the memory is taken from the hugepages of the NUMA socket of the calling lcore
+ * and it is cache line aligned, so a pool of a worker should be allocated on the worker lcore.
+ */
+template<typename T>
+struct Allocator {
+	using value_type = T;
+	using pointer = T*;
+	using const_pointer = const T*;
+	using size_type = size_t;
+	using difference_type = ptrdiff_t;
+
+	template<typename U>
+	struct rebind {
+		using other = Allocator<U>;
+	};
+
+	Allocator() noexcept = default;
+
+	template<typename U>
+	Allocator(const Allocator<U>&) noexcept {}
+
+	/**
+	 * @return nullptr - if the DPDK heap of the socket is exhausted.
+	 */
+	T* allocate(size_t n) noexcept {
+		return static_cast<T*>(rte_malloc_socket(nullptr, n * sizeof(T), RTE_CACHE_LINE_SIZE, rte_socket_id()));
+	}
+
+	void deallocate(T* ptr, size_t) noexcept {
+		rte_free(ptr);
+	}
+
+	template<typename... Args>
+	void construct(T* ptr, Args&& ... args) noexcept {
+		::new(static_cast<void*>(ptr)) T(std::forward<Args>(args)...);
+	}
+
+	void destroy(T* ptr) noexcept {
+		ptr->~T();
+	}
+
+	bool operator==(const Allocator&) const noexcept {
+		return true;
+	}
+
+	bool operator!=(const Allocator&) const noexcept {
+		return false;
+	}
+};
+
+#else
+
+/**
+ * Without DPDK the storages are mapped with the huge pages of the NUMA node of the calling thread.
+ */
+template<typename T>
+using Allocator = memory::NumaAllocator<T>;
+
+#endif
+
+}; // namespace dpdk
+
+#endif /* DPDK_ALLOCATOR_H */
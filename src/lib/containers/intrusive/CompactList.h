@@ -0,0 +1,350 @@
+#ifndef INTRUSIVE_COMPACTLIST_H
+#define INTRUSIVE_COMPACTLIST_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <cassert>
+
+namespace intrusive {
+
+/**
+ * A compact hook of CompactList, 8 bytes instead of the 24 bytes of LinkedListHook.
+ * The links are 32-bit offsets from the node to its neighbours in node units,
+ * so all the nodes of a list must live in the same array (e.g. the storage of a pool) of less than 2^31 nodes.
+ * NONE marks the missed neighbour of the head and of the tail, UNLINKED in il_prev marks a free node.
+ */
+template<typename N>
+struct CompactListHook {
+	static constexpr int32_t NONE = 0;
+	static constexpr int32_t UNLINKED = INT32_MIN;
+
+	int32_t il_next;
+	int32_t il_prev;
+
+	CompactListHook() noexcept : il_next(NONE), il_prev(UNLINKED) {}
+
+	CompactListHook(const CompactListHook&) = delete;
+	CompactListHook& operator=(const CompactListHook&) = delete;
+
+	CompactListHook(CompactListHook&&) = delete;
+	CompactListHook& operator=(CompactListHook&&) = delete;
+
+	inline bool linked() const noexcept {
+		return il_prev != UNLINKED;
+	}
+};
+
+/**
+ * A LinkedList of CompactListHook nodes, it has the same interface as LinkedList.
+ */
+template<typename ListNode>
+class CompactList {
+protected:
+	using Hook_t = CompactListHook<ListNode>;
+
+	static constexpr int32_t NONE = Hook_t::NONE;
+	static constexpr int32_t UNLINKED = Hook_t::UNLINKED;
+
+	ListNode* m_head;
+	ListNode* m_tail;
+	size_t m_size;
+
+	static inline ListNode* next_of(ListNode* node) noexcept {
+		return node->il_next != NONE ? node + node->il_next : nullptr;
+	}
+
+	static inline ListNode* prev_of(ListNode* node) noexcept {
+		return node->il_prev != NONE ? node + node->il_prev : nullptr;
+	}
+
+	static inline const ListNode* next_of(const ListNode* node) noexcept {
+		return node->il_next != NONE ? node + node->il_next : nullptr;
+	}
+
+	static inline const ListNode* prev_of(const ListNode* node) noexcept {
+		return node->il_prev != NONE ? node + node->il_prev : nullptr;
+	}
+
+	static inline int32_t offset(const ListNode* from, const ListNode* to) noexcept {
+		return to ? int32_t(to - from) : NONE;
+	}
+
+	template<typename N, bool REVERSE>
+	struct Iterator {
+		friend class CompactList;
+
+		Iterator() noexcept : node_ptr(nullptr) {}
+
+		Iterator(N* node) noexcept : node_ptr(node) {}
+
+		bool operator==(const Iterator& it) const noexcept {
+			return node_ptr == it.node_ptr;
+		}
+
+		bool operator!=(const Iterator& it) const noexcept {
+			return node_ptr != it.node_ptr;
+		}
+
+		Iterator& operator++() noexcept {
+			node_ptr = REVERSE ? prev_of(node_ptr) : next_of(node_ptr);
+			return *this;
+		}
+
+		Iterator operator++(int)noexcept {
+			node_ptr = REVERSE ? prev_of(node_ptr) : next_of(node_ptr);
+			return Iterator(node_ptr);
+		}
+
+		const N& operator*() const noexcept {
+			return *node_ptr;
+		}
+
+		N& operator*() noexcept {
+			return *node_ptr;
+		}
+
+		const N* operator->() const noexcept {
+			return node_ptr;
+		}
+
+		N* operator->() noexcept {
+			return node_ptr;
+		}
+
+		operator bool() const noexcept {
+			return node_ptr;
+		}
+
+		inline const N* get() const noexcept {
+			return node_ptr;
+		}
+
+		inline N* get() noexcept {
+			return node_ptr;
+		}
+
+	private:
+		N* node_ptr;
+	};
+
+public:
+
+	using Iterator_t = Iterator<ListNode, false>;
+	using ConstIterator_t = Iterator<const ListNode, false>;
+	using ReverseIterator_t = Iterator<ListNode, true>;
+	using ConstReverseIterator_t = Iterator<const ListNode, true>;
+
+	CompactList() noexcept : m_head(nullptr), m_tail(nullptr), m_size(0) {}
+
+	CompactList(const CompactList&) = delete;
+	CompactList& operator=(const CompactList&) = delete;
+
+	CompactList(CompactList&& rv) : m_head(rv.m_head), m_tail(rv.m_tail), m_size(rv.m_size) {
+		rv.m_head = rv.m_tail = nullptr;
+		rv.m_size = 0;
+	}
+
+	CompactList& operator=(CompactList&& rv) {
+		if(this != &rv) {
+			m_head = rv.m_head;
+			m_tail = rv.m_tail;
+			m_size = rv.m_size;
+			rv.clean_state();
+		}
+		return *this;
+	}
+
+	/**
+	 * Be careful, The list must be empty before the storage has been destroyed.
+	 */
+	virtual ~CompactList() noexcept {
+		clear();
+		clean_state();
+	}
+
+	ListNode* head() noexcept {
+		return m_head;
+	}
+
+	ListNode* tail() noexcept {
+		return m_tail;
+	}
+
+	void push_front(ListNode& node) noexcept {
+		check_free(node); // TODO: debug
+		if(m_head)
+			insert_before(*m_head, node);
+		else
+			link_first(node);
+	}
+
+	void push_back(ListNode& node) noexcept {
+		check_free(node); // TODO: debug
+		if(m_tail)
+			insert_after(*m_tail, node);
+		else
+			link_first(node);
+	}
+
+	ListNode* pop_front() noexcept {
+		ListNode* result = m_head;
+		if(result) {
+			remove(*result);
+		}
+		return result;
+	}
+
+	ListNode* pop_back() noexcept {
+		ListNode* result = m_tail;
+		if(result) {
+			remove(*result);
+		}
+		return result;
+	}
+
+	void insert_before(ListNode& before, ListNode& node) noexcept {
+		check_linked(before); // TODO: debug
+		check_free(node); // TODO: debug
+		ListNode* prev = prev_of(&before);
+		node.il_next = offset(&node, &before);
+		node.il_prev = offset(&node, prev);
+		before.il_prev = offset(&before, &node);
+		if(prev)
+			prev->il_next = offset(prev, &node);
+		else
+			m_head = &node;
+		m_size++;
+	}
+
+	void insert_after(ListNode& after, ListNode& node) noexcept {
+		check_linked(after); // TODO: debug
+		check_free(node); // TODO: debug
+		ListNode* next = next_of(&after);
+		node.il_prev = offset(&node, &after);
+		node.il_next = offset(&node, next);
+		after.il_next = offset(&after, &node);
+		if(next)
+			next->il_prev = offset(next, &node);
+		else
+			m_tail = &node;
+		m_size++;
+	}
+
+	void remove(ListNode& node) noexcept {
+		check_linked(node); // TODO: debug
+		ListNode* prev = prev_of(&node);
+		ListNode* next = next_of(&node);
+		if(prev)
+			prev->il_next = offset(prev, next);
+		else
+			m_head = next;
+		if(next)
+			next->il_prev = offset(next, prev);
+		else
+			m_tail = prev;
+		node.il_next = NONE;
+		node.il_prev = UNLINKED;
+		m_size--;
+	}
+
+	/**
+	 * Move the 'n' nodes from 'first' to 'last' of the list 'from' to the back of this list,
+	 * only the ends of the range are relinked and the sizes are updated once.
+	 * The range must be linked in 'from' in this order (a range of a single node has first == last).
+	 */
+	void splice_back(CompactList& from, ListNode& first, ListNode& last, size_t n) noexcept {
+		check_linked(first); // TODO: debug
+		check_linked(last); // TODO: debug
+		ListNode* prev = prev_of(&first);
+		ListNode* next = next_of(&last);
+		if(prev)
+			prev->il_next = offset(prev, next);
+		else
+			from.m_head = next;
+		if(next)
+			next->il_prev = offset(next, prev);
+		else
+			from.m_tail = prev;
+		from.m_size -= n;
+
+		first.il_prev = offset(&first, m_tail);
+		last.il_next = NONE;
+		if(m_tail)
+			m_tail->il_next = offset(m_tail, &first);
+		else
+			m_head = &first;
+		m_tail = &last;
+		m_size += n;
+	}
+
+	/**
+	 * Unlink all objects in the list.
+	 */
+	void clear() noexcept {
+		while(m_head)
+			pop_front();
+	}
+
+	inline size_t size() const noexcept {
+		return m_size;
+	}
+
+	inline Iterator_t begin() noexcept {
+		return Iterator_t(m_head);
+	}
+
+	inline ReverseIterator_t rbegin() noexcept {
+		return ReverseIterator_t(m_tail);
+	}
+
+	inline ConstIterator_t cbegin() const noexcept {
+		return ConstIterator_t(m_head);
+	}
+
+	inline ConstReverseIterator_t crbegin() const noexcept {
+		return ConstReverseIterator_t(m_tail);
+	}
+
+	inline Iterator_t end() const noexcept {
+		return Iterator_t();
+	}
+
+	inline ReverseIterator_t rend() noexcept {
+		return ReverseIterator_t();
+	}
+
+	inline ConstIterator_t cend() const noexcept {
+		return ConstIterator_t();
+	}
+
+	inline ConstReverseIterator_t crend() const noexcept {
+		return ConstReverseIterator_t();
+	}
+
+private:
+
+	inline static void check_free(ListNode& node) noexcept {
+		assert(not node.linked());
+	}
+
+	inline static void check_linked(ListNode& node) noexcept {
+		assert(node.linked());
+	}
+
+	inline void link_first(ListNode& node) noexcept {
+		node.il_next = NONE;
+		node.il_prev = NONE;
+		m_head = m_tail = &node;
+		m_size++;
+	}
+
+	inline void clean_state() noexcept {
+		m_head = m_tail = nullptr;
+		m_size = 0;
+	}
+
+};
+
+}; // namespace intrusive
+
+#endif /* INTRUSIVE_COMPACTLIST_H */
@@ -0,0 +1,341 @@
+#ifndef INTRUSIVE_CONCURRENTHASHMAP_H
+#define INTRUSIVE_CONCURRENTHASHMAP_H
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+#include "HashMap.h"
+
+namespace intrusive {
+
+/**
+ * A hook of ConcurrentHashMap, 'im_next' is read by the lookups while the writers relink the chain.
+ */
+template<typename K, typename V>
+struct ConcurrentHashMapHook {
+	std::atomic<V*> im_next;
+	K im_key;
+	bool im_linked;
+
+	ConcurrentHashMapHook() noexcept : im_next(nullptr), im_key(), im_linked(false) {}
+
+	ConcurrentHashMapHook(const ConcurrentHashMapHook&) = delete;
+	ConcurrentHashMapHook& operator=(const ConcurrentHashMapHook&) = delete;
+
+	ConcurrentHashMapHook(ConcurrentHashMapHook&&) = delete;
+	ConcurrentHashMapHook& operator=(ConcurrentHashMapHook&&) = delete;
+};
+
+/**
+ * A bucket of ConcurrentHashMap: the head of the chain is pushed with a CAS,
+ * 'lock' serializes the unlinks of the bucket only.
+ */
+template<typename MapData_t>
+struct ConcurrentHashMapBucket {
+	std::atomic<MapData_t*> head;
+	std::atomic<uint32_t> lock;
+	std::atomic<uint32_t> size;
+
+	ConcurrentHashMapBucket() noexcept : head(nullptr), lock(0), size(0) {}
+
+	ConcurrentHashMapBucket(const ConcurrentHashMapBucket&) = delete;
+	ConcurrentHashMapBucket& operator=(const ConcurrentHashMapBucket&) = delete;
+
+	ConcurrentHashMapBucket(ConcurrentHashMapBucket&&) = delete;
+	ConcurrentHashMapBucket& operator=(ConcurrentHashMapBucket&&) = delete;
+};
+
+/**
+ * An unordered intrusive hash map which is shared by many threads without a map-wide lock,
+ * for the tables which cannot be sharded by key (e.g. the sessions which every worker looks up).
+ * Can hold many items for one key, the nodes are ConcurrentHashMapHook ones and live in the storage
+ * of the caller (e.g. ConcurrentPool) as the nodes of HashMap do.
+ *
+ * - find() is wait-free: a walk of a chain with the acquire loads, it never takes a lock or retries;
+ * - link() and find_or_link() are lock-free: a node is pushed to the head of its chain with a CAS;
+ * - remove() takes the spin lock of the bucket of the node, so the unlinks of the bucket are serialized,
+ *   while the links and the lookups of the bucket and the other buckets go on.
+ * An unlinked node keeps its 'im_next', so a lookup which stands on it goes on to the rest of the chain.
+ * Hence a removed node must not be linked again or freed until every thread which might have seen it
+ * has passed a grace period, e.g. storage::Qsbr::synchronize() with the lookups reporting quiescent().
+ * The map doesn't reclaim the nodes, the owner of a node does.
+ *
+ * The bucket list is fixed: the split-ordered resizing needs the marked pointers in the hooks,
+ * so the map is sized for its capacity (HashMapSizing::POW2 is used), clear() and the destructor
+ * must not race with the other operations.
+ *
+ * Using sample:
+ * storage::Qsbr<> qsbr;
+ * Map_t map(capacity * 2);
+ * map.allocate();
+ * // a worker
+ * qsbr.online(worker_id);
+ * for(;;) {
+ *     Node_t* node = map.find(key);
+ *     ...
+ *     map.remove(*old); retired.push_back(old); // linked again after the next synchronize()
+ *     qsbr.quiescent(worker_id);
+ * }
+ */
+template<typename K, typename MapNode, typename H = HashMix<K>, typename A = std::allocator<ConcurrentHashMapBucket<MapNode> > >
+class ConcurrentHashMap {
+	friend class TestConcurrentHashMap;
+
+public:
+	using Bucket_t = typename A::value_type;
+
+private:
+	static constexpr unsigned LOCK_SPINS = 64; // the pauses before a waiting writer yields its core
+
+	Bucket_t* m_buckets;
+	const size_t m_bucket_count; // a power of two
+	const size_t m_mask;
+	H m_hasher;
+	A m_allocator;
+	HashMapMetrics* m_metrics;
+
+public:
+
+	/**
+	 * @param bucket_count - amount of buckets, it is rounded up to a power of two.
+	 */
+	ConcurrentHashMap(size_t bucket_count) noexcept
+		: m_buckets(nullptr)
+		, m_bucket_count(round_up(bucket_count))
+		, m_mask(m_bucket_count - 1)
+		, m_hasher()
+		, m_allocator()
+		, m_metrics(nullptr) {}
+
+	ConcurrentHashMap(const ConcurrentHashMap&) = delete;
+	ConcurrentHashMap& operator=(const ConcurrentHashMap&) = delete;
+
+	ConcurrentHashMap(ConcurrentHashMap&&) = delete;
+	ConcurrentHashMap& operator=(ConcurrentHashMap&&) = delete;
+
+	/**
+	 * Be careful, the map must be cleared before the storage of the nodes has been destroyed.
+	 */
+	virtual ~ConcurrentHashMap() noexcept {
+		if(m_buckets) {
+			for(size_t i = 0; i < m_bucket_count; i++) {
+				m_allocator.destroy(m_buckets + i);
+			}
+			m_allocator.deallocate(m_buckets, m_bucket_count);
+			m_buckets = nullptr;
+		}
+	}
+
+	/**
+	 * Allocate the bucket storage of the map, before the map is shared.
+	 * @return true - if the bucket storage has been allocated successfully.
+	 */
+	bool allocate() noexcept {
+		if(m_buckets)
+			return false;
+
+		m_buckets = m_allocator.allocate(m_bucket_count);
+		if(not m_buckets)
+			return false;
+
+		for(size_t i = 0; i < m_bucket_count; i++) {
+			m_allocator.construct(m_buckets + i);
+		}
+		return true;
+	}
+
+	/**
+	 * Link a key with a node, lock-free.
+	 * The node must not be linked and must have passed a grace period since it has been removed.
+	 * @return the node.
+	 */
+	MapNode* link(const K& key, MapNode& node) noexcept {
+		assert(not node.im_linked);
+		node.im_key = key;
+		node.im_linked = true;
+		Bucket_t& bucket = m_buckets[index(m_hasher(key))];
+		MapNode* head = bucket.head.load(std::memory_order_relaxed);
+		do {
+			node.im_next.store(head, std::memory_order_relaxed);
+		} while(not bucket.head.compare_exchange_weak(head, &node, std::memory_order_release, std::memory_order_relaxed));
+		bucket.size.fetch_add(1, std::memory_order_relaxed);
+		return &node;
+	}
+
+	/**
+	 * Find the first node which is linked to the key or link the key with 'node' if there is none, lock-free.
+	 * Two racing calls of one key link one node, the other one gets that node.
+	 * @param node - a free node, nullptr makes it a plain find().
+	 * @return the found node, 'node' if it has been linked or nullptr if there is no node to link.
+	 */
+	MapNode* find_or_link(const K& key, MapNode* node) noexcept {
+		Bucket_t& bucket = m_buckets[index(m_hasher(key))];
+		MapNode* head = bucket.head.load(std::memory_order_acquire);
+		for(;;) {
+			MapNode* found = find_from(head, key);
+			if(found || node == nullptr) {
+				count_lookup(found);
+				return found;
+			}
+			assert(not node->im_linked);
+			node->im_key = key;
+			node->im_next.store(head, std::memory_order_relaxed);
+			// the release publishes the key, the acquire of a failure makes the new head walkable
+			if(bucket.head.compare_exchange_weak(head, node, std::memory_order_acq_rel, std::memory_order_acquire)) {
+				break;
+			}
+		}
+		count_lookup(nullptr);
+		node->im_linked = true;
+		bucket.size.fetch_add(1, std::memory_order_relaxed);
+		return node;
+	}
+
+	/**
+	 * Find the first node which is linked to the key, wait-free.
+	 * The node must not be referenced after the next quiescent state of the caller.
+	 * @return nullptr - if there is none.
+	 */
+	MapNode* find(const K& key) const noexcept {
+		MapNode* found = find_from(m_buckets[index(m_hasher(key))].head.load(std::memory_order_acquire), key);
+		count_lookup(found);
+		return found;
+	}
+
+	/**
+	 * @return the next node after 'node' which is linked to the key, nullptr - if there is none.
+	 */
+	MapNode* find_next(const MapNode& node) const noexcept {
+		return find_from(node.im_next.load(std::memory_order_acquire), node.im_key);
+	}
+
+	/**
+	 * Unlink a node, the unlinks of its bucket are serialized.
+	 * The node must be linked, it may be linked again or freed after a grace period only.
+	 */
+	void remove(MapNode& node) noexcept {
+		assert(node.im_linked);
+		Bucket_t& bucket = m_buckets[index(m_hasher(node.im_key))];
+		lock(bucket);
+		MapNode* const next = node.im_next.load(std::memory_order_acquire);
+		MapNode* head = &node;
+		// the links push the head concurrently, once the node is not the head it can't become one again
+		if(not bucket.head.compare_exchange_strong(head, next, std::memory_order_release, std::memory_order_acquire)) {
+			MapNode* prev = head;
+			MapNode* current = prev->im_next.load(std::memory_order_acquire);
+			while(current != &node) {
+				assert(current); // the node is linked to this bucket
+				prev = current;
+				current = prev->im_next.load(std::memory_order_acquire);
+			}
+			prev->im_next.store(next, std::memory_order_release);
+		}
+		unlock(bucket);
+		bucket.size.fetch_sub(1, std::memory_order_relaxed);
+		node.im_linked = false;
+	}
+
+	/**
+	 * Unlink all the nodes, the map must not be used by the other threads meanwhile.
+	 */
+	void clear() noexcept {
+		for(size_t i = 0; i < m_bucket_count; i++) {
+			MapNode* node = m_buckets[i].head.load(std::memory_order_relaxed);
+			while(node) {
+				MapNode* next = node->im_next.load(std::memory_order_relaxed);
+				node->im_next.store(nullptr, std::memory_order_relaxed);
+				node->im_linked = false;
+				node = next;
+			}
+			m_buckets[i].head.store(nullptr, std::memory_order_relaxed);
+			m_buckets[i].size.store(0, std::memory_order_relaxed);
+		}
+	}
+
+	inline void prefetch(const K& key) const noexcept {
+		__builtin_prefetch(m_buckets + index(m_hasher(key)));
+	}
+
+	/**
+	 * @return amount of the linked nodes, the buckets are summed up, so it is a snapshot for the stats.
+	 */
+	size_t size() const noexcept {
+		size_t result = 0;
+		for(size_t i = 0; i < m_bucket_count; i++) {
+			result += m_buckets[i].size.load(std::memory_order_relaxed);
+		}
+		return result;
+	}
+
+	inline size_t buckets() const noexcept {
+		return m_bucket_count;
+	}
+
+	inline size_t storage_bytes() const noexcept {
+		return m_bucket_count * sizeof(Bucket_t);
+	}
+
+	/**
+	 * @param metrics - the counters of the lookups, the cells of the threads are written without the atomic increments.
+	 */
+	inline void set_metrics(HashMapMetrics* metrics) noexcept {
+		m_metrics = metrics;
+	}
+
+private:
+
+	static inline size_t round_up(size_t buckets) noexcept {
+		size_t result = 1;
+		while(result < buckets) {
+			result <<= 1;
+		}
+		return result;
+	}
+
+	inline size_t index(size_t hash) const noexcept {
+		return hash & m_mask;
+	}
+
+	static inline MapNode* find_from(MapNode* node, const K& key) noexcept {
+		while(node && not (node->im_key == key)) {
+			node = node->im_next.load(std::memory_order_acquire);
+		}
+		return node;
+	}
+
+	static inline void lock(Bucket_t& bucket) noexcept {
+		unsigned spins = 0;
+		while(bucket.lock.exchange(1, std::memory_order_acquire)) {
+			while(bucket.lock.load(std::memory_order_relaxed)) {
+				if(++spins < LOCK_SPINS) {
+#if defined(__x86_64__) || defined(__i386__)
+					__builtin_ia32_pause();
+#endif
+				} else {
+					std::this_thread::yield();
+				}
+			}
+		}
+	}
+
+	static inline void unlock(Bucket_t& bucket) noexcept {
+		bucket.lock.store(0, std::memory_order_release);
+	}
+
+	inline void count_lookup(const MapNode* found) const noexcept {
+		if(utils::Metrics::ENABLED && m_metrics) {
+			m_metrics->lookups.add();
+			if(found) {
+				m_metrics->hits.add();
+			}
+		}
+	}
+
+};
+
+}; // namespace intrusive
+
+#endif /* INTRUSIVE_CONCURRENTHASHMAP_H */
@@ -3,6 +3,9 @@
 
 #include <memory>
 #include <cassert>
+#include <cstdint>
+
+#include "../../utils/Metrics.h"
 
 namespace intrusive {
 
@@ -21,6 +24,31 @@ struct HashMapHook {
 	HashMapHook& operator=(HashMapHook&&) = delete;
 };
 
+/**
+ * A hook for the doubly linked layout (see HashMapDListBucket).
+ * 'im_pprev' points to the link which points to the node,
+ * that is either the head of the bucket or 'im_next' of the previous node.
+ */
+template<typename K, typename V>
+struct HashMapDListHook {
+	V* im_next;
+	V** im_pprev;
+	K im_key;
+	bool im_linked;
+
+	HashMapDListHook() noexcept : im_next(nullptr), im_pprev(nullptr), im_key(), im_linked(false) {}
+
+	HashMapDListHook(const HashMapDListHook&) = delete;
+	HashMapDListHook& operator=(const HashMapDListHook&) = delete;
+
+	HashMapDListHook(HashMapDListHook&&) = delete;
+	HashMapDListHook& operator=(HashMapDListHook&&) = delete;
+};
+
+/**
+ * A bucket of the separately chained layout.
+ * Nodes of the bucket are chained with im_next.
+ */
 template<typename MapData_t>
 struct HashMapBucket {
 	MapData_t* head;
@@ -33,24 +61,571 @@ struct HashMapBucket {
 
 	HashMapBucket(HashMapBucket&&) = delete;
 	HashMapBucket& operator=(HashMapBucket&&) = delete;
+
+	// the layout interface, see HashMap for more details
+
+	static inline constexpr size_t capacity(size_t) noexcept {
+		return ~size_t(0);
+	}
+
+	static inline void prefetch(const HashMapBucket* list, size_t bucket_id) noexcept {
+		__builtin_prefetch(list + bucket_id);
+	}
+
+	static inline void prefetch_node(const HashMapBucket* list, size_t, size_t bucket_id, size_t) noexcept {
+		if(list[bucket_id].head) {
+			__builtin_prefetch(list[bucket_id].head);
+		}
+	}
+
+	template<typename K>
+	static inline MapData_t* find(const HashMapBucket* list, size_t, size_t bucket_id, size_t, const K& key) noexcept {
+		MapData_t* cur = list[bucket_id].head;
+		while(cur) {
+			if(cur->im_key == key) {
+				break;
+			}
+			cur = cur->im_next;
+		}
+		return cur;
+	}
+
+	static inline bool link(HashMapBucket* list, size_t, size_t bucket_id, size_t, MapData_t& node) noexcept {
+		HashMapBucket& bucket = list[bucket_id];
+		node.im_next = bucket.head;
+		bucket.head = &node;
+		bucket.size++;
+		return true;
+	}
+
+	static inline void unlink(HashMapBucket* list, size_t, size_t bucket_id, size_t, MapData_t& node) noexcept {
+		HashMapBucket& bucket = list[bucket_id];
+		if(&node == bucket.head) {
+			bucket.head = node.im_next;
+		} else {
+			MapData_t* prev = find_prev(bucket, &node);
+			prev->im_next = node.im_next;
+		}
+		node.im_next = nullptr;
+		bucket.size--;
+	}
+
+	static inline size_t clear(HashMapBucket& bucket) noexcept {
+		size_t result = 0;
+		while(bucket.head) {
+			MapData_t* tmp_value = bucket.head;
+			bucket.head = bucket.head->im_next;
+			tmp_value->im_next = nullptr;
+			tmp_value->im_linked = false;
+			result++;
+		}
+		bucket.size = 0;
+		return result;
+	}
+
+	static inline size_t length(const HashMapBucket& bucket) noexcept {
+		return bucket.size;
+	}
+
+	template<typename F, typename S>
+	static inline void drain(HashMapBucket* list, size_t, size_t bucket_id, const F&, const S& sink) noexcept {
+		HashMapBucket& bucket = list[bucket_id];
+		MapData_t* cur = reverse(bucket.head);
+		bucket.head = nullptr;
+		bucket.size = 0;
+		while(cur) {
+			MapData_t* tmp_value = cur;
+			cur = cur->im_next;
+			tmp_value->im_next = nullptr;
+			sink(*tmp_value);
+		}
+	}
+
+private:
+
+	static inline MapData_t* reverse(MapData_t* head) noexcept {
+		MapData_t* result = nullptr;
+		while(head) {
+			MapData_t* tmp_value = head;
+			head = head->im_next;
+			tmp_value->im_next = result;
+			result = tmp_value;
+		}
+		return result;
+	}
+
+	static inline MapData_t* find_prev(const HashMapBucket& bucket, const MapData_t* node) noexcept {
+		MapData_t* cur = bucket.head;
+		MapData_t* prev = nullptr;
+		while(cur) {
+			if(cur == node) {
+				return prev;
+			}
+			prev = cur;
+			cur = cur->im_next;
+		}
+		return nullptr;
+	}
+};
+
+/**
+ * A bucket of the doubly linked layout.
+ * Nodes MUST have HashMapDListHook hooks, that makes unlinking a node constant time
+ * regardless of the chain length.
+ */
+template<typename MapData_t>
+struct HashMapDListBucket {
+	MapData_t* head;
+
+	HashMapDListBucket() noexcept : head(nullptr) {}
+
+	HashMapDListBucket(const HashMapDListBucket&) = delete;
+	HashMapDListBucket& operator=(const HashMapDListBucket&) = delete;
+
+	HashMapDListBucket(HashMapDListBucket&&) = delete;
+	HashMapDListBucket& operator=(HashMapDListBucket&&) = delete;
+
+	// the layout interface, see HashMap for more details
+
+	static inline constexpr size_t capacity(size_t) noexcept {
+		return ~size_t(0);
+	}
+
+	static inline void prefetch(const HashMapDListBucket* list, size_t bucket_id) noexcept {
+		__builtin_prefetch(list + bucket_id);
+	}
+
+	static inline void prefetch_node(const HashMapDListBucket* list, size_t, size_t bucket_id, size_t) noexcept {
+		if(list[bucket_id].head) {
+			__builtin_prefetch(list[bucket_id].head);
+		}
+	}
+
+	template<typename K>
+	static inline MapData_t* find(const HashMapDListBucket* list, size_t, size_t bucket_id, size_t, const K& key) noexcept {
+		MapData_t* cur = list[bucket_id].head;
+		while(cur) {
+			if(cur->im_key == key) {
+				break;
+			}
+			cur = cur->im_next;
+		}
+		return cur;
+	}
+
+	static inline bool link(HashMapDListBucket* list, size_t, size_t bucket_id, size_t, MapData_t& node) noexcept {
+		HashMapDListBucket& bucket = list[bucket_id];
+		node.im_next = bucket.head;
+		node.im_pprev = &bucket.head;
+		if(bucket.head) {
+			bucket.head->im_pprev = &node.im_next;
+		}
+		bucket.head = &node;
+		return true;
+	}
+
+	static inline void unlink(HashMapDListBucket*, size_t, size_t, size_t, MapData_t& node) noexcept {
+		*node.im_pprev = node.im_next;
+		if(node.im_next) {
+			node.im_next->im_pprev = node.im_pprev;
+		}
+		node.im_next = nullptr;
+		node.im_pprev = nullptr;
+	}
+
+	static inline size_t clear(HashMapDListBucket& bucket) noexcept {
+		size_t result = 0;
+		while(bucket.head) {
+			MapData_t* tmp_value = bucket.head;
+			bucket.head = bucket.head->im_next;
+			tmp_value->im_next = nullptr;
+			tmp_value->im_pprev = nullptr;
+			tmp_value->im_linked = false;
+			result++;
+		}
+		return result;
+	}
+
+	static inline size_t length(const HashMapDListBucket& bucket) noexcept {
+		size_t result = 0;
+		for(const MapData_t* cur = bucket.head; cur; cur = cur->im_next) {
+			result++;
+		}
+		return result;
+	}
+
+	template<typename F, typename S>
+	static inline void drain(HashMapDListBucket* list, size_t, size_t bucket_id, const F&, const S& sink) noexcept {
+		HashMapDListBucket& bucket = list[bucket_id];
+		MapData_t* cur = nullptr;
+		while(bucket.head) {
+			MapData_t* tmp_value = bucket.head;
+			bucket.head = bucket.head->im_next;
+			tmp_value->im_next = cur;
+			cur = tmp_value;
+		}
+		while(cur) {
+			MapData_t* tmp_value = cur;
+			cur = cur->im_next;
+			tmp_value->im_next = nullptr;
+			tmp_value->im_pprev = nullptr;
+			sink(*tmp_value);
+		}
+	}
+};
+
+/**
+ * A bucket of the open-addressing layout.
+ * The bucket takes exactly one cache line and holds up to SLOTS distinct keys
+ * as node pointers along with 8-bit hash fingerprints,
+ * so the most of hits and misses are settled by one cache line load.
+ *
+ * Nodes with the same key are chained with im_next behind the slot their key occupies.
+ * A full bucket spills new keys to the following buckets (linear probing),
+ * 'overflow' counts the keys which have been spilled over the bucket.
+ * The counter saturates at OVERFLOW_MAX, such a bucket stays overflowed until it is cleared.
+ *
+ * The layout can hold up to SLOTS * buckets distinct keys, link() fails when all the slots are taken.
+ * Use an allocator which respects the cache line alignment of the bucket (e.g. dpdk::Allocator).
+ */
+template<typename MapData_t>
+struct alignas(64) HashMapLineBucket {
+	static constexpr size_t SLOTS = 7;
+	static constexpr uint8_t OVERFLOW_MAX = 0xFF;
+
+	MapData_t* node[SLOTS];
+	uint8_t fingerprint[SLOTS];
+	uint8_t overflow;
+
+	HashMapLineBucket() noexcept : node(), fingerprint(), overflow(0) {
+		static_assert(sizeof(HashMapLineBucket) == 64, "HashMapLineBucket must take one cache line");
+	}
+
+	HashMapLineBucket(const HashMapLineBucket&) = delete;
+	HashMapLineBucket& operator=(const HashMapLineBucket&) = delete;
+
+	HashMapLineBucket(HashMapLineBucket&&) = delete;
+	HashMapLineBucket& operator=(HashMapLineBucket&&) = delete;
+
+	// the layout interface, see HashMap for more details
+
+	static inline constexpr size_t capacity(size_t list_size) noexcept {
+		return SLOTS * list_size;
+	}
+
+	static inline void prefetch(const HashMapLineBucket* list, size_t bucket_id) noexcept {
+		__builtin_prefetch(list + bucket_id);
+	}
+
+	/**
+	 * Prefetch the first node of the home bucket which fingerprint matches the hash.
+	 */
+	static inline void prefetch_node(const HashMapLineBucket* list, size_t, size_t bucket_id, size_t hash) noexcept {
+		const HashMapLineBucket& bucket = list[bucket_id];
+		const uint8_t fp = fingerprint_of(hash);
+		for(size_t i = 0; i < SLOTS && bucket.node[i]; ++i) {
+			if(bucket.fingerprint[i] == fp) {
+				__builtin_prefetch(bucket.node[i]);
+				return;
+			}
+		}
+	}
+
+	template<typename K>
+	static inline MapData_t* find(
+		const HashMapLineBucket* list
+		, size_t list_size
+		, size_t bucket_id
+		, size_t hash
+		, const K& key
+	                             ) noexcept {
+		size_t slot_bucket_id = bucket_id;
+		MapData_t* const* slot = locate(list, list_size, bucket_id, fingerprint_of(hash), key, slot_bucket_id);
+		return slot ? *slot : nullptr;
+	}
+
+	static inline bool link(HashMapLineBucket* list, size_t list_size, size_t bucket_id, size_t hash, MapData_t& node) noexcept {
+		const uint8_t fp = fingerprint_of(hash);
+		size_t slot_bucket_id = bucket_id;
+		MapData_t** slot = const_cast<MapData_t**>(locate(list, list_size, bucket_id, fp, node.im_key, slot_bucket_id));
+		if(slot) {
+			// the key is already linked, put the node in front of the chain
+			node.im_next = *slot;
+			*slot = &node;
+			return true;
+		}
+
+		size_t free_bucket_id = bucket_id;
+		size_t free_slot = SLOTS;
+		for(size_t probe = 0; probe < list_size; ++probe) {
+			free_slot = list[free_bucket_id].used();
+			if(free_slot < SLOTS) {
+				break;
+			}
+			free_bucket_id = next(free_bucket_id, list_size);
+		}
+		if(free_slot == SLOTS) {
+			return false;
+		}
+
+		for(size_t id = bucket_id; id != free_bucket_id; id = next(id, list_size)) {
+			if(list[id].overflow < OVERFLOW_MAX) {
+				list[id].overflow++;
+			}
+		}
+		HashMapLineBucket& bucket = list[free_bucket_id];
+		node.im_next = nullptr;
+		bucket.node[free_slot] = &node;
+		bucket.fingerprint[free_slot] = fp;
+		return true;
+	}
+
+	static inline void unlink(HashMapLineBucket* list, size_t list_size, size_t bucket_id, size_t hash, MapData_t& node) noexcept {
+		size_t slot_bucket_id = bucket_id;
+		MapData_t** slot = const_cast<MapData_t**>(
+			locate(list, list_size, bucket_id, fingerprint_of(hash), node.im_key, slot_bucket_id));
+		if(*slot != &node) {
+			MapData_t* prev = *slot;
+			while(prev->im_next != &node) {
+				prev = prev->im_next;
+			}
+			prev->im_next = node.im_next;
+		} else if(node.im_next) {
+			*slot = node.im_next;
+		} else {
+			release(list, list_size, bucket_id, slot_bucket_id, slot - list[slot_bucket_id].node);
+		}
+		node.im_next = nullptr;
+	}
+
+	static inline size_t clear(HashMapLineBucket& bucket) noexcept {
+		size_t result = 0;
+		for(size_t i = 0; i < SLOTS; ++i) {
+			while(bucket.node[i]) {
+				MapData_t* tmp_value = bucket.node[i];
+				bucket.node[i] = tmp_value->im_next;
+				tmp_value->im_next = nullptr;
+				tmp_value->im_linked = false;
+				result++;
+			}
+			bucket.fingerprint[i] = 0;
+		}
+		bucket.overflow = 0;
+		return result;
+	}
+
+	/**
+	 * @return amount of the nodes in the slots of the bucket, the spilled keys of the other buckets are counted.
+	 */
+	static inline size_t length(const HashMapLineBucket& bucket) noexcept {
+		size_t result = 0;
+		for(size_t i = 0; i < SLOTS && bucket.node[i]; ++i) {
+			for(const MapData_t* cur = bucket.node[i]; cur; cur = cur->im_next) {
+				result++;
+			}
+		}
+		return result;
+	}
+
+	/**
+	 * Unlink all the keys which have 'bucket_id' as their home bucket and pass their nodes to 'sink'.
+	 * The keys are looked for along the probing run which starts with the home bucket.
+	 * @param home_of - returns the home bucket of a node.
+	 * @param sink - takes the unlinked nodes.
+	 */
+	template<typename F, typename S>
+	static inline void drain(HashMapLineBucket* list, size_t list_size, size_t bucket_id, const F& home_of, const S& sink) noexcept {
+		size_t id = bucket_id;
+		for(size_t probe = 0; probe < list_size; ++probe) {
+			HashMapLineBucket& bucket = list[id];
+			size_t i = 0;
+			while(i < SLOTS && bucket.node[i]) {
+				if(home_of(*bucket.node[i]) != bucket_id) {
+					i++;
+					continue;
+				}
+				// the taken slot is replaced with the last one, so 'i' stays
+				MapData_t* cur = nullptr;
+				while(bucket.node[i]) {
+					MapData_t* tmp_value = bucket.node[i];
+					bucket.node[i] = tmp_value->im_next;
+					tmp_value->im_next = cur;
+					cur = tmp_value;
+				}
+				release(list, list_size, bucket_id, id, i);
+				while(cur) {
+					MapData_t* tmp_value = cur;
+					cur = cur->im_next;
+					tmp_value->im_next = nullptr;
+					sink(*tmp_value);
+				}
+			}
+			if(bucket.overflow == 0) {
+				break;
+			}
+			id = next(id, list_size);
+		}
+	}
+
+private:
+
+	/**
+	 * Release an empty slot, keep the slots packed and fix the overflow counters of the probing run.
+	 */
+	static inline void release(HashMapLineBucket* list, size_t list_size, size_t home_id, size_t slot_bucket_id, size_t index) noexcept {
+		HashMapLineBucket& bucket = list[slot_bucket_id];
+		size_t last = index;
+		while(last + 1 < SLOTS && bucket.node[last + 1]) {
+			last++;
+		}
+		bucket.node[index] = bucket.node[last];
+		bucket.fingerprint[index] = bucket.fingerprint[last];
+		bucket.node[last] = nullptr;
+		bucket.fingerprint[last] = 0;
+		for(size_t id = home_id; id != slot_bucket_id; id = next(id, list_size)) {
+			if(list[id].overflow < OVERFLOW_MAX) {
+				list[id].overflow--;
+			}
+		}
+	}
+
+	/**
+	 * @return amount of the taken slots, they are always packed at the beginning of the bucket.
+	 */
+	inline size_t used() const noexcept {
+		size_t result = 0;
+		while(result < SLOTS && node[result]) {
+			result++;
+		}
+		return result;
+	}
+
+	static inline uint8_t fingerprint_of(size_t hash) noexcept {
+		return uint8_t(hash >> ((sizeof(size_t) - 1) << 3));
+	}
+
+	static inline size_t next(size_t bucket_id, size_t list_size) noexcept {
+		bucket_id++;
+		return bucket_id < list_size ? bucket_id : 0;
+	}
+
+	template<typename K>
+	static inline MapData_t* const* locate(
+		const HashMapLineBucket* list
+		, size_t list_size
+		, size_t bucket_id
+		, uint8_t fp
+		, const K& key
+		, size_t& slot_bucket_id
+	                                      ) noexcept {
+		for(size_t probe = 0; probe < list_size; ++probe) {
+			const HashMapLineBucket& bucket = list[bucket_id];
+			for(size_t i = 0; i < SLOTS && bucket.node[i]; ++i) {
+				if(bucket.fingerprint[i] == fp && bucket.node[i]->im_key == key) {
+					slot_bucket_id = bucket_id;
+					return bucket.node + i;
+				}
+			}
+			if(bucket.overflow == 0) {
+				break;
+			}
+			bucket_id = next(bucket_id, list_size);
+		}
+		return nullptr;
+	}
+};
+
+/**
+ * A bucket list sizing mode.
+ * EXACT - use the requested amount of buckets and index them with a modulo.
+ * POW2 - round the amount of buckets up to a power of two and index them with a mask.
+ */
+enum class HashMapSizing : uint8_t {
+	EXACT,
+	POW2
+};
+
+/**
+ * A hash finalizer on top of hasher 'H'.
+ * Spreads weak hashes (e.g. the identity std::hash of integers) over all the bits of size_t,
+ * so the low bits are good enough for a mask indexing and the high bits for fingerprints.
+ * Based on the 64-bit MurmurHash3 finalizer.
+ */
+template<typename K, typename H = std::hash<K> >
+struct HashMix {
+	H hasher;
+
+	inline size_t operator()(const K& key) const noexcept {
+		return size_t(mix(uint64_t(hasher(key))));
+	}
+
+	static inline constexpr uint64_t mix(uint64_t h) noexcept {
+		return fold(fold(fold(h, 33) * 0xff51afd7ed558ccdull, 33) * 0xc4ceb9fe1a85ec53ull, 33);
+	}
+
+private:
+	static inline constexpr uint64_t fold(uint64_t h, unsigned shift) noexcept {
+		return h ^ (h >> shift);
+	}
+};
+
+/**
+ * The hot path counters of a map, they are updated while the map has them attached by set_metrics()
+ * and METRICS_ENABLED is defined (see utils/Metrics.h).
+ * The metrics live apart from the map, so several maps (e.g. shards) may share them.
+ */
+struct HashMapMetrics {
+	utils::Counter lookups; // find(), find_bulk() and find_or_link()
+	utils::Counter hits;
+	utils::Counter failed; // link() and find_or_link() which the bucket layout couldn't hold
+
+	void write(utils::MetricsWriter& writer) const noexcept {
+		writer.counter("map_lookups", lookups);
+		writer.counter("map_hits", hits);
+		writer.counter("map_failed", failed);
+	}
 };
 
 /**
  * An unordered hash map implemented in an intrusive way.
  * Can hold many items for one key.
+ *
+ * The bucket layout is selected with the value type of the bucket allocator 'A':
+ * - HashMapBucket - separately chained buckets, the default one;
+ * - HashMapDListBucket - doubly linked chains with O(1) remove(), requires HashMapDListHook nodes;
+ * - HashMapLineBucket - open-addressing cache line buckets with key fingerprints.
+ * In the open-addressing layout the iterators walk through the nodes of the same key only.
+ *
+ * The map can be resized without a pause: resize() allocates a new bucket list
+ * and every following link(), remove() and find() moves up to migrate_budget() buckets
+ * of the old list to the new one. Both lists live until the migration is over.
+ * A key stays in the old list until its old bucket has been migrated,
+ * so all the nodes of a key are always linked in the same list.
  */
 
 template<typename K, typename MapNode, typename H = std::hash<K>, typename A = std::allocator<HashMapBucket<MapNode> > >
 class HashMap {
 public:
-	using Bucket_t = HashMapBucket<MapNode>;
+	using Bucket_t = typename A::value_type;
 
 private:
+	static constexpr size_t NO_MASK = ~size_t(0);
+
+	static constexpr size_t DEFAULT_MIGRATE_BUDGET = 2;
+	static constexpr size_t BULK_MAX = 32; // amount of keys find_bulk() keeps in flight
+
 	Bucket_t* bucket_list;
 	size_t bucket_list_size;
+	size_t bucket_mask; // bucket_list_size - 1 for a power of two list size, NO_MASK otherwise
+	Bucket_t* old_list; // the list which is being migrated, nullptr if there is no migration
+	size_t old_list_size;
+	size_t old_mask;
+	size_t migrate_cursor; // the old buckets before the cursor have been migrated
+	size_t migrate_step; // amount of the old buckets migrated per operation
 	size_t elements;
 	H hasher;
 	A allocator;
+	HashMapMetrics* metrics_sink;
 
 	template<typename N>
 	struct Iterator {
@@ -130,8 +705,20 @@ public:
 	using Iterator_t = Iterator<MapNode>;
 	using ConstIterator_t = Iterator<const MapNode>;
 
+	/**
+	 * @param bucket_list_size - amount of buckets, a power of two size enables the mask indexing.
+	 */
 	HashMap(size_t bucket_list_size) noexcept :
-		bucket_list(nullptr), bucket_list_size(bucket_list_size), elements(0), hasher(), allocator() {}
+		bucket_list(nullptr), bucket_list_size(bucket_list_size), bucket_mask(mask_of(bucket_list_size))
+		, old_list(nullptr), old_list_size(0), old_mask(NO_MASK), migrate_cursor(0), migrate_step(DEFAULT_MIGRATE_BUDGET)
+		, elements(0), hasher(), allocator(), metrics_sink(nullptr) {}
+
+	/**
+	 * @param bucket_list_size - requested amount of buckets.
+	 * @param sizing - sizing mode.
+	 */
+	HashMap(size_t bucket_list_size, HashMapSizing sizing) noexcept :
+		HashMap(bucket_count(bucket_list_size, sizing)) {}
 
 	HashMap(const HashMap&) = delete;
 	HashMap& operator=(const HashMap&) = delete;
@@ -139,11 +726,17 @@ public:
 	HashMap(HashMap&& rv) noexcept :
 		bucket_list(rv.bucket_list)
 		, bucket_list_size(rv.bucket_list_size)
+		, bucket_mask(rv.bucket_mask)
+		, old_list(rv.old_list)
+		, old_list_size(rv.old_list_size)
+		, old_mask(rv.old_mask)
+		, migrate_cursor(rv.migrate_cursor)
+		, migrate_step(rv.migrate_step)
 		, elements(rv.elements)
 		, hasher(rv.hasher)
-		, allocator(rv.allocator) {
-		rv.bucket_list = nullptr;
-		rv.destroy();
+		, allocator(rv.allocator)
+		, metrics_sink(rv.metrics_sink) {
+		rv.clean_state();
 	}
 
 	HashMap& operator=(HashMap&& rv) noexcept {
@@ -151,9 +744,16 @@ public:
 			destroy();
 			bucket_list = rv.bucket_list;
 			bucket_list_size = rv.bucket_list_size;
+			bucket_mask = rv.bucket_mask;
+			old_list = rv.old_list;
+			old_list_size = rv.old_list_size;
+			old_mask = rv.old_mask;
+			migrate_cursor = rv.migrate_cursor;
+			migrate_step = rv.migrate_step;
 			elements = rv.elements;
 			allocator = rv.allocator;
 			hasher = rv.hasher;
+			metrics_sink = rv.metrics_sink;
 			rv.clean_state();
 		}
 		return *this;
@@ -175,22 +775,126 @@ public:
 		if(bucket_list)
 			return false;
 
-		bucket_list = allocator.allocate(bucket_list_size);
-		if(bucket_list) {
-			for(size_t i = 0; i < bucket_list_size; i++) {
-				allocator.construct(bucket_list + i);
-			}
-		}
+		bucket_list = allocate_list(bucket_list_size);
 		return bucket_list != nullptr;
 	}
 
+	/**
+	 * Start moving the nodes to a new bucket list.
+	 * The migration goes on with the following operations or with migrate().
+	 * The map must be allocated and must not be migrating.
+	 * @param new_size - amount of buckets of the new list, a power of two size enables the mask indexing.
+	 * @return true - if the new bucket list has been allocated.
+	 */
+	bool resize(size_t new_size) noexcept {
+		if(not bucket_list || old_list || not new_size || Bucket_t::capacity(new_size) < elements)
+			return false;
+
+		Bucket_t* new_list = allocate_list(new_size);
+		if(not new_list)
+			return false;
+
+		old_list = bucket_list;
+		old_list_size = bucket_list_size;
+		old_mask = bucket_mask;
+		migrate_cursor = 0;
+		bucket_list = new_list;
+		bucket_list_size = new_size;
+		bucket_mask = mask_of(new_size);
+		if(not elements) {
+			finish_migration();
+		}
+		return true;
+	}
+
+	/**
+	 * @param new_size - requested amount of buckets of the new list.
+	 * @param sizing - sizing mode.
+	 * @return true - if the new bucket list has been allocated.
+	 */
+	bool resize(size_t new_size, HashMapSizing sizing) noexcept {
+		return resize(bucket_count(new_size, sizing));
+	}
+
+	/**
+	 * Migrate up to 'buckets' buckets of the old list.
+	 * @param buckets - amount of the old buckets to migrate.
+	 * @return amount of the migrated buckets.
+	 */
+	size_t migrate(size_t buckets) noexcept {
+		size_t result = 0;
+		if(not old_list)
+			return result;
+
+		const auto home_of = [this](const MapNode& node) noexcept {
+			return index_of(hasher(node.im_key), old_list_size, old_mask);
+		};
+		const auto sink = [this](MapNode& node) noexcept {
+			const size_t hash = hasher(node.im_key);
+			const bool linked = Bucket_t::link(bucket_list, bucket_list_size, index(hash), hash, node);
+			assert(linked); // resize() and link() keep enough room in the new list
+			(void) linked;
+		};
+		while(result < buckets && migrate_cursor < old_list_size) {
+			Bucket_t::drain(old_list, old_list_size, migrate_cursor, home_of, sink);
+			migrate_cursor++;
+			result++;
+		}
+		if(migrate_cursor == old_list_size) {
+			finish_migration();
+		}
+		return result;
+	}
+
+	/**
+	 * @return true - if the map is migrating to a new bucket list.
+	 */
+	inline bool migrating() const noexcept {
+		return old_list;
+	}
+
+	/**
+	 * @return amount of the migrated buckets of the old list.
+	 */
+	inline size_t migrated() const noexcept {
+		return migrate_cursor;
+	}
+
+	/**
+	 * @return amount of buckets of the old list, 0 if there is no migration.
+	 */
+	inline size_t migrating_buckets() const noexcept {
+		return old_list_size;
+	}
+
+	/**
+	 * @return amount of the old buckets migrated by each link(), remove() and find().
+	 */
+	inline size_t migrate_budget() const noexcept {
+		return migrate_step;
+	}
+
+	/**
+	 * @param budget - amount of the old buckets migrated by each link(), remove() and find(),
+	 * 0 leaves the migration to migrate().
+	 */
+	inline void set_migrate_budget(size_t budget) noexcept {
+		migrate_step = budget;
+	}
+
 	/**
 	 * Unlink all the objects the map contains.
+	 * A migration in progress is over.
 	 */
 	void clear() noexcept {
 		for(size_t i = 0; i < bucket_list_size; i++) {
-			while(bucket_list[i].head)
-				unlink_front(i);
+			elements -= Bucket_t::clear(bucket_list[i]);
+		}
+		if(old_list) {
+			for(size_t i = 0; i < old_list_size; i++) {
+				elements -= Bucket_t::clear(old_list[i]);
+			}
+			finish_migration();
 		}
 	}
 
@@ -199,23 +903,77 @@ public:
 	 * The node must not be linked.
 	 * @param key
 	 * @param node
-	 * @return 
+	 * @return an iterator to the node or end() if the bucket layout cannot hold one more key.
 	 */
 	Iterator_t link(const K& key, MapNode& node) noexcept {
 		check_free(node); // TODO: debug
-		size_t bucket_id = hasher(key) % bucket_list_size;
-		link_front(bucket_id, key, node);
+		step();
+		if(old_list && Bucket_t::capacity(bucket_list_size) <= elements) {
+			count_failed();
+			return Iterator_t();
+		}
+		const size_t hash = hasher(key);
+		node.im_key = key;
+		size_t list_size;
+		size_t bucket_id;
+		Bucket_t* list = locate(hash, list_size, bucket_id);
+		if(not Bucket_t::link(list, list_size, bucket_id, hash, node)) {
+			count_failed();
+			return Iterator_t();
+		}
+		node.im_linked = true;
+		elements++;
 		return Iterator_t(&node);
 	}
 
+	/**
+	 * Find the first node which is linked to the key or link the key with 'node' if there is none.
+	 * The key is hashed and its bucket is located once.
+	 * @param key
+	 * @param node - a free node, nullptr makes it a plain find().
+	 * @return an iterator to the found node, to 'node' if it has been linked,
+	 * or end() if there is no node to link or the bucket layout cannot hold one more key.
+	 */
+	Iterator_t find_or_link(const K& key, MapNode* node) noexcept {
+		step();
+		const size_t hash = hasher(key);
+		size_t list_size;
+		size_t bucket_id;
+		Bucket_t* list = locate(hash, list_size, bucket_id);
+		MapNode* found = Bucket_t::find(list, list_size, bucket_id, hash, key);
+		count_lookup(found);
+		if(found || node == nullptr) {
+			return Iterator_t(found);
+		}
+
+		check_free(*node); // TODO: debug
+		if(old_list && Bucket_t::capacity(bucket_list_size) <= elements) {
+			count_failed();
+			return Iterator_t();
+		}
+		node->im_key = key;
+		if(not Bucket_t::link(list, list_size, bucket_id, hash, *node)) {
+			count_failed();
+			return Iterator_t();
+		}
+		node->im_linked = true;
+		elements++;
+		return Iterator_t(node);
+	}
+
 	/**
 	 * Find the first node which is linked to the key.
 	 * @param key
 	 * @return 
 	 */
 	ConstIterator_t find(const K& key) const noexcept {
-		size_t bucket_id = hasher(key) % bucket_list_size;
-		return ConstIterator_t(find(bucket_id, key));
+		const size_t hash = hasher(key);
+		size_t list_size;
+		size_t bucket_id;
+		const Bucket_t* list = locate(hash, list_size, bucket_id);
+		const MapNode* found = Bucket_t::find(list, list_size, bucket_id, hash, key);
+		count_lookup(found);
+		return ConstIterator_t(found);
 	}
 
 	/**
@@ -224,8 +982,34 @@ public:
 	 * @return 
 	 */
 	Iterator_t find(const K& key) noexcept {
-		size_t bucket_id = hasher(key) % bucket_list_size;
-		return Iterator_t(find(bucket_id, key));
+		step();
+		const size_t hash = hasher(key);
+		size_t list_size;
+		size_t bucket_id;
+		Bucket_t* list = locate(hash, list_size, bucket_id);
+		MapNode* found = Bucket_t::find(list, list_size, bucket_id, hash, key);
+		count_lookup(found);
+		return Iterator_t(found);
+	}
+
+	/**
+	 * Find the first nodes which are linked to the keys.
+	 * The keys are hashed first, then all their buckets and first nodes are prefetched
+	 * and only then the keys are compared, so the cache misses of a burst overlap.
+	 * @param keys - the keys to look for.
+	 * @param n - amount of the keys.
+	 * @param out - n iterators, end() for the missed keys.
+	 */
+	void find_bulk(const K* keys, size_t n, ConstIterator_t* out) const noexcept {
+		find_bulk_to(keys, n, out);
+	}
+
+	/**
+	 * See the const version.
+	 */
+	void find_bulk(const K* keys, size_t n, Iterator_t* out) noexcept {
+		step();
+		find_bulk_to(keys, n, out);
 	}
 
 	/**
@@ -236,13 +1020,14 @@ public:
 	 */
 	void remove(MapNode& node) noexcept {
 		check_linked(node); // TODO: debug
-		size_t bucket_id = hasher(node.im_key) % bucket_list_size;
-		if(&node == bucket_list[bucket_id].head) {
-			unlink_front(bucket_id);
-		} else {
-			MapNode* prev = find_prev(bucket_id, &node);
-			unlink_next(bucket_id, *prev);
-		}
+		step();
+		const size_t hash = hasher(node.im_key);
+		size_t list_size;
+		size_t bucket_id;
+		Bucket_t* list = locate(hash, list_size, bucket_id);
+		Bucket_t::unlink(list, list_size, bucket_id, hash, node);
+		node.im_linked = false;
+		elements--;
 	}
 
 	/**
@@ -269,6 +1054,54 @@ public:
 		return bucket_list_size;
 	}
 
+	/**
+	 * Attach the hot path counters, nullptr detaches them.
+	 * They are not updated at all without METRICS_ENABLED.
+	 */
+	inline void set_metrics(HashMapMetrics* metrics) noexcept {
+		metrics_sink = metrics;
+	}
+
+	inline HashMapMetrics* metrics() const noexcept {
+		return metrics_sink;
+	}
+
+	/**
+	 * Add the amount of nodes of every bucket to the histogram, the buckets of a migration are walked both.
+	 * It walks the whole map, so it is for a periodic report rather than for the hot path.
+	 */
+	void chains(utils::Log2Histogram& histogram) const noexcept {
+		for(size_t i = 0; i < bucket_list_size && bucket_list; i++) {
+			histogram.add(Bucket_t::length(bucket_list[i]));
+		}
+		for(size_t i = migrate_cursor; i < old_list_size; i++) {
+			histogram.add(Bucket_t::length(old_list[i]));
+		}
+	}
+
+	/**
+	 * @return true - if the buckets are indexed with a mask.
+	 */
+	inline bool masked() const noexcept {
+		return bucket_mask != NO_MASK;
+	}
+
+	/**
+	 * @param wanted - requested amount of buckets.
+	 * @param sizing - sizing mode.
+	 * @return amount of buckets the map should be constructed with.
+	 */
+	static inline size_t bucket_count(size_t wanted, HashMapSizing sizing) noexcept {
+		size_t result = wanted ? wanted : 1;
+		if(sizing == HashMapSizing::POW2 && mask_of(result) == NO_MASK) {
+			result = 1;
+			while(result < wanted) {
+				result <<= 1;
+			}
+		}
+		return result;
+	}
+
 	inline Iterator_t begin(size_t bucket) noexcept {
 		return Iterator_t(bucket_list[bucket].head, bucket);
 	}
@@ -290,89 +1123,125 @@ private:
 	void destroy() noexcept {
 		if(bucket_list) {
 			clear();
-			for(size_t i = 0; i < bucket_list_size; i++) {
-				allocator.destroy(bucket_list + i);
-			}
-			allocator.deallocate(bucket_list, bucket_list_size);
+			deallocate_list(bucket_list, bucket_list_size);
 		}
 		clean_state();
 	}
 
-	inline static void check_free(const MapNode& node) noexcept {
-		assert(not node.im_linked);
+	Bucket_t* allocate_list(size_t list_size) noexcept {
+		Bucket_t* list = allocator.allocate(list_size);
+		if(list) {
+			for(size_t i = 0; i < list_size; i++) {
+				allocator.construct(list + i);
+			}
+		}
+		return list;
 	}
 
-	inline static void check_linked(const MapNode& node) noexcept {
-		assert(node.im_linked);
+	void deallocate_list(Bucket_t* list, size_t list_size) noexcept {
+		for(size_t i = 0; i < list_size; i++) {
+			allocator.destroy(list + i);
+		}
+		allocator.deallocate(list, list_size);
 	}
 
-	inline void link_front(size_t bucket_id, const K& key, MapNode& node) noexcept {
-		Bucket_t& bucket = bucket_list[bucket_id];
-		node.im_next = bucket.head;
-		node.im_linked = true;
-		node.im_key = key;
-		bucket.head = &node;
-		bucket.size++;
-		elements++;
+	void finish_migration() noexcept {
+		deallocate_list(old_list, old_list_size);
+		old_list = nullptr;
+		old_list_size = 0;
+		old_mask = NO_MASK;
+		migrate_cursor = 0;
 	}
 
-	inline void unlink_front(size_t bucket_id) noexcept {
-		Bucket_t& bucket = bucket_list[bucket_id];
-		MapNode* tmp_value = bucket.head;
-		bucket.head = bucket.head->im_next;
-		tmp_value->im_next = nullptr;
-		tmp_value->im_linked = false;
-		bucket.size--;
-		elements--;
+	inline void step() noexcept {
+		if(old_list) {
+			migrate(migrate_step);
+		}
 	}
 
-	inline void unlink_next(size_t bucket_id, MapNode& node) noexcept {
-		Bucket_t& bucket = bucket_list[bucket_id];
-		MapNode* tmp_value = node.im_next;
-		node.im_next = node.im_next->im_next;
-		tmp_value->im_next = nullptr;
-		tmp_value->im_linked = false;
-		bucket.size--;
-		elements--;
+	template<typename It>
+	void find_bulk_to(const K* keys, size_t n, It* out) const noexcept {
+		size_t hash[BULK_MAX];
+		size_t list_size[BULK_MAX];
+		size_t bucket_id[BULK_MAX];
+		const Bucket_t* list[BULK_MAX];
+		for(size_t first = 0; first < n; first += BULK_MAX) {
+			const size_t count = (n - first) < BULK_MAX ? (n - first) : BULK_MAX;
+			for(size_t i = 0; i < count; i++) {
+				hash[i] = hasher(keys[first + i]);
+				list[i] = locate(hash[i], list_size[i], bucket_id[i]);
+				Bucket_t::prefetch(list[i], bucket_id[i]);
+			}
+			for(size_t i = 0; i < count; i++) {
+				Bucket_t::prefetch_node(list[i], list_size[i], bucket_id[i], hash[i]);
+			}
+			for(size_t i = 0; i < count; i++) {
+				out[first + i] = It(Bucket_t::find(list[i], list_size[i], bucket_id[i], hash[i], keys[first + i]));
+				count_lookup(out[first + i]);
+			}
+		}
 	}
 
-	inline MapNode* find(size_t bucket_id, const K& key) noexcept {
-		MapNode* cur = bucket_list[bucket_id].head;
-		while(cur) {
-			if(cur->im_key == key)
-				break;
-			cur = cur->im_next;
+	/**
+	 * @return the bucket list where the key with 'hash' lives.
+	 */
+	inline Bucket_t* locate(size_t hash, size_t& list_size, size_t& bucket_id) const noexcept {
+		if(old_list) {
+			const size_t old_id = index_of(hash, old_list_size, old_mask);
+			if(old_id >= migrate_cursor) {
+				list_size = old_list_size;
+				bucket_id = old_id;
+				return old_list;
+			}
 		}
-		return cur;
+		list_size = bucket_list_size;
+		bucket_id = index(hash);
+		return bucket_list;
 	}
 
-	inline const MapNode* find(size_t bucket_id, const K& key) const noexcept {
-		MapNode* cur = bucket_list[bucket_id].head;
-		while(cur) {
-			if(cur->im_key == key) {
-				break;
+	inline void count_lookup(bool hit) const noexcept {
+		if(utils::Metrics::ENABLED && metrics_sink) {
+			metrics_sink->lookups.add();
+			if(hit) {
+				metrics_sink->hits.add();
 			}
-			cur = cur->im_next;
 		}
-		return cur;
 	}
 
-	inline MapNode* find_prev(size_t bucket_id, const MapNode* node) const noexcept {
-		MapNode* cur = bucket_list[bucket_id].head;
-		MapNode* prev = nullptr;
-		while(cur) {
-			if(cur == node) {
-				return prev;
-			}
-			prev = cur;
-			cur = cur->im_next;
+	inline void count_failed() const noexcept {
+		if(utils::Metrics::ENABLED && metrics_sink) {
+			metrics_sink->failed.add();
 		}
-		return nullptr;
+	}
+
+	inline static void check_free(const MapNode& node) noexcept {
+		assert(not node.im_linked);
+	}
+
+	inline static void check_linked(const MapNode& node) noexcept {
+		assert(node.im_linked);
+	}
+
+	inline size_t index(size_t hash) const noexcept {
+		return index_of(hash, bucket_list_size, bucket_mask);
+	}
+
+	static inline size_t index_of(size_t hash, size_t list_size, size_t mask) noexcept {
+		return mask != NO_MASK ? (hash & mask) : (hash % list_size);
+	}
+
+	static inline constexpr size_t mask_of(size_t size) noexcept {
+		return (size && (size & (size - 1)) == 0) ? size - 1 : NO_MASK;
 	}
 
 	inline void clean_state() noexcept {
 		bucket_list = nullptr;
 		bucket_list_size = 0;
+		bucket_mask = NO_MASK;
+		old_list = nullptr;
+		old_list_size = 0;
+		old_mask = NO_MASK;
+		migrate_cursor = 0;
 		elements = 0;
 	}
 
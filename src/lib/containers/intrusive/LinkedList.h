@@ -19,6 +19,10 @@ struct LinkedListHook {
 
 	LinkedListHook(LinkedListHook&&) = delete;
 	LinkedListHook& operator=(LinkedListHook&&) = delete;
+
+	inline bool linked() const noexcept {
+		return il_linked;
+	}
 };
 
 template<typename ListNode>
@@ -247,6 +251,36 @@ public:
 		}
 	}
 
+	/**
+	 * Move the 'n' nodes from 'first' to 'last' of the list 'from' to the back of this list,
+	 * only the ends of the range are relinked and the sizes are updated once.
+	 * The range must be linked in 'from' in this order (a range of a single node has first == last).
+	 */
+	void splice_back(LinkedList& from, ListNode& first, ListNode& last, size_t n) noexcept {
+		check_linked(first); // TODO: debug
+		check_linked(last); // TODO: debug
+		ListNode* prev = first.il_prev;
+		ListNode* next = last.il_next;
+		if(prev)
+			prev->il_next = next;
+		else
+			from.m_head = next;
+		if(next)
+			next->il_prev = prev;
+		else
+			from.m_tail = prev;
+		from.m_size -= n;
+
+		first.il_prev = m_tail;
+		last.il_next = nullptr;
+		if(m_tail)
+			m_tail->il_next = &first;
+		else
+			m_head = &first;
+		m_tail = &last;
+		m_size += n;
+	}
+
 	/**
 	 * Unlink all objects in the list.
 	 */
@@ -0,0 +1,211 @@
+#ifndef INTRUSIVE_TESTS_TESTCONCURRENTHASHMAP_H
+#define INTRUSIVE_TESTS_TESTCONCURRENTHASHMAP_H
+
+#include "containers/intrusive/ConcurrentHashMap.h"
+#include "containers/storage/Snapshot.h"
+
+#include <assert.h>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+namespace intrusive {
+
+class TestConcurrentHashMap {
+
+	using Key_t = unsigned;
+
+	struct MapNode : public ConcurrentHashMapHook<Key_t, MapNode> {
+		unsigned value;
+
+		MapNode() noexcept : value(0) {}
+	};
+
+	using Map_t = ConcurrentHashMap<Key_t, MapNode>;
+
+	const size_t m_capacity;
+	std::vector<MapNode> m_nodes;
+
+public:
+
+	TestConcurrentHashMap(unsigned capacity) noexcept
+		: m_capacity(capacity), m_nodes(capacity) {}
+
+	TestConcurrentHashMap(const TestConcurrentHashMap&) = delete;
+	TestConcurrentHashMap(TestConcurrentHashMap&&) = delete;
+
+	TestConcurrentHashMap operator=(const TestConcurrentHashMap&) = delete;
+	TestConcurrentHashMap operator=(TestConcurrentHashMap&&) = delete;
+
+	~TestConcurrentHashMap() {}
+
+	void test() noexcept {
+		printf("<TestConcurrentHashMap>...\n");
+		printf("capacity=%zu\n", m_capacity);
+		printf("sizeof(MapNode)=%zu\n", sizeof(MapNode));
+		printf("sizeof(Bucket_t)=%zu\n", sizeof(Map_t::Bucket_t));
+
+		unsigned step = 1;
+		test_link_remove(m_capacity, step++);
+		test_link_remove(1, step++);
+		test_find_or_link_race(step++);
+		test_readers_writers(step++);
+	}
+
+private:
+
+	/**
+	 * One thread: the chains of the forward, backward and odd/even removals and the same key nodes.
+	 */
+	void test_link_remove(size_t buckets, unsigned step) noexcept {
+		printf("-> test_link_remove(buckets=%zu, step=%u)\n", buckets, step);
+		Map_t map(buckets);
+		assert(map.allocate());
+		assert(not map.allocate());
+
+		for(size_t i = 0; i < m_capacity; i++) {
+			assert(map.find(Key_t(i)) == nullptr);
+			assert(map.link(Key_t(i), m_nodes[i]) == &m_nodes[i]);
+		}
+		assert(map.size() == m_capacity);
+		for(size_t i = 0; i < m_capacity; i += 2) {
+			assert(map.find(Key_t(i)) == &m_nodes[i]);
+			map.remove(m_nodes[i]);
+		}
+		for(size_t i = 0; i < m_capacity; i++) {
+			assert(map.find(Key_t(i)) == (i % 2 ? &m_nodes[i] : nullptr));
+		}
+		for(size_t i = m_capacity; i > 0; i--) {
+			if((i - 1) % 2) {
+				map.remove(m_nodes[i - 1]);
+			}
+		}
+		assert(map.size() == 0);
+
+		// the same key: the newest node first, find_next() walks the older ones
+		const size_t same = m_capacity < 8 ? m_capacity : 8;
+		for(size_t i = 0; i < same; i++) {
+			map.link(7, m_nodes[i]);
+		}
+		assert(map.find_or_link(7, nullptr) == &m_nodes[same - 1]);
+		size_t seen = 0;
+		for(MapNode* node = map.find(7); node; node = map.find_next(*node)) {
+			assert(node == &m_nodes[same - 1 - seen]);
+			seen++;
+		}
+		assert(seen == same);
+		map.remove(m_nodes[same / 2]);
+		map.clear();
+		assert(map.size() == 0 && map.find(7) == nullptr);
+		for(size_t i = 0; i < m_capacity; i++) {
+			assert(not m_nodes[i].im_linked);
+		}
+	}
+
+	/**
+	 * The threads link the same keys with their own nodes, every key is linked once.
+	 */
+	void test_find_or_link_race(unsigned step) noexcept {
+		printf("-> test_find_or_link_race(step=%u)\n", step);
+		const unsigned threads = 4;
+		const size_t keys = m_capacity / threads;
+		Map_t map(keys / 4);
+		assert(map.allocate());
+
+		std::vector<std::thread> workers;
+		std::vector<size_t> linked(threads, 0);
+		for(unsigned t = 0; t < threads; t++) {
+			workers.emplace_back([&, t]() {
+				for(size_t i = 0; i < keys; i++) {
+					MapNode* node = &m_nodes[t * keys + i];
+					MapNode* found = map.find_or_link(Key_t(i), node);
+					assert(found && found->im_key == Key_t(i));
+					linked[t] += found == node;
+				}
+			});
+		}
+		for(std::thread& worker : workers) {
+			worker.join();
+		}
+		size_t total = 0;
+		for(size_t count : linked) {
+			total += count;
+		}
+		assert(total == keys);
+		assert(map.size() == keys);
+		for(size_t i = 0; i < keys; i++) {
+			MapNode* node = map.find(Key_t(i));
+			assert(node && map.find_next(*node) == nullptr);
+		}
+		map.clear();
+	}
+
+	/**
+	 * The readers always find the stable keys while the writers unlink and relink their neighbours,
+	 * the unlinked nodes are linked again after a grace period.
+	 */
+	void test_readers_writers(unsigned step) noexcept {
+		printf("-> test_readers_writers(step=%u)\n", step);
+		const unsigned readers = 3;
+		const unsigned writers = 2;
+		const size_t stable = m_capacity / 2;
+		const size_t per_writer = (m_capacity - stable) / writers;
+		const unsigned rounds = 200;
+		Map_t map(stable / 8); // the long chains mix the stable and the moving nodes
+		assert(map.allocate());
+		storage::Qsbr<8> qsbr;
+
+		for(size_t i = 0; i < stable; i++) {
+			m_nodes[i].value = unsigned(i);
+			map.link(Key_t(i), m_nodes[i]);
+		}
+		for(size_t i = stable; i < stable + per_writer * writers; i++) {
+			map.link(Key_t(i), m_nodes[i]);
+		}
+
+		std::atomic<unsigned> running(writers);
+		std::vector<std::thread> workers;
+		for(unsigned r = 0; r < readers; r++) {
+			workers.emplace_back([&, r]() {
+				qsbr.online(r);
+				while(running.load(std::memory_order_acquire)) {
+					for(size_t i = 0; i < stable; i++) {
+						const MapNode* node = map.find(Key_t(i));
+						assert(node && node->value == i);
+						(void) node;
+					}
+					qsbr.quiescent(r);
+				}
+				qsbr.offline(r);
+			});
+		}
+		for(unsigned w = 0; w < writers; w++) {
+			workers.emplace_back([&, w]() {
+				MapNode* first = &m_nodes[stable + w * per_writer];
+				for(unsigned round = 0; round < rounds; round++) {
+					for(size_t i = 0; i < per_writer; i++) {
+						map.remove(first[i]);
+					}
+					qsbr.synchronize();
+					for(size_t i = 0; i < per_writer; i++) {
+						map.link(Key_t(stable + w * per_writer + (i + round) % per_writer), first[i]);
+					}
+				}
+				running.fetch_sub(1, std::memory_order_release);
+			});
+		}
+		for(std::thread& worker : workers) {
+			worker.join();
+		}
+		assert(map.size() == stable + per_writer * writers);
+		for(size_t i = 0; i < stable + per_writer * writers; i++) {
+			assert(map.find(Key_t(i)));
+		}
+		map.clear();
+	}
+
+};
+
+}; // namespace intrusive
+
+#endif /* INTRUSIVE_TESTS_TESTCONCURRENTHASHMAP_H */
@@ -6,10 +6,12 @@
 #include <assert.h>
 #include <cstdio>
 #include <cstdlib>
+#include <chrono>
 
 namespace intrusive {
 
-class TestHashMap {
+template<template<typename> class Bucket, template<typename, typename> class Hook = HashMapHook>
+class TestHashMapT {
 
 	template<typename T>
 	struct StructValue {
@@ -37,7 +39,7 @@ class TestHashMap {
 	};
 
 	template<typename K, typename V>
-	struct MapNode : public HashMapHook<K, MapNode<K, V> > {
+	struct MapNode : public Hook<K, MapNode<K, V> > {
 		V value;
 
 		MapNode() : value() {}
@@ -51,8 +53,8 @@ class TestHashMap {
 	};
 
 	using MapNode_t = MapNode<Key_t, Value_t>;
-	using Map_t = HashMap<Key_t, MapNode_t, SimpleHasher<Key_t> >;
-	using Bucket_t = Map_t::Bucket_t;
+	using Map_t = HashMap<Key_t, MapNode_t, SimpleHasher<Key_t>, std::allocator<Bucket<MapNode_t> > >;
+	using Bucket_t = typename Map_t::Bucket_t;
 
 	const size_t storage_size;
 	MapNode_t* storage;
@@ -62,9 +64,10 @@ class TestHashMap {
 
 public:
 
-	TestHashMap(unsigned storage_size, float load_factor)
+	TestHashMapT(unsigned storage_size, float load_factor)
 		: storage_size(storage_size), storage(new MapNode_t[storage_size]), bucket_list_size(
-		(storage_size / load_factor) + 1), map_default(bucket_list_size), map_one_bucket(1) {
+		(storage_size / load_factor) + 1), map_default(bucket_list_size)
+		, map_one_bucket(min_buckets(storage_size, static_cast<Bucket_t*>(nullptr))) {
 		if(not map_default.allocate())
 			throw std::logic_error("Cannot allocate 'default map' instance");
 
@@ -72,13 +75,13 @@ public:
 			throw std::logic_error("Cannot allocate 'map with one bucket' instance");
 	}
 
-	TestHashMap(const TestHashMap&) = delete;
-	TestHashMap(TestHashMap&&) = delete;
+	TestHashMapT(const TestHashMapT&) = delete;
+	TestHashMapT(TestHashMapT&&) = delete;
 
-	TestHashMap operator=(const TestHashMap&) = delete;
-	TestHashMap operator=(TestHashMap&&) = delete;
+	TestHashMapT operator=(const TestHashMapT&) = delete;
+	TestHashMapT operator=(TestHashMapT&&) = delete;
 
-	~TestHashMap() {
+	~TestHashMapT() {
 		// The map must be empty before the storage has been destroyed.
 		map_default.clear();
 		map_one_bucket.clear();
@@ -116,6 +119,48 @@ public:
 
 		test_raii(map_default);
 		test_raii(map_one_bucket);
+
+		test_find_bulk(map_default, step++);
+		test_find_bulk(map_one_bucket, step++);
+
+		test_resize(map_default, bucket_list_size * 2 + 1);
+		test_resize(map_default, bucket_list_size);
+		test_resize(map_one_bucket, bucket_list_size);
+		test_resize(map_one_bucket, min_buckets(storage_size, static_cast<Bucket_t*>(nullptr)));
+
+		perf_remove_skewed(storage_size * 256, 16);
+	}
+
+	/**
+	 * Eviction cost under deliberately skewed keys.
+	 * All the keys collide in one bucket, the nodes are removed in the order they were linked,
+	 * so the oldest node is always at the far end of its chain.
+	 * @param nodes - amount of nodes to link and remove.
+	 * @param keys - amount of distinct keys.
+	 */
+	void perf_remove_skewed(size_t nodes, size_t keys) {
+		printf("-> perf_remove_skewed(nodes=%zu, keys=%zu)\n", nodes, keys);
+		MapNode_t* skewed_storage = new MapNode_t[nodes];
+		const size_t skewed_buckets = min_buckets(keys, static_cast<Bucket_t*>(nullptr));
+		Map_t map(skewed_buckets);
+		assert(map.allocate());
+
+		for(size_t i = 0; i < nodes; i++) {
+			const Key_t key = Key_t((i % keys) * skewed_buckets);
+			auto it = map.link(key, skewed_storage[i]);
+			assert(it != map.end());
+		}
+
+		const auto before = std::chrono::steady_clock::now();
+		for(size_t i = 0; i < nodes; i++) {
+			map.remove(skewed_storage[i]);
+		}
+		const auto spent = std::chrono::steady_clock::now() - before;
+		assert(map.size() == 0);
+
+		const double ns = std::chrono::duration_cast<std::chrono::nanoseconds>(spent).count();
+		printf("perf=%.2f ns per one remove\n", ns / nodes);
+		delete[] skewed_storage;
 	}
 
 	void test_put_remove_forward(Map_t& map, unsigned step) noexcept {
@@ -246,6 +291,90 @@ public:
 		test_sanity();
 	}
 
+	void test_find_bulk(Map_t& map, unsigned step) noexcept {
+		printf("-> test_find_bulk()\n");
+		assert(map.size() == 0);
+
+		// the even keys are linked, the odd ones are missed
+		const size_t n = storage_size * 2;
+		Key_t* keys = new Key_t[n];
+		typename Map_t::Iterator_t* out = new typename Map_t::Iterator_t[n];
+		for(size_t i = 0; i < storage_size; i++) {
+			put_one(map, i, Key_t(i * 2 * step), i);
+		}
+		for(size_t i = 0; i < n; i++) {
+			keys[i] = Key_t(i * step);
+		}
+		map.find_bulk(keys, n, out);
+		const Map_t& const_map = map;
+		typename Map_t::ConstIterator_t const_out[3];
+		const_map.find_bulk(keys, 3, const_out);
+		for(size_t i = 0; i < n; i++) {
+			if(i % 2) {
+				assert(out[i] == map.end());
+			} else {
+				assert(out[i] != map.end());
+				assert(out[i]->im_key == keys[i]);
+				assert(out[i]->value == Value_t(i / 2));
+			}
+			if(i < 3) {
+				assert(const_out[i].get() == out[i].get());
+			}
+		}
+		for(size_t i = 0; i < storage_size; i++) {
+			remove_one(map, Key_t(i * 2 * step), i);
+		}
+		delete[] out;
+		delete[] keys;
+		assert(map.size() == 0);
+		test_sanity();
+	}
+
+	void test_resize(Map_t& map, size_t buckets) noexcept {
+		printf("-> test_resize(buckets=%zu)\n", buckets);
+		assert(map.size() == 0);
+
+		// the odd nodes hold the same key
+		const Key_t same_key = Key_t(storage_size);
+		for(size_t i = 0; i < storage_size; i++) {
+			put_one(map, i, i % 2 ? same_key : Key_t(i), i);
+		}
+		map.set_migrate_budget(1);
+		assert(map.resize(buckets));
+		assert(not map.resize(buckets));
+		assert(map.buckets() == buckets);
+
+		// every operation migrates one bucket, the nodes stay reachable meanwhile
+		size_t i = 0;
+		for(; map.migrating() && i < storage_size; i++) {
+			const size_t migrated = map.migrated();
+			if(i % 2) {
+				find_multi(map, same_key, i);
+			} else {
+				remove_one(map, Key_t(i), i);
+				miss_one(map, Key_t(i));
+			}
+			assert(not map.migrating() || map.migrated() > migrated);
+		}
+		while(map.migrating()) {
+			assert(map.migrate(1) == 1);
+		}
+		assert(map.migrated() == 0);
+		assert(map.migrating_buckets() == 0);
+
+		for(size_t j = 0; j < storage_size; j++) {
+			if(j % 2) {
+				remove_multi(map, same_key, j);
+			} else if(j >= i) {
+				remove_one(map, Key_t(j), j);
+			}
+		}
+		miss_one(map, same_key);
+		map.set_migrate_budget(2);
+		assert(map.size() == 0);
+		test_sanity();
+	}
+
 	void dump(Map_t& map) noexcept {
 		std::cout << "map has " << map.size() << " elements \n";
 		for(size_t bucket = 0; bucket < map.buckets(); ++bucket) {
@@ -259,6 +388,19 @@ public:
 
 private:
 
+	// the smallest bucket list which is able to hold the whole storage
+	static size_t min_buckets(size_t, const HashMapBucket<MapNode_t>*) noexcept {
+		return 1;
+	}
+
+	static size_t min_buckets(size_t, const HashMapDListBucket<MapNode_t>*) noexcept {
+		return 1;
+	}
+
+	static size_t min_buckets(size_t storage_size, const HashMapLineBucket<MapNode_t>*) noexcept {
+		return (storage_size + HashMapLineBucket<MapNode_t>::SLOTS - 1) / HashMapLineBucket<MapNode_t>::SLOTS;
+	}
+
 	void test_sanity() {
 		for(unsigned i = 0; i < storage_size; i++) {
 			assert(not storage[i].im_linked);
@@ -330,6 +472,10 @@ private:
 
 };
 
+using TestHashMap = TestHashMapT<HashMapBucket>;
+using TestHashMapLine = TestHashMapT<HashMapLineBucket>;
+using TestHashMapDList = TestHashMapT<HashMapDListBucket, HashMapDListHook>;
+
 }; // namespace intrusive
 
 #endif /* INTRUSIVE_TESTS_TESTHASHMAP_H */
@@ -88,6 +88,7 @@ public:
 		test_insert_before();
 		test_insert_after();
 		test_iterators();
+		test_splice_back();
 	}
 
 	void test_raii() {
@@ -192,6 +193,66 @@ public:
 		test_sanity();
 	}
 
+	void test_splice_back() {
+		printf("-> test_splice_back()\n");
+		assert(list.size() == 0);
+		if(storage_size < 4)
+			return;
+
+		// split the storage into the lists [0, half) and [half, storage_size)
+		const unsigned half = storage_size / 2;
+		List_t other;
+		for(Key_t i = 0; i < half; i++) {
+			list.push_back(storage[i]);
+		}
+		for(Key_t i = half; i < storage_size; i++) {
+			other.push_back(storage[i]);
+		}
+
+		// a range in the middle of the other list
+		other.splice_back(list, storage[1], storage[half - 2], half - 2);
+		assert(list.size() == 2);
+		assert(list.head() == &storage[0]);
+		assert(list.tail() == &storage[half - 1]);
+		assert(other.size() == storage_size - 2);
+		assert(other.tail() == &storage[half - 2]);
+
+		// the whole list to an empty one
+		List_t tmp;
+		tmp.splice_back(other, *other.head(), *other.tail(), other.size());
+		assert(other.size() == 0);
+		assert(other.head() == nullptr && other.tail() == nullptr);
+
+		// the head and the tail ranges
+		list.splice_back(tmp, *tmp.head(), storage[storage_size - 1], storage_size - half);
+		list.splice_back(tmp, *tmp.head(), *tmp.tail(), tmp.size());
+		assert(tmp.size() == 0);
+		assert(list.size() == storage_size);
+
+		Key_t expected[] = {0, half - 1};
+		Key_t index = 0;
+		for(auto it = list.begin(); it != list.end(); ++it, index++) {
+			Key_t value;
+			if(index < 2)
+				value = expected[index];
+			else if(index < 2 + storage_size - half)
+				value = half + index - 2;
+			else
+				value = index - (storage_size - half) - 1;
+			assert(it->value == storage[value].value);
+		}
+		assert(index == storage_size);
+
+		index = storage_size;
+		for(auto it = list.rbegin(); it != list.rend(); ++it) {
+			index--;
+		}
+		assert(index == 0);
+
+		list.clear();
+		test_sanity();
+	}
+
 	void test_iterators() {
 		printf("-> test_iterators()\n");
 		assert(list.size() == 0);
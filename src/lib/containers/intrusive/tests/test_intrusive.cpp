@@ -4,7 +4,9 @@
 #pragma GCC diagnostic ignored "-Weffc++"
 
 #include "TestLinkedList.h"
+#include "TestCompactList.h"
 #include "TestHashMap.h"
+#include "TestConcurrentHashMap.h"
 
 typedef unsigned Key_t;
 
@@ -21,6 +23,10 @@ int main_intrusive(int, char**) {
 	test_list.test();
 	std::cout << "\n";
 
+	intrusive::TestCompactList test_compact_list(storage_size);
+	test_compact_list.test();
+	std::cout << "\n";
+
 	intrusive::TestHashMap test_map_first(storage_size, load_factor_first);
 	test_map_first.test();
 	std::cout << "\n";
@@ -29,6 +35,26 @@ int main_intrusive(int, char**) {
 	test_map_second.test();
 	std::cout << "\n";
 
+	intrusive::TestHashMapLine test_map_line_first(storage_size, load_factor_first);
+	test_map_line_first.test();
+	std::cout << "\n";
+
+	intrusive::TestHashMapLine test_map_line_second(storage_size, load_factor_second);
+	test_map_line_second.test();
+	std::cout << "\n";
+
+	intrusive::TestHashMapDList test_map_dlist_first(storage_size, load_factor_first);
+	test_map_dlist_first.test();
+	std::cout << "\n";
+
+	intrusive::TestHashMapDList test_map_dlist_second(storage_size, load_factor_second);
+	test_map_dlist_second.test();
+	std::cout << "\n";
+
+	intrusive::TestConcurrentHashMap test_concurrent_map(storage_size * 16);
+	test_concurrent_map.test();
+	std::cout << "\n";
+
 	std::cout << "<---- the end of main_intrusive() ---->\n";
 	return 0;
 }
@@ -0,0 +1,306 @@
+#ifndef INTRUSIVEPOOL_CONCURRENTPOOL_H
+#define INTRUSIVEPOOL_CONCURRENTPOOL_H
+
+#include <atomic>
+#include <bits/allocator.h>
+#include <cstdint>
+#include <cstdlib>
+
+namespace intrusive {
+
+template<typename T>
+struct ConcurrentPoolNode {
+	using Value_t = T;
+	T value;
+	std::atomic<uint32_t> next; // the next free node, the free list only
+
+	ConcurrentPoolNode() : value(), next(0) {}
+
+	ConcurrentPoolNode(const ConcurrentPoolNode&) = delete;
+	ConcurrentPoolNode& operator=(const ConcurrentPoolNode&) = delete;
+
+	ConcurrentPoolNode(ConcurrentPoolNode&&) = delete;
+	ConcurrentPoolNode& operator=(ConcurrentPoolNode&&) = delete;
+};
+
+/**
+ * A preallocated pool which nodes are acquired and released by any thread without locks.
+ * The free list is a Treiber stack of node indices, its head is tagged with a counter
+ * which is incremented on every change, so a stale head never wins the CAS (no ABA).
+ * The nodes are never freed, so a racing reader of a popped node reads valid memory.
+ *
+ * An index of a node is 32-bit, so a node can be handed to another core through SpscRing.
+ * The pool doesn't track the acquired nodes, the owner of a node releases it.
+ */
+template<
+	typename Node_t,
+	typename SA = std::allocator<Node_t>
+>
+class ConcurrentPool {
+	friend class TestConcurrentPool;
+
+public:
+	using Value_t = typename Node_t::Value_t;
+
+	static constexpr uint32_t NIL = ~uint32_t(0);
+
+private:
+	static inline constexpr uint64_t pack(uint32_t tag, uint32_t index) noexcept {
+		return (uint64_t(tag) << 32) | index;
+	}
+
+	static inline constexpr uint32_t index_of(uint64_t head) noexcept {
+		return uint32_t(head);
+	}
+
+	static inline constexpr uint32_t tag_of(uint64_t head) noexcept {
+		return uint32_t(head >> 32);
+	}
+
+	const size_t m_capacity;
+	Node_t* m_storage;
+	SA m_allocator;
+	alignas(64) std::atomic<uint64_t> m_head; // the tagged index of the free list head
+	alignas(64) std::atomic<size_t> m_available;
+
+public:
+
+	ConcurrentPool(unsigned capacity) noexcept
+		: m_capacity(capacity), m_storage(nullptr), m_allocator(), m_head(pack(0, NIL)), m_available(0) {}
+
+	ConcurrentPool(const ConcurrentPool&) = delete;
+	ConcurrentPool& operator=(const ConcurrentPool&) = delete;
+
+	ConcurrentPool(ConcurrentPool&& rv) = delete;
+	ConcurrentPool& operator=(ConcurrentPool&&) = delete;
+
+	virtual ~ConcurrentPool() noexcept {
+		destroy();
+	}
+
+	/**
+	 * Allocate the node storage, it must not be called concurrently.
+	 * @return 0 - if the storage has been allocated successfully.
+	 */
+	int allocate() noexcept {
+		if(m_storage || m_capacity >= NIL)
+			return -1;
+
+		m_storage = m_allocator.allocate(m_capacity);
+		if(m_storage == nullptr)
+			return -1;
+
+		for(size_t i = 0; i < m_capacity; i++) {
+			m_allocator.construct(m_storage + i);
+		}
+		reset();
+		return 0;
+	}
+
+	/**
+	 * Take a free node, it may be called by any thread.
+	 * @return nullptr - if there is no free node.
+	 */
+	Node_t* acquire() noexcept {
+		uint64_t head = m_head.load(std::memory_order_acquire);
+		for(;;) {
+			const uint32_t index = index_of(head);
+			if(index == NIL)
+				return nullptr;
+
+			const uint32_t next = m_storage[index].next.load(std::memory_order_relaxed);
+			if(m_head.compare_exchange_weak(head, pack(tag_of(head) + 1, next),
+			                                std::memory_order_acquire, std::memory_order_acquire)) {
+				m_available.fetch_sub(1, std::memory_order_relaxed);
+				return m_storage + index;
+			}
+		}
+	}
+
+	/**
+	 * Return a node to the pool, it may be called by any thread.
+	 */
+	void release(Node_t* node) noexcept {
+		const uint32_t index = this->index(node);
+		m_available.fetch_add(1, std::memory_order_relaxed);
+		uint64_t head = m_head.load(std::memory_order_relaxed);
+		do {
+			node->next.store(index_of(head), std::memory_order_relaxed);
+		} while(not m_head.compare_exchange_weak(head, pack(tag_of(head) + 1, index),
+		                                         std::memory_order_release, std::memory_order_relaxed));
+	}
+
+	/**
+	 * @return the index of the node in the storage, e.g. to pass the node through SpscRing.
+	 */
+	inline uint32_t index(const Node_t* node) const noexcept {
+		return uint32_t(node - m_storage);
+	}
+
+	inline Node_t* at(uint32_t index) noexcept {
+		return m_storage + index;
+	}
+
+	inline const Node_t* at(uint32_t index) const noexcept {
+		return m_storage + index;
+	}
+
+	/**
+	 * Return all the nodes to the free list, it must not be called concurrently.
+	 */
+	void reset() noexcept {
+		for(size_t i = 0; i < m_capacity; i++) {
+			m_storage[i].next.store(i + 1 < m_capacity ? uint32_t(i + 1) : NIL, std::memory_order_relaxed);
+		}
+		m_head.store(pack(tag_of(m_head.load()) + 1, m_capacity ? 0 : NIL));
+		m_available.store(m_capacity);
+	}
+
+	inline size_t capacity() const noexcept {
+		return m_capacity;
+	}
+
+	/**
+	 * @return amount of the free nodes, it is approximate while the pool is in use.
+	 */
+	inline size_t available() const noexcept {
+		return m_available.load(std::memory_order_relaxed);
+	}
+
+	inline size_t storage_bytes() noexcept {
+		return m_capacity * sizeof(Node_t);
+	}
+
+private:
+
+	void destroy() noexcept {
+		if(m_storage) {
+			for(size_t i = 0; i < m_capacity; i++) {
+				m_allocator.destroy(m_storage + i);
+			}
+			m_allocator.deallocate(m_storage, m_capacity);
+			m_storage = nullptr;
+		}
+	}
+
+};
+
+/**
+ * A single producer single consumer ring of 32-bit node indices, e.g. of ConcurrentPool or DequePool nodes,
+ * to hand the nodes over from one core to another without locks.
+ * The producer and the consumer keep their positions on their own cache lines
+ * and cache the position of the other side, so a cache line moves only when the cached position runs out.
+ * @tparam A - the allocator of the slots.
+ */
+template<typename A = std::allocator<uint32_t> >
+class SpscRing {
+	friend class TestConcurrentPool;
+
+	const size_t m_capacity; // a power of two
+	const size_t m_mask;
+	uint32_t* m_slots;
+	A m_allocator;
+
+	alignas(64) std::atomic<size_t> m_tail; // the producer position
+	size_t m_head_cached;
+
+	alignas(64) std::atomic<size_t> m_head; // the consumer position
+	size_t m_tail_cached;
+
+public:
+
+	/**
+	 * @param capacity - amount of slots, it is rounded up to a power of two.
+	 */
+	SpscRing(size_t capacity) noexcept
+		: m_capacity(round_up(capacity))
+		, m_mask(m_capacity - 1)
+		, m_slots(nullptr)
+		, m_allocator()
+		, m_tail(0)
+		, m_head_cached(0)
+		, m_head(0)
+		, m_tail_cached(0) {}
+
+	SpscRing(const SpscRing&) = delete;
+	SpscRing& operator=(const SpscRing&) = delete;
+
+	SpscRing(SpscRing&& rv) = delete;
+	SpscRing& operator=(SpscRing&&) = delete;
+
+	virtual ~SpscRing() noexcept {
+		if(m_slots) {
+			m_allocator.deallocate(m_slots, m_capacity);
+			m_slots = nullptr;
+		}
+	}
+
+	/**
+	 * @return 0 - if the slots have been allocated successfully.
+	 */
+	int allocate() noexcept {
+		if(m_slots)
+			return -1;
+
+		m_slots = m_allocator.allocate(m_capacity);
+		return m_slots ? 0 : -1;
+	}
+
+	/**
+	 * The producer side.
+	 * @return false - if the ring is full.
+	 */
+	inline bool push(uint32_t index) noexcept {
+		const size_t tail = m_tail.load(std::memory_order_relaxed);
+		if(tail - m_head_cached == m_capacity) {
+			m_head_cached = m_head.load(std::memory_order_acquire);
+			if(tail - m_head_cached == m_capacity)
+				return false;
+		}
+		m_slots[tail & m_mask] = index;
+		m_tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	 * The consumer side.
+	 * @return false - if the ring is empty.
+	 */
+	inline bool pop(uint32_t& index) noexcept {
+		const size_t head = m_head.load(std::memory_order_relaxed);
+		if(head == m_tail_cached) {
+			m_tail_cached = m_tail.load(std::memory_order_acquire);
+			if(head == m_tail_cached)
+				return false;
+		}
+		index = m_slots[head & m_mask];
+		m_head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	inline size_t capacity() const noexcept {
+		return m_capacity;
+	}
+
+	/**
+	 * @return amount of the indices in the ring, it is approximate while the ring is in use.
+	 */
+	inline size_t size() const noexcept {
+		return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+	}
+
+private:
+
+	static inline size_t round_up(size_t capacity) noexcept {
+		size_t result = 1;
+		while(result < capacity) {
+			result <<= 1;
+		}
+		return result;
+	}
+
+};
+
+}; // namespace intrusive
+
+#endif /* INTRUSIVEPOOL_CONCURRENTPOOL_H */
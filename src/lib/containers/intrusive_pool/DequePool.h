@@ -2,6 +2,7 @@
 #define INTRUSIVEPOOL_DEQUEDPOOL_H
 
 #include "../../../intrusive/LinkedList.h"
+#include "../../../intrusive/CompactList.h"
 #include "../../../intrusive/HashMap.h"
 
 #include <bits/allocator.h>
@@ -26,15 +27,42 @@ struct DequePoolNode : public intrusive::LinkedListHook<DequePoolNode<T> > {
 	}
 };
 
+/**
+ * A node with the 8 byte CompactListHook, it requires DequePool with CompactList.
+ */
+template<typename T>
+struct CompactDequePoolNode : public intrusive::CompactListHook<CompactDequePoolNode<T> > {
+	using Value_t = T;
+	T value;
+
+	CompactDequePoolNode() : value() {}
+
+	CompactDequePoolNode(const CompactDequePoolNode&) = delete;
+	CompactDequePoolNode& operator=(const CompactDequePoolNode&) = delete;
+
+	CompactDequePoolNode(CompactDequePoolNode&&) = delete;
+	CompactDequePoolNode& operator=(CompactDequePoolNode&&) = delete;
+
+	bool operator==(const CompactDequePoolNode& data) const noexcept {
+		return value == data.value;
+	}
+};
+
+/**
+ * @tparam L - the list of the nodes, CompactList for the CompactListHook nodes.
+ * The nodes live in one storage array, so the 32-bit offsets of CompactList always fit.
+ */
 template<
 	typename Node_t,
-	typename SA = std::allocator<Node_t>
+	typename SA = std::allocator<Node_t>,
+	typename L = intrusive::LinkedList<Node_t>
 >
 class DequePool {
+	template<template<typename> class, template<typename> class>
 	friend class TestDequePool;
 
 	using Value_t = typename Node_t::Value_t;
-	using List_t = intrusive::LinkedList<Node_t>;
+	using List_t = L;
 
 	const size_t m_capacity;
 	Node_t* m_storage;
@@ -149,6 +177,50 @@ public:
 		return Iterator_t(result);
 	}
 
+	/**
+	 * Push back a burst of up to 'n' nodes, the nodes are spliced from the free list at once.
+	 * @param out - takes the iterators of the pushed nodes in the queue order.
+	 * @return amount of the pushed nodes, less than 'n' if the pool runs out of free nodes.
+	 */
+	size_t push_back_bulk(size_t n, Iterator_t* out) noexcept {
+		if(n > available())
+			n = available();
+		if(n == 0)
+			return 0;
+
+		ReverseIterator_t first = m_list_freed.rbegin();
+		for(size_t i = 1; i < n; i++) {
+			++first;
+		}
+		Iterator_t it(first.get());
+		m_list_cached.splice_back(m_list_freed, *first, *m_list_freed.tail(), n);
+		for(size_t i = 0; i < n; i++, ++it) {
+			out[i] = it;
+		}
+		return n;
+	}
+
+	/**
+	 * Pop front a burst of up to 'n' nodes, the nodes are spliced to the free list at once.
+	 * The values of the popped nodes stay valid until the nodes are pushed again.
+	 * @param out - takes the iterators of the popped nodes in the queue order.
+	 * @return amount of the popped nodes, less than 'n' if the queue runs out of nodes.
+	 */
+	size_t pop_front_bulk(size_t n, Iterator_t* out) noexcept {
+		if(n > size())
+			n = size();
+		if(n == 0)
+			return 0;
+
+		Iterator_t it = m_list_cached.begin();
+		out[0] = it;
+		for(size_t i = 1; i < n; i++) {
+			out[i] = ++it;
+		}
+		m_list_freed.splice_back(m_list_cached, *out[0], *it, n);
+		return n;
+	}
+
 	inline void remove(Iterator_t it) noexcept {
 		m_list_cached.remove(*it);
 		m_list_freed.push_back(*it);
@@ -161,6 +233,7 @@ public:
 
 	void reset() noexcept {
 		m_list_cached.clear();
+		m_list_freed.clear();
 		for(unsigned i = 0; i < m_capacity; i++) {
 			m_list_freed.push_back(m_storage[i]);
 		}
@@ -178,6 +251,21 @@ public:
 		return m_list_freed.size();
 	}
 
+	inline size_t storage_bytes() noexcept {
+		return m_capacity * sizeof(Node_t);
+	}
+
+	/**
+	 * @return the array of the capacity() nodes, nullptr - if it is not allocated, e.g. to index the nodes.
+	 */
+	inline Node_t* storage() noexcept {
+		return m_storage;
+	}
+
+	inline const Node_t* storage() const noexcept {
+		return m_storage;
+	}
+
 private:
 
 	void destroy() noexcept {
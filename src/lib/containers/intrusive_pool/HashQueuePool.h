@@ -8,10 +8,13 @@
 
 namespace intrusive {
 
-template<typename K>
+/**
+ * @tparam MH - the map hook, HashMapDListHook is required by the HashMapDListBucket layout.
+ */
+template<typename K, template<typename, typename> class MH = intrusive::HashMapHook>
 struct HashQueuePoolEmptyNode
-	: public intrusive::LinkedListHook<HashQueuePoolEmptyNode<K> >,
-	  intrusive::HashMapHook<K, HashQueuePoolEmptyNode<K> > {
+	: public intrusive::LinkedListHook<HashQueuePoolEmptyNode<K, MH> >,
+	  MH<K, HashQueuePoolEmptyNode<K, MH> > {
 	using Key_t = K;
 
 	HashQueuePoolEmptyNode() noexcept = default;
@@ -24,9 +27,12 @@ struct HashQueuePoolEmptyNode
 
 };
 
-template<typename K, typename V>
+/**
+ * @tparam MH - the map hook, HashMapDListHook is required by the HashMapDListBucket layout.
+ */
+template<typename K, typename V, template<typename, typename> class MH = intrusive::HashMapHook>
 struct HashQueuePoolNode
-	: public intrusive::LinkedListHook<HashQueuePoolNode<K, V> >, intrusive::HashMapHook<K, HashQueuePoolNode<K, V> > {
+	: public intrusive::LinkedListHook<HashQueuePoolNode<K, V, MH> >, MH<K, HashQueuePoolNode<K, V, MH> > {
 	using Key_t = K;
 	using Value_t = V;
 	V value;
@@ -44,6 +50,25 @@ struct HashQueuePoolNode
 	}
 };
 
+/**
+ * The hot path counters of a pool (see utils/Metrics.h), the map counters are attached to its map.
+ */
+struct HashQueuePoolMetrics {
+	HashMapMetrics map;
+	utils::Counter evicted; // pop_front()
+	utils::Counter dropped; // the pushes which have found no free node or which the map couldn't hold
+
+	void write(utils::MetricsWriter& writer) const noexcept {
+		map.write(writer);
+		writer.counter("pool_evicted", evicted);
+		writer.counter("pool_dropped", dropped);
+	}
+};
+
+/**
+ * @tparam SA - the node storage allocator.
+ * @tparam BA - the bucket allocator, its value type selects the HashMap layout (see HashMap.h).
+ */
 template<
 	typename Node_t,
 	typename H = std::hash<typename Node_t::Key_t>,
@@ -64,18 +89,27 @@ class HashQueuePool {
 	List_t m_list_cached;
 	List_t m_list_freed;
 	SA m_allocator;
+	HashQueuePoolMetrics m_metrics;
 
 public:
 	using Iterator_t = typename Map_t::Iterator_t;
 	using ConstIterator_t = typename Map_t::ConstIterator_t;
 
-	HashQueuePool(unsigned capacity, float load_factor) noexcept
+	/**
+	 * @param capacity - amount of nodes.
+	 * @param load_factor - average amount of nodes per bucket.
+	 * @param sizing - HashMapSizing::POW2 rounds the buckets up to a power of two to index them with a mask.
+	 */
+	HashQueuePool(unsigned capacity, float load_factor, HashMapSizing sizing = HashMapSizing::EXACT) noexcept
 		: m_capacity(capacity)
 		, m_storage(nullptr)
-		, m_map((capacity / load_factor) + 1)
+		, m_map((capacity / load_factor) + 1, sizing)
 		, m_list_cached()
 		, m_list_freed()
-		, m_allocator() {}
+		, m_allocator()
+		, m_metrics() {
+		m_map.set_metrics(&m_metrics.map);
+	}
 
 	HashQueuePool(const HashQueuePool&) = delete;
 	HashQueuePool& operator=(const HashQueuePool&) = delete;
@@ -120,14 +154,78 @@ public:
 		return m_map.cend();
 	}
 
+	/**
+	 * @return end() - if there is no free node or the map cannot hold one more node (LineBucket).
+	 */
 	Iterator_t push_back(const Key_t& key) noexcept {
-		Node_t* freed = nullptr;
 		if(available()) {
-			freed = m_list_freed.pop_back();
+			Node_t* freed = m_list_freed.tail();
+			Iterator_t result = m_map.link(key, *freed);
+			if(result) {
+				m_list_freed.pop_back();
+				m_list_cached.push_back(*freed);
+				return result;
+			}
+		}
+		count_dropped(1);
+		return end();
+	}
+
+	/**
+	 * Push back a burst of keys, the nodes are spliced from the free list at once and linked to the keys.
+	 * Like push_back() it doesn't look for the keys, a node which the map cannot hold goes back to the free list.
+	 * @param out - takes the iterators of the pushed nodes, end() for the keys which have not been pushed.
+	 * @return amount of the pushed nodes.
+	 */
+	size_t insert_bulk(const Key_t* keys, size_t n, Iterator_t* out) noexcept {
+		size_t taken = n < available() ? n : available();
+		for(size_t i = taken; i < n; i++) {
+			out[i] = end();
+		}
+		count_dropped(n - taken);
+		if(taken == 0)
+			return 0;
+
+		typename List_t::ReverseIterator_t first = m_list_freed.rbegin();
+		for(size_t i = 1; i < taken; i++) {
+			++first;
+		}
+		Node_t* node = first.get();
+		m_list_cached.splice_back(m_list_freed, *first, *m_list_freed.tail(), taken);
+
+		size_t result = 0;
+		for(size_t i = 0; i < taken; i++) {
+			Node_t* next = node->il_next;
+			out[i] = m_map.link(keys[i], *node);
+			if(out[i]) {
+				result++;
+			} else {
+				m_list_cached.remove(*node);
+				m_list_freed.push_back(*node);
+				count_dropped(1);
+			}
+			node = next;
+		}
+		return result;
+	}
+
+	/**
+	 * Find the first node of the key or push a new one back if there is none, with a single map probe.
+	 * A found node keeps its place in the queue, see move_back().
+	 * @param inserted - true if a new node has been pushed.
+	 * @return end() - if the key is missed and the pool is full.
+	 */
+	Iterator_t find_or_insert(const Key_t& key, bool& inserted) noexcept {
+		Node_t* freed = m_list_freed.tail();
+		Iterator_t result = m_map.find_or_link(key, freed);
+		inserted = result && result.get() == freed;
+		if(inserted) {
+			m_list_freed.pop_back();
 			m_list_cached.push_back(*freed);
-			m_map.link(key, *freed);
+		} else if(not result) {
+			count_dropped(1);
 		}
-		return Iterator_t(freed);
+		return result;
 	}
 
 	inline Iterator_t peek_front() noexcept {
@@ -138,12 +236,26 @@ public:
 		return result;
 	}
 
+	/**
+	 * Walk the nodes in use from the oldest one to the newest one, that is in the order of their eviction.
+	 * @param f - a functor which takes 'const Node_t&', the pool must not be changed by it.
+	 */
+	template<typename F>
+	void for_each(const F& f) const noexcept {
+		for(auto it = m_list_cached.cbegin(); it != m_list_cached.cend(); ++it) {
+			f(*it);
+		}
+	}
+
 	inline Iterator_t pop_front() noexcept {
 		Node_t* result = nullptr;
 		if(size()) {
 			result = m_list_cached.pop_front();
 			m_list_freed.push_back(*result);
 			m_map.remove(*result);
+			if(utils::Metrics::ENABLED) {
+				m_metrics.evicted.add();
+			}
 		}
 		return Iterator_t(result);
 	}
@@ -156,6 +268,17 @@ public:
 		return Iterator_t(m_map.find(key).get());
 	}
 
+	/**
+	 * Find the first nodes of a burst of keys, see HashMap::find_bulk().
+	 */
+	inline void find_bulk(const Key_t* keys, size_t n, ConstIterator_t* out) const noexcept {
+		m_map.find_bulk(keys, n, out);
+	}
+
+	inline void find_bulk(const Key_t* keys, size_t n, Iterator_t* out) noexcept {
+		m_map.find_bulk(keys, n, out);
+	}
+
 	inline void move_back(Iterator_t it) noexcept {
 		m_list_cached.remove(*it);
 		m_list_cached.push_back(*it);
@@ -188,12 +311,54 @@ public:
 		return m_list_freed.size();
 	}
 
+	/**
+	 * Start an incremental migration of the map to 'buckets' buckets (see HashMap::resize()).
+	 * @return true - if the migration has been started.
+	 */
+	inline bool resize_map(size_t buckets, HashMapSizing sizing = HashMapSizing::EXACT) noexcept {
+		return m_map.resize(buckets, sizing);
+	}
+
+	/**
+	 * @return true - if the map is migrating to a new bucket list.
+	 */
+	inline bool map_migrating() const noexcept {
+		return m_map.migrating();
+	}
+
+	/**
+	 * @param budget - amount of the old buckets migrated per pool operation.
+	 */
+	inline void set_migrate_budget(size_t budget) noexcept {
+		m_map.set_migrate_budget(budget);
+	}
+
 	inline size_t storage_bytes() noexcept {
-		return m_capacity * sizeof(Node_t) + m_map.buckets() * sizeof(Bucket_t);
+		return m_capacity * sizeof(Node_t) + (m_map.buckets() + m_map.migrating_buckets()) * sizeof(Bucket_t);
+	}
+
+	/**
+	 * @return the hot path counters, they are counted with METRICS_ENABLED only.
+	 */
+	inline const HashQueuePoolMetrics& metrics() const noexcept {
+		return m_metrics;
+	}
+
+	/**
+	 * See HashMap::chains().
+	 */
+	inline void chains(utils::Log2Histogram& histogram) const noexcept {
+		m_map.chains(histogram);
 	}
 
 private:
 
+	inline void count_dropped(size_t n) noexcept {
+		if(utils::Metrics::ENABLED && n) {
+			m_metrics.dropped.add(n);
+		}
+	}
+
 	void destroy() noexcept {
 		if(m_storage) {
 			m_list_freed.clear();
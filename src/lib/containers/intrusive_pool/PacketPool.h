@@ -0,0 +1,363 @@
+#ifndef INTRUSIVEPOOL_PACKETPOOL_H
+#define INTRUSIVEPOOL_PACKETPOOL_H
+
+#include "DequePool.h"
+#include "../dpdk/Allocator.h"
+#include "../../proto/mframe/MFrame.h"
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+
+namespace intrusive {
+
+/**
+ * A packet buffer of PacketPool, as rte_mbuf is: the hook of the pool and the metadata share the first cache line
+ * and the buffer starts on the second one. The data starts HEADROOM bytes into the buffer, so the headers can be
+ * prepended with prepend() or head_move_back() of frame() without a copy.
+ * A packet may be referenced by several owners (see PacketPool::clone()), a shared packet is read only and it is
+ * copied by PacketPool::copy() to be rewritten.
+ * @tparam SIZE - the buffer bytes, a multiple of the cache line.
+ * @tparam HEADROOM - the bytes before the data of a new packet.
+ */
+template<size_t SIZE = 2048, size_t HEADROOM = 128>
+struct Packet : public intrusive::LinkedListHook<Packet<SIZE, HEADROOM> > {
+	static_assert(SIZE % 64 == 0, "the buffer must be a multiple of the cache line");
+	static_assert(HEADROOM < SIZE && SIZE <= UINT16_MAX, "the offsets are 16-bit");
+
+	using Value_t = Packet;
+
+	static constexpr size_t BUFFER_SIZE = SIZE;
+	static constexpr size_t HEADROOM_SIZE = HEADROOM;
+
+	uint32_t refcnt;
+	uint16_t offset; // the data from the buffer
+	uint16_t length; // the data bytes
+	alignas(64) uint8_t buffer[SIZE];
+
+	Packet() noexcept : refcnt(0), offset(HEADROOM), length(0) {}
+
+	Packet(const Packet&) = delete;
+	Packet& operator=(const Packet&) = delete;
+
+	Packet(Packet&&) = delete;
+	Packet& operator=(Packet&&) = delete;
+
+	inline uint8_t* data() noexcept {
+		assert(not shared());
+		return buffer + offset;
+	}
+
+	inline const uint8_t* data() const noexcept {
+		return buffer + offset;
+	}
+
+	inline size_t headroom() const noexcept {
+		return offset;
+	}
+
+	inline size_t tailroom() const noexcept {
+		return SIZE - offset - length;
+	}
+
+	/**
+	 * @return true - if the packet has several references, it is read only then.
+	 */
+	inline bool shared() const noexcept {
+		return refcnt > 1;
+	}
+
+	/**
+	 * @return a frame of the data, its head can be moved back by headroom() and its tail by tailroom() bytes.
+	 * The moves are kept by update().
+	 */
+	inline proto::RwMFrame frame() noexcept {
+		assert(not shared());
+		proto::RwMFrame result(buffer, SIZE);
+		result.head_move(offset);
+		result.tail_move_back(tailroom());
+		return result;
+	}
+
+	inline proto::RoMFrame frame() const noexcept {
+		proto::RoMFrame result(buffer, SIZE);
+		result.head_move(offset);
+		result.tail_move_back(tailroom());
+		return result;
+	}
+
+	/**
+	 * Take the data from the head to the tail of @frame, a frame() of this packet.
+	 */
+	inline void update(const proto::RwMFrame& frame) noexcept {
+		assert(frame.size() == SIZE && frame.head() >= buffer && frame.tail() <= buffer + SIZE);
+		offset = uint16_t(frame.offset());
+		length = uint16_t(frame.available());
+	}
+
+	/**
+	 * Prepend @bytes to the data, e.g. an encapsulation header.
+	 * @return the new data, nullptr - if the headroom is too short.
+	 */
+	inline uint8_t* prepend(size_t bytes) noexcept {
+		if(bytes > headroom()) {
+			return nullptr;
+		}
+		offset -= uint16_t(bytes);
+		length += uint16_t(bytes);
+		return data();
+	}
+
+	/**
+	 * Append @bytes to the data.
+	 * @return the appended bytes, nullptr - if the tailroom is too short.
+	 */
+	inline uint8_t* append(size_t bytes) noexcept {
+		if(bytes > tailroom()) {
+			return nullptr;
+		}
+		uint8_t* result = data() + length;
+		length += uint16_t(bytes);
+		return result;
+	}
+
+	/**
+	 * Remove @bytes from the beginning of the data, e.g. a decapsulated header.
+	 * @return false - if the data is shorter.
+	 */
+	inline bool adj(size_t bytes) noexcept {
+		if(bytes > length) {
+			return false;
+		}
+		offset += uint16_t(bytes);
+		length -= uint16_t(bytes);
+		return true;
+	}
+
+	/**
+	 * Remove @bytes from the end of the data.
+	 * @return false - if the data is shorter.
+	 */
+	inline bool trim(size_t bytes) noexcept {
+		if(bytes > length) {
+			return false;
+		}
+		length -= uint16_t(bytes);
+		return true;
+	}
+};
+
+struct PacketPoolStat {
+	uint64_t allocated;
+	uint64_t freed;
+	uint64_t failed; // the allocations of an empty pool
+	uint64_t cloned;
+	uint64_t copied;
+
+	PacketPoolStat() noexcept : allocated(0), freed(0), failed(0), cloned(0), copied(0) {}
+};
+
+/**
+ * A preallocated pool of the packet buffers built on DequePool, the packets are allocated, queued, cloned and
+ * rewritten without the heap. The packets in use are the queue of the pool and the free ones are its free list,
+ * which is LIFO, so a packet which has just been freed is allocated again while its buffer is hot in the cache.
+ *
+ * A pool is per core and there is no lock, the reference counts are not atomic: each core allocates its pool
+ * on its own NUMA node (dpdk::Allocator) and it is the cache of the core. A packet handed over to another core
+ * is returned through SpscRing by index() and at(), it is freed by the core of its pool only.
+ *
+ * Using sample:
+ * Packet_t* pkt = pool.alloc(frame, bytes);
+ * proto::RwMFrame frame = pkt->frame();
+ * frame.head_move_back(sizeof(Vlan::Header));
+ * ...
+ * pkt->update(frame);
+ * Packet_t* mirror = pool.clone(pkt);
+ * ...
+ * pool.free(pkt);
+ * pool.free(mirror);
+ *
+ * @tparam SA - the allocator of the packets, it must align them to the cache line as dpdk::Allocator does.
+ */
+template<size_t SIZE = 2048, size_t HEADROOM = 128, typename SA = dpdk::Allocator<Packet<SIZE, HEADROOM> > >
+class PacketPool {
+	friend class TestPacketPool;
+
+public:
+	using Packet_t = Packet<SIZE, HEADROOM>;
+
+	static constexpr size_t BURST = 32;
+
+private:
+	using Pool_t = DequePool<Packet_t, SA>;
+	using Iterator_t = typename Pool_t::Iterator_t;
+
+	Pool_t m_pool;
+	Packet_t* m_storage; // the first packet
+	PacketPoolStat m_stat;
+
+public:
+
+	PacketPool(unsigned capacity) noexcept : m_pool(capacity), m_storage(nullptr), m_stat() {}
+
+	PacketPool(const PacketPool&) = delete;
+	PacketPool& operator=(const PacketPool&) = delete;
+
+	PacketPool(PacketPool&&) = delete;
+	PacketPool& operator=(PacketPool&&) = delete;
+
+	/**
+	 * Allocate the packets.
+	 * @return 0 - if the packets have been allocated and aligned to the cache line.
+	 */
+	int allocate() noexcept {
+		if(m_pool.allocate()) {
+			return -1;
+		}
+		m_storage = m_pool.capacity() ? m_pool.storage() : nullptr;
+		return reinterpret_cast<uintptr_t>(m_storage) % 64 == 0 ? 0 : -1;
+	}
+
+	/**
+	 * @return a packet with no data, HEADROOM bytes into the buffer, nullptr - if the pool is empty.
+	 */
+	inline Packet_t* alloc() noexcept {
+		Iterator_t it = m_pool.push_back();
+		if(not it) {
+			m_stat.failed++;
+			return nullptr;
+		}
+		m_stat.allocated++;
+		return init(*it);
+	}
+
+	/**
+	 * @return a packet with a copy of @bytes of @data, nullptr - if the pool is empty or the data doesn't fit.
+	 */
+	inline Packet_t* alloc(const uint8_t* data, size_t bytes) noexcept {
+		if(bytes > SIZE - HEADROOM) {
+			m_stat.failed++;
+			return nullptr;
+		}
+		Packet_t* result = alloc();
+		if(result) {
+			memcpy(result->append(bytes), data, bytes);
+		}
+		return result;
+	}
+
+	/**
+	 * Allocate a burst of up to @n packets at once, e.g. for a receive burst.
+	 * @return amount of the allocated packets, less than @n if the pool runs out of packets.
+	 */
+	size_t alloc_bulk(Packet_t** out, size_t n) noexcept {
+		Iterator_t its[BURST];
+		size_t result = 0;
+		while(result < n) {
+			const size_t burst = n - result < BURST ? n - result : size_t(BURST);
+			const size_t taken = m_pool.push_back_bulk(burst, its);
+			for(size_t i = 0; i < taken; i++) {
+				out[result++] = init(*its[i]);
+			}
+			if(taken < burst) {
+				m_stat.failed += n - result;
+				break;
+			}
+		}
+		m_stat.allocated += result;
+		return result;
+	}
+
+	/**
+	 * @return one more reference of @pkt, e.g. to queue it twice, both references are read only until one is freed.
+	 */
+	inline Packet_t* clone(Packet_t* pkt) noexcept {
+		pkt->refcnt++;
+		m_stat.cloned++;
+		return pkt;
+	}
+
+	/**
+	 * @return a new packet with the data of @pkt at the same offset, e.g. to rewrite a shared packet,
+	 * nullptr - if the pool is empty.
+	 */
+	Packet_t* copy(const Packet_t* pkt) noexcept {
+		Packet_t* result = alloc();
+		if(result) {
+			result->offset = pkt->offset;
+			result->length = pkt->length;
+			memcpy(result->data(), pkt->data(), pkt->length);
+			m_stat.copied++;
+		}
+		return result;
+	}
+
+	/**
+	 * Drop a reference of @pkt, the packet goes back to the pool with the last one.
+	 */
+	inline void free(Packet_t* pkt) noexcept {
+		assert(pkt->refcnt > 0 && owns(pkt));
+		if(--pkt->refcnt == 0) {
+			m_pool.remove(Iterator_t(pkt));
+			m_stat.freed++;
+		}
+	}
+
+	void free_bulk(Packet_t** pkts, size_t n) noexcept {
+		for(size_t i = 0; i < n; i++) {
+			free(pkts[i]);
+		}
+	}
+
+	/**
+	 * @return the index of @pkt in the pool, e.g. to pass it through SpscRing.
+	 */
+	inline uint32_t index(const Packet_t* pkt) const noexcept {
+		return uint32_t(pkt - m_storage);
+	}
+
+	inline Packet_t* at(uint32_t index) noexcept {
+		return m_storage + index;
+	}
+
+	inline bool owns(const Packet_t* pkt) const noexcept {
+		return pkt >= m_storage && pkt < m_storage + m_pool.capacity();
+	}
+
+	inline size_t capacity() const noexcept {
+		return m_pool.capacity();
+	}
+
+	/**
+	 * @return amount of the packets in use.
+	 */
+	inline size_t size() const noexcept {
+		return m_pool.size();
+	}
+
+	inline size_t available() const noexcept {
+		return m_pool.available();
+	}
+
+	inline const PacketPoolStat& stat() const noexcept {
+		return m_stat;
+	}
+
+	inline size_t storage_bytes() noexcept {
+		return m_pool.storage_bytes();
+	}
+
+private:
+
+	static inline Packet_t* init(Packet_t& pkt) noexcept {
+		pkt.refcnt = 1;
+		pkt.offset = HEADROOM;
+		pkt.length = 0;
+		return &pkt;
+	}
+
+};
+
+}; // namespace intrusive
+
+#endif /* INTRUSIVEPOOL_PACKETPOOL_H */
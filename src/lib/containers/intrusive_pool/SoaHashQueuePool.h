@@ -0,0 +1,511 @@
+#ifndef INTRUSIVEPOOL_SOAHASHQUEUEPOOL_H
+#define INTRUSIVEPOOL_SOAHASHQUEUEPOOL_H
+
+#include "../../../intrusive/HashMap.h"
+
+#include <bits/allocator.h>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+namespace intrusive {
+
+/**
+ * A HashQueuePool with the structure-of-arrays node storage.
+ * A node is an index into the arrays of the pool instead of an object:
+ * - the key array keeps the keys with the 32-bit links of the bucket chains, so a lookup scans it only;
+ * - the link array keeps the 32-bit links of the queue and of the free list;
+ * - the value array keeps the values, a value is touched when it is accessed through an iterator only.
+ * The buckets are the 32-bit heads of the chains, so there are no pointers in the storage at all
+ * and the overhead is 12 bytes per node plus 4 bytes per bucket.
+ * The capacity must be less than NIL.
+ *
+ * There are no pointers in the arrays, so the pool can be attached to an image in a file mapping
+ * (see memory::MappedStorage) and resumed by another process.
+ *
+ * @tparam A - the allocator of the arrays, it is rebound to every array type.
+ */
+template<
+	typename K,
+	typename V,
+	typename H = std::hash<K>,
+	typename A = std::allocator<uint32_t>
+>
+class SoaHashQueuePool {
+	friend class TestSoaHashQueuePool;
+
+public:
+	using Key_t = K;
+	using Value_t = V;
+
+	static constexpr uint32_t NIL = ~uint32_t(0);
+	static constexpr size_t IMAGE_ALIGN = 64; // of the arrays in an image, see attach()
+
+private:
+	static constexpr uint32_t FREED = NIL - 1; // the prev link of a node in the free list
+
+	struct KeySlot {
+		K key;
+		uint32_t next; // the next node of the bucket chain
+	};
+
+	struct Links {
+		uint32_t prev;
+		uint32_t next;
+	};
+
+	/**
+	 * The first block of an image, the arrays follow it.
+	 */
+	struct ImageState {
+		uint64_t capacity;
+		uint64_t buckets;
+		uint64_t size;
+		uint32_t head;
+		uint32_t tail;
+		uint32_t freed;
+		uint32_t reserved;
+	};
+
+	using KeyAllocator_t = typename std::allocator_traits<A>::template rebind_alloc<KeySlot>;
+	using LinksAllocator_t = typename std::allocator_traits<A>::template rebind_alloc<Links>;
+	using ValueAllocator_t = typename std::allocator_traits<A>::template rebind_alloc<V>;
+	using BucketAllocator_t = typename std::allocator_traits<A>::template rebind_alloc<uint32_t>;
+
+	template<typename P, typename T>
+	struct Iterator {
+		friend class SoaHashQueuePool;
+
+		Iterator() noexcept : m_pool(nullptr), m_index(NIL) {}
+
+		Iterator(P* pool, uint32_t index) noexcept : m_pool(pool), m_index(index) {}
+
+		inline bool operator==(const Iterator& it) const noexcept {
+			return m_index == it.m_index;
+		}
+
+		inline bool operator!=(const Iterator& it) const noexcept {
+			return m_index != it.m_index;
+		}
+
+		inline operator bool() const noexcept {
+			return m_index != NIL;
+		}
+
+		inline const K& key() const noexcept {
+			return m_pool->m_keys[m_index].key;
+		}
+
+		inline T& value() const noexcept {
+			return m_pool->m_values[m_index];
+		}
+
+		/**
+		 * @return the index of the node in the storage.
+		 */
+		inline uint32_t index() const noexcept {
+			return m_index;
+		}
+
+	private:
+		P* m_pool;
+		uint32_t m_index;
+	};
+
+	const size_t m_capacity;
+	const size_t m_buckets_size;
+	const size_t m_mask; // m_buckets_size - 1 for a power of two, 0 otherwise
+	KeySlot* m_keys;
+	Links* m_links;
+	V* m_values;
+	uint32_t* m_buckets;
+	uint32_t m_head; // the queue
+	uint32_t m_tail;
+	uint32_t m_freed; // the free list is chained with the next links
+	size_t m_size;
+	ImageState* m_image; // the arrays are not allocated if the pool is attached to an image
+	H m_hasher;
+	KeyAllocator_t m_key_allocator;
+	LinksAllocator_t m_links_allocator;
+	ValueAllocator_t m_value_allocator;
+	BucketAllocator_t m_bucket_allocator;
+
+public:
+	using Iterator_t = Iterator<SoaHashQueuePool, V>;
+	using ConstIterator_t = Iterator<const SoaHashQueuePool, const V>;
+
+	/**
+	 * @param capacity - amount of nodes.
+	 * @param load_factor - average amount of nodes per bucket.
+	 * @param sizing - HashMapSizing::POW2 rounds the buckets up to a power of two to index them with a mask.
+	 */
+	SoaHashQueuePool(unsigned capacity, float load_factor, HashMapSizing sizing = HashMapSizing::EXACT) noexcept
+		: m_capacity(capacity)
+		, m_buckets_size(bucket_count(size_t(capacity / load_factor) + 1, sizing))
+		, m_mask((m_buckets_size & (m_buckets_size - 1)) == 0 ? m_buckets_size - 1 : 0)
+		, m_keys(nullptr)
+		, m_links(nullptr)
+		, m_values(nullptr)
+		, m_buckets(nullptr)
+		, m_head(NIL)
+		, m_tail(NIL)
+		, m_freed(NIL)
+		, m_size(0)
+		, m_image(nullptr)
+		, m_hasher()
+		, m_key_allocator()
+		, m_links_allocator()
+		, m_value_allocator()
+		, m_bucket_allocator() {}
+
+	SoaHashQueuePool(const SoaHashQueuePool&) = delete;
+	SoaHashQueuePool& operator=(const SoaHashQueuePool&) = delete;
+
+	SoaHashQueuePool(SoaHashQueuePool&& rv) = delete;
+	SoaHashQueuePool& operator=(SoaHashQueuePool&&) = delete;
+
+	virtual ~SoaHashQueuePool() noexcept {
+		destroy();
+	}
+
+	/**
+	 * Allocate the arrays.
+	 * @return 0 - if the storage has been allocated successfully.
+	 */
+	int allocate() noexcept {
+		if(m_keys || m_capacity >= FREED)
+			return -1;
+
+		m_keys = m_key_allocator.allocate(m_capacity);
+		m_links = m_links_allocator.allocate(m_capacity);
+		m_values = m_value_allocator.allocate(m_capacity);
+		m_buckets = m_bucket_allocator.allocate(m_buckets_size);
+		if(m_keys == nullptr || m_links == nullptr || m_values == nullptr || m_buckets == nullptr) {
+			release();
+			return -1;
+		}
+
+		for(size_t i = 0; i < m_capacity; i++) {
+			m_key_allocator.construct(m_keys + i);
+			m_value_allocator.construct(m_values + i);
+		}
+		reset();
+		return 0;
+	}
+
+	/**
+	 * @return the bytes of an image of the pool, see attach().
+	 */
+	inline size_t image_bytes() const noexcept {
+		return image_layout().bytes;
+	}
+
+	/**
+	 * Place the arrays to an external image instead of allocating them, e.g. to MappedStorage::data().
+	 * The image keeps the whole state of the pool once sync_image() has been called (the destructor calls it).
+	 * @param image - image_bytes() bytes aligned to IMAGE_ALIGN. MUST NOT be NULL.
+	 * @param resume - true takes the state of the image (e.g. MappedStorage::OPEN_RESUMED), false resets it.
+	 * @return 0 - if the pool has been attached, -1 if the image is too small or its geometry differs.
+	 */
+	int attach(void* image, size_t bytes, bool resume) noexcept {
+		static_assert(std::is_trivially_copyable<K>::value, "An image needs trivially copyable keys.");
+		static_assert(std::is_trivially_copyable<V>::value, "An image needs trivially copyable values.");
+		if(m_keys || m_capacity >= FREED || image == nullptr || bytes < image_bytes())
+			return -1;
+
+		ImageState* state = static_cast<ImageState*>(image);
+		if(resume && (state->capacity != m_capacity || state->buckets != m_buckets_size))
+			return -1;
+
+		const ImageLayout layout = image_layout();
+		uint8_t* base = static_cast<uint8_t*>(image);
+		m_image = state;
+		m_keys = reinterpret_cast<KeySlot*>(base + layout.keys);
+		m_links = reinterpret_cast<Links*>(base + layout.links);
+		m_values = reinterpret_cast<V*>(base + layout.values);
+		m_buckets = reinterpret_cast<uint32_t*>(base + layout.buckets);
+		if(resume) {
+			m_head = state->head;
+			m_tail = state->tail;
+			m_freed = state->freed;
+			m_size = state->size;
+		} else {
+			for(size_t i = 0; i < m_capacity; i++) {
+				m_key_allocator.construct(m_keys + i);
+				m_value_allocator.construct(m_values + i);
+			}
+			reset();
+			sync_image();
+		}
+		return 0;
+	}
+
+	/**
+	 * Write the queue state to the image, it must be called before the image is synced.
+	 */
+	void sync_image() noexcept {
+		if(m_image) {
+			m_image->capacity = m_capacity;
+			m_image->buckets = m_buckets_size;
+			m_image->size = m_size;
+			m_image->head = m_head;
+			m_image->tail = m_tail;
+			m_image->freed = m_freed;
+			m_image->reserved = 0;
+		}
+	}
+
+	inline Iterator_t end() noexcept {
+		return Iterator_t();
+	}
+
+	inline ConstIterator_t cend() const noexcept {
+		return ConstIterator_t();
+	}
+
+	Iterator_t push_back(const Key_t& key) noexcept {
+		if(m_freed == NIL)
+			return end();
+
+		const uint32_t index = m_freed;
+		m_freed = m_links[index].next;
+		link_map(index, key, bucket_of(key));
+		link_tail(index);
+		return Iterator_t(this, index);
+	}
+
+	/**
+	 * Find the first node of the key or push a new one back if there is none, with a single bucket walk.
+	 * @param inserted - true if a new node has been pushed.
+	 * @return end() - if the key is missed and the pool is full.
+	 */
+	Iterator_t find_or_insert(const Key_t& key, bool& inserted) noexcept {
+		const size_t bucket = bucket_of(key);
+		const uint32_t found = find_in(bucket, key);
+		inserted = found == NIL && m_freed != NIL;
+		if(not inserted) {
+			return Iterator_t(this, found);
+		}
+
+		const uint32_t index = m_freed;
+		m_freed = m_links[index].next;
+		link_map(index, key, bucket);
+		link_tail(index);
+		return Iterator_t(this, index);
+	}
+
+	inline Iterator_t peek_front() noexcept {
+		return Iterator_t(this, m_head);
+	}
+
+	Iterator_t pop_front() noexcept {
+		const uint32_t index = m_head;
+		if(index != NIL) {
+			release_node(index);
+		}
+		return Iterator_t(this, index);
+	}
+
+	inline ConstIterator_t find(const Key_t& key) const noexcept {
+		return ConstIterator_t(this, find_in(bucket_of(key), key));
+	}
+
+	inline Iterator_t find(const Key_t& key) noexcept {
+		return Iterator_t(this, find_in(bucket_of(key), key));
+	}
+
+	inline void move_back(Iterator_t it) noexcept {
+		unlink_list(it.m_index);
+		link_tail(it.m_index);
+	}
+
+	/**
+	 * The value of a removed node stays valid until the node is pushed again.
+	 */
+	inline void remove(Iterator_t it) noexcept {
+		release_node(it.m_index);
+	}
+
+	void reset() noexcept {
+		for(size_t i = 0; i < m_buckets_size; i++) {
+			m_buckets[i] = NIL;
+		}
+		m_head = m_tail = NIL;
+		m_size = 0;
+		m_freed = NIL;
+		for(size_t i = m_capacity; i-- > 0;) {
+			push_freed(uint32_t(i));
+		}
+	}
+
+	inline size_t capacity() const noexcept {
+		return m_capacity;
+	}
+
+	inline size_t size() const noexcept {
+		return m_size;
+	}
+
+	inline size_t available() const noexcept {
+		return m_capacity - m_size;
+	}
+
+	inline size_t buckets() const noexcept {
+		return m_buckets_size;
+	}
+
+	inline size_t storage_bytes() const noexcept {
+		return m_capacity * (sizeof(KeySlot) + sizeof(Links) + sizeof(V)) + m_buckets_size * sizeof(uint32_t);
+	}
+
+private:
+
+	static inline size_t bucket_count(size_t wanted, HashMapSizing sizing) noexcept {
+		size_t result = wanted ? wanted : 1;
+		if(sizing == HashMapSizing::POW2) {
+			size_t pow2 = 1;
+			while(pow2 < result) {
+				pow2 <<= 1;
+			}
+			result = pow2;
+		}
+		return result;
+	}
+
+	static inline constexpr size_t align_image(size_t offset) noexcept {
+		return (offset + IMAGE_ALIGN - 1) / IMAGE_ALIGN * IMAGE_ALIGN;
+	}
+
+	/**
+	 * The offsets of the arrays in an image: the state, the keys, the links, the values and the buckets.
+	 */
+	struct ImageLayout {
+		size_t keys;
+		size_t links;
+		size_t values;
+		size_t buckets;
+		size_t bytes;
+	};
+
+	inline ImageLayout image_layout() const noexcept {
+		ImageLayout result;
+		result.keys = align_image(sizeof(ImageState));
+		result.links = align_image(result.keys + m_capacity * sizeof(KeySlot));
+		result.values = align_image(result.links + m_capacity * sizeof(Links));
+		result.buckets = align_image(result.values + m_capacity * sizeof(V));
+		result.bytes = align_image(result.buckets + m_buckets_size * sizeof(uint32_t));
+		return result;
+	}
+
+	inline size_t bucket_of(const Key_t& key) const noexcept {
+		const size_t hash = m_hasher(key);
+		return m_mask ? (hash & m_mask) : (hash % m_buckets_size);
+	}
+
+	inline uint32_t find_in(size_t bucket, const Key_t& key) const noexcept {
+		uint32_t cur = m_buckets[bucket];
+		while(cur != NIL && not(m_keys[cur].key == key)) {
+			cur = m_keys[cur].next;
+		}
+		return cur;
+	}
+
+	inline void link_map(uint32_t index, const Key_t& key, size_t bucket) noexcept {
+		m_keys[index].key = key;
+		m_keys[index].next = m_buckets[bucket];
+		m_buckets[bucket] = index;
+	}
+
+	inline void unlink_map(uint32_t index) noexcept {
+		uint32_t* cur = m_buckets + bucket_of(m_keys[index].key);
+		while(*cur != index) {
+			cur = &m_keys[*cur].next;
+		}
+		*cur = m_keys[index].next;
+		m_keys[index].next = NIL;
+	}
+
+	inline void link_tail(uint32_t index) noexcept {
+		m_links[index].prev = m_tail;
+		m_links[index].next = NIL;
+		if(m_tail != NIL) {
+			m_links[m_tail].next = index;
+		} else {
+			m_head = index;
+		}
+		m_tail = index;
+		m_size++;
+	}
+
+	inline void unlink_list(uint32_t index) noexcept {
+		assert(m_links[index].prev != FREED);
+		const Links links = m_links[index];
+		if(links.prev != NIL) {
+			m_links[links.prev].next = links.next;
+		} else {
+			m_head = links.next;
+		}
+		if(links.next != NIL) {
+			m_links[links.next].prev = links.prev;
+		} else {
+			m_tail = links.prev;
+		}
+		m_size--;
+	}
+
+	inline void push_freed(uint32_t index) noexcept {
+		m_links[index].prev = FREED;
+		m_links[index].next = m_freed;
+		m_freed = index;
+	}
+
+	inline void release_node(uint32_t index) noexcept {
+		unlink_map(index);
+		unlink_list(index);
+		push_freed(index);
+	}
+
+	void release() noexcept {
+		if(m_keys) {
+			m_key_allocator.deallocate(m_keys, m_capacity);
+		}
+		if(m_links) {
+			m_links_allocator.deallocate(m_links, m_capacity);
+		}
+		if(m_values) {
+			m_value_allocator.deallocate(m_values, m_capacity);
+		}
+		if(m_buckets) {
+			m_bucket_allocator.deallocate(m_buckets, m_buckets_size);
+		}
+		m_keys = nullptr;
+		m_links = nullptr;
+		m_values = nullptr;
+		m_buckets = nullptr;
+	}
+
+	void destroy() noexcept {
+		if(m_image) {
+			sync_image();
+			m_image = nullptr;
+			m_keys = nullptr;
+			m_links = nullptr;
+			m_values = nullptr;
+			m_buckets = nullptr;
+			return;
+		}
+		if(m_keys && m_values) {
+			for(size_t i = 0; i < m_capacity; i++) {
+				m_key_allocator.destroy(m_keys + i);
+				m_value_allocator.destroy(m_values + i);
+			}
+		}
+		release();
+	}
+
+};
+
+}; // namespace intrusive
+
+#endif /* INTRUSIVEPOOL_SOAHASHQUEUEPOOL_H */
@@ -0,0 +1,216 @@
+#ifndef INTRUSIVEPOOL_TESTS_TESTCONCURRENTPOOL_H
+#define INTRUSIVEPOOL_TESTS_TESTCONCURRENTPOOL_H
+
+#include "containers/intrusive_pool/ConcurrentPool.h"
+
+#include <assert.h>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace intrusive {
+
+class TestConcurrentPool {
+
+	using Value_t = long long unsigned;
+	using Node_t = ConcurrentPoolNode<Value_t>;
+	using Pool_t = ConcurrentPool<Node_t>;
+	using Ring_t = SpscRing<>;
+
+	Pool_t m_pool;
+	const size_t m_capacity;
+
+public:
+
+	TestConcurrentPool(unsigned capacity) noexcept : m_pool(capacity), m_capacity(capacity) {
+		assert(m_pool.allocate() == 0);
+	}
+
+	TestConcurrentPool(const TestConcurrentPool&) = delete;
+	TestConcurrentPool(TestConcurrentPool&&) = delete;
+
+	TestConcurrentPool operator=(const TestConcurrentPool&) = delete;
+	TestConcurrentPool operator=(TestConcurrentPool&&) = delete;
+
+	~TestConcurrentPool() {}
+
+	void test() noexcept {
+		printf("<TestConcurrentPool>...\n");
+		printf("capacity=%zu\n", m_capacity);
+		printf("storage_bytes=%.2f Kb\n", m_pool.storage_bytes() / 1024.0);
+
+		unsigned step = 1;
+		test_acquire_release(step++);
+		test_reset(step++);
+		test_ring(step++);
+		test_mpmc(step++);
+		test_handoff(step++);
+	}
+
+	void test_acquire_release(unsigned step) {
+		printf("-> test_acquire_release(step=%u)\n", step);
+		assert(m_pool.available() == m_capacity);
+
+		std::vector<Node_t*> nodes;
+		for(size_t i = 0; i < m_capacity; i++) {
+			Node_t* node = m_pool.acquire();
+			assert(node);
+			assert(m_pool.at(m_pool.index(node)) == node);
+			node->value = i;
+			nodes.push_back(node);
+		}
+		assert(m_pool.available() == 0);
+		assert(m_pool.acquire() == nullptr);
+
+		for(size_t i = 0; i < m_capacity; i++) {
+			assert(nodes[i]->value == i);
+			for(size_t j = i + 1; j < m_capacity; j++) {
+				assert(nodes[i] != nodes[j]);
+			}
+		}
+
+		// LIFO order
+		m_pool.release(nodes[0]);
+		m_pool.release(nodes[1]);
+		assert(m_pool.available() == 2);
+		assert(m_pool.acquire() == nodes[1]);
+		assert(m_pool.acquire() == nodes[0]);
+
+		for(Node_t* node : nodes) {
+			m_pool.release(node);
+		}
+		assert(m_pool.available() == m_capacity);
+	}
+
+	void test_reset(unsigned step) {
+		printf("-> test_reset(step=%u)\n", step);
+		for(size_t i = 0; i < m_capacity / 2; i++) {
+			assert(m_pool.acquire());
+		}
+		assert(m_pool.available() == m_capacity - m_capacity / 2);
+
+		m_pool.reset();
+		assert(m_pool.available() == m_capacity);
+		for(size_t i = 0; i < m_capacity; i++) {
+			assert(m_pool.acquire() == m_pool.at(uint32_t(i)));
+		}
+		assert(m_pool.acquire() == nullptr);
+		m_pool.reset();
+	}
+
+	void test_ring(unsigned step) {
+		printf("-> test_ring(step=%u)\n", step);
+		Ring_t ring(m_capacity - 1);
+		assert(ring.allocate() == 0);
+		assert(ring.capacity() >= m_capacity - 1);
+		assert((ring.capacity() & (ring.capacity() - 1)) == 0);
+
+		uint32_t index = 0;
+		assert(not ring.pop(index));
+		for(uint32_t i = 0; i < ring.capacity(); i++) {
+			assert(ring.push(i));
+		}
+		assert(not ring.push(0));
+		assert(ring.size() == ring.capacity());
+
+		// wrap around
+		for(uint32_t round = 0; round < 3; round++) {
+			for(uint32_t i = 0; i < ring.capacity(); i++) {
+				assert(ring.pop(index));
+				assert(index == i);
+				assert(ring.push(i));
+			}
+		}
+		for(uint32_t i = 0; i < ring.capacity(); i++) {
+			assert(ring.pop(index));
+			assert(index == i);
+		}
+		assert(not ring.pop(index));
+		assert(ring.size() == 0);
+	}
+
+	/**
+	 * The threads acquire and release the nodes concurrently, a node must never be owned twice.
+	 */
+	void test_mpmc(unsigned step) {
+		printf("-> test_mpmc(step=%u)\n", step);
+		const unsigned threads = 4;
+		const unsigned rounds = 20000;
+		std::vector<std::thread> workers;
+		for(unsigned t = 0; t < threads; t++) {
+			workers.emplace_back([this, t, rounds]() {
+				const Value_t mark = Value_t(t + 1) << 32;
+				for(unsigned i = 0; i < rounds; i++) {
+					Node_t* node = m_pool.acquire();
+					if(node == nullptr) {
+						std::this_thread::yield();
+						continue;
+					}
+					node->value = mark | i;
+					std::this_thread::yield();
+					assert(node->value == (mark | i));
+					m_pool.release(node);
+				}
+			});
+		}
+		for(std::thread& worker : workers) {
+			worker.join();
+		}
+		assert(m_pool.available() == m_capacity);
+
+		// the free list is consistent
+		std::vector<bool> seen(m_capacity, false);
+		for(size_t i = 0; i < m_capacity; i++) {
+			Node_t* node = m_pool.acquire();
+			assert(node);
+			assert(not seen[m_pool.index(node)]);
+			seen[m_pool.index(node)] = true;
+		}
+		assert(m_pool.acquire() == nullptr);
+		m_pool.reset();
+	}
+
+	/**
+	 * The producer fills the nodes and hands their indices to the consumer which releases them.
+	 */
+	void test_handoff(unsigned step) {
+		printf("-> test_handoff(step=%u)\n", step);
+		const Value_t count = 100000;
+		Ring_t ring(m_capacity / 2);
+		assert(ring.allocate() == 0);
+
+		std::thread producer([this, &ring, count]() {
+			for(Value_t i = 0; i < count; i++) {
+				Node_t* node;
+				while((node = m_pool.acquire()) == nullptr) {
+					std::this_thread::yield();
+				}
+				node->value = i;
+				while(not ring.push(m_pool.index(node))) {
+					std::this_thread::yield();
+				}
+			}
+		});
+
+		Value_t expected = 0;
+		while(expected < count) {
+			uint32_t index;
+			if(not ring.pop(index)) {
+				std::this_thread::yield();
+				continue;
+			}
+			Node_t* node = m_pool.at(index);
+			assert(node->value == expected);
+			expected++;
+			m_pool.release(node);
+		}
+		producer.join();
+		assert(ring.size() == 0);
+		assert(m_pool.available() == m_capacity);
+	}
+
+};
+
+}; // namespace intrusive
+
+#endif /* INTRUSIVEPOOL_TESTS_TESTCONCURRENTPOOL_H */
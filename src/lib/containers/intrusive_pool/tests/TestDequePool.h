@@ -5,9 +5,15 @@
 
 #include <assert.h>
 #include <iostream>
+#include <vector>
 
 namespace intrusive {
 
+/**
+ * @tparam N - the node template, DequePoolNode or CompactDequePoolNode.
+ * @tparam L - the list template of the node hook.
+ */
+template<template<typename> class N = DequePoolNode, template<typename> class L = LinkedList>
 class TestDequePool {
 
 	template<typename T>
@@ -29,8 +35,8 @@ class TestDequePool {
 
 	using Value_t = StructValue<long long unsigned>;
 
-	using Node_t = DequePoolNode<Value_t>;
-	using LinkedPool_t = DequePool<Node_t>;
+	using Node_t = N<Value_t>;
+	using LinkedPool_t = DequePool<Node_t, std::allocator<Node_t>, L<Node_t> >;
 
 	LinkedPool_t m_pool;
 	const size_t m_capacity;
@@ -66,6 +72,7 @@ public:
 		test_push_remove(step++);
 		test_reset(step++);
 		test_iterators(step++);
+		test_bulk(step++);
 	}
 
 	void test_push_back_pop_front(unsigned step) {
@@ -230,6 +237,11 @@ public:
 		m_pool.reset();
 
 		assert(m_pool.size() == 0);
+		// the free list is LIFO, reset() pushes the nodes to it in the storage order
+		if(m_capacity) {
+			assert(m_pool.push_back().get() == m_pool.storage() + m_capacity - 1);
+			m_pool.pop_back();
+		}
 		test_sanity();
 	}
 
@@ -320,64 +332,131 @@ public:
 
 private:
 
+	void test_bulk(unsigned step) {
+		printf("-> test_bulk()\n");
+		assert(m_pool.size() == 0);
+		using Iterator_t = typename LinkedPool_t::Iterator_t;
+		std::vector<Iterator_t> out(m_capacity + 1);
+
+		// a burst in the middle of the free list and a burst of all the free nodes
+		const size_t burst = m_capacity / 4 + 1;
+		assert(m_pool.push_back_bulk(0, out.data()) == 0);
+		assert(m_pool.push_back_bulk(burst, out.data()) == burst);
+		for(size_t i = 0; i < burst; i++) {
+			assert(out[i]->linked());
+			out[i]->value = i * step;
+		}
+		assert(m_pool.size() == burst);
+		assert(m_pool.push_back_bulk(m_capacity, out.data()) == m_capacity - burst);
+		for(size_t i = 0; i < m_capacity - burst; i++) {
+			out[i]->value = (burst + i) * step;
+		}
+		assert(m_pool.size() == m_capacity);
+		assert(m_pool.available() == 0);
+		assert(m_pool.push_back_bulk(1, out.data()) == 0);
+		oversize_one();
+
+		size_t index = 0;
+		for(auto& elem : m_pool) {
+			assert(elem.value == index * step);
+			index++;
+		}
+		assert(index == m_capacity);
+
+		// the popped nodes are in the queue order
+		assert(m_pool.pop_front_bulk(burst, out.data()) == burst);
+		for(size_t i = 0; i < burst; i++) {
+			assert(out[i]->value == i * step);
+		}
+		assert(m_pool.size() == m_capacity - burst);
+		assert(m_pool.available() == burst);
+		peek_front_one(burst * step);
+
+		// the pushed nodes follow the remaining ones
+		assert(m_pool.push_back_bulk(burst, out.data()) == burst);
+		for(size_t i = 0; i < burst; i++) {
+			out[i]->value = (m_capacity + i) * step;
+		}
+		assert(m_pool.pop_front_bulk(m_capacity + 1, out.data()) == m_capacity);
+		for(size_t i = 0; i < m_capacity; i++) {
+			assert(out[i]->value == (burst + i) * step);
+		}
+		assert(m_pool.pop_front_bulk(1, out.data()) == 0);
+
+		assert(m_pool.size() == 0);
+		assert(m_pool.available() == m_capacity);
+		test_sanity();
+
+		// the single node operations see a consistent free list
+		for(size_t i = 0; i < m_capacity; i++) {
+			push_front_one(i * step);
+		}
+		oversize_one();
+		for(size_t i = 0; i < m_capacity; i++) {
+			pop_back_one(i * step);
+		}
+		assert(m_pool.size() == 0);
+		test_sanity();
+	}
+
 	void push_back_one(const Value_t& value) noexcept {
 		auto it = m_pool.push_back();
 		assert(it != m_pool.end());
 		it->value = value;
-		assert(it->il_linked);
+		assert(it->linked());
 	}
 
 	void push_front_one(const Value_t& value) noexcept {
 		auto it = m_pool.push_front();
 		assert(it != m_pool.end());
 		it->value = value;
-		assert(it->il_linked);
+		assert(it->linked());
 	}
 
 	void peek_front_one(const Value_t& value) noexcept {
 		auto it = m_pool.begin();
 		assert(it != m_pool.end());
 		it->value = value;
-		assert(it->il_linked);
+		assert(it->linked());
 	}
 
 	void peek_back_one(const Value_t& value) noexcept {
 		auto it = m_pool.rbegin();
 		assert(it != m_pool.rend());
 		it->value = value;
-		assert(it->il_linked);
+		assert(it->linked());
 	}
 
 	void pop_front_one(const Value_t& value) noexcept {
 		auto it = m_pool.pop_front();
 		assert(it != m_pool.end());
 		it->value = value;
-		assert(it->il_linked);
+		assert(it->linked());
 	}
 
 	void pop_back_one(const Value_t& value) noexcept {
 		auto it = m_pool.pop_back();
 		assert(it != m_pool.end());
 		it->value = value;
-		assert(it->il_linked);
+		assert(it->linked());
 	}
 
 	void remove_front_one(const Value_t& value) noexcept {
 		auto it = m_pool.begin();
 		assert(it != m_pool.end());
 		it->value = value;
-		assert(it->il_linked);
+		assert(it->linked());
 		m_pool.remove(it);
-		assert(it->il_linked);
+		assert(it->linked());
 	}
 
 	void remove_back_one(const Value_t& value) noexcept {
 		auto it = m_pool.rbegin();
 		assert(it != m_pool.rend());
 		it->value = value;
-		assert(it->il_linked);
+		assert(it->linked());
 		m_pool.remove(it);
-		assert(it->il_linked);
+		assert(it->linked());
 	}
 
 	void oversize_one() noexcept {
@@ -389,7 +468,7 @@ private:
 
 	void test_sanity() {
 		for(unsigned i = 0; i < m_capacity; i++) {
-			assert(m_pool.m_storage[i].il_linked);
+			assert(m_pool.m_storage[i].linked());
 		}
 	}
 
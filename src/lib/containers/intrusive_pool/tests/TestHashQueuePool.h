@@ -5,6 +5,7 @@
 
 #include <assert.h>
 #include <iostream>
+#include <vector>
 
 namespace intrusive {
 
@@ -38,8 +39,8 @@ class TestHashQueuePool {
 
 public:
 
-	TestHashQueuePool(unsigned capacity, float load_factor) noexcept
-		: m_pool(capacity, load_factor), m_capacity(capacity) {
+	TestHashQueuePool(unsigned capacity, float load_factor, HashMapSizing sizing = HashMapSizing::EXACT) noexcept
+		: m_pool(capacity, load_factor, sizing), m_capacity(capacity) {
 		assert(m_pool.allocate() == 0);
 	}
 
@@ -58,7 +59,7 @@ public:
 		printf("sizeof(Node_t)=%zu\n", sizeof(Node_t));
 		printf("sizeof(Pool_t::Bucket_t)=%zu\n", sizeof(Pool_t::Bucket_t));
 		printf("capacity=%zu\n", m_capacity);
-		printf("buckets=%zu\n", m_pool.m_map.buckets());
+		printf("buckets=%zu%s\n", m_pool.m_map.buckets(), m_pool.m_map.masked() ? " (masked)" : "");
 		printf("memory used %.2f Kb\n", mem_used / 1024);
 
 		unsigned step = 1;
@@ -66,8 +67,13 @@ public:
 		test_push_pop_same_key(step++);
 		test_push_remove(step++);
 		test_push_remove_same_key(step++);
+		test_find_or_insert(step++);
+		test_insert_bulk(step++);
 
 		test_clear(step++);
+		test_resize_map(step++);
+		test_metrics(step++);
+		test_line_bucket(step++);
 	}
 
 	void test_push_pop(unsigned step) {
@@ -216,6 +222,79 @@ public:
 		test_sanity();
 	}
 
+	void test_find_or_insert(unsigned step) {
+		printf("-> test_find_or_insert()\n");
+		assert(m_pool.size() == 0);
+
+		bool inserted = false;
+		for(size_t i = 0; i < m_capacity; i++) {
+			auto it = m_pool.find_or_insert(i * step, inserted);
+			assert(it != m_pool.end());
+			assert(inserted);
+			it->value = i + step;
+			it = m_pool.find_or_insert(i * step, inserted);
+			assert(it != m_pool.end());
+			assert(not inserted);
+			assert(it->value == i + step);
+		}
+		assert(m_pool.size() == m_capacity);
+
+		// the found keys keep their places, the missed ones don't fit
+		assert(m_pool.find_or_insert(m_capacity * step + 1, inserted) == m_pool.end());
+		assert(not inserted);
+		for(size_t i = 0; i < m_capacity; i++) {
+			assert(m_pool.find_or_insert(i * step, inserted) != m_pool.end());
+			assert(not inserted);
+		}
+		for(size_t i = 0; i < m_capacity; i++) {
+			pop_front_one(i * step, i + step);
+			miss_one(i * step);
+		}
+
+		assert(m_pool.size() == 0);
+		test_sanity();
+	}
+
+	void test_insert_bulk(unsigned step) {
+		printf("-> test_insert_bulk()\n");
+		assert(m_pool.size() == 0);
+
+		std::vector<Key_t> keys;
+		for(size_t i = 0; i <= m_capacity; i++) {
+			keys.push_back(i * step);
+		}
+		std::vector<Pool_t::Iterator_t> out(keys.size());
+
+		const size_t burst = m_capacity / 4 + 1;
+		assert(m_pool.insert_bulk(keys.data(), 0, out.data()) == 0);
+		assert(m_pool.insert_bulk(keys.data(), burst, out.data()) == burst);
+		// the last key doesn't fit
+		assert(m_pool.insert_bulk(keys.data() + burst, keys.size() - burst, out.data() + burst) == m_capacity - burst);
+		assert(out[m_capacity] == m_pool.end());
+		for(size_t i = 0; i < m_capacity; i++) {
+			assert(out[i] != m_pool.end());
+			assert(out[i]->im_key == keys[i]);
+			assert(out[i]->im_linked);
+			out[i]->value = i + step;
+		}
+		assert(m_pool.size() == m_capacity);
+		assert(m_pool.available() == 0);
+		miss_one(keys[m_capacity]);
+
+		// the queue keeps the order of the keys
+		for(size_t i = 0; i < m_capacity; i++) {
+			find_one(keys[i], i + step);
+		}
+		for(size_t i = 0; i < m_capacity; i++) {
+			peek_front_one(keys[i], i + step);
+			pop_front_one(keys[i], i + step);
+			miss_one(keys[i]);
+		}
+
+		assert(m_pool.size() == 0);
+		test_sanity();
+	}
+
 	void test_clear(unsigned step) {
 		printf("-> test_clear()\n");
 		for(size_t i = 0; i < m_capacity; i++) {
@@ -231,6 +310,96 @@ public:
 		test_sanity();
 	}
 
+	void test_resize_map(unsigned step) {
+		printf("-> test_resize_map()\n");
+		const size_t buckets = m_pool.m_map.buckets();
+		for(size_t i = 0; i < m_capacity; i++) {
+			push_back(i * step, i + step);
+		}
+		m_pool.set_migrate_budget(1);
+		assert(m_pool.resize_map(buckets * 2, HashMapSizing::POW2));
+		assert(m_pool.map_migrating());
+		for(size_t i = 0; i < m_capacity; i++) {
+			find_one(i * step, i + step);
+			pop_front_one(i * step, i + step);
+			miss_one(i * step);
+		}
+		assert(not m_pool.map_migrating());
+		assert(m_pool.resize_map(buckets));
+		assert(not m_pool.map_migrating());
+		m_pool.set_migrate_budget(2);
+
+		assert(m_pool.size() == 0);
+		test_sanity();
+	}
+
+	void test_metrics(unsigned step) {
+		printf("-> test_metrics()\n");
+		const HashQueuePoolMetrics& metrics = m_pool.metrics();
+		const uint64_t lookups = metrics.map.lookups.load();
+		const uint64_t hits = metrics.map.hits.load();
+		const uint64_t evicted = metrics.evicted.load();
+		const uint64_t dropped = metrics.dropped.load();
+		for(size_t i = 0; i < m_capacity; i++) {
+			push_back(i * step, i + step);
+		}
+		push_back_oversize(step);
+		for(size_t i = 0; i < m_capacity; i++) {
+			find_one(i * step, i + step);
+		}
+		miss_one(m_capacity * step);
+
+		utils::Log2Histogram chains;
+		m_pool.chains(chains);
+		assert(chains.count() == m_pool.m_map.buckets());
+		assert(chains.sum == m_capacity);
+
+		for(size_t i = 0; i < m_capacity; i++) {
+			pop_front_one(i * step, i + step);
+		}
+		const uint64_t factor = utils::Metrics::ENABLED ? 1 : 0;
+		assert(metrics.map.lookups.load() - lookups == (m_capacity + 1) * factor);
+		assert(metrics.map.hits.load() - hits == m_capacity * factor);
+		assert(metrics.evicted.load() - evicted == m_capacity * factor);
+		assert(metrics.dropped.load() - dropped == factor);
+
+		assert(m_pool.size() == 0);
+		test_sanity();
+	}
+
+	/**
+	 * The open-addressing layout holds SLOTS * buckets keys, a push it refuses takes no node.
+	 */
+	void test_line_bucket(unsigned step) {
+		printf("-> test_line_bucket()\n");
+		using LineBucket_t = HashMapLineBucket<Node_t>;
+		using LinePool_t = HashQueuePool<Node_t, std::hash<Key_t>, std::allocator<Node_t>, std::allocator<LineBucket_t> >;
+		LinePool_t pool(m_capacity, 16.0f);
+		assert(pool.allocate() == 0);
+		const size_t slots = pool.m_map.buckets() * LineBucket_t::SLOTS;
+		assert(slots < m_capacity);
+
+		const uint64_t dropped = pool.metrics().dropped.load();
+		size_t pushed = 0;
+		for(size_t i = 0; i < m_capacity; i++) {
+			auto it = pool.push_back(i * step);
+			if(it != pool.end()) {
+				assert(it->im_key == i * step && it->im_linked);
+				pushed++;
+			}
+		}
+		assert(pushed == slots && pool.size() == slots);
+		assert(pool.available() == m_capacity - slots);
+		if(utils::Metrics::ENABLED) {
+			assert(pool.metrics().dropped.load() - dropped == m_capacity - slots);
+		}
+		for(size_t i = 0; i < slots; i++) {
+			auto it = pool.pop_front();
+			assert(it != pool.end() && not it->im_linked);
+		}
+		assert(pool.size() == 0 && pool.pop_front() == pool.end());
+	}
+
 	void dump() {
 		std::cout << "map has " << m_pool.m_map.size() << " elements \n";
 		for(size_t bucket = 0; bucket < m_pool.m_map.buckets(); ++bucket) {
@@ -0,0 +1,176 @@
+#ifndef INTRUSIVEPOOL_TESTS_TESTPACKETPOOL_H
+#define INTRUSIVEPOOL_TESTS_TESTPACKETPOOL_H
+
+#include "containers/intrusive_pool/PacketPool.h"
+
+#include <assert.h>
+#include <iostream>
+#include <vector>
+
+namespace intrusive {
+
+class TestPacketPool {
+
+	using Pool_t = PacketPool<256, 64>;
+	using Packet_t = Pool_t::Packet_t;
+
+	Pool_t m_pool;
+	const size_t m_capacity;
+
+public:
+
+	TestPacketPool(unsigned capacity) noexcept
+		: m_pool(capacity), m_capacity(capacity) {
+		assert(m_pool.allocate() == 0);
+	}
+
+	TestPacketPool(const TestPacketPool&) = delete;
+	TestPacketPool(TestPacketPool&&) = delete;
+
+	TestPacketPool operator=(const TestPacketPool&) = delete;
+	TestPacketPool operator=(TestPacketPool&&) = delete;
+
+	~TestPacketPool() {}
+
+	void test() noexcept {
+		printf("<TestPacketPool>...\n");
+		printf("sizeof(Packet_t)=%zu\n", sizeof(Packet_t));
+		printf("capacity=%zu\n", m_capacity);
+		printf("memory used %.2f Kb\n", m_pool.storage_bytes() / (float) 1024.0);
+
+		unsigned step = 1;
+		test_alloc_free(step++);
+		test_headroom(step++);
+		test_clone_copy(step++);
+		test_bulk(step++);
+		test_index(step++);
+	}
+
+	void test_alloc_free(unsigned step) noexcept {
+		printf("-> test_alloc_free(step=%u)\n", step);
+		std::vector<Packet_t*> pkts;
+		for(size_t i = 0; i < m_capacity; i++) {
+			Packet_t* pkt = m_pool.alloc();
+			assert(pkt != nullptr);
+			assert(reinterpret_cast<uintptr_t>(pkt->buffer) % 64 == 0);
+			assert(pkt->refcnt == 1 && pkt->headroom() == 64 && pkt->length == 0);
+			pkts.push_back(pkt);
+		}
+		assert(m_pool.alloc() == nullptr);
+		assert(m_pool.size() == m_capacity && m_pool.available() == 0);
+		assert(m_pool.stat().failed == 1);
+
+		// the last freed packet is allocated first
+		m_pool.free(pkts[3]);
+		assert(m_pool.alloc() == pkts[3]);
+		for(Packet_t* pkt : pkts) {
+			m_pool.free(pkt);
+		}
+		assert(m_pool.size() == 0 && m_pool.available() == m_capacity);
+
+		const uint8_t data[150] = {1, 2, 3};
+		assert(m_pool.alloc(data, 256 - 64 + 1) == nullptr);
+		Packet_t* pkt = m_pool.alloc(data, sizeof(data));
+		assert(pkt != nullptr && pkt->length == sizeof(data));
+		assert(memcmp(pkt->data(), data, sizeof(data)) == 0);
+		m_pool.free(pkt);
+		check_empty();
+	}
+
+	void test_headroom(unsigned step) noexcept {
+		printf("-> test_headroom(step=%u)\n", step);
+		const uint8_t data[100] = {0xAA};
+		Packet_t* pkt = m_pool.alloc(data, sizeof(data));
+
+		proto::RwMFrame frame = pkt->frame();
+		assert(frame.available() == sizeof(data));
+		assert(frame.head() == pkt->data() && frame.head()[0] == 0xAA);
+		frame.head_move_back(4);
+		frame.write(uint32_t(0x11223344));
+		frame.head_move_back(4);
+		pkt->update(frame);
+		assert(pkt->headroom() == 60 && pkt->length == sizeof(data) + 4);
+		assert(pkt->data()[4] == 0xAA);
+
+		assert(pkt->prepend(61) == nullptr);
+		assert(pkt->prepend(60) == pkt->buffer);
+		assert(pkt->headroom() == 0 && pkt->length == sizeof(data) + 64);
+		assert(pkt->adj(64) && pkt->data()[0] == 0xAA);
+		assert(pkt->tailroom() == 256 - 64 - sizeof(data));
+		assert(pkt->append(pkt->tailroom() + 1) == nullptr);
+		assert(pkt->append(10) == pkt->data() + sizeof(data));
+		assert(pkt->trim(10) && pkt->length == sizeof(data));
+		assert(not pkt->trim(sizeof(data) + 1));
+
+		const Packet_t* ro = pkt;
+		assert(ro->frame().available() == sizeof(data) && ro->frame().offset() == 64);
+		m_pool.free(pkt);
+		check_empty();
+	}
+
+	void test_clone_copy(unsigned step) noexcept {
+		printf("-> test_clone_copy(step=%u)\n", step);
+		const uint8_t data[60] = {7, 7, 7};
+		Packet_t* pkt = m_pool.alloc(data, sizeof(data));
+		Packet_t* mirror = m_pool.clone(pkt);
+		assert(mirror == pkt && pkt->shared());
+		assert(m_pool.size() == 1);
+
+		// the shared packet is copied to be rewritten
+		Packet_t* rw = m_pool.copy(pkt);
+		assert(rw != pkt && not rw->shared());
+		assert(rw->headroom() == pkt->headroom() && rw->length == pkt->length);
+		rw->data()[0] = 8;
+		assert(static_cast<const Packet_t*>(pkt)->data()[0] == 7);
+
+		m_pool.free(pkt);
+		assert(m_pool.size() == 2 && not mirror->shared());
+		m_pool.free(mirror);
+		m_pool.free(rw);
+		assert(m_pool.stat().cloned == 1 && m_pool.stat().copied == 1);
+		check_empty();
+	}
+
+	void test_bulk(unsigned step) noexcept {
+		printf("-> test_bulk(step=%u)\n", step);
+		std::vector<Packet_t*> pkts(m_capacity + 10);
+		const size_t n = m_pool.alloc_bulk(pkts.data(), Pool_t::BURST + 3);
+		assert(n == Pool_t::BURST + 3);
+		for(size_t i = 0; i < n; i++) {
+			assert(pkts[i]->refcnt == 1 && pkts[i]->headroom() == 64);
+		}
+		const size_t rest = m_pool.alloc_bulk(pkts.data() + n, m_capacity + 10 - n);
+		assert(rest == m_capacity - n);
+		assert(m_pool.available() == 0);
+		m_pool.free_bulk(pkts.data(), m_capacity);
+		check_empty();
+	}
+
+	void test_index(unsigned step) noexcept {
+		printf("-> test_index(step=%u)\n", step);
+		Packet_t* a = m_pool.alloc();
+		Packet_t* b = m_pool.alloc();
+		assert(m_pool.owns(a) && m_pool.owns(b));
+		assert(m_pool.at(m_pool.index(a)) == a);
+		assert(m_pool.at(m_pool.index(b)) == b);
+		assert(m_pool.index(a) < m_capacity && m_pool.index(b) < m_capacity);
+		Packet_t other;
+		assert(not m_pool.owns(&other));
+		m_pool.free(a);
+		m_pool.free(b);
+		check_empty();
+	}
+
+private:
+
+	void check_empty() noexcept {
+		assert(m_pool.size() == 0);
+		assert(m_pool.available() == m_capacity);
+		assert(m_pool.stat().allocated == m_pool.stat().freed);
+	}
+
+};
+
+}; // namespace intrusive
+
+#endif /* INTRUSIVEPOOL_TESTS_TESTPACKETPOOL_H */
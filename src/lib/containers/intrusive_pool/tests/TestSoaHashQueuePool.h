@@ -0,0 +1,256 @@
+#ifndef INTRUSIVEPOOL_TESTS_TESTSOAHASHQUEUEPOOL_H
+#define INTRUSIVEPOOL_TESTS_TESTSOAHASHQUEUEPOOL_H
+
+#include "containers/intrusive_pool/SoaHashQueuePool.h"
+#include "containers/intrusive_pool/HashQueuePool.h"
+
+#include <assert.h>
+#include <iostream>
+
+namespace intrusive {
+
+class TestSoaHashQueuePool {
+
+	using Key_t = unsigned;
+	using Value_t = long long unsigned;
+
+	using Pool_t = SoaHashQueuePool<Key_t, Value_t>;
+	using AosPool_t = HashQueuePool<HashQueuePoolNode<Key_t, Value_t> >;
+
+	Pool_t m_pool;
+	const size_t m_capacity;
+	const float m_load_factor;
+
+public:
+
+	TestSoaHashQueuePool(unsigned capacity, float load_factor, HashMapSizing sizing = HashMapSizing::EXACT) noexcept
+		: m_pool(capacity, load_factor, sizing), m_capacity(capacity), m_load_factor(load_factor) {
+		assert(m_pool.allocate() == 0);
+	}
+
+	TestSoaHashQueuePool(const TestSoaHashQueuePool&) = delete;
+	TestSoaHashQueuePool(TestSoaHashQueuePool&&) = delete;
+
+	TestSoaHashQueuePool operator=(const TestSoaHashQueuePool&) = delete;
+	TestSoaHashQueuePool operator=(TestSoaHashQueuePool&&) = delete;
+
+	~TestSoaHashQueuePool() {}
+
+	void test() noexcept {
+		AosPool_t aos(m_capacity, m_load_factor);
+		printf("<TestSoaHashQueuePool>...\n");
+		printf("capacity=%zu\n", m_capacity);
+		printf("buckets=%zu\n", m_pool.buckets());
+		printf("storage_bytes=%.2f Kb (HashQueuePool %.2f Kb)\n",
+		       m_pool.storage_bytes() / 1024.0, aos.storage_bytes() / 1024.0);
+		assert(m_pool.storage_bytes() * 2 <= aos.storage_bytes());
+
+		unsigned step = 1;
+		test_push_pop(step++);
+		test_push_remove(step++);
+		test_move_back(step++);
+		test_find_or_insert(step++);
+		test_clear(step++);
+		test_image(step++);
+	}
+
+	void test_push_pop(unsigned step) {
+		printf("-> test_push_pop()\n");
+		assert(m_pool.size() == 0);
+
+		// test with one item
+		for(size_t i = 0; i < m_capacity * 2; i++) {
+			push_back(i * step, i + step);
+			find_one(i * step, i + step);
+			pop_front_one(i * step, i + step);
+			miss_one(i * step);
+		}
+		test_sanity();
+
+		// test with full capacity
+		for(size_t i = 0; i < m_capacity * 2; i++) {
+			if(i < m_capacity) {
+				push_back(i * step, i + step);
+			} else {
+				assert(m_pool.push_back(i * step) == m_pool.end());
+			}
+		}
+		for(size_t i = 0; i < m_capacity; i++) {
+			find_one(i * step, i + step);
+			assert(m_pool.peek_front().key() == i * step);
+			pop_front_one(i * step, i + step);
+			miss_one(i * step);
+		}
+		test_sanity();
+	}
+
+	void test_push_remove(unsigned step) {
+		printf("-> test_push_remove()\n");
+		assert(m_pool.size() == 0);
+
+		// the keys are removed from the middle of the chains and of the queue
+		for(size_t i = 0; i < m_capacity; i++) {
+			push_back(i * step, i + step);
+		}
+		for(size_t i = 0; i < m_capacity; i += 2) {
+			auto it = m_pool.find(i * step);
+			assert(it != m_pool.end());
+			m_pool.remove(it);
+			miss_one(i * step);
+		}
+		for(size_t i = 1; i < m_capacity; i += 2) {
+			find_one(i * step, i + step);
+			pop_front_one(i * step, i + step);
+		}
+		test_sanity();
+	}
+
+	void test_move_back(unsigned step) {
+		printf("-> test_move_back()\n");
+		assert(m_pool.size() == 0);
+
+		for(size_t i = 0; i < m_capacity; i++) {
+			push_back(i * step, i + step);
+		}
+		for(size_t i = 0; i < m_capacity; i += 2) {
+			m_pool.move_back(m_pool.find(i * step));
+		}
+		for(size_t i = 1; i < m_capacity; i += 2) {
+			pop_front_one(i * step, i + step);
+		}
+		for(size_t i = 0; i < m_capacity; i += 2) {
+			pop_front_one(i * step, i + step);
+		}
+		test_sanity();
+	}
+
+	void test_find_or_insert(unsigned step) {
+		printf("-> test_find_or_insert()\n");
+		assert(m_pool.size() == 0);
+
+		bool inserted = false;
+		for(size_t i = 0; i < m_capacity; i++) {
+			auto it = m_pool.find_or_insert(i * step, inserted);
+			assert(it != m_pool.end());
+			assert(inserted);
+			it.value() = i + step;
+			it = m_pool.find_or_insert(i * step, inserted);
+			assert(not inserted);
+			assert(it.value() == i + step);
+		}
+		assert(m_pool.find_or_insert(m_capacity * step + 1, inserted) == m_pool.end());
+		assert(not inserted);
+		for(size_t i = 0; i < m_capacity; i++) {
+			pop_front_one(i * step, i + step);
+		}
+		test_sanity();
+	}
+
+	void test_clear(unsigned step) {
+		printf("-> test_clear()\n");
+		for(size_t i = 0; i < m_capacity; i++) {
+			push_back(i * step, i + step);
+		}
+		m_pool.reset();
+		for(size_t i = 0; i < m_capacity; i++) {
+			miss_one(i * step);
+		}
+		test_sanity();
+	}
+
+	void test_image(unsigned step) {
+		printf("-> test_image()\n");
+		const size_t bytes = Pool_t(m_capacity, m_load_factor).image_bytes();
+		assert(bytes % Pool_t::IMAGE_ALIGN == 0);
+		assert(bytes >= Pool_t(m_capacity, m_load_factor).storage_bytes());
+		uint64_t* image = new uint64_t[bytes / sizeof(uint64_t)];
+		assert(reinterpret_cast<uintptr_t>(image) % sizeof(uint64_t) == 0);
+
+		{
+			Pool_t pool(m_capacity, m_load_factor);
+			assert(pool.attach(image, bytes - 1, false) != 0);
+			assert(pool.attach(image, bytes, false) == 0);
+			assert(pool.allocate() != 0);
+			assert(pool.attach(image, bytes, false) != 0);
+			assert(pool.size() == 0);
+			for(size_t i = 0; i < m_capacity; i++) {
+				auto it = pool.push_back(i * step);
+				assert(it);
+				it.value() = i + step;
+			}
+			for(size_t i = 0; i < m_capacity / 2; i++) {
+				auto it = pool.pop_front();
+				assert(it.key() == i * step);
+			}
+		}
+
+		// another pool takes the state of the image
+		{
+			Pool_t other(m_capacity + 1, m_load_factor);
+			assert(other.attach(image, bytes, true) != 0);
+		}
+		{
+			Pool_t pool(m_capacity, m_load_factor);
+			assert(pool.attach(image, bytes, true) == 0);
+			assert(pool.size() == m_capacity - m_capacity / 2);
+			for(size_t i = 0; i < m_capacity / 2; i++) {
+				assert(pool.find(i * step) == pool.end());
+			}
+			for(size_t i = m_capacity / 2; i < m_capacity; i++) {
+				auto it = pool.find(i * step);
+				assert(it);
+				assert(it.value() == i + step);
+			}
+			for(size_t i = m_capacity / 2; i < m_capacity; i++) {
+				auto it = pool.pop_front();
+				assert(it.key() == i * step);
+			}
+			assert(pool.size() == 0);
+			assert(pool.available() == m_capacity);
+		}
+
+		delete[] image;
+	}
+
+private:
+
+	void push_back(const Key_t& key, const Value_t& value) noexcept {
+		auto it = m_pool.push_back(key);
+		assert(it != m_pool.end());
+		it.value() = value;
+		assert(it.key() == key);
+	}
+
+	void pop_front_one(const Key_t& key, const Value_t& value) noexcept {
+		auto it = m_pool.pop_front();
+		assert(it != m_pool.end());
+		assert(it.key() == key);
+		assert(it.value() == value);
+	}
+
+	void find_one(const Key_t& key, const Value_t& value) noexcept {
+		const Pool_t& pool = m_pool;
+		auto it = pool.find(key);
+		assert(it != pool.cend());
+		assert(it.key() == key);
+		assert(it.value() == value);
+	}
+
+	void miss_one(const Key_t& key) noexcept {
+		assert(m_pool.find(key) == m_pool.end());
+	}
+
+	void test_sanity() {
+		assert(m_pool.size() == 0);
+		assert(m_pool.available() == m_capacity);
+		assert(m_pool.peek_front() == m_pool.end());
+		for(size_t i = 0; i < m_pool.buckets(); i++) {
+			assert(m_pool.m_buckets[i] == Pool_t::NIL);
+		}
+	}
+
+};
+
+}; // namespace intrusive
+
+#endif /* INTRUSIVEPOOL_TESTS_TESTSOAHASHQUEUEPOOL_H */
@@ -6,6 +6,9 @@
 
 #include "TestHashQueuePool.h"
 #include "TestDequePool.h"
+#include "TestSoaHashQueuePool.h"
+#include "TestConcurrentPool.h"
+#include "TestPacketPool.h"
 
 using namespace intrusive;
 
@@ -16,10 +19,14 @@ int main_intrusive_pool(int, char**) {
 	float load_factor_one = 0.7f;
 	float load_factor_two = 2.0f;
 
-	TestDequePool deque_pool(storage_size);
+	TestDequePool<> deque_pool(storage_size);
 	deque_pool.test();
 	std::cout << "\n";
 
+	TestDequePool<CompactDequePoolNode, CompactList> compact_deque_pool(storage_size);
+	compact_deque_pool.test();
+	std::cout << "\n";
+
 	TestHashQueuePool linked_hash_pool_first(storage_size, load_factor_one);
 	linked_hash_pool_first.test();
 	std::cout << "\n";
@@ -28,6 +35,26 @@ int main_intrusive_pool(int, char**) {
 	linked_hash_pool_second.test();
 	std::cout << "\n";
 
+	TestHashQueuePool linked_hash_pool_pow2(storage_size, load_factor_one, HashMapSizing::POW2);
+	linked_hash_pool_pow2.test();
+	std::cout << "\n";
+
+	TestSoaHashQueuePool soa_hash_pool_first(storage_size, load_factor_one);
+	soa_hash_pool_first.test();
+	std::cout << "\n";
+
+	TestSoaHashQueuePool soa_hash_pool_pow2(storage_size, load_factor_two, HashMapSizing::POW2);
+	soa_hash_pool_pow2.test();
+	std::cout << "\n";
+
+	TestConcurrentPool concurrent_pool(storage_size);
+	concurrent_pool.test();
+	std::cout << "\n";
+
+	TestPacketPool packet_pool(storage_size);
+	packet_pool.test();
+	std::cout << "\n";
+
 	std::cout << "<---- the end of main_intrusive_pool() ---->\n";
 	return 0;
 }
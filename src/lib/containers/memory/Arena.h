@@ -0,0 +1,247 @@
+#ifndef MEMORY_ARENA_H
+#define MEMORY_ARENA_H
+
+#include "PageAllocator.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+namespace memory {
+
+/**
+ * A monotonic (bump pointer) arena for the short-lived tables, e.g. the scratch pools of a burst or a job:
+ * an allocation is an aligned bump of the offset, a deallocation is free unless it is the last allocation,
+ * which is rolled back, and reset() frees everything at once.
+ * The memory is a buffer of the caller (e.g. on the stack) or a mapping of its own by allocate(),
+ * huge pages are requested for the mappings as Page::map() does.
+ * An arena is used by one thread, ArenaAllocator takes the arena of the Scope of the calling thread.
+ *
+ * Using sample:
+ * memory::Arena arena(64 << 20);
+ * if(arena.allocate()) {...}
+ * for(;;) {
+ *     {
+ *         memory::Arena::Scope scope(arena);
+ *         Pool_t pool(capacity, 0.7f); // SA and BA are ArenaAllocator
+ *         pool.allocate();
+ *         ...
+ *     }
+ *     arena.reset();
+ * }
+ */
+class Arena {
+	uint8_t* m_begin;
+	size_t m_capacity;
+	size_t m_used;
+	size_t m_high_water; // the most bytes used since the arena has been created
+	uint64_t m_failures; // the allocations which haven't fit
+	size_t m_page; // the page of the mapping, 0 - the buffer of the caller
+
+public:
+
+	/**
+	 * The arena of a buffer of the caller, the buffer outlives the arena.
+	 */
+	Arena(void* buffer, size_t bytes) noexcept
+		: m_begin(static_cast<uint8_t*>(buffer))
+		, m_capacity(bytes)
+		, m_used(0)
+		, m_high_water(0)
+		, m_failures(0)
+		, m_page(0) {}
+
+	/**
+	 * The arena of a mapping which is made by allocate().
+	 * @param page - the page size, see Page::map().
+	 */
+	Arena(size_t bytes, size_t page = Page::SIZE_2M) noexcept
+		: m_begin(nullptr)
+		, m_capacity(Page::round_up(bytes, page))
+		, m_used(0)
+		, m_high_water(0)
+		, m_failures(0)
+		, m_page(page) {}
+
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+
+	Arena(Arena&&) = delete;
+	Arena& operator=(Arena&&) = delete;
+
+	virtual ~Arena() noexcept {
+		if(m_page && m_begin) {
+			Page::unmap(m_begin, m_capacity);
+			m_begin = nullptr;
+		}
+	}
+
+	/**
+	 * Map the memory of the arena.
+	 * @return 0 - if the memory has been mapped successfully.
+	 */
+	int allocate() noexcept {
+		if(m_begin || m_page == 0)
+			return -1;
+
+		m_begin = static_cast<uint8_t*>(Page::map(m_capacity, m_page));
+		return m_begin ? 0 : -1;
+	}
+
+	/**
+	 * @param align - a power of two.
+	 * @return nullptr - if the arena is exhausted.
+	 */
+	inline void* take(size_t bytes, size_t align) noexcept {
+		const uintptr_t base = reinterpret_cast<uintptr_t>(m_begin);
+		const size_t offset = size_t(((base + m_used + align - 1) & ~uintptr_t(align - 1)) - base);
+		if(m_begin == nullptr || offset > m_capacity || bytes > m_capacity - offset) {
+			m_failures++;
+			return nullptr;
+		}
+		m_used = offset + bytes;
+		if(m_used > m_high_water) {
+			m_high_water = m_used;
+		}
+		return m_begin + offset;
+	}
+
+	/**
+	 * Roll the last allocation back, the other ones are kept until reset().
+	 */
+	inline void give_back(void* ptr, size_t bytes) noexcept {
+		if(static_cast<uint8_t*>(ptr) + bytes == m_begin + m_used) {
+			m_used -= bytes;
+		}
+	}
+
+	/**
+	 * Free all the allocations, the objects in the arena must have been destroyed.
+	 */
+	inline void reset() noexcept {
+		m_used = 0;
+	}
+
+	inline size_t used() const noexcept {
+		return m_used;
+	}
+
+	inline size_t capacity() const noexcept {
+		return m_capacity;
+	}
+
+	inline size_t high_water() const noexcept {
+		return m_high_water;
+	}
+
+	inline uint64_t failures() const noexcept {
+		return m_failures;
+	}
+
+	/**
+	 * @return the arena of the innermost Scope of the calling thread, nullptr - if there is none.
+	 */
+	static inline Arena* current() noexcept {
+		return current_ref();
+	}
+
+	/**
+	 * Make an arena the current one of the calling thread, the previous one is restored by the destructor.
+	 */
+	class Scope {
+		Arena* m_previous;
+
+	public:
+		explicit Scope(Arena& arena) noexcept : m_previous(current_ref()) {
+			current_ref() = &arena;
+		}
+
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+		~Scope() noexcept {
+			current_ref() = m_previous;
+		}
+	};
+
+private:
+
+	static inline Arena*& current_ref() noexcept {
+		static thread_local Arena* current = nullptr;
+		return current;
+	}
+
+};
+
+/**
+ * The allocator of an Arena, usable as the storage/bucket allocator of the pools (SA, BA of HashQueuePool,
+ * A of HashMap): the pools default construct their allocators, so the allocator takes Arena::current()
+ * when it is constructed, the pool is constructed in the Scope of its arena and it may be used outside of it.
+ * The arrays of a cache line or more are cache line aligned, as the buckets of HashMap want.
+ * allocate() returns nullptr as the other allocators of the pools do when the arena is exhausted or
+ * there is no arena, the standard containers need an arena which is big enough.
+ */
+template<typename T>
+struct ArenaAllocator {
+	using value_type = T;
+	using pointer = T*;
+	using const_pointer = const T*;
+	using size_type = size_t;
+	using difference_type = ptrdiff_t;
+
+	template<typename U>
+	struct rebind {
+		using other = ArenaAllocator<U>;
+	};
+
+	Arena* arena;
+
+	ArenaAllocator() noexcept : arena(Arena::current()) {}
+
+	explicit ArenaAllocator(Arena& arena_) noexcept : arena(&arena_) {}
+
+	template<typename U>
+	ArenaAllocator(const ArenaAllocator<U>& other) noexcept : arena(other.arena) {}
+
+	/**
+	 * @return nullptr - if the arena is exhausted.
+	 */
+	T* allocate(size_t n) noexcept {
+		if(arena == nullptr)
+			return nullptr;
+
+		const size_t bytes = n * sizeof(T);
+		const size_t align = bytes >= Page::CACHE_LINE && alignof(T) < Page::CACHE_LINE ? Page::CACHE_LINE : alignof(T);
+		return static_cast<T*>(arena->take(bytes, align));
+	}
+
+	void deallocate(T* ptr, size_t n) noexcept {
+		if(ptr && arena) {
+			arena->give_back(ptr, n * sizeof(T));
+		}
+	}
+
+	template<typename... Args>
+	void construct(T* ptr, Args&& ... args) noexcept {
+		::new(static_cast<void*>(ptr)) T(std::forward<Args>(args)...);
+	}
+
+	void destroy(T* ptr) noexcept {
+		ptr->~T();
+	}
+
+	template<typename U>
+	bool operator==(const ArenaAllocator<U>& other) const noexcept {
+		return arena == other.arena;
+	}
+
+	template<typename U>
+	bool operator!=(const ArenaAllocator<U>& other) const noexcept {
+		return arena != other.arena;
+	}
+};
+
+}; // namespace memory
+
+#endif /* MEMORY_ARENA_H */
@@ -0,0 +1,205 @@
+#ifndef MEMORY_MAPPEDSTORAGE_H
+#define MEMORY_MAPPEDSTORAGE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace memory {
+
+/**
+ * A storage which is kept in a file between the runs of a process, so a restarted process resumes with warm state
+ * (e.g. the chunks of BitArrayT or the image of SoaHashQueuePool) by a single mmap().
+ * The file starts with a page of the versioned header, the storage follows it page aligned.
+ * The header keeps the storage geometry and the checksum of the storage which is written by sync(),
+ * a storage which has not been synced since it was opened (e.g. the process has crashed) is never resumed.
+ * The storage must keep no pointers, only offsets and indices are valid after a restart.
+ */
+class MappedStorage {
+public:
+	static constexpr uint64_t MAGIC = 0x45524f545350414dull; // "MAPSTORE"
+	static constexpr uint32_t VERSION = 1;
+	static constexpr size_t HEADER_BYTES = 4096;
+
+	static constexpr int OPEN_FAILED = -1;
+	static constexpr int OPEN_CREATED = 0; // the storage is zeroed or it must be initialized
+	static constexpr int OPEN_RESUMED = 1; // the storage keeps the state of the last sync()
+
+	struct Header {
+		uint64_t magic;
+		uint32_t version;
+		uint32_t width; // e.g. the item width of BitArrayT or the node size of a pool
+		uint64_t capacity; // e.g. amount of items or nodes
+		uint64_t bytes; // the storage size
+		uint64_t checksum; // of the storage, valid if 'clean' is set
+		uint32_t clean;
+		uint32_t reserved;
+	};
+
+private:
+	int m_fd;
+	void* m_mapping;
+	size_t m_bytes;
+
+public:
+
+	MappedStorage() noexcept : m_fd(-1), m_mapping(nullptr), m_bytes(0) {}
+
+	MappedStorage(const MappedStorage&) = delete;
+	MappedStorage& operator=(const MappedStorage&) = delete;
+
+	MappedStorage(MappedStorage&&) = delete;
+	MappedStorage& operator=(MappedStorage&&) = delete;
+
+	virtual ~MappedStorage() noexcept {
+		close();
+	}
+
+	/**
+	 * Map the file 'path' with a storage of 'bytes' bytes, the file is created if it is missed.
+	 * A file of other version or geometry is recreated zeroed, a file with a wrong checksum keeps its content
+	 * but it is reported as OPEN_CREATED as well.
+	 * @param verify - false skips the checksum verification of a clean storage, e.g. for multi-GB storages.
+	 * @return OPEN_RESUMED, OPEN_CREATED or OPEN_FAILED.
+	 */
+	int open(const char* path, uint32_t width, uint64_t capacity, size_t bytes, bool verify = true) noexcept {
+		if(m_mapping || bytes == 0)
+			return OPEN_FAILED;
+
+		m_fd = ::open(path, O_RDWR | O_CREAT, 0644);
+		if(m_fd < 0)
+			return OPEN_FAILED;
+
+		const size_t file_bytes = HEADER_BYTES + bytes;
+		struct stat st;
+		if(fstat(m_fd, &st) != 0) {
+			close();
+			return OPEN_FAILED;
+		}
+		if(size_t(st.st_size) != file_bytes) {
+			if(ftruncate(m_fd, 0) != 0 || ftruncate(m_fd, off_t(file_bytes)) != 0) {
+				close();
+				return OPEN_FAILED;
+			}
+		}
+
+		void* mapping = mmap(nullptr, file_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+		if(mapping == MAP_FAILED) {
+			close();
+			return OPEN_FAILED;
+		}
+		m_mapping = mapping;
+		m_bytes = bytes;
+
+		Header* header = header_mutable();
+		int result = OPEN_CREATED;
+		if(header->magic == MAGIC && header->version == VERSION && header->width == width
+		   && header->capacity == capacity && header->bytes == bytes) {
+			if(header->clean && (not verify || header->checksum == checksum(data(), bytes)))
+				result = OPEN_RESUMED;
+		} else {
+			memset(data(), 0, bytes);
+		}
+
+		header->magic = MAGIC;
+		header->version = VERSION;
+		header->width = width;
+		header->capacity = capacity;
+		header->bytes = bytes;
+		header->clean = 0;
+		if(msync(m_mapping, HEADER_BYTES, MS_SYNC) != 0) {
+			close();
+			return OPEN_FAILED;
+		}
+		return result;
+	}
+
+	/**
+	 * Write the checksum and flush the storage to the file, the next open() resumes the storage.
+	 * The storage must not be modified concurrently.
+	 * @return 0 - if the storage has been flushed.
+	 */
+	int sync() noexcept {
+		if(m_mapping == nullptr)
+			return -1;
+
+		Header* header = header_mutable();
+		header->clean = 0;
+		if(msync(data(), m_bytes, MS_SYNC) != 0)
+			return -1;
+
+		header->checksum = checksum(data(), m_bytes);
+		header->clean = 1;
+		return msync(m_mapping, HEADER_BYTES, MS_SYNC);
+	}
+
+	/**
+	 * Mark the storage as modified, so a crash before the next sync() drops it.
+	 */
+	inline void touch() noexcept {
+		if(m_mapping) {
+			header_mutable()->clean = 0;
+		}
+	}
+
+	/**
+	 * Unmap the file without sync(), so the storage is not resumed unless it has been synced.
+	 */
+	void close() noexcept {
+		if(m_mapping) {
+			munmap(m_mapping, HEADER_BYTES + m_bytes);
+			m_mapping = nullptr;
+			m_bytes = 0;
+		}
+		if(m_fd >= 0) {
+			::close(m_fd);
+			m_fd = -1;
+		}
+	}
+
+	inline void* data() noexcept {
+		return m_mapping ? static_cast<uint8_t*>(m_mapping) + HEADER_BYTES : nullptr;
+	}
+
+	inline size_t bytes() const noexcept {
+		return m_bytes;
+	}
+
+	inline const Header* header() const noexcept {
+		return static_cast<const Header*>(m_mapping);
+	}
+
+	/**
+	 * FNV-1a over the 64-bit words of the storage and its tail bytes.
+	 */
+	static uint64_t checksum(const void* data, size_t bytes) noexcept {
+		const uint64_t PRIME = 0x100000001b3ull;
+		uint64_t result = 0xcbf29ce484222325ull;
+		const uint8_t* ptr = static_cast<const uint8_t*>(data);
+		for(; bytes >= sizeof(uint64_t); bytes -= sizeof(uint64_t), ptr += sizeof(uint64_t)) {
+			uint64_t word;
+			memcpy(&word, ptr, sizeof(word));
+			result = (result ^ word) * PRIME;
+		}
+		for(; bytes; bytes--, ptr++) {
+			result = (result ^ *ptr) * PRIME;
+		}
+		return result;
+	}
+
+private:
+
+	inline Header* header_mutable() noexcept {
+		return static_cast<Header*>(m_mapping);
+	}
+
+};
+
+}; // namespace memory
+
+#endif /* MEMORY_MAPPEDSTORAGE_H */
@@ -0,0 +1,243 @@
+#ifndef MEMORY_PAGEALLOCATOR_H
+#define MEMORY_PAGEALLOCATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace memory {
+
+/**
+ * The page sizes of the page allocators.
+ */
+struct Page {
+	static constexpr size_t SIZE_4K = size_t(1) << 12;
+	static constexpr size_t SIZE_2M = size_t(1) << 21;
+	static constexpr size_t SIZE_1G = size_t(1) << 30;
+
+	static constexpr size_t CACHE_LINE = 64;
+
+	/**
+	 * Map anonymous memory with 'page' pages.
+	 * The huge pages are taken from the hugetlbfs pool first, the transparent huge pages are requested otherwise.
+	 * @return nullptr - if the memory cannot be mapped.
+	 */
+	static void* map(size_t bytes, size_t page) noexcept {
+		void* result = MAP_FAILED;
+		if(page > SIZE_4K) {
+			result = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | huge_flags(page), -1, 0);
+		}
+		if(result == MAP_FAILED) {
+			result = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if(result == MAP_FAILED)
+				return nullptr;
+#ifdef MADV_HUGEPAGE
+			if(page > SIZE_4K) {
+				madvise(result, bytes, MADV_HUGEPAGE);
+			}
+#endif
+		}
+		return result;
+	}
+
+	static void unmap(void* ptr, size_t bytes) noexcept {
+		munmap(ptr, bytes);
+	}
+
+	/**
+	 * Bind the pages of a mapping to a NUMA node, must be called before the pages are touched.
+	 * @return 0 - if the mapping has been bound.
+	 */
+	static int bind(void* ptr, size_t bytes, unsigned node) noexcept {
+#ifdef SYS_mbind
+		constexpr int MPOL_BIND_MODE = 2; // MPOL_BIND of numaif.h
+		constexpr unsigned long NODES_MAX = sizeof(unsigned long) * 8;
+		if(node >= NODES_MAX)
+			return -1;
+
+		const unsigned long mask = 1ul << node;
+		return int(syscall(SYS_mbind, ptr, bytes, MPOL_BIND_MODE, &mask, NODES_MAX, 0));
+#else
+		(void) ptr;
+		(void) bytes;
+		(void) node;
+		return -1;
+#endif
+	}
+
+	/**
+	 * @return the NUMA node of the calling CPU.
+	 */
+	static unsigned current_node() noexcept {
+		unsigned cpu = 0;
+		unsigned node = 0;
+#ifdef SYS_getcpu
+		if(syscall(SYS_getcpu, &cpu, &node, nullptr) != 0)
+			return 0;
+#endif
+		return node;
+	}
+
+	static inline constexpr size_t round_up(size_t bytes, size_t page) noexcept {
+		return ((bytes + page - 1) / page) * page;
+	}
+
+private:
+
+	static inline int huge_flags(size_t page) noexcept {
+		int flags = 0;
+#ifdef MAP_HUGETLB
+		flags |= MAP_HUGETLB;
+#ifdef MAP_HUGE_SHIFT
+		unsigned shift = 0;
+		while((size_t(1) << shift) < page) {
+			shift++;
+		}
+		flags |= int(shift << MAP_HUGE_SHIFT);
+#endif
+#else
+		(void) page;
+#endif
+		return flags;
+	}
+
+};
+
+/**
+ * The allocator of the huge page mappings, usable as the storage/bucket allocator of the pools.
+ * Every allocation is a mapping of its own rounded up to the page size, so it is page (and cache line) aligned
+ * and it should be used for the big storages only (e.g. multi-GB tables) to remove the TLB misses.
+ * @tparam PAGE - Page::SIZE_2M or Page::SIZE_1G, the pages must be reserved in the hugetlbfs pool,
+ * the transparent huge pages are requested otherwise.
+ */
+template<typename T, size_t PAGE = Page::SIZE_2M>
+struct HugePageAllocator {
+	using value_type = T;
+	using pointer = T*;
+	using const_pointer = const T*;
+	using size_type = size_t;
+	using difference_type = ptrdiff_t;
+
+	template<typename U>
+	struct rebind {
+		using other = HugePageAllocator<U, PAGE>;
+	};
+
+	HugePageAllocator() noexcept = default;
+
+	template<typename U>
+	HugePageAllocator(const HugePageAllocator<U, PAGE>&) noexcept {}
+
+	/**
+	 * @return nullptr - if the memory cannot be mapped.
+	 */
+	T* allocate(size_t n) noexcept {
+		return static_cast<T*>(Page::map(Page::round_up(n * sizeof(T), PAGE), PAGE));
+	}
+
+	void deallocate(T* ptr, size_t n) noexcept {
+		if(ptr) {
+			Page::unmap(ptr, Page::round_up(n * sizeof(T), PAGE));
+		}
+	}
+
+	template<typename... Args>
+	void construct(T* ptr, Args&& ... args) noexcept {
+		::new(static_cast<void*>(ptr)) T(std::forward<Args>(args)...);
+	}
+
+	void destroy(T* ptr) noexcept {
+		ptr->~T();
+	}
+
+	bool operator==(const HugePageAllocator&) const noexcept {
+		return true;
+	}
+
+	bool operator!=(const HugePageAllocator&) const noexcept {
+		return false;
+	}
+};
+
+/**
+ * The allocator of the mappings which are bound to a NUMA node, usable as the storage/bucket allocator of the pools.
+ * The allocations are page aligned as with HugePageAllocator.
+ * @tparam NODE - the NUMA node, CURRENT_NODE takes the node of the CPU which allocates,
+ * so a pool of a worker should be allocated on the worker thread.
+ * @tparam PAGE - the page size, Page::SIZE_4K uses the regular pages only.
+ */
+template<typename T, unsigned NODE = ~0u, size_t PAGE = Page::SIZE_2M>
+struct NumaAllocator {
+	using value_type = T;
+	using pointer = T*;
+	using const_pointer = const T*;
+	using size_type = size_t;
+	using difference_type = ptrdiff_t;
+
+	static constexpr unsigned CURRENT_NODE = ~0u;
+
+	template<typename U>
+	struct rebind {
+		using other = NumaAllocator<U, NODE, PAGE>;
+	};
+
+	NumaAllocator() noexcept = default;
+
+	template<typename U>
+	NumaAllocator(const NumaAllocator<U, NODE, PAGE>&) noexcept {}
+
+	/**
+	 * The memory is not bound if the kernel has no NUMA support, it is placed by the first touch then.
+	 * @return nullptr - if the memory cannot be mapped.
+	 */
+	T* allocate(size_t n) noexcept {
+		const size_t page = page_of(n);
+		const size_t bytes = Page::round_up(n * sizeof(T), page);
+		void* result = Page::map(bytes, page);
+		if(result) {
+			Page::bind(result, bytes, NODE == CURRENT_NODE ? Page::current_node() : NODE);
+		}
+		return static_cast<T*>(result);
+	}
+
+	void deallocate(T* ptr, size_t n) noexcept {
+		if(ptr) {
+			Page::unmap(ptr, Page::round_up(n * sizeof(T), page_of(n)));
+		}
+	}
+
+	template<typename... Args>
+	void construct(T* ptr, Args&& ... args) noexcept {
+		::new(static_cast<void*>(ptr)) T(std::forward<Args>(args)...);
+	}
+
+	void destroy(T* ptr) noexcept {
+		ptr->~T();
+	}
+
+	bool operator==(const NumaAllocator&) const noexcept {
+		return true;
+	}
+
+	bool operator!=(const NumaAllocator&) const noexcept {
+		return false;
+	}
+
+private:
+
+	/**
+	 * The allocations smaller than a huge page take the regular pages.
+	 */
+	static inline size_t page_of(size_t n) noexcept {
+		return n * sizeof(T) >= PAGE ? PAGE : Page::SIZE_4K;
+	}
+};
+
+}; // namespace memory
+
+#endif /* MEMORY_PAGEALLOCATOR_H */
@@ -0,0 +1,155 @@
+#ifndef MEMORY_TESTS_TESTARENA_H
+#define MEMORY_TESTS_TESTARENA_H
+
+#include "containers/memory/Arena.h"
+#include "containers/intrusive_pool/HashQueuePool.h"
+
+#include <assert.h>
+#include <iostream>
+
+namespace memory {
+
+class TestArena {
+
+	using Key_t = unsigned;
+	using Value_t = uint64_t;
+
+	using Node_t = intrusive::HashQueuePoolNode<Key_t, Value_t>;
+	using Bucket_t = intrusive::HashMapBucket<Node_t>;
+
+	using Pool_t = intrusive::HashQueuePool<
+		Node_t, std::hash<Key_t>, ArenaAllocator<Node_t>, ArenaAllocator<Bucket_t> >;
+
+	const size_t m_capacity;
+
+public:
+
+	TestArena(unsigned capacity) noexcept
+		: m_capacity(capacity) {}
+
+	TestArena(const TestArena&) = delete;
+	TestArena(TestArena&&) = delete;
+
+	TestArena operator=(const TestArena&) = delete;
+	TestArena operator=(TestArena&&) = delete;
+
+	~TestArena() {}
+
+	void test() noexcept {
+		printf("<TestArena>...\n");
+		printf("capacity=%zu\n", m_capacity);
+
+		unsigned step = 1;
+		test_bump(step++);
+		test_scope(step++);
+		test_pool(step++);
+	}
+
+	/**
+	 * A stack buffer: the alignment, the rollback of the last allocation, the exhaustion and reset().
+	 */
+	void test_bump(unsigned step) noexcept {
+		printf("-> test_bump(step=%u)\n", step);
+
+		alignas(64) uint8_t buffer[1024];
+		Arena arena(buffer, sizeof(buffer));
+		assert(arena.allocate() != 0); // the buffer of the caller is not mapped
+		ArenaAllocator<uint8_t> bytes(arena);
+		ArenaAllocator<Value_t> values(bytes);
+		assert(values == bytes);
+
+		uint8_t* byte = bytes.allocate(3);
+		assert(byte == buffer);
+		Value_t* small = values.allocate(2); // 16 bytes, aligned to the value
+		assert(uintptr_t(small) % alignof(Value_t) == 0 && small == reinterpret_cast<Value_t*>(buffer + 8));
+		Value_t* big = values.allocate(16); // 128 bytes, aligned to the cache line
+		assert(uintptr_t(big) % Page::CACHE_LINE == 0);
+		assert(arena.used() == 64 + 128);
+
+		values.deallocate(big, 16); // the last one is rolled back
+		assert(arena.used() == 64);
+		values.deallocate(small, 2); // not the last one
+		assert(arena.used() == 64);
+
+		assert(values.allocate(1024) == nullptr);
+		assert(arena.failures() == 1);
+		assert(values.allocate(120) != nullptr); // the rest of the buffer
+		assert(arena.used() == sizeof(buffer));
+		assert(bytes.allocate(1) == nullptr);
+		assert(arena.high_water() == sizeof(buffer));
+
+		arena.reset();
+		assert(arena.used() == 0);
+		assert(bytes.allocate(1) == buffer);
+	}
+
+	/**
+	 * The allocators take the arena of the innermost scope of the thread.
+	 */
+	void test_scope(unsigned step) noexcept {
+		printf("-> test_scope(step=%u)\n", step);
+
+		assert(Arena::current() == nullptr);
+		assert(ArenaAllocator<Value_t>().allocate(1) == nullptr);
+		Value_t outer_buffer[8];
+		Value_t inner_buffer[8];
+		Arena outer(outer_buffer, sizeof(outer_buffer));
+		Arena inner(inner_buffer, sizeof(inner_buffer));
+		{
+			Arena::Scope outer_scope(outer);
+			assert(Arena::current() == &outer);
+			{
+				Arena::Scope inner_scope(inner);
+				assert(ArenaAllocator<Value_t>().allocate(1) == inner_buffer);
+			}
+			ArenaAllocator<Value_t> allocator;
+			assert(allocator.arena == &outer);
+			assert(allocator.allocate(1) == outer_buffer);
+			assert(allocator != ArenaAllocator<Value_t>(inner));
+		}
+		assert(Arena::current() == nullptr);
+	}
+
+	/**
+	 * A pool of a mapped arena is built, dropped and built again after reset().
+	 */
+	void test_pool(unsigned step) noexcept {
+		printf("-> test_pool(step=%u)\n", step);
+
+		const size_t bytes = m_capacity * (sizeof(Node_t) + 2 * sizeof(Bucket_t)) + 2 * Page::SIZE_4K;
+		Arena arena(bytes, Page::SIZE_4K);
+		assert(arena.allocate() == 0);
+		assert(arena.allocate() != 0);
+		for(unsigned round = 0; round < 3; round++) {
+			{
+				Arena::Scope scope(arena);
+				Pool_t pool(unsigned(m_capacity), 0.7f);
+				assert(pool.allocate() == 0);
+				for(size_t i = 0; i < m_capacity; i++) {
+					auto it = pool.push_back(Key_t(i));
+					assert(it != pool.end());
+					it->value = i + round;
+				}
+				for(size_t i = 0; i < m_capacity; i++) {
+					auto it = pool.find(Key_t(i));
+					assert(it != pool.end());
+					assert(it->value == i + round);
+				}
+				assert(arena.used() >= m_capacity * sizeof(Node_t));
+			}
+			arena.reset();
+		}
+		assert(arena.failures() == 0);
+
+		// a pool which doesn't fit fails to allocate
+		Arena::Scope scope(arena);
+		Pool_t pool(unsigned(m_capacity * 4), 0.7f);
+		assert(pool.allocate() != 0);
+		assert(arena.failures() != 0);
+	}
+
+};
+
+}; // namespace memory
+
+#endif /* MEMORY_TESTS_TESTARENA_H */
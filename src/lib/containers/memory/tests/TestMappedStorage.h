@@ -0,0 +1,170 @@
+#ifndef MEMORY_TESTS_TESTMAPPEDSTORAGE_H
+#define MEMORY_TESTS_TESTMAPPEDSTORAGE_H
+
+#include "containers/memory/MappedStorage.h"
+#include "containers/intrusive_pool/SoaHashQueuePool.h"
+#include "containers/BitArrayT.h"
+
+#include <assert.h>
+#include <cstdlib>
+#include <iostream>
+
+namespace memory {
+
+class TestMappedStorage {
+
+	using Key_t = unsigned;
+	using Value_t = uint64_t;
+
+	using Pool_t = intrusive::SoaHashQueuePool<Key_t, Value_t>;
+	using Bits_t = BitArrayT<5>;
+
+	const size_t m_capacity;
+	char m_path[64];
+
+public:
+
+	TestMappedStorage(unsigned capacity) noexcept
+		: m_capacity(capacity), m_path("/tmp/test_mapped_storage.XXXXXX") {
+		const int fd = mkstemp(m_path);
+		assert(fd >= 0);
+		::close(fd);
+	}
+
+	TestMappedStorage(const TestMappedStorage&) = delete;
+	TestMappedStorage(TestMappedStorage&&) = delete;
+
+	TestMappedStorage operator=(const TestMappedStorage&) = delete;
+	TestMappedStorage operator=(TestMappedStorage&&) = delete;
+
+	~TestMappedStorage() {
+		unlink(m_path);
+	}
+
+	void test() noexcept {
+		printf("<TestMappedStorage>...\n");
+		printf("capacity=%zu\n", m_capacity);
+
+		unsigned step = 1;
+		test_open(step++);
+		test_bit_array(step++);
+		test_pool(step++);
+	}
+
+	void test_open(unsigned step) {
+		printf("-> test_open(step=%u)\n", step);
+		const size_t bytes = m_capacity * sizeof(Value_t) + step;
+		{
+			MappedStorage storage;
+			assert(storage.open(m_path, 8, m_capacity, bytes) == MappedStorage::OPEN_CREATED);
+			assert(storage.open(m_path, 8, m_capacity, bytes) == MappedStorage::OPEN_FAILED);
+			assert(storage.bytes() == bytes);
+			assert(reinterpret_cast<uintptr_t>(storage.data()) % 4096 == 0);
+			uint8_t* data = static_cast<uint8_t*>(storage.data());
+			for(size_t i = 0; i < bytes; i++) {
+				assert(data[i] == 0);
+				data[i] = uint8_t(i * step);
+			}
+			assert(storage.sync() == 0);
+			assert(storage.header()->clean);
+		}
+		{
+			MappedStorage storage;
+			assert(storage.open(m_path, 8, m_capacity, bytes) == MappedStorage::OPEN_RESUMED);
+			assert(not storage.header()->clean);
+			const uint8_t* data = static_cast<const uint8_t*>(storage.data());
+			for(size_t i = 0; i < bytes; i++) {
+				assert(data[i] == uint8_t(i * step));
+			}
+			// not synced
+		}
+		{
+			MappedStorage storage;
+			assert(storage.open(m_path, 8, m_capacity, bytes) == MappedStorage::OPEN_CREATED);
+			assert(storage.sync() == 0);
+			static_cast<uint8_t*>(storage.data())[0] ^= 0xff;
+		}
+		{
+			// the checksum differs
+			MappedStorage storage;
+			assert(storage.open(m_path, 8, m_capacity, bytes) == MappedStorage::OPEN_CREATED);
+			assert(storage.sync() == 0);
+		}
+		{
+			// the geometry differs
+			MappedStorage storage;
+			assert(storage.open(m_path, 9, m_capacity, bytes) == MappedStorage::OPEN_CREATED);
+			const uint8_t* data = static_cast<const uint8_t*>(storage.data());
+			for(size_t i = 0; i < bytes; i++) {
+				assert(data[i] == 0);
+			}
+		}
+	}
+
+	void test_bit_array(unsigned step) {
+		printf("-> test_bit_array(step=%u)\n", step);
+		const size_t bytes = (m_capacity * 5 + 63) / 64 * sizeof(BitArrayTChunk_t);
+		{
+			MappedStorage storage;
+			assert(storage.open(m_path, 5, m_capacity, bytes) == MappedStorage::OPEN_CREATED);
+			Bits_t bits;
+			bits.allocate(storage.data(), storage.bytes());
+			assert(bits.items_capacity() >= m_capacity);
+			for(size_t i = 0; i < m_capacity; i++) {
+				bits.store(i, (i + step) % bits.range());
+			}
+			assert(storage.sync() == 0);
+		}
+		{
+			MappedStorage storage;
+			assert(storage.open(m_path, 5, m_capacity, bytes) == MappedStorage::OPEN_RESUMED);
+			Bits_t bits;
+			bits.allocate(storage.data(), storage.bytes());
+			for(size_t i = 0; i < m_capacity; i++) {
+				assert(bits.load(i) == (i + step) % bits.range());
+			}
+		}
+	}
+
+	void test_pool(unsigned step) {
+		printf("-> test_pool(step=%u)\n", step);
+		const float load_factor = 0.7f;
+		const size_t bytes = Pool_t(m_capacity, load_factor).image_bytes();
+		{
+			MappedStorage storage;
+			const int opened = storage.open(m_path, sizeof(Value_t), m_capacity, bytes);
+			assert(opened == MappedStorage::OPEN_CREATED);
+			Pool_t pool(m_capacity, load_factor);
+			assert(pool.attach(storage.data(), storage.bytes(), opened == MappedStorage::OPEN_RESUMED) == 0);
+			for(size_t i = 0; i < m_capacity; i++) {
+				auto it = pool.push_back(Key_t(i * step));
+				assert(it);
+				it.value() = i + step;
+			}
+			pool.sync_image();
+			assert(storage.sync() == 0);
+		}
+		{
+			MappedStorage storage;
+			const int opened = storage.open(m_path, sizeof(Value_t), m_capacity, bytes);
+			assert(opened == MappedStorage::OPEN_RESUMED);
+			Pool_t pool(m_capacity, load_factor);
+			assert(pool.attach(storage.data(), storage.bytes(), opened == MappedStorage::OPEN_RESUMED) == 0);
+			assert(pool.size() == m_capacity);
+			for(size_t i = 0; i < m_capacity; i++) {
+				auto it = pool.find(Key_t(i * step));
+				assert(it);
+				assert(it.value() == i + step);
+			}
+			for(size_t i = 0; i < m_capacity; i++) {
+				assert(pool.pop_front().key() == Key_t(i * step));
+			}
+			assert(pool.size() == 0);
+		}
+	}
+
+};
+
+}; // namespace memory
+
+#endif /* MEMORY_TESTS_TESTMAPPEDSTORAGE_H */
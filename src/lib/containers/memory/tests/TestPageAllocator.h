@@ -0,0 +1,102 @@
+#ifndef MEMORY_TESTS_TESTPAGEALLOCATOR_H
+#define MEMORY_TESTS_TESTPAGEALLOCATOR_H
+
+#include "containers/memory/PageAllocator.h"
+#include "containers/intrusive_pool/HashQueuePool.h"
+
+#include <assert.h>
+#include <iostream>
+
+namespace memory {
+
+class TestPageAllocator {
+
+	using Key_t = unsigned;
+	using Value_t = uint64_t;
+
+	using Node_t = intrusive::HashQueuePoolNode<Key_t, Value_t>;
+	using Bucket_t = intrusive::HashMapBucket<Node_t>;
+
+	using HugePool_t = intrusive::HashQueuePool<
+		Node_t, std::hash<Key_t>, HugePageAllocator<Node_t>, HugePageAllocator<Bucket_t> >;
+	using NumaPool_t = intrusive::HashQueuePool<
+		Node_t, std::hash<Key_t>, NumaAllocator<Node_t>, NumaAllocator<Bucket_t> >;
+	using NodePool_t = intrusive::HashQueuePool<
+		Node_t, std::hash<Key_t>, NumaAllocator<Node_t, 0, Page::SIZE_4K>, NumaAllocator<Bucket_t, 0, Page::SIZE_4K> >;
+
+	const size_t m_capacity;
+
+public:
+
+	TestPageAllocator(unsigned capacity) noexcept
+		: m_capacity(capacity) {}
+
+	TestPageAllocator(const TestPageAllocator&) = delete;
+	TestPageAllocator(TestPageAllocator&&) = delete;
+
+	TestPageAllocator operator=(const TestPageAllocator&) = delete;
+	TestPageAllocator operator=(TestPageAllocator&&) = delete;
+
+	~TestPageAllocator() {}
+
+	void test() noexcept {
+		printf("<TestPageAllocator>...\n");
+		printf("capacity=%zu\n", m_capacity);
+		printf("current_node=%u\n", Page::current_node());
+
+		unsigned step = 1;
+		test_allocate<HugePageAllocator<Value_t> >(step++);
+		test_allocate<NumaAllocator<Value_t> >(step++);
+		test_allocate<NumaAllocator<Value_t, 0, Page::SIZE_4K> >(step++);
+		test_pool<HugePool_t>(step++);
+		test_pool<NumaPool_t>(step++);
+		test_pool<NodePool_t>(step++);
+	}
+
+	template<typename A>
+	void test_allocate(unsigned step) noexcept {
+		printf("-> test_allocate(step=%u)\n", step);
+
+		// the small and the big allocations are aligned and writable
+		A allocator;
+		const size_t sizes[] = {1, m_capacity, Page::SIZE_2M / sizeof(Value_t) + 1};
+		for(size_t size : sizes) {
+			Value_t* values = allocator.allocate(size);
+			assert(values != nullptr);
+			assert(uintptr_t(values) % Page::CACHE_LINE == 0);
+			for(size_t i = 0; i < size; i++) {
+				allocator.construct(values + i, i);
+			}
+			for(size_t i = 0; i < size; i++) {
+				assert(values[i] == i);
+				allocator.destroy(values + i);
+			}
+			allocator.deallocate(values, size);
+		}
+	}
+
+	template<typename P>
+	void test_pool(unsigned step) noexcept {
+		printf("-> test_pool(step=%u)\n", step);
+
+		P pool(m_capacity, 0.7f);
+		assert(pool.allocate() == 0);
+		for(size_t i = 0; i < m_capacity; i++) {
+			auto it = pool.push_back(Key_t(i));
+			assert(it != pool.end());
+			it->value = i;
+		}
+		for(size_t i = 0; i < m_capacity; i++) {
+			auto it = pool.find(Key_t(i));
+			assert(it != pool.end());
+			assert(it->value == i);
+		}
+		pool.reset();
+		assert(pool.size() == 0);
+	}
+
+};
+
+}; // namespace memory
+
+#endif /* MEMORY_TESTS_TESTPAGEALLOCATOR_H */
@@ -0,0 +1,29 @@
+#include <iostream>
+
+#pragma GCC diagnostic ignored "-Wnon-virtual-dtor"
+#pragma GCC diagnostic ignored "-Weffc++"
+
+#include "TestPageAllocator.h"
+#include "TestMappedStorage.h"
+#include "TestArena.h"
+
+int main_memory(int, char**) {
+	//int main(int, char**) {
+
+	unsigned storage_size = 1024 * 64;
+
+	memory::TestPageAllocator page_allocator(storage_size);
+	page_allocator.test();
+	std::cout << "\n";
+
+	memory::TestMappedStorage mapped_storage(storage_size);
+	mapped_storage.test();
+	std::cout << "\n";
+
+	memory::TestArena arena(storage_size);
+	arena.test();
+	std::cout << "\n";
+
+	std::cout << "<---- the end of main_memory() ---->\n";
+	return 0;
+}
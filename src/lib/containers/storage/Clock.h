@@ -0,0 +1,178 @@
+#ifndef STORAGE_CLOCK_H
+#define STORAGE_CLOCK_H
+
+#include <cstdint>
+#include <ctime>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace storage {
+
+/*
+ * The clock sources of TimedQueue and RateLimiter.
+ * A clock counts ticks of its own unit, the containers keep the clock as a member (see their clock()),
+ * so a clock which is set by the caller is set once per burst and not read per packet.
+ *
+ * struct Clock {
+ *     // the current tick
+ *     uint64_t now() noexcept;
+ *     // ticks per second
+ *     uint64_t hz() const noexcept;
+ * };
+ */
+
+/**
+ * CLOCK_MONOTONIC_COARSE in nanoseconds, the resolution is a kernel tick (1-4 ms), it is read from vDSO.
+ */
+struct CoarseClock {
+	inline uint64_t now() noexcept {
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+		return uint64_t(ts.tv_sec) * NSEC_PER_SEC + uint64_t(ts.tv_nsec);
+	}
+
+	inline uint64_t hz() const noexcept {
+		return NSEC_PER_SEC;
+	}
+
+	static constexpr uint64_t NSEC_PER_SEC = 1000000000;
+};
+
+/**
+ * The TSC in cycles, the frequency is calibrated against CLOCK_MONOTONIC once per process.
+ * An invariant TSC is assumed, e.g. as DPDK does with rte_rdtsc().
+ * CLOCK_MONOTONIC nanoseconds are used where there is no TSC.
+ */
+class TscClock {
+	static constexpr unsigned NSEC_SHIFT = 32;
+
+	uint64_t m_hz;
+	uint64_t m_nsec_mult; // nanoseconds per cycle << NSEC_SHIFT
+
+public:
+
+	TscClock() noexcept
+		: m_hz(calibrate())
+		, m_nsec_mult((CoarseClock::NSEC_PER_SEC << NSEC_SHIFT) / m_hz) {}
+
+	inline uint64_t now() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+		return __rdtsc();
+#else
+		return monotonic();
+#endif
+	}
+
+	inline uint64_t hz() const noexcept {
+		return m_hz;
+	}
+
+	/**
+	 * @return the cycles in nanoseconds, the cycles must be less than ~4 seconds worth.
+	 */
+	inline uint64_t nanosec(uint64_t cycles) const noexcept {
+		return (cycles * m_nsec_mult) >> NSEC_SHIFT;
+	}
+
+private:
+
+	static uint64_t monotonic() noexcept {
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return uint64_t(ts.tv_sec) * CoarseClock::NSEC_PER_SEC + uint64_t(ts.tv_nsec);
+	}
+
+	/**
+	 * Count the cycles of ~10 ms, the result is cached.
+	 */
+	static uint64_t calibrate() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+		static const uint64_t hz = []() {
+			const uint64_t nsec_start = monotonic();
+			const uint64_t start = __rdtsc();
+			uint64_t nsec;
+			do {
+				nsec = monotonic();
+			} while(nsec - nsec_start < CoarseClock::NSEC_PER_SEC / 100);
+			const uint64_t cycles = __rdtsc() - start;
+			const uint64_t result = cycles * CoarseClock::NSEC_PER_SEC / (nsec - nsec_start);
+			return result ? result : 1;
+		}();
+		return hz;
+#else
+		return CoarseClock::NSEC_PER_SEC;
+#endif
+	}
+
+};
+
+/**
+ * std::time() in seconds.
+ */
+struct TimeClock {
+	inline uint64_t now() noexcept {
+		return uint64_t(std::time(nullptr));
+	}
+
+	inline uint64_t hz() const noexcept {
+		return 1;
+	}
+};
+
+/**
+ * The time supplied by the caller, e.g. taken once per burst.
+ * @tparam HZ - ticks per second of the caller time.
+ */
+template<uint64_t HZ = 1000000000>
+class BurstClock {
+	uint64_t m_now;
+
+public:
+
+	BurstClock() noexcept : m_now(0) {}
+
+	inline void set(uint64_t now) noexcept {
+		m_now = now;
+	}
+
+	inline uint64_t now() noexcept {
+		return m_now;
+	}
+
+	inline uint64_t hz() const noexcept {
+		return HZ;
+	}
+};
+
+/**
+ * The timestamp of the current frame in nanoseconds, so a replayed capture runs in the capture time.
+ */
+class FrameClock {
+	uint64_t m_now;
+
+public:
+
+	FrameClock() noexcept : m_now(0) {}
+
+	/**
+	 * @param frame - a frame with nanosec(), e.g. pcapwrap::Frame.
+	 */
+	template<typename F>
+	inline void set(const F& frame) noexcept {
+		m_now = frame.nanosec();
+	}
+
+	inline uint64_t now() noexcept {
+		return m_now;
+	}
+
+	inline uint64_t hz() const noexcept {
+		return CoarseClock::NSEC_PER_SEC;
+	}
+};
+
+}; // namespace storage
+
+#endif /* STORAGE_CLOCK_H */
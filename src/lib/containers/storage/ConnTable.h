@@ -0,0 +1,270 @@
+#ifndef STORAGE_CONNTABLE_H
+#define STORAGE_CONNTABLE_H
+
+#include "FlowTable.h"
+#include "TimerWheel.h"
+#include "Clock.h"
+
+#include <cassert>
+#include <cstdint>
+
+namespace storage {
+
+/**
+ * The idle timeouts of ConnTable in milliseconds, the defaults are of nf_conntrack.
+ */
+struct ConnTimeouts {
+	uint32_t tcp[proto::TcpConn::STATES]; // by proto::TcpConn::State
+	uint32_t udp;
+	uint32_t other;
+
+	ConnTimeouts() noexcept : tcp(), udp(30000), other(600000) {
+		tcp[proto::TcpConn::NONE] = 10000;
+		tcp[proto::TcpConn::SYN_SENT] = 120000;
+		tcp[proto::TcpConn::SYN_RECV] = 60000;
+		tcp[proto::TcpConn::ESTABLISHED] = 432000000; // 5 days
+		tcp[proto::TcpConn::FIN_WAIT] = 120000;
+		tcp[proto::TcpConn::TIME_WAIT] = 120000;
+		tcp[proto::TcpConn::CLOSE] = 10000;
+	}
+};
+
+struct ConnTableStat {
+	uint64_t packets; // valid
+	uint64_t conns; // created
+	uint64_t expired;
+	uint64_t invalid; // the TCP packets which are not valid in the state of their connection
+	uint64_t dropped; // the new connections when the table is full
+	uint64_t ignored; // the non IP packets
+
+	ConnTableStat() noexcept : packets(0), conns(0), expired(0), invalid(0), dropped(0), ignored(0) {}
+};
+
+/**
+ * ConnTable tracks the connections for a stateful filter: a packet takes a single probe of its FlowEntry
+ * (keyed by FlowKey::canonical() as in FlowTable), which counts it and advances the proto::TcpConn state inline.
+ * The entries are kept in a TimerWheel and every valid packet reschedules its entry by the timeout of its new
+ * state (ConnTimeouts), so a reset connection goes in seconds and an established one stays for days.
+ * The packets which are not valid in the state don't refresh the entry, a TCP connection is created
+ * by a valid first packet only (a SYN or an ACK of a connection picked up in the middle).
+ * A new connection is dropped when the table is full, as nf_conntrack does.
+ * All the entries are allocated by allocate() and there is no lock, a table is per core.
+ *
+ * Using sample:
+ * bool valid;
+ * const FlowEntry* conn = table.update(frame, pkt, len, valid);
+ * if(not valid) {
+ *     drop...
+ * }
+ * ...
+ * table.expire([](const FlowEntry& conn) { ... });
+ *
+ * @tparam C - the clock source, see Clock.h, at least 1000 ticks per second, the wheel ticks milliseconds.
+ * @tparam H - the hash of FlowKey, it must be symmetric as proto::Crc32cFlowHash and proto::ToeplitzFlowHash are.
+ */
+template<typename C = CoarseClock, typename H = proto::Crc32cFlowHash>
+class ConnTable {
+	friend class TestConnTable;
+
+	using Node_t = TimerWheelNode<proto::FlowKey, FlowEntry>;
+	using Wheel_t = TimerWheel<Node_t, H>;
+	using Iterator_t = typename Wheel_t::Iterator_t;
+
+	Wheel_t m_wheel;
+	const size_t m_capacity;
+	C m_clock;
+	uint64_t m_tick; // clock ticks per millisecond
+	ConnTimeouts m_timeouts;
+	ConnTableStat m_stat;
+
+public:
+
+	/**
+	 * @param capacity - amount of the connections.
+	 */
+	ConnTable(size_t capacity, const ConnTimeouts& timeouts = ConnTimeouts(), float load_factor = 1.0f) noexcept
+		: m_wheel(capacity, load_factor)
+		, m_capacity(capacity)
+		, m_clock()
+		, m_tick(0)
+		, m_timeouts(timeouts)
+		, m_stat() {
+		m_tick = m_clock.hz() / 1000;
+		assert(m_tick > 0);
+	}
+
+	ConnTable(const ConnTable&) = delete;
+	ConnTable& operator=(const ConnTable&) = delete;
+
+	ConnTable(ConnTable&&) = delete;
+	ConnTable& operator=(ConnTable&&) = delete;
+
+	int allocate() noexcept {
+		return m_wheel.allocate();
+	}
+
+	/**
+	 * Count a packet to its connection, the connection is created if it is new.
+	 * @param frame - the frame @flow has been parsed from, the TCP flags are read from it.
+	 * @param flow - the packet or its ParsedPacket::inner.
+	 * @param bytes - the length of the packet to count.
+	 * @param valid - false if the packet is not valid in the state of its connection or it has no connection.
+	 * @return the connection, nullptr - if the packet is not IP, the table is full or the first TCP packet is
+	 * not valid.
+	 */
+	FlowEntry* update(const uint8_t* frame, const proto::ParsedFlow& flow, size_t bytes, bool& valid) noexcept {
+		valid = false;
+		if(flow.ip_version == 0) {
+			m_stat.ignored++;
+			return nullptr;
+		}
+		const proto::FlowKey key = proto::FlowKey::of(flow);
+		const uint64_t now = m_clock.now();
+		const uint64_t tick = now / m_tick;
+		Iterator_t it = m_wheel.find(key.canonical());
+		bool created = false;
+		if(not it) {
+			if(m_wheel.size() == 0) {
+				sync(tick); // the wheel steps tick by tick, an empty one jumps
+			}
+			it = m_wheel.schedule(key.canonical(), 1);
+			if(not it) {
+				m_stat.dropped++;
+				return nullptr;
+			}
+			it->value = FlowEntry();
+			it->value.key = key;
+			it->value.first = now;
+			created = true;
+		}
+
+		FlowEntry& entry = it->value;
+		valid = entry.count(key, flow, frame, bytes, now);
+		if(not valid) {
+			m_stat.invalid++;
+			if(created) {
+				m_wheel.cancel(it);
+				return nullptr;
+			}
+			return &entry;
+		}
+		m_wheel.refresh(it, timeout(entry) + elapsed(tick));
+		m_stat.conns += created;
+		m_stat.packets++;
+		return &entry;
+	}
+
+	/**
+	 * Remove the connections which have timed out, e.g. once per burst.
+	 * @param callback - a functor which takes 'const FlowEntry&', the entry is valid in the callback only.
+	 * @return amount of the expired connections.
+	 */
+	template<typename F>
+	size_t expire(const F& callback) noexcept {
+		const size_t result = m_wheel.expire(m_clock.now() / m_tick, Expirer<F>{callback});
+		m_stat.expired += result;
+		return result;
+	}
+
+	/**
+	 * @return the connection of @key in any direction, the connection is not refreshed, nullptr - if there is no one.
+	 */
+	FlowEntry* find(const proto::FlowKey& key) noexcept {
+		auto it = m_wheel.find(key.canonical());
+		return it ? &it->value : nullptr;
+	}
+
+	/**
+	 * Remove the connection of @key before its timeout.
+	 * @return false - if there is no connection.
+	 */
+	bool remove(const proto::FlowKey& key) noexcept {
+		return bool(m_wheel.remove(key.canonical()));
+	}
+
+	/**
+	 * @return the milliseconds left until the connection of @key expires.
+	 */
+	uint64_t remaining(const proto::FlowKey& key) noexcept {
+		auto it = m_wheel.find(key.canonical());
+		if(not it) {
+			return 0;
+		}
+		const uint64_t left = m_wheel.remaining(it);
+		const uint64_t behind = elapsed(m_clock.now() / m_tick);
+		return left > behind ? left - behind : 0;
+	}
+
+	/**
+	 * @return the clock source, e.g. to set the time of a burst.
+	 */
+	inline C& clock() noexcept {
+		return m_clock;
+	}
+
+	inline const ConnTimeouts& timeouts() const noexcept {
+		return m_timeouts;
+	}
+
+	/**
+	 * @return amount of the connections.
+	 */
+	inline size_t size() const noexcept {
+		return m_wheel.size();
+	}
+
+	inline size_t capacity() const noexcept {
+		return m_capacity;
+	}
+
+	inline const ConnTableStat& stat() const noexcept {
+		return m_stat;
+	}
+
+	inline size_t storage_bytes() noexcept {
+		return m_wheel.storage_bytes();
+	}
+
+private:
+
+	template<typename F>
+	struct Expirer {
+		const F& callback;
+
+		inline void operator()(Node_t& node) const noexcept {
+			callback(const_cast<const FlowEntry&>(node.value));
+		}
+	};
+
+	struct Nothing {
+		inline void operator()(Node_t&) const noexcept {}
+	};
+
+	inline void sync(uint64_t tick) noexcept {
+		m_wheel.expire(tick, Nothing());
+	}
+
+	/**
+	 * @return the ticks since the last expire(), the wheel counts the timeouts since it, so they are
+	 * extended by it to count since the packet.
+	 */
+	inline uint64_t elapsed(uint64_t tick) const noexcept {
+		return tick > m_wheel.now() ? tick - m_wheel.now() : 0;
+	}
+
+	inline uint64_t timeout(const FlowEntry& entry) const noexcept {
+		switch(entry.key.protocol) {
+			case proto::IPv4::PROTO_TCP:
+				return m_timeouts.tcp[entry.tcp.state];
+			case proto::IPv4::PROTO_UDP:
+				return m_timeouts.udp;
+			default:
+				return m_timeouts.other;
+		}
+	}
+
+};
+
+}; // namespace storage
+
+#endif /* STORAGE_CONNTABLE_H */
@@ -0,0 +1,313 @@
+#ifndef STORAGE_CUCKOOFILTER_H
+#define STORAGE_CUCKOOFILTER_H
+
+#include "Sketch.h"
+#include "../../utils/Metrics.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace storage {
+
+struct CuckooFilterMetrics {
+	utils::Counter lookups;
+	utils::Counter negatives; // answered by the filter alone
+	utils::Counter false_positives; // the filter has passed a key which the table has missed
+
+	void write(utils::MetricsWriter& writer) const noexcept {
+		writer.counter("filter_lookups", lookups);
+		writer.counter("filter_negatives", negatives);
+		writer.counter("filter_false_positives", false_positives);
+	}
+};
+
+/**
+ * A cuckoo filter of 16-bit fingerprints in the buckets of 4 slots, a bucket is one uint64_t, so
+ * a key is looked up in two buckets (two cache lines at most) with a SWAR compare of a bucket at once.
+ * Unlike a Bloom filter it supports remove(), so it mirrors a table with deletions and evictions
+ * (see IpTable), a key which has been inserted n times must be removed n times.
+ * The false positive rate is about 8 * load / 2^16 (0.011% at the full load of 90%) and a key takes
+ * 2 bytes / load, the filter never returns a false negative: an insertion which finds no slot after
+ * KICKS_MAX relocations keeps the last fingerprint as the victim and a second one saturates the filter,
+ * which answers true for every key until it is cleared, so the filter is sized for the capacity of its table.
+ * The keys arrive as 64-bit hashes spread with SketchHash::mix(), the bucket is taken from the low bits
+ * and the fingerprint from the high ones.
+ */
+template<typename A = std::allocator<uint64_t> >
+class CuckooFilter {
+	friend class TestCuckooFilter;
+
+public:
+	static constexpr unsigned SLOTS = 4;
+	static constexpr unsigned KICKS_MAX = 500;
+
+private:
+	static constexpr uint64_t LANES = 0x0001000100010001ull;
+	static constexpr uint64_t HIGHS = 0x8000800080008000ull;
+	static constexpr uint64_t LANE_MASK = 0xFFFF;
+
+	const size_t m_bucket_count; // a power of two
+	const size_t m_mask;
+	uint64_t* m_buckets;
+	size_t m_size;
+	uint64_t m_victim_bucket;
+	uint16_t m_victim; // the fingerprint which has found no slot, 0 - none
+	bool m_saturated;
+	uint64_t m_random; // xorshift64 of the relocations
+	A m_allocator;
+	CuckooFilterMetrics* m_metrics;
+
+public:
+
+	/**
+	 * @param capacity - the keys at the load of 90% at most.
+	 */
+	CuckooFilter(size_t capacity) noexcept
+		: m_bucket_count(round_up((capacity * 10 / 9 + SLOTS - 1) / SLOTS))
+		, m_mask(m_bucket_count - 1)
+		, m_buckets(nullptr)
+		, m_size(0)
+		, m_victim_bucket(0)
+		, m_victim(0)
+		, m_saturated(false)
+		, m_random(0x9e3779b97f4a7c15ull)
+		, m_allocator()
+		, m_metrics(nullptr) {}
+
+	CuckooFilter(const CuckooFilter&) = delete;
+	CuckooFilter& operator=(const CuckooFilter&) = delete;
+
+	CuckooFilter(CuckooFilter&&) = delete;
+	CuckooFilter& operator=(CuckooFilter&&) = delete;
+
+	virtual ~CuckooFilter() noexcept {
+		if(m_buckets) {
+			m_allocator.deallocate(m_buckets, m_bucket_count);
+			m_buckets = nullptr;
+		}
+	}
+
+	/**
+	 * @return 0 - if the buckets have been allocated successfully.
+	 */
+	int allocate() noexcept {
+		if(m_buckets)
+			return -1;
+
+		m_buckets = m_allocator.allocate(m_bucket_count);
+		if(m_buckets == nullptr)
+			return -1;
+
+		clear();
+		return 0;
+	}
+
+	void insert_hash(uint64_t hash) noexcept {
+		m_size++;
+		if(m_saturated) {
+			return;
+		}
+		uint16_t fp = fingerprint(hash);
+		size_t bucket = index(hash);
+		if(put(bucket, fp) || put(alt(bucket, fp), fp)) {
+			return;
+		}
+		if(m_victim) {
+			m_saturated = true;
+			return;
+		}
+		if(next_random() & 1) {
+			bucket = alt(bucket, fp);
+		}
+		for(unsigned kick = 0; kick < KICKS_MAX; kick++) {
+			const unsigned shift = unsigned(next_random() & (SLOTS - 1)) * 16;
+			const uint16_t kicked = uint16_t(m_buckets[bucket] >> shift);
+			m_buckets[bucket] = (m_buckets[bucket] & ~(LANE_MASK << shift)) | (uint64_t(fp) << shift);
+			fp = kicked;
+			bucket = alt(bucket, fp);
+			if(put(bucket, fp)) {
+				return;
+			}
+		}
+		m_victim = fp;
+		m_victim_bucket = bucket;
+	}
+
+	/**
+	 * @return false - if the key of @hash has not been inserted, true - if it probably has.
+	 */
+	inline bool contains_hash(uint64_t hash) const noexcept {
+		const uint16_t fp = fingerprint(hash);
+		const size_t bucket = index(hash);
+		const size_t other = alt(bucket, fp);
+		const bool result = has(m_buckets[bucket], fp) || has(m_buckets[other], fp) || m_saturated
+			|| (m_victim == fp && (m_victim_bucket == bucket || m_victim_bucket == other));
+		count_lookup(result);
+		return result;
+	}
+
+	/**
+	 * Remove a fingerprint of the key of @hash, the key must have been inserted.
+	 * @return false - if no fingerprint has been found.
+	 */
+	bool remove_hash(uint64_t hash) noexcept {
+		if(m_size == 0) {
+			return false;
+		}
+		m_size--;
+		if(m_saturated) {
+			if(m_size == 0) {
+				clear();
+			}
+			return true;
+		}
+		const uint16_t fp = fingerprint(hash);
+		const size_t bucket = index(hash);
+		const size_t other = alt(bucket, fp);
+		if(take(bucket, fp) || take(other, fp)) {
+			if(m_victim && (put(m_victim_bucket, m_victim) || put(alt(m_victim_bucket, m_victim), m_victim))) {
+				m_victim = 0;
+			}
+			return true;
+		}
+		if(m_victim == fp && (m_victim_bucket == bucket || m_victim_bucket == other)) {
+			m_victim = 0;
+			return true;
+		}
+		m_size++;
+		return false;
+	}
+
+	inline void prefetch_hash(uint64_t hash) const noexcept {
+		__builtin_prefetch(m_buckets + index(hash));
+		__builtin_prefetch(m_buckets + alt(index(hash), fingerprint(hash)));
+	}
+
+	/**
+	 * Count a positive answer which the table has not confirmed.
+	 */
+	inline void count_false_positive() const noexcept {
+		if(utils::Metrics::ENABLED && m_metrics) {
+			m_metrics->false_positives.add();
+		}
+	}
+
+	void clear() noexcept {
+		for(size_t i = 0; i < m_bucket_count; i++) {
+			m_buckets[i] = 0;
+		}
+		m_size = 0;
+		m_victim = 0;
+		m_victim_bucket = 0;
+		m_saturated = false;
+	}
+
+	inline size_t size() const noexcept {
+		return m_size;
+	}
+
+	inline size_t slots() const noexcept {
+		return m_bucket_count * SLOTS;
+	}
+
+	inline bool saturated() const noexcept {
+		return m_saturated;
+	}
+
+	inline double load() const noexcept {
+		return double(m_size) / double(slots());
+	}
+
+	/**
+	 * @return the false positive rate of the current load, a lookup compares 2 * SLOTS slots.
+	 */
+	inline double false_positive_rate() const noexcept {
+		return m_saturated ? 1.0 : 2.0 * SLOTS * load() / double(LANE_MASK);
+	}
+
+	inline size_t storage_bytes() const noexcept {
+		return m_bucket_count * sizeof(uint64_t);
+	}
+
+	inline void set_metrics(CuckooFilterMetrics* metrics) noexcept {
+		m_metrics = metrics;
+	}
+
+private:
+
+	static inline size_t round_up(size_t buckets) noexcept {
+		size_t result = 1;
+		while(result < buckets) {
+			result <<= 1;
+		}
+		return result;
+	}
+
+	static inline uint16_t fingerprint(uint64_t hash) noexcept {
+		const uint16_t result = uint16_t(hash >> 48);
+		return result ? result : 1;
+	}
+
+	inline size_t index(uint64_t hash) const noexcept {
+		return size_t(hash) & m_mask;
+	}
+
+	/**
+	 * The other bucket of a fingerprint, alt(alt(bucket)) == bucket.
+	 */
+	inline size_t alt(size_t bucket, uint16_t fp) const noexcept {
+		return (bucket ^ size_t(uint64_t(fp) * 0xc6a4a7935bd1e995ull)) & m_mask;
+	}
+
+	/**
+	 * @return true - if a 16-bit lane of @bucket equals @fp.
+	 */
+	static inline bool has(uint64_t bucket, uint16_t fp) noexcept {
+		const uint64_t x = bucket ^ (LANES * fp);
+		return ((x - LANES) & ~x & HIGHS) != 0;
+	}
+
+	inline bool put(size_t bucket, uint16_t fp) noexcept {
+		uint64_t& value = m_buckets[bucket];
+		for(unsigned shift = 0; shift < SLOTS * 16; shift += 16) {
+			if(((value >> shift) & LANE_MASK) == 0) {
+				value |= uint64_t(fp) << shift;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	inline bool take(size_t bucket, uint16_t fp) noexcept {
+		uint64_t& value = m_buckets[bucket];
+		for(unsigned shift = 0; shift < SLOTS * 16; shift += 16) {
+			if(((value >> shift) & LANE_MASK) == fp) {
+				value &= ~(LANE_MASK << shift);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	inline uint64_t next_random() noexcept {
+		m_random ^= m_random << 13;
+		m_random ^= m_random >> 7;
+		m_random ^= m_random << 17;
+		return m_random;
+	}
+
+	inline void count_lookup(bool positive) const noexcept {
+		if(utils::Metrics::ENABLED && m_metrics) {
+			m_metrics->lookups.add();
+			if(not positive) {
+				m_metrics->negatives.add();
+			}
+		}
+	}
+
+};
+
+}; // namespace storage
+
+#endif /* STORAGE_CUCKOOFILTER_H */
@@ -0,0 +1,74 @@
+#ifndef STORAGE_FLOWRECORD_H
+#define STORAGE_FLOWRECORD_H
+
+#include "../../proto/FlowKey.h"
+#include "../../proto/TcpConn.h"
+#include "../../proto/parsers/ParsedPacket.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace storage {
+
+/**
+ * The counters of a direction of a flow.
+ */
+struct FlowCounters {
+	uint64_t packets;
+	uint64_t bytes;
+	uint8_t tcp_flags; // OR of the TCP flags seen, 0 - for the other protocols
+
+	FlowCounters() noexcept : packets(0), bytes(0), tcp_flags(0) {}
+};
+
+/**
+ * A bidirectional flow, @key is of the first packet seen (the initiator is the source),
+ * @forward counts the packets of @key and @reverse the packets of the opposite direction.
+ * The times are in the clock ticks of the table.
+ */
+struct FlowEntry {
+	proto::FlowKey key;
+	uint64_t first;
+	uint64_t last;
+	FlowCounters forward;
+	FlowCounters reverse;
+	proto::TcpConn tcp; // NONE - for the other protocols
+
+	FlowEntry() noexcept : key(), first(0), last(0), forward(), reverse(), tcp() {}
+
+	/**
+	 * Count a packet of the flow and advance the TCP state.
+	 * @param packet_key - FlowKey::of(@flow).
+	 * @return false - if the TCP packet is not valid in the state, see proto::TcpConn::update().
+	 */
+	inline bool count(const proto::FlowKey& packet_key, const proto::ParsedFlow& flow, const uint8_t* frame,
+			size_t bytes, uint64_t now) noexcept {
+		const bool back = not (packet_key == key);
+		FlowCounters& counters = back ? reverse : forward;
+		counters.packets++;
+		counters.bytes += bytes;
+		last = now;
+		if(flow.has(proto::Protocol::L4_TCP)) {
+			const uint8_t flags = frame[flow.l4 + offsetof(proto::Tcp::Header, flags)];
+			counters.tcp_flags |= flags;
+			return tcp.update(flags, back);
+		}
+		return true;
+	}
+};
+
+enum class FlowEnd : uint8_t {
+	IDLE, // no packet for the idle timeout
+	ACTIVE, // the active timeout since the first packet, the flow goes on with the counters reset
+	EVICTED, // the oldest flow removed for a new one when the table is full
+	FLUSHED // by FlowTable::flush()
+};
+
+struct FlowRecord {
+	FlowEntry flow;
+	FlowEnd reason;
+};
+
+}; // namespace storage
+
+#endif /* STORAGE_FLOWRECORD_H */
@@ -0,0 +1,252 @@
+#ifndef STORAGE_FLOWTABLE_H
+#define STORAGE_FLOWTABLE_H
+
+#include "TimedQueue.h"
+#include "Clock.h"
+#include "FlowRecord.h"
+#include "../../proto/FlowKey.h"
+#include "../../proto/parsers/ParsedPacket.h"
+
+#include <cstdint>
+#include <cstring>
+
+namespace storage {
+
+struct FlowTableStat {
+	uint64_t packets; // counted to a flow
+	uint64_t flows; // created
+	uint64_t idle;
+	uint64_t active;
+	uint64_t evicted;
+	uint64_t flushed;
+	uint64_t ignored; // the non IP packets
+	uint64_t dropped; // the packets of the new flows which got no entry even after an eviction
+
+	FlowTableStat() noexcept : packets(0), flows(0), idle(0), active(0), evicted(0), flushed(0), ignored(0), dropped(0) {}
+};
+
+/**
+ * FlowTable counts the parsed packets to the bidirectional flows, e.g. for a NetFlow/IPFIX style exporter.
+ * The flows are kept in a TimedQueue keyed by FlowKey::canonical(), so both directions take a single probe
+ * of the same entry, and are ordered by their last packet, so the idle flows are at the front.
+ * A flow is exported when it is idle for idle_ms, every active_ms since its first packet (its counters are reset
+ * and it goes on) and when it is evicted for a new one, the records are collected into batches of BATCH
+ * and passed to the exporter at once.
+ * All the entries are allocated by allocate() and there is no lock, a table is per core (e.g. behind RSS),
+ * FlowKey::canonical() with a symmetric hash keeps both directions on the same core.
+ * The packets of the fragments after the first one have no ports, so they are the flows of their own
+ * unless they are reassembled first (see proto::Reassembler).
+ *
+ * Using sample:
+ * struct Exporter {
+ *     void operator()(const FlowRecord* records, size_t n) noexcept { ... }
+ * };
+ * FlowTable<Exporter> table(1 << 20);
+ * table.allocate();
+ * for each burst:
+ *     for each frame:
+ *         if(PacketParser::parse(frame, caplen, pkt)) {
+ *             table.update(frame, pkt, len);
+ *         }
+ *     table.expire();
+ *
+ * @tparam E - the exporter, void operator()(const FlowRecord* records, size_t n) noexcept.
+ * @tparam C - the clock source, see Clock.h.
+ * @tparam H - the hash of FlowKey, it must be symmetric as proto::Crc32cFlowHash and proto::ToeplitzFlowHash are.
+ */
+template<typename E, typename C = CoarseClock, typename H = proto::Crc32cFlowHash>
+class FlowTable {
+	friend class TestFlowTable;
+
+public:
+	static constexpr size_t BATCH = 32; // the records per exporter call
+	static constexpr unsigned IDLE_MS = 15000; // as the inactive timeout of NetFlow
+	static constexpr unsigned ACTIVE_MS = 1800000; // as the active timeout of NetFlow
+
+private:
+	using Node_t = TimedQueueNode<proto::FlowKey, FlowEntry>;
+	using Queue_t = TimedQueue<Node_t, H, intrusive::HashMapBucket<Node_t>, C>;
+	using Iterator_t = typename Queue_t::Iterator_t;
+
+	Queue_t m_queue;
+	const size_t m_capacity;
+	uint64_t m_idle; // clock ticks
+	uint64_t m_active; // clock ticks
+	E m_exporter;
+	size_t m_batch_size;
+	FlowTableStat m_stat;
+	FlowRecord m_batch[BATCH];
+
+public:
+
+	/**
+	 * @param capacity - amount of the flows.
+	 * @param idle_ms - a flow is exported if it has had no packet for this time.
+	 * @param active_ms - a long flow is exported every this time, 0 - never.
+	 */
+	FlowTable(size_t capacity, unsigned idle_ms = IDLE_MS, unsigned active_ms = ACTIVE_MS, float load_factor = 1.0f,
+			const E& exporter = E()) noexcept
+		: m_queue(capacity, load_factor)
+		, m_capacity(capacity)
+		, m_idle(0)
+		, m_active(0)
+		, m_exporter(exporter)
+		, m_batch_size(0)
+		, m_stat() {
+		m_idle = uint64_t(idle_ms) * m_queue.clock().hz() / 1000;
+		m_active = uint64_t(active_ms) * m_queue.clock().hz() / 1000;
+	}
+
+	FlowTable(const FlowTable&) = delete;
+	FlowTable& operator=(const FlowTable&) = delete;
+
+	FlowTable(FlowTable&&) = delete;
+	FlowTable& operator=(FlowTable&&) = delete;
+
+	int allocate() noexcept {
+		return m_queue.allocate();
+	}
+
+	/**
+	 * Count a packet to its flow, the flow is created if it is new, the TCP state of the flow is advanced
+	 * but the packets which are not valid in it are counted too (see ConnTable for a stateful filter).
+	 * @param frame - the frame @flow has been parsed from, the TCP flags are read from it.
+	 * @param flow - the packet or its ParsedPacket::inner, e.g. to count the flows inside the tunnels.
+	 * @param bytes - the length of the packet to count, e.g. the wire length of the frame.
+	 * @return the flow, nullptr - if the packet is not IP or there is no entry for its new flow.
+	 */
+	FlowEntry* update(const uint8_t* frame, const proto::ParsedFlow& flow, size_t bytes) noexcept {
+		if(flow.ip_version == 0) {
+			m_stat.ignored++;
+			return nullptr;
+		}
+		const proto::FlowKey key = proto::FlowKey::of(flow);
+		const uint64_t now = m_queue.clock().now();
+		bool pushed;
+		Iterator_t it = m_queue.touch_or_push(key.canonical(), pushed);
+		if(not it) {
+			evict();
+			it = m_queue.touch_or_push(key.canonical(), pushed);
+			if(not it) {
+				m_stat.dropped++;
+				return nullptr;
+			}
+		}
+
+		FlowEntry& entry = it->value;
+		if(pushed) {
+			entry = FlowEntry();
+			entry.key = key;
+			entry.first = now;
+			m_stat.flows++;
+		} else if(m_active && now - entry.first >= m_active) {
+			stage(entry, FlowEnd::ACTIVE);
+			m_stat.active++;
+			entry.forward = FlowCounters();
+			entry.reverse = FlowCounters();
+			entry.first = now;
+		}
+		entry.count(key, flow, frame, bytes, now);
+		m_stat.packets++;
+		return &entry;
+	}
+
+	/**
+	 * Export the idle flows and the records collected by update(), e.g. once per burst.
+	 */
+	void expire() noexcept {
+		Iterator_t it;
+		while((it = m_queue.pop_front(m_idle))) {
+			stage(it->value, FlowEnd::IDLE);
+			m_stat.idle++;
+		}
+		emit();
+	}
+
+	/**
+	 * Export all the flows, e.g. at the end of a capture, the table is empty after it.
+	 */
+	void flush() noexcept {
+		Iterator_t it;
+		while((it = m_queue.pop_front(0))) {
+			stage(it->value, FlowEnd::FLUSHED);
+			m_stat.flushed++;
+		}
+		emit();
+	}
+
+	/**
+	 * @return the flow of @key in any direction, the flow is not refreshed, nullptr - if there is no one.
+	 */
+	FlowEntry* find(const proto::FlowKey& key) noexcept {
+		auto it = m_queue.find(key.canonical());
+		return it ? &it->value : nullptr;
+	}
+
+	/**
+	 * @return the clock source, e.g. to set the time of a burst.
+	 */
+	inline C& clock() noexcept {
+		return m_queue.clock();
+	}
+
+	inline E& exporter() noexcept {
+		return m_exporter;
+	}
+
+	/**
+	 * @return amount of the flows.
+	 */
+	inline size_t size() const noexcept {
+		return m_queue.size();
+	}
+
+	inline size_t capacity() const noexcept {
+		return m_capacity;
+	}
+
+	inline const FlowTableStat& stat() const noexcept {
+		return m_stat;
+	}
+
+	inline size_t storage_bytes() noexcept {
+		return m_queue.storage_bytes();
+	}
+
+private:
+
+	/**
+	 * Remove the flow with the oldest last packet.
+	 */
+	void evict() noexcept {
+		Iterator_t it = m_queue.pop_front(0);
+		if(it) {
+			stage(it->value, FlowEnd::EVICTED);
+			m_stat.evicted++;
+		}
+	}
+
+	/**
+	 * Copy a flow into the batch, a removed node is valid until the next push, so it is copied at once.
+	 */
+	inline void stage(const FlowEntry& flow, FlowEnd reason) noexcept {
+		FlowRecord& record = m_batch[m_batch_size++];
+		record.flow = flow;
+		record.reason = reason;
+		if(m_batch_size == BATCH) {
+			emit();
+		}
+	}
+
+	inline void emit() noexcept {
+		if(m_batch_size) {
+			m_exporter(m_batch, m_batch_size);
+			m_batch_size = 0;
+		}
+	}
+
+};
+
+}; // namespace storage
+
+#endif /* STORAGE_FLOWTABLE_H */
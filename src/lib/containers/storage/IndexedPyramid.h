@@ -0,0 +1,269 @@
+#ifndef STORAGE_INDEXEDPYRAMID_H
+#define STORAGE_INDEXEDPYRAMID_H
+
+#include <bits/allocator.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+namespace storage {
+
+template<typename P>
+struct IndexedPyramidEntry {
+	P priority;
+	uint32_t handle;
+};
+
+/**
+ * A D-ary max-heap of handles with priorities, it keeps the heap position of every handle,
+ * so the priority of a handle is updated or the handle is erased in O(log n) without a search.
+ * A handle is an index in [0, capacity), e.g. the index of a pooled node,
+ * the heap keeps every handle at most once.
+ * As in Pyramid the root keeps the greatest priority by C, e.g. C = std::greater<uint64_t>
+ * keeps the earliest deadline in the root.
+ *
+ * @tparam P - a trivially copyable priority, the entries are kept in the raw allocated storage.
+ * @tparam D - the node children number, see Pyramid.
+ * @tparam EA - an allocator of the heap entries.
+ * @tparam PA - an allocator of the handle positions.
+ */
+template<
+	typename P,
+	typename C = std::less<P>,
+	unsigned D = 4,
+	typename EA = std::allocator<IndexedPyramidEntry<P> >,
+	typename PA = std::allocator<uint32_t>
+>
+class IndexedPyramid {
+	friend class TestIndexedPyramid;
+
+	static_assert(D >= 2, "Template argument 'D' must be at least 2.");
+	static_assert(std::is_trivially_copyable<P>::value, "Template argument 'P' must be trivially copyable.");
+
+public:
+	using Priority_t = P;
+	using Handle_t = uint32_t;
+	using Entry_t = IndexedPyramidEntry<P>;
+
+	static constexpr Handle_t NIL = ~Handle_t(0); // the position of a handle out of the heap
+
+private:
+	const size_t m_capacity;
+	Entry_t* m_heap;
+	uint32_t* m_positions; // the heap position of each handle or NIL
+	size_t m_size;
+	C m_less;
+	EA m_entry_allocator;
+	PA m_position_allocator;
+
+public:
+
+	/**
+	 * @param capacity - amount of the handles, it is limited by NIL.
+	 */
+	IndexedPyramid(size_t capacity) noexcept
+		: m_capacity(capacity < size_t(NIL) ? capacity : size_t(NIL))
+		, m_heap(nullptr)
+		, m_positions(nullptr)
+		, m_size(0)
+		, m_less()
+		, m_entry_allocator()
+		, m_position_allocator() {}
+
+	IndexedPyramid(const IndexedPyramid&) = delete;
+	IndexedPyramid& operator=(const IndexedPyramid&) = delete;
+
+	IndexedPyramid(IndexedPyramid&&) = delete;
+	IndexedPyramid& operator=(IndexedPyramid&&) = delete;
+
+	virtual ~IndexedPyramid() noexcept {
+		destroy();
+	}
+
+	/**
+	 * @return 0 - if the heap has been allocated successfully.
+	 */
+	int allocate() noexcept {
+		if(m_heap || m_capacity == 0)
+			return -1;
+
+		m_heap = m_entry_allocator.allocate(m_capacity);
+		if(m_heap == nullptr)
+			return -1;
+
+		m_positions = m_position_allocator.allocate(m_capacity);
+		if(m_positions == nullptr) {
+			destroy();
+			return -1;
+		}
+		for(size_t i = 0; i < m_capacity; ++i) {
+			m_positions[i] = NIL;
+		}
+		return 0;
+	}
+
+	/**
+	 * @return false - if the handle is out of the range or it is in the heap already.
+	 */
+	bool push(Handle_t handle, const P& priority) noexcept {
+		if(handle >= m_capacity || m_positions[handle] != NIL)
+			return false;
+
+		place(m_size, Entry_t{priority, handle});
+		m_size++;
+		leaf_up(m_size - 1);
+		return true;
+	}
+
+	/**
+	 * Change the priority of a handle in the heap, e.g. the deadline of a re-activated flow.
+	 * @return false - if the handle is not in the heap.
+	 */
+	bool update(Handle_t handle, const P& priority) noexcept {
+		if(not contains(handle))
+			return false;
+
+		const size_t index = m_positions[handle];
+		const bool up = m_less(m_heap[index].priority, priority);
+		m_heap[index].priority = priority;
+		if(up) {
+			leaf_up(index);
+		} else {
+			node_down(index);
+		}
+		return true;
+	}
+
+	/**
+	 * @return false - if the handle is not in the heap.
+	 */
+	bool erase(Handle_t handle) noexcept {
+		if(not contains(handle))
+			return false;
+
+		const size_t index = m_positions[handle];
+		m_positions[handle] = NIL;
+		m_size--;
+		if(index != m_size) {
+			const bool up = m_less(m_heap[index].priority, m_heap[m_size].priority);
+			place(index, std::move(m_heap[m_size]));
+			if(up) {
+				leaf_up(index);
+			} else {
+				node_down(index);
+			}
+		}
+		return true;
+	}
+
+	inline bool contains(Handle_t handle) const noexcept {
+		return handle < m_capacity && m_positions[handle] != NIL;
+	}
+
+	/**
+	 * @return the priority of a handle or nullptr if the handle is not in the heap.
+	 */
+	inline const P* priority(Handle_t handle) const noexcept {
+		return contains(handle) ? &m_heap[m_positions[handle]].priority : nullptr;
+	}
+
+	inline const Entry_t* peek() const noexcept {
+		return (m_size ? m_heap : nullptr);
+	}
+
+	inline bool pop(Entry_t& copy) noexcept {
+		if(m_size) {
+			copy = *m_heap;
+			erase(copy.handle);
+			return true;
+		}
+		return false;
+	}
+
+	void clear() noexcept {
+		for(size_t i = 0; i < m_size; ++i) {
+			m_positions[m_heap[i].handle] = NIL;
+		}
+		m_size = 0;
+	}
+
+	inline size_t size() const noexcept {
+		return m_size;
+	}
+
+	inline size_t capacity() const noexcept {
+		return m_capacity;
+	}
+
+	inline size_t storage_bytes() const noexcept {
+		return m_capacity * (sizeof(Entry_t) + sizeof(uint32_t));
+	}
+
+private:
+
+	void destroy() noexcept {
+		if(m_positions) {
+			m_position_allocator.deallocate(m_positions, m_capacity);
+			m_positions = nullptr;
+		}
+		if(m_heap) {
+			m_entry_allocator.deallocate(m_heap, m_capacity);
+			m_heap = nullptr;
+		}
+		m_size = 0;
+	}
+
+	inline void place(size_t index, Entry_t&& entry) noexcept {
+		m_positions[entry.handle] = uint32_t(index);
+		m_heap[index] = std::move(entry);
+	}
+
+	void node_down(size_t index) noexcept {
+		const size_t first_leaf = m_size > 1 ? (m_size - 2) / D + 1 : 0;
+		if(index >= first_leaf) {
+			return;
+		}
+		Entry_t entry = std::move(m_heap[index]);
+		while(index < first_leaf) {
+			const size_t index_first = index * D + 1;
+			const size_t index_last = std::min(index_first + D, m_size);
+			size_t index_top = index_first;
+			for(size_t i = index_first + 1; i < index_last; ++i) {
+				if(m_less(m_heap[index_top].priority, m_heap[i].priority)) {
+					index_top = i;
+				}
+			}
+			if(not m_less(entry.priority, m_heap[index_top].priority)) {
+				break;
+			}
+			place(index, std::move(m_heap[index_top]));
+			index = index_top;
+		}
+		place(index, std::move(entry));
+	}
+
+	void leaf_up(size_t index) noexcept {
+		if(index == 0) {
+			return;
+		}
+		Entry_t entry = std::move(m_heap[index]);
+		while(index > 0) {
+			const size_t index_parent = (index - 1) / D;
+			if(not m_less(m_heap[index_parent].priority, entry.priority)) {
+				break;
+			}
+			place(index, std::move(m_heap[index_parent]));
+			index = index_parent;
+		}
+		place(index, std::move(entry));
+	}
+
+};
+
+}; // namespace storage
+
+#endif /* STORAGE_INDEXEDPYRAMID_H */
@@ -0,0 +1,293 @@
+#ifndef IP6TABLE_H
+#define IP6TABLE_H
+
+#include "../intrusive_pool/HashQueuePool.h"
+#include "../dpdk/Allocator.h"
+
+#include <cstdint>
+
+namespace storage {
+
+/**
+ * A table of IPv6 addresses and networks with FIFO eviction, the IPv6 variant of IpTable.
+ * Both the addresses and the networks are kept in HashQueuePools.
+ * A network is looked up by its prefix for every prefix length which is in use,
+ * so a lookup takes as many hash lookups as there are distinct prefix lengths in the table.
+ */
+class Ip6Table {
+	friend class TestIp6Table;
+
+public:
+
+	/**
+	 * An IPv6 address in host byte order, 'hi' holds the first 8 bytes of the address.
+	 */
+	struct IPv6Addr_t {
+		uint64_t hi;
+		uint64_t lo;
+
+		inline bool operator==(const IPv6Addr_t& addr) const noexcept {
+			return hi == addr.hi && lo == addr.lo;
+		}
+	};
+
+	struct IPv6Network_t {
+		IPv6Addr_t network;
+		uint8_t depth;
+
+		inline bool operator==(const IPv6Network_t& net) const noexcept {
+			return network == net.network && depth == net.depth;
+		}
+	};
+
+	static constexpr unsigned DEPTH_MAX = 128;
+
+private:
+
+	struct Hash {
+		inline size_t operator()(const IPv6Addr_t& addr) const noexcept {
+			return size_t(intrusive::HashMix<uint64_t>::mix(addr.hi ^ intrusive::HashMix<uint64_t>::mix(addr.lo)));
+		}
+
+		inline size_t operator()(const IPv6Network_t& net) const noexcept {
+			return size_t(intrusive::HashMix<uint64_t>::mix(
+				net.network.hi ^ intrusive::HashMix<uint64_t>::mix(net.network.lo ^ net.depth)));
+		}
+	};
+
+	using NodeAddr_t = intrusive::HashQueuePoolEmptyNode<IPv6Addr_t>;
+	using PoolAddr_t = intrusive::HashQueuePool<
+		NodeAddr_t,
+		Hash,
+		dpdk::Allocator<NodeAddr_t>,
+		dpdk::Allocator<intrusive::HashMapBucket<NodeAddr_t> >
+	>;
+
+	using NodeNet_t = intrusive::HashQueuePoolEmptyNode<IPv6Network_t>;
+	using PoolNet_t = intrusive::HashQueuePool<
+		NodeNet_t,
+		Hash,
+		dpdk::Allocator<NodeNet_t>,
+		dpdk::Allocator<intrusive::HashMapBucket<NodeNet_t> >
+	>;
+
+	static constexpr size_t BULK_MAX = 32;
+	static constexpr size_t DEPTH_WORDS = (DEPTH_MAX + 1 + 63) / 64;
+
+	PoolAddr_t m_pool_addr;
+	PoolNet_t m_pool_net;
+	uint32_t m_depth_nets[DEPTH_MAX + 1]; // amount of the networks per prefix length
+	uint64_t m_depth_used[DEPTH_WORDS]; // the prefix lengths which are in use
+
+public:
+
+	Ip6Table(unsigned capacity_addr, float load_factor, unsigned capacity_net) noexcept
+		: m_pool_addr(capacity_addr, load_factor, intrusive::HashMapSizing::POW2)
+		, m_pool_net(capacity_net, load_factor, intrusive::HashMapSizing::POW2)
+		, m_depth_nets()
+		, m_depth_used() {};
+
+	int allocate() noexcept {
+		return m_pool_addr.allocate() || m_pool_net.allocate();
+	}
+
+	/**
+	 * @param addr - an IP address.
+	 * @return true if the table contains addr.
+	 */
+	inline bool find(const IPv6Addr_t& addr) const noexcept {
+		return find_in_addrs(addr) || find_in_nets(addr);
+	}
+
+	/**
+	 * @param addr - an IP address.
+	 * @return true if the table contains addr as an individual IP address.
+	 */
+	inline bool find_in_addrs(const IPv6Addr_t& addr) const noexcept {
+		return m_pool_addr.find(addr) != m_pool_addr.cend();
+	}
+
+	/**
+	 * @param addr - an IP address.
+	 * @return true if the table contains addr as a network address range.
+	 */
+	inline bool find_in_nets(const IPv6Addr_t& addr) const noexcept {
+		for(size_t word = 0; word < DEPTH_WORDS; word++) {
+			for(uint64_t used = m_depth_used[word]; used; used &= used - 1) {
+				const unsigned depth = unsigned(word * 64 + __builtin_ctzll(used));
+				if(m_pool_net.find(network_of(addr, depth)) != m_pool_net.cend()) {
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	/**
+	 * Look up a burst of addresses, see find().
+	 * @param addrs - IP addresses.
+	 * @param n - amount of the addresses.
+	 * @param out - n results.
+	 */
+	void find_bulk(const IPv6Addr_t* addrs, size_t n, bool* out) const noexcept {
+		PoolAddr_t::ConstIterator_t found_addr[BULK_MAX];
+		PoolNet_t::ConstIterator_t found_net[BULK_MAX];
+		IPv6Network_t nets[BULK_MAX];
+		for(size_t first = 0; first < n; first += BULK_MAX) {
+			const size_t count = (n - first) < BULK_MAX ? (n - first) : BULK_MAX;
+			m_pool_addr.find_bulk(addrs + first, count, found_addr);
+			for(size_t i = 0; i < count; i++) {
+				out[first + i] = found_addr[i] != m_pool_addr.cend();
+			}
+			for(size_t word = 0; word < DEPTH_WORDS; word++) {
+				for(uint64_t used = m_depth_used[word]; used; used &= used - 1) {
+					const unsigned depth = unsigned(word * 64 + __builtin_ctzll(used));
+					for(size_t i = 0; i < count; i++) {
+						nets[i] = network_of(addrs[first + i], depth);
+					}
+					m_pool_net.find_bulk(nets, count, found_net);
+					for(size_t i = 0; i < count; i++) {
+						out[first + i] = out[first + i] || found_net[i] != m_pool_net.cend();
+					}
+				}
+			}
+		}
+	}
+
+	/**
+	 * @param addr - an IP address.
+	 */
+	inline void append_addr(const IPv6Addr_t& addr) noexcept {
+		if(not m_pool_addr.available()) {
+			m_pool_addr.pop_front();
+		}
+		m_pool_addr.push_back(addr);
+	}
+
+	/**
+	 * @param net - an IP address of the network, the bits beyond the prefix are ignored.
+	 * @param depth - the prefix length of the network [0, DEPTH_MAX].
+	 */
+	inline void append_net(const IPv6Addr_t& net, unsigned depth) noexcept {
+		if(depth > DEPTH_MAX)
+			return;
+
+		if(not m_pool_net.available()) {
+			auto it = m_pool_net.pop_front();
+			unuse_depth(it->im_key.depth);
+		}
+		if(m_pool_net.push_back(network_of(net, depth))) {
+			use_depth(depth);
+		}
+	}
+
+	/**
+	 * @param addr - an IP address.
+	 */
+	inline void remove_addr(const IPv6Addr_t& addr) noexcept {
+		auto it = m_pool_addr.find(addr);
+		if(it) {
+			m_pool_addr.remove(it);
+		}
+	}
+
+	/**
+	 * @param net - an IP address of the network.
+	 * @param depth - the prefix length of the network.
+	 */
+	inline void remove_net(const IPv6Addr_t& net, unsigned depth) noexcept {
+		if(depth > DEPTH_MAX)
+			return;
+
+		auto it = m_pool_net.find(network_of(net, depth));
+		if(it) {
+			m_pool_net.remove(it);
+			unuse_depth(depth);
+		}
+	}
+
+	size_t size_addr() const noexcept {
+		return m_pool_addr.size();
+	}
+
+	size_t size_net() const noexcept {
+		return m_pool_net.size();
+	}
+
+	size_t available_addr() const noexcept {
+		return m_pool_addr.available();
+	}
+
+	size_t available_net() const noexcept {
+		return m_pool_net.available();
+	}
+
+	size_t capacity_addr() const noexcept {
+		return m_pool_addr.capacity();
+	}
+
+	size_t capacity_net() const noexcept {
+		return m_pool_net.capacity();
+	}
+
+	inline size_t storage_bytes() noexcept {
+		return m_pool_addr.storage_bytes() + m_pool_net.storage_bytes();
+	}
+
+	/**
+	 * @param bytes - 16 bytes of an address in network byte order.
+	 */
+	static IPv6Addr_t as_host_addr(const uint8_t* bytes) noexcept {
+		IPv6Addr_t addr = {0, 0};
+		for(unsigned i = 0; i < 8; i++) {
+			addr.hi = (addr.hi << 8) | bytes[i];
+			addr.lo = (addr.lo << 8) | bytes[i + 8];
+		}
+		return addr;
+	}
+
+	/**
+	 * @param words - 8 16-bit groups of an address as they are written, e.g. 2001:db8::1.
+	 */
+	static IPv6Addr_t as_host_addr(
+		unsigned w0, unsigned w1, unsigned w2, unsigned w3, unsigned w4, unsigned w5, unsigned w6, unsigned w7
+	                              ) noexcept {
+		IPv6Addr_t addr = {0, 0};
+		const unsigned hi[] = {w0, w1, w2, w3};
+		const unsigned lo[] = {w4, w5, w6, w7};
+		for(unsigned i = 0; i < 4; i++) {
+			addr.hi = (addr.hi << 16) | (hi[i] & 0xFFFF);
+			addr.lo = (addr.lo << 16) | (lo[i] & 0xFFFF);
+		}
+		return addr;
+	}
+
+	/**
+	 * @return the network of the address with the prefix length 'depth'.
+	 */
+	static inline IPv6Network_t network_of(const IPv6Addr_t& addr, unsigned depth) noexcept {
+		IPv6Network_t net;
+		net.network.hi = depth >= 64 ? addr.hi : (depth ? addr.hi & (~uint64_t(0) << (64 - depth)) : 0);
+		net.network.lo = depth >= 128 ? addr.lo : (depth > 64 ? addr.lo & (~uint64_t(0) << (128 - depth)) : 0);
+		net.depth = uint8_t(depth);
+		return net;
+	}
+
+private:
+
+	inline void use_depth(unsigned depth) noexcept {
+		m_depth_nets[depth]++;
+		m_depth_used[depth / 64] |= uint64_t(1) << (depth % 64);
+	}
+
+	inline void unuse_depth(unsigned depth) noexcept {
+		if(--m_depth_nets[depth] == 0) {
+			m_depth_used[depth / 64] &= ~(uint64_t(1) << (depth % 64));
+		}
+	}
+
+};
+
+}; // namespace storage
+
+#endif /* IP6TABLE_H */
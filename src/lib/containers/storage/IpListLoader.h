@@ -0,0 +1,172 @@
+#ifndef STORAGE_IPLISTLOADER_H
+#define STORAGE_IPLISTLOADER_H
+
+#include "IpTable.h"
+#include "Ip6Table.h"
+#include "IpListStat.h"
+#include "../../utils/InetText.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+namespace storage {
+
+/**
+ * A loader of the address lists (e.g. the blocklists) into IpTable and Ip6Table straight from the text,
+ * the text is parsed in place by utils::InetText, so nothing is allocated and nothing is thrown.
+ * A line takes an entry, the spaces around it and a '#' comment, the empty and the comment lines are skipped:
+ *   192.168.1.1
+ *   10.0.0.0/8               # a prefix, the host bits are cleared
+ *   172.16.0.0/255.240.0.0   # a mask, it may be non-contiguous
+ *   2001:db8::1
+ *   2001:db8::/32
+ * A line which doesn't parse is skipped and counted in IpListStat, the first error keeps its line and column.
+ *
+ * Using sample:
+ * const storage::IpListStat stat = storage::IpListLoader::load(text, size, table, table6);
+ * if(stat.errors) {
+ *     fprintf(stderr, "%zu:%zu: %s\n", stat.error_line, stat.error_column, stat.error);
+ * }
+ */
+class IpListLoader {
+public:
+	static IpListStat load(const char* text, size_t size, IpTable& table, Ip6Table& table6) noexcept {
+		return load(text, size, &table, &table6);
+	}
+
+	/**
+	 * The IPv6 entries are errors.
+	 */
+	static IpListStat load(const char* text, size_t size, IpTable& table) noexcept {
+		return load(text, size, &table, nullptr);
+	}
+
+private:
+
+	static IpListStat load(const char* text, size_t size, IpTable* table, Ip6Table* table6) noexcept {
+		IpListStat stat;
+		const char* const end = text + size;
+		const char* line = text;
+		while(line != end) {
+			const char* line_end = static_cast<const char*>(memchr(line, '\n', size_t(end - line)));
+			const char* next = line_end ? line_end + 1 : end;
+			line_end = line_end ? line_end : end;
+			if(line_end != line && line_end[-1] == '\r') {
+				line_end--;
+			}
+			stat.lines++;
+			const char* str = line;
+			const char* error = load_line(str, line_end, table, table6, stat);
+			if(error) {
+				if(not stat.errors) {
+					stat.error = error;
+					stat.error_line = stat.lines;
+					stat.error_column = size_t(str - line) + 1;
+				}
+				stat.errors++;
+			}
+			line = next;
+		}
+		return stat;
+	}
+
+	/**
+	 * @return an error, nullptr - none, @str points to the char of the error then.
+	 */
+	static const char* load_line(const char*& str, const char* end, IpTable* table, Ip6Table* table6, IpListStat& stat) noexcept {
+		str = skip_spaces(str, end);
+		if(str == end || *str == '#') {
+			return nullptr;
+		}
+		const unsigned family = utils::InetText::family(str, end);
+		if(family == 4) {
+			uint32_t addr;
+			if(not utils::InetText::parse_ipv4(str, end, addr)) {
+				return "bad IPv4 address";
+			}
+			if(str != end && *str == '/') {
+				str++;
+				uint32_t mask;
+				if(not parse_mask(str, end, mask)) {
+					return "bad IPv4 prefix or mask";
+				}
+				if(not finished(str, end)) {
+					return "unexpected character";
+				}
+				table->append_net(addr & mask, mask);
+				stat.nets++;
+				return nullptr;
+			}
+			if(not finished(str, end)) {
+				return "unexpected character";
+			}
+			table->append_addr(addr);
+			stat.addrs++;
+			return nullptr;
+		} else if(family == 6) {
+			uint8_t bytes[utils::InetText::IPV6_BYTES];
+			if(not table6) {
+				return "no IPv6 table";
+			}
+			if(not utils::InetText::parse_ipv6(str, end, bytes)) {
+				return "bad IPv6 address";
+			}
+			const Ip6Table::IPv6Addr_t addr = Ip6Table::as_host_addr(bytes);
+			if(str != end && *str == '/') {
+				str++;
+				unsigned depth;
+				if(not utils::InetText::parse_depth(str, end, Ip6Table::DEPTH_MAX, depth)) {
+					return "bad IPv6 prefix";
+				}
+				if(not finished(str, end)) {
+					return "unexpected character";
+				}
+				table6->append_net(addr, depth);
+				stat.nets6++;
+				return nullptr;
+			}
+			if(not finished(str, end)) {
+				return "unexpected character";
+			}
+			table6->append_addr(addr);
+			stat.addrs6++;
+			return nullptr;
+		}
+		return "not an address";
+	}
+
+	/**
+	 * A prefix length or a dotted quad mask.
+	 */
+	static inline bool parse_mask(const char*& str, const char* end, uint32_t& mask) noexcept {
+		if(utils::InetText::family(str, end) == 4) {
+			return utils::InetText::parse_ipv4(str, end, mask);
+		}
+		unsigned depth;
+		if(not utils::InetText::parse_depth(str, end, 32, depth)) {
+			return false;
+		}
+		mask = depth ? ~uint32_t(0) << (32 - depth) : 0;
+		return true;
+	}
+
+	/**
+	 * @return true - if only the spaces and a comment follow @str, @str points to the first other char.
+	 */
+	static inline bool finished(const char*& str, const char* end) noexcept {
+		str = skip_spaces(str, end);
+		return str == end || *str == '#';
+	}
+
+	static inline const char* skip_spaces(const char* str, const char* end) noexcept {
+		while(str != end && (*str == ' ' || *str == '\t')) {
+			str++;
+		}
+		return str;
+	}
+};
+
+}; // namespace storage
+
+#endif /* STORAGE_IPLISTLOADER_H */
@@ -0,0 +1,36 @@
+#ifndef STORAGE_IPLISTSTAT_H
+#define STORAGE_IPLISTSTAT_H
+
+#include <cstdlib>
+#include <cstdio>
+
+namespace storage {
+
+/**
+ * The outcome of IpListLoader::load(), the lines with errors are skipped and the first error is kept.
+ */
+struct IpListStat {
+	size_t lines;
+	size_t addrs;
+	size_t nets;
+	size_t addrs6;
+	size_t nets6;
+	size_t errors; // the skipped lines
+	size_t error_line; // of the first error, from 1
+	size_t error_column; // of the first error, from 1
+	const char* error; // of the first error, nullptr - none
+
+	IpListStat() noexcept
+		: lines(0), addrs(0), nets(0), addrs6(0), nets6(0), errors(0), error_line(0), error_column(0), error(nullptr) {}
+
+	void print(FILE* out) const noexcept {
+		fprintf(out, "[IL] lines=%zu addrs=%zu nets=%zu addrs6=%zu nets6=%zu errors=%zu", lines, addrs, nets, addrs6, nets6, errors);
+		if(error) {
+			fprintf(out, " first='%s' at %zu:%zu", error, error_line, error_column);
+		}
+	}
+};
+
+}; // namespace storage
+
+#endif /* STORAGE_IPLISTSTAT_H */
@@ -4,14 +4,25 @@
 #include "../stack_ip/procotols/IPv4.h"
 #include "../intrusive_pool/HashQueuePool.h"
 #include "../intrusive_pool/DequePool.h"
+#include "PrefixTable.h"
+#include "CuckooFilter.h"
 #include "../dpdk/Allocator.h"
 
 #include <arpa/inet.h>
 
+#include <cassert>
 #include <cstdint>
 
 namespace storage {
 
+/**
+ * A table of IPv4 addresses and networks with FIFO eviction.
+ * The networks with prefix masks are looked up with a PrefixTable,
+ * the rest of them (non-contiguous masks, host bits in the network address) are scanned.
+ * The optional filter is a CuckooFilter of the individual addresses in front of the hash map, it is kept
+ * in step with append_addr(), the evictions and remove_addr(), so most of the missed addresses cost
+ * one or two cache lines of the filter instead of a bucket chain walk.
+ */
 class IpTable {
 	friend class TestIpTable;
 
@@ -26,7 +37,7 @@ private:
 	using NodeAddr_t = intrusive::HashQueuePoolEmptyNode<IPv4Addr_t>;
 	using PoolAddr_t = intrusive::HashQueuePool<
 		NodeAddr_t,
-		std::hash<IPv4Addr_t>,
+		intrusive::HashMix<IPv4Addr_t>,
 		dpdk::Allocator<NodeAddr_t>,
 		dpdk::Allocator<intrusive::HashMapBucket<NodeAddr_t> >
 	>;
@@ -38,18 +49,38 @@ private:
 	>;
 
 	using Iterator_t = typename PoolNet_t::Iterator_t;
+	using Prefixes_t = PrefixTable<dpdk::Allocator<uint32_t> >;
+	using Filter_t = CuckooFilter<dpdk::Allocator<uint64_t> >;
+
+	static constexpr size_t BULK_MAX = 32;
 
 	PoolAddr_t m_pool_addr;
 	PoolNet_t m_pool_net;
+	Prefixes_t m_prefixes;
+	size_t m_scanned_nets; // amount of the networks which are not in m_prefixes
+	const bool m_filtered;
+	Filter_t m_filter;
+	CuckooFilterMetrics m_filter_metrics;
 
 public:
 
-	IpTable(unsigned capacity_addr, float load_factor, unsigned capacity_net) noexcept
-		: m_pool_addr(capacity_addr, load_factor)
-		, m_pool_net(capacity_net) {};
+	/**
+	 * @param filter - true to put a CuckooFilter of capacity_addr addresses in front of the address lookups.
+	 */
+	IpTable(unsigned capacity_addr, float load_factor, unsigned capacity_net, bool filter = false) noexcept
+		: m_pool_addr(capacity_addr, load_factor, intrusive::HashMapSizing::POW2)
+		, m_pool_net(capacity_net)
+		, m_prefixes(size_t(capacity_net) * 2)
+		, m_scanned_nets(0)
+		, m_filtered(filter)
+		, m_filter(filter ? capacity_addr : 1)
+		, m_filter_metrics() {
+		m_filter.set_metrics(&m_filter_metrics);
+	};
 
 	int allocate() noexcept {
-		return m_pool_addr.allocate() || m_pool_net.allocate();
+		return m_pool_addr.allocate() || m_pool_net.allocate() || m_prefixes.allocate()
+			|| (m_filtered && m_filter.allocate());
 	}
 
 	/**
@@ -65,7 +96,76 @@ public:
 	 * @return true if the table contains addr as an individual IP address.
 	 */
 	inline bool find_in_addrs(IPv4Addr_t addr) const noexcept {
-		return m_pool_addr.find(addr) != m_pool_addr.cend();
+		if(m_filtered && not m_filter.contains_hash(filter_hash(addr))) {
+			return false;
+		}
+		const bool result = m_pool_addr.find(addr) != m_pool_addr.cend();
+		if(m_filtered && not result) {
+			m_filter.count_false_positive();
+		}
+		return result;
+	}
+
+	/**
+	 * Look up a burst of addresses, see find().
+	 * @param addrs - IP addresses.
+	 * @param n - amount of the addresses.
+	 * @param out - n results.
+	 */
+	inline void find_bulk(const IPv4Addr_t* addrs, size_t n, bool* out) const noexcept {
+		find_in_addrs_bulk(addrs, n, out);
+		for(size_t i = 0; i < n; i++) {
+			out[i] = out[i] || find_in_nets(addrs[i]);
+		}
+	}
+
+	/**
+	 * Look up a burst of individual IP addresses with one bulk lookup of the hash map.
+	 * With the filter the buckets of the filter are prefetched first and only the addresses which pass it
+	 * go to the hash map.
+	 * @param addrs - IP addresses.
+	 * @param n - amount of the addresses.
+	 * @param out - n results.
+	 */
+	inline void find_in_addrs_bulk(const IPv4Addr_t* addrs, size_t n, bool* out) const noexcept {
+		PoolAddr_t::ConstIterator_t found[BULK_MAX];
+		IPv4Addr_t passed[BULK_MAX];
+		size_t passed_idx[BULK_MAX];
+		for(size_t first = 0; first < n; first += BULK_MAX) {
+			const size_t count = (n - first) < BULK_MAX ? (n - first) : BULK_MAX;
+			if(not m_filtered) {
+				m_pool_addr.find_bulk(addrs + first, count, found);
+				for(size_t i = 0; i < count; i++) {
+					out[first + i] = found[i] != m_pool_addr.cend();
+				}
+				continue;
+			}
+			uint64_t hashes[BULK_MAX];
+			for(size_t i = 0; i < count; i++) {
+				hashes[i] = filter_hash(addrs[first + i]);
+				m_filter.prefetch_hash(hashes[i]);
+			}
+			size_t candidates = 0;
+			for(size_t i = 0; i < count; i++) {
+				out[first + i] = false;
+				if(m_filter.contains_hash(hashes[i])) {
+					passed[candidates] = addrs[first + i];
+					passed_idx[candidates] = first + i;
+					candidates++;
+				}
+			}
+			if(candidates == 0) {
+				continue;
+			}
+			m_pool_addr.find_bulk(passed, candidates, found);
+			for(size_t i = 0; i < candidates; i++) {
+				const bool result = found[i] != m_pool_addr.cend();
+				out[passed_idx[i]] = result;
+				if(not result) {
+					m_filter.count_false_positive();
+				}
+			}
+		}
 	}
 
 	/**
@@ -73,6 +173,12 @@ public:
 	* @return true if the table contains addr as a network address range.
 	*/
 	inline bool find_in_nets(IPv4Addr_t addr) const noexcept {
+		if(m_prefixes.find(addr)) {
+			return true;
+		}
+		if(not m_scanned_nets) {
+			return false;
+		}
 		for(auto it = m_pool_net.cbegin(); it != m_pool_net.cend(); ++it){
 			IPv4Addr_t network = addr & it->value.mask;
 			if(network == it->value.network){
@@ -87,9 +193,15 @@ public:
 	 */
 	inline void append_addr(IPv4Addr_t addr) noexcept {
 		if(not m_pool_addr.available()) {
-			m_pool_addr.pop_front();
+			auto evicted = m_pool_addr.pop_front();
+			if(m_filtered && evicted) {
+				m_filter.remove_hash(filter_hash(evicted->im_key));
+			}
+		}
+		auto it = m_pool_addr.push_back(addr);
+		if(m_filtered && it) {
+			m_filter.insert_hash(filter_hash(addr));
 		}
-		m_pool_addr.push_back(addr);
 	}
 
 	/**
@@ -98,12 +210,22 @@ public:
 	*/
 	inline void append_net(IPv4Addr_t net, IPv4Addr_t mask) noexcept {
 		if(not m_pool_net.available()) {
-			m_pool_net.pop_front();
+			auto evicted = m_pool_net.pop_front();
+			unindex_net(evicted->value);
 		}
 		auto it = m_pool_net.push_back();
 		if(it){
 			it->value.network = net;
 			it->value.mask = mask;
+			unsigned depth;
+			if(prefix_of(it->value, depth)) {
+				// every prefix takes up to 2 groups, so the groups cannot be exhausted
+				const bool inserted = m_prefixes.insert(net, depth);
+				assert(inserted);
+				(void) inserted;
+			} else {
+				m_scanned_nets++;
+			}
 		}
 	}
 
@@ -114,6 +236,9 @@ public:
 		auto it = m_pool_addr.find(addr);
 		if(it) {
 			m_pool_addr.remove(it);
+			if(m_filtered) {
+				m_filter.remove_hash(filter_hash(addr));
+			}
 		}
 	}
 
@@ -125,11 +250,48 @@ public:
 		for(auto it = m_pool_net.begin(); it != m_pool_net.end(); ++it){
 			if(net == it->value.network && mask == it->value.mask){
 				m_pool_net.remove(it);
+				unindex_net(it->value);
 				return;
 			}
 		}
 	}
 
+	/**
+	 * Remove all the addresses and the networks.
+	 */
+	void clear() noexcept {
+		m_pool_addr.reset();
+		m_pool_net.reset();
+		m_prefixes.reset();
+		m_scanned_nets = 0;
+		if(m_filtered) {
+			m_filter.clear();
+		}
+	}
+
+	/**
+	 * Walk the addresses in the order of their eviction, so appending them to an empty table of the same
+	 * capacity makes the same table (see Replication.h).
+	 * @param f - a functor which takes 'IPv4Addr_t'.
+	 */
+	template<typename F>
+	void for_each_addr(const F& f) const noexcept {
+		m_pool_addr.for_each([&f](const NodeAddr_t& node) noexcept {
+			f(node.im_key);
+		});
+	}
+
+	/**
+	 * Walk the networks in the order of their eviction.
+	 * @param f - a functor which takes 'IPv4Addr_t network, IPv4Addr_t mask'.
+	 */
+	template<typename F>
+	void for_each_net(const F& f) const noexcept {
+		for(auto it = m_pool_net.cbegin(); it != m_pool_net.cend(); ++it) {
+			f(it->value.network, it->value.mask);
+		}
+	}
+
 	size_t size_addr() const noexcept {
 		return m_pool_addr.size();
 	}
@@ -155,7 +317,30 @@ public:
 	}
 
 	inline size_t storage_bytes() noexcept {
-		return m_pool_addr.storage_bytes() + m_pool_net.storage_bytes();
+		return m_pool_addr.storage_bytes() + m_pool_net.storage_bytes() + m_prefixes.storage_bytes()
+			+ filter_bytes();
+	}
+
+	inline bool filtered() const noexcept {
+		return m_filtered;
+	}
+
+	inline size_t filter_bytes() const noexcept {
+		return m_filtered ? m_filter.storage_bytes() : 0;
+	}
+
+	/**
+	 * @return the expected false positive rate of the filter at its current load, 1 - if it has no filter.
+	 */
+	inline double filter_false_positive_rate() const noexcept {
+		return m_filtered ? m_filter.false_positive_rate() : 1.0;
+	}
+
+	/**
+	 * @return the measured answers of the filter, they are counted with -DMETRICS_ENABLED only.
+	 */
+	inline const CuckooFilterMetrics& filter_metrics() const noexcept {
+		return m_filter_metrics;
 	}
 
 	static IPv4Addr_t as_host_addr(unsigned b0, unsigned b1, unsigned b2, unsigned b3) noexcept {
@@ -178,6 +363,46 @@ public:
 		return htonl(addr);
 	}
 
+private:
+
+	static inline uint64_t filter_hash(IPv4Addr_t addr) noexcept {
+		return SketchHash::mix(addr);
+	}
+
+	/**
+	 * @return true - if the network is a prefix which can be held by m_prefixes.
+	 */
+	static inline bool prefix_of(const IPv4Network_t& net, unsigned& depth) noexcept {
+		return Prefixes_t::prefix_of(net.mask, depth) && (net.network & ~net.mask) == 0;
+	}
+
+	/**
+	 * Remove a network which has been removed from m_pool_net from the lookup structures.
+	 * The same prefix may stay in the pool, otherwise the longest covering one takes its place.
+	 */
+	void unindex_net(const IPv4Network_t& removed) noexcept {
+		unsigned depth;
+		if(not prefix_of(removed, depth)) {
+			m_scanned_nets--;
+			return;
+		}
+		unsigned cover = Prefixes_t::NO_DEPTH;
+		for(auto it = m_pool_net.cbegin(); it != m_pool_net.cend(); ++it) {
+			unsigned other;
+			if(not prefix_of(it->value, other) || other > depth || (removed.network & it->value.mask) != it->value.network) {
+				continue;
+			}
+			if(other == depth) {
+				// the same prefix is still in the pool
+				return;
+			}
+			if(cover == Prefixes_t::NO_DEPTH || other > cover) {
+				cover = other;
+			}
+		}
+		m_prefixes.remove(removed.network, depth, cover);
+	}
+
 };
 
 }; // namespace storage
@@ -0,0 +1,288 @@
+#ifndef STORAGE_MACTABLE_H
+#define STORAGE_MACTABLE_H
+
+#include "TimedQueue.h"
+#include "Clock.h"
+#include "../../cli/types/MacAddress.h"
+#include "../../proto/parsers/ParsedPacket.h"
+
+#include <cstdint>
+#include <cstring>
+
+namespace storage {
+
+/**
+ * A learned station, @generation is of its port when it has been learned, see MacTable::flush(port).
+ */
+struct MacEntry {
+	uint32_t generation;
+	uint16_t port;
+
+	MacEntry() noexcept : generation(0), port(0) {}
+};
+
+struct MacTableStat {
+	uint64_t learned; // the new stations
+	uint64_t moved; // the stations learned on another port
+	uint64_t refreshed; // the stations learned on the same port again
+	uint64_t hits;
+	uint64_t misses; // the lookups to flood, the flushed stations included
+	uint64_t aged;
+	uint64_t evicted; // the oldest stations removed for the new ones when the table is full
+	uint64_t flushes; // flush(port) calls
+
+	MacTableStat() noexcept
+		: learned(0), moved(0), refreshed(0), hits(0), misses(0), aged(0), evicted(0), flushes(0) {}
+};
+
+/**
+ * MacTable is the forwarding database of a software bridge: it maps (VLAN, MAC) to the port the station
+ * has been seen on. The stations are kept in a TimedQueue which a learn() refreshes, so they are aged in the LRU
+ * order by expire() after aging_ms without a frame from them, and the oldest one is evicted for a new one
+ * when the table is full. A lookup doesn't refresh a station, as the bridges age by the source addresses only.
+ * The key packs the 12 bits of the VLAN id and the 48 bits of the MAC into an integer (see key()).
+ * flush(port) is O(1): it bumps the generation of the port, the entries of the older generations are misses
+ * and they are dropped when they are learned again or aged.
+ * All the entries are allocated by allocate() and there is no lock, a table is per core.
+ *
+ * Using sample:
+ * MacTable<> table(1 << 16);
+ * table.allocate();
+ * for each burst:
+ *     for each frame:
+ *         table.learn(MacTable<>::src_key(frame, pkt), in_port);
+ *         out_port = table.lookup(MacTable<>::dst_key(frame, pkt)); // FLOOD - to all the ports
+ *     table.expire();
+ *
+ * @tparam P - amount of the ports, a port is in [0, P).
+ * @tparam C - the clock source, see Clock.h.
+ */
+template<size_t P = 256, typename C = CoarseClock>
+class MacTable {
+	friend class TestMacTable;
+
+public:
+	using Key_t = uint64_t;
+
+	static constexpr uint16_t FLOOD = 0xFFFF; // the port of a missed lookup
+	static constexpr unsigned AGING_MS = 300000; // the default of 802.1D
+	static constexpr size_t BULK_MAX = 32;
+
+private:
+	static_assert(P > 0 && P < FLOOD, "MacTable::P is in [1, FLOOD)");
+
+	using Node_t = TimedQueueNode<Key_t, MacEntry>;
+	using Queue_t = TimedQueue<Node_t, intrusive::HashMix<Key_t>, intrusive::HashMapBucket<Node_t>, C>;
+	using Iterator_t = typename Queue_t::Iterator_t;
+
+	Queue_t m_queue;
+	const size_t m_capacity;
+	uint64_t m_aging; // clock ticks
+	MacTableStat m_stat;
+	uint32_t m_generations[P];
+
+public:
+
+	/**
+	 * @param capacity - amount of the stations.
+	 * @param aging_ms - a station is removed if it has sent no frame for this time.
+	 */
+	MacTable(size_t capacity, unsigned aging_ms = AGING_MS, float load_factor = 1.0f) noexcept
+		: m_queue(capacity, load_factor)
+		, m_capacity(capacity)
+		, m_aging(0)
+		, m_stat()
+		, m_generations() {
+		m_aging = uint64_t(aging_ms) * m_queue.clock().hz() / 1000;
+	}
+
+	MacTable(const MacTable&) = delete;
+	MacTable& operator=(const MacTable&) = delete;
+
+	MacTable(MacTable&&) = delete;
+	MacTable& operator=(MacTable&&) = delete;
+
+	int allocate() noexcept {
+		return m_queue.allocate();
+	}
+
+	static inline Key_t key(uint16_t vlan, const cli::MacAddress& mac) noexcept {
+		return (Key_t(vlan & 0xFFF) << 48) | mac.value();
+	}
+
+	/**
+	 * @return the key of the source station of a frame on its outer VLAN (0 - untagged).
+	 */
+	static inline Key_t src_key(const uint8_t* frame, const proto::ParsedPacket& pkt) noexcept {
+		return key(vlan_of(pkt), cli::MacAddress(frame + cli::MacAddress::ADDR_SIZE, cli::MacAddress::ADDR_SIZE));
+	}
+
+	static inline Key_t dst_key(const uint8_t* frame, const proto::ParsedPacket& pkt) noexcept {
+		return key(vlan_of(pkt), cli::MacAddress(frame, cli::MacAddress::ADDR_SIZE));
+	}
+
+	/**
+	 * Learn or refresh the port of a source station.
+	 * @return false - if the port is out of [0, P).
+	 */
+	bool learn(Key_t key, uint16_t port) noexcept {
+		if(port >= P) {
+			return false;
+		}
+		bool pushed;
+		Iterator_t it = m_queue.touch_or_push(key, pushed);
+		if(not it) {
+			evict();
+			it = m_queue.touch_or_push(key, pushed);
+		}
+		if(it) {
+			update(it->value, pushed, port);
+		}
+		return true;
+	}
+
+	/**
+	 * Learn a burst of source stations with one bulk lookup of the known ones, see learn().
+	 * @param ports - n ports, the stations of the ports out of [0, P) are skipped.
+	 */
+	void learn_bulk(const Key_t* keys, const uint16_t* ports, size_t n) noexcept {
+		Iterator_t found[BULK_MAX];
+		for(size_t first = 0; first < n; first += BULK_MAX) {
+			const size_t count = (n - first) < BULK_MAX ? (n - first) : BULK_MAX;
+			m_queue.find_bulk(keys + first, count, found);
+			// the known stations are refreshed before an eviction of the new ones may remove them
+			for(size_t i = 0; i < count; i++) {
+				if(found[i] && ports[first + i] < P) {
+					m_queue.touch(found[i]);
+					update(found[i]->value, false, ports[first + i]);
+				}
+			}
+			for(size_t i = 0; i < count; i++) {
+				if(not found[i]) {
+					learn(keys[first + i], ports[first + i]);
+				}
+			}
+		}
+	}
+
+	/**
+	 * @return the port of a destination station, FLOOD - if it is not known.
+	 */
+	inline uint16_t lookup(Key_t key) noexcept {
+		Iterator_t it = m_queue.find(key);
+		return port_of(it);
+	}
+
+	/**
+	 * Look up a burst of destination stations, see lookup().
+	 * @param out - n ports.
+	 */
+	void lookup_bulk(const Key_t* keys, size_t n, uint16_t* out) noexcept {
+		Iterator_t found[BULK_MAX];
+		for(size_t first = 0; first < n; first += BULK_MAX) {
+			const size_t count = (n - first) < BULK_MAX ? (n - first) : BULK_MAX;
+			m_queue.find_bulk(keys + first, count, found);
+			for(size_t i = 0; i < count; i++) {
+				out[first + i] = port_of(found[i]);
+			}
+		}
+	}
+
+	/**
+	 * Forget the stations of a port, e.g. when its link goes down or the topology changes.
+	 */
+	inline void flush(uint16_t port) noexcept {
+		if(port < P) {
+			m_generations[port]++;
+			m_stat.flushes++;
+		}
+	}
+
+	/**
+	 * Forget all the stations.
+	 */
+	void flush() noexcept {
+		while(m_queue.pop_front(0)) {
+		}
+	}
+
+	/**
+	 * Remove the stations which haven't sent a frame for the aging time, e.g. once per burst.
+	 */
+	void expire() noexcept {
+		while(m_queue.pop_front(m_aging)) {
+			m_stat.aged++;
+		}
+	}
+
+	/**
+	 * @return the clock source, e.g. to set the time of a burst.
+	 */
+	inline C& clock() noexcept {
+		return m_queue.clock();
+	}
+
+	/**
+	 * @return amount of the entries, the flushed ones which are not dropped yet included.
+	 */
+	inline size_t size() const noexcept {
+		return m_queue.size();
+	}
+
+	inline size_t capacity() const noexcept {
+		return m_capacity;
+	}
+
+	inline const MacTableStat& stat() const noexcept {
+		return m_stat;
+	}
+
+	inline size_t storage_bytes() noexcept {
+		return m_queue.storage_bytes();
+	}
+
+private:
+
+	static inline uint16_t vlan_of(const proto::ParsedPacket& pkt) noexcept {
+		return pkt.vlan_count ? pkt.vlan[0] : 0;
+	}
+
+	inline bool current(const MacEntry& entry) const noexcept {
+		return entry.generation == m_generations[entry.port];
+	}
+
+	inline void update(MacEntry& entry, bool pushed, uint16_t port) noexcept {
+		if(pushed || not current(entry)) {
+			m_stat.learned++;
+		} else if(entry.port != port) {
+			m_stat.moved++;
+		} else {
+			m_stat.refreshed++;
+		}
+		entry.port = port;
+		entry.generation = m_generations[port];
+	}
+
+	inline uint16_t port_of(Iterator_t it) noexcept {
+		if(it && current(it->value)) {
+			m_stat.hits++;
+			return it->value.port;
+		}
+		m_stat.misses++;
+		return FLOOD;
+	}
+
+	/**
+	 * Remove the station with the oldest frame.
+	 */
+	void evict() noexcept {
+		if(m_queue.pop_front(0)) {
+			m_stat.evicted++;
+		}
+	}
+
+};
+
+}; // namespace storage
+
+#endif /* STORAGE_MACTABLE_H */
@@ -0,0 +1,278 @@
+#ifndef STORAGE_PREFIXTABLE_H
+#define STORAGE_PREFIXTABLE_H
+
+#include <bits/allocator.h>
+
+#include <cstdint>
+#include <cstdlib>
+
+namespace storage {
+
+/**
+ * A longest prefix match table of IPv4 prefixes, a multibit trie with 16-8-8 strides (DIR-16-8-8).
+ * The root table is indexed with the upper 16 bits of an address,
+ * the longer prefixes are expanded to groups of 256 entries indexed with the next 8 bits,
+ * so a lookup takes at most 3 memory accesses.
+ *
+ * Every entry holds the depth of the longest prefix which covers it (plus one, 0 means no prefix),
+ * or an index of a group. The table doesn't keep the prefixes itself,
+ * so remove() requires the depth of the longest remaining prefix which covers the removed one.
+ * Groups which become uniform are returned to the group pool.
+ *
+ * Addresses are in host byte order.
+ *
+ * @tparam A - an allocator of the entries.
+ */
+template<typename A = std::allocator<uint32_t> >
+class PrefixTable {
+	friend class TestPrefixTable;
+
+	static constexpr size_t ROOT_SIZE = size_t(1) << 16;
+	static constexpr size_t GROUP_SIZE = size_t(1) << 8;
+	static constexpr uint32_t GROUP = 0x80000000u; // the entry is an index of a group
+
+	const size_t m_groups;
+	uint32_t* m_entries; // the root table, then the groups
+	uint32_t* m_free; // the stack of the free group indexes
+	size_t m_free_size;
+	A m_allocator;
+
+public:
+	static constexpr unsigned NO_DEPTH = ~0u;
+
+	/**
+	 * @param groups - amount of 256 entry groups, a prefix longer than 16 bits takes up to 2 groups.
+	 */
+	PrefixTable(size_t groups) noexcept
+		: m_groups(groups)
+		, m_entries(nullptr)
+		, m_free(nullptr)
+		, m_free_size(0)
+		, m_allocator() {}
+
+	PrefixTable(const PrefixTable&) = delete;
+	PrefixTable& operator=(const PrefixTable&) = delete;
+
+	PrefixTable(PrefixTable&&) = delete;
+	PrefixTable& operator=(PrefixTable&&) = delete;
+
+	virtual ~PrefixTable() noexcept {
+		destroy();
+	}
+
+	/**
+	 * Allocate the entries.
+	 * @return 0 - if the table has been allocated successfully.
+	 */
+	int allocate() noexcept {
+		if(m_entries)
+			return -1;
+
+		m_entries = m_allocator.allocate(entries());
+		if(m_entries == nullptr)
+			return -1;
+
+		m_free = m_allocator.allocate(m_groups ? m_groups : 1);
+		if(m_free == nullptr) {
+			destroy();
+			return -1;
+		}
+		reset();
+		return 0;
+	}
+
+	/**
+	 * @param addr - an IPv4 address.
+	 * @return true - if a prefix covers the address.
+	 */
+	inline bool find(uint32_t addr) const noexcept {
+		return lookup(addr) != 0;
+	}
+
+	/**
+	 * @param addr - an IPv4 address.
+	 * @return the depth of the longest prefix which covers the address or NO_DEPTH.
+	 */
+	inline unsigned depth(uint32_t addr) const noexcept {
+		return lookup(addr) - 1;
+	}
+
+	/**
+	 * Insert a prefix, inserting the same prefix again changes nothing.
+	 * @param net - the network address, the bits beyond the depth must be zero.
+	 * @param depth - the prefix length [0, 32].
+	 * @return true - if the prefix has been inserted, false if the groups are exhausted.
+	 */
+	bool insert(uint32_t net, unsigned depth) noexcept {
+		if(depth > 32)
+			return false;
+
+		return insert(m_entries, 0, net, depth);
+	}
+
+	/**
+	 * Remove a prefix.
+	 * @param net - the network address.
+	 * @param depth - the prefix length.
+	 * @param cover - the depth of the longest remaining prefix which covers the removed one or NO_DEPTH.
+	 */
+	void remove(uint32_t net, unsigned depth, unsigned cover) noexcept {
+		if(depth > 32)
+			return;
+
+		remove(m_entries, 0, net, depth, cover + 1);
+	}
+
+	void reset() noexcept {
+		for(size_t i = 0; i < ROOT_SIZE; i++) {
+			m_entries[i] = 0;
+		}
+		m_free_size = 0;
+		for(size_t i = m_groups; i > 0; i--) {
+			m_free[m_free_size++] = uint32_t(i - 1);
+		}
+	}
+
+	inline size_t groups() const noexcept {
+		return m_groups;
+	}
+
+	inline size_t groups_used() const noexcept {
+		return m_groups - m_free_size;
+	}
+
+	inline size_t storage_bytes() const noexcept {
+		return entries() * sizeof(uint32_t) + m_groups * sizeof(uint32_t);
+	}
+
+	/**
+	 * @return true - if 'mask' is a prefix mask, 'depth' is set to its length then.
+	 */
+	static inline bool prefix_of(uint32_t mask, unsigned& depth) noexcept {
+		const uint32_t inverted = ~mask;
+		depth = unsigned(__builtin_popcount(mask));
+		return (inverted & (inverted + 1)) == 0;
+	}
+
+private:
+
+	inline uint32_t lookup(uint32_t addr) const noexcept {
+		uint32_t entry = m_entries[addr >> 16];
+		if(entry & GROUP) {
+			entry = group(entry)[(addr >> 8) & 0xFF];
+			if(entry & GROUP) {
+				entry = group(entry)[addr & 0xFF];
+			}
+		}
+		return entry;
+	}
+
+	inline size_t entries() const noexcept {
+		return ROOT_SIZE + m_groups * GROUP_SIZE;
+	}
+
+	inline uint32_t* group(uint32_t entry) const noexcept {
+		return m_entries + ROOT_SIZE + size_t(entry & ~GROUP) * GROUP_SIZE;
+	}
+
+	static inline unsigned last_depth(unsigned level) noexcept {
+		return 16 + level * 8;
+	}
+
+	static inline size_t index(unsigned level, uint32_t net) noexcept {
+		return level ? (net >> (32 - last_depth(level))) & 0xFF : net >> 16;
+	}
+
+	bool insert(uint32_t* table, unsigned level, uint32_t net, unsigned depth) noexcept {
+		const size_t id = index(level, net);
+		if(depth <= last_depth(level)) {
+			const size_t count = size_t(1) << (last_depth(level) - depth);
+			for(size_t i = id; i < id + count; i++) {
+				raise(table[i], depth + 1);
+			}
+			return true;
+		}
+		if(not(table[id] & GROUP)) {
+			if(not m_free_size)
+				return false;
+
+			const uint32_t group_id = m_free[--m_free_size];
+			uint32_t* entries = m_entries + ROOT_SIZE + size_t(group_id) * GROUP_SIZE;
+			for(size_t i = 0; i < GROUP_SIZE; i++) {
+				entries[i] = table[id];
+			}
+			table[id] = GROUP | group_id;
+		}
+		return insert(group(table[id]), level + 1, net, depth);
+	}
+
+	void raise(uint32_t& entry, uint32_t value) noexcept {
+		if(entry & GROUP) {
+			uint32_t* entries = group(entry);
+			for(size_t i = 0; i < GROUP_SIZE; i++) {
+				raise(entries[i], value);
+			}
+		} else if(entry < value) {
+			entry = value;
+		}
+	}
+
+	void remove(uint32_t* table, unsigned level, uint32_t net, unsigned depth, uint32_t cover) noexcept {
+		const size_t id = index(level, net);
+		if(depth <= last_depth(level)) {
+			const size_t count = size_t(1) << (last_depth(level) - depth);
+			for(size_t i = id; i < id + count; i++) {
+				lower(table[i], depth + 1, cover);
+			}
+		} else if(table[id] & GROUP) {
+			remove(group(table[id]), level + 1, net, depth, cover);
+			collapse(table[id]);
+		}
+	}
+
+	void lower(uint32_t& entry, uint32_t value, uint32_t cover) noexcept {
+		if(entry & GROUP) {
+			uint32_t* entries = group(entry);
+			for(size_t i = 0; i < GROUP_SIZE; i++) {
+				lower(entries[i], value, cover);
+			}
+			collapse(entry);
+		} else if(entry == value) {
+			entry = cover;
+		}
+	}
+
+	/**
+	 * Replace a group with its value if all the entries of the group are the same.
+	 */
+	void collapse(uint32_t& entry) noexcept {
+		const uint32_t* entries = group(entry);
+		const uint32_t value = entries[0];
+		if(value & GROUP)
+			return;
+
+		for(size_t i = 1; i < GROUP_SIZE; i++) {
+			if(entries[i] != value)
+				return;
+		}
+		m_free[m_free_size++] = entry & ~GROUP;
+		entry = value;
+	}
+
+	void destroy() noexcept {
+		if(m_entries) {
+			m_allocator.deallocate(m_entries, entries());
+			m_entries = nullptr;
+		}
+		if(m_free) {
+			m_allocator.deallocate(m_free, m_groups ? m_groups : 1);
+			m_free = nullptr;
+		}
+		m_free_size = 0;
+	}
+
+};
+
+}; // namespace storage
+
+#endif /* STORAGE_PREFIXTABLE_H */
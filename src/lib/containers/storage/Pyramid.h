@@ -3,17 +3,32 @@
 
 #include <cstdint>
 #include <cstdlib>
-#include <cmath>
+#include <algorithm>
+#include <functional>
+#include <utility>
 
 namespace storage {
 
-template<typename T>
+/**
+ * A D-ary heap over an external array, the children of a node are adjacent: child(i, k) = i * D + k + 1.
+ * A 4- or 8-ary heap takes less levels and cache misses per a sift than the binary one,
+ * the D children take one cache line if D * sizeof(T) == 64 and the storage is shifted so m_head + 1 is line-aligned.
+ * The pyramid is used either as a max-heap (build(), insert(), pop(), heap_sort())
+ * or as a bounded top-K heap (push_top(), top_sort()), the modes must not be mixed on the same elements.
+ * @tparam C - the "less" comparator, the max-heap keeps the greatest element in the root,
+ * the top-K heap keeps the capacity() greatest elements with the least of them in the root.
+ * @tparam D - the node children number, 2 - for the binary heap.
+ */
+template<typename T, typename C = std::less<T>, unsigned D = 2>
 class Pyramid {
 	friend class TestPyramid;
 
+	static_assert(D >= 2, "Template argument 'D' must be at least 2.");
+
 	T* m_head;
 	size_t m_size;
 	size_t m_capacity;
+	C m_less;
 
 public:
 	using Height_t = uint8_t;
@@ -21,7 +36,8 @@ public:
 	Pyramid(T* head, size_t capacity) noexcept
 		: m_head(head)
 		, m_size(0)
-		, m_capacity(capacity) {}
+		, m_capacity(capacity)
+		, m_less() {}
 
 	inline const T* begin() const noexcept {
 		return m_head;
@@ -55,8 +71,19 @@ public:
 		return m_capacity;
 	}
 
-	inline Height_t height() const noexcept {
-		return std::ceil(std::log2(m_size + 1));
+	/**
+	 * @return amount of the layers, the last one may be incomplete.
+	 */
+	Height_t height() const noexcept {
+		Height_t result = 0;
+		size_t layers_size = 0;
+		size_t width = 1;
+		while(layers_size < m_size) {
+			layers_size += std::min(width, m_size - layers_size);
+			width = width > m_size / D ? m_size : width * D;
+			result++;
+		}
+		return result;
 	}
 
 	size_t build(size_t size) noexcept {
@@ -72,11 +99,35 @@ public:
 		return m_size;
 	}
 
-	void insert(const T& element) noexcept {
+	/**
+	 * @return false - if the pyramid is full and the element has been dropped, see push_top().
+	 */
+	bool insert(const T& element) noexcept {
 		if(m_size < m_capacity) {
 			m_head[m_size++] = element;
 			leaf_up_max(m_size - 1);
+			return true;
 		}
+		return false;
+	}
+
+	/**
+	 * Offer an element to the top-K heap: it is kept while the heap is not full,
+	 * it replaces the root (the least of the kept elements) if it is greater afterwards.
+	 * @return true - if the element has been kept.
+	 */
+	bool push_top(const T& element) noexcept {
+		if(m_size < m_capacity) {
+			m_head[m_size++] = element;
+			leaf_up_min(m_size - 1);
+			return true;
+		}
+		if(m_size && m_less(*m_head, element)) {
+			*m_head = element;
+			node_down_min(0);
+			return true;
+		}
+		return false;
 	}
 
 	inline const T* peek() const noexcept {
@@ -101,8 +152,9 @@ public:
 			*m_head = m_head[m_size - 1];
 			m_size--;
 			node_down_max(0);
+			return true;
 		}
-		return true;
+		return false;
 	}
 
 	inline void pop_swap() noexcept {
@@ -113,85 +165,106 @@ public:
 		}
 	}
 
+	/**
+	 * Sort the max-heap in place in the ascending order.
+	 * The pyramid is empty afterwards, the sorted elements stay in the storage.
+	 * @return amount of the sorted elements.
+	 */
+	size_t heap_sort() noexcept {
+		const size_t result = m_size;
+		while(m_size > 1) {
+			std::swap(*m_head, m_head[m_size - 1]);
+			m_size--;
+			node_down_max(0);
+		}
+		m_size = 0;
+		return result;
+	}
+
+	/**
+	 * Sort the top-K heap in place in the descending order, so the greatest element comes first.
+	 * The pyramid is empty afterwards, the sorted elements stay in the storage.
+	 * @return amount of the sorted elements.
+	 */
+	size_t top_sort() noexcept {
+		const size_t result = m_size;
+		while(m_size > 1) {
+			std::swap(*m_head, m_head[m_size - 1]);
+			m_size--;
+			node_down_min(0);
+		}
+		m_size = 0;
+		return result;
+	}
+
 
 private:
 
-	void node_down_min(size_t index_node) noexcept {
-		if(is_node(index_node)) {
-			size_t index_left = left(index_node);
-			size_t index_right = right(index_node);
+	/**
+	 * The sifts move the sifted element into a hole instead of swapping it at every level.
+	 * @tparam MAX - true for the max-heap, false for the top-K heap.
+	 */
+	template<bool MAX>
+	inline bool above(const T& a, const T& b) const noexcept {
+		return MAX ? m_less(b, a) : m_less(a, b);
+	}
 
-			size_t index_min = index_node;
-			if(m_head[index_left] < m_head[index_min]) {
-				index_min = index_left;
-			}
-			if(index_right < m_size && m_head[index_right] < m_head[index_min]) {
-				index_min = index_right;
+	template<bool MAX>
+	void node_down(size_t index_node) noexcept {
+		const size_t first_leaf_index = first_leaf();
+		if(index_node >= first_leaf_index) {
+			return;
+		}
+		T element = std::move(m_head[index_node]);
+		while(index_node < first_leaf_index) {
+			const size_t index_first = child(index_node, 0);
+			const size_t index_last = std::min(index_first + D, m_size);
+			size_t index_top = index_first;
+			for(size_t i = index_first + 1; i < index_last; ++i) {
+				if(above<MAX>(m_head[i], m_head[index_top])) {
+					index_top = i;
+				}
 			}
-			if(index_min != index_node) {
-				std::swap(m_head[index_node], m_head[index_min]);
-				node_down_min(index_min);
+			if(not above<MAX>(m_head[index_top], element)) {
+				break;
 			}
+			m_head[index_node] = std::move(m_head[index_top]);
+			index_node = index_top;
 		}
+		m_head[index_node] = std::move(element);
 	}
 
-	void node_down_max(size_t index_node) noexcept {
-		if(is_node(index_node)) {
-			size_t index_left = left(index_node);
-			size_t index_right = right(index_node);
-
-			size_t index_max = index_node;
-			if(m_head[index_left] > m_head[index_max]) {
-				index_max = index_left;
-			}
-			if(index_right < m_size && m_head[index_right] > m_head[index_max]) {
-				index_max = index_right;
-			}
-			if(index_max != index_node) {
-				std::swap(m_head[index_node], m_head[index_max]);
-				node_down_max(index_max);
+	template<bool MAX>
+	void leaf_up(size_t index_leaf) noexcept {
+		if(index_leaf == 0) {
+			return;
+		}
+		T element = std::move(m_head[index_leaf]);
+		while(index_leaf > 0) {
+			const size_t index_parent = parent(index_leaf);
+			if(not above<MAX>(element, m_head[index_parent])) {
+				break;
 			}
+			m_head[index_leaf] = std::move(m_head[index_parent]);
+			index_leaf = index_parent;
 		}
+		m_head[index_leaf] = std::move(element);
 	}
 
-	void leaf_up_min(size_t index_leaf) noexcept {
-		if(index_leaf > 0) {
-			size_t index_parent = parent(index_leaf);
-			size_t index_left = left(index_parent);
-			size_t index_right = right(index_parent);
+	inline void node_down_min(size_t index_node) noexcept {
+		node_down<false>(index_node);
+	}
 
-			size_t index_min = index_parent;
-			if(m_head[index_left] < m_head[index_min]) {
-				index_min = index_left;
-			}
-			if(index_right < m_size && m_head[index_right] < m_head[index_min]) {
-				index_min = index_right;
-			}
-			if(index_min != index_parent) {
-				std::swap(m_head[index_parent], m_head[index_min]);
-				leaf_up_min(index_parent);
-			}
-		}
+	inline void node_down_max(size_t index_node) noexcept {
+		node_down<true>(index_node);
 	}
 
-	void leaf_up_max(size_t index_leaf) noexcept {
-		if(index_leaf > 0) {
-			size_t index_parent = parent(index_leaf);
-			size_t index_left = left(index_parent);
-			size_t index_right = right(index_parent);
+	inline void leaf_up_min(size_t index_leaf) noexcept {
+		leaf_up<false>(index_leaf);
+	}
 
-			size_t index_max = index_parent;
-			if(m_head[index_left] > m_head[index_max]) {
-				index_max = index_left;
-			}
-			if(index_right < m_size && m_head[index_right] > m_head[index_max]) {
-				index_max = index_right;
-			}
-			if(index_max != index_parent) {
-				std::swap(m_head[index_parent], m_head[index_max]);
-				leaf_up_max(index_parent);
-			}
-		}
+	inline void leaf_up_max(size_t index_leaf) noexcept {
+		leaf_up<true>(index_leaf);
 	}
 
 	inline size_t leaves() const noexcept {
@@ -199,7 +272,7 @@ private:
 	}
 
 	inline size_t first_leaf() const noexcept {
-		return (m_size >> 1);
+		return (m_size > 1 ? (m_size - 2) / D + 1 : 0);
 	}
 
 	inline bool is_node(size_t index) noexcept {
@@ -208,23 +281,34 @@ private:
 
 	// common indexing
 
+	static inline size_t child(size_t index, size_t number) noexcept {
+		return index * D + number + 1;
+	}
+
 	static inline size_t left(size_t index) noexcept {
-		return (index << 1) | size_t(1);
+		return child(index, 0);
 	}
 
 	static inline size_t right(size_t index) noexcept {
-		return (index + size_t(1)) << 1;
+		return child(index, 1);
 	}
 
 	static inline size_t parent(size_t index) noexcept {
-		return (index - size_t(1)) >> 1;
+		return (index - size_t(1)) / D;
 	}
 
+	/**
+	 * @return the index of the first element of the layer, 0 - if the layer doesn't fit into size_t.
+	 */
 	static inline size_t layer_offset(Height_t layer) noexcept {
 		size_t result = 0;
-		if(layer < sizeof(size_t) * 8) {
-			result = size_t(1) << size_t(layer);
-			result--;
+		size_t width = 1;
+		for(Height_t i = 0; i < layer; ++i) {
+			if(width > ~result) {
+				return 0;
+			}
+			result += width;
+			width = width > ~size_t(0) / D ? ~size_t(0) : width * D;
 		}
 		return result;
 	}
@@ -2,28 +2,32 @@
 #define STORAGE_RATELIMITER_H
 
 #include "RateLimiterStat.h"
+#include "RateLimiterPolicy.h"
+#include "Clock.h"
 #include "../intrusive_pool/HashQueuePool.h"
 #include "../dpdk/Allocator.h"
 
-#include <rte_cycles.h>
-
 #include <cstdint>
 #include <cstdio>
 #include <ctime>
 
 namespace storage {
 
-template<typename K>
+/**
+ * @tparam P - the limiting policy, see RateLimiterPolicy.h.
+ */
+template<typename K, template<typename, typename> class MH = intrusive::HashMapHook, typename P = RateLimiterPeriod>
 struct RateLimiterNode
-	: public intrusive::LinkedListHook<RateLimiterNode<K> >, intrusive::HashMapHook<K, RateLimiterNode<K> > {
-	template<typename Tmp1, typename Tmp2>
+	: public intrusive::LinkedListHook<RateLimiterNode<K, MH, P> >, MH<K, RateLimiterNode<K, MH, P> > {
+	template<typename Tmp1, typename Tmp2, typename Tmp3, typename Tmp4>
 	friend
 	class RateLimiter;
 
 private:
-	uint64_t time;
+	typename P::State state;
 public:
 	using Key_t = K;
+	using Policy_t = P;
 
 	RateLimiterNode() = default;
 
@@ -35,17 +39,31 @@ public:
 
 };
 
+/**
+ * A per-key rate limiter, the limiting policy is selected with the node type (see RateLimiterNode).
+ * The state of a key is updated in place with one lookup,
+ * the keys are evicted in the order of their last check when the limiter is full.
+ *
+ * @tparam B - a bucket type which selects the HashMap layout, see HashMap.h for more details.
+ * @tparam C - the clock source, the policy configs are in its ticks (see Clock.h).
+ */
 template<
 	typename Node_t,
-	typename H = std::hash<typename Node_t::Key_t>
+	typename H = std::hash<typename Node_t::Key_t>,
+	typename B = intrusive::HashMapBucket<Node_t>,
+	typename C = TscClock
 >
 class RateLimiter {
 	friend class TestRateLimiter;
 
-	using Pool_t = intrusive::HashQueuePool<Node_t, H, dpdk::Allocator<Node_t>, dpdk::Allocator<intrusive::HashMapBucket<Node_t> > >;
+	using Pool_t = intrusive::HashQueuePool<Node_t, H, dpdk::Allocator<Node_t>, dpdk::Allocator<B> >;
+
+	static constexpr size_t BULK_MAX = 32;
+
 	Pool_t m_pool;
 	const size_t m_capacity;
-	uint64_t m_period;
+	typename Node_t::Policy_t::Config m_config;
+	C m_clock;
 
 	std::time_t m_push_time;
 	RateLimiterStat m_stat;
@@ -54,41 +72,87 @@ public:
 
 	using Key_t = typename Node_t::Key_t;
 	using Iterator_t = typename Pool_t::Iterator_t;
+	using Policy_t = typename Node_t::Policy_t;
+	using Config_t = typename Policy_t::Config;
 
-	RateLimiter(size_t capacity, float load_factor) noexcept
-		: m_pool(capacity, load_factor)
+	RateLimiter(size_t capacity, float load_factor, intrusive::HashMapSizing sizing = intrusive::HashMapSizing::EXACT) noexcept
+		: m_pool(capacity, load_factor, sizing)
 		, m_capacity(capacity)
+		, m_config()
+		, m_clock()
 		, m_push_time(0)
 		, m_stat() {}
 
+	/**
+	 * RateLimiterPeriod only.
+	 * @param period - clock ticks between the allowed events of a key.
+	 */
 	void set_period(uint64_t period) noexcept {
-		m_period = period;
+		m_config.period = period;
+	}
+
+	/**
+	 * @param config - the policy config, it affects the keys in use as well.
+	 */
+	void set_config(const Config_t& config) noexcept {
+		m_config = config;
+	}
+
+	inline const Config_t& config() const noexcept {
+		return m_config;
+	}
+
+	/**
+	 * @return the clock source, e.g. to set the time of a burst.
+	 */
+	inline C& clock() noexcept {
+		return m_clock;
 	}
 
 	int allocate() noexcept {
 		return m_pool.allocate();
 	}
 
-	bool check(const Key_t& key) noexcept {
-		bool result = true;
-		uint64_t current = rte_rdtsc();
-		auto it = m_pool.find(key);
-		if(it) {
-			if(current - it->time > m_period) {
-				m_pool.remove(it);
-				it = m_pool.push_back(key);
-				it->time = current;
-			} else {
-				result = false;
-			}
-		} else {
-			if(not m_pool.available()) {
-				m_pool.pop_front();
+	/**
+	 * @param key - the key of the event.
+	 * @param cost - the weight of the event, e.g. the length of a packet for the byte based policies.
+	 * @return true - if the event is allowed, false - if it is limited or its new key has got no node (RateLimiterStat::dropped).
+	 */
+	inline bool check(const Key_t& key, uint64_t cost = 1) noexcept {
+		return check(key, cost, m_clock.now());
+	}
+
+	/**
+	 * @param now - the current clock tick, e.g. taken once per burst.
+	 */
+	inline bool check(const Key_t& key, uint64_t cost, uint64_t now) noexcept {
+		return check_found(key, m_pool.find(key), cost, now);
+	}
+
+	/**
+	 * Check a burst of keys, the lookups of the burst are done in bulk (see intrusive::HashMap::find_bulk()).
+	 * The keys are checked in order, so the result is the same as calling check() for each of them.
+	 * @param keys - the keys to check.
+	 * @param n - amount of the keys.
+	 * @param out - n results of check().
+	 * @param costs - n weights of the events, nullptr makes every cost 1.
+	 */
+	void check_bulk(const Key_t* keys, size_t n, bool* out, const uint64_t* costs = nullptr) noexcept {
+		Iterator_t found[BULK_MAX];
+		const uint64_t current = m_clock.now();
+		for(size_t first = 0; first < n; first += BULK_MAX) {
+			const size_t count = (n - first) < BULK_MAX ? (n - first) : BULK_MAX;
+			m_pool.find_bulk(keys + first, count, found);
+			for(size_t i = 0; i < count; i++) {
+				const Key_t& key = keys[first + i];
+				auto it = found[i];
+				// the previous keys of the burst may have evicted or linked the node
+				if(not it || not it->im_linked || not(it->im_key == key)) {
+					it = m_pool.find(key);
+				}
+				out[first + i] = check_found(key, it, costs ? costs[first + i] : 1, current);
 			}
-			it = m_pool.push_back(key);
-			it->time = current;
 		}
-		return result;
 	}
 
 	Iterator_t remove(const Key_t& key) noexcept {
@@ -121,6 +185,34 @@ public:
 		return m_pool.storage_bytes();
 	}
 
+private:
+
+	bool check_found(const Key_t& key, Iterator_t it, uint64_t cost, uint64_t now) noexcept {
+		if(not it) {
+			if(not m_pool.available()) {
+				m_pool.pop_front();
+				m_stat.evicted++;
+			}
+			it = m_pool.push_back(key);
+			if(not it) {
+				m_stat.dropped++;
+				return false;
+			}
+			Policy_t::init(it->state, m_config, now);
+			m_stat.inserted++;
+		} else {
+			m_pool.move_back(it);
+		}
+
+		const bool result = Policy_t::check(it->state, m_config, now, cost);
+		if(result) {
+			m_stat.passed++;
+		} else {
+			m_stat.limited++;
+		}
+		return result;
+	}
+
 };
 
 }; // namespace storage
@@ -0,0 +1,167 @@
+#ifndef STORAGE_RATELIMITERPOLICY_H
+#define STORAGE_RATELIMITERPOLICY_H
+
+#include <cstdint>
+
+namespace storage {
+
+/*
+ * The policies of RateLimiter.
+ * A policy keeps its per-key 'State' in the limiter node and is tuned with a 'Config',
+ * 'now' is a clock tick (see Clock.h) and 'cost' is the weight of an event (e.g. 1 for packets or the length for bytes).
+ *
+ * struct Policy {
+ *     struct Config {...};
+ *     struct State {...};
+ *     // prepare the state of a new key
+ *     static void init(State& state, const Config& config, uint64_t now) noexcept;
+ *     // update the state in place, return true if the event is allowed
+ *     static bool check(State& state, const Config& config, uint64_t now, uint64_t cost) noexcept;
+ * };
+ */
+
+/**
+ * One event per period per key, the cost is ignored.
+ */
+struct RateLimiterPeriod {
+	struct Config {
+		uint64_t period; // clock ticks
+
+		static Config make(uint64_t period) noexcept {
+			return Config{period};
+		}
+	};
+
+	struct State {
+		uint64_t time;
+	};
+
+	static inline void init(State& state, const Config& config, uint64_t now) noexcept {
+		state.time = now - config.period - 1;
+	}
+
+	static inline bool check(State& state, const Config& config, uint64_t now, uint64_t) noexcept {
+		if(now - state.time > config.period) {
+			state.time = now;
+			return true;
+		}
+		return false;
+	}
+};
+
+/**
+ * A token bucket: 'rate' tokens per second with up to 'burst' tokens saved up.
+ * The tokens are kept in token-cycles (tokens * hz), so the refill is exact in integers.
+ * burst * hz must fit 64 bits.
+ */
+struct RateLimiterTokenBucket {
+	struct Config {
+		uint64_t rate; // tokens per second
+		uint64_t hz; // clock ticks per second
+		uint64_t credit_max; // burst * hz
+		uint64_t fill_cycles; // the time to fill an empty bucket
+
+		/**
+		 * @param rate - tokens per second.
+		 * @param burst - the capacity of the bucket in tokens.
+		 * @param hz - clock ticks per second (e.g. RateLimiter::clock().hz()).
+		 */
+		static Config make(uint64_t rate, uint64_t burst, uint64_t hz) noexcept {
+			Config config;
+			config.rate = rate ? rate : 1;
+			config.hz = hz;
+			config.credit_max = burst * hz;
+			config.fill_cycles = burst * hz / config.rate + 1;
+			return config;
+		}
+	};
+
+	struct State {
+		uint64_t time;
+		uint64_t credit; // tokens * hz
+	};
+
+	static inline void init(State& state, const Config& config, uint64_t now) noexcept {
+		state.time = now;
+		state.credit = config.credit_max;
+	}
+
+	static inline bool check(State& state, const Config& config, uint64_t now, uint64_t cost) noexcept {
+		const uint64_t elapsed = now - state.time;
+		if(elapsed >= config.fill_cycles) {
+			state.credit = config.credit_max;
+		} else {
+			const uint64_t credit = state.credit + elapsed * config.rate;
+			state.credit = credit < config.credit_max ? credit : config.credit_max;
+		}
+		state.time = now;
+
+		const uint64_t need = cost * config.hz;
+		if(state.credit >= need) {
+			state.credit -= need;
+			return true;
+		}
+		return false;
+	}
+};
+
+/**
+ * A sliding window counter: up to 'limit' cost units per window.
+ * The count of the previous window is weighted by its part which still overlaps the sliding window.
+ */
+struct RateLimiterSlidingWindow {
+	struct Config {
+		uint64_t window; // clock ticks
+		uint64_t limit; // cost units per window
+
+		/**
+		 * @param window - the window length in clock ticks.
+		 * @param limit - cost units per window.
+		 */
+		static Config make(uint64_t window, uint64_t limit) noexcept {
+			return Config{window ? window : 1, limit};
+		}
+	};
+
+	struct State {
+		uint64_t start; // the start of the current window
+		uint32_t current;
+		uint32_t previous;
+	};
+
+	static constexpr unsigned WEIGHT_BITS = 16;
+
+	static inline void init(State& state, const Config&, uint64_t now) noexcept {
+		state.start = now;
+		state.current = 0;
+		state.previous = 0;
+	}
+
+	static inline bool check(State& state, const Config& config, uint64_t now, uint64_t cost) noexcept {
+		uint64_t elapsed = now - state.start;
+		if(elapsed >= config.window * 2) {
+			state.start = now;
+			state.current = 0;
+			state.previous = 0;
+			elapsed = 0;
+		} else if(elapsed >= config.window) {
+			state.start += config.window;
+			state.previous = state.current;
+			state.current = 0;
+			elapsed -= config.window;
+		}
+
+		const uint64_t weight = ((config.window - elapsed) << WEIGHT_BITS) / config.window;
+		const uint64_t estimate = ((uint64_t(state.previous) * weight) >> WEIGHT_BITS) + state.current + cost;
+		if(estimate <= config.limit) {
+			const uint64_t current = uint64_t(state.current) + cost;
+			state.current = current < UINT32_MAX ? uint32_t(current) : UINT32_MAX;
+			return true;
+		}
+		return false;
+	}
+};
+
+}; // namespace storage
+
+#endif /* STORAGE_RATELIMITERPOLICY_H */
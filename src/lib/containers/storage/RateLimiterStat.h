@@ -10,16 +10,38 @@ namespace storage {
 struct RateLimiterStat {
 	size_t capacity;
 	size_t size;
+	uint64_t passed; // the allowed events
+	uint64_t limited; // the rejected events
+	uint64_t inserted; // the new keys
+	uint64_t evicted; // the keys evicted to insert the new ones
+	uint64_t dropped; // the events of the new keys which the map has refused to link, they are not allowed
 
 	static void print_field(FILE* out, const char* name, uint64_t value, uint64_t value_prev) noexcept {
 		fprintf(out, "%s=%zu(%zu) ", name, value, value - value_prev);
 	}
 
-	void print(FILE* out, const RateLimiterStat&) const noexcept {
+	/**
+	 * Sum up the statistics of another limiter, e.g. of another shard.
+	 */
+	void add(const RateLimiterStat& stat) noexcept {
+		capacity += stat.capacity;
+		size += stat.size;
+		passed += stat.passed;
+		limited += stat.limited;
+		inserted += stat.inserted;
+		evicted += stat.evicted;
+		dropped += stat.dropped;
+	}
+
+	void print(FILE* out, const RateLimiterStat& prev) const noexcept {
 		float load_factor = (static_cast<float>(size) / capacity) * 100.0f;
 		fprintf(out, "[TQ] ");
 		fprintf(out, "%zu/%zu (%.2f%%) ", size, capacity, load_factor);
-		//        print_field(out, "put_col", put_collision, prev.put_collision);
+		print_field(out, "passed", passed, prev.passed);
+		print_field(out, "limited", limited, prev.limited);
+		print_field(out, "inserted", inserted, prev.inserted);
+		print_field(out, "evicted", evicted, prev.evicted);
+		print_field(out, "dropped", dropped, prev.dropped);
 	}
 };
 
@@ -0,0 +1,546 @@
+#ifndef STORAGE_REPLICATION_H
+#define STORAGE_REPLICATION_H
+
+#include "IpTable.h"
+#include "../../utils/ByteOrder.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+
+namespace storage {
+
+/*
+ * The replication stream of IpTable and RateLimiter: the updates of a publisher node are recorded into
+ * the batches of a compact binary log which the replicas apply in the same order, so the deterministic
+ * tables (the FIFO eviction depends on the updates only) stay the same on every node of the same capacity.
+ * The transport is the caller's one: a batch fits a datagram (BATCH_MAX) and may be sent by UDP multicast,
+ * kept in a file or relayed through a broker.
+ *
+ * A batch, the numbers are big-endian:
+ *   u32 magic 'QRPL', u8 version, u8 flags (SNAPSHOT - the batch starts a snapshot), u16 records, u64 sequence
+ * and the records, an operation byte and its operands:
+ *   ADDR_APPEND, ADDR_REMOVE   u32 address                               5 bytes
+ *   NET_APPEND, NET_REMOVE     u32 network, u8 prefix length             6 bytes
+ *                              or u32 network, 0xFF, u32 mask            10 bytes (a non-contiguous mask)
+ *   TABLE_CLEAR                                                          1 byte
+ *   LIMIT_CONFIG               u8 words, u64 * words of the policy Config
+ *   LIMIT_REMOVE               u8 length, the key (big-endian if it is an integer)
+ *   LIMIT_RESET                                                          1 byte
+ * The sequence grows by one per batch. A replica applies the batches in a row only: a lost or a reordered
+ * batch is a gap and the replica waits for the next snapshot, which is a TABLE_CLEAR followed by the whole
+ * table in its eviction order, so the publisher sends one periodically (e.g. every few minutes) for
+ * the replicas which have joined late or lost a batch. The states of the rate limited keys are not replicated,
+ * they depend on the local traffic, the replicas share the config and the removals of the keys.
+ */
+
+enum class ReplicationOp : uint8_t {
+	ADDR_APPEND = 1,
+	ADDR_REMOVE = 2,
+	NET_APPEND = 3,
+	NET_REMOVE = 4,
+	TABLE_CLEAR = 5,
+	LIMIT_CONFIG = 6,
+	LIMIT_REMOVE = 7,
+	LIMIT_RESET = 8
+};
+
+enum class ReplicationResult : uint8_t {
+	APPLIED,
+	STALE, // a batch which has been applied already (e.g. a duplicate datagram)
+	GAP, // a batch after a lost one, the replica waits for a snapshot
+	MALFORMED // nothing of the batch has been applied
+};
+
+struct ReplicationStat {
+	uint64_t batches; // made or applied
+	uint64_t bytes;
+	uint64_t records;
+	uint64_t snapshots;
+	uint64_t stale;
+	uint64_t gaps;
+	uint64_t malformed;
+
+	ReplicationStat() noexcept : batches(0), bytes(0), records(0), snapshots(0), stale(0), gaps(0), malformed(0) {}
+
+	void print(FILE* out) const noexcept {
+		fprintf(out, "[RP] batches=%llu bytes=%llu records=%llu snapshots=%llu stale=%llu gaps=%llu malformed=%llu",
+			(unsigned long long)batches, (unsigned long long)bytes, (unsigned long long)records,
+			(unsigned long long)snapshots, (unsigned long long)stale, (unsigned long long)gaps,
+			(unsigned long long)malformed);
+	}
+};
+
+/**
+ * The encoding of the batches, see above.
+ */
+struct ReplicationFormat {
+	static constexpr uint32_t MAGIC = 0x5152504C; // 'QRPL'
+	static constexpr uint8_t VERSION = 1;
+	static constexpr uint8_t FLAG_SNAPSHOT = 0x01;
+	static constexpr size_t HEADER = 16;
+	static constexpr size_t BATCH_MAX = 1400; // fits a datagram of the tunnels of 1500 bytes links
+	static constexpr size_t RECORD_MAX = 256; // LIMIT_CONFIG of up to 31 words or a key of up to 254 bytes
+	static constexpr uint8_t MASK_FOLLOWS = 0xFF;
+
+	/**
+	 * @return the prefix length of a contiguous mask, MASK_FOLLOWS - otherwise.
+	 */
+	static inline uint8_t depth_of(uint32_t mask) noexcept {
+		const uint8_t depth = uint8_t(__builtin_popcount(mask));
+		return mask_of(depth) == mask ? depth : MASK_FOLLOWS;
+	}
+
+	static inline uint32_t mask_of(uint8_t depth) noexcept {
+		return depth ? ~uint32_t(0) << (32 - depth) : 0;
+	}
+
+	template<typename K>
+	static inline void store_key(uint8_t* ptr, const K& key) noexcept {
+		store_key(ptr, key, std::is_integral<K>());
+	}
+
+	template<typename K>
+	static inline void load_key(const uint8_t* ptr, K& key) noexcept {
+		load_key(ptr, key, std::is_integral<K>());
+	}
+
+private:
+	template<typename K>
+	static inline void store_key(uint8_t* ptr, const K& key, std::true_type) noexcept {
+		uint64_t value = uint64_t(key);
+		for(size_t i = sizeof(K); i > 0; i--, value >>= 8) {
+			ptr[i - 1] = uint8_t(value);
+		}
+	}
+
+	template<typename K>
+	static inline void store_key(uint8_t* ptr, const K& key, std::false_type) noexcept {
+		memcpy(ptr, &key, sizeof(K));
+	}
+
+	template<typename K>
+	static inline void load_key(const uint8_t* ptr, K& key, std::true_type) noexcept {
+		uint64_t value = 0;
+		for(size_t i = 0; i < sizeof(K); i++) {
+			value = (value << 8) | ptr[i];
+		}
+		key = K(value);
+	}
+
+	template<typename K>
+	static inline void load_key(const uint8_t* ptr, K& key, std::false_type) noexcept {
+		memcpy(&key, ptr, sizeof(K));
+	}
+};
+
+/**
+ * The publisher side: the updates are recorded into a batch, a full batch is handed to the sink and
+ * flush() hands over the rest, e.g. once per reload. The writer doesn't touch the tables,
+ * the publisher updates its own tables and records the same updates.
+ *
+ * @tparam S - the sink, a functor which takes 'const uint8_t* batch, size_t bytes', the batch is valid in the call only.
+ *
+ * Using sample:
+ * ReplicationWriter<Send> writer(Send{fd});
+ * table.append_addr(addr); writer.append_addr(addr);
+ * ...
+ * writer.flush();
+ * // periodically
+ * writer.begin_snapshot();
+ * writer.snapshot(table);
+ * writer.limit_config(limiter.config());
+ * writer.flush();
+ */
+template<typename S>
+class ReplicationWriter {
+	using Format = ReplicationFormat;
+
+	S m_sink;
+	const size_t m_batch_bytes;
+	uint8_t m_batch[Format::BATCH_MAX];
+	size_t m_used;
+	uint16_t m_records;
+	uint8_t m_flags; // of the batch being recorded
+	uint64_t m_sequence; // of the batch being recorded
+	ReplicationStat m_stat;
+
+public:
+
+	/**
+	 * @param batch_bytes - the most bytes of a batch, up to Format::BATCH_MAX.
+	 * @param sequence - the sequence of the first batch, e.g. a restarted publisher continues its stream.
+	 */
+	explicit ReplicationWriter(const S& sink, size_t batch_bytes = Format::BATCH_MAX, uint64_t sequence = 0) noexcept
+		: m_sink(sink)
+		, m_batch_bytes(clamp(batch_bytes))
+		, m_batch()
+		, m_used(Format::HEADER)
+		, m_records(0)
+		, m_flags(0)
+		, m_sequence(sequence)
+		, m_stat() {}
+
+	ReplicationWriter(const ReplicationWriter&) = delete;
+	ReplicationWriter& operator=(const ReplicationWriter&) = delete;
+
+	ReplicationWriter(ReplicationWriter&&) = delete;
+	ReplicationWriter& operator=(ReplicationWriter&&) = delete;
+
+	inline void append_addr(IpTable::IPv4Addr_t addr) noexcept {
+		record_addr(ReplicationOp::ADDR_APPEND, addr);
+	}
+
+	inline void remove_addr(IpTable::IPv4Addr_t addr) noexcept {
+		record_addr(ReplicationOp::ADDR_REMOVE, addr);
+	}
+
+	inline void append_net(IpTable::IPv4Addr_t net, IpTable::IPv4Addr_t mask) noexcept {
+		record_net(ReplicationOp::NET_APPEND, net, mask);
+	}
+
+	inline void remove_net(IpTable::IPv4Addr_t net, IpTable::IPv4Addr_t mask) noexcept {
+		record_net(ReplicationOp::NET_REMOVE, net, mask);
+	}
+
+	inline void clear_table() noexcept {
+		reserve(1)[0] = uint8_t(ReplicationOp::TABLE_CLEAR);
+	}
+
+	/**
+	 * @param config - the Config of a RateLimiter policy, it is a struct of uint64_t.
+	 */
+	template<typename C>
+	void limit_config(const C& config) noexcept {
+		static_assert(sizeof(C) % sizeof(uint64_t) == 0 && sizeof(C) < Format::RECORD_MAX - 2,
+			"ReplicationWriter::limit_config() takes a struct of uint64_t");
+		constexpr size_t words = sizeof(C) / sizeof(uint64_t);
+		uint8_t* ptr = reserve(2 + words * sizeof(uint64_t));
+		ptr[0] = uint8_t(ReplicationOp::LIMIT_CONFIG);
+		ptr[1] = uint8_t(words);
+		const uint8_t* value = reinterpret_cast<const uint8_t*>(&config);
+		for(size_t i = 0; i < words; i++) {
+			uint64_t word;
+			memcpy(&word, value + i * sizeof(word), sizeof(word));
+			utils::ByteOrder::store_be64(ptr + 2 + i * sizeof(word), word);
+		}
+	}
+
+	template<typename K>
+	void limit_remove(const K& key) noexcept {
+		static_assert(std::is_trivially_copyable<K>::value && sizeof(K) < Format::RECORD_MAX - 2,
+			"ReplicationWriter::limit_remove() takes a trivially copyable key");
+		uint8_t* ptr = reserve(2 + sizeof(K));
+		ptr[0] = uint8_t(ReplicationOp::LIMIT_REMOVE);
+		ptr[1] = uint8_t(sizeof(K));
+		Format::store_key(ptr + 2, key);
+	}
+
+	inline void limit_reset() noexcept {
+		reserve(1)[0] = uint8_t(ReplicationOp::LIMIT_RESET);
+	}
+
+	/**
+	 * Hand the recorded updates over and start the next batch as a snapshot.
+	 */
+	void begin_snapshot() noexcept {
+		flush();
+		m_flags |= Format::FLAG_SNAPSHOT;
+		m_stat.snapshots++;
+	}
+
+	/**
+	 * Record TABLE_CLEAR and the whole table in its eviction order, after begin_snapshot().
+	 */
+	void snapshot(const IpTable& table) noexcept {
+		clear_table();
+		table.for_each_net([this](IpTable::IPv4Addr_t net, IpTable::IPv4Addr_t mask) noexcept {
+			append_net(net, mask);
+		});
+		table.for_each_addr([this](IpTable::IPv4Addr_t addr) noexcept {
+			append_addr(addr);
+		});
+	}
+
+	/**
+	 * Hand the batch over if it has a record.
+	 */
+	void flush() noexcept {
+		if(m_records == 0) {
+			return;
+		}
+		utils::ByteOrder::store_be32(m_batch, Format::MAGIC);
+		m_batch[4] = Format::VERSION;
+		m_batch[5] = m_flags;
+		utils::ByteOrder::store_be16(m_batch + 6, m_records);
+		utils::ByteOrder::store_be64(m_batch + 8, m_sequence);
+		m_sink(static_cast<const uint8_t*>(m_batch), m_used);
+		m_stat.batches++;
+		m_stat.bytes += m_used;
+		m_stat.records += m_records;
+		m_used = Format::HEADER;
+		m_records = 0;
+		m_flags = 0;
+		m_sequence++;
+	}
+
+	/**
+	 * @return the sequence of the next batch.
+	 */
+	inline uint64_t sequence() const noexcept {
+		return m_sequence;
+	}
+
+	inline const ReplicationStat& stat() const noexcept {
+		return m_stat;
+	}
+
+private:
+
+	static inline size_t clamp(size_t batch_bytes) noexcept {
+		const size_t least = Format::HEADER + Format::RECORD_MAX;
+		return batch_bytes < least ? least : (batch_bytes > Format::BATCH_MAX ? Format::BATCH_MAX : batch_bytes);
+	}
+
+	inline uint8_t* reserve(size_t bytes) noexcept {
+		if(m_used + bytes > m_batch_bytes || m_records == UINT16_MAX) {
+			flush(); // the following batches of a snapshot are the plain ones
+		}
+		uint8_t* result = m_batch + m_used;
+		m_used += bytes;
+		m_records++;
+		return result;
+	}
+
+	inline void record_addr(ReplicationOp op, IpTable::IPv4Addr_t addr) noexcept {
+		uint8_t* ptr = reserve(5);
+		ptr[0] = uint8_t(op);
+		utils::ByteOrder::store_be32(ptr + 1, addr);
+	}
+
+	inline void record_net(ReplicationOp op, IpTable::IPv4Addr_t net, IpTable::IPv4Addr_t mask) noexcept {
+		const uint8_t depth = Format::depth_of(mask);
+		uint8_t* ptr = reserve(depth == Format::MASK_FOLLOWS ? 10 : 6);
+		ptr[0] = uint8_t(op);
+		utils::ByteOrder::store_be32(ptr + 1, net);
+		ptr[5] = depth;
+		if(depth == Format::MASK_FOLLOWS) {
+			utils::ByteOrder::store_be32(ptr + 6, mask);
+		}
+	}
+
+};
+
+/**
+ * The replica side: the batches are checked and applied in the order of their sequence.
+ * A replica starts unsynchronized and takes the first snapshot, after a gap it drops the batches until
+ * the next snapshot. A batch is checked as a whole before its records are applied, so a malformed one
+ * changes nothing. A snapshot of many batches leaves the table partial until its last batch, the readers
+ * which must not see it keep the table in a Snapshot and apply the whole snapshot in one update().
+ *
+ * Using sample:
+ * ReplicationReader reader;
+ * while(recv(fd, buffer, sizeof(buffer), 0) > 0) {
+ *     if(reader.apply(buffer, bytes, table, &limiter) == ReplicationResult::GAP) {...}
+ * }
+ */
+class ReplicationReader {
+	using Format = ReplicationFormat;
+
+	/**
+	 * The limiter of the replicas without one, its records are skipped.
+	 */
+	struct NoLimiter {
+		struct Config_t {
+			uint64_t word;
+		};
+		using Key_t = uint64_t;
+
+		void set_config(const Config_t&) noexcept {}
+		void remove(const Key_t&) noexcept {}
+		void reset() noexcept {}
+	};
+
+	bool m_synced;
+	uint64_t m_sequence; // the next one
+	ReplicationStat m_stat;
+
+public:
+
+	ReplicationReader() noexcept : m_synced(false), m_sequence(0), m_stat() {}
+
+	ReplicationReader(const ReplicationReader&) = delete;
+	ReplicationReader& operator=(const ReplicationReader&) = delete;
+
+	ReplicationReader(ReplicationReader&&) = delete;
+	ReplicationReader& operator=(ReplicationReader&&) = delete;
+
+	ReplicationResult apply(const uint8_t* batch, size_t bytes, IpTable& table) noexcept {
+		return apply(batch, bytes, table, static_cast<NoLimiter*>(nullptr));
+	}
+
+	/**
+	 * @param limiter - a RateLimiter, nullptr skips the limiter records.
+	 */
+	template<typename L>
+	ReplicationResult apply(const uint8_t* batch, size_t bytes, IpTable& table, L* limiter) noexcept {
+		uint16_t records = 0;
+		if(not check(batch, bytes, records)) {
+			m_stat.malformed++;
+			return ReplicationResult::MALFORMED;
+		}
+		const uint64_t sequence = utils::ByteOrder::load_be64(batch + 8);
+		const bool snapshot = batch[5] & Format::FLAG_SNAPSHOT;
+		if(m_synced && sequence < m_sequence) {
+			m_stat.stale++;
+			return ReplicationResult::STALE;
+		}
+		if(not (snapshot || (m_synced && sequence == m_sequence))) {
+			m_synced = false;
+			m_stat.gaps++;
+			return ReplicationResult::GAP;
+		}
+		m_synced = true;
+		m_sequence = sequence + 1;
+		m_stat.snapshots += snapshot;
+		m_stat.batches++;
+		m_stat.bytes += bytes;
+		m_stat.records += records;
+
+		const uint8_t* ptr = batch + Format::HEADER;
+		for(uint16_t i = 0; i < records; i++) {
+			ptr = apply_record(ptr, table, limiter);
+		}
+		return ReplicationResult::APPLIED;
+	}
+
+	/**
+	 * @return true - if the replica has taken a snapshot and has lost no batch since.
+	 */
+	inline bool synced() const noexcept {
+		return m_synced;
+	}
+
+	/**
+	 * @return the sequence of the next batch.
+	 */
+	inline uint64_t sequence() const noexcept {
+		return m_sequence;
+	}
+
+	inline const ReplicationStat& stat() const noexcept {
+		return m_stat;
+	}
+
+private:
+
+	static bool check(const uint8_t* batch, size_t bytes, uint16_t& records) noexcept {
+		if(bytes < Format::HEADER || utils::ByteOrder::load_be32(batch) != Format::MAGIC || batch[4] != Format::VERSION) {
+			return false;
+		}
+		records = utils::ByteOrder::load_be16(batch + 6);
+		size_t offset = Format::HEADER;
+		for(uint16_t i = 0; i < records; i++) {
+			if(offset >= bytes) {
+				return false;
+			}
+			size_t length = 0;
+			switch(ReplicationOp(batch[offset])) {
+			case ReplicationOp::ADDR_APPEND:
+			case ReplicationOp::ADDR_REMOVE:
+				length = 5;
+				break;
+			case ReplicationOp::NET_APPEND:
+			case ReplicationOp::NET_REMOVE:
+				if(offset + 6 > bytes || (batch[offset + 5] > 32 && batch[offset + 5] != Format::MASK_FOLLOWS)) {
+					return false;
+				}
+				length = batch[offset + 5] == Format::MASK_FOLLOWS ? 10 : 6;
+				break;
+			case ReplicationOp::TABLE_CLEAR:
+			case ReplicationOp::LIMIT_RESET:
+				length = 1;
+				break;
+			case ReplicationOp::LIMIT_CONFIG:
+				if(offset + 2 > bytes) {
+					return false;
+				}
+				length = 2 + size_t(batch[offset + 1]) * sizeof(uint64_t);
+				break;
+			case ReplicationOp::LIMIT_REMOVE:
+				if(offset + 2 > bytes) {
+					return false;
+				}
+				length = 2 + size_t(batch[offset + 1]);
+				break;
+			default:
+				return false;
+			}
+			offset += length;
+			if(offset > bytes) {
+				return false;
+			}
+		}
+		return offset == bytes;
+	}
+
+	/**
+	 * @return the next record, the record has been checked.
+	 */
+	template<typename L>
+	const uint8_t* apply_record(const uint8_t* ptr, IpTable& table, L* limiter) noexcept {
+		switch(ReplicationOp(ptr[0])) {
+		case ReplicationOp::ADDR_APPEND:
+			table.append_addr(utils::ByteOrder::load_be32(ptr + 1));
+			return ptr + 5;
+		case ReplicationOp::ADDR_REMOVE:
+			table.remove_addr(utils::ByteOrder::load_be32(ptr + 1));
+			return ptr + 5;
+		case ReplicationOp::NET_APPEND:
+		case ReplicationOp::NET_REMOVE: {
+			const uint32_t net = utils::ByteOrder::load_be32(ptr + 1);
+			const bool follows = ptr[5] == Format::MASK_FOLLOWS;
+			const uint32_t mask = follows ? utils::ByteOrder::load_be32(ptr + 6) : Format::mask_of(ptr[5]);
+			if(ReplicationOp(ptr[0]) == ReplicationOp::NET_APPEND) {
+				table.append_net(net, mask);
+			} else {
+				table.remove_net(net, mask);
+			}
+			return ptr + (follows ? 10 : 6);
+		}
+		case ReplicationOp::TABLE_CLEAR:
+			table.clear();
+			return ptr + 1;
+		case ReplicationOp::LIMIT_CONFIG:
+			if(limiter && ptr[1] * sizeof(uint64_t) == sizeof(typename L::Config_t)) {
+				typename L::Config_t config;
+				uint8_t* value = reinterpret_cast<uint8_t*>(&config);
+				for(size_t i = 0; i < ptr[1]; i++) {
+					const uint64_t word = utils::ByteOrder::load_be64(ptr + 2 + i * sizeof(word));
+					memcpy(value + i * sizeof(word), &word, sizeof(word));
+				}
+				limiter->set_config(config);
+			}
+			return ptr + 2 + ptr[1] * sizeof(uint64_t);
+		case ReplicationOp::LIMIT_REMOVE:
+			if(limiter && ptr[1] == sizeof(typename L::Key_t)) {
+				typename L::Key_t key;
+				Format::load_key(ptr + 2, key);
+				limiter->remove(key);
+			}
+			return ptr + 2 + ptr[1];
+		case ReplicationOp::LIMIT_RESET:
+			if(limiter) {
+				limiter->reset();
+			}
+			return ptr + 1;
+		}
+		return ptr + 1; // unreachable, the batch has been checked
+	}
+
+};
+
+}; // namespace storage
+
+#endif /* STORAGE_REPLICATION_H */
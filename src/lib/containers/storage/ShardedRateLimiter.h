@@ -0,0 +1,233 @@
+#ifndef STORAGE_SHARDEDRATELIMITER_H
+#define STORAGE_SHARDEDRATELIMITER_H
+
+#include "RateLimiter.h"
+
+#include <atomic>
+#include <cstring>
+#include <type_traits>
+
+namespace storage {
+
+/**
+ * A front end of RateLimiter shards, one shard per lcore.
+ * A key is routed to exactly one shard by its hash, see shard_of().
+ * A shard is not thread-safe, so the keys of a shard must be checked by its owner lcore only
+ * (e.g. the NIC spreads the flows with the same hash or the packets are dispatched to the owners).
+ *
+ * The statistics are aggregated without locks: every owner publishes the statistics of its shard
+ * from time to time with publish() and load() sums up the last published ones.
+ *
+ * @tparam H - the hasher of the keys, the shard is selected with the high bits of the mixed hash,
+ * the shard maps use the low ones.
+ */
+template<
+	typename Node_t,
+	typename H = std::hash<typename Node_t::Key_t>,
+	typename B = intrusive::HashMapBucket<Node_t>,
+	typename C = TscClock
+>
+class ShardedRateLimiter {
+	friend class TestShardedRateLimiter;
+
+public:
+	using Key_t = typename Node_t::Key_t;
+	using Limiter_t = RateLimiter<Node_t, H, B, C>;
+	using Config_t = typename Limiter_t::Config_t;
+
+private:
+	static_assert(std::is_trivially_copyable<RateLimiterStat>::value, "RateLimiterStat must be trivially copyable");
+
+	static constexpr size_t STAT_WORDS = (sizeof(RateLimiterStat) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+	struct alignas(64) Shard {
+		Limiter_t limiter;
+		std::atomic<uint64_t> stat_seq; // odd while the statistics are being published
+		std::atomic<uint64_t> stat[STAT_WORDS];
+
+		Shard(size_t capacity, float load_factor, intrusive::HashMapSizing sizing) noexcept
+			: limiter(capacity, load_factor, sizing), stat_seq(0), stat() {}
+	};
+
+	const unsigned m_shards_size;
+	const size_t m_capacity;
+	const float m_load_factor;
+	const intrusive::HashMapSizing m_sizing;
+	Shard* m_shards;
+	intrusive::HashMix<Key_t, H> m_hasher;
+	dpdk::Allocator<Shard> m_allocator;
+
+public:
+
+	/**
+	 * @param shards - amount of shards, usually the amount of RX lcores.
+	 * @param capacity - amount of keys per shard.
+	 * @param load_factor - average amount of nodes per bucket.
+	 * @param sizing - the bucket sizing mode of the shards.
+	 */
+	ShardedRateLimiter(
+		unsigned shards
+		, size_t capacity
+		, float load_factor
+		, intrusive::HashMapSizing sizing = intrusive::HashMapSizing::EXACT
+	                  ) noexcept
+		: m_shards_size(shards ? shards : 1)
+		, m_capacity(capacity)
+		, m_load_factor(load_factor)
+		, m_sizing(sizing)
+		, m_shards(nullptr)
+		, m_hasher()
+		, m_allocator() {}
+
+	ShardedRateLimiter(const ShardedRateLimiter&) = delete;
+	ShardedRateLimiter& operator=(const ShardedRateLimiter&) = delete;
+
+	ShardedRateLimiter(ShardedRateLimiter&&) = delete;
+	ShardedRateLimiter& operator=(ShardedRateLimiter&&) = delete;
+
+	virtual ~ShardedRateLimiter() noexcept {
+		destroy();
+	}
+
+	/**
+	 * Allocate the shard list, the shard storages are allocated with allocate_shard().
+	 * @return 0 - if the shard list has been allocated successfully.
+	 */
+	int allocate() noexcept {
+		if(m_shards)
+			return -1;
+
+		m_shards = m_allocator.allocate(m_shards_size);
+		if(m_shards == nullptr)
+			return -1;
+
+		for(unsigned i = 0; i < m_shards_size; i++) {
+			m_allocator.construct(m_shards + i, m_capacity, m_load_factor, m_sizing);
+		}
+		return 0;
+	}
+
+	/**
+	 * Allocate the storage of a shard.
+	 * Call it on the owner lcore, so dpdk::Allocator takes the memory of the lcore NUMA node.
+	 * @return 0 - if the storage has been allocated successfully.
+	 */
+	int allocate_shard(unsigned shard) noexcept {
+		return m_shards[shard].limiter.allocate();
+	}
+
+	/**
+	 * @return the shard which owns the key.
+	 */
+	inline unsigned shard_of(const Key_t& key) const noexcept {
+		const uint64_t high = uint64_t(m_hasher(key)) >> 32;
+		return unsigned((high * m_shards_size) >> 32);
+	}
+
+	inline Limiter_t& shard(unsigned shard) noexcept {
+		return m_shards[shard].limiter;
+	}
+
+	inline unsigned shards() const noexcept {
+		return m_shards_size;
+	}
+
+	/**
+	 * Check the key with its shard, must be called by the owner lcore of the shard.
+	 */
+	inline bool check(const Key_t& key, uint64_t cost = 1) noexcept {
+		return m_shards[shard_of(key)].limiter.check(key, cost);
+	}
+
+	/**
+	 * Set the period for all the shards, must be called before the shards are in use.
+	 */
+	void set_period(uint64_t period) noexcept {
+		for(unsigned i = 0; i < m_shards_size; i++) {
+			m_shards[i].limiter.set_period(period);
+		}
+	}
+
+	/**
+	 * Set the policy config for all the shards, must be called before the shards are in use.
+	 */
+	void set_config(const Config_t& config) noexcept {
+		for(unsigned i = 0; i < m_shards_size; i++) {
+			m_shards[i].limiter.set_config(config);
+		}
+	}
+
+	/**
+	 * Publish the statistics of a shard, must be called by the owner lcore of the shard.
+	 */
+	void publish(unsigned shard) noexcept {
+		Shard& owner = m_shards[shard];
+		RateLimiterStat stat;
+		owner.limiter.load(stat);
+		uint64_t words[STAT_WORDS] = {};
+		std::memcpy(words, &stat, sizeof(stat));
+
+		const uint64_t seq = owner.stat_seq.load(std::memory_order_relaxed);
+		owner.stat_seq.store(seq + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		for(size_t i = 0; i < STAT_WORDS; i++) {
+			owner.stat[i].store(words[i], std::memory_order_relaxed);
+		}
+		owner.stat_seq.store(seq + 2, std::memory_order_release);
+	}
+
+	/**
+	 * Sum up the last published statistics of all the shards, may be called by any thread.
+	 */
+	void load(RateLimiterStat& stat) const noexcept {
+		std::memset(&stat, 0, sizeof(stat));
+		for(unsigned i = 0; i < m_shards_size; i++) {
+			RateLimiterStat shard_stat;
+			load(i, shard_stat);
+			stat.add(shard_stat);
+		}
+	}
+
+	/**
+	 * Load the last published statistics of a shard, may be called by any thread.
+	 */
+	void load(unsigned shard, RateLimiterStat& stat) const noexcept {
+		const Shard& owner = m_shards[shard];
+		uint64_t words[STAT_WORDS];
+		for(;;) {
+			const uint64_t seq = owner.stat_seq.load(std::memory_order_acquire);
+			for(size_t i = 0; i < STAT_WORDS; i++) {
+				words[i] = owner.stat[i].load(std::memory_order_relaxed);
+			}
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if(not(seq & 1) && owner.stat_seq.load(std::memory_order_relaxed) == seq)
+				break;
+		}
+		std::memcpy(&stat, words, sizeof(stat));
+	}
+
+	inline size_t storage_bytes() noexcept {
+		size_t result = m_shards_size * sizeof(Shard);
+		for(unsigned i = 0; i < m_shards_size; i++) {
+			result += m_shards[i].limiter.storage_bytes();
+		}
+		return result;
+	}
+
+private:
+
+	void destroy() noexcept {
+		if(m_shards) {
+			for(unsigned i = 0; i < m_shards_size; i++) {
+				m_allocator.destroy(m_shards + i);
+			}
+			m_allocator.deallocate(m_shards, m_shards_size);
+			m_shards = nullptr;
+		}
+	}
+
+};
+
+}; // namespace storage
+
+#endif /* STORAGE_SHARDEDRATELIMITER_H */
@@ -0,0 +1,359 @@
+#ifndef STORAGE_SKETCH_H
+#define STORAGE_SKETCH_H
+
+#include "../BitArrayT.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+
+namespace storage {
+
+/**
+ * The finalizer of splitmix64, it spreads the weak hashes (e.g. std::hash of an integer is the integer)
+ * over all the 64 bits which the sketches take their indices from.
+ */
+struct SketchHash {
+	static inline constexpr uint64_t mix(uint64_t x) noexcept {
+		return fin(fin(fin(x + 0x9e3779b97f4a7c15ull, 30, 0xbf58476d1ce4e5b9ull), 27, 0x94d049bb133111ebull), 31, 1);
+	}
+
+private:
+	static inline constexpr uint64_t fin(uint64_t x, unsigned shift, uint64_t mul) noexcept {
+		return (x ^ (x >> shift)) * mul;
+	}
+};
+
+/**
+ * A count-min sketch of Depth rows of packed saturating Width-bit counters, e.g. the packet rates of the sources.
+ * An estimate never underestimates, it overestimates by less than e * total / columns with the probability
+ * 1 - e^-Depth. The rows are the items of one BitArrayT, the columns of a row are taken by the double hashing
+ * of one key hash: column_i = h1 + i * h2.
+ * The sketch is single-threaded, a sketch per worker merged with merge() or ConcurrentBitArrayT fit the shared case.
+ *
+ * @tparam Width - the counter width, a counter saturates at BitArrayT<Width>::value_max().
+ * @tparam Depth - the row number.
+ */
+template<BitArrayTWidth_t Width, unsigned Depth, typename K = uint32_t, typename H = std::hash<K> >
+class CountMinSketch {
+	friend class TestSketch;
+
+public:
+	using Key_t = K;
+	using Counter_t = BitArrayTChunk_t;
+
+	static constexpr size_t BURST = 32; // the keys which are hashed and prefetched at once by update_bulk()
+
+private:
+	BitArrayT<Width> m_counters;
+	const size_t m_columns; // a power of two
+	H m_hasher;
+
+public:
+
+	/**
+	 * @param columns - the counters of a row, it is rounded up to a power of two.
+	 */
+	CountMinSketch(size_t columns) noexcept : m_counters(), m_columns(round_up(columns)), m_hasher() {}
+
+	CountMinSketch(const CountMinSketch&) = delete;
+	CountMinSketch& operator=(const CountMinSketch&) = delete;
+
+	CountMinSketch(CountMinSketch&&) = delete;
+	CountMinSketch& operator=(CountMinSketch&&) = delete;
+
+	virtual ~CountMinSketch() noexcept {}
+
+	/**
+	 * @return 0 - if the counters have been allocated successfully.
+	 */
+	int allocate() noexcept {
+		static_assert(Depth > 0, "Template argument 'Depth' must be greater than zero.");
+		if(m_counters.chunk_capacity())
+			return -1;
+
+		m_counters.allocate(m_columns * Depth);
+		m_counters.fill(0);
+		return 0;
+	}
+
+	/**
+	 * Add @delta to the counters of @key.
+	 */
+	inline void update(const Key_t& key, Counter_t delta = 1) noexcept {
+		update_hash(SketchHash::mix(m_hasher(key)), delta);
+	}
+
+	/**
+	 * Add a burst of keys, e.g. the source addresses of the packets which HeaderParser has taken from a burst.
+	 * The hashes of BURST keys are taken and their counters are prefetched before the counters are updated.
+	 * @param deltas - the deltas of the keys (e.g. the packet sizes) or nullptr to add one for every key.
+	 */
+	void update_bulk(const Key_t* keys, size_t n, const Counter_t* deltas = nullptr) noexcept {
+		uint64_t hashes[BURST];
+		while(n) {
+			const size_t burst = n < BURST ? n : BURST;
+			for(size_t i = 0; i < burst; i++) {
+				hashes[i] = SketchHash::mix(m_hasher(keys[i]));
+				for(unsigned row = 0; row < Depth; row++) {
+					m_counters.prefetch(index(hashes[i], row));
+				}
+			}
+			for(size_t i = 0; i < burst; i++) {
+				update_hash(hashes[i], deltas ? deltas[i] : 1);
+			}
+			keys += burst;
+			if(deltas)
+				deltas += burst;
+			n -= burst;
+		}
+	}
+
+	/**
+	 * @return the estimate of the total delta of @key, it is the minimum of its counters.
+	 */
+	inline Counter_t estimate(const Key_t& key) const noexcept {
+		return estimate_hash(SketchHash::mix(m_hasher(key)));
+	}
+
+	void estimate_bulk(const Key_t* keys, size_t n, Counter_t* out) const noexcept {
+		uint64_t hashes[BURST];
+		while(n) {
+			const size_t burst = n < BURST ? n : BURST;
+			for(size_t i = 0; i < burst; i++) {
+				hashes[i] = SketchHash::mix(m_hasher(keys[i]));
+				for(unsigned row = 0; row < Depth; row++) {
+					m_counters.prefetch(index(hashes[i], row));
+				}
+			}
+			for(size_t i = 0; i < burst; i++) {
+				out[i] = estimate_hash(hashes[i]);
+			}
+			keys += burst;
+			out += burst;
+			n -= burst;
+		}
+	}
+
+	/**
+	 * Add the counters of a sketch of the same geometry, e.g. of another worker.
+	 */
+	void merge(const CountMinSketch& other) noexcept {
+		const size_t items = m_columns * Depth;
+		Counter_t mine[BURST];
+		Counter_t theirs[BURST];
+		for(size_t first = 0; first < items; first += BURST) {
+			const size_t number = items - first < BURST ? items - first : BURST;
+			m_counters.load_range(first, number, mine);
+			other.m_counters.load_range(first, number, theirs);
+			for(size_t i = 0; i < number; i++) {
+				mine[i] = add_sat(mine[i], theirs[i]);
+			}
+			m_counters.store_range(first, number, mine);
+		}
+	}
+
+	/**
+	 * Zero the counters, e.g. at the start of a measurement period.
+	 */
+	inline void reset() noexcept {
+		m_counters.fill(0);
+	}
+
+	inline size_t columns() const noexcept {
+		return m_columns;
+	}
+
+	static constexpr unsigned depth() noexcept {
+		return Depth;
+	}
+
+	static constexpr Counter_t value_max() noexcept {
+		return BitArrayT<Width>::value_max();
+	}
+
+	inline size_t storage_bytes() const noexcept {
+		return m_counters.byte_capacity();
+	}
+
+private:
+
+	static inline size_t round_up(size_t columns) noexcept {
+		size_t result = 1;
+		while(result < columns) {
+			result <<= 1;
+		}
+		return result;
+	}
+
+	static inline Counter_t add_sat(Counter_t value, Counter_t delta) noexcept {
+		return delta < value_max() - value ? value + delta : value_max();
+	}
+
+	inline size_t index(uint64_t hash, unsigned row) const noexcept {
+		const uint64_t h1 = hash;
+		const uint64_t h2 = (hash >> 32) | 1u;
+		return row * m_columns + size_t((h1 + row * h2) & (m_columns - 1));
+	}
+
+	inline void update_hash(uint64_t hash, Counter_t delta) noexcept {
+		for(unsigned row = 0; row < Depth; row++) {
+			const size_t i = index(hash, row);
+			m_counters.store(i, add_sat(m_counters.load(i), delta));
+		}
+	}
+
+	inline Counter_t estimate_hash(uint64_t hash) const noexcept {
+		Counter_t result = value_max();
+		for(unsigned row = 0; row < Depth; row++) {
+			const Counter_t value = m_counters.load(index(hash, row));
+			result = value < result ? value : result;
+		}
+		return result;
+	}
+
+};
+
+/**
+ * A HyperLogLog counter of the distinct keys, e.g. of the destinations, with 2^P 6-bit registers in BitArrayT<6>.
+ * The standard error of an estimate is 1.04 / sqrt(2^P), e.g. 0.8% for P = 14 in 12 Kb.
+ * The small cardinalities are estimated by the linear counting of the empty registers.
+ *
+ * @tparam P - the register index bits, in [4:18] range.
+ */
+template<unsigned P = 14, typename K = uint32_t, typename H = std::hash<K> >
+class HyperLogLog {
+	friend class TestSketch;
+
+public:
+	using Key_t = K;
+	using Register_t = BitArrayTChunk_t;
+
+	static constexpr size_t REGISTERS = size_t(1) << P;
+	static constexpr size_t BURST = 32; // the keys which are hashed and prefetched at once by update_bulk()
+
+private:
+	static constexpr size_t RANGE = REGISTERS < BURST ? REGISTERS : BURST; // the registers loaded at once
+
+	BitArrayT<6> m_registers;
+	H m_hasher;
+
+public:
+
+	HyperLogLog() noexcept : m_registers(), m_hasher() {}
+
+	HyperLogLog(const HyperLogLog&) = delete;
+	HyperLogLog& operator=(const HyperLogLog&) = delete;
+
+	HyperLogLog(HyperLogLog&&) = delete;
+	HyperLogLog& operator=(HyperLogLog&&) = delete;
+
+	virtual ~HyperLogLog() noexcept {}
+
+	/**
+	 * @return 0 - if the registers have been allocated successfully.
+	 */
+	int allocate() noexcept {
+		static_assert(P >= 4 && P <= 18, "Template argument 'P' must be in [4:18] range.");
+		if(m_registers.chunk_capacity())
+			return -1;
+
+		m_registers.allocate(REGISTERS);
+		m_registers.fill(0);
+		return 0;
+	}
+
+	inline void update(const Key_t& key) noexcept {
+		update_hash(SketchHash::mix(m_hasher(key)));
+	}
+
+	/**
+	 * Add a burst of keys, e.g. the destination addresses of the packets which HeaderParser has taken from a burst.
+	 */
+	void update_bulk(const Key_t* keys, size_t n) noexcept {
+		uint64_t hashes[BURST];
+		while(n) {
+			const size_t burst = n < BURST ? n : BURST;
+			for(size_t i = 0; i < burst; i++) {
+				hashes[i] = SketchHash::mix(m_hasher(keys[i]));
+				m_registers.prefetch(size_t(hashes[i] >> (64 - P)));
+			}
+			for(size_t i = 0; i < burst; i++) {
+				update_hash(hashes[i]);
+			}
+			keys += burst;
+			n -= burst;
+		}
+	}
+
+	/**
+	 * @return the estimate of the distinct keys number.
+	 */
+	double estimate() const noexcept {
+		Register_t registers[RANGE];
+		double sum = 0;
+		size_t zeros = 0;
+		for(size_t first = 0; first < REGISTERS; first += RANGE) {
+			m_registers.load_range(first, RANGE, registers);
+			for(size_t i = 0; i < RANGE; i++) {
+				sum += std::ldexp(1.0, -int(registers[i]));
+				zeros += registers[i] == 0;
+			}
+		}
+
+		const double m = double(REGISTERS);
+		const double result = alpha() * m * m / sum;
+		if(result <= 2.5 * m && zeros) {
+			return m * std::log(m / double(zeros));
+		}
+		return result;
+	}
+
+	/**
+	 * Take the union with a counter of the same P, e.g. of another worker.
+	 */
+	void merge(const HyperLogLog& other) noexcept {
+		Register_t mine[RANGE];
+		Register_t theirs[RANGE];
+		for(size_t first = 0; first < REGISTERS; first += RANGE) {
+			m_registers.load_range(first, RANGE, mine);
+			other.m_registers.load_range(first, RANGE, theirs);
+			for(size_t i = 0; i < RANGE; i++) {
+				mine[i] = theirs[i] > mine[i] ? theirs[i] : mine[i];
+			}
+			m_registers.store_range(first, RANGE, mine);
+		}
+	}
+
+	inline void reset() noexcept {
+		m_registers.fill(0);
+	}
+
+	inline size_t storage_bytes() const noexcept {
+		return m_registers.byte_capacity();
+	}
+
+private:
+
+	static inline constexpr double alpha() noexcept {
+		return P == 4 ? 0.673 : P == 5 ? 0.697 : P == 6 ? 0.709 : 0.7213 / (1.0 + 1.079 / double(REGISTERS));
+	}
+
+	/**
+	 * The high P bits select a register, the rank of the other bits is the position of their first set bit.
+	 */
+	inline void update_hash(uint64_t hash) noexcept {
+		const size_t index = size_t(hash >> (64 - P));
+		const uint64_t rest = (hash << P) | (uint64_t(1) << (P - 1)); // the guard bit limits the rank
+		const Register_t rank = Register_t(__builtin_clzll(rest)) + 1;
+		if(rank > m_registers.load(index)) {
+			m_registers.store(index, rank);
+		}
+	}
+
+};
+
+}; // namespace storage
+
+#endif /* STORAGE_SKETCH_H */
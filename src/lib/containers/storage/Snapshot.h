@@ -0,0 +1,152 @@
+#ifndef STORAGE_SNAPSHOT_H
+#define STORAGE_SNAPSHOT_H
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+namespace storage {
+
+/**
+ * Quiescent-state-based reclamation for up to N reader threads.
+ * A reader thread takes a slot, goes online() and reports quiescent() between the bursts,
+ * that is when it doesn't keep any reference to the shared data, and goes offline() when it idles.
+ * Every slot takes its own cache line, so the readers never write a shared cache line.
+ * synchronize() waits until every online reader has passed through a quiescent state.
+ */
+template<unsigned N = 64>
+class Qsbr {
+	struct alignas(64) Reader {
+		std::atomic<uint64_t> epoch; // the epoch of the last quiescent state, OFFLINE if the reader is offline
+
+		Reader() noexcept : epoch(OFFLINE) {}
+	};
+
+	static constexpr uint64_t OFFLINE = 0;
+
+	Reader m_readers[N];
+	alignas(64) std::atomic<uint64_t> m_epoch;
+
+public:
+	static constexpr unsigned READERS_MAX = N;
+
+	Qsbr() noexcept : m_readers(), m_epoch(OFFLINE + 1) {}
+
+	Qsbr(const Qsbr&) = delete;
+	Qsbr& operator=(const Qsbr&) = delete;
+
+	Qsbr(Qsbr&&) = delete;
+	Qsbr& operator=(Qsbr&&) = delete;
+
+	/**
+	 * @param reader - a slot of the reader thread [0, N).
+	 */
+	inline void online(unsigned reader) noexcept {
+		m_readers[reader].epoch.store(m_epoch.load());
+	}
+
+	inline void quiescent(unsigned reader) noexcept {
+		m_readers[reader].epoch.store(m_epoch.load());
+	}
+
+	inline void offline(unsigned reader) noexcept {
+		m_readers[reader].epoch.store(OFFLINE);
+	}
+
+	/**
+	 * Wait for a grace period, the data which has been unpublished before the call is not referenced after it.
+	 * Must not be called by an online reader.
+	 */
+	void synchronize() noexcept {
+		const uint64_t epoch = m_epoch.fetch_add(1) + 1;
+		for(unsigned i = 0; i < N; i++) {
+			for(;;) {
+				const uint64_t seen = m_readers[i].epoch.load();
+				if(seen == OFFLINE || seen >= epoch)
+					break;
+
+				std::this_thread::yield();
+			}
+		}
+	}
+
+};
+
+/**
+ * A read-mostly wrapper which makes the lookups of 'T' lock-free.
+ * The wrapper holds two instances of 'T', the readers use the published one
+ * while a writer patches the other one, publishes it, waits for a grace period
+ * and applies the same patch to the unpublished instance.
+ * So the readers never take a lock, and the memory of 'T' is doubled.
+ *
+ * 'T' must be deterministic: the same sequence of updates leaves both instances in the same state
+ * (e.g. IpTable and Ip6Table, their FIFO eviction depends on the updates only).
+ * The updates must be serialized by the caller.
+ *
+ * Usage:
+ *   Qsbr<> qsbr;
+ *   Snapshot<IpTable> table(qsbr, capacity_addr, load_factor, capacity_net);
+ *   // a worker
+ *   qsbr.online(worker_id);
+ *   for(;;) { ... table.read().find_bulk(addrs, n, out); ... qsbr.quiescent(worker_id); }
+ *   // the control plane
+ *   table.update([&](IpTable& t) { t.append_addr(addr); });
+ */
+template<typename T, unsigned N = 64>
+class Snapshot {
+	Qsbr<N>& m_qsbr;
+	T m_first;
+	T m_second;
+	std::atomic<T*> m_current;
+
+public:
+
+	/**
+	 * @param args - the arguments of the constructor of 'T', both instances get the same ones.
+	 */
+	template<typename... Args>
+	Snapshot(Qsbr<N>& qsbr, const Args& ... args) noexcept
+		: m_qsbr(qsbr)
+		, m_first(args...)
+		, m_second(args...)
+		, m_current(&m_first) {}
+
+	Snapshot(const Snapshot&) = delete;
+	Snapshot& operator=(const Snapshot&) = delete;
+
+	Snapshot(Snapshot&&) = delete;
+	Snapshot& operator=(Snapshot&&) = delete;
+
+	/**
+	 * @return 0 - if both instances have been allocated successfully.
+	 */
+	int allocate() noexcept {
+		return m_first.allocate() || m_second.allocate();
+	}
+
+	/**
+	 * @return the published instance, it must not be referenced after the next quiescent state of the reader.
+	 */
+	inline const T& read() const noexcept {
+		return *m_current.load();
+	}
+
+	/**
+	 * Apply 'patch' to both instances, the readers see either the state before the patch or after it.
+	 * @param patch - a functor which takes 'T&', it is called twice.
+	 */
+	template<typename F>
+	void update(const F& patch) noexcept {
+		T* published = m_current.load();
+		T* standby = published == &m_first ? &m_second : &m_first;
+		patch(*standby);
+		m_current.store(standby);
+		m_qsbr.synchronize();
+		patch(*published);
+	}
+
+};
+
+}; // namespace storage
+
+#endif /* STORAGE_SNAPSHOT_H */
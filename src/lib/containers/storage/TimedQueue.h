@@ -2,6 +2,7 @@
 #define STORAGE_TIMEDQUEUE_H
 
 #include "TimedQueueStat.h"
+#include "Clock.h"
 #include "../intrusive_pool/HashQueuePool.h"
 #include "../dpdk/Allocator.h"
 
@@ -11,15 +12,15 @@
 
 namespace storage {
 
-template<typename K, typename V>
+template<typename K, typename V, template<typename, typename> class MH = intrusive::HashMapHook>
 struct TimedQueueNode
-	: public intrusive::LinkedListHook<TimedQueueNode<K, V> >, intrusive::HashMapHook<K, TimedQueueNode<K, V> > {
-	template<typename Tmp1, typename Tmp2>
+	: public intrusive::LinkedListHook<TimedQueueNode<K, V, MH> >, MH<K, TimedQueueNode<K, V, MH> > {
+	template<typename Tmp1, typename Tmp2, typename Tmp3, typename Tmp4>
 	friend
 	class TimedQueue;
 
 private:
-	std::time_t time;
+	uint64_t time;
 public:
 	using Key_t = K;
 	V value;
@@ -37,15 +38,15 @@ public:
 	}
 };
 
-template<typename K>
+template<typename K, template<typename, typename> class MH = intrusive::HashMapHook>
 struct TimedQueueEmptyNode
-	: public intrusive::LinkedListHook<TimedQueueEmptyNode<K> >, intrusive::HashMapHook<K, TimedQueueEmptyNode<K> > {
-	template<typename Tmp1, typename Tmp2>
+	: public intrusive::LinkedListHook<TimedQueueEmptyNode<K, MH> >, MH<K, TimedQueueEmptyNode<K, MH> > {
+	template<typename Tmp1, typename Tmp2, typename Tmp3, typename Tmp4>
 	friend
 	class TimedQueue;
 
 private:
-	std::time_t time;
+	uint64_t time;
 public:
 	using Key_t = K;
 
@@ -59,17 +60,24 @@ public:
 
 };
 
+/**
+ * @tparam B - a bucket type which selects the HashMap layout, see HashMap.h for more details.
+ * @tparam C - the clock source, the timeouts are in its ticks (see Clock.h).
+ */
 template<
 	typename Node_t,
-	typename H = std::hash<typename Node_t::Key_t>
+	typename H = std::hash<typename Node_t::Key_t>,
+	typename B = intrusive::HashMapBucket<Node_t>,
+	typename C = TimeClock
 >
 class TimedQueue {
 	friend class TestTimedQueue;
 
-	using Pool_t = intrusive::HashQueuePool<Node_t, H, dpdk::Allocator<Node_t>, dpdk::Allocator<intrusive::HashMapBucket<Node_t> > >;
+	using Pool_t = intrusive::HashQueuePool<Node_t, H, dpdk::Allocator<Node_t>, dpdk::Allocator<B> >;
 	Pool_t m_pool;
 	const size_t m_capacity;
-	std::time_t m_push_time;
+	C m_clock;
+	uint64_t m_push_time;
 	TimedQueueStat m_stat;
 
 public:
@@ -77,9 +85,10 @@ public:
 	using Key_t = typename Node_t::Key_t;
 	using Iterator_t = typename Pool_t::Iterator_t;
 
-	TimedQueue(size_t capacity, float load_factor) noexcept
-		: m_pool(capacity, load_factor)
+	TimedQueue(size_t capacity, float load_factor, intrusive::HashMapSizing sizing = intrusive::HashMapSizing::EXACT) noexcept
+		: m_pool(capacity, load_factor, sizing)
 		, m_capacity(capacity)
+		, m_clock()
 		, m_push_time(0)
 		, m_stat() {}
 
@@ -87,45 +96,128 @@ public:
 		return m_pool.allocate();
 	}
 
+	/**
+	 * @return the clock source, e.g. to set the time of a burst.
+	 */
+	inline C& clock() noexcept {
+		return m_clock;
+	}
+
 	Iterator_t push_back(const Key_t& key) noexcept {
-		std::time_t time = std::time(nullptr);
+		const uint64_t time = m_clock.now();
 		assert(time >= m_push_time); // TODO: 
 		auto it = m_pool.push_back(key);
 		if(it) {
 			it->time = time;
 			m_push_time = time;
+			m_stat.pushed++;
+		} else {
+			m_stat.dropped++;
+		}
+		return it;
+	}
+
+	/**
+	 * Refresh the time of a node and move it to the tail, the hash node is not relinked.
+	 */
+	inline void touch(Iterator_t it) noexcept {
+		const uint64_t time = m_clock.now();
+		assert(time >= m_push_time); // the clock is monotonic, so the tail stays the newest node
+		it->time = time;
+		m_push_time = time;
+		m_pool.move_back(it);
+	}
+
+	/**
+	 * Refresh the first node of the key.
+	 * @return end() - if there is no node of the key.
+	 */
+	Iterator_t touch(const Key_t& key) noexcept {
+		auto it = m_pool.find(key);
+		if(it) {
+			touch(it);
+		}
+		return it;
+	}
+
+	/**
+	 * Refresh the first node of the key or push a new node back, with a single map probe,
+	 * e.g. for a flow cache where every packet refreshes its flow.
+	 * @param pushed - true if a new node has been pushed.
+	 * @return end() - if the key is missed and the queue is full.
+	 */
+	Iterator_t touch_or_push(const Key_t& key, bool& pushed) noexcept {
+		auto it = m_pool.find_or_insert(key, pushed);
+		if(pushed) {
+			const uint64_t time = m_clock.now();
+			assert(time >= m_push_time); // a monotonic clock keeps the queue in the time order, pop_front() checks the head only
+			it->time = time;
+			m_push_time = time;
+			m_stat.pushed++;
+		} else if(it) {
+			touch(it);
+		} else {
+			m_stat.dropped++;
 		}
 		return it;
 	}
 
-	Iterator_t pop_front(unsigned sec) noexcept {
+	/**
+	 * @param timeout - clock ticks, seconds for the default TimeClock.
+	 */
+	Iterator_t pop_front(uint64_t timeout) noexcept {
 		Iterator_t result;
 		auto it = m_pool.peek_front();
 		if(it) {
-			std::time_t now = std::time(nullptr);
-			if(std::difftime(now, it->time) >= sec) {
+			const uint64_t now = m_clock.now();
+			if(now - it->time >= timeout) {
 				m_pool.remove(it);
 				result = it;
+				m_stat.expired++;
 			}
 		}
 		return result;
 	}
 
+	/**
+	 * Find the first node of the key, the time of the node is not refreshed.
+	 * @return end() - if there is no node of the key.
+	 */
+	inline Iterator_t find(const Key_t& key) noexcept {
+		return m_pool.find(key);
+	}
+
 	Iterator_t remove(const Key_t& key) noexcept {
 		auto it = m_pool.find(key);
 		if(it) {
-			m_pool.remove(it);
+			remove(it);
 		}
 		return it;
 	}
 
+	/**
+	 * Remove a node found by find() or pushed by push_back().
+	 */
+	inline void remove(Iterator_t it) noexcept {
+		m_pool.remove(it);
+		m_stat.removed++;
+	}
+
+	/**
+	 * Find the first nodes of a burst of keys, see intrusive::HashMap::find_bulk().
+	 * @param out - n iterators, end() for the missed keys.
+	 */
+	inline void find_bulk(const Key_t* keys, size_t n, Iterator_t* out) noexcept {
+		m_pool.find_bulk(keys, n, out);
+	}
+
 	inline void remove_all(const Key_t& key) noexcept {
 		Iterator_t tmp;
 		auto it = m_pool.find(key);
 		while(it) {
 			tmp = it;
 			it.next(key);
-			m_pool.remove(tmp);
+			remove(tmp);
 		}
 	}
 
@@ -147,6 +239,13 @@ public:
 		stat.capacity = m_capacity;
 	}
 
+	/**
+	 * @return the hot path counters of the underlying pool, see HashQueuePool::metrics().
+	 */
+	inline const intrusive::HashQueuePoolMetrics& metrics() const noexcept {
+		return m_pool.metrics();
+	}
+
 	inline Iterator_t end() noexcept {
 		return m_pool.end();
 	}
@@ -10,16 +10,25 @@ namespace storage {
 struct TimedQueueStat {
 	size_t capacity;
 	size_t size;
+	uint64_t pushed; // the new nodes
+	uint64_t dropped; // the pushes which have found no free node
+	uint64_t expired; // the nodes removed by their timeout
+	uint64_t removed; // the nodes removed before their timeout
+
+	TimedQueueStat() noexcept : capacity(0), size(0), pushed(0), dropped(0), expired(0), removed(0) {}
 
 	static void print_field(FILE* out, const char* name, uint64_t value, uint64_t value_prev) noexcept {
 		fprintf(out, "%s=%zu(%zu) ", name, value, value - value_prev);
 	}
 
-	void print(FILE* out, const TimedQueueStat&) const noexcept {
+	void print(FILE* out, const TimedQueueStat& prev) const noexcept {
 		float load_factor = (static_cast<float>(size) / capacity) * 100.0f;
 		fprintf(out, "[TQ] ");
 		fprintf(out, "%zu/%zu (%.2f%%) ", size, capacity, load_factor);
-		//        print_field(out, "put_col", put_collision, prev.put_collision);
+		print_field(out, "pushed", pushed, prev.pushed);
+		print_field(out, "dropped", dropped, prev.dropped);
+		print_field(out, "expired", expired, prev.expired);
+		print_field(out, "removed", removed, prev.removed);
 	}
 };
 
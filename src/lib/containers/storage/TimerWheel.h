@@ -0,0 +1,359 @@
+#ifndef STORAGE_TIMERWHEEL_H
+#define STORAGE_TIMERWHEEL_H
+
+#include "TimedQueueStat.h"
+#include "../../../intrusive/LinkedList.h"
+#include "../../../intrusive/HashMap.h"
+#include "../dpdk/Allocator.h"
+
+#include <cstdint>
+#include <cstdio>
+
+namespace storage {
+
+template<typename K, typename V, template<typename, typename> class MH = intrusive::HashMapHook>
+struct TimerWheelNode
+	: public intrusive::LinkedListHook<TimerWheelNode<K, V, MH> >, MH<K, TimerWheelNode<K, V, MH> > {
+	template<typename Tmp1, typename Tmp2, typename Tmp3>
+	friend
+	class TimerWheel;
+
+private:
+	uint64_t expire; // the tick to expire at
+	uint32_t slot; // the wheel slot which links the node
+public:
+	using Key_t = K;
+	V value;
+
+	TimerWheelNode() : expire(0), slot(0), value() {}
+
+	TimerWheelNode(const TimerWheelNode&) = delete;
+	TimerWheelNode& operator=(const TimerWheelNode&) = delete;
+
+	TimerWheelNode(TimerWheelNode&&) = delete;
+	TimerWheelNode& operator=(TimerWheelNode&&) = delete;
+
+	bool operator==(const TimerWheelNode& data) const noexcept {
+		return value == data.value;
+	}
+};
+
+template<typename K, template<typename, typename> class MH = intrusive::HashMapHook>
+struct TimerWheelEmptyNode
+	: public intrusive::LinkedListHook<TimerWheelEmptyNode<K, MH> >, MH<K, TimerWheelEmptyNode<K, MH> > {
+	template<typename Tmp1, typename Tmp2, typename Tmp3>
+	friend
+	class TimerWheel;
+
+private:
+	uint64_t expire;
+	uint32_t slot;
+public:
+	using Key_t = K;
+
+	TimerWheelEmptyNode() : expire(0), slot(0) {}
+
+	TimerWheelEmptyNode(const TimerWheelEmptyNode&) = delete;
+	TimerWheelEmptyNode& operator=(const TimerWheelEmptyNode&) = delete;
+
+	TimerWheelEmptyNode(TimerWheelEmptyNode&&) = delete;
+	TimerWheelEmptyNode& operator=(TimerWheelEmptyNode&&) = delete;
+
+};
+
+/**
+ * A hierarchical timing wheel, a TimedQueue with the own timeout per node.
+ * The time is counted in ticks (e.g. milliseconds) supplied by the caller, so no clock is read per node.
+ * The wheel has LEVELS levels of SLOTS slots, a slot of a level spans a whole turn of the level below,
+ * the nodes of a slot are cascaded to the lower levels when the slot comes up.
+ * So schedule(), cancel() and refresh() are O(1) and expire() touches the due slots only.
+ * The timeouts are clamped with TIMEOUT_MAX ticks (~49 days of milliseconds).
+ *
+ * The nodes are kept in the node storage as in HashQueuePool, a node is linked by its slot list
+ * when it is scheduled and by the free list otherwise.
+ *
+ * @tparam B - a bucket type which selects the HashMap layout, see HashMap.h for more details.
+ */
+template<
+	typename Node_t,
+	typename H = std::hash<typename Node_t::Key_t>,
+	typename B = intrusive::HashMapBucket<Node_t>
+>
+class TimerWheel {
+	friend class TestTimerWheel;
+
+	using Key_t = typename Node_t::Key_t;
+	using List_t = intrusive::LinkedList<Node_t>;
+	using Map_t = intrusive::HashMap<Key_t, Node_t, H, dpdk::Allocator<B> >;
+
+	static constexpr unsigned LEVEL_BITS = 8;
+	static constexpr unsigned LEVELS = 4;
+	static constexpr unsigned SLOTS = 1u << LEVEL_BITS;
+	static constexpr uint64_t SLOT_MASK = SLOTS - 1;
+
+	const size_t m_capacity;
+	Node_t* m_storage;
+	Map_t m_map;
+	List_t m_slots[LEVELS * SLOTS];
+	List_t m_list_freed;
+	uint64_t m_now; // the last expired tick
+	TimedQueueStat m_stat;
+	dpdk::Allocator<Node_t> m_allocator;
+
+public:
+
+	using Iterator_t = typename Map_t::Iterator_t;
+
+	static constexpr uint64_t TIMEOUT_MAX = (uint64_t(1) << (LEVEL_BITS * LEVELS)) - 1;
+
+	/**
+	 * @param capacity - amount of nodes.
+	 * @param load_factor - average amount of nodes per bucket.
+	 * @param now - the initial tick.
+	 */
+	TimerWheel(
+		size_t capacity
+		, float load_factor
+		, uint64_t now = 0
+		, intrusive::HashMapSizing sizing = intrusive::HashMapSizing::EXACT
+	          ) noexcept
+		: m_capacity(capacity)
+		, m_storage(nullptr)
+		, m_map((capacity / load_factor) + 1, sizing)
+		, m_slots()
+		, m_list_freed()
+		, m_now(now)
+		, m_stat()
+		, m_allocator() {}
+
+	TimerWheel(const TimerWheel&) = delete;
+	TimerWheel& operator=(const TimerWheel&) = delete;
+
+	TimerWheel(TimerWheel&&) = delete;
+	TimerWheel& operator=(TimerWheel&&) = delete;
+
+	virtual ~TimerWheel() noexcept {
+		destroy();
+	}
+
+	/**
+	 * Allocate the node storage.
+	 * @return 0 - if the storage has been allocated successfully.
+	 */
+	int allocate() noexcept {
+		if(m_storage)
+			return -1;
+
+		m_storage = m_allocator.allocate(m_capacity);
+		if(m_storage == nullptr)
+			return -1;
+
+		for(size_t i = 0; i < m_capacity; i++) {
+			m_allocator.construct(m_storage + i);
+			m_list_freed.push_back(m_storage[i]);
+		}
+
+		if(not m_map.allocate()) {
+			destroy();
+			return -1;
+		}
+		return 0;
+	}
+
+	/**
+	 * Schedule a new node.
+	 * @param timeout - ticks since the current tick (see now()).
+	 * @return end() - if the wheel is full or the map cannot hold one more node (HashMapLineBucket).
+	 */
+	Iterator_t schedule(const Key_t& key, uint64_t timeout) noexcept {
+		if(available()) {
+			Node_t* freed = m_list_freed.tail();
+			Iterator_t result = m_map.link(key, *freed);
+			if(result) {
+				m_list_freed.pop_back();
+				freed->expire = m_now + clamp(timeout);
+				link(*freed);
+				m_stat.pushed++;
+				return result;
+			}
+		}
+		m_stat.dropped++;
+		return end();
+	}
+
+	/**
+	 * Reschedule a node since the current tick.
+	 */
+	inline void refresh(Iterator_t it, uint64_t timeout) noexcept {
+		m_slots[it->slot].remove(*it);
+		it->expire = m_now + clamp(timeout);
+		link(*it);
+	}
+
+	/**
+	 * Remove a node before its timeout.
+	 */
+	inline void cancel(Iterator_t it) noexcept {
+		m_slots[it->slot].remove(*it);
+		m_map.remove(*it);
+		m_list_freed.push_back(*it);
+		m_stat.removed++;
+	}
+
+	Iterator_t remove(const Key_t& key) noexcept {
+		auto it = m_map.find(key);
+		if(it) {
+			cancel(it);
+		}
+		return it;
+	}
+
+	inline Iterator_t find(const Key_t& key) noexcept {
+		return m_map.find(key);
+	}
+
+	/**
+	 * Find the first nodes of a burst of keys, see intrusive::HashMap::find_bulk().
+	 * @param out - n iterators, end() for the missed keys.
+	 */
+	inline void find_bulk(const Key_t* keys, size_t n, Iterator_t* out) noexcept {
+		m_map.find_bulk(keys, n, out);
+	}
+
+	/**
+	 * Advance the wheel up to 'now' and remove all the due nodes.
+	 * A removed node is valid in the callback only, it is reused by the next schedule().
+	 * @param now - the current tick, the earlier ticks are ignored.
+	 * @param callback - a functor which takes 'Node_t&'.
+	 * @return amount of the expired nodes.
+	 */
+	template<typename F>
+	size_t expire(uint64_t now, const F& callback) noexcept {
+		size_t result = 0;
+		while(m_now < now) {
+			if(size() == 0) {
+				m_now = now;
+				break;
+			}
+			m_now++;
+			for(unsigned level = 1; level < LEVELS && (m_now & level_mask(level)) == 0; level++) {
+				cascade(level);
+			}
+
+			List_t& due = m_slots[m_now & SLOT_MASK];
+			while(Node_t* node = due.pop_front()) {
+				m_map.remove(*node);
+				m_list_freed.push_back(*node);
+				callback(*node);
+				result++;
+			}
+		}
+		m_stat.expired += result;
+		return result;
+	}
+
+	/**
+	 * @return the last expired tick, the timeouts are counted since it.
+	 */
+	inline uint64_t now() const noexcept {
+		return m_now;
+	}
+
+	/**
+	 * @return the ticks left until the node expires.
+	 */
+	inline uint64_t remaining(Iterator_t it) const noexcept {
+		return it->expire - m_now;
+	}
+
+	void reset() noexcept {
+		m_map.clear();
+		for(size_t i = 0; i < LEVELS * SLOTS; i++) {
+			m_slots[i].clear();
+		}
+		m_list_freed.clear();
+		for(size_t i = 0; i < m_capacity; i++) {
+			m_list_freed.push_back(m_storage[i]);
+		}
+	}
+
+	inline size_t capacity() const noexcept {
+		return m_capacity;
+	}
+
+	inline size_t size() const noexcept {
+		return m_capacity - m_list_freed.size();
+	}
+
+	inline size_t available() const noexcept {
+		return m_list_freed.size();
+	}
+
+	inline size_t storage_bytes() noexcept {
+		return m_capacity * sizeof(Node_t) + m_map.buckets() * sizeof(B) + sizeof(m_slots);
+	}
+
+	void load(TimedQueueStat& stat) const noexcept {
+		stat = m_stat;
+		stat.size = size();
+		stat.capacity = m_capacity;
+	}
+
+	inline Iterator_t end() noexcept {
+		return m_map.end();
+	}
+
+private:
+
+	static inline uint64_t clamp(uint64_t timeout) noexcept {
+		// a node is never due at the current tick, it has been expired already
+		return timeout == 0 ? 1 : (timeout > TIMEOUT_MAX ? TIMEOUT_MAX : timeout);
+	}
+
+	static inline uint64_t level_mask(unsigned level) noexcept {
+		return (uint64_t(1) << (LEVEL_BITS * level)) - 1;
+	}
+
+	/**
+	 * Link the node by the slot of the level which spans its timeout.
+	 */
+	inline void link(Node_t& node) noexcept {
+		const uint64_t delta = node.expire - m_now;
+		unsigned level = 0;
+		while(level + 1 < LEVELS && delta > level_mask(level + 1)) {
+			level++;
+		}
+		node.slot = uint32_t(level * SLOTS + ((node.expire >> (LEVEL_BITS * level)) & SLOT_MASK));
+		m_slots[node.slot].push_back(node);
+	}
+
+	/**
+	 * Move the nodes of the current slot of a level to the lower levels.
+	 */
+	inline void cascade(unsigned level) noexcept {
+		List_t& slot = m_slots[level * SLOTS + ((m_now >> (LEVEL_BITS * level)) & SLOT_MASK)];
+		while(Node_t* node = slot.pop_front()) {
+			link(*node);
+		}
+	}
+
+	void destroy() noexcept {
+		if(m_storage) {
+			m_list_freed.clear();
+			for(size_t i = 0; i < LEVELS * SLOTS; i++) {
+				m_slots[i].clear();
+			}
+			m_map.clear();
+			for(size_t i = 0; i < m_capacity; i++) {
+				m_allocator.destroy(m_storage + i);
+			}
+			m_allocator.deallocate(m_storage, m_capacity);
+			m_storage = nullptr;
+		}
+	}
+
+};
+
+}; // namespace storage
+
+#endif /* STORAGE_TIMERWHEEL_H */
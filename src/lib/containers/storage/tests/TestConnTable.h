@@ -0,0 +1,272 @@
+#ifndef STORAGE_TESTS_TESTCONNTABLE_H
+#define STORAGE_TESTS_TESTCONNTABLE_H
+
+#include "containers/storage/ConnTable.h"
+
+#include <assert.h>
+#include <iostream>
+#include <vector>
+
+namespace storage {
+
+class TestConnTable {
+
+	using Table_t = ConnTable<BurstClock<1000> >;
+	using Conn = proto::TcpConn;
+
+	static constexpr size_t L4 = 34; // Ethernet + IPv4 without options
+	static constexpr uint8_t SYN = proto::Tcp::FLAG_SYN;
+	static constexpr uint8_t ACK = proto::Tcp::FLAG_ACK;
+	static constexpr uint8_t FIN = proto::Tcp::FLAG_FIN;
+	static constexpr uint8_t RST = proto::Tcp::FLAG_RST;
+
+	struct Collector {
+		std::vector<FlowEntry>* entries;
+
+		void operator()(const FlowEntry& entry) const noexcept {
+			entries->push_back(entry);
+		}
+	};
+
+	Table_t m_table;
+	const size_t m_capacity;
+	uint64_t m_base;
+	std::vector<FlowEntry> m_expired;
+	const ConnTimeouts m_timeouts;
+	uint8_t m_frame[L4 + sizeof(proto::Tcp::Header)];
+
+public:
+
+	TestConnTable(unsigned capacity) noexcept
+		: m_table(capacity), m_capacity(capacity), m_base(0), m_expired(), m_timeouts(), m_frame() {
+		assert(m_table.allocate() == 0);
+	}
+
+	TestConnTable(const TestConnTable&) = delete;
+	TestConnTable(TestConnTable&&) = delete;
+
+	TestConnTable operator=(const TestConnTable&) = delete;
+	TestConnTable operator=(TestConnTable&&) = delete;
+
+	~TestConnTable() {}
+
+	void test() noexcept {
+		printf("<TestConnTable>...\n");
+		printf("capacity=%zu\n", m_capacity);
+		printf("sizeof(FlowEntry)=%zu\n", sizeof(FlowEntry));
+		printf("storage_bytes=%.2f Kb\n", m_table.storage_bytes() / (float) 1024.0);
+
+		unsigned step = 1;
+		test_handshake_close(step++);
+		test_invalid(step++);
+		test_reset_timeout(step++);
+		test_pickup_reopen(step++);
+		test_udp_timeout(step++);
+		test_full(step++);
+	}
+
+	void test_handshake_close(unsigned step) noexcept {
+		printf("-> test_handshake_close(step=%u)\n", step);
+		reset();
+		const proto::ParsedFlow ab = tcp(1, 2, 1000, 80);
+		const proto::ParsedFlow ba = tcp(2, 1, 80, 1000);
+		const proto::FlowKey key = proto::FlowKey::of(ab);
+
+		assert(state(ab, SYN) == Conn::SYN_SENT);
+		assert(m_table.remaining(key) == m_timeouts.tcp[Conn::SYN_SENT]);
+		assert(state(ab, SYN) == Conn::SYN_SENT); // retransmitted
+		assert(state(ba, SYN | ACK) == Conn::SYN_RECV);
+		assert(m_table.remaining(key) == m_timeouts.tcp[Conn::SYN_RECV]);
+		assert(state(ab, ACK) == Conn::ESTABLISHED);
+		assert(m_table.remaining(key) == m_timeouts.tcp[Conn::ESTABLISHED]);
+		assert(state(ba, ACK) == Conn::ESTABLISHED);
+		assert(m_table.size() == 1);
+
+		assert(state(ab, FIN | ACK) == Conn::FIN_WAIT);
+		assert(state(ba, ACK) == Conn::FIN_WAIT);
+		assert(state(ba, FIN | ACK) == Conn::TIME_WAIT);
+		assert(state(ab, ACK) == Conn::TIME_WAIT);
+		assert(m_table.remaining(key) == m_timeouts.tcp[Conn::TIME_WAIT]);
+
+		const FlowEntry* entry = m_table.find(key);
+		assert(entry != nullptr && entry->key == key);
+		assert(entry->forward.packets == 5);
+		assert(entry->reverse.packets == 4);
+		assert(m_table.stat().conns == 1);
+		assert(m_table.stat().packets == 9);
+		assert(m_table.stat().invalid == 0);
+	}
+
+	void test_invalid(unsigned step) noexcept {
+		printf("-> test_invalid(step=%u)\n", step);
+		reset();
+		const proto::ParsedFlow ab = tcp(1, 2, 1000, 80);
+		const proto::ParsedFlow ba = tcp(2, 1, 80, 1000);
+		const proto::FlowKey key = proto::FlowKey::of(ab);
+		bool valid;
+
+		// no connection starts with SYN+ACK or RST
+		assert(update(ba, SYN | ACK, valid) == nullptr && not valid);
+		assert(update(ab, RST, valid) == nullptr && not valid);
+		assert(m_table.size() == 0);
+
+		assert(state(ab, SYN) == Conn::SYN_SENT);
+		at(1000);
+		// the ACK of the initiator before SYN+ACK
+		assert(update(ab, ACK, valid) != nullptr && not valid);
+		assert(m_table.find(key)->tcp.state == Conn::SYN_SENT);
+		// the invalid packets don't refresh the connection
+		assert(m_table.remaining(key) == m_timeouts.tcp[Conn::SYN_SENT] - 1000);
+		assert(update(ba, SYN, valid) != nullptr && not valid);
+
+		assert(state(ba, SYN | ACK) == Conn::SYN_RECV);
+		assert(state(ab, ACK) == Conn::ESTABLISHED);
+		assert(update(ab, SYN, valid) != nullptr && not valid);
+		assert(m_table.find(key)->tcp.state == Conn::ESTABLISHED);
+		assert(m_table.stat().invalid == 5);
+	}
+
+	void test_reset_timeout(unsigned step) noexcept {
+		printf("-> test_reset_timeout(step=%u)\n", step);
+		reset();
+		const proto::ParsedFlow ab = tcp(1, 2, 1000, 80);
+		const proto::ParsedFlow ba = tcp(2, 1, 80, 1000);
+
+		assert(state(ab, ACK) == Conn::ESTABLISHED);
+		assert(state(ba, RST) == Conn::CLOSE);
+		bool valid;
+		assert(update(ab, ACK, valid) != nullptr && not valid);
+
+		const uint64_t timeout = m_timeouts.tcp[Conn::CLOSE];
+		at(timeout - 1);
+		assert(expire() == 0);
+		at(timeout);
+		assert(expire() == 1);
+		assert(m_expired.size() == 1);
+		assert(m_expired[0].key == proto::FlowKey::of(ab));
+		assert(m_expired[0].tcp.state == Conn::CLOSE);
+		assert(m_table.size() == 0);
+		assert(m_table.stat().expired == 1);
+	}
+
+	void test_pickup_reopen(unsigned step) noexcept {
+		printf("-> test_pickup_reopen(step=%u)\n", step);
+		reset();
+		const proto::ParsedFlow ab = tcp(1, 2, 1000, 80);
+		const proto::ParsedFlow ba = tcp(2, 1, 80, 1000);
+
+		// the connection is picked up in the middle
+		assert(state(ba, ACK) == Conn::ESTABLISHED);
+		assert(m_table.find(proto::FlowKey::of(ab))->key == proto::FlowKey::of(ba));
+		assert(state(ab, FIN | ACK) == Conn::FIN_WAIT);
+		assert(state(ba, FIN | ACK) == Conn::TIME_WAIT);
+
+		// the responder of the picked up connection is the initiator
+		bool valid;
+		assert(update(ab, SYN, valid) != nullptr && not valid);
+		assert(state(ba, SYN) == Conn::SYN_SENT);
+		assert(m_table.find(proto::FlowKey::of(ab))->tcp.fin == 0);
+		assert(m_table.size() == 1);
+	}
+
+	void test_udp_timeout(unsigned step) noexcept {
+		printf("-> test_udp_timeout(step=%u)\n", step);
+		reset();
+		proto::ParsedFlow flow = ip(1, 2);
+		flow.protocols |= 1u << proto::Protocol::L4_UDP;
+		flow.ip_protocol = proto::IPv4::PROTO_UDP;
+		flow.src_port = htons(53);
+		flow.dst_port = htons(53);
+		bool valid;
+		assert(m_table.update(m_frame, flow, 100, valid) != nullptr && valid);
+		at(5000);
+		assert(expire() == 0);
+		at(10000);
+		assert(m_table.update(m_frame, flow, 100, valid) != nullptr && valid);
+
+		// the timeout is counted since the packet, not since the last expire()
+		at(10000 + m_timeouts.udp - 1);
+		assert(expire() == 0);
+		at(10000 + m_timeouts.udp);
+		assert(expire() == 1);
+		assert(m_expired[0].forward.packets == 2);
+	}
+
+	void test_full(unsigned step) noexcept {
+		printf("-> test_full(step=%u)\n", step);
+		reset();
+		for(uint32_t i = 0; i < m_capacity; i++) {
+			assert(state(tcp(i, 0xFFFFFF, 1000, 80), SYN) == Conn::SYN_SENT);
+		}
+		bool valid;
+		assert(update(tcp(m_capacity, 0xFFFFFF, 1000, 80), SYN, valid) == nullptr && not valid);
+		assert(m_table.stat().dropped == 1);
+		// the known connections go on
+		assert(state(tcp(0xFFFFFF, 0, 80, 1000), SYN | ACK) == Conn::SYN_RECV);
+		assert(state(tcp(0, 0xFFFFFF, 1000, 80), ACK) == Conn::ESTABLISHED);
+
+		at(m_timeouts.tcp[Conn::SYN_SENT]);
+		assert(expire() == m_capacity - 1);
+		assert(m_table.size() == 1);
+	}
+
+private:
+
+	/**
+	 * Empty the table, the tests run in their own time from m_base, the clock never goes back.
+	 */
+	void reset() noexcept {
+		m_table.m_wheel.reset();
+		m_base += 1000000000;
+		at(0);
+		m_table.m_stat = ConnTableStat();
+		m_expired.clear();
+	}
+
+	inline void at(uint64_t now) noexcept {
+		m_table.clock().set(m_base + now);
+	}
+
+	size_t expire() noexcept {
+		return m_table.expire(Collector{&m_expired});
+	}
+
+	uint8_t state(const proto::ParsedFlow& flow, uint8_t flags) noexcept {
+		bool valid;
+		const FlowEntry* entry = update(flow, flags, valid);
+		assert(entry != nullptr && valid);
+		return entry->tcp.state;
+	}
+
+	FlowEntry* update(const proto::ParsedFlow& flow, uint8_t flags, bool& valid) noexcept {
+		m_frame[L4 + offsetof(proto::Tcp::Header, flags)] = flags;
+		return m_table.update(m_frame, flow, 60, valid);
+	}
+
+	static proto::ParsedFlow tcp(uint32_t src, uint32_t dst, uint16_t src_port, uint16_t dst_port) noexcept {
+		proto::ParsedFlow flow = ip(src, dst);
+		flow.protocols |= 1u << proto::Protocol::L4_TCP;
+		flow.ip_protocol = proto::IPv4::PROTO_TCP;
+		flow.src_port = htons(src_port);
+		flow.dst_port = htons(dst_port);
+		return flow;
+	}
+
+	static proto::ParsedFlow ip(uint32_t src, uint32_t dst) noexcept {
+		proto::ParsedFlow flow;
+		memset(&flow, 0, sizeof(flow));
+		flow.protocols = (1u << proto::Protocol::L2_ETHERNET) | (1u << proto::Protocol::L3_IPv4);
+		flow.l3 = L4 - sizeof(proto::IPv4::Header);
+		flow.l4 = L4;
+		flow.payload = L4 + sizeof(proto::Tcp::Header);
+		flow.ip_version = 4;
+		flow.src.addr32[0] = htonl(src);
+		flow.dst.addr32[0] = htonl(dst);
+		return flow;
+	}
+
+};
+
+}; // namespace storage
+
+#endif /* STORAGE_TESTS_TESTCONNTABLE_H */
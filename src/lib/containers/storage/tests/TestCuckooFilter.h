@@ -0,0 +1,141 @@
+#ifndef STORAGE_TESTS_TESTCUCKOOFILTER_H
+#define STORAGE_TESTS_TESTCUCKOOFILTER_H
+
+#include "containers/storage/CuckooFilter.h"
+
+#include <assert.h>
+#include <iostream>
+
+namespace storage {
+
+class TestCuckooFilter {
+
+	using Filter_t = CuckooFilter<>;
+
+	Filter_t m_filter;
+	const size_t m_capacity;
+
+public:
+
+	TestCuckooFilter(unsigned capacity) noexcept
+		: m_filter(capacity), m_capacity(capacity) {
+		assert(m_filter.allocate() == 0);
+		assert(m_filter.allocate() != 0);
+	}
+
+	TestCuckooFilter(const TestCuckooFilter&) = delete;
+	TestCuckooFilter(TestCuckooFilter&&) = delete;
+
+	TestCuckooFilter operator=(const TestCuckooFilter&) = delete;
+	TestCuckooFilter operator=(TestCuckooFilter&&) = delete;
+
+	~TestCuckooFilter() {}
+
+	void test() noexcept {
+		printf("<TestCuckooFilter>...\n");
+		printf("capacity=%zu\n", m_capacity);
+		printf("slots=%zu\n", m_filter.slots());
+		printf("storage_bytes=%.2f Kb\n", m_filter.storage_bytes() / (float) 1024.0);
+
+		unsigned step = 1;
+		test_insert_remove(step++);
+		test_duplicates(step++);
+		test_saturate(step++);
+	}
+
+private:
+
+	static inline uint64_t hash_of(uint64_t key) noexcept {
+		return SketchHash::mix(key);
+	}
+
+	bool empty() const noexcept {
+		for(size_t i = 0; i < m_filter.m_bucket_count; i++) {
+			if(m_filter.m_buckets[i]) {
+				return false;
+			}
+		}
+		return m_filter.m_victim == 0;
+	}
+
+	/**
+	 * The full capacity: no false negatives, the false positives as expected, nothing is left after the removal.
+	 */
+	void test_insert_remove(unsigned step) noexcept {
+		printf("-> test_insert_remove(step=%u)\n", step);
+		m_filter.clear();
+
+		for(uint64_t key = 0; key < m_capacity; key++) {
+			m_filter.insert_hash(hash_of(key));
+		}
+		assert(m_filter.size() == m_capacity);
+		assert(not m_filter.saturated());
+		for(uint64_t key = 0; key < m_capacity; key++) {
+			assert(m_filter.contains_hash(hash_of(key)));
+		}
+
+		const uint64_t probes = 1000000;
+		uint64_t positives = 0;
+		for(uint64_t key = m_capacity; key < m_capacity + probes; key++) {
+			positives += m_filter.contains_hash(hash_of(key));
+		}
+		const double measured = double(positives) / double(probes);
+		printf("load=%.2f false_positive_rate=%.5f%% expected=%.5f%%\n", m_filter.load(), measured * 100,
+			m_filter.false_positive_rate() * 100);
+		assert(measured < 2 * m_filter.false_positive_rate() + 0.0001);
+
+		for(uint64_t key = 0; key < m_capacity; key++) {
+			assert(m_filter.remove_hash(hash_of(key)));
+		}
+		assert(m_filter.size() == 0);
+		assert(empty());
+		assert(not m_filter.remove_hash(hash_of(0)));
+	}
+
+	/**
+	 * A key inserted n times stays until it is removed n times.
+	 */
+	void test_duplicates(unsigned step) noexcept {
+		printf("-> test_duplicates(step=%u)\n", step);
+		m_filter.clear();
+
+		const uint64_t hash = hash_of(7);
+		for(unsigned i = 0; i < 3; i++) {
+			m_filter.insert_hash(hash);
+		}
+		for(unsigned i = 0; i < 3; i++) {
+			assert(m_filter.contains_hash(hash));
+			assert(m_filter.remove_hash(hash));
+		}
+		assert(not m_filter.contains_hash(hash));
+		assert(empty());
+	}
+
+	/**
+	 * The keys beyond the slots saturate the filter, it passes everything until it is empty.
+	 */
+	void test_saturate(unsigned step) noexcept {
+		printf("-> test_saturate(step=%u)\n", step);
+		Filter_t filter(8);
+		assert(filter.allocate() == 0);
+		const uint64_t n = filter.slots() * 2;
+		for(uint64_t key = 0; key < n; key++) {
+			filter.insert_hash(hash_of(key));
+		}
+		assert(filter.saturated());
+		assert(filter.false_positive_rate() == 1.0);
+		for(uint64_t key = 0; key < 2 * n; key++) {
+			assert(filter.contains_hash(hash_of(key)));
+		}
+		for(uint64_t key = 0; key < n; key++) {
+			assert(filter.remove_hash(hash_of(key)));
+		}
+		assert(not filter.saturated());
+		assert(not filter.contains_hash(hash_of(0)));
+	}
+
+};
+
+}; // namespace storage
+
+#endif /* STORAGE_TESTS_TESTCUCKOOFILTER_H */
@@ -0,0 +1,262 @@
+#ifndef STORAGE_TESTS_TESTFLOWTABLE_H
+#define STORAGE_TESTS_TESTFLOWTABLE_H
+
+#include "containers/storage/FlowTable.h"
+
+#include <assert.h>
+#include <iostream>
+#include <vector>
+
+namespace storage {
+
+class TestFlowTable {
+
+	struct Collector {
+		std::vector<FlowRecord>* records;
+		size_t* calls;
+
+		void operator()(const FlowRecord* batch, size_t n) noexcept {
+			assert(n > 0 && n <= FlowTable<Collector>::BATCH);
+			records->insert(records->end(), batch, batch + n);
+			(*calls)++;
+		}
+	};
+
+	using Table_t = FlowTable<Collector, BurstClock<1000> >;
+
+	static constexpr unsigned IDLE_MS = 1000;
+	static constexpr unsigned ACTIVE_MS = 5000;
+	static constexpr size_t L4 = 34; // Ethernet + IPv4 without options
+
+	std::vector<FlowRecord> m_records;
+	size_t m_calls;
+	uint64_t m_base;
+	Table_t m_table;
+	const size_t m_capacity;
+	uint8_t m_frame[L4 + sizeof(proto::Tcp::Header)];
+
+public:
+
+	TestFlowTable(unsigned capacity) noexcept
+		: m_records(), m_calls(0), m_base(0), m_table(capacity, IDLE_MS, ACTIVE_MS, 1.0f, Collector{&m_records, &m_calls})
+		, m_capacity(capacity), m_frame() {
+		assert(m_table.allocate() == 0);
+	}
+
+	TestFlowTable(const TestFlowTable&) = delete;
+	TestFlowTable(TestFlowTable&&) = delete;
+
+	TestFlowTable operator=(const TestFlowTable&) = delete;
+	TestFlowTable operator=(TestFlowTable&&) = delete;
+
+	~TestFlowTable() {}
+
+	void test() noexcept {
+		printf("<TestFlowTable>...\n");
+		printf("capacity=%zu\n", m_capacity);
+		printf("storage_bytes=%.2f Kb\n", m_table.storage_bytes() / (float) 1024.0);
+
+		unsigned step = 1;
+		test_bidirectional(step++);
+		test_idle(step++);
+		test_active(step++);
+		test_evict(step++);
+		test_flush_batches(step++);
+		test_ignored(step++);
+	}
+
+	void test_bidirectional(unsigned step) noexcept {
+		printf("-> test_bidirectional(step=%u)\n", step);
+		reset(1);
+		const proto::ParsedFlow ab = tcp(1, 2, 1000, 80);
+		const proto::ParsedFlow ba = tcp(2, 1, 80, 1000);
+
+		assert(update(ab, 0x02, 60) != nullptr); // SYN
+		assert(update(ba, 0x12, 60) != nullptr); // SYN+ACK
+		assert(update(ab, 0x10, 100) != nullptr);
+		FlowEntry* entry = update(ab, 0x18, 200);
+		assert(entry != nullptr);
+		assert(m_table.size() == 1);
+
+		assert(entry->key == proto::FlowKey::of(ab));
+		assert(entry->forward.packets == 3);
+		assert(entry->forward.bytes == 360);
+		assert(entry->forward.tcp_flags == 0x1A);
+		assert(entry->reverse.packets == 1);
+		assert(entry->reverse.bytes == 60);
+		assert(entry->reverse.tcp_flags == 0x12);
+		assert(m_table.find(proto::FlowKey::of(ba)) == entry);
+
+		const proto::ParsedFlow other = tcp(1, 2, 1001, 80);
+		assert(m_table.find(proto::FlowKey::of(other)) == nullptr);
+		assert(update(other, 0x02, 60) != entry);
+		assert(m_table.size() == 2);
+		assert(m_table.stat().flows == 2);
+		assert(m_table.stat().packets == 5);
+	}
+
+	void test_idle(unsigned step) noexcept {
+		printf("-> test_idle(step=%u)\n", step);
+		reset(1);
+		update(udp(1, 2), 100);
+		at(500);
+		update(udp(3, 4), 100);
+		at(1200);
+		update(udp(2, 1), 100); // the reverse direction refreshes the first flow
+
+		at(1600);
+		m_table.expire();
+		assert(m_records.size() == 1);
+		assert(m_records[0].reason == FlowEnd::IDLE);
+		assert(m_records[0].flow.key == proto::FlowKey::of(udp(3, 4)));
+		assert(m_records[0].flow.first == m_base + 500);
+		assert(m_records[0].flow.last == m_base + 500);
+		assert(m_table.size() == 1);
+
+		at(2199);
+		m_table.expire();
+		assert(m_records.size() == 1);
+		at(2200);
+		m_table.expire();
+		assert(m_records.size() == 2);
+		assert(m_records[1].flow.key == proto::FlowKey::of(udp(1, 2)));
+		assert(m_records[1].flow.forward.packets == 1);
+		assert(m_records[1].flow.reverse.packets == 1);
+		assert(m_records[1].flow.first == m_base + 1 && m_records[1].flow.last == m_base + 1200);
+		assert(m_table.size() == 0);
+		assert(m_table.stat().idle == 2);
+	}
+
+	void test_active(unsigned step) noexcept {
+		printf("-> test_active(step=%u)\n", step);
+		reset(1);
+		for(uint64_t now = 1; now < ACTIVE_MS + 1000; now += 500) {
+			at(now);
+			update(udp(1, 2), 100);
+		}
+		// the record is staged by update() and passed to the exporter by expire()
+		assert(m_records.empty());
+		m_table.expire();
+		assert(m_records.size() == 1);
+		assert(m_records[0].reason == FlowEnd::ACTIVE);
+		assert(m_records[0].flow.forward.packets == ACTIVE_MS / 500);
+		assert(m_table.size() == 1);
+
+		FlowEntry* entry = m_table.find(proto::FlowKey::of(udp(1, 2)));
+		assert(entry != nullptr);
+		assert(entry->forward.packets == 2);
+		assert(entry->first == m_base + ACTIVE_MS + 1);
+		assert(m_table.stat().active == 1);
+	}
+
+	void test_evict(unsigned step) noexcept {
+		printf("-> test_evict(step=%u)\n", step);
+		reset(1);
+		for(uint32_t i = 0; i < m_capacity; i++) {
+			at(1 + i / 16);
+			assert(update(udp(i, i + 1), 100) != nullptr);
+		}
+		assert(m_table.size() == m_capacity);
+
+		// the oldest flow goes for a new one
+		update(udp(0, 1), 100);
+		assert(update(udp(m_capacity, m_capacity + 1), 100) != nullptr);
+		assert(m_table.size() == m_capacity);
+		assert(m_table.stat().evicted == 1);
+		m_table.expire();
+		assert(m_records.size() == 1);
+		assert(m_records[0].reason == FlowEnd::EVICTED);
+		assert(m_records[0].flow.key == proto::FlowKey::of(udp(1, 2)));
+		assert(m_table.find(proto::FlowKey::of(udp(0, 1))) != nullptr);
+	}
+
+	void test_flush_batches(unsigned step) noexcept {
+		printf("-> test_flush_batches(step=%u)\n", step);
+		reset(1);
+		const size_t flows = Table_t::BATCH * 3 + 5;
+		for(uint32_t i = 0; i < flows; i++) {
+			update(udp(i, 0xFFFFFF), 100);
+		}
+		m_table.flush();
+		assert(m_table.size() == 0);
+		assert(m_records.size() == flows);
+		assert(m_calls == 4);
+		for(size_t i = 0; i < flows; i++) {
+			assert(m_records[i].reason == FlowEnd::FLUSHED);
+			assert(m_records[i].flow.key == proto::FlowKey::of(udp(uint32_t(i), 0xFFFFFF)));
+		}
+	}
+
+	void test_ignored(unsigned step) noexcept {
+		printf("-> test_ignored(step=%u)\n", step);
+		reset(1);
+		proto::ParsedFlow flow;
+		memset(&flow, 0, sizeof(flow));
+		assert(m_table.update(m_frame, flow, 100) == nullptr);
+		assert(m_table.size() == 0);
+		assert(m_table.stat().ignored == 1);
+	}
+
+private:
+
+	/**
+	 * Empty the table, the tests run in their own time from m_base, the clock never goes back.
+	 */
+	void reset(uint64_t now) noexcept {
+		m_table.flush();
+		m_table.m_stat = FlowTableStat();
+		m_base += 1000000;
+		at(now);
+		m_records.clear();
+		m_calls = 0;
+	}
+
+	inline void at(uint64_t now) noexcept {
+		m_table.clock().set(m_base + now);
+	}
+
+	static proto::ParsedFlow udp(uint32_t src, uint32_t dst) noexcept {
+		proto::ParsedFlow flow = ip(src, dst);
+		flow.protocols |= 1u << proto::Protocol::L4_UDP;
+		flow.ip_protocol = proto::IPv4::PROTO_UDP;
+		flow.src_port = htons(53);
+		flow.dst_port = htons(53);
+		return flow;
+	}
+
+	static proto::ParsedFlow tcp(uint32_t src, uint32_t dst, uint16_t src_port, uint16_t dst_port) noexcept {
+		proto::ParsedFlow flow = ip(src, dst);
+		flow.protocols |= 1u << proto::Protocol::L4_TCP;
+		flow.ip_protocol = proto::IPv4::PROTO_TCP;
+		flow.src_port = htons(src_port);
+		flow.dst_port = htons(dst_port);
+		return flow;
+	}
+
+	static proto::ParsedFlow ip(uint32_t src, uint32_t dst) noexcept {
+		proto::ParsedFlow flow;
+		memset(&flow, 0, sizeof(flow));
+		flow.protocols = (1u << proto::Protocol::L2_ETHERNET) | (1u << proto::Protocol::L3_IPv4);
+		flow.l3 = L4 - sizeof(proto::IPv4::Header);
+		flow.l4 = L4;
+		flow.payload = L4 + sizeof(proto::Tcp::Header);
+		flow.ip_version = 4;
+		flow.src.addr32[0] = htonl(src);
+		flow.dst.addr32[0] = htonl(dst);
+		return flow;
+	}
+
+	FlowEntry* update(const proto::ParsedFlow& flow, size_t bytes) noexcept {
+		return m_table.update(m_frame, flow, bytes);
+	}
+
+	FlowEntry* update(const proto::ParsedFlow& flow, uint8_t tcp_flags, size_t bytes) noexcept {
+		m_frame[L4 + offsetof(proto::Tcp::Header, flags)] = tcp_flags;
+		return m_table.update(m_frame, flow, bytes);
+	}
+
+};
+
+}; // namespace storage
+
+#endif /* STORAGE_TESTS_TESTFLOWTABLE_H */
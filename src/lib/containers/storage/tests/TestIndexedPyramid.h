@@ -0,0 +1,187 @@
+#ifndef STORAGE_TESTS_TESTINDEXEDPYRAMID_H
+#define STORAGE_TESTS_TESTINDEXEDPYRAMID_H
+
+#include "containers/storage/IndexedPyramid.h"
+
+#include <assert.h>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <vector>
+
+namespace storage {
+
+class TestIndexedPyramid {
+	using Priority_t = uint64_t;
+	using Pyramid_t = IndexedPyramid<Priority_t>;
+	using Handle_t = Pyramid_t::Handle_t;
+	using Entry_t = Pyramid_t::Entry_t;
+	using Deadlines_t = IndexedPyramid<Priority_t, std::greater<Priority_t>, 8>;
+
+	Pyramid_t m_pyramid;
+	const size_t m_capacity;
+
+public:
+
+	TestIndexedPyramid(size_t capacity) noexcept
+		: m_pyramid(capacity)
+		, m_capacity(capacity) {
+		assert(m_pyramid.allocate() == 0);
+		assert(m_pyramid.allocate() != 0);
+	}
+
+	TestIndexedPyramid(const TestIndexedPyramid&) = delete;
+	TestIndexedPyramid(TestIndexedPyramid&&) = delete;
+
+	TestIndexedPyramid operator=(const TestIndexedPyramid&) = delete;
+	TestIndexedPyramid operator=(TestIndexedPyramid&&) = delete;
+
+	~TestIndexedPyramid() {}
+
+	void test() noexcept {
+		printf("<TestIndexedPyramid>...\n");
+		printf("capacity=%zu\n", m_pyramid.capacity());
+		printf("storage_bytes=%.2f Kb\n", m_pyramid.storage_bytes() / (float) 1024.0);
+
+		unsigned step = 1;
+		test_push_pop(step++);
+		test_update(step++);
+		test_erase(step++);
+		test_clear(step++);
+		test_deadlines(step++);
+	}
+
+	void test_push_pop(unsigned step) noexcept {
+		printf("-> test_push_pop(step=%u)\n", step);
+		srand(step);
+		for(Handle_t handle = 0; handle < m_capacity; ++handle) {
+			assert(not m_pyramid.contains(handle));
+			assert(m_pyramid.push(handle, rand() % m_capacity));
+			assert(m_pyramid.contains(handle));
+			assert(not m_pyramid.push(handle, 0));
+		}
+		assert(not m_pyramid.push(Handle_t(m_capacity), 0));
+		assert(m_pyramid.size() == m_capacity);
+		validate_pop(m_capacity);
+	}
+
+	/**
+	 * The priorities are raised and lowered against a reference array.
+	 */
+	void test_update(unsigned step) noexcept {
+		printf("-> test_update(step=%u)\n", step);
+		std::vector<Priority_t> priorities(m_capacity);
+		srand(step);
+		for(Handle_t handle = 0; handle < m_capacity; ++handle) {
+			priorities[handle] = rand() % m_capacity;
+			assert(m_pyramid.push(handle, priorities[handle]));
+		}
+		for(size_t i = 0; i < m_capacity * 4; ++i) {
+			const Handle_t handle = rand() % m_capacity;
+			priorities[handle] = rand() % (m_capacity * 2);
+			assert(m_pyramid.update(handle, priorities[handle]));
+			assert(*m_pyramid.priority(handle) == priorities[handle]);
+		}
+		assert(not m_pyramid.update(Handle_t(m_capacity), 0));
+
+		Entry_t entry;
+		Priority_t last = ~Priority_t(0);
+		while(m_pyramid.pop(entry)) {
+			assert(entry.priority == priorities[entry.handle]);
+			assert(entry.priority <= last);
+			assert(not m_pyramid.contains(entry.handle));
+			assert(not m_pyramid.update(entry.handle, 0));
+			last = entry.priority;
+		}
+	}
+
+	void test_erase(unsigned step) noexcept {
+		printf("-> test_erase(step=%u)\n", step);
+		srand(step);
+		for(Handle_t handle = 0; handle < m_capacity; ++handle) {
+			assert(m_pyramid.push(handle, rand() % m_capacity));
+		}
+		size_t erased = 0;
+		for(Handle_t handle = 0; handle < m_capacity; handle += 3) {
+			assert(m_pyramid.erase(handle));
+			assert(not m_pyramid.erase(handle));
+			assert(m_pyramid.priority(handle) == nullptr);
+			erased++;
+		}
+		assert(m_pyramid.size() == m_capacity - erased);
+
+		Entry_t entry;
+		Priority_t last = ~Priority_t(0);
+		while(m_pyramid.pop(entry)) {
+			assert(entry.handle % 3);
+			assert(entry.priority <= last);
+			last = entry.priority;
+		}
+	}
+
+	void test_clear(unsigned step) noexcept {
+		printf("-> test_clear(step=%u)\n", step);
+		for(Handle_t handle = 0; handle < m_capacity; ++handle) {
+			assert(m_pyramid.push(handle, handle * step));
+		}
+		m_pyramid.clear();
+		assert(m_pyramid.size() == 0);
+		assert(m_pyramid.peek() == nullptr);
+		for(Handle_t handle = 0; handle < m_capacity; ++handle) {
+			assert(not m_pyramid.contains(handle));
+		}
+	}
+
+	/**
+	 * The earliest deadline is in the root, a re-activated flow postpones its deadline.
+	 */
+	void test_deadlines(unsigned step) noexcept {
+		printf("-> test_deadlines(step=%u)\n", step);
+		Deadlines_t deadlines(m_capacity);
+		assert(deadlines.allocate() == 0);
+		const Priority_t timeout = 100;
+		Priority_t now = 0;
+		for(Handle_t handle = 0; handle < m_capacity; ++handle, ++now) {
+			assert(deadlines.push(handle, now + timeout));
+		}
+		// the even flows are active again
+		for(Handle_t handle = 0; handle < m_capacity; handle += 2) {
+			assert(deadlines.update(handle, now + timeout));
+		}
+
+		size_t expired = 0;
+		Entry_t entry;
+		now += timeout;
+		while(deadlines.peek() && deadlines.peek()->priority < now) {
+			assert(deadlines.pop(entry));
+			assert(entry.handle % 2);
+			expired++;
+		}
+		assert(expired == m_capacity / 2);
+		Priority_t last = 0;
+		while(deadlines.pop(entry)) {
+			assert(entry.handle % 2 == 0);
+			assert(entry.priority >= last);
+			last = entry.priority;
+		}
+	}
+
+	void validate_pop(size_t size) noexcept {
+		Entry_t entry;
+		Priority_t last = ~Priority_t(0);
+		size_t popped = 0;
+		while(m_pyramid.pop(entry)) {
+			assert(entry.priority <= last);
+			assert(not m_pyramid.contains(entry.handle));
+			last = entry.priority;
+			popped++;
+		}
+		assert(popped == size);
+		assert(m_pyramid.size() == 0);
+	}
+
+};
+
+}; // namespace storage
+
+#endif /* STORAGE_TESTS_TESTINDEXEDPYRAMID_H */
@@ -0,0 +1,170 @@
+#ifndef STORAGE_TESTS_TESTIP6TABLE_H
+#define STORAGE_TESTS_TESTIP6TABLE_H
+
+#include "containers/storage/Ip6Table.h"
+
+#include <cstdio>
+#include <assert.h>
+#include <iostream>
+
+namespace storage {
+
+class TestIp6Table {
+
+	using Addr_t = Ip6Table::IPv6Addr_t;
+
+	Ip6Table m_table;
+	const size_t m_capacity;
+
+public:
+
+	TestIp6Table(unsigned capacity, float load_factor) noexcept
+		: m_table(capacity, load_factor, capacity)
+		, m_capacity(capacity) {
+		assert(m_table.allocate() == 0);
+	}
+
+	TestIp6Table(const TestIp6Table&) = delete;
+	TestIp6Table(TestIp6Table&&) = delete;
+
+	TestIp6Table operator=(const TestIp6Table&) = delete;
+	TestIp6Table operator=(TestIp6Table&&) = delete;
+
+	~TestIp6Table() {}
+
+	void test() noexcept {
+		printf("<TestIp6Table>...\n");
+		printf("capacity_addr=%zu\n", m_capacity);
+		printf("storage_bytes=%.2f Kb\n", m_table.storage_bytes() / (float) 1024.0);
+		printf("sizeof(Ip6Table::NodeAddr_t)=%zu\n", sizeof(Ip6Table::NodeAddr_t));
+		printf("sizeof(Ip6Table::NodeNet_t)=%zu\n", sizeof(Ip6Table::NodeNet_t));
+
+		unsigned step = 1;
+		test_check_addr(step++);
+		test_check_net(step++);
+		test_check_net_evict(step++);
+		test_find_bulk(step++);
+		check_empty();
+	}
+
+private:
+
+	void test_check_addr(unsigned step) noexcept {
+		printf("-> test_check_addr(step=%u)\n", step);
+		check_empty();
+
+		// the addresses differ in both halves
+		for(size_t i = 0; i < m_capacity; i++) {
+			const Addr_t addr = make_addr(i);
+			assert(not m_table.find_in_addrs(addr));
+			m_table.append_addr(addr);
+		}
+		for(size_t i = 0; i < m_capacity; i++) {
+			assert(m_table.find_in_addrs(make_addr(i)));
+			m_table.remove_addr(make_addr(i));
+		}
+		for(size_t i = 0; i < m_capacity; i++) {
+			assert(not m_table.find_in_addrs(make_addr(i)));
+		}
+
+		const uint8_t bytes[16] = {0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1};
+		assert(Ip6Table::as_host_addr(bytes) == Ip6Table::as_host_addr(0x2001, 0xdb8, 0, 0, 0, 0, 0, 1));
+	}
+
+	void test_check_net(unsigned step) noexcept {
+		printf("-> test_check_net(step=%u)\n", step);
+		check_empty();
+
+		const Addr_t net32 = Ip6Table::as_host_addr(0x2001, 0xdb8, 0, 0, 0, 0, 0, 0);
+		const Addr_t net116 = Ip6Table::as_host_addr(0x2a00, 0, 0, 0, 0, 0, 0xabcd, 0xe000);
+		m_table.append_net(net32, 32);
+		m_table.append_net(Ip6Table::as_host_addr(0x2a00, 0, 0, 0, 0, 0, 0xabcd, 0xefff), 116);
+		m_table.append_net(net116, 116);
+
+		assert(m_table.find(Ip6Table::as_host_addr(0x2001, 0xdb8, 0xffff, 0, 0, 0, 0, 1)));
+		assert(not m_table.find(Ip6Table::as_host_addr(0x2001, 0xdb9, 0, 0, 0, 0, 0, 1)));
+		assert(m_table.find(Ip6Table::as_host_addr(0x2a00, 0, 0, 0, 0, 0, 0xabcd, 0xefff)));
+		assert(not m_table.find(Ip6Table::as_host_addr(0x2a00, 0, 0, 0, 0, 0, 0xabcd, 0xf000)));
+
+		// the same network has been appended twice
+		m_table.remove_net(net116, 116);
+		assert(m_table.find(Ip6Table::as_host_addr(0x2a00, 0, 0, 0, 0, 0, 0xabcd, 0xe001)));
+		m_table.remove_net(net116, 116);
+		assert(not m_table.find(Ip6Table::as_host_addr(0x2a00, 0, 0, 0, 0, 0, 0xabcd, 0xe001)));
+
+		m_table.append_net(Addr_t{0, 0}, 0);
+		assert(m_table.find(Ip6Table::as_host_addr(0xffff, 0, 0, 0, 0, 0, 0, 0)));
+		m_table.remove_net(Addr_t{1, 1}, 0);
+		m_table.remove_net(net32, 32);
+		assert(m_table.m_depth_used[0] == 0 && m_table.m_depth_used[1] == 0 && m_table.m_depth_used[2] == 0);
+	}
+
+	void test_check_net_evict(unsigned step) noexcept {
+		printf("-> test_check_net_evict(step=%u)\n", step);
+		check_empty();
+
+		// the oldest /64 networks are evicted by the newer ones
+		const size_t total = m_capacity * 2;
+		for(size_t i = 0; i < total; i++) {
+			m_table.append_net(make_addr(i), 64);
+		}
+		for(size_t i = 0; i < total; i++) {
+			assert(m_table.find(make_addr(i)) == (i >= total - m_capacity));
+		}
+		for(size_t i = total - m_capacity; i < total; i++) {
+			m_table.remove_net(make_addr(i), 64);
+		}
+		assert(m_table.m_depth_nets[64] == 0);
+	}
+
+	void test_find_bulk(unsigned step) noexcept {
+		printf("-> test_find_bulk(step=%u)\n", step);
+		check_empty();
+
+		// every third address is appended, every third one is in a /48 network
+		const size_t n = m_capacity * 3;
+		const Addr_t net48 = Ip6Table::as_host_addr(0xfd00, 0, 1, 0, 0, 0, 0, 0);
+		Addr_t* addrs = new Addr_t[n];
+		bool* out = new bool[n];
+		for(size_t i = 0; i < n; i++) {
+			addrs[i] = make_addr(i);
+			if(i % 3 == 1) {
+				addrs[i].hi = net48.hi;
+			} else if(i % 3 == 0) {
+				m_table.append_addr(addrs[i]);
+			}
+		}
+		m_table.append_net(net48, 48);
+		m_table.find_bulk(addrs, n, out);
+		for(size_t i = 0; i < n; i++) {
+			assert(out[i] == (i % 3 != 2));
+			assert(out[i] == m_table.find(addrs[i]));
+		}
+
+		for(size_t i = 0; i < n; i += 3) {
+			m_table.remove_addr(addrs[i]);
+		}
+		m_table.remove_net(net48, 48);
+		delete[] out;
+		delete[] addrs;
+	}
+
+	static Addr_t make_addr(size_t i) noexcept {
+		// the /64 networks differ as well
+		return Ip6Table::as_host_addr(0x2001, 0xdb8, unsigned(i >> 16), unsigned(i), 0, 0, unsigned(i >> 16), unsigned(i));
+	}
+
+	void check_empty() const noexcept {
+		assert(m_table.size_addr() == 0);
+		assert(m_table.size_net() == 0);
+		assert(m_table.available_addr() == m_capacity);
+		assert(m_table.available_net() == m_capacity);
+		assert(m_table.capacity_addr() == m_capacity);
+		assert(m_table.capacity_net() == m_capacity);
+	}
+
+};
+
+}; // namespace storage
+
+#endif /* STORAGE_TESTS_TESTIP6TABLE_H */
@@ -0,0 +1,151 @@
+#ifndef STORAGE_TESTS_TESTIPLISTLOADER_H
+#define STORAGE_TESTS_TESTIPLISTLOADER_H
+
+#include "containers/storage/IpListLoader.h"
+
+#include <cstdio>
+#include <cstring>
+#include <assert.h>
+#include <string>
+
+namespace storage {
+
+class TestIpListLoader {
+
+	IpTable m_table;
+	Ip6Table m_table6;
+
+public:
+
+	TestIpListLoader(unsigned capacity, float load_factor) noexcept
+		: m_table(capacity, load_factor, capacity)
+		, m_table6(capacity, load_factor, capacity) {
+		assert(m_table.allocate() == 0);
+		assert(m_table6.allocate() == 0);
+	}
+
+	TestIpListLoader(const TestIpListLoader&) = delete;
+	TestIpListLoader(TestIpListLoader&&) = delete;
+
+	TestIpListLoader operator=(const TestIpListLoader&) = delete;
+	TestIpListLoader operator=(TestIpListLoader&&) = delete;
+
+	~TestIpListLoader() {}
+
+	void test() noexcept {
+		printf("<TestIpListLoader>...\n");
+
+		unsigned step = 1;
+		test_load(step++);
+		test_errors(step++);
+		test_no_table6(step++);
+	}
+
+private:
+
+	static IpTable::IPv4Addr_t v4(unsigned b0, unsigned b1, unsigned b2, unsigned b3) noexcept {
+		return IpTable::as_host_addr(b0, b1, b2, b3);
+	}
+
+	void test_load(unsigned step) noexcept {
+		printf("-> test_load(step=%u)\n", step);
+		const std::string text =
+			"# a blocklist\n"
+			"\n"
+			"192.168.1.1\n"
+			"  10.0.0.1\t# a comment\r\n"
+			"172.16.0.0/12\n"
+			"100.64.0.1/10\n" // the host bits are cleared
+			"198.51.100.0/255.255.255.0\n"
+			"2001:db8::1\n"
+			"::ffff:192.0.2.1\n"
+			"2001:db8:1::/48 # IPv6 network\n"
+			"0.0.0.0/0";
+		const IpListStat stat = IpListLoader::load(text.data(), text.size(), m_table, m_table6);
+		stat.print(stdout);
+		printf("\n");
+		assert(stat.lines == 11);
+		assert(stat.addrs == 2);
+		assert(stat.nets == 4);
+		assert(stat.addrs6 == 2);
+		assert(stat.nets6 == 1);
+		assert(stat.errors == 0 && stat.error == nullptr);
+
+		assert(m_table.find_in_addrs(v4(192, 168, 1, 1)));
+		assert(m_table.find_in_addrs(v4(10, 0, 0, 1)));
+		assert(not m_table.find_in_addrs(v4(10, 0, 0, 2)));
+		assert(m_table.find_in_nets(v4(172, 31, 255, 255)));
+		assert(m_table.find_in_nets(v4(100, 127, 0, 1)));
+		assert(m_table.find_in_nets(v4(198, 51, 100, 7)));
+		assert(m_table.find_in_nets(v4(8, 8, 8, 8))); // 0.0.0.0/0
+
+		assert(m_table6.find(Ip6Table::as_host_addr(0x2001, 0xdb8, 0, 0, 0, 0, 0, 1)));
+		assert(m_table6.find(Ip6Table::as_host_addr(0, 0, 0, 0, 0, 0xffff, 0xc000, 0x0201)));
+		assert(m_table6.find(Ip6Table::as_host_addr(0x2001, 0xdb8, 1, 0xffff, 0, 0, 0, 5)));
+		assert(not m_table6.find(Ip6Table::as_host_addr(0x2001, 0xdb8, 2, 0, 0, 0, 0, 5)));
+
+		m_table.remove_addr(v4(192, 168, 1, 1));
+		m_table.remove_addr(v4(10, 0, 0, 1));
+		m_table.remove_net(v4(172, 16, 0, 0), v4(255, 240, 0, 0));
+		m_table.remove_net(v4(100, 64, 0, 0), v4(255, 192, 0, 0));
+		m_table.remove_net(v4(198, 51, 100, 0), v4(255, 255, 255, 0));
+		m_table.remove_net(v4(0, 0, 0, 0), v4(0, 0, 0, 0));
+		assert(m_table.size_addr() == 0 && m_table.size_net() == 0);
+		m_table6.remove_addr(Ip6Table::as_host_addr(0x2001, 0xdb8, 0, 0, 0, 0, 0, 1));
+		m_table6.remove_addr(Ip6Table::as_host_addr(0, 0, 0, 0, 0, 0xffff, 0xc000, 0x0201));
+		m_table6.remove_net(Ip6Table::as_host_addr(0x2001, 0xdb8, 1, 0, 0, 0, 0, 0), 48);
+		assert(m_table6.size_addr() == 0 && m_table6.size_net() == 0);
+	}
+
+	void test_errors(unsigned step) noexcept {
+		printf("-> test_errors(step=%u)\n", step);
+		struct Case {
+			const char* line;
+			size_t column;
+		};
+		const Case cases[] = {
+			{"256.1.1.1", 1},
+			{"1.2.3", 6},
+			{"01.2.3.4", 2},
+			{"1.2.3.4/33", 9},
+			{"1.2.3.4/", 9},
+			{"1.2.3.4 x", 9},
+			{"  1.2.3.4.5", 10},
+			{"1::2::3", 5},
+			{"2001:db8::/129", 12},
+			{"12345::1", 1},
+			{"hello", 1}
+		};
+		for(const auto& c : cases) {
+			const IpListStat stat = IpListLoader::load(c.line, strlen(c.line), m_table, m_table6);
+			if(stat.error_column != c.column) {
+				printf("'%s': %zu:%zu %s\n", c.line, stat.error_line, stat.error_column, stat.error);
+			}
+			assert(stat.errors == 1 && stat.error != nullptr);
+			assert(stat.error_line == 1 && stat.error_column == c.column);
+		}
+
+		// the lines with errors are skipped, the first one is reported
+		const std::string text = "1.1.1.1\n1.1.1.300\n2.2.2.2\nbad\n";
+		const IpListStat stat = IpListLoader::load(text.data(), text.size(), m_table, m_table6);
+		assert(stat.lines == 4 && stat.addrs == 2 && stat.errors == 2);
+		assert(stat.error_line == 2 && stat.error_column == 7);
+		m_table.remove_addr(v4(1, 1, 1, 1));
+		m_table.remove_addr(v4(2, 2, 2, 2));
+		assert(m_table.size_addr() == 0 && m_table.size_net() == 0);
+		assert(m_table6.size_addr() == 0 && m_table6.size_net() == 0);
+	}
+
+	void test_no_table6(unsigned step) noexcept {
+		printf("-> test_no_table6(step=%u)\n", step);
+		const std::string text = "::1\n1.1.1.1\n";
+		const IpListStat stat = IpListLoader::load(text.data(), text.size(), m_table);
+		assert(stat.addrs == 1 && stat.errors == 1 && stat.error_line == 1);
+		m_table.remove_addr(v4(1, 1, 1, 1));
+		assert(m_table.size_addr() == 0);
+	}
+};
+
+}; // namespace storage
+
+#endif /* STORAGE_TESTS_TESTIPLISTLOADER_H */
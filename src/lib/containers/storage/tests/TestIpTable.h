@@ -17,8 +17,8 @@ class TestIpTable {
 
 public:
 
-	TestIpTable(unsigned capacity, float load_factor) noexcept
-		: m_table(capacity, load_factor, capacity)
+	TestIpTable(unsigned capacity, float load_factor, bool filter = false) noexcept
+		: m_table(capacity, load_factor, capacity, filter)
 		, m_capacity(capacity) {
 		assert(m_table.allocate() == 0);
 	}
@@ -35,6 +35,7 @@ public:
 		printf("<TestIpTable>...\n");
 		printf("capacity_addr=%zu\n", m_capacity);
 		printf("storage_bytes=%.2f Kb\n", m_table.storage_bytes() / (float) 1024.0);
+		printf("filter_bytes=%.2f Kb\n", m_table.filter_bytes() / (float) 1024.0);
 		printf("sizeof(IpTable::NodeAddr_t)=%zu\n", sizeof(IpTable::NodeAddr_t));
 		printf("sizeof(IpTable::NodeNet_t)=%zu\n", sizeof(IpTable::NodeNet_t));
 
@@ -43,6 +44,9 @@ public:
 		test_check_addr_odd_even(step++);
 		test_check_net(step++);
 		test_check_net_special(step++);
+		test_check_net_nested(step++);
+		test_check_net_evict(step++);
+		test_find_bulk(step++);
 		check_empty();
 	}
 
@@ -71,6 +75,38 @@ private:
 		}
 	}
 
+	void test_find_bulk(unsigned step) noexcept {
+		printf("-> test_find_bulk(step=%u)\n", step);
+		check_empty();
+
+		// the even addresses are appended, the odd ones are in the network 10.0.0.0/8
+		const size_t n = m_capacity * 2;
+		IpTable::IPv4Addr_t* addrs = new IpTable::IPv4Addr_t[n];
+		bool* out = new bool[n];
+		for(size_t i = 0; i < n; i++) {
+			addrs[i] = (i % 2) ? IpTable::as_host_addr(10, 0, 0, i) : IpTable::as_host_addr(192, 168, 1, 0) + i;
+			if(i % 2 == 0) {
+				m_table.append_addr(addrs[i]);
+			}
+		}
+		m_table.find_in_addrs_bulk(addrs, n, out);
+		for(size_t i = 0; i < n; i++) {
+			assert(out[i] == (i % 2 == 0));
+		}
+		m_table.append_net(IpTable::as_host_addr(10, 0, 0, 0), IpTable::as_host_addr(255, 0, 0, 0));
+		m_table.find_bulk(addrs, n, out);
+		for(size_t i = 0; i < n; i++) {
+			assert(out[i]);
+		}
+
+		for(size_t i = 0; i < n; i += 2) {
+			m_table.remove_addr(addrs[i]);
+		}
+		m_table.remove_net(IpTable::as_host_addr(10, 0, 0, 0), IpTable::as_host_addr(255, 0, 0, 0));
+		delete[] out;
+		delete[] addrs;
+	}
+
 	void test_check_addr_odd_even(unsigned step) noexcept {
 		printf("-> test_check_addr_odd_even(step=%u)\n", step);
 		check_empty();
@@ -154,6 +190,63 @@ private:
 		m_table.remove_net(network_full, mask);
 	}
 
+	void test_check_net_nested(unsigned step) noexcept {
+		printf("-> test_check_net_nested(step=%u)\n", step);
+		check_empty();
+
+		IpTable::IPv4Addr_t net_wide = IpTable::as_host_addr(10, 0, 0, 0);
+		IpTable::IPv4Addr_t mask_wide = IpTable::as_host_addr(255, 0, 0, 0);
+		IpTable::IPv4Addr_t net_narrow = IpTable::as_host_addr(10, 1, 2, 0);
+		IpTable::IPv4Addr_t mask_narrow = IpTable::as_host_addr(255, 255, 255, 128);
+		// a non-contiguous mask, matches 172.X.0.1
+		IpTable::IPv4Addr_t net_odd = IpTable::as_host_addr(172, 0, 0, 1);
+		IpTable::IPv4Addr_t mask_odd = IpTable::as_host_addr(255, 0, 255, 255);
+
+		m_table.append_net(net_narrow, mask_narrow);
+		m_table.append_net(net_narrow, mask_narrow);
+		m_table.append_net(net_wide, mask_wide);
+		m_table.append_net(net_odd, mask_odd);
+		assert(m_table.find(IpTable::as_host_addr(10, 1, 2, 127)));
+		assert(m_table.find(IpTable::as_host_addr(10, 200, 0, 1)));
+		assert(m_table.find(IpTable::as_host_addr(172, 16, 0, 1)));
+		assert(not m_table.find(IpTable::as_host_addr(172, 16, 1, 1)));
+		assert(not m_table.find(IpTable::as_host_addr(11, 1, 2, 1)));
+
+		m_table.remove_net(net_wide, mask_wide);
+		assert(not m_table.find(IpTable::as_host_addr(10, 200, 0, 1)));
+		assert(not m_table.find(IpTable::as_host_addr(10, 1, 2, 128)));
+		assert(m_table.find(IpTable::as_host_addr(10, 1, 2, 0)));
+
+		// the duplicate keeps the network
+		m_table.remove_net(net_narrow, mask_narrow);
+		assert(m_table.find(IpTable::as_host_addr(10, 1, 2, 0)));
+		m_table.remove_net(net_narrow, mask_narrow);
+		assert(not m_table.find(IpTable::as_host_addr(10, 1, 2, 0)));
+
+		m_table.remove_net(net_odd, mask_odd);
+		assert(not m_table.find(IpTable::as_host_addr(172, 16, 0, 1)));
+		assert(m_table.m_prefixes.groups_used() == 0);
+		assert(m_table.m_scanned_nets == 0);
+	}
+
+	void test_check_net_evict(unsigned step) noexcept {
+		printf("-> test_check_net_evict(step=%u)\n", step);
+		check_empty();
+
+		// the oldest /24 networks are evicted by the newer ones
+		const size_t total = m_capacity * 2;
+		for(size_t i = 0; i < total; i++) {
+			m_table.append_net(IpTable::as_host_addr(10, i >> 8, i & 0xFF, 0), IpTable::as_host_addr(255, 255, 255, 0));
+		}
+		for(size_t i = 0; i < total; i++) {
+			assert(m_table.find(IpTable::as_host_addr(10, i >> 8, i & 0xFF, 1)) == (i >= total - m_capacity));
+		}
+		for(size_t i = total - m_capacity; i < total; i++) {
+			m_table.remove_net(IpTable::as_host_addr(10, i >> 8, i & 0xFF, 0), IpTable::as_host_addr(255, 255, 255, 0));
+		}
+		assert(m_table.m_prefixes.groups_used() == 0);
+	}
+
 	void check_empty() const noexcept {
 		assert(m_table.size_addr() == 0);
 		assert(m_table.size_net() == 0);
@@ -161,6 +254,7 @@ private:
 		assert(m_table.available_net() == m_capacity);
 		assert(m_table.capacity_addr() == m_capacity);
 		assert(m_table.capacity_net() == m_capacity);
+		assert(m_table.m_filter.size() == 0);
 	}
 
 	static void print_ip_host(const char* name, IpTable::IPv4Addr_t ip) noexcept {
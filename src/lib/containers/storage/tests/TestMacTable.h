@@ -0,0 +1,192 @@
+#ifndef STORAGE_TESTS_TESTMACTABLE_H
+#define STORAGE_TESTS_TESTMACTABLE_H
+
+#include "containers/storage/MacTable.h"
+
+#include <assert.h>
+#include <cstdio>
+#include <cstring>
+
+namespace storage {
+
+class TestMacTable {
+
+	using Table_t = MacTable<8, BurstClock<1000> >;
+	using Key_t = Table_t::Key_t;
+
+	static constexpr unsigned AGING_MS = 1000;
+
+	Table_t m_table;
+	const size_t m_capacity;
+	uint64_t m_now;
+
+public:
+
+	TestMacTable(unsigned capacity) noexcept
+		: m_table(capacity, AGING_MS)
+		, m_capacity(capacity)
+		, m_now(0) {
+		assert(m_table.allocate() == 0);
+	}
+
+	TestMacTable(const TestMacTable&) = delete;
+	TestMacTable(TestMacTable&&) = delete;
+
+	TestMacTable operator=(const TestMacTable&) = delete;
+	TestMacTable operator=(TestMacTable&&) = delete;
+
+	~TestMacTable() {}
+
+	void test() noexcept {
+		printf("<TestMacTable>...\n");
+		printf("capacity=%zu\n", m_capacity);
+		printf("storage_bytes=%.2f Kb\n", m_table.storage_bytes() / (float) 1024.0);
+
+		unsigned step = 1;
+		test_learn(step++);
+		test_aging(step++);
+		test_flush_port(step++);
+		test_evict(step++);
+		test_bulk(step++);
+		test_frame_keys(step++);
+	}
+
+private:
+
+	static Key_t station(uint16_t vlan, uint64_t mac) noexcept {
+		return Table_t::key(vlan, cli::MacAddress::from_value(mac));
+	}
+
+	void tick(uint64_t ms) noexcept {
+		m_now += ms;
+		m_table.clock().set(m_now);
+	}
+
+	void reset() noexcept {
+		m_table.flush();
+		assert(m_table.size() == 0);
+	}
+
+	void test_learn(unsigned step) noexcept {
+		printf("-> test_learn(step=%u)\n", step);
+		reset();
+		assert(m_table.lookup(station(1, 0xA)) == Table_t::FLOOD);
+		assert(m_table.learn(station(1, 0xA), 3));
+		assert(m_table.lookup(station(1, 0xA)) == 3);
+		// the VLANs are apart
+		assert(m_table.lookup(station(2, 0xA)) == Table_t::FLOOD);
+		assert(m_table.learn(station(2, 0xA), 5));
+		assert(m_table.lookup(station(2, 0xA)) == 5);
+		// a station move
+		const MacTableStat before = m_table.stat();
+		assert(m_table.learn(station(1, 0xA), 4));
+		assert(m_table.lookup(station(1, 0xA)) == 4);
+		assert(m_table.stat().moved == before.moved + 1);
+		assert(m_table.size() == 2);
+		assert(not m_table.learn(station(1, 0xB), 8)); // the port is out of P
+		assert(m_table.size() == 2);
+	}
+
+	void test_aging(unsigned step) noexcept {
+		printf("-> test_aging(step=%u)\n", step);
+		reset();
+		m_table.learn(station(0, 1), 0);
+		tick(600);
+		m_table.learn(station(0, 2), 0);
+		tick(300);
+		m_table.learn(station(0, 1), 1); // refreshes the first station
+		tick(300);
+		m_table.lookup(station(0, 2)); // a lookup doesn't refresh
+		m_table.expire();
+		assert(m_table.size() == 2);
+		tick(500);
+		const MacTableStat before = m_table.stat();
+		m_table.expire();
+		assert(m_table.size() == 1);
+		assert(m_table.stat().aged == before.aged + 1);
+		assert(m_table.lookup(station(0, 2)) == Table_t::FLOOD);
+		assert(m_table.lookup(station(0, 1)) == 1);
+	}
+
+	void test_flush_port(unsigned step) noexcept {
+		printf("-> test_flush_port(step=%u)\n", step);
+		reset();
+		for(uint64_t mac = 0; mac < 8; mac++) {
+			m_table.learn(station(0, mac), uint16_t(mac % 2));
+		}
+		m_table.flush(1);
+		for(uint64_t mac = 0; mac < 8; mac++) {
+			assert(m_table.lookup(station(0, mac)) == (mac % 2 ? Table_t::FLOOD : 0));
+		}
+		// a flushed station is learned again as a new one
+		const MacTableStat before = m_table.stat();
+		m_table.learn(station(0, 1), 1);
+		assert(m_table.stat().learned == before.learned + 1);
+		assert(m_table.lookup(station(0, 1)) == 1);
+		m_table.learn(station(0, 3), 0);
+		assert(m_table.lookup(station(0, 3)) == 0);
+		assert(m_table.size() == 8);
+	}
+
+	void test_evict(unsigned step) noexcept {
+		printf("-> test_evict(step=%u)\n", step);
+		reset();
+		for(uint64_t mac = 0; mac < m_capacity; mac++) {
+			tick(1);
+			m_table.learn(station(7, mac), 2);
+		}
+		tick(1);
+		m_table.learn(station(7, 0), 2); // the oldest station is the second one now
+		const MacTableStat before = m_table.stat();
+		m_table.learn(station(7, m_capacity), 2);
+		assert(m_table.size() == m_capacity);
+		assert(m_table.stat().evicted == before.evicted + 1);
+		assert(m_table.lookup(station(7, 1)) == Table_t::FLOOD);
+		assert(m_table.lookup(station(7, 0)) == 2);
+		assert(m_table.lookup(station(7, m_capacity)) == 2);
+	}
+
+	void test_bulk(unsigned step) noexcept {
+		printf("-> test_bulk(step=%u)\n", step);
+		reset();
+		static constexpr size_t N = 100;
+		const size_t n = m_capacity < N ? m_capacity : N; // no eviction
+		Key_t keys[N];
+		uint16_t ports[N];
+		uint16_t out[N];
+		for(size_t i = 0; i < n; i++) {
+			keys[i] = station(uint16_t(i / 2 % 3), i / 2); // every key is twice in the burst
+			ports[i] = uint16_t(i % 7);
+		}
+		m_table.learn_bulk(keys, ports, n);
+		m_table.learn_bulk(keys, ports, n);
+		m_table.lookup_bulk(keys, n, out);
+		for(size_t i = 0; i < n; i++) {
+			assert(out[i] == m_table.lookup(keys[i]));
+			assert(out[i] != Table_t::FLOOD);
+		}
+		assert(m_table.size() <= n);
+	}
+
+	void test_frame_keys(unsigned step) noexcept {
+		printf("-> test_frame_keys(step=%u)\n", step);
+		reset();
+		uint8_t frame[14] = {
+			0x00, 0x00, 0x00, 0x00, 0x00, 0x02, // dst
+			0x00, 0x00, 0x00, 0x00, 0x00, 0x01, // src
+			0x81, 0x00
+		};
+		proto::ParsedPacket pkt;
+		memset(&pkt, 0, sizeof(pkt));
+		pkt.vlan_count = 1;
+		pkt.vlan[0] = 10;
+		assert(Table_t::src_key(frame, pkt) == station(10, 1));
+		assert(Table_t::dst_key(frame, pkt) == station(10, 2));
+		pkt.vlan_count = 0;
+		assert(Table_t::src_key(frame, pkt) == station(0, 1));
+	}
+};
+
+}; // namespace storage
+
+#endif /* STORAGE_TESTS_TESTMACTABLE_H */
@@ -0,0 +1,182 @@
+#ifndef STORAGE_TESTS_TESTPREFIXTABLE_H
+#define STORAGE_TESTS_TESTPREFIXTABLE_H
+
+#include "containers/storage/PrefixTable.h"
+
+#include <assert.h>
+#include <cstdio>
+#include <cstdlib>
+
+namespace storage {
+
+class TestPrefixTable {
+
+	struct Prefix {
+		uint32_t net;
+		unsigned depth;
+	};
+
+	using Table_t = PrefixTable<>;
+
+	Table_t m_table;
+	const size_t m_capacity;
+	Prefix* m_prefixes;
+	size_t m_size;
+
+public:
+
+	TestPrefixTable(unsigned capacity) noexcept
+		: m_table(capacity * 2)
+		, m_capacity(capacity)
+		, m_prefixes(new Prefix[capacity])
+		, m_size(0) {
+		assert(m_table.allocate() == 0);
+	}
+
+	TestPrefixTable(const TestPrefixTable&) = delete;
+	TestPrefixTable(TestPrefixTable&&) = delete;
+
+	TestPrefixTable operator=(const TestPrefixTable&) = delete;
+	TestPrefixTable operator=(TestPrefixTable&&) = delete;
+
+	~TestPrefixTable() {
+		delete[] m_prefixes;
+	}
+
+	void test() noexcept {
+		printf("<TestPrefixTable>...\n");
+		printf("capacity=%zu\n", m_capacity);
+		printf("storage_bytes=%.2f Kb\n", m_table.storage_bytes() / (float) 1024.0);
+
+		unsigned step = 1;
+		test_nested(step++);
+		test_random(step++);
+	}
+
+	void test_nested(unsigned step) noexcept {
+		printf("-> test_nested(step=%u)\n", step);
+		check_empty();
+
+		// 10.0.0.0/8 > 10.1.0.0/16 > 10.1.2.0/24 > 10.1.2.3/32
+		const uint32_t addr = 0x0A010203;
+		for(unsigned depth = 8; depth <= 32; depth += 8) {
+			insert(addr & mask_of(depth), depth);
+			assert(m_table.depth(addr) == depth);
+			assert(m_table.depth(addr + 1) == (depth == 32 ? 24 : depth));
+		}
+		assert(m_table.groups_used() == 2);
+		assert(m_table.depth(0x0B000000) == Table_t::NO_DEPTH);
+
+		// remove from the middle, the covering prefixes take the place
+		remove(addr & mask_of(16), 16);
+		assert(m_table.depth(0x0A01FF00) == 8);
+		assert(m_table.depth(addr) == 32);
+		remove(addr & mask_of(32), 32);
+		assert(m_table.depth(addr) == 24);
+		remove(addr & mask_of(24), 24);
+		assert(m_table.depth(addr) == 8);
+		assert(m_table.groups_used() == 0);
+		remove(addr & mask_of(8), 8);
+
+		// the default route
+		insert(0, 0);
+		assert(m_table.depth(addr) == 0);
+		assert(m_table.depth(~uint32_t(0)) == 0);
+		remove(0, 0);
+		check_empty();
+	}
+
+	void test_random(unsigned step) noexcept {
+		printf("-> test_random(step=%u)\n", step);
+		check_empty();
+
+		std::srand(step);
+		for(size_t round = 0; round < m_capacity * 4; round++) {
+			if(m_size == m_capacity || (m_size && std::rand() % 3 == 0)) {
+				const Prefix prefix = m_prefixes[std::rand() % m_size];
+				remove(prefix.net, prefix.depth);
+			} else {
+				// the prefixes are kept in 10.0.0.0/12 to make them nest
+				const unsigned depth = 12 + unsigned(std::rand()) % 21;
+				const uint32_t net = (0x0A000000 | (uint32_t(std::rand()) & 0x000FFFFF)) & mask_of(depth);
+				insert(net, depth);
+			}
+			for(unsigned i = 0; i < 16; i++) {
+				const uint32_t addr = 0x0A000000 | (uint32_t(std::rand()) & 0x000FFFFF);
+				assert(m_table.depth(addr) == expected(addr));
+			}
+			for(size_t i = 0; i < m_size; i++) {
+				const Prefix& prefix = m_prefixes[i];
+				assert(m_table.depth(prefix.net) == expected(prefix.net));
+			}
+			assert(m_table.groups_used() <= m_size * 2);
+		}
+		while(m_size) {
+			remove(m_prefixes[0].net, m_prefixes[0].depth);
+		}
+		check_empty();
+	}
+
+private:
+
+	static uint32_t mask_of(unsigned depth) noexcept {
+		return depth ? ~uint32_t(0) << (32 - depth) : 0;
+	}
+
+	unsigned expected(uint32_t addr) const noexcept {
+		unsigned result = Table_t::NO_DEPTH;
+		for(size_t i = 0; i < m_size; i++) {
+			const Prefix& prefix = m_prefixes[i];
+			if((addr & mask_of(prefix.depth)) == prefix.net && (result == Table_t::NO_DEPTH || prefix.depth > result)) {
+				result = prefix.depth;
+			}
+		}
+		return result;
+	}
+
+	void insert(uint32_t net, unsigned depth) noexcept {
+		assert(m_table.insert(net, depth));
+		m_prefixes[m_size++] = Prefix{net, depth};
+	}
+
+	void remove(uint32_t net, unsigned depth) noexcept {
+		size_t found = m_size;
+		bool same = false;
+		for(size_t i = 0; i < m_size; i++) {
+			if(found == m_size && m_prefixes[i].net == net && m_prefixes[i].depth == depth) {
+				found = i;
+			} else if(m_prefixes[i].net == net && m_prefixes[i].depth == depth) {
+				same = true;
+			}
+		}
+		assert(found < m_size);
+		m_prefixes[found] = m_prefixes[--m_size];
+		if(same) {
+			return;
+		}
+
+		// the longest remaining prefix which covers the removed one
+		unsigned cover = Table_t::NO_DEPTH;
+		for(size_t i = 0; i < m_size; i++) {
+			const Prefix& prefix = m_prefixes[i];
+			if(prefix.depth < depth && (net & mask_of(prefix.depth)) == prefix.net
+			   && (cover == Table_t::NO_DEPTH || prefix.depth > cover)) {
+				cover = prefix.depth;
+			}
+		}
+		m_table.remove(net, depth, cover);
+	}
+
+	void check_empty() const noexcept {
+		assert(m_size == 0);
+		assert(m_table.groups_used() == 0);
+		for(size_t i = 0; i < Table_t::ROOT_SIZE; i++) {
+			assert(m_table.m_entries[i] == 0);
+		}
+	}
+
+};
+
+}; // namespace storage
+
+#endif /* STORAGE_TESTS_TESTPREFIXTABLE_H */
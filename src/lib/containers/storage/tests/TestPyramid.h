@@ -8,6 +8,9 @@
 #include <iostream>
 #include <thread>
 #include <algorithm>
+#include <chrono>
+#include <functional>
+#include <vector>
 
 namespace storage {
 
@@ -51,6 +54,15 @@ public:
 
 //		test_std_sort(step++);
 		test_pyramid_sort_build(step++);
+		test_heap_sort(step++);
+		test_insert_full(step++);
+		test_top_k(step++);
+		test_top_k_greater(step++);
+		test_top_k_perf(step++);
+		test_d_ary<4>(step++);
+		test_d_ary<8>(step++);
+		test_d_ary_height(step++);
+		test_d_ary_perf(step++);
 
 //		test_indexing_capacity(step++);
 //		test_common_indexing(step++);
@@ -171,6 +183,213 @@ private:
 		printf("check_summ=0x%zx\n", check_summ);
 	}
 
+	void test_heap_sort(unsigned step) noexcept {
+		printf("-> test_heap_sort(step=%u)\n", step);
+		size_t check_summ = randomize_storage(step);
+		assert(m_pyramid.build(m_capacity) == m_capacity);
+		assert(m_pyramid.heap_sort() == m_capacity);
+		assert(m_pyramid.size() == 0);
+		validate_storage(check_summ);
+		assert(m_pyramid.heap_sort() == 0);
+	}
+
+	void test_insert_full(unsigned step) noexcept {
+		printf("-> test_insert_full(step=%u)\n", step);
+		for(size_t i = 0; i < m_capacity; ++i) {
+			assert(m_pyramid.insert(Type_t(i * step)));
+		}
+		assert(not m_pyramid.insert(Type_t(m_capacity * step)));
+		assert(*m_pyramid.peek() == Type_t((m_capacity - 1) * step));
+
+		Type_t copy = 0;
+		while(m_pyramid.size()) {
+			assert(m_pyramid.pop(copy));
+		}
+		assert(copy == 0);
+		assert(not m_pyramid.pop(copy));
+	}
+
+	/**
+	 * The top-K heap keeps the K greatest of the offered elements as std::partial_sort does.
+	 */
+	void test_top_k(unsigned step) noexcept {
+		printf("-> test_top_k(step=%u)\n", step);
+		const size_t k = std::min<size_t>(m_capacity > 8 ? m_capacity / 8 : 1, 1000);
+		const size_t n = std::min<size_t>(m_capacity * 4, size_t(1) << 22);
+		std::vector<Type_t> input(n);
+		srand(step);
+		for(size_t i = 0; i < n; ++i) {
+			input[i] = rand() % (m_capacity * 2);
+		}
+
+		Pyramid_t top(m_storage, k);
+		size_t kept = 0;
+		for(Type_t value : input) {
+			kept += top.push_top(value);
+		}
+		assert(top.size() == k);
+		assert(kept >= k);
+
+		std::vector<Type_t> expected(input);
+		std::partial_sort(expected.begin(), expected.begin() + k, expected.end(), std::greater<Type_t>());
+		assert(*top.peek() == expected[k - 1]);
+		assert(top.top_sort() == k);
+		assert(top.size() == 0);
+		for(size_t i = 0; i < k; ++i) {
+			assert(m_storage[i] == expected[i]);
+		}
+	}
+
+	/**
+	 * The comparator turns the top-K heap into the bottom-K one.
+	 */
+	void test_top_k_greater(unsigned step) noexcept {
+		printf("-> test_top_k_greater(step=%u)\n", step);
+		const size_t k = std::min<size_t>(m_capacity > 8 ? m_capacity / 8 : 1, 1000);
+		const size_t n = std::min<size_t>(m_capacity, size_t(1) << 22);
+		Pyramid<Type_t, std::greater<Type_t> > bottom(m_storage, k);
+		for(size_t i = 0; i < n; ++i) {
+			bottom.push_top(Type_t(n - i - 1 + step));
+		}
+		assert(bottom.size() == k);
+		assert(*bottom.peek() == Type_t(k - 1 + step));
+		assert(bottom.top_sort() == k);
+		for(size_t i = 0; i < k; ++i) {
+			assert(m_storage[i] == Type_t(i + step));
+		}
+	}
+
+	void test_top_k_perf(unsigned step) noexcept {
+		printf("-> test_top_k_perf(step=%u)\n", step);
+		const size_t k = std::min<size_t>(1000, m_capacity);
+		const size_t n = std::max<size_t>(k, std::min<size_t>(m_capacity * 16, size_t(1) << 22));
+		std::vector<Type_t> input(n);
+		srand(step);
+		for(size_t i = 0; i < n; ++i) {
+			input[i] = rand();
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		Pyramid_t top(m_storage, k);
+		for(Type_t value : input) {
+			top.push_top(value);
+		}
+		top.top_sort();
+		const double pyramid_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		start = std::chrono::steady_clock::now();
+		std::partial_sort(input.begin(), input.begin() + k, input.end(), std::greater<Type_t>());
+		const double partial_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		for(size_t i = 0; i < k; ++i) {
+			assert(m_storage[i] == input[i]);
+		}
+		printf("top %zu of %zu: push_top=%.2f ms std::partial_sort=%.2f ms\n", k, n, pyramid_ms, partial_ms);
+	}
+
+	/**
+	 * The D-ary pyramid sorts and keeps the top-K as the binary one does.
+	 */
+	template<unsigned D>
+	void test_d_ary(unsigned step) noexcept {
+		printf("-> test_d_ary<%u>(step=%u)\n", D, step);
+		size_t check_summ = randomize_storage(step);
+		Pyramid<Type_t, std::less<Type_t>, D> pyramid(m_storage, m_capacity);
+		assert(pyramid.build(m_capacity) == m_capacity);
+		assert(pyramid.heap_sort() == m_capacity);
+		validate_storage(check_summ);
+
+		for(size_t i = 0; i < m_capacity; ++i) {
+			assert(pyramid.insert(Type_t(i * step)));
+		}
+		assert(not pyramid.insert(Type_t(m_capacity * step)));
+		Type_t copy = 0;
+		for(size_t i = m_capacity; i > 0; --i) {
+			assert(*pyramid.peek() == Type_t((i - 1) * step));
+			assert(pyramid.pop(copy));
+		}
+		assert(not pyramid.pop(copy));
+
+		const size_t k = std::min<size_t>(m_capacity > 8 ? m_capacity / 8 : 1, 1000);
+		const size_t n = std::min<size_t>(m_capacity * 4, size_t(1) << 20);
+		std::vector<Type_t> input(n);
+		for(size_t i = 0; i < n; ++i) {
+			input[i] = rand() % (m_capacity * 2);
+		}
+		Pyramid<Type_t, std::less<Type_t>, D> top(m_storage, k);
+		for(Type_t value : input) {
+			top.push_top(value);
+		}
+		std::partial_sort(input.begin(), input.begin() + k, input.end(), std::greater<Type_t>());
+		assert(top.top_sort() == k);
+		for(size_t i = 0; i < k; ++i) {
+			assert(m_storage[i] == input[i]);
+		}
+	}
+
+	void test_d_ary_height(unsigned step) noexcept {
+		printf("-> test_d_ary_height(step=%u)\n", step);
+		const size_t sizes[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 20, 21, 22, 84, 85, 86, 1000};
+		for(size_t size : sizes) {
+			if(size > m_capacity) {
+				break;
+			}
+			Pyramid<Type_t> binary(m_storage, m_capacity);
+			Pyramid<Type_t, std::less<Type_t>, 4> quad(m_storage, m_capacity);
+			binary.build(size);
+			quad.build(size);
+			assert(binary.height() == layers(size, 2));
+			assert(quad.height() == layers(size, 4));
+			if(size) {
+				assert(binary.end(binary.height() - 1) == binary.end());
+				assert(quad.end(quad.height() - 1) == quad.end());
+			}
+		}
+		assert(Pyramid_t::layer_offset(3) == 7);
+		assert((Pyramid<Type_t, std::less<Type_t>, 4>::layer_offset(3) == 21));
+		assert((Pyramid<Type_t, std::less<Type_t>, 8>::parent(9) == 1));
+		assert((Pyramid<Type_t, std::less<Type_t>, 8>::child(1, 7) == 16));
+	}
+
+	void test_d_ary_perf(unsigned step) noexcept {
+		printf("-> test_d_ary_perf(step=%u)\n", step);
+		const size_t n = std::min<size_t>(m_capacity, size_t(1) << 22);
+		std::vector<Type_t> input(n);
+		srand(step);
+		for(size_t i = 0; i < n; ++i) {
+			input[i] = rand();
+		}
+		const double binary_ms = insert_pop_ms<2>(input);
+		const double quad_ms = insert_pop_ms<4>(input);
+		const double octal_ms = insert_pop_ms<8>(input);
+		printf("insert/pop %zu: D=2 %.2f ms, D=4 %.2f ms, D=8 %.2f ms\n", n, binary_ms, quad_ms, octal_ms);
+	}
+
+	template<unsigned D>
+	double insert_pop_ms(const std::vector<Type_t>& input) noexcept {
+		auto start = std::chrono::steady_clock::now();
+		Pyramid<Type_t, std::less<Type_t>, D> pyramid(m_storage, input.size());
+		for(Type_t value : input) {
+			pyramid.insert(value);
+		}
+		Type_t last = ~Type_t(0);
+		Type_t copy = 0;
+		while(pyramid.pop(copy)) {
+			assert(copy <= last);
+			last = copy;
+		}
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	static inline unsigned layers(size_t size, size_t d) noexcept {
+		unsigned result = 0;
+		size_t layer_size = 1;
+		for(size_t total = 0; total < size; total += layer_size, layer_size *= d) {
+			result++;
+		}
+		return result;
+	}
+
 	size_t randomize_storage(size_t seed = 0) noexcept {
 		size_t summ = 0;
 		srand(seed);
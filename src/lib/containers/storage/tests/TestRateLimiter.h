@@ -33,6 +33,11 @@ class TestRateLimiter {
 	using Node_t = RateLimiterNode<Key_t>;
 	using RateLimiter_t = RateLimiter<Node_t>;
 
+	using BucketNode_t = RateLimiterNode<Key_t, intrusive::HashMapHook, RateLimiterTokenBucket>;
+	using BucketLimiter_t = RateLimiter<BucketNode_t>;
+
+	using BurstLimiter_t = RateLimiter<Node_t, std::hash<Key_t>, intrusive::HashMapBucket<Node_t>, BurstClock<1000> >;
+
 	RateLimiter_t m_limiter;
 	const size_t m_capacity;
 
@@ -57,17 +62,24 @@ public:
 		printf("capacity_addr=%zu\n", m_capacity);
 		printf("sizeof(NodeAddr_t)=%zu\n", sizeof(Node_t));
 		printf("storage_bytes=%.2f Kb\n", m_limiter.storage_bytes() / (float) 1024.0);
-		m_limiter.set_period(rte_get_tsc_hz() * 10/*10 sec*/);
+		m_limiter.set_period(m_limiter.clock().hz() * 10/*10 sec*/);
 
 		unsigned step = 1;
 		test_check(step++);
 		test_check_cycles(step++);
 		test_remove(step++);
+		test_check_bulk(step++);
+		test_stat(step++);
+		test_token_bucket(step++);
+		test_sliding_window(step++);
+		test_check_cost(step++);
+		test_burst_clock(step++);
+		test_line_bucket(step++);
 		test_clear(step++);
 	}
 
 	void test_check(unsigned step) noexcept {
-		m_limiter.set_period(rte_get_tsc_hz() * 10/*10 sec*/);
+		m_limiter.set_period(m_limiter.clock().hz() * 10/*10 sec*/);
 		printf("-> test_check_addr(step=%u)\n", step);
 		assert(m_limiter.size() == 0);
 
@@ -98,7 +110,7 @@ public:
 
 	void test_check_cycles(unsigned step) noexcept {
 		printf("-> test_check_cycles(step=%u)\n", step);
-		m_limiter.set_period(rte_get_tsc_hz() / 10 /*100 msec*/);
+		m_limiter.set_period(m_limiter.clock().hz() / 10 /*100 msec*/);
 		assert(m_limiter.size() == 0);
 
 		for(size_t i = 0; i < m_capacity; i++) {
@@ -106,7 +118,7 @@ public:
 			assert(not m_limiter.check(i));
 		}
 
-		wait_cycles(rte_get_tsc_hz() / 10);
+		wait_cycles(m_limiter.clock().hz() / 10);
 		for(size_t i = 0; i < m_capacity; i++) {
 			assert(m_limiter.check(i));
 			assert(not m_limiter.check(i));
@@ -117,7 +129,7 @@ public:
 	}
 
 	void test_remove(unsigned step) noexcept {
-		m_limiter.set_period(rte_get_tsc_hz() * 10/*10 sec*/);
+		m_limiter.set_period(m_limiter.clock().hz() * 10/*10 sec*/);
 		printf("-> test_remove(step=%u)\n", step);
 		assert(m_limiter.size() == 0);
 
@@ -157,6 +169,219 @@ public:
 
 	}
 
+	void test_check_bulk(unsigned step) noexcept {
+		m_limiter.set_period(m_limiter.clock().hz() * 10/*10 sec*/);
+		printf("-> test_check_bulk(step=%u)\n", step);
+		assert(m_limiter.size() == 0);
+
+		// every key comes twice in a burst, the bursts overflow the capacity
+		const size_t n = m_capacity * 4;
+		Key_t* keys = new Key_t[n];
+		bool* out = new bool[n];
+		for(size_t i = 0; i < n; i++) {
+			keys[i] = Key_t(i / 2);
+		}
+		m_limiter.check_bulk(keys, n, out);
+		for(size_t i = 0; i < n; i++) {
+			assert(out[i] == (i % 2 == 0));
+		}
+		assert(m_limiter.size() == m_capacity);
+
+		// the last keys are still limited, the first ones have been evicted
+		m_limiter.check_bulk(keys + n - m_capacity * 2, m_capacity * 2, out);
+		for(size_t i = 0; i < m_capacity * 2; i++) {
+			assert(not out[i]);
+		}
+		m_limiter.check_bulk(keys, 2, out);
+		assert(out[0]);
+		assert(not out[1]);
+
+		delete[] out;
+		delete[] keys;
+		m_limiter.reset();
+		assert(m_limiter.size() == 0);
+	}
+
+	void test_stat(unsigned step) noexcept {
+		m_limiter.set_period(m_limiter.clock().hz() * 10/*10 sec*/);
+		printf("-> test_stat(step=%u)\n", step);
+		assert(m_limiter.size() == 0);
+
+		RateLimiterStat prev;
+		m_limiter.load(prev);
+		for(size_t i = 0; i < m_capacity * 2; i++) {
+			assert(m_limiter.check(i));
+			assert(not m_limiter.check(i));
+		}
+		RateLimiterStat stat;
+		m_limiter.load(stat);
+		assert(stat.passed - prev.passed == m_capacity * 2);
+		assert(stat.limited - prev.limited == m_capacity * 2);
+		assert(stat.inserted - prev.inserted == m_capacity * 2);
+		assert(stat.evicted - prev.evicted == m_capacity);
+
+		// a checked key is the last one to be evicted
+		m_limiter.reset();
+		for(size_t i = 0; i < m_capacity; i++) {
+			assert(m_limiter.check(i));
+		}
+		assert(not m_limiter.check(0));
+		assert(m_limiter.check(m_capacity));
+		assert(not m_limiter.check(0));
+		assert(m_limiter.check(1));
+		m_limiter.reset();
+		assert(m_limiter.size() == 0);
+	}
+
+	void test_token_bucket(unsigned step) noexcept {
+		printf("-> test_token_bucket(step=%u)\n", step);
+		using Policy_t = RateLimiterTokenBucket;
+
+		// 10 tokens per second with 5 tokens of burst, a second is 1000 cycles
+		const uint64_t hz = 1000;
+		const auto config = Policy_t::Config::make(10, 5, hz);
+		Policy_t::State state;
+		uint64_t now = 1000000;
+		Policy_t::init(state, config, now);
+
+		// the burst is allowed at once
+		for(unsigned i = 0; i < 5; i++) {
+			assert(Policy_t::check(state, config, now, 1));
+		}
+		assert(not Policy_t::check(state, config, now, 1));
+
+		// a token per 100 cycles
+		now += 99;
+		assert(not Policy_t::check(state, config, now, 1));
+		now += 1;
+		assert(Policy_t::check(state, config, now, 1));
+		assert(not Policy_t::check(state, config, now, 1));
+
+		// the credit is capped with the burst
+		now += hz * 10;
+		assert(not Policy_t::check(state, config, now, 6));
+		assert(Policy_t::check(state, config, now, 5));
+		assert(not Policy_t::check(state, config, now, 1));
+
+		// the time wraps around
+		now = uint64_t(0) - 50;
+		Policy_t::init(state, config, now);
+		assert(Policy_t::check(state, config, now, 5));
+		now += 100;
+		assert(Policy_t::check(state, config, now, 1));
+		assert(not Policy_t::check(state, config, now, 1));
+	}
+
+	void test_sliding_window(unsigned step) noexcept {
+		printf("-> test_sliding_window(step=%u)\n", step);
+		using Policy_t = RateLimiterSlidingWindow;
+
+		// 100 units per 1000 cycles
+		const auto config = Policy_t::Config::make(1000, 100);
+		Policy_t::State state;
+		uint64_t now = 5000;
+		Policy_t::init(state, config, now);
+
+		assert(Policy_t::check(state, config, now, 60));
+		assert(Policy_t::check(state, config, now, 40));
+		assert(not Policy_t::check(state, config, now, 1));
+
+		// the previous window still counts in the half of the current one
+		now += 1500;
+		assert(Policy_t::check(state, config, now, 50));
+		assert(not Policy_t::check(state, config, now, 1));
+
+		// the previous window is over
+		now += 500;
+		assert(Policy_t::check(state, config, now, 50));
+		assert(not Policy_t::check(state, config, now, 50));
+
+		// both windows are over
+		now += 2000;
+		assert(Policy_t::check(state, config, now, 100));
+		assert(not Policy_t::check(state, config, now, 1));
+	}
+
+	void test_check_cost(unsigned step) noexcept {
+		printf("-> test_check_cost(step=%u)\n", step);
+
+		// 1500 bytes per second with a burst of 3000 bytes, a second is 1000 cycles
+		BucketLimiter_t limiter(m_capacity, 1.0f);
+		assert(limiter.allocate() == 0);
+		limiter.set_config(RateLimiterTokenBucket::Config::make(1500, 3000, 1000));
+
+		uint64_t now = 1000;
+		for(Key_t key = 0; key < m_capacity; key++) {
+			assert(limiter.check(key, 1500, now));
+			assert(limiter.check(key, 1500, now));
+			assert(not limiter.check(key, 64, now));
+		}
+		now += 1000;
+		for(Key_t key = 0; key < m_capacity; key++) {
+			assert(limiter.check(key, 1500, now));
+			assert(not limiter.check(key, 1500, now));
+		}
+		assert(limiter.size() == m_capacity);
+
+		RateLimiterStat stat;
+		limiter.load(stat);
+		assert(stat.passed == m_capacity * 3);
+		assert(stat.limited == m_capacity * 2);
+		assert(stat.inserted == m_capacity);
+		assert(stat.evicted == 0);
+	}
+
+	void test_burst_clock(unsigned step) noexcept {
+		printf("-> test_burst_clock(step=%u)\n", step);
+
+		// the time of a burst is set by the caller, in milliseconds
+		BurstLimiter_t limiter(m_capacity, 1.0f);
+		assert(limiter.allocate() == 0);
+		limiter.set_period(limiter.clock().hz() / 10 /*100 msec*/);
+
+		limiter.clock().set(1000);
+		for(Key_t key = 0; key < m_capacity; key++) {
+			assert(limiter.check(key));
+			assert(not limiter.check(key));
+		}
+		limiter.clock().set(1100);
+		for(Key_t key = 0; key < m_capacity; key++) {
+			assert(not limiter.check(key));
+		}
+		limiter.clock().set(1101);
+		for(Key_t key = 0; key < m_capacity; key++) {
+			assert(limiter.check(key));
+		}
+	}
+
+	/**
+	 * The open-addressing layout refuses the keys over its slots, their events are dropped, not allowed.
+	 */
+	void test_line_bucket(unsigned step) noexcept {
+		printf("-> test_line_bucket(step=%u)\n", step);
+		using LineLimiter_t = RateLimiter<Node_t, std::hash<Key_t>, intrusive::HashMapLineBucket<Node_t>, BurstClock<1000> >;
+		LineLimiter_t limiter(64, 16.0f);
+		assert(limiter.allocate() == 0);
+		limiter.set_period(limiter.clock().hz());
+
+		size_t passed = 0;
+		for(Key_t key = 0; key < 64; key++) {
+			passed += limiter.check(key);
+		}
+		RateLimiterStat stat;
+		limiter.load(stat);
+		assert(passed < 64 && limiter.size() == passed);
+		assert(stat.inserted == passed && stat.dropped == 64 - passed && stat.limited == 0);
+		// the linked keys are limited, the refused ones are dropped again
+		for(Key_t key = 0; key < 64; key++) {
+			assert(not limiter.check(key));
+		}
+		limiter.load(stat);
+		assert(stat.limited == passed && stat.dropped == 2 * (64 - passed) && stat.evicted == 0);
+		limiter.reset();
+		assert(limiter.size() == 0);
+	}
+
 	void test_clear(unsigned step) noexcept {
 		printf("-> test_clear(step=%u)\n", step);
 
@@ -173,9 +398,9 @@ public:
 
 private:
 
-	static void wait_cycles(uint64_t cycles) noexcept {
-		uint64_t init = rte_rdtsc();
-		while(rte_rdtsc() - init < cycles);
+	void wait_cycles(uint64_t cycles) noexcept {
+		uint64_t init = m_limiter.clock().now();
+		while(m_limiter.clock().now() - init < cycles);
 	}
 
 };
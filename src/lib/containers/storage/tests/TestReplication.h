@@ -0,0 +1,287 @@
+#ifndef STORAGE_TESTS_TESTREPLICATION_H
+#define STORAGE_TESTS_TESTREPLICATION_H
+
+#include "containers/storage/Replication.h"
+#include "containers/storage/RateLimiter.h"
+
+#include <assert.h>
+#include <cstdio>
+#include <vector>
+
+namespace storage {
+
+class TestReplication {
+
+	using Batch_t = std::vector<uint8_t>;
+	using Batches_t = std::vector<Batch_t>;
+
+	struct Sink {
+		Batches_t* batches;
+
+		void operator()(const uint8_t* batch, size_t bytes) const noexcept {
+			batches->push_back(Batch_t(batch, batch + bytes));
+		}
+	};
+
+	using Writer_t = ReplicationWriter<Sink>;
+
+	using LimiterNode_t = RateLimiterNode<uint32_t, intrusive::HashMapHook, RateLimiterTokenBucket>;
+	using Limiter_t = RateLimiter<LimiterNode_t, std::hash<uint32_t>, intrusive::HashMapBucket<LimiterNode_t>, BurstClock<1000> >;
+
+	const unsigned m_capacity;
+	IpTable m_table;
+	IpTable m_replica;
+	Batches_t m_batches;
+	Writer_t m_writer;
+
+public:
+
+	TestReplication(unsigned capacity, float load_factor) noexcept
+		: m_capacity(capacity)
+		, m_table(capacity, load_factor, capacity)
+		, m_replica(capacity, load_factor, capacity, true)
+		, m_batches()
+		, m_writer(Sink{&m_batches}) {
+		assert(m_table.allocate() == 0);
+		assert(m_replica.allocate() == 0);
+	}
+
+	TestReplication(const TestReplication&) = delete;
+	TestReplication(TestReplication&&) = delete;
+
+	TestReplication operator=(const TestReplication&) = delete;
+	TestReplication operator=(TestReplication&&) = delete;
+
+	~TestReplication() {}
+
+	void test() noexcept {
+		printf("<TestReplication>...\n");
+		printf("capacity=%u\n", m_capacity);
+
+		unsigned step = 1;
+		test_stream(step++);
+		test_gap(step++);
+		test_malformed(step++);
+		test_limiter(step++);
+	}
+
+private:
+
+	static IpTable::IPv4Addr_t v4(unsigned b0, unsigned b1, unsigned b2, unsigned b3) noexcept {
+		return IpTable::as_host_addr(b0, b1, b2, b3);
+	}
+
+	// the publisher updates its table and records the same update
+
+	void append_addr(IpTable::IPv4Addr_t addr) noexcept {
+		m_table.append_addr(addr);
+		m_writer.append_addr(addr);
+	}
+
+	void remove_addr(IpTable::IPv4Addr_t addr) noexcept {
+		m_table.remove_addr(addr);
+		m_writer.remove_addr(addr);
+	}
+
+	void append_net(IpTable::IPv4Addr_t net, IpTable::IPv4Addr_t mask) noexcept {
+		m_table.append_net(net, mask);
+		m_writer.append_net(net, mask);
+	}
+
+	void remove_net(IpTable::IPv4Addr_t net, IpTable::IPv4Addr_t mask) noexcept {
+		m_table.remove_net(net, mask);
+		m_writer.remove_net(net, mask);
+	}
+
+	/**
+	 * The same entries in the same eviction order.
+	 */
+	static bool same(const IpTable& first, const IpTable& second) noexcept {
+		std::vector<uint32_t> a;
+		std::vector<uint32_t> b;
+		first.for_each_addr([&a](IpTable::IPv4Addr_t addr) { a.push_back(addr); });
+		second.for_each_addr([&b](IpTable::IPv4Addr_t addr) { b.push_back(addr); });
+		first.for_each_net([&a](IpTable::IPv4Addr_t net, IpTable::IPv4Addr_t mask) { a.push_back(net); a.push_back(mask); });
+		second.for_each_net([&b](IpTable::IPv4Addr_t net, IpTable::IPv4Addr_t mask) { b.push_back(net); b.push_back(mask); });
+		return a == b;
+	}
+
+	ReplicationResult apply(ReplicationReader& reader, const Batch_t& batch) noexcept {
+		return reader.apply(batch.data(), batch.size(), m_replica);
+	}
+
+	/**
+	 * A late replica takes the snapshot, then the deltas with the evictions keep it the same.
+	 */
+	void test_stream(unsigned step) noexcept {
+		printf("-> test_stream(step=%u)\n", step);
+		ReplicationReader reader;
+
+		for(unsigned i = 0; i < m_capacity / 2; i++) {
+			append_addr(v4(192, 168, i >> 8, i));
+		}
+		append_net(v4(10, 0, 0, 0), v4(255, 0, 0, 0));
+		append_net(v4(172, 16, 0, 0), v4(255, 240, 0, 255)); // a non-contiguous mask
+		m_writer.flush();
+		assert(not m_batches.empty());
+		for(const Batch_t& batch : m_batches) {
+			assert(apply(reader, batch) == ReplicationResult::GAP); // no snapshot yet
+		}
+		assert(not reader.synced());
+		assert(m_replica.size_addr() == 0);
+		m_batches.clear();
+
+		m_writer.begin_snapshot();
+		m_writer.snapshot(m_table);
+		m_writer.flush();
+		assert(m_batches.size() > 1 && (m_batches[0][5] & ReplicationFormat::FLAG_SNAPSHOT));
+		for(const Batch_t& batch : m_batches) {
+			assert(apply(reader, batch) == ReplicationResult::APPLIED);
+		}
+		assert(reader.synced());
+		assert(same(m_table, m_replica));
+		m_batches.clear();
+
+		// the deltas evict the oldest addresses on both sides
+		for(unsigned i = 0; i < m_capacity; i++) {
+			append_addr(v4(10, 1, i >> 8, i));
+		}
+		remove_addr(v4(10, 1, 0, 7));
+		remove_net(v4(10, 0, 0, 0), v4(255, 0, 0, 0));
+		append_net(v4(100, 64, 0, 0), v4(255, 192, 0, 0));
+		m_writer.flush();
+		size_t bytes = 0;
+		for(const Batch_t& batch : m_batches) {
+			bytes += batch.size();
+			assert(apply(reader, batch) == ReplicationResult::APPLIED);
+		}
+		printf("records=%u bytes=%zu batches=%zu\n", m_capacity + 3, bytes, m_batches.size());
+		assert(bytes < (m_capacity + 3) * 5 + m_batches.size() * ReplicationFormat::HEADER + 16);
+		assert(same(m_table, m_replica));
+		assert(m_replica.find(v4(10, 1, 0, 8)) && not m_replica.find_in_addrs(v4(10, 1, 0, 7)));
+		assert(m_replica.find_in_nets(v4(172, 31, 7, 0)) && not m_replica.find_in_nets(v4(172, 31, 7, 1)));
+		assert(reader.stat().snapshots == 1);
+		m_batches.clear();
+	}
+
+	/**
+	 * A lost batch stops the replica until the next snapshot, a duplicate is dropped.
+	 */
+	void test_gap(unsigned step) noexcept {
+		printf("-> test_gap(step=%u)\n", step);
+		ReplicationReader reader;
+		m_writer.begin_snapshot();
+		m_writer.snapshot(m_table);
+		m_writer.flush();
+		for(const Batch_t& batch : m_batches) {
+			assert(apply(reader, batch) == ReplicationResult::APPLIED);
+		}
+		assert(apply(reader, m_batches.back()) == ReplicationResult::STALE);
+		m_batches.clear();
+
+		for(unsigned round = 0; round < 3; round++) {
+			append_addr(v4(10, 2, 0, round));
+			m_writer.flush();
+		}
+		assert(m_batches.size() == 3);
+		assert(apply(reader, m_batches[0]) == ReplicationResult::APPLIED);
+		assert(apply(reader, m_batches[2]) == ReplicationResult::GAP);
+		assert(apply(reader, m_batches[1]) == ReplicationResult::GAP);
+		assert(not reader.synced() && reader.stat().gaps == 2);
+		assert(not same(m_table, m_replica));
+		m_batches.clear();
+
+		m_writer.begin_snapshot();
+		m_writer.snapshot(m_table);
+		m_writer.flush();
+		for(const Batch_t& batch : m_batches) {
+			assert(apply(reader, batch) == ReplicationResult::APPLIED);
+		}
+		assert(same(m_table, m_replica));
+		m_batches.clear();
+	}
+
+	/**
+	 * A damaged batch changes nothing.
+	 */
+	void test_malformed(unsigned step) noexcept {
+		printf("-> test_malformed(step=%u)\n", step);
+		ReplicationReader reader;
+		m_writer.begin_snapshot();
+		m_writer.clear_table();
+		m_writer.append_addr(v4(1, 2, 3, 4));
+		m_writer.append_net(v4(1, 2, 0, 0), v4(255, 255, 0, 0));
+		m_writer.flush();
+		assert(m_batches.size() == 1);
+		const Batch_t good = m_batches[0];
+		m_batches.clear();
+		const size_t before = m_replica.size_addr();
+
+		Batch_t batch = good;
+		batch.pop_back(); // truncated
+		assert(apply(reader, batch) == ReplicationResult::MALFORMED);
+		batch = good;
+		batch[ReplicationFormat::HEADER + 1] = 0x7F; // an unknown operation after TABLE_CLEAR
+		assert(apply(reader, batch) == ReplicationResult::MALFORMED);
+		batch = good;
+		batch[0] ^= 1; // the magic
+		assert(apply(reader, batch) == ReplicationResult::MALFORMED);
+		batch = good;
+		batch[ReplicationFormat::HEADER + 1 + 5 + 5] = 33; // a prefix length
+		assert(apply(reader, batch) == ReplicationResult::MALFORMED);
+		batch = good;
+		batch.push_back(0); // a trailing byte
+		assert(apply(reader, batch) == ReplicationResult::MALFORMED);
+		assert(reader.stat().malformed == 5);
+		assert(m_replica.size_addr() == before);
+
+		assert(apply(reader, good) == ReplicationResult::APPLIED);
+		assert(m_replica.size_addr() == 1 && m_replica.size_net() == 1);
+		assert(m_replica.find(v4(1, 2, 3, 4)) && m_replica.find(v4(1, 2, 200, 1)));
+	}
+
+	/**
+	 * The config and the removals of the keys reach the limiter of the replica.
+	 */
+	void test_limiter(unsigned step) noexcept {
+		printf("-> test_limiter(step=%u)\n", step);
+		Limiter_t limiter(64, 1.0f);
+		assert(limiter.allocate() == 0);
+		ReplicationReader reader;
+
+		const Limiter_t::Config_t config = Limiter_t::Config_t::make(10, 2, 1000);
+		m_writer.begin_snapshot();
+		m_writer.snapshot(m_table);
+		m_writer.limit_config(config);
+		m_writer.flush();
+		for(const Batch_t& batch : m_batches) {
+			assert(reader.apply(batch.data(), batch.size(), m_replica, &limiter) == ReplicationResult::APPLIED);
+		}
+		m_batches.clear();
+		assert(limiter.config().rate == 10 && limiter.config().credit_max == config.credit_max);
+		assert(limiter.config().fill_cycles == config.fill_cycles && limiter.config().hz == 1000);
+
+		const uint32_t key = 0x01020304;
+		assert(limiter.check(key, 1, 1) && limiter.check(key, 1, 1));
+		assert(not limiter.check(key, 1, 1)); // the burst is spent
+		m_writer.limit_remove(key);
+		m_writer.flush();
+		assert(m_batches[0][ReplicationFormat::HEADER + 2] == 0x01); // big-endian
+		assert(reader.apply(m_batches[0].data(), m_batches[0].size(), m_replica, &limiter) == ReplicationResult::APPLIED);
+		assert(limiter.size() == 0);
+		assert(limiter.check(key, 1, 1)); // a new key
+		m_batches.clear();
+
+		m_writer.limit_reset();
+		m_writer.flush();
+		assert(reader.apply(m_batches[0].data(), m_batches[0].size(), m_replica, &limiter) == ReplicationResult::APPLIED);
+		assert(limiter.size() == 0);
+		m_batches.clear();
+		assert(same(m_table, m_replica));
+	}
+
+};
+
+}; // namespace storage
+
+#endif /* STORAGE_TESTS_TESTREPLICATION_H */
@@ -0,0 +1,134 @@
+#ifndef STORAGE_TESTS_TESTSHARDEDRATELIMITER_H
+#define STORAGE_TESTS_TESTSHARDEDRATELIMITER_H
+
+#include "containers/storage/ShardedRateLimiter.h"
+
+#include <assert.h>
+#include <iostream>
+#include <thread>
+
+namespace storage {
+
+class TestShardedRateLimiter {
+
+	using Key_t = unsigned;
+
+	using Node_t = RateLimiterNode<Key_t>;
+	using Limiter_t = ShardedRateLimiter<Node_t>;
+
+	Limiter_t m_limiter;
+	const unsigned m_shards;
+	const size_t m_capacity;
+
+public:
+
+	TestShardedRateLimiter(unsigned shards, unsigned capacity, float load_factor) noexcept
+		: m_limiter(shards, capacity, load_factor)
+		, m_shards(shards)
+		, m_capacity(capacity) {
+		assert(m_limiter.allocate() == 0);
+		for(unsigned i = 0; i < m_shards; i++) {
+			assert(m_limiter.allocate_shard(i) == 0);
+		}
+	}
+
+	TestShardedRateLimiter(const TestShardedRateLimiter&) = delete;
+	TestShardedRateLimiter(TestShardedRateLimiter&&) = delete;
+
+	TestShardedRateLimiter operator=(const TestShardedRateLimiter&) = delete;
+	TestShardedRateLimiter operator=(TestShardedRateLimiter&&) = delete;
+
+	~TestShardedRateLimiter() {}
+
+	void test() noexcept {
+		printf("<TestShardedRateLimiter>...\n");
+		printf("shards=%u\n", m_shards);
+		printf("capacity=%zu\n", m_capacity);
+		printf("storage_bytes=%.2f Kb\n", m_limiter.storage_bytes() / (float) 1024.0);
+		m_limiter.set_period(m_limiter.shard(0).clock().hz() * 10/*10 sec*/);
+
+		unsigned step = 1;
+		test_routing(step++);
+		test_owners(step++);
+	}
+
+	void test_routing(unsigned step) noexcept {
+		printf("-> test_routing(step=%u)\n", step);
+
+		// the keys are spread over all the shards and stay on their shards
+		size_t* hits = new size_t[m_shards]();
+		const size_t keys = m_capacity * m_shards / 2;
+		for(Key_t key = 0; key < keys; key++) {
+			const unsigned shard = m_limiter.shard_of(key);
+			assert(shard < m_shards);
+			assert(shard == m_limiter.shard_of(key));
+			hits[shard]++;
+			assert(m_limiter.check(key));
+			assert(not m_limiter.check(key));
+			assert(not m_limiter.shard(shard).check(key));
+		}
+		for(unsigned i = 0; i < m_shards; i++) {
+			assert(hits[i] > 0);
+			assert(hits[i] <= m_capacity);
+			assert(m_limiter.shard(i).size() == hits[i]);
+			m_limiter.publish(i);
+		}
+
+		RateLimiterStat stat;
+		m_limiter.load(stat);
+		assert(stat.capacity == m_capacity * m_shards);
+		assert(stat.size == keys);
+
+		for(unsigned i = 0; i < m_shards; i++) {
+			m_limiter.shard(i).reset();
+			m_limiter.publish(i);
+		}
+		m_limiter.load(stat);
+		assert(stat.size == 0);
+		delete[] hits;
+	}
+
+	void test_owners(unsigned step) noexcept {
+		printf("-> test_owners(step=%u)\n", step);
+
+		// every owner checks the keys of its shard and publishes, the statistics are read meanwhile
+		std::atomic<unsigned> done(0);
+		std::thread* owners = new std::thread[m_shards];
+		for(unsigned id = 0; id < m_shards; id++) {
+			owners[id] = std::thread([this, id, &done]() {
+				for(Key_t key = 0; key < m_capacity * m_shards; key++) {
+					if(m_limiter.shard_of(key) == id) {
+						m_limiter.check(key);
+						m_limiter.publish(id);
+					}
+				}
+				done++;
+			});
+		}
+		RateLimiterStat stat;
+		while(done != m_shards) {
+			m_limiter.load(stat);
+			assert(stat.capacity == m_capacity * m_shards);
+			assert(stat.size <= m_capacity * m_shards);
+		}
+		for(unsigned id = 0; id < m_shards; id++) {
+			owners[id].join();
+		}
+		delete[] owners;
+
+		size_t size = 0;
+		for(unsigned i = 0; i < m_shards; i++) {
+			size += m_limiter.shard(i).size();
+			m_limiter.shard(i).reset();
+			m_limiter.publish(i);
+		}
+		m_limiter.load(stat);
+		assert(stat.size == 0);
+		assert(size > 0);
+	}
+
+};
+
+}; // namespace storage
+
+#endif /* STORAGE_TESTS_TESTSHARDEDRATELIMITER_H */
@@ -0,0 +1,196 @@
+#ifndef STORAGE_TESTS_TESTSKETCH_H
+#define STORAGE_TESTS_TESTSKETCH_H
+
+#include "containers/storage/Sketch.h"
+
+#include <assert.h>
+#include <iostream>
+#include <vector>
+
+namespace storage {
+
+class TestSketch {
+
+	using Key_t = uint32_t;
+
+	using Sketch_t = CountMinSketch<12, 4, Key_t>;
+	using Counter_t = Sketch_t::Counter_t;
+	using Hll_t = HyperLogLog<12, Key_t>;
+
+	Sketch_t m_sketch;
+	Hll_t m_hll;
+	const size_t m_capacity;
+
+public:
+
+	TestSketch(unsigned capacity) noexcept
+		: m_sketch(capacity * 4), m_hll(), m_capacity(capacity) {
+		assert(m_sketch.allocate() == 0);
+		assert(m_sketch.allocate() != 0);
+		assert(m_hll.allocate() == 0);
+		assert(m_hll.allocate() != 0);
+	}
+
+	TestSketch(const TestSketch&) = delete;
+	TestSketch(TestSketch&&) = delete;
+
+	TestSketch operator=(const TestSketch&) = delete;
+	TestSketch operator=(TestSketch&&) = delete;
+
+	~TestSketch() {}
+
+	void test() noexcept {
+		printf("<TestSketch>...\n");
+		printf("capacity=%zu\n", m_capacity);
+		printf("columns=%zu\n", m_sketch.columns());
+		printf("sketch storage_bytes=%.2f Kb\n", m_sketch.storage_bytes() / (float) 1024.0);
+		printf("hll storage_bytes=%.2f Kb\n", m_hll.storage_bytes() / (float) 1024.0);
+
+		unsigned step = 1;
+		test_update_estimate(step++);
+		test_update_bulk(step++);
+		test_saturate(step++);
+		test_merge(step++);
+		test_hll_estimate(step++);
+		test_hll_bulk_merge(step++);
+	}
+
+	void test_update_estimate(unsigned step) noexcept {
+		printf("-> test_update_estimate(step=%u)\n", step);
+		m_sketch.reset();
+
+		// the estimates never underestimate and they are exact mostly with 4 columns per key
+		for(Key_t key = 0; key < m_capacity; key++) {
+			for(unsigned i = 0; i <= key % 8; i++) {
+				m_sketch.update(key, step);
+			}
+		}
+		size_t exact = 0;
+		for(Key_t key = 0; key < m_capacity; key++) {
+			const Counter_t expected = (key % 8 + 1) * step;
+			const Counter_t estimate = m_sketch.estimate(key);
+			assert(estimate >= expected);
+			exact += estimate == expected;
+		}
+		assert(exact * 10 >= m_capacity * 9);
+		assert(m_sketch.estimate(Key_t(m_capacity * 2)) <= 8 * step);
+
+		m_sketch.reset();
+		for(Key_t key = 0; key < m_capacity; key++) {
+			assert(m_sketch.estimate(key) == 0);
+		}
+	}
+
+	void test_update_bulk(unsigned step) noexcept {
+		printf("-> test_update_bulk(step=%u)\n", step);
+		m_sketch.reset();
+
+		// a burst longer than Sketch_t::BURST with and without the deltas
+		std::vector<Key_t> keys;
+		std::vector<Counter_t> deltas;
+		for(Key_t key = 0; key < m_capacity; key++) {
+			keys.push_back(key);
+			deltas.push_back(key % 16 + step);
+		}
+		m_sketch.update_bulk(keys.data(), keys.size());
+		m_sketch.update_bulk(keys.data(), keys.size(), deltas.data());
+
+		std::vector<Counter_t> estimates(keys.size());
+		m_sketch.estimate_bulk(keys.data(), keys.size(), estimates.data());
+		size_t exact = 0;
+		for(size_t i = 0; i < keys.size(); i++) {
+			const Counter_t expected = 1 + deltas[i];
+			assert(estimates[i] >= expected);
+			assert(estimates[i] == m_sketch.estimate(keys[i]));
+			exact += estimates[i] == expected;
+		}
+		assert(exact * 10 >= m_capacity * 9);
+		m_sketch.reset();
+	}
+
+	void test_saturate(unsigned step) noexcept {
+		printf("-> test_saturate(step=%u)\n", step);
+		m_sketch.reset();
+		const Key_t key = step;
+		m_sketch.update(key, Sketch_t::value_max() - 1);
+		assert(m_sketch.estimate(key) == Sketch_t::value_max() - 1);
+		m_sketch.update(key, 2);
+		assert(m_sketch.estimate(key) == Sketch_t::value_max());
+		m_sketch.update(key, Sketch_t::value_max());
+		assert(m_sketch.estimate(key) == Sketch_t::value_max());
+		m_sketch.reset();
+	}
+
+	void test_merge(unsigned step) noexcept {
+		printf("-> test_merge(step=%u)\n", step);
+		Sketch_t other(m_sketch.columns());
+		assert(other.allocate() == 0);
+		m_sketch.reset();
+		for(Key_t key = 0; key < m_capacity; key++) {
+			m_sketch.update(key, step);
+			other.update(key, key % 4);
+		}
+		m_sketch.merge(other);
+		size_t exact = 0;
+		for(Key_t key = 0; key < m_capacity; key++) {
+			const Counter_t expected = step + key % 4;
+			assert(m_sketch.estimate(key) >= expected);
+			exact += m_sketch.estimate(key) == expected;
+		}
+		assert(exact * 10 >= m_capacity * 9);
+		m_sketch.reset();
+	}
+
+	void test_hll_estimate(unsigned step) noexcept {
+		printf("-> test_hll_estimate(step=%u)\n", step);
+		m_hll.reset();
+		assert(m_hll.estimate() == 0);
+
+		// the duplicates don't count, the error is within 5 standard errors (1.04 / 64)
+		const size_t counts[] = {1, 100, 1000, 10000, 100000};
+		size_t added = 0;
+		for(size_t count : counts) {
+			for(; added < count; added++) {
+				m_hll.update(Key_t(added * step));
+				m_hll.update(Key_t(added * step));
+			}
+			const double estimate = m_hll.estimate();
+			const double error = estimate > count ? estimate - count : count - estimate;
+			printf("count=%zu estimate=%.1f\n", count, estimate);
+			assert(error <= 5 * 1.04 / 64 * count + 1);
+		}
+		m_hll.reset();
+	}
+
+	void test_hll_bulk_merge(unsigned step) noexcept {
+		printf("-> test_hll_bulk_merge(step=%u)\n", step);
+		const size_t count = 50000;
+		std::vector<Key_t> keys;
+		for(size_t i = 0; i < count; i++) {
+			keys.push_back(Key_t(i * step));
+		}
+
+		// two halves with an overlap give the union
+		Hll_t other;
+		assert(other.allocate() == 0);
+		m_hll.reset();
+		m_hll.update_bulk(keys.data(), count * 2 / 3);
+		other.update_bulk(keys.data() + count / 3, count - count / 3);
+		m_hll.merge(other);
+
+		Hll_t all;
+		assert(all.allocate() == 0);
+		for(Key_t key : keys) {
+			all.update(key);
+		}
+		assert(m_hll.estimate() == all.estimate());
+		const double error = m_hll.estimate() > count ? m_hll.estimate() - count : count - m_hll.estimate();
+		assert(error <= 5 * 1.04 / 64 * count);
+		m_hll.reset();
+	}
+
+};
+
+}; // namespace storage
+
+#endif /* STORAGE_TESTS_TESTSKETCH_H */
@@ -0,0 +1,135 @@
+#ifndef STORAGE_TESTS_TESTSNAPSHOT_H
+#define STORAGE_TESTS_TESTSNAPSHOT_H
+
+#include "containers/storage/Snapshot.h"
+
+#include <assert.h>
+#include <cstdio>
+#include <atomic>
+#include <thread>
+
+namespace storage {
+
+class TestSnapshot {
+
+	/**
+	 * A table which state is valid when all the values are the same.
+	 */
+	struct Table {
+		static constexpr size_t SIZE = 64;
+		uint64_t values[SIZE];
+
+		Table(uint64_t init) noexcept {
+			for(size_t i = 0; i < SIZE; i++) {
+				values[i] = init;
+			}
+		}
+
+		int allocate() noexcept {
+			return 0;
+		}
+
+		void set(uint64_t value) noexcept {
+			for(size_t i = 0; i < SIZE; i++) {
+				values[i] = value;
+			}
+		}
+
+		bool valid() const noexcept {
+			for(size_t i = 1; i < SIZE; i++) {
+				if(values[i] != values[0]) {
+					return false;
+				}
+			}
+			return true;
+		}
+	};
+
+	static constexpr unsigned READERS = 4;
+
+	using Qsbr_t = Qsbr<READERS>;
+	using Snapshot_t = Snapshot<Table, READERS>;
+
+	Qsbr_t m_qsbr;
+	Snapshot_t m_snapshot;
+	const size_t m_updates;
+
+public:
+
+	TestSnapshot(size_t updates) noexcept
+		: m_qsbr()
+		, m_snapshot(m_qsbr, 0)
+		, m_updates(updates) {
+		assert(m_snapshot.allocate() == 0);
+	}
+
+	TestSnapshot(const TestSnapshot&) = delete;
+	TestSnapshot(TestSnapshot&&) = delete;
+
+	TestSnapshot operator=(const TestSnapshot&) = delete;
+	TestSnapshot operator=(TestSnapshot&&) = delete;
+
+	~TestSnapshot() {}
+
+	void test() noexcept {
+		printf("<TestSnapshot>...\n");
+		printf("readers=%u\n", READERS);
+		printf("sizeof(Qsbr_t)=%zu\n", sizeof(Qsbr_t));
+
+		unsigned step = 1;
+		test_update(step++);
+		test_readers(step++);
+	}
+
+	void test_update(unsigned step) noexcept {
+		printf("-> test_update(step=%u)\n", step);
+
+		// no reader is online, so the grace period is over at once
+		for(uint64_t i = 1; i <= 4; i++) {
+			m_snapshot.update([i](Table& table) { table.set(i); });
+			assert(m_snapshot.read().valid());
+			assert(m_snapshot.read().values[0] == i);
+		}
+		m_snapshot.update([](Table& table) { table.set(0); });
+	}
+
+	void test_readers(unsigned step) noexcept {
+		printf("-> test_readers(step=%u)\n", step);
+
+		std::atomic<bool> stop(false);
+		std::atomic<unsigned> failed(0);
+		std::thread readers[READERS];
+		for(unsigned id = 0; id < READERS; id++) {
+			readers[id] = std::thread([this, id, &stop, &failed]() {
+				uint64_t last = 0;
+				m_qsbr.online(id);
+				while(not stop.load()) {
+					const Table& table = m_snapshot.read();
+					// the published versions never go back
+					if(not table.valid() || table.values[0] < last) {
+						failed++;
+					}
+					last = table.values[0];
+					m_qsbr.quiescent(id);
+					std::this_thread::yield();
+				}
+				m_qsbr.offline(id);
+			});
+		}
+
+		for(uint64_t i = 1; i <= m_updates; i++) {
+			m_snapshot.update([i](Table& table) { table.set(i); });
+		}
+		stop = true;
+		for(unsigned id = 0; id < READERS; id++) {
+			readers[id].join();
+		}
+		assert(failed == 0);
+		assert(m_snapshot.read().values[0] == m_updates);
+	}
+
+};
+
+}; // namespace storage
+
+#endif /* STORAGE_TESTS_TESTSNAPSHOT_H */
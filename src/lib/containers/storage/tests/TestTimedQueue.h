@@ -33,6 +33,7 @@ class TestTimedQueue {
 
 	using Node_t = TimedQueueNode<Key_t, Value_t>;
 	using Queue_t = TimedQueue<Node_t>;
+	using BurstQueue_t = TimedQueue<Node_t, std::hash<Key_t>, intrusive::HashMapBucket<Node_t>, BurstClock<1000> >;
 
 	Queue_t m_queue;
 	const size_t m_capacity;
@@ -64,6 +65,9 @@ public:
 		test_push_remove_same_key(step++);
 		test_push_remove_all(step++);
 		test_push_pop_timeout(step++);
+		test_push_pop_burst_clock(step++);
+		test_touch(step++);
+		test_stat(step++);
 
 		test_clear(step++);
 	}
@@ -247,6 +251,79 @@ public:
 		assert(m_queue.size() == 0);
 	}
 
+	void test_push_pop_burst_clock(unsigned step) {
+		printf("-> test_push_pop_burst_clock()\n");
+
+		// the time of a burst is set by the caller, in milliseconds
+		BurstQueue_t queue(m_capacity, 1.0f);
+		assert(queue.allocate() == 0);
+		for(size_t i = 0; i < m_capacity; i++) {
+			queue.clock().set(i);
+			assert(queue.push_back(i * step) != queue.end());
+		}
+
+		// the nodes pushed 10 msec ago and earlier are due
+		const size_t half = m_capacity / 2;
+		queue.clock().set(half + 9);
+		for(size_t i = 0; i < half; i++) {
+			auto it = queue.pop_front(10);
+			assert(it != queue.end());
+			assert(it->im_key == i * step);
+		}
+		for(size_t i = half; i < m_capacity; i++) {
+			assert(queue.pop_front(10) == queue.end());
+			queue.clock().set(i + 10);
+			auto it = queue.pop_front(10);
+			assert(it != queue.end());
+			assert(it->im_key == i * step);
+		}
+		assert(queue.size() == 0);
+	}
+
+	void test_touch(unsigned step) {
+		printf("-> test_touch()\n");
+
+		BurstQueue_t queue(m_capacity, 1.0f);
+		assert(queue.allocate() == 0);
+		bool pushed = false;
+		for(size_t i = 0; i < m_capacity; i++) {
+			queue.clock().set(i);
+			assert(queue.touch(i * step) == queue.end());
+			assert(queue.touch_or_push(i * step, pushed) != queue.end());
+			assert(pushed);
+		}
+		assert(queue.touch_or_push(m_capacity * step + 1, pushed) == queue.end());
+		assert(not pushed);
+
+		// the even keys are kept alive, the odd ones become idle
+		queue.clock().set(m_capacity);
+		for(size_t i = 0; i < m_capacity; i += 2) {
+			if(i % 4 == 0) {
+				assert(queue.touch(i * step) != queue.end());
+			} else {
+				assert(queue.touch_or_push(i * step, pushed) != queue.end());
+				assert(not pushed);
+			}
+		}
+		assert(queue.size() == m_capacity);
+
+		queue.clock().set(m_capacity * 2 - 1);
+		for(size_t i = 1; i < m_capacity; i += 2) {
+			auto it = queue.pop_front(m_capacity);
+			assert(it != queue.end());
+			assert(it->im_key == i * step);
+		}
+		assert(queue.pop_front(m_capacity) == queue.end());
+
+		queue.clock().set(m_capacity * 2);
+		for(size_t i = 0; i < m_capacity; i += 2) {
+			auto it = queue.pop_front(m_capacity);
+			assert(it != queue.end());
+			assert(it->im_key == i * step);
+		}
+		assert(queue.size() == 0);
+	}
+
 	void test_clear(unsigned step) {
 		printf("-> test_clear()\n");
 
@@ -261,6 +338,31 @@ public:
 		assert(m_queue.size() == 0);
 	}
 
+	void test_stat(unsigned step) {
+		printf("-> test_stat()\n");
+		assert(m_queue.size() == 0);
+		TimedQueueStat prev;
+		m_queue.load(prev);
+
+		for(size_t i = 0; i < m_capacity; i++) {
+			push_back(i * step, i + step);
+		}
+		push_back_oversize(step);
+		remove_one(0, step);
+		for(size_t i = 1; i < m_capacity; i++) {
+			pop_front_one(i * step, i + step, 0);
+		}
+
+		TimedQueueStat stat;
+		m_queue.load(stat);
+		assert(stat.capacity == m_capacity);
+		assert(stat.size == 0);
+		assert(stat.pushed - prev.pushed == m_capacity);
+		assert(stat.dropped - prev.dropped == 1);
+		assert(stat.removed - prev.removed == 1);
+		assert(stat.expired - prev.expired == m_capacity - 1);
+	}
+
 private:
 
 	void push_back(const Key_t& key, const Value_t& value) noexcept {
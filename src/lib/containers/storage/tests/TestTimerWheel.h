@@ -0,0 +1,216 @@
+#ifndef STORAGE_TESTS_TESTTIMERWHEEL_H
+#define STORAGE_TESTS_TESTTIMERWHEEL_H
+
+#include "containers/storage/TimerWheel.h"
+
+#include <assert.h>
+#include <iostream>
+
+namespace storage {
+
+class TestTimerWheel {
+
+	using Key_t = unsigned;
+	using Value_t = uint64_t;
+
+	using Node_t = TimerWheelNode<Key_t, Value_t>;
+	using Wheel_t = TimerWheel<Node_t>;
+
+	Wheel_t m_wheel;
+	const size_t m_capacity;
+
+public:
+
+	TestTimerWheel(unsigned capacity, float load_factor) noexcept
+		: m_wheel(capacity, load_factor), m_capacity(capacity) {
+		assert(m_wheel.allocate() == 0);
+	}
+
+	TestTimerWheel(const TestTimerWheel&) = delete;
+	TestTimerWheel(TestTimerWheel&&) = delete;
+
+	TestTimerWheel operator=(const TestTimerWheel&) = delete;
+	TestTimerWheel operator=(TestTimerWheel&&) = delete;
+
+	~TestTimerWheel() {}
+
+	void test() noexcept {
+		printf("<TestTimerWheel>...\n");
+		printf("sizeof(Node_t)=%zu\n", sizeof(Node_t));
+		printf("capacity=%zu\n", m_capacity);
+		printf("storage_bytes=%.2f Kb\n", m_wheel.storage_bytes() / (float) 1024.0);
+
+		unsigned step = 1;
+		test_schedule_expire(step++);
+		test_levels(step++);
+		test_cancel(step++);
+		test_refresh(step++);
+		test_oversize(step++);
+		test_clear(step++);
+		test_line_bucket(step++);
+	}
+
+	void test_schedule_expire(unsigned step) noexcept {
+		printf("-> test_schedule_expire(step=%u)\n", step);
+		assert(m_wheel.size() == 0);
+
+		// the nodes expire in the order of the timeouts, not of the insertion
+		const uint64_t start = m_wheel.now();
+		for(size_t i = 0; i < m_capacity; i++) {
+			schedule(i, m_capacity - i);
+		}
+		assert(m_wheel.size() == m_capacity);
+
+		for(uint64_t tick = 1; tick <= m_capacity; tick++) {
+			Value_t last = 0;
+			size_t expired = m_wheel.expire(start + tick, [&](Node_t& node) {
+				last = node.value;
+			});
+			assert(expired == 1);
+			assert(last == m_capacity - tick);
+			assert(m_wheel.find(last) == m_wheel.end());
+		}
+		assert(m_wheel.size() == 0);
+	}
+
+	void test_levels(unsigned step) noexcept {
+		printf("-> test_levels(step=%u)\n", step);
+		assert(m_wheel.size() == 0);
+
+		// the timeouts of every level are cascaded down and expire exactly in time
+		const uint64_t timeouts[] = {1, 255, 256, 257, 65535, 65536, 65537, 1 << 20, (1 << 24) + 3};
+		const size_t n = sizeof(timeouts) / sizeof(timeouts[0]);
+		const uint64_t start = m_wheel.now();
+		for(size_t i = 0; i < n; i++) {
+			schedule(i, timeouts[i]);
+			assert(m_wheel.remaining(m_wheel.find(i)) == timeouts[i]);
+		}
+		for(size_t i = 0; i < n; i++) {
+			size_t expired = m_wheel.expire(start + timeouts[i] - 1, [](Node_t&) {});
+			assert(expired == 0);
+			expired = m_wheel.expire(start + timeouts[i], [&](Node_t& node) {
+				assert(node.value == i);
+			});
+			assert(expired == 1);
+		}
+		assert(m_wheel.size() == 0);
+	}
+
+	void test_cancel(unsigned step) noexcept {
+		printf("-> test_cancel(step=%u)\n", step);
+		assert(m_wheel.size() == 0);
+
+		const uint64_t start = m_wheel.now();
+		for(size_t i = 0; i < m_capacity; i++) {
+			schedule(i, 1 + i * 300);
+		}
+		for(size_t i = 0; i < m_capacity; i += 2) {
+			assert(m_wheel.remove(i) != m_wheel.end());
+			assert(m_wheel.remove(i) == m_wheel.end());
+		}
+		assert(m_wheel.size() == m_capacity / 2);
+
+		size_t expired = m_wheel.expire(start + m_capacity * 300, [](Node_t& node) {
+			assert(node.value % 2 == 1);
+		});
+		assert(expired == m_capacity / 2);
+		assert(m_wheel.size() == 0);
+	}
+
+	void test_refresh(unsigned step) noexcept {
+		printf("-> test_refresh(step=%u)\n", step);
+		assert(m_wheel.size() == 0);
+
+		// a refreshed node is kept alive as long as it is refreshed in time
+		const uint64_t start = m_wheel.now();
+		schedule(0, 1000);
+		schedule(1, 1000);
+		for(uint64_t tick = 500; tick <= 5000; tick += 500) {
+			m_wheel.refresh(m_wheel.find(0), 1000);
+			size_t expired = m_wheel.expire(start + tick, [](Node_t& node) {
+				assert(node.value == 1);
+			});
+			assert(expired == (tick == 1000 ? 1 : 0));
+		}
+		assert(m_wheel.size() == 1);
+		assert(m_wheel.remaining(m_wheel.find(0)) == 500);
+		assert(m_wheel.expire(start + 5499, [](Node_t&) {}) == 0);
+		assert(m_wheel.expire(start + 5500, [](Node_t&) {}) == 1);
+		assert(m_wheel.size() == 0);
+	}
+
+	void test_oversize(unsigned step) noexcept {
+		printf("-> test_oversize(step=%u)\n", step);
+		assert(m_wheel.size() == 0);
+
+		for(size_t i = 0; i < m_capacity; i++) {
+			schedule(i, i + 1);
+		}
+		assert(m_wheel.schedule(m_capacity, 1) == m_wheel.end());
+
+		// an idle wheel skips the ticks at once
+		assert(m_wheel.expire(m_wheel.now() + m_capacity, [](Node_t&) {}) == m_capacity);
+		assert(m_wheel.expire(m_wheel.now() + Wheel_t::TIMEOUT_MAX, [](Node_t&) {}) == 0);
+
+		// too long timeouts are clamped
+		auto it = m_wheel.schedule(0, Wheel_t::TIMEOUT_MAX * 2);
+		assert(it != m_wheel.end());
+		assert(m_wheel.remaining(it) == Wheel_t::TIMEOUT_MAX);
+		m_wheel.cancel(it);
+		assert(m_wheel.size() == 0);
+	}
+
+	void test_clear(unsigned step) noexcept {
+		printf("-> test_clear(step=%u)\n", step);
+
+		assert(m_wheel.size() == 0);
+		m_wheel.reset();
+
+		assert(m_wheel.size() == 0);
+		for(size_t i = 0; i < m_capacity; i++) {
+			schedule(i, i * 1000);
+		}
+		m_wheel.reset();
+		assert(m_wheel.size() == 0);
+		assert(m_wheel.available() == m_capacity);
+	}
+
+	/**
+	 * The open-addressing layout holds SLOTS * buckets keys, a timer it refuses takes no node.
+	 */
+	void test_line_bucket(unsigned step) noexcept {
+		printf("-> test_line_bucket(step=%u)\n", step);
+		using LineBucket_t = intrusive::HashMapLineBucket<Node_t>;
+		using LineWheel_t = TimerWheel<Node_t, std::hash<Key_t>, LineBucket_t>;
+		LineWheel_t wheel(64, 16.0f);
+		assert(wheel.allocate() == 0);
+		const size_t slots = wheel.m_map.buckets() * LineBucket_t::SLOTS;
+		assert(slots < 64);
+
+		size_t scheduled = 0;
+		for(size_t i = 0; i < 64; i++) {
+			if(wheel.schedule(Key_t(i * step), i + 1) != wheel.end()) {
+				scheduled++;
+			}
+		}
+		assert(scheduled == slots && wheel.size() == slots);
+		TimedQueueStat stat;
+		wheel.load(stat);
+		assert(stat.dropped == 64 - slots);
+		assert(wheel.expire(wheel.now() + 64, [](Node_t& node) { assert(not node.im_linked); }) == slots);
+		assert(wheel.size() == 0 && wheel.available() == 64);
+	}
+
+private:
+
+	void schedule(size_t i, uint64_t timeout) noexcept {
+		auto it = m_wheel.schedule(Key_t(i), timeout);
+		assert(it != m_wheel.end());
+		it->value = i;
+	}
+
+};
+
+}; // namespace storage
+
+#endif /* STORAGE_TESTS_TESTTIMERWHEEL_H */
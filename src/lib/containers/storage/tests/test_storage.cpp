@@ -3,8 +3,22 @@
 
 #include "../../dpdk/Utils.h"
 #include "TestTimedQueue.h"
+#include "TestTimerWheel.h"
 #include "TestIpTable.h"
+#include "TestIp6Table.h"
+#include "TestIpListLoader.h"
+#include "TestReplication.h"
+#include "TestMacTable.h"
+#include "TestRateLimiter.h"
+#include "TestShardedRateLimiter.h"
 #include "TestPyramid.h"
+#include "TestIndexedPyramid.h"
+#include "TestPrefixTable.h"
+#include "TestSnapshot.h"
+#include "TestSketch.h"
+#include "TestCuckooFilter.h"
+#include "TestFlowTable.h"
+#include "TestConnTable.h"
 
 using namespace storage;
 
@@ -25,6 +39,10 @@ int main_storage(int argc, char** argv) {
 //	queue_second.test();
 //	std::cout << "\n";
 //
+//	TestTimerWheel timer_wheel_first(storage_size, load_factor_one);
+//	timer_wheel_first.test();
+//	std::cout << "\n";
+//
 //	TestRateLimiter rate_limiter_first(storage_size, load_factor_one);
 //	rate_limiter_first.test();
 //	std::cout << "\n";
@@ -33,6 +51,10 @@ int main_storage(int argc, char** argv) {
 //	rate_limiter_second.test();
 //	std::cout << "\n";
 //
+//	TestShardedRateLimiter sharded_rate_limiter(4, storage_size, load_factor_one);
+//	sharded_rate_limiter.test();
+//	std::cout << "\n";
+//
 //	TestIpTable ip_table_first(storage_size, load_factor_one);
 //	ip_table_first.test();
 //	std::cout << "\n";
@@ -41,11 +63,57 @@ int main_storage(int argc, char** argv) {
 //	ip_table_second.test();
 //	std::cout << "\n";
 //
+//	TestIp6Table ip6_table_first(storage_size, load_factor_one);
+//	ip6_table_first.test();
+//	std::cout << "\n";
+//
 //	dpdk::Dumper::malloc_stat(stdout);
 
 	TestPyramid pyramid(storage_size);
 	pyramid.test();
 
+	TestIp6Table ip6_table(1024 * 1024, 0.7f);
+	ip6_table.test();
+
+	TestTimerWheel timer_wheel(1024 * 1024, 0.7f);
+	timer_wheel.test();
+
+	TestRateLimiter rate_limiter(1024 * 1024, 0.7f);
+	rate_limiter.test();
+
+	TestShardedRateLimiter sharded_rate_limiter(4, 1024 * 1024, 0.7f);
+	sharded_rate_limiter.test();
+
+	TestIndexedPyramid indexed_pyramid(1024 * 1024);
+	indexed_pyramid.test();
+
+	TestPrefixTable prefix_table(1024);
+	prefix_table.test();
+
+	TestSnapshot snapshot(1000);
+	snapshot.test();
+
+	TestSketch sketch(10000);
+	sketch.test();
+
+	TestCuckooFilter cuckoo_filter(10000);
+	cuckoo_filter.test();
+
+	TestFlowTable flow_table(1024);
+	flow_table.test();
+
+	TestConnTable conn_table(1024);
+	conn_table.test();
+
+	TestIpListLoader ip_list_loader(1024, 0.7f);
+	ip_list_loader.test();
+
+	TestReplication replication(1024, 0.7f);
+	replication.test();
+
+	TestMacTable mac_table(1024);
+	mac_table.test();
+
 	std::cout << "<---- the end of main_storage() ---->\n";
 	return 0;
 }
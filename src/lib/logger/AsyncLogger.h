@@ -0,0 +1,716 @@
+#ifndef ASYNC_LOGGER_H_
+#define ASYNC_LOGGER_H_
+
+#include "../utils/SpscByteRing.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+#include <time.h>
+
+struct AsyncLoggerStat {
+	uint64_t logged;
+	uint64_t dropped; // the ring of the thread was full or there was no ring for the thread
+	uint64_t written;
+	uint64_t batches;
+	uint64_t bytes;
+	unsigned threads; // which have logged
+
+	AsyncLoggerStat() noexcept : logged(0), dropped(0), written(0), batches(0), bytes(0), threads(0) {}
+};
+
+/**
+ * A logger which takes a record off the calling thread by a few stores: the record is the timestamp, the pointers
+ * to the format, the function and the file and the arguments in the binary form, it is copied into the ring
+ * (utils::SpscByteRing) of the thread. The strings are copied, the other arguments are kept by their values.
+ * The I/O thread merges the records of all the threads by their timestamps, formats them by printf() rules and
+ * writes them in batches by one fwrite() and fflush().
+ * There is no lock on the way of a record but the first record of a thread, which takes a ring. A record which
+ * doesn't fit into the ring is dropped and counted, the I/O thread reports the drops to the file.
+ * The format must be a literal (or must outlive the logger) since it is formatted later, see the LOG_ macros.
+ *
+ * Using sample:
+ * AsyncLogger::instance().start(stderr);
+ * LOG_INFO("port %u: %zu packets", port_id, packets);
+ * ...
+ * AsyncLogger::instance().stop();
+ */
+class AsyncLogger {
+public:
+	enum Level : uint8_t {
+		CRITICAL,
+		INFO,
+		DEBUG,
+		RAW, // the message and a new line, without the prefix
+		TEXT // the message only, see LOGC
+	};
+
+	static constexpr size_t DEFAULT_RING_BYTES = size_t(256) << 10;
+	static constexpr size_t RECORD_BYTES = 1024; // the longer strings are cut
+	static constexpr unsigned THREADS_MAX = 64;
+	static constexpr unsigned IDLE_SLEEP_US = 1000;
+	static constexpr size_t BATCH_BYTES = size_t(64) << 10;
+
+private:
+	enum Type : uint8_t {
+		INT,
+		UINT,
+		DOUBLE,
+		STRING,
+		POINTER
+	};
+
+	enum State : int {
+		FREE,
+		USED,
+		RETIRED // the thread has exited, the ring is freed when it is empty
+	};
+
+	struct Header {
+		uint64_t ts; // nanoseconds of CLOCK_MONOTONIC
+		const char* format;
+		const char* function;
+		const char* file;
+		uint32_t size; // of the record
+		uint32_t line;
+		uint8_t level;
+		uint8_t args;
+	};
+
+	struct Record {
+		uint8_t bytes[RECORD_BYTES];
+		size_t size;
+		bool cut;
+	};
+
+	struct Slot {
+		utils::SpscByteRing ring;
+		std::atomic<int> state;
+		std::atomic<uint64_t> logged;
+		std::atomic<uint64_t> dropped;
+
+		Slot(size_t ring_bytes) noexcept : ring(ring_bytes), state(FREE), logged(0), dropped(0) {}
+	};
+
+	/**
+	 * The slot of a thread, it is retired by the exit of the thread.
+	 */
+	struct Handle {
+		Slot* slot;
+		bool none; // there has been no slot for the thread
+
+		Handle() noexcept : slot(nullptr), none(false) {}
+
+		~Handle() noexcept {
+			if(slot) {
+				slot->state.store(RETIRED, std::memory_order_release);
+			}
+		}
+	};
+
+	std::atomic<Slot*> m_slots[THREADS_MAX];
+	std::atomic<unsigned> m_slot_count;
+	std::mutex m_mutex; // of the slot registration
+	size_t m_ring_bytes;
+	FILE* m_out;
+	std::thread m_thread;
+	std::atomic<bool> m_running;
+	std::atomic<bool> m_stop;
+
+	std::atomic<uint64_t> m_dropped; // by the threads without a slot
+	std::atomic<uint64_t> m_written;
+	std::atomic<uint64_t> m_batches;
+	std::atomic<uint64_t> m_bytes;
+	uint64_t m_dropped_reported; // by the I/O thread
+
+	char m_batch[BATCH_BYTES]; // of the I/O thread
+	size_t m_batch_size;
+
+	AsyncLogger() noexcept
+		: m_slot_count(0), m_mutex(), m_ring_bytes(DEFAULT_RING_BYTES), m_out(nullptr), m_thread(), m_running(false)
+		, m_stop(false), m_dropped(0), m_written(0), m_batches(0), m_bytes(0), m_dropped_reported(0), m_batch_size(0) {
+		for(auto& slot : m_slots) {
+			slot.store(nullptr, std::memory_order_relaxed);
+		}
+	}
+
+public:
+	AsyncLogger(const AsyncLogger&) = delete;
+	AsyncLogger& operator=(const AsyncLogger&) = delete;
+
+	AsyncLogger(AsyncLogger&&) = delete;
+	AsyncLogger& operator=(AsyncLogger&&) = delete;
+
+	~AsyncLogger() noexcept {
+		stop();
+		for(auto& slot : m_slots) {
+			delete slot.load(std::memory_order_relaxed);
+		}
+	}
+
+	static AsyncLogger& instance() noexcept {
+		static AsyncLogger logger;
+		return logger;
+	}
+
+	/**
+	 * Start the I/O thread which writes to @out.
+	 * @param ring_bytes - the ring of every thread, it is rounded up to a power of two, the rings taken before
+	 * keep their sizes.
+	 * @return 0 - if the thread has been started.
+	 */
+	int start(FILE* out, size_t ring_bytes = DEFAULT_RING_BYTES) {
+		if(m_thread.joinable() || out == nullptr)
+			return -1;
+
+		m_out = out;
+		m_ring_bytes = ring_bytes;
+		m_stop.store(false);
+		m_thread = std::thread(&AsyncLogger::run, this);
+		m_running.store(true, std::memory_order_release);
+		return 0;
+	}
+
+	/**
+	 * Write the remaining records and stop the I/O thread, the records logged during the stop may be left
+	 * in the rings until the next start().
+	 */
+	void stop() {
+		if(m_thread.joinable()) {
+			m_running.store(false, std::memory_order_release);
+			m_stop.store(true, std::memory_order_release);
+			m_thread.join();
+		}
+	}
+
+	inline bool running() const noexcept {
+		return m_running.load(std::memory_order_acquire);
+	}
+
+	/**
+	 * Put a record into the ring of the calling thread.
+	 * @param format - printf() format, it is kept by the pointer.
+	 * @return false - if the logger is not running, the record is not taken then.
+	 */
+	template <typename... Args>
+	bool log(Level level, const char* function, const char* file, unsigned line, const char* format,
+	         const Args&... args) noexcept {
+		if(not running())
+			return false;
+
+		Slot* slot = local();
+		if(slot == nullptr) {
+			m_dropped.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+
+		Record record;
+		record.size = sizeof(Header);
+		record.cut = false;
+		put_all(record, args...);
+
+		Header header;
+		header.ts = now();
+		header.format = format;
+		header.function = function;
+		header.file = file;
+		header.size = uint32_t(record.size);
+		header.line = line;
+		header.level = level;
+		header.args = uint8_t(sizeof...(Args));
+		memcpy(record.bytes, &header, sizeof(header));
+
+		if(slot->ring.write(record.bytes, record.size)) {
+			slot->logged.store(slot->logged.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		} else {
+			slot->dropped.store(slot->dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		}
+		return true;
+	}
+
+	AsyncLoggerStat stat() const noexcept {
+		AsyncLoggerStat result;
+		const unsigned count = m_slot_count.load(std::memory_order_acquire);
+		for(unsigned i = 0; i < count; i++) {
+			const Slot* slot = m_slots[i].load(std::memory_order_acquire);
+			if(slot) {
+				result.logged += slot->logged.load(std::memory_order_relaxed);
+				result.dropped += slot->dropped.load(std::memory_order_relaxed);
+			}
+		}
+		result.dropped += m_dropped.load(std::memory_order_relaxed);
+		result.written = m_written.load(std::memory_order_relaxed);
+		result.batches = m_batches.load(std::memory_order_relaxed);
+		result.bytes = m_bytes.load(std::memory_order_relaxed);
+		result.threads = count;
+		return result;
+	}
+
+private:
+
+	static inline uint64_t now() noexcept {
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return uint64_t(ts.tv_sec) * 1000000000u + uint64_t(ts.tv_nsec);
+	}
+
+	/**
+	 * @return the slot of the calling thread, nullptr - if all the slots are taken.
+	 */
+	Slot* local() noexcept {
+		static thread_local Handle handle;
+		if(handle.slot || handle.none)
+			return handle.slot;
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		const unsigned count = m_slot_count.load(std::memory_order_relaxed);
+		for(unsigned i = 0; i < count; i++) {
+			Slot* slot = m_slots[i].load(std::memory_order_relaxed);
+			int state = FREE;
+			if(slot->state.compare_exchange_strong(state, USED, std::memory_order_acq_rel)) {
+				handle.slot = slot;
+				return slot;
+			}
+		}
+		if(count < THREADS_MAX) {
+			Slot* slot = new(std::nothrow) Slot(m_ring_bytes);
+			if(slot && slot->ring.allocate() == 0) {
+				slot->state.store(USED, std::memory_order_relaxed);
+				m_slots[count].store(slot, std::memory_order_release);
+				m_slot_count.store(count + 1, std::memory_order_release);
+				handle.slot = slot;
+				return slot;
+			}
+			delete slot;
+		}
+		handle.none = true;
+		return nullptr;
+	}
+
+	//
+	// the arguments of a record: the type and the value, a string is its length (uint16_t) and the chars
+	//
+
+	static inline void put_all(Record&) noexcept {}
+
+	template <typename T, typename... Rest>
+	static inline void put_all(Record& record, const T& value, const Rest&... rest) noexcept {
+		put(record, value);
+		put_all(record, rest...);
+	}
+
+	template <typename T>
+	static inline typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type
+	put(Record& record, T value) noexcept {
+		put(record, INT, int64_t(value));
+	}
+
+	template <typename T>
+	static inline typename std::enable_if<std::is_integral<T>::value && not std::is_signed<T>::value>::type
+	put(Record& record, T value) noexcept {
+		put(record, UINT, uint64_t(value));
+	}
+
+	template <typename T>
+	static inline typename std::enable_if<std::is_enum<T>::value>::type put(Record& record, T value) noexcept {
+		put(record, INT, int64_t(value));
+	}
+
+	template <typename T>
+	static inline typename std::enable_if<std::is_floating_point<T>::value>::type
+	put(Record& record, T value) noexcept {
+		put(record, DOUBLE, double(value));
+	}
+
+	template <typename T>
+	static inline void put(Record& record, const T* value) noexcept {
+		put(record, POINTER, uintptr_t(value));
+	}
+
+	static inline void put(Record& record, std::nullptr_t) noexcept {
+		put(record, POINTER, uintptr_t(0));
+	}
+
+	static inline void put(Record& record, const char* value) noexcept {
+		if(value == nullptr) {
+			value = "(null)";
+		}
+		put_string(record, value, strlen(value));
+	}
+
+	static inline void put(Record& record, char* value) noexcept {
+		put(record, static_cast<const char*>(value));
+	}
+
+	template <size_t N>
+	static inline void put(Record& record, const char (&value)[N]) noexcept {
+		put(record, static_cast<const char*>(value));
+	}
+
+	static inline void put(Record& record, const std::string& value) noexcept {
+		put_string(record, value.data(), value.size());
+	}
+
+	template <typename T>
+	static inline void put(Record& record, Type type, T value) noexcept {
+		if(record.cut || RECORD_BYTES - record.size < 1 + sizeof(value)) {
+			record.cut = true;
+			return;
+		}
+		record.bytes[record.size] = type;
+		memcpy(record.bytes + record.size + 1, &value, sizeof(value));
+		record.size += 1 + sizeof(value);
+	}
+
+	static inline void put_string(Record& record, const char* value, size_t length) noexcept {
+		if(record.cut || RECORD_BYTES - record.size < 1 + sizeof(uint16_t)) {
+			record.cut = true;
+			return;
+		}
+		const size_t room = RECORD_BYTES - record.size - 1 - sizeof(uint16_t);
+		const uint16_t bytes = uint16_t(length < room ? length : room);
+		record.bytes[record.size] = STRING;
+		memcpy(record.bytes + record.size + 1, &bytes, sizeof(bytes));
+		memcpy(record.bytes + record.size + 1 + sizeof(bytes), value, bytes);
+		record.size += 1 + sizeof(bytes) + bytes;
+	}
+
+	//
+	// the I/O thread
+	//
+
+	/**
+	 * The readable bytes of a ring which are taken by a batch.
+	 */
+	struct View {
+		Slot* slot;
+		struct iovec iov[2];
+		int iov_count;
+		size_t size;
+		size_t offset; // of the next record
+		Header next;
+	};
+
+	void run() noexcept {
+		for(;;) {
+			const bool stop = m_stop.load(std::memory_order_acquire);
+			if(batch()) {
+				continue;
+			}
+			if(stop) {
+				break;
+			}
+			std::this_thread::sleep_for(std::chrono::microseconds(unsigned(IDLE_SLEEP_US)));
+		}
+		fflush(m_out);
+	}
+
+	/**
+	 * Write all the records of the rings merged by their timestamps.
+	 * @return amount of the written records.
+	 */
+	size_t batch() noexcept {
+		View views[THREADS_MAX];
+		unsigned view_count = 0;
+		const unsigned count = m_slot_count.load(std::memory_order_acquire);
+		for(unsigned i = 0; i < count; i++) {
+			Slot* slot = m_slots[i].load(std::memory_order_acquire);
+			View& view = views[view_count];
+			view.slot = slot;
+			view.offset = 0;
+			view.size = slot->ring.peek(view.iov, view.iov_count);
+			if(view.size) {
+				gather(view, 0, &view.next, sizeof(view.next));
+				view_count++;
+			} else if(slot->state.load(std::memory_order_acquire) == RETIRED) {
+				slot->state.store(FREE, std::memory_order_release);
+			}
+		}
+
+		size_t result = 0;
+		Record record;
+		while(view_count) {
+			unsigned first = 0;
+			for(unsigned i = 1; i < view_count; i++) {
+				if(views[i].next.ts < views[first].next.ts) {
+					first = i;
+				}
+			}
+			View& view = views[first];
+			record.size = view.next.size;
+			gather(view, view.offset, record.bytes, record.size);
+			format(record);
+			result++;
+
+			view.offset += record.size;
+			if(view.offset < view.size) {
+				gather(view, view.offset, &view.next, sizeof(view.next));
+			} else {
+				view.slot->ring.consume(view.size);
+				view = views[--view_count];
+			}
+		}
+
+		const uint64_t dropped = stat().dropped;
+		if(dropped != m_dropped_reported) {
+			char line[128];
+			const int bytes = snprintf(line, sizeof(line), "[critical] AsyncLogger: %lu records have been dropped\n",
+			                           (unsigned long)(dropped - m_dropped_reported));
+			append(line, size_t(bytes));
+			m_dropped_reported = dropped;
+		}
+
+		if(m_batch_size) {
+			write_batch();
+			fflush(m_out);
+			m_batches.fetch_add(1, std::memory_order_relaxed);
+		}
+		m_written.fetch_add(result, std::memory_order_relaxed);
+		return result;
+	}
+
+	/**
+	 * Copy @bytes at @offset of the view, they may cross the end of the ring.
+	 */
+	static void gather(const View& view, size_t offset, void* data, size_t bytes) noexcept {
+		uint8_t* ptr = static_cast<uint8_t*>(data);
+		for(int i = 0; i < view.iov_count && bytes; i++) {
+			const size_t length = view.iov[i].iov_len;
+			if(offset >= length) {
+				offset -= length;
+				continue;
+			}
+			const size_t chunk = bytes < length - offset ? bytes : length - offset;
+			memcpy(ptr, static_cast<const uint8_t*>(view.iov[i].iov_base) + offset, chunk);
+			ptr += chunk;
+			bytes -= chunk;
+			offset = 0;
+		}
+	}
+
+	/**
+	 * Format a record by the printf() rules, every conversion is formatted by snprintf() with the argument
+	 * of the record, the length modifiers of the format are replaced by the ones of the kept types.
+	 */
+	void format(const Record& record) noexcept {
+		Header header;
+		memcpy(&header, record.bytes, sizeof(header));
+		char line[RECORD_BYTES + 256];
+		switch(header.level) {
+			case CRITICAL:
+			case INFO:
+			case DEBUG: {
+				static const char* names[] = {"critical", "info", "debug"};
+				const int bytes = snprintf(line, sizeof(line), "[%s] %s() %s:%u ", names[header.level], header.function,
+				                           header.file, header.line);
+				append(line, size_t(bytes) < sizeof(line) ? size_t(bytes) : sizeof(line) - 1);
+				break;
+			}
+			default:
+				break;
+		}
+
+		size_t offset = sizeof(Header);
+		const char* fmt = header.format;
+		while(*fmt) {
+			const char* percent = strchr(fmt, '%');
+			if(percent == nullptr) {
+				append(fmt, strlen(fmt));
+				break;
+			}
+			append(fmt, size_t(percent - fmt));
+			fmt = percent + 1;
+			if(*fmt == '%') {
+				append("%", 1);
+				fmt++;
+				continue;
+			}
+
+			// the flags, the width and the precision, '*' takes an argument
+			char spec[64] = "%";
+			size_t spec_size = 1;
+			while(*fmt && strchr("-+ #0'123456789.*", *fmt) && spec_size < sizeof(spec) - 24) {
+				if(*fmt == '*') {
+					int64_t value = 0;
+					argument(record, offset, value);
+					spec_size += size_t(snprintf(spec + spec_size, sizeof(spec) - spec_size, "%d", int(value)));
+				} else {
+					spec[spec_size++] = *fmt;
+				}
+				fmt++;
+			}
+			unsigned halves = 0; // of "h" and "hh", the value is cut as printf() does
+			while(*fmt && strchr("hlLqjzt", *fmt)) {
+				halves += *fmt == 'h';
+				fmt++;
+			}
+			const char conversion = *fmt;
+			if(conversion == 0) {
+				break;
+			}
+			fmt++;
+			conversion_format(record, offset, spec, spec_size, conversion, halves, line, sizeof(line));
+		}
+
+		if(header.level != TEXT) {
+			append("\n", 1);
+		}
+	}
+
+	void conversion_format(const Record& record, size_t& offset, char* spec, size_t spec_size, char conversion,
+	                       unsigned halves, char* line, size_t line_bytes) noexcept {
+		Type type;
+		int64_t value = 0;
+		const char* string = nullptr;
+		uint16_t length = 0;
+		if(not argument(record, offset, value, &type, &string, &length)) {
+			append("%", 1);
+			append(&conversion, 1);
+			return;
+		}
+
+		int bytes = 0;
+		switch(conversion) {
+			case 'd':
+			case 'i':
+			case 'o':
+			case 'u':
+			case 'x':
+			case 'X':
+				if(type == STRING) {
+					append(string, length);
+					return;
+				}
+				if(type == DOUBLE) {
+					double number;
+					memcpy(&number, &value, sizeof(number));
+					value = int64_t(number);
+				}
+				if(halves) {
+					const bool is_signed = conversion == 'd' || conversion == 'i';
+					if(halves == 1) {
+						value = is_signed ? int64_t(int16_t(value)) : int64_t(uint16_t(value));
+					} else {
+						value = is_signed ? int64_t(int8_t(value)) : int64_t(uint8_t(value));
+					}
+				}
+				spec[spec_size++] = 'l';
+				spec[spec_size++] = 'l';
+				spec[spec_size++] = conversion;
+				spec[spec_size] = 0;
+				bytes = snprintf(line, line_bytes, spec, (long long)value);
+				break;
+
+			case 'c':
+				spec[spec_size++] = conversion;
+				spec[spec_size] = 0;
+				bytes = snprintf(line, line_bytes, spec, int(value));
+				break;
+
+			case 'e':
+			case 'E':
+			case 'f':
+			case 'F':
+			case 'g':
+			case 'G':
+			case 'a':
+			case 'A': {
+				double number;
+				if(type == DOUBLE) {
+					memcpy(&number, &value, sizeof(number));
+				} else if(type == INT) {
+					number = double(value);
+				} else {
+					number = double(uint64_t(value));
+				}
+				spec[spec_size++] = conversion;
+				spec[spec_size] = 0;
+				bytes = snprintf(line, line_bytes, spec, number);
+				break;
+			}
+
+			case 's':
+				spec[spec_size++] = conversion;
+				spec[spec_size] = 0;
+				if(type == STRING) {
+					char text[RECORD_BYTES];
+					memcpy(text, string, length);
+					text[length] = 0;
+					bytes = snprintf(line, line_bytes, spec, text);
+				} else {
+					bytes = snprintf(line, line_bytes, "%lld", (long long)value);
+				}
+				break;
+
+			case 'p':
+				bytes = snprintf(line, line_bytes, "%p", reinterpret_cast<const void*>(uintptr_t(value)));
+				break;
+
+			default: // 'n' and the unknown conversions
+				return;
+		}
+		if(bytes > 0) {
+			append(line, size_t(bytes) < line_bytes ? size_t(bytes) : line_bytes - 1);
+		}
+	}
+
+	/**
+	 * Take the next argument of the record at @offset, @value keeps the bits of a number.
+	 * @return false - if there are no more arguments.
+	 */
+	static bool argument(const Record& record, size_t& offset, int64_t& value, Type* type = nullptr,
+	                     const char** string = nullptr, uint16_t* length = nullptr) noexcept {
+		if(offset >= record.size)
+			return false;
+
+		const Type kind = Type(record.bytes[offset]);
+		if(type) {
+			*type = kind;
+		}
+		if(kind == STRING) {
+			uint16_t bytes;
+			memcpy(&bytes, record.bytes + offset + 1, sizeof(bytes));
+			if(string) {
+				*string = reinterpret_cast<const char*>(record.bytes + offset + 1 + sizeof(bytes));
+				*length = bytes;
+			}
+			value = 0;
+			offset += 1 + sizeof(bytes) + bytes;
+			return true;
+		}
+		memcpy(&value, record.bytes + offset + 1, sizeof(value));
+		offset += 1 + sizeof(value);
+		return true;
+	}
+
+	inline void append(const char* data, size_t bytes) noexcept {
+		if(BATCH_BYTES - m_batch_size < bytes) {
+			write_batch();
+		}
+		if(bytes > BATCH_BYTES) {
+			fwrite(data, 1, bytes, m_out);
+			m_bytes.fetch_add(bytes, std::memory_order_relaxed);
+			return;
+		}
+		memcpy(m_batch + m_batch_size, data, bytes);
+		m_batch_size += bytes;
+	}
+
+	inline void write_batch() noexcept {
+		if(m_batch_size) {
+			fwrite(m_batch, 1, m_batch_size, m_out);
+			m_bytes.fetch_add(m_batch_size, std::memory_order_relaxed);
+			m_batch_size = 0;
+		}
+	}
+
+};
+
+#endif /* ASYNC_LOGGER_H_ */
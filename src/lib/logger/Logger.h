@@ -3,6 +3,8 @@
 
 #include <stdio.h>
 
+#include "AsyncLogger.h"
+
 /*
  * size_t x = ...;
  * ssize_t y = ...;
@@ -12,25 +14,48 @@
  * 
  **/
 
-#define LOGC(...) {fprintf(Logger::log_file, __VA_ARGS__);}
-#define LOGNL {fprintf(Logger::log_file, "\n"); fflush(Logger::log_file);}
+/*
+ * The messages go to AsyncLogger while it is running (see AsyncLogger::start()), otherwise they are written
+ * to Logger::log_file as they are. The format must be a literal, AsyncLogger keeps its pointer.
+ * The levels above LOG_LEVEL are compiled out, e.g. -DLOG_LEVEL=LOG_LEVEL_CRITICAL.
+ **/
 
-#define LOG_RAW(...) {fprintf(Logger::log_file, __VA_ARGS__); fprintf(Logger::log_file, "\n");fflush(Logger::log_file);}
+#define LOG_LEVEL_CRITICAL 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_DEBUG 2
 
-#define LOG_INFO(...) { \
-    fprintf(Logger::log_file, "[info] %s() %s:%d ", __FUNCTION__, __FILE__, __LINE__); \
-    fprintf(Logger::log_file, __VA_ARGS__);\
-    fprintf(Logger::log_file, "\n");\
-    fflush(Logger::log_file); \
-}
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
 
-#define LOG_CRITICAL(...) { \
-    fprintf(Logger::log_file, "[critical] %s() %s:%d ", __FUNCTION__, __FILE__, __LINE__); \
+#define LOG_ASYNC(level, ...) AsyncLogger::instance().log(AsyncLogger::level, __FUNCTION__, __FILE__, __LINE__, __VA_ARGS__)
+
+#define LOG_SYNC(name, ...) { \
+    fprintf(Logger::log_file, "[" name "] %s() %s:%d ", __FUNCTION__, __FILE__, __LINE__); \
     fprintf(Logger::log_file, __VA_ARGS__);\
     fprintf(Logger::log_file, "\n");\
     fflush(Logger::log_file); \
 }
 
+#define LOGC(...) {if(not LOG_ASYNC(TEXT, __VA_ARGS__)) {fprintf(Logger::log_file, __VA_ARGS__);}}
+#define LOGNL {if(not LOG_ASYNC(TEXT, "\n")) {fprintf(Logger::log_file, "\n"); fflush(Logger::log_file);}}
+
+#define LOG_RAW(...) {if(not LOG_ASYNC(RAW, __VA_ARGS__)) {fprintf(Logger::log_file, __VA_ARGS__); fprintf(Logger::log_file, "\n");fflush(Logger::log_file);}}
+
+#define LOG_CRITICAL(...) {if(not LOG_ASYNC(CRITICAL, __VA_ARGS__)) LOG_SYNC("critical", __VA_ARGS__)}
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(...) {if(not LOG_ASYNC(INFO, __VA_ARGS__)) LOG_SYNC("info", __VA_ARGS__)}
+#else
+#define LOG_INFO(...) {}
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) {if(not LOG_ASYNC(DEBUG, __VA_ARGS__)) LOG_SYNC("debug", __VA_ARGS__)}
+#else
+#define LOG_DEBUG(...) {}
+#endif
+
 class Logger {
 public:
 	static FILE* log_file;
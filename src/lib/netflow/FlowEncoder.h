@@ -0,0 +1,382 @@
+#pragma once
+
+#include "../containers/storage/FlowRecord.h"
+#include "../utils/ByteOrder.h"
+
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+
+namespace netflow {
+
+enum class FlowFormat : uint16_t {
+	NETFLOW_V9 = 9, // RFC 3954
+	IPFIX = 10 // RFC 7011
+};
+
+/**
+ * FlowEncoder encodes storage::FlowRecord into the export datagrams of NetFlow v9 or IPFIX, a datagram is
+ * written into a buffer of the caller, there is no allocation.
+ * A bidirectional flow is exported as two data records, one per direction which has packets, by the template
+ * of its address family. The templates are sent in the first datagram and again in every template_every one,
+ * as a collector behind UDP may have lost them.
+ * The fields of a record are the addresses, the ports, the protocol, the OR of the TCP flags, the packets,
+ * the bytes, the times of the first and the last packet and (IPFIX only) flowEndReason. The times are
+ * flowStartMilliseconds/flowEndMilliseconds of IPFIX, NetFlow v9 has FIRST_SWITCHED/LAST_SWITCHED relative
+ * to the sysUpTime of the header, which counts here from the first datagram.
+ * The flow times are in the ticks of the clock of the table, they are turned into Unix milliseconds by @hz
+ * and @offset_ms, see offset_ms().
+ *
+ * Using sample:
+ * FlowEncoder encoder(FlowFormat::IPFIX, domain, table.clock().hz(), FlowEncoder::offset_ms(table.clock()));
+ * const storage::FlowRecord* next = records;
+ * while(next != records + n) {
+ *     const size_t bytes = encoder.encode(next, records + n, datagram, FlowEncoder::now_ms());
+ *     send(fd, datagram, bytes, 0);
+ * }
+ */
+class FlowEncoder {
+public:
+	static constexpr size_t MTU = 1400; // the datagram bytes by default, it fits the tunnels of 1500 bytes links
+	static constexpr unsigned TEMPLATE_EVERY = 20; // the datagrams
+	static constexpr uint16_t TEMPLATE_IPV4 = 256;
+	static constexpr uint16_t TEMPLATE_IPV6 = 257;
+
+	// flowEndReason of IPFIX
+	static constexpr uint8_t END_IDLE = 1;
+	static constexpr uint8_t END_ACTIVE = 2;
+	static constexpr uint8_t END_FORCED = 4;
+	static constexpr uint8_t END_RESOURCES = 5;
+
+private:
+	static constexpr unsigned FIELDS_MAX = 12;
+	static constexpr size_t HEADER_V9 = 20;
+	static constexpr size_t HEADER_IPFIX = 16;
+	static constexpr size_t SET_HEADER = 4;
+
+	// the information elements, the numbers are common to NetFlow v9 and IPFIX
+	enum Element : uint16_t {
+		OCTETS = 1,
+		PACKETS = 2,
+		PROTOCOL = 4,
+		TCP_FLAGS = 6,
+		SRC_PORT = 7,
+		SRC_IPV4 = 8,
+		DST_PORT = 11,
+		DST_IPV4 = 12,
+		LAST_SWITCHED = 21,
+		FIRST_SWITCHED = 22,
+		SRC_IPV6 = 27,
+		DST_IPV6 = 28,
+		END_REASON = 136,
+		START_MS = 152,
+		END_MS = 153
+	};
+
+	struct Field {
+		uint16_t id;
+		uint16_t length;
+	};
+
+	struct Template {
+		uint16_t id;
+		unsigned field_count;
+		Field fields[FIELDS_MAX];
+		size_t record_bytes;
+	};
+
+	const FlowFormat m_format;
+	const uint32_t m_domain;
+	const size_t m_mtu;
+	const unsigned m_template_every;
+	const uint64_t m_hz;
+	const int64_t m_offset_ms;
+	Template m_templates[2]; // IPv4 and IPv6
+	uint64_t m_boot_ms; // the sysUpTime origin of NetFlow v9, 0 - before the first datagram
+	uint32_t m_datagrams; // the sequence of NetFlow v9
+	uint32_t m_records; // the sequence of IPFIX
+
+public:
+
+	/**
+	 * @param domain - the observation domain (the source id of NetFlow v9).
+	 * @param hz - the ticks per second of the flow times.
+	 * @param offset_ms - the Unix milliseconds of the tick 0 of the flow times.
+	 * @param mtu - the datagram bytes, it must take the templates.
+	 */
+	FlowEncoder(FlowFormat format, uint32_t domain, uint64_t hz, int64_t offset_ms, size_t mtu = MTU,
+			unsigned template_every = TEMPLATE_EVERY) noexcept
+		: m_format(format)
+		, m_domain(domain)
+		, m_mtu(mtu)
+		, m_template_every(template_every ? template_every : 1)
+		, m_hz(hz ? hz : 1)
+		, m_offset_ms(offset_ms)
+		, m_templates()
+		, m_boot_ms(0)
+		, m_datagrams(0)
+		, m_records(0) {
+		build(m_templates[0], TEMPLATE_IPV4, SRC_IPV4, DST_IPV4, 4);
+		build(m_templates[1], TEMPLATE_IPV6, SRC_IPV6, DST_IPV6, 16);
+	}
+
+	/**
+	 * Encode the records from @records into one datagram, @records moves over the encoded ones.
+	 * @param datagram - mtu bytes.
+	 * @param now_ms - the Unix milliseconds of the export.
+	 * @return the datagram bytes, 0 - if there is nothing to send.
+	 */
+	inline size_t encode(const storage::FlowRecord*& records, const storage::FlowRecord* end, uint8_t* datagram,
+			uint64_t now_ms) noexcept {
+		const bool templates = m_datagrams % m_template_every == 0;
+		if(records == end && not templates) {
+			return 0;
+		}
+		return encode(records, end, datagram, now_ms, templates);
+	}
+
+	/**
+	 * Encode a datagram of the templates alone, e.g. when there have been no flows for a while.
+	 * @return the datagram bytes.
+	 */
+	inline size_t encode_templates(uint8_t* datagram, uint64_t now_ms) noexcept {
+		const storage::FlowRecord* none = nullptr;
+		return encode(none, none, datagram, now_ms, true);
+	}
+
+	inline FlowFormat format() const noexcept {
+		return m_format;
+	}
+
+	inline size_t mtu() const noexcept {
+		return m_mtu;
+	}
+
+	/**
+	 * @return the datagrams encoded.
+	 */
+	inline uint32_t datagrams() const noexcept {
+		return m_datagrams;
+	}
+
+	/**
+	 * @return the data records encoded.
+	 */
+	inline uint32_t records() const noexcept {
+		return m_records;
+	}
+
+	/**
+	 * @return the Unix milliseconds of the tick 0 of @clock, e.g. of the clock of a FlowTable.
+	 */
+	template<typename C>
+	static int64_t offset_ms(C& clock) noexcept {
+		return int64_t(now_ms()) - int64_t(to_ms(clock.now(), clock.hz()));
+	}
+
+	/**
+	 * @return CLOCK_REALTIME in milliseconds.
+	 */
+	static uint64_t now_ms() noexcept {
+		struct timespec ts;
+		clock_gettime(CLOCK_REALTIME, &ts);
+		return uint64_t(ts.tv_sec) * 1000 + uint64_t(ts.tv_nsec) / 1000000;
+	}
+
+	/**
+	 * @return the Unix milliseconds of the flow time @ticks.
+	 */
+	inline uint64_t unix_ms(uint64_t ticks) const noexcept {
+		return uint64_t(int64_t(to_ms(ticks, m_hz)) + m_offset_ms);
+	}
+
+private:
+
+	size_t encode(const storage::FlowRecord*& records, const storage::FlowRecord* end, uint8_t* datagram,
+			uint64_t now_ms, bool templates) noexcept {
+		if(m_boot_ms == 0) {
+			m_boot_ms = now_ms;
+		}
+		const size_t header_bytes = m_format == FlowFormat::IPFIX ? HEADER_IPFIX : HEADER_V9;
+		uint8_t* ptr = datagram + header_bytes;
+		unsigned count = 0; // the records of NetFlow v9, the templates included
+		if(templates) {
+			ptr = put_templates(ptr);
+			count += 2;
+		}
+
+		uint8_t* set = nullptr;
+		uint16_t set_id = 0;
+		unsigned data_records = 0;
+		for(; records != end; records++) {
+			const storage::FlowEntry& flow = records->flow;
+			const Template& tmpl = m_templates[flow.key.version == 6];
+			// a flow takes two records and two sets at most, it is not split between the datagrams
+			if(size_t(ptr - datagram) + 2 * (SET_HEADER + 3 + tmpl.record_bytes) > m_mtu) {
+				break;
+			}
+			if(set_id != tmpl.id) {
+				ptr = close_set(set, ptr);
+				set = ptr;
+				set_id = tmpl.id;
+				utils::ByteOrder::store_be16(set, set_id);
+				ptr += SET_HEADER;
+			}
+			if(flow.forward.packets) {
+				ptr = put_record(ptr, flow, flow.forward, false, records->reason);
+				data_records++;
+			}
+			if(flow.reverse.packets) {
+				ptr = put_record(ptr, flow, flow.reverse, true, records->reason);
+				data_records++;
+			}
+		}
+		ptr = close_set(set, ptr);
+		count += data_records;
+
+		const size_t bytes = size_t(ptr - datagram);
+		const uint32_t unix_secs = uint32_t(now_ms / 1000);
+		if(m_format == FlowFormat::IPFIX) {
+			utils::ByteOrder::store_be16(datagram, uint16_t(m_format));
+			utils::ByteOrder::store_be16(datagram + 2, uint16_t(bytes));
+			utils::ByteOrder::store_be32(datagram + 4, unix_secs);
+			utils::ByteOrder::store_be32(datagram + 8, m_records);
+			utils::ByteOrder::store_be32(datagram + 12, m_domain);
+		} else {
+			utils::ByteOrder::store_be16(datagram, uint16_t(m_format));
+			utils::ByteOrder::store_be16(datagram + 2, uint16_t(count));
+			utils::ByteOrder::store_be32(datagram + 4, uint32_t(now_ms - m_boot_ms));
+			utils::ByteOrder::store_be32(datagram + 8, unix_secs);
+			utils::ByteOrder::store_be32(datagram + 12, m_datagrams);
+			utils::ByteOrder::store_be32(datagram + 16, m_domain);
+		}
+		m_datagrams++;
+		m_records += data_records;
+		return bytes;
+	}
+
+	static inline uint64_t to_ms(uint64_t ticks, uint64_t hz) noexcept {
+		// the nanoseconds of the Unix time overflow ticks * 1000
+		return hz >= 1000 ? ticks / (hz / 1000) : ticks * 1000 / hz;
+	}
+
+	void build(Template& tmpl, uint16_t id, uint16_t src, uint16_t dst, uint16_t addr_bytes) noexcept {
+		tmpl.id = id;
+		tmpl.field_count = 0;
+		tmpl.record_bytes = 0;
+		add(tmpl, src, addr_bytes);
+		add(tmpl, dst, addr_bytes);
+		add(tmpl, SRC_PORT, 2);
+		add(tmpl, DST_PORT, 2);
+		add(tmpl, PROTOCOL, 1);
+		add(tmpl, TCP_FLAGS, 1);
+		add(tmpl, PACKETS, 8);
+		add(tmpl, OCTETS, 8);
+		if(m_format == FlowFormat::IPFIX) {
+			add(tmpl, START_MS, 8);
+			add(tmpl, END_MS, 8);
+			add(tmpl, END_REASON, 1);
+		} else {
+			add(tmpl, FIRST_SWITCHED, 4);
+			add(tmpl, LAST_SWITCHED, 4);
+		}
+	}
+
+	static inline void add(Template& tmpl, uint16_t id, uint16_t length) noexcept {
+		tmpl.fields[tmpl.field_count++] = Field{id, length};
+		tmpl.record_bytes += length;
+	}
+
+	/**
+	 * The template set (IPFIX) or FlowSet (NetFlow v9) of both templates.
+	 */
+	uint8_t* put_templates(uint8_t* ptr) noexcept {
+		uint8_t* set = ptr;
+		utils::ByteOrder::store_be16(ptr, m_format == FlowFormat::IPFIX ? 2 : 0);
+		ptr += SET_HEADER;
+		for(const Template& tmpl : m_templates) {
+			utils::ByteOrder::store_be16(ptr, tmpl.id);
+			utils::ByteOrder::store_be16(ptr + 2, uint16_t(tmpl.field_count));
+			ptr += 4;
+			for(unsigned i = 0; i < tmpl.field_count; i++) {
+				utils::ByteOrder::store_be16(ptr, tmpl.fields[i].id);
+				utils::ByteOrder::store_be16(ptr + 2, tmpl.fields[i].length);
+				ptr += 4;
+			}
+		}
+		utils::ByteOrder::store_be16(set + 2, uint16_t(ptr - set));
+		return ptr;
+	}
+
+	/**
+	 * Set the length of an open set, a FlowSet of NetFlow v9 is padded to 4 bytes, an empty set is dropped.
+	 * @return the end of the set.
+	 */
+	inline uint8_t* close_set(uint8_t* set, uint8_t* ptr) const noexcept {
+		if(set == nullptr) {
+			return ptr;
+		}
+		if(ptr == set + SET_HEADER) {
+			return set;
+		}
+		if(m_format == FlowFormat::NETFLOW_V9) {
+			while((ptr - set) & 3) {
+				*ptr++ = 0;
+			}
+		}
+		utils::ByteOrder::store_be16(set + 2, uint16_t(ptr - set));
+		return ptr;
+	}
+
+	/**
+	 * A data record in the field order of build(), @back - the record of the reverse direction.
+	 */
+	inline uint8_t* put_record(uint8_t* ptr, const storage::FlowEntry& flow, const storage::FlowCounters& counters,
+			bool back, storage::FlowEnd reason) noexcept {
+		const proto::FlowKey& key = flow.key;
+		const size_t addr_bytes = key.version == 6 ? 16 : 4;
+		memcpy(ptr, back ? &key.dst : &key.src, addr_bytes);
+		memcpy(ptr + addr_bytes, back ? &key.src : &key.dst, addr_bytes);
+		ptr += 2 * addr_bytes;
+		// the ports are in the network byte order already
+		utils::ByteOrder::store(ptr, back ? key.dst_port : key.src_port);
+		utils::ByteOrder::store(ptr + 2, back ? key.src_port : key.dst_port);
+		ptr[4] = key.protocol;
+		ptr[5] = counters.tcp_flags;
+		utils::ByteOrder::store_be64(ptr + 6, counters.packets);
+		utils::ByteOrder::store_be64(ptr + 14, counters.bytes);
+		ptr += 22;
+		if(m_format == FlowFormat::IPFIX) {
+			utils::ByteOrder::store_be64(ptr, unix_ms(flow.first));
+			utils::ByteOrder::store_be64(ptr + 8, unix_ms(flow.last));
+			ptr[16] = end_reason(reason);
+			ptr += 17;
+		} else {
+			utils::ByteOrder::store_be32(ptr, uptime_ms(flow.first));
+			utils::ByteOrder::store_be32(ptr + 4, uptime_ms(flow.last));
+			ptr += 8;
+		}
+		return ptr;
+	}
+
+	inline uint32_t uptime_ms(uint64_t ticks) const noexcept {
+		const uint64_t ms = unix_ms(ticks);
+		return ms > m_boot_ms ? uint32_t(ms - m_boot_ms) : 0;
+	}
+
+	static inline uint8_t end_reason(storage::FlowEnd reason) noexcept {
+		switch(reason) {
+			case storage::FlowEnd::IDLE:
+				return END_IDLE;
+			case storage::FlowEnd::ACTIVE:
+				return END_ACTIVE;
+			case storage::FlowEnd::EVICTED:
+				return END_RESOURCES;
+			default:
+				return END_FORCED;
+		}
+	}
+
+};
+
+}; // namespace netflow
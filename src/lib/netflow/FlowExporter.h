@@ -0,0 +1,363 @@
+#pragma once
+
+#include "FlowEncoder.h"
+#include "../utils/SpscByteRing.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <thread>
+
+#include <errno.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace netflow {
+
+struct FlowExporterStat {
+	uint64_t pushed; // the flow records taken from the packet threads
+	uint64_t dropped; // the flow records which haven't fit into the ring of their channel
+	uint64_t datagrams; // sent
+	uint64_t bytes; // of the sent datagrams
+	uint64_t batches; // sendmmsg() calls
+	uint64_t errors; // the datagrams which haven't been sent
+
+	FlowExporterStat() noexcept : pushed(0), dropped(0), datagrams(0), bytes(0), batches(0), errors(0) {}
+};
+
+/**
+ * FlowExporter takes the expired flows off the packet threads and exports them to a collector by its own
+ * thread, so the encoding and the system calls don't load the packet cores.
+ * Every packet thread pushes the records into its channel (a utils::SpscByteRing), a push is a copy of
+ * the batch into the ring and there is no lock, the records which don't fit are dropped and counted.
+ * The export thread gathers the records of all the channels, encodes them by FlowEncoder into a burst
+ * of preallocated datagrams and sends the burst by one sendmmsg() on a connected UDP socket.
+ * The thread sleeps IDLE_SLEEP_US when there is nothing to send, the templates are sent alone when nothing
+ * has been sent for TEMPLATE_REFRESH_MS, as a collector which has been restarted needs them.
+ *
+ * Using sample:
+ * FlowExporter exporter(FlowFormat::IPFIX, domain, clock.hz(), FlowEncoder::offset_ms(clock), workers);
+ * exporter.allocate();
+ * exporter.start(collector, sizeof(collector));
+ * FlowTable<FlowExporter::Sink> table(1 << 20, idle_ms, active_ms, exporter.sink(worker_id)); // per worker
+ * ...
+ * exporter.stop();
+ */
+class FlowExporter {
+public:
+	static constexpr unsigned CHANNELS_MAX = 64;
+	static constexpr size_t DEFAULT_RING_BYTES = size_t(1) << 20;
+	static constexpr size_t BURST = 32; // the datagrams per sendmmsg()
+	static constexpr size_t RECORDS = 256; // the records taken from a channel at once
+	static constexpr unsigned IDLE_SLEEP_US = 1000;
+	static constexpr uint64_t TEMPLATE_REFRESH_MS = 10000;
+
+private:
+	struct Channel {
+		utils::SpscByteRing ring;
+		std::atomic<uint64_t> pushed;
+		std::atomic<uint64_t> dropped;
+
+		Channel(size_t ring_bytes) noexcept : ring(ring_bytes), pushed(0), dropped(0) {}
+	};
+
+public:
+	/**
+	 * The exporter of a storage::FlowTable, it pushes the records into a channel.
+	 */
+	class Sink {
+		Channel* m_channel;
+
+	public:
+		Sink(Channel* channel = nullptr) noexcept : m_channel(channel) {}
+
+		/**
+		 * The producer side, the records are taken all or none.
+		 * @return false - if the records haven't fit into the ring.
+		 */
+		inline bool operator()(const storage::FlowRecord* records, size_t n) noexcept {
+			if(m_channel == nullptr) {
+				return false;
+			}
+			Channel& channel = *m_channel;
+			if(channel.ring.write(records, n * sizeof(storage::FlowRecord))) {
+				channel.pushed.store(channel.pushed.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+				return true;
+			}
+			channel.dropped.store(channel.dropped.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+			return false;
+		}
+	};
+
+private:
+	FlowEncoder m_encoder;
+	const unsigned m_channel_count;
+	const size_t m_ring_bytes;
+	Channel* m_channels[CHANNELS_MAX];
+	uint8_t* m_datagrams; // BURST of mtu bytes
+	struct mmsghdr m_messages[BURST];
+	struct iovec m_iov[BURST];
+	storage::FlowRecord m_records[RECORDS];
+	int m_fd;
+	bool m_own_fd;
+	std::thread m_thread;
+	std::atomic<bool> m_stop;
+	uint64_t m_sent_ms; // the last datagram
+
+	std::atomic<uint64_t> m_sent;
+	std::atomic<uint64_t> m_bytes;
+	std::atomic<uint64_t> m_batches;
+	std::atomic<uint64_t> m_errors;
+
+public:
+
+	/**
+	 * @param hz, offset_ms - the clock of the flow times, see FlowEncoder.
+	 * @param channels - amount of the packet threads, up to CHANNELS_MAX.
+	 * @param ring_bytes - the ring of a channel, it is rounded up to a power of two.
+	 */
+	FlowExporter(FlowFormat format, uint32_t domain, uint64_t hz, int64_t offset_ms, unsigned channels,
+			size_t ring_bytes = DEFAULT_RING_BYTES, size_t mtu = FlowEncoder::MTU,
+			unsigned template_every = FlowEncoder::TEMPLATE_EVERY) noexcept
+		: m_encoder(format, domain, hz, offset_ms, mtu, template_every)
+		, m_channel_count(channels < CHANNELS_MAX ? channels : CHANNELS_MAX)
+		, m_ring_bytes(ring_bytes)
+		, m_channels()
+		, m_datagrams(nullptr)
+		, m_messages()
+		, m_iov()
+		, m_records()
+		, m_fd(-1)
+		, m_own_fd(false)
+		, m_thread()
+		, m_stop(false)
+		, m_sent_ms(0)
+		, m_sent(0)
+		, m_bytes(0)
+		, m_batches(0)
+		, m_errors(0) {}
+
+	FlowExporter(const FlowExporter&) = delete;
+	FlowExporter& operator=(const FlowExporter&) = delete;
+
+	FlowExporter(FlowExporter&&) = delete;
+	FlowExporter& operator=(FlowExporter&&) = delete;
+
+	~FlowExporter() noexcept {
+		stop();
+		for(Channel*& channel : m_channels) {
+			delete channel;
+			channel = nullptr;
+		}
+		free(m_datagrams);
+	}
+
+	/**
+	 * @return 0 - if the rings and the datagrams have been allocated successfully.
+	 */
+	int allocate() noexcept {
+		if(m_datagrams)
+			return -1;
+
+		m_datagrams = static_cast<uint8_t*>(malloc(BURST * m_encoder.mtu()));
+		if(m_datagrams == nullptr)
+			return -1;
+
+		for(unsigned i = 0; i < m_channel_count; i++) {
+			m_channels[i] = new(std::nothrow) Channel(m_ring_bytes);
+			if(m_channels[i] == nullptr || m_channels[i]->ring.allocate())
+				return -1;
+		}
+		for(size_t i = 0; i < BURST; i++) {
+			m_iov[i].iov_base = m_datagrams + i * m_encoder.mtu();
+			m_messages[i].msg_hdr.msg_iov = &m_iov[i];
+			m_messages[i].msg_hdr.msg_iovlen = 1;
+		}
+		return 0;
+	}
+
+	/**
+	 * Connect a UDP socket to the collector and start the export thread.
+	 * @return 0 - if the thread has been started, -1 - errno keeps the error of the socket.
+	 */
+	int start(const struct sockaddr* collector, socklen_t length) {
+		if(m_thread.joinable() || m_datagrams == nullptr)
+			return -1;
+
+		const int fd = socket(collector->sa_family, SOCK_DGRAM, 0);
+		if(fd < 0)
+			return -1;
+
+		if(connect(fd, collector, length)) {
+			const int error = errno;
+			close(fd);
+			errno = error;
+			return -1;
+		}
+		m_own_fd = true;
+		return run_on(fd);
+	}
+
+	/**
+	 * Start the export thread on a connected datagram socket of the caller, it is not closed by the exporter.
+	 * @return 0 - if the thread has been started.
+	 */
+	int start(int fd) {
+		if(m_thread.joinable() || m_datagrams == nullptr || fd < 0)
+			return -1;
+
+		m_own_fd = false;
+		return run_on(fd);
+	}
+
+	/**
+	 * Export the records which are in the rings and stop the export thread.
+	 */
+	void stop() {
+		if(m_thread.joinable()) {
+			m_stop.store(true, std::memory_order_release);
+			m_thread.join();
+			if(m_own_fd) {
+				close(m_fd);
+			}
+			m_fd = -1;
+		}
+	}
+
+	/**
+	 * @return the producer of a packet thread, a channel takes a single thread.
+	 */
+	inline Sink sink(unsigned channel) noexcept {
+		return Sink(channel < m_channel_count ? m_channels[channel] : nullptr);
+	}
+
+	FlowExporterStat stat() const noexcept {
+		FlowExporterStat result;
+		for(unsigned i = 0; i < m_channel_count; i++) {
+			const Channel* channel = m_channels[i];
+			if(channel) {
+				result.pushed += channel->pushed.load(std::memory_order_relaxed);
+				result.dropped += channel->dropped.load(std::memory_order_relaxed);
+			}
+		}
+		result.datagrams = m_sent.load(std::memory_order_relaxed);
+		result.bytes = m_bytes.load(std::memory_order_relaxed);
+		result.batches = m_batches.load(std::memory_order_relaxed);
+		result.errors = m_errors.load(std::memory_order_relaxed);
+		return result;
+	}
+
+private:
+
+	int run_on(int fd) {
+		m_fd = fd;
+		m_stop.store(false);
+		m_thread = std::thread(&FlowExporter::run, this);
+		return 0;
+	}
+
+	void run() noexcept {
+		for(;;) {
+			const bool stop = m_stop.load(std::memory_order_acquire);
+			if(batch()) {
+				continue;
+			}
+			if(stop) {
+				break;
+			}
+			const uint64_t now_ms = FlowEncoder::now_ms();
+			if(now_ms - m_sent_ms >= TEMPLATE_REFRESH_MS) {
+				m_iov[0].iov_len = m_encoder.encode_templates(datagram(0), now_ms);
+				send(1);
+			}
+			std::this_thread::sleep_for(std::chrono::microseconds(unsigned(IDLE_SLEEP_US)));
+		}
+	}
+
+	/**
+	 * Export the records of all the channels.
+	 * @return amount of the exported records.
+	 */
+	size_t batch() noexcept {
+		size_t result = 0;
+		size_t datagram_count = 0;
+		const uint64_t now_ms = FlowEncoder::now_ms();
+		for(unsigned i = 0; i < m_channel_count; i++) {
+			utils::SpscByteRing& ring = m_channels[i]->ring;
+			for(;;) {
+				struct iovec iov[2];
+				int iov_count;
+				const size_t count = ring.peek(iov, iov_count) / sizeof(storage::FlowRecord);
+				if(count == 0) {
+					break;
+				}
+				const size_t taken = count < RECORDS ? count : RECORDS;
+				gather(iov, iov_count, m_records, taken * sizeof(storage::FlowRecord));
+				ring.consume(taken * sizeof(storage::FlowRecord));
+				result += taken;
+
+				const storage::FlowRecord* next = m_records;
+				while(next != m_records + taken) {
+					if(datagram_count == BURST) {
+						send(datagram_count);
+						datagram_count = 0;
+					}
+					const size_t bytes = m_encoder.encode(next, m_records + taken, datagram(datagram_count), now_ms);
+					m_iov[datagram_count++].iov_len = bytes;
+				}
+			}
+		}
+		send(datagram_count);
+		return result;
+	}
+
+	inline uint8_t* datagram(size_t index) noexcept {
+		return m_datagrams + index * m_encoder.mtu();
+	}
+
+	void send(size_t count) noexcept {
+		if(count) {
+			m_sent_ms = FlowEncoder::now_ms();
+		}
+		size_t first = 0;
+		while(first < count) {
+			const int sent = sendmmsg(m_fd, m_messages + first, unsigned(count - first), 0);
+			m_batches.fetch_add(1, std::memory_order_relaxed);
+			if(sent <= 0) {
+				if(sent < 0 && errno == EINTR) {
+					continue;
+				}
+				// the datagram which has failed is skipped, e.g. ECONNREFUSED of a collector which is down
+				m_errors.fetch_add(1, std::memory_order_relaxed);
+				first++;
+				continue;
+			}
+			size_t bytes = 0;
+			for(size_t i = first; i < first + size_t(sent); i++) {
+				bytes += m_messages[i].msg_len;
+			}
+			m_sent.fetch_add(unsigned(sent), std::memory_order_relaxed);
+			m_bytes.fetch_add(bytes, std::memory_order_relaxed);
+			first += size_t(sent);
+		}
+	}
+
+	/**
+	 * Copy @bytes of the peeked pieces of a ring.
+	 */
+	static inline void gather(const struct iovec* iov, int iov_count, void* data, size_t bytes) noexcept {
+		uint8_t* ptr = static_cast<uint8_t*>(data);
+		for(int i = 0; i < iov_count && bytes; i++) {
+			const size_t chunk = bytes < iov[i].iov_len ? bytes : iov[i].iov_len;
+			memcpy(ptr, iov[i].iov_base, chunk);
+			ptr += chunk;
+			bytes -= chunk;
+		}
+	}
+
+};
+
+}; // namespace netflow
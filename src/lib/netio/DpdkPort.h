@@ -0,0 +1,197 @@
+#pragma once
+
+#if defined(__has_include)
+#if __has_include(<rte_ethdev.h>)
+#define NETIO_DPDK_PORT 1
+#endif
+#endif
+
+#ifdef NETIO_DPDK_PORT
+
+#include "Port.h"
+#include "../containers/storage/Clock.h"
+#include "../proto/mframe/MFrame.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#include <rte_ethdev.h>
+#include <rte_mbuf.h>
+
+namespace netio {
+
+/**
+ * A queue of a DPDK port, the port is configured and started by the application (rte_eth_dev_configure(),
+ * rte_eth_rx_queue_setup(), rte_eth_tx_queue_setup(), rte_eth_dev_start()) and the class owns the bursts of
+ * a queue pair, so a queue is used by one lcore.
+ * The RoMFrame of a burst points into the data of its mbuf, which is freed by rx_release() or by
+ * the next rx_burst(), a frame is the first segment of its mbuf (the scattered RX is not supported).
+ * A TX frame is the buffer of an mbuf of @pool, the head is after the headroom of the mbuf, so an encapsulation
+ * is pushed by head_move_back().
+ * The timestamp of a burst is storage::TscClock, the same as rte_rdtsc().
+ * see Port.h for the interface.
+ *
+ * Using sample:
+ * netio::DpdkPort<> port(port_id, queue_id, pool);
+ * for(;;) {
+ *     const size_t n = port.rx_burst(frames, timestamps, BURST);
+ *     ...
+ *     port.rx_release();
+ * }
+ */
+template<typename C = storage::TscClock>
+class DpdkPort {
+public:
+	constexpr static uint16_t BURST_MAX = 256;
+
+private:
+	uint16_t m_port;
+	uint16_t m_queue;
+	struct rte_mempool* m_pool;
+	uint16_t m_rx_count; // the mbufs of the last burst
+	uint16_t m_tx_count; // the mbufs of the last tx_alloc()
+	PortStat m_stat;
+	C m_clock;
+	struct rte_mbuf* m_rx[BURST_MAX];
+	struct rte_mbuf* m_tx[BURST_MAX];
+
+public:
+
+	/**
+	 * @param pool - the mbufs of TX, e.g. the pool of the RX queue.
+	 */
+	DpdkPort(uint16_t port, uint16_t queue, struct rte_mempool* pool) noexcept
+		: m_port(port)
+		, m_queue(queue)
+		, m_pool(pool)
+		, m_rx_count(0)
+		, m_tx_count(0)
+		, m_stat()
+		, m_clock() {}
+
+	DpdkPort(const DpdkPort&) = delete;
+	DpdkPort(DpdkPort&&) = delete;
+	DpdkPort& operator=(const DpdkPort&) = delete;
+	DpdkPort& operator=(DpdkPort&&) = delete;
+
+	~DpdkPort() noexcept {
+		rx_release();
+		tx_free(0);
+	}
+
+	/**
+	 * Fill up to @n frames (BURST_MAX at most), the frames of the previous burst are released.
+	 * @return amount of the filled frames.
+	 */
+	size_t rx_burst(proto::RoMFrame* frames, uint64_t* timestamps, size_t n) noexcept {
+		rx_release();
+		const uint16_t count = rte_eth_rx_burst(m_port, m_queue, m_rx, uint16_t(std::min<size_t>(n, BURST_MAX)));
+		if(count == 0) {
+			return 0;
+		}
+		const uint64_t now = timestamps ? m_clock.now() : 0;
+		uint64_t bytes = 0;
+		for(uint16_t i = 0; i < count; i++) {
+			const struct rte_mbuf* mbuf = m_rx[i];
+			frames[i] = proto::RoMFrame(rte_pktmbuf_mtod(mbuf, const uint8_t*), rte_pktmbuf_data_len(mbuf));
+			bytes += rte_pktmbuf_data_len(mbuf);
+			if(timestamps) {
+				timestamps[i] = now;
+			}
+		}
+		m_rx_count = count;
+		m_stat.rx_packets += count;
+		m_stat.rx_bytes += bytes;
+		m_stat.rx_bursts++;
+		return count;
+	}
+
+	inline void rx_release() noexcept {
+		if(m_rx_count) {
+			rte_pktmbuf_free_bulk(m_rx, m_rx_count);
+			m_rx_count = 0;
+		}
+	}
+
+	/**
+	 * Take @n mbufs (BURST_MAX at most) of the pool, the mbufs of the previous call which have not been sent
+	 * are freed.
+	 * @return amount of the frames, 0 - if the pool has less mbufs than asked.
+	 */
+	size_t tx_alloc(proto::RwMFrame* frames, size_t n) noexcept {
+		tx_free(0);
+		const uint16_t count = uint16_t(std::min<size_t>(n, BURST_MAX));
+		if(count == 0 || rte_pktmbuf_alloc_bulk(m_pool, m_tx, count) != 0) {
+			m_stat.tx_no_buffer += count != 0;
+			return 0;
+		}
+		for(uint16_t i = 0; i < count; i++) {
+			struct rte_mbuf* mbuf = m_tx[i];
+			proto::RwMFrame& frame = frames[i];
+			frame = proto::RwMFrame(static_cast<uint8_t*>(mbuf->buf_addr), mbuf->buf_len);
+			frame.head_move(rte_pktmbuf_headroom(mbuf));
+			frame.tail_move_back(frame.available());
+		}
+		m_tx_count = count;
+		return count;
+	}
+
+	/**
+	 * Send the first @n frames of the last tx_alloc() in its order.
+	 * @return amount of the frames which have been taken by the TX queue, the rest of the mbufs are freed.
+	 */
+	size_t tx_burst(const proto::RwMFrame* frames, size_t n) noexcept {
+		const uint16_t count = uint16_t(std::min<size_t>(n, m_tx_count));
+		uint64_t bytes = 0;
+		for(uint16_t i = 0; i < count; i++) {
+			struct rte_mbuf* mbuf = m_tx[i];
+			const uint16_t length = uint16_t(frames[i].available());
+			mbuf->data_off = uint16_t(frames[i].head() - static_cast<uint8_t*>(mbuf->buf_addr));
+			mbuf->data_len = length;
+			mbuf->pkt_len = length;
+			bytes += length;
+		}
+		const uint16_t sent = count ? rte_eth_tx_burst(m_port, m_queue, m_tx, count) : 0;
+		for(uint16_t i = sent; i < count; i++) {
+			bytes -= rte_pktmbuf_data_len(m_tx[i]);
+		}
+		m_stat.tx_packets += sent;
+		m_stat.tx_bytes += bytes;
+		m_stat.tx_dropped += count - sent;
+		tx_free(sent);
+		return sent;
+	}
+
+	inline const PortStat& stat() const noexcept {
+		return m_stat;
+	}
+
+	inline C& clock() noexcept {
+		return m_clock;
+	}
+
+	inline uint16_t port() const noexcept {
+		return m_port;
+	}
+
+	inline uint16_t queue() const noexcept {
+		return m_queue;
+	}
+
+private:
+
+	/**
+	 * Free the mbufs of the last tx_alloc() from @first.
+	 */
+	inline void tx_free(uint16_t first) noexcept {
+		if(first < m_tx_count) {
+			rte_pktmbuf_free_bulk(m_tx + first, m_tx_count - first);
+		}
+		m_tx_count = 0;
+	}
+
+};
+
+}; // namespace netio
+
+#endif // NETIO_DPDK_PORT
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+
+namespace netio {
+
+/*
+ * The packet I/O of the kernel bypass, XdpSocket (AF_XDP) and DpdkPort (a queue of a DPDK port), share
+ * a burst interface, so a worker loop is written once over the port type:
+ *
+ * class Port {
+ *     // up to @n received frames, they point into the buffers of the port and are valid until rx_release(),
+ *     // a timestamp is a tick of the clock of the port (storage::TscClock by default), @timestamps may be nullptr
+ *     size_t rx_burst(proto::RoMFrame* frames, uint64_t* timestamps, size_t n) noexcept;
+ *     // hand the buffers of the last burst back to the port
+ *     void rx_release() noexcept;
+ *     // up to @n empty frames to fill: the head is after the headroom, nothing is available,
+ *     // the frame is grown by tail_move() and written from head()
+ *     size_t tx_alloc(proto::RwMFrame* frames, size_t n) noexcept;
+ *     // send [head, tail) of the first @n frames of the last tx_alloc(), the rest of them are freed
+ *     size_t tx_burst(const proto::RwMFrame* frames, size_t n) noexcept;
+ * };
+ *
+ * Using sample:
+ * proto::RoMFrame frames[BURST];
+ * uint64_t timestamps[BURST];
+ * for(;;) {
+ *     const size_t n = port.rx_burst(frames, timestamps, BURST);
+ *     for(size_t i = 0; i < n; i++) {
+ *         parser.parse(frames[i]);
+ *         ...
+ *     }
+ *     port.rx_release();
+ * }
+ */
+
+struct PortStat {
+	uint64_t rx_packets;
+	uint64_t rx_bytes;
+	uint64_t rx_bursts; // returned a frame at least
+	uint64_t tx_packets;
+	uint64_t tx_bytes;
+	uint64_t tx_dropped; // the TX ring was full, the frames have been freed
+	uint64_t tx_no_buffer; // tx_alloc() has returned less than asked
+
+	PortStat() noexcept
+		: rx_packets(0)
+		, rx_bytes(0)
+		, rx_bursts(0)
+		, tx_packets(0)
+		, tx_bytes(0)
+		, tx_dropped(0)
+		, tx_no_buffer(0) {}
+};
+
+}; // namespace netio
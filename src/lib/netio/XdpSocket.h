@@ -0,0 +1,581 @@
+#pragma once
+
+#include "Port.h"
+#include "../containers/storage/Clock.h"
+#include "../proto/mframe/MFrame.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <linux/if_xdp.h>
+#include <net/if.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifndef AF_XDP
+#define AF_XDP 44
+#endif
+
+#ifndef SOL_XDP
+#define SOL_XDP 283
+#endif
+
+#ifndef BPF_MAP_UPDATE_ELEM
+#define BPF_MAP_UPDATE_ELEM 2
+#endif
+
+namespace netio {
+
+/**
+ * The parameters of the UMEM and the rings of XdpSocket.
+ */
+struct XdpConfig {
+	uint32_t frame_bytes; // a power of two, 2048 or 4096
+	uint32_t frame_count; // of the UMEM, ring_size of them are for RX and the rest are for TX
+	uint32_t ring_size; // a power of two, of all the four rings
+	uint32_t headroom; // before the data of a frame, e.g. to push an encapsulation
+	bool zero_copy; // force XDP_ZEROCOPY, otherwise the driver decides and falls back to the copy mode
+	bool need_wakeup; // XDP_USE_NEED_WAKEUP, the kernel is kicked by a syscall only when it asks to
+
+	XdpConfig() noexcept
+		: frame_bytes(2048)
+		, frame_count(8192)
+		, ring_size(2048)
+		, headroom(0)
+		, zero_copy(false)
+		, need_wakeup(true) {}
+};
+
+/**
+ * A queue of an interface by an AF_XDP socket, the frames are received into and sent from a UMEM which
+ * is registered with the kernel, so the RoMFrame of a burst points into the UMEM and nothing is copied
+ * in the zero-copy mode of the driver (and once by the kernel in the copy mode).
+ * The four rings are single producer single consumer, so a socket is used by one thread, a thread per queue
+ * (the RSS of the NIC spreads the flows over the queues).
+ * The frames are redirected to the socket by an XDP program which calls bpf_redirect_map() on an XSKMAP
+ * (e.g. the default program of libxdp or xdp-loader), the program is loaded by the caller and the socket
+ * inserts itself into the map at the index of its queue when the map is given to open().
+ * The RX frames of a burst are given back to the fill ring by rx_release() or by the next rx_burst(),
+ * the TX frames return to the UMEM as the kernel completes them.
+ * see Port.h for the interface.
+ *
+ * Using sample:
+ * auto port = netio::XdpSocket<>::open("eth0", queue, xsks_map_fd);
+ * for(;;) {
+ *     const size_t n = port.rx_burst(frames, timestamps, BURST);
+ *     if(n == 0) {
+ *         port.wait(100);
+ *         continue;
+ *     }
+ *     ...
+ *     port.rx_release();
+ * }
+ */
+template<typename C = storage::TscClock>
+class XdpSocket {
+	/**
+	 * The part of a ring which is mapped from the kernel, and the cached indexes of the other side.
+	 */
+	struct Ring {
+		uint32_t* producer;
+		uint32_t* consumer;
+		uint32_t* flags;
+		void* entries;
+		uint32_t mask;
+		uint32_t cached_prod;
+		uint32_t cached_cons;
+		void* map;
+		size_t map_bytes;
+
+		Ring() noexcept
+			: producer(nullptr)
+			, consumer(nullptr)
+			, flags(nullptr)
+			, entries(nullptr)
+			, mask(0)
+			, cached_prod(0)
+			, cached_cons(0)
+			, map(nullptr)
+			, map_bytes(0) {}
+
+		template<typename T>
+		inline T& at(uint32_t idx) const noexcept {
+			return static_cast<T*>(entries)[idx & mask];
+		}
+
+		/**
+		 * The producer side, the fill ring and the TX ring.
+		 * @return the free entries up to @n.
+		 */
+		inline uint32_t free(uint32_t n) noexcept {
+			uint32_t result = mask + 1 - (cached_prod - cached_cons);
+			if(result < n) {
+				cached_cons = __atomic_load_n(consumer, __ATOMIC_ACQUIRE);
+				result = mask + 1 - (cached_prod - cached_cons);
+			}
+			return std::min(result, n);
+		}
+
+		inline void produce(uint32_t n) noexcept {
+			cached_prod += n;
+			__atomic_store_n(producer, cached_prod, __ATOMIC_RELEASE);
+		}
+
+		/**
+		 * The consumer side, the RX ring and the completion ring.
+		 * @return the ready entries up to @n.
+		 */
+		inline uint32_t ready(uint32_t n) noexcept {
+			uint32_t result = cached_prod - cached_cons;
+			if(result < n) {
+				cached_prod = __atomic_load_n(producer, __ATOMIC_ACQUIRE);
+				result = cached_prod - cached_cons;
+			}
+			return std::min(result, n);
+		}
+
+		inline void consume(uint32_t n) noexcept {
+			cached_cons += n;
+			__atomic_store_n(consumer, cached_cons, __ATOMIC_RELEASE);
+		}
+
+		inline bool need_wakeup() const noexcept {
+			return __atomic_load_n(flags, __ATOMIC_RELAXED) & XDP_RING_NEED_WAKEUP;
+		}
+	};
+
+	/**
+	 * The BPF_MAP_UPDATE_ELEM part of union bpf_attr, <linux/bpf.h> is not included as its struct bpf_insn
+	 * clashes with the one of <pcap.h>.
+	 */
+	struct MapUpdateAttr {
+		uint32_t map_fd;
+		uint64_t key __attribute__((aligned(8)));
+		uint64_t value;
+		uint64_t flags;
+	};
+
+	int m_fd;
+	uint8_t* m_umem;
+	size_t m_umem_bytes;
+	uint32_t m_frame_bytes;
+	uint32_t m_headroom;
+	bool m_need_wakeup;
+	Ring m_rx;
+	Ring m_tx;
+	Ring m_fill;
+	Ring m_comp;
+	std::vector<uint64_t> m_rx_addrs; // the RX frames which are not in the fill ring, [0, m_rx_held)
+	uint32_t m_rx_held;
+	uint32_t m_rx_burst; // the frames of the last burst
+	std::vector<uint64_t> m_free; // the TX frames
+	std::vector<uint64_t> m_tx_addrs; // the frames of the last tx_alloc(), [0, m_tx_count)
+	uint32_t m_tx_count;
+	PortStat m_stat;
+	C m_clock;
+
+	XdpSocket(int fd, uint8_t* umem, const XdpConfig& config) noexcept
+		: m_fd(fd)
+		, m_umem(umem)
+		, m_umem_bytes(size_t(config.frame_bytes) * config.frame_count)
+		, m_frame_bytes(config.frame_bytes)
+		, m_headroom(config.headroom)
+		, m_need_wakeup(config.need_wakeup)
+		, m_rx()
+		, m_tx()
+		, m_fill()
+		, m_comp()
+		, m_rx_addrs(config.ring_size)
+		, m_rx_held(0)
+		, m_rx_burst(0)
+		, m_free()
+		, m_tx_addrs(config.frame_count - config.ring_size)
+		, m_tx_count(0)
+		, m_stat()
+		, m_clock() {
+		m_free.reserve(config.frame_count - config.ring_size);
+	}
+
+public:
+	XdpSocket(const XdpSocket&) = delete;
+	XdpSocket& operator=(const XdpSocket&) = delete;
+
+	XdpSocket(XdpSocket&& rvalue) noexcept
+		: m_fd(rvalue.m_fd)
+		, m_umem(rvalue.m_umem)
+		, m_umem_bytes(rvalue.m_umem_bytes)
+		, m_frame_bytes(rvalue.m_frame_bytes)
+		, m_headroom(rvalue.m_headroom)
+		, m_need_wakeup(rvalue.m_need_wakeup)
+		, m_rx(rvalue.m_rx)
+		, m_tx(rvalue.m_tx)
+		, m_fill(rvalue.m_fill)
+		, m_comp(rvalue.m_comp)
+		, m_rx_addrs(std::move(rvalue.m_rx_addrs))
+		, m_rx_held(rvalue.m_rx_held)
+		, m_rx_burst(rvalue.m_rx_burst)
+		, m_free(std::move(rvalue.m_free))
+		, m_tx_addrs(std::move(rvalue.m_tx_addrs))
+		, m_tx_count(rvalue.m_tx_count)
+		, m_stat(rvalue.m_stat)
+		, m_clock(rvalue.m_clock) {
+		rvalue.clear();
+	}
+
+	XdpSocket& operator=(XdpSocket&& rvalue) noexcept {
+		if(this != &rvalue) {
+			close();
+			m_fd = rvalue.m_fd;
+			m_umem = rvalue.m_umem;
+			m_umem_bytes = rvalue.m_umem_bytes;
+			m_frame_bytes = rvalue.m_frame_bytes;
+			m_headroom = rvalue.m_headroom;
+			m_need_wakeup = rvalue.m_need_wakeup;
+			m_rx = rvalue.m_rx;
+			m_tx = rvalue.m_tx;
+			m_fill = rvalue.m_fill;
+			m_comp = rvalue.m_comp;
+			m_rx_addrs = std::move(rvalue.m_rx_addrs);
+			m_rx_held = rvalue.m_rx_held;
+			m_rx_burst = rvalue.m_rx_burst;
+			m_free = std::move(rvalue.m_free);
+			m_tx_addrs = std::move(rvalue.m_tx_addrs);
+			m_tx_count = rvalue.m_tx_count;
+			m_stat = rvalue.m_stat;
+			m_clock = rvalue.m_clock;
+			rvalue.clear();
+		}
+		return *this;
+	}
+
+	~XdpSocket() noexcept {
+		close();
+	}
+
+	inline void close() noexcept {
+		if(m_fd >= 0) {
+			for(Ring* ring : {&m_rx, &m_tx, &m_fill, &m_comp}) {
+				if(ring->map) {
+					munmap(ring->map, ring->map_bytes);
+				}
+			}
+			::close(m_fd);
+			munmap(m_umem, m_umem_bytes);
+			clear();
+		}
+	}
+
+	/**
+	 * Fill up to @n frames, the call doesn't block, see wait().
+	 * The frames of the previous burst are released if rx_release() has not been called.
+	 * @return amount of the filled frames.
+	 */
+	size_t rx_burst(proto::RoMFrame* frames, uint64_t* timestamps, size_t n) noexcept {
+		if(m_rx_burst) {
+			rx_release();
+		}
+		const uint32_t room = uint32_t(m_rx_addrs.size()) - m_rx_held;
+		const uint32_t count = m_rx.ready(uint32_t(std::min<size_t>(n, room)));
+		if(count == 0) {
+			if(m_need_wakeup && m_fill.need_wakeup()) {
+				recvfrom(m_fd, nullptr, 0, MSG_DONTWAIT, nullptr, nullptr);
+			}
+			return 0;
+		}
+		const uint64_t now = timestamps ? m_clock.now() : 0;
+		uint64_t bytes = 0;
+		for(uint32_t i = 0; i < count; i++) {
+			const struct xdp_desc& desc = m_rx.at<struct xdp_desc>(m_rx.cached_cons + i);
+			frames[i] = proto::RoMFrame(m_umem + desc.addr, desc.len);
+			m_rx_addrs[m_rx_held + i] = desc.addr & ~uint64_t(m_frame_bytes - 1); // the start of its frame
+			bytes += desc.len;
+			if(timestamps) {
+				timestamps[i] = now;
+			}
+		}
+		m_rx.consume(count);
+		m_rx_held += count;
+		m_rx_burst = count;
+		m_stat.rx_packets += count;
+		m_stat.rx_bytes += bytes;
+		m_stat.rx_bursts++;
+		return count;
+	}
+
+	/**
+	 * Give the frames of the last burst back to the fill ring, the ones which don't fit are kept for the next call.
+	 */
+	void rx_release() noexcept {
+		m_rx_burst = 0;
+		if(m_rx_held == 0) {
+			return;
+		}
+		const uint32_t count = m_fill.free(m_rx_held);
+		for(uint32_t i = 0; i < count; i++) {
+			m_fill.at<uint64_t>(m_fill.cached_prod + i) = m_rx_addrs[i];
+		}
+		m_fill.produce(count);
+		m_rx_held -= count;
+		if(m_rx_held) {
+			std::copy(m_rx_addrs.begin() + count, m_rx_addrs.begin() + count + m_rx_held, m_rx_addrs.begin());
+		}
+	}
+
+	/**
+	 * Take up to @n TX frames of the UMEM, the frames of the previous call which have not been sent are freed.
+	 * @return amount of the frames.
+	 */
+	size_t tx_alloc(proto::RwMFrame* frames, size_t n) noexcept {
+		tx_free(0);
+		complete();
+		const uint32_t count = uint32_t(std::min(n, m_free.size()));
+		for(uint32_t i = 0; i < count; i++) {
+			const uint64_t addr = m_free.back();
+			m_free.pop_back();
+			m_tx_addrs[i] = addr;
+			proto::RwMFrame& frame = frames[i];
+			frame = proto::RwMFrame(m_umem + addr, m_frame_bytes);
+			frame.head_move(m_headroom);
+			frame.tail_move_back(frame.available());
+		}
+		m_tx_count = count;
+		if(count < n) {
+			m_stat.tx_no_buffer++;
+		}
+		return count;
+	}
+
+	/**
+	 * Send the first @n frames of the last tx_alloc() in its order.
+	 * @return amount of the frames which have been put into the TX ring, the rest of the frames are freed.
+	 */
+	size_t tx_burst(const proto::RwMFrame* frames, size_t n) noexcept {
+		n = std::min<size_t>(n, m_tx_count);
+		const uint32_t count = m_tx.free(uint32_t(n));
+		uint64_t bytes = 0;
+		for(uint32_t i = 0; i < count; i++) {
+			struct xdp_desc& desc = m_tx.at<struct xdp_desc>(m_tx.cached_prod + i);
+			desc.addr = uint64_t(frames[i].head() - m_umem);
+			desc.len = uint32_t(frames[i].available());
+			desc.options = 0;
+			bytes += desc.len;
+		}
+		if(count) {
+			m_tx.produce(count);
+			if(not m_need_wakeup || m_tx.need_wakeup()) {
+				sendto(m_fd, nullptr, 0, MSG_DONTWAIT, nullptr, 0);
+			}
+		}
+		m_stat.tx_packets += count;
+		m_stat.tx_bytes += bytes;
+		m_stat.tx_dropped += n - count;
+		tx_free(count);
+		return count;
+	}
+
+	/**
+	 * Wait for the RX frames, e.g. after rx_burst() has returned 0.
+	 * @param timeout_ms - -1 - forever.
+	 * @return true - if there are the frames.
+	 */
+	bool wait(int timeout_ms) noexcept {
+		if(m_rx.ready(1)) {
+			return true;
+		}
+		struct pollfd pfd;
+		pfd.fd = m_fd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		return poll(&pfd, 1, timeout_ms) > 0 && m_rx.ready(1);
+	}
+
+	/**
+	 * @return the drops of the kernel: the RX ring has been full or the fill ring has been empty.
+	 */
+	bool kernel_stat(struct xdp_statistics& stats) const noexcept {
+		socklen_t length = sizeof(stats);
+		return getsockopt(m_fd, SOL_XDP, XDP_STATISTICS, &stats, &length) == 0;
+	}
+
+	inline const PortStat& stat() const noexcept {
+		return m_stat;
+	}
+
+	inline C& clock() noexcept {
+		return m_clock;
+	}
+
+	inline int fd() const noexcept {
+		return m_fd;
+	}
+
+	/**
+	 * Open the socket of @queue of @interface.
+	 * @param xsks_map_fd - the XSKMAP of the XDP program of the interface, -1 - the socket is inserted by the caller.
+	 */
+	static XdpSocket open(const std::string& interface, uint32_t queue, int xsks_map_fd = -1,
+			const XdpConfig& config = XdpConfig()) noexcept(false) {
+		const unsigned index = if_nametoindex(interface.c_str());
+		if(index == 0) {
+			throw std::runtime_error(interface + ": " + strerror(errno));
+		}
+		if(config.frame_count <= config.ring_size) {
+			throw std::runtime_error(interface + ": the UMEM has no TX frames");
+		}
+		const int fd = socket(AF_XDP, SOCK_RAW, 0);
+		if(fd < 0) {
+			throw std::runtime_error(interface + ": " + strerror(errno));
+		}
+		void* umem = mmap(nullptr, size_t(config.frame_bytes) * config.frame_count, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+		if(umem == MAP_FAILED) {
+			const int error = errno;
+			::close(fd);
+			throw std::runtime_error(interface + ": mmap: " + strerror(error));
+		}
+		XdpSocket result(fd, static_cast<uint8_t*>(umem), config);
+		result.setup(interface, index, queue, xsks_map_fd, config); // the socket is closed by the destructor on a throw
+		return result;
+	}
+
+private:
+
+	inline void clear() noexcept {
+		m_fd = -1;
+		m_umem = nullptr;
+		m_umem_bytes = 0;
+		m_rx = Ring();
+		m_tx = Ring();
+		m_fill = Ring();
+		m_comp = Ring();
+		m_rx_held = 0;
+		m_rx_burst = 0;
+		m_tx_count = 0;
+	}
+
+	static void fail(const std::string& interface, const char* what) noexcept(false) {
+		throw std::runtime_error(interface + ": " + what + ": " + strerror(errno));
+	}
+
+	bool map(Ring& ring, const struct xdp_ring_offset& offset, uint32_t size, size_t entry_bytes,
+			off_t pgoff) noexcept {
+		const size_t bytes = offset.desc + size * entry_bytes;
+		void* ptr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, pgoff);
+		if(ptr == MAP_FAILED) {
+			return false;
+		}
+		uint8_t* base = static_cast<uint8_t*>(ptr);
+		ring.map = ptr;
+		ring.map_bytes = bytes;
+		ring.producer = reinterpret_cast<uint32_t*>(base + offset.producer);
+		ring.consumer = reinterpret_cast<uint32_t*>(base + offset.consumer);
+		ring.flags = reinterpret_cast<uint32_t*>(base + offset.flags);
+		ring.entries = base + offset.desc;
+		ring.mask = size - 1;
+		// the indexes of the kernel side, the rings are empty
+		ring.cached_prod = __atomic_load_n(ring.producer, __ATOMIC_ACQUIRE);
+		ring.cached_cons = __atomic_load_n(ring.consumer, __ATOMIC_ACQUIRE);
+		return true;
+	}
+
+	void setup(const std::string& interface, unsigned index, uint32_t queue, int xsks_map_fd,
+			const XdpConfig& config) noexcept(false) {
+		struct xdp_umem_reg reg;
+		memset(&reg, 0, sizeof(reg));
+		reg.addr = uint64_t(reinterpret_cast<uintptr_t>(m_umem));
+		reg.len = m_umem_bytes;
+		reg.chunk_size = config.frame_bytes;
+		reg.headroom = config.headroom;
+		if(setsockopt(m_fd, SOL_XDP, XDP_UMEM_REG, &reg, sizeof(reg))) {
+			fail(interface, "XDP_UMEM_REG");
+		}
+
+		const int size = int(config.ring_size);
+		if(setsockopt(m_fd, SOL_XDP, XDP_UMEM_FILL_RING, &size, sizeof(size))
+				|| setsockopt(m_fd, SOL_XDP, XDP_UMEM_COMPLETION_RING, &size, sizeof(size))
+				|| setsockopt(m_fd, SOL_XDP, XDP_RX_RING, &size, sizeof(size))
+				|| setsockopt(m_fd, SOL_XDP, XDP_TX_RING, &size, sizeof(size))) {
+			fail(interface, "XDP rings");
+		}
+
+		struct xdp_mmap_offsets offsets;
+		socklen_t length = sizeof(offsets);
+		if(getsockopt(m_fd, SOL_XDP, XDP_MMAP_OFFSETS, &offsets, &length)) {
+			fail(interface, "XDP_MMAP_OFFSETS");
+		}
+		if(not map(m_rx, offsets.rx, config.ring_size, sizeof(struct xdp_desc), XDP_PGOFF_RX_RING)
+				|| not map(m_tx, offsets.tx, config.ring_size, sizeof(struct xdp_desc), XDP_PGOFF_TX_RING)
+				|| not map(m_fill, offsets.fr, config.ring_size, sizeof(uint64_t), XDP_UMEM_PGOFF_FILL_RING)
+				|| not map(m_comp, offsets.cr, config.ring_size, sizeof(uint64_t),
+					XDP_UMEM_PGOFF_COMPLETION_RING)) {
+			fail(interface, "mmap of XDP rings");
+		}
+
+		struct sockaddr_xdp addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sxdp_family = AF_XDP;
+		addr.sxdp_ifindex = index;
+		addr.sxdp_queue_id = queue;
+		addr.sxdp_flags = uint16_t((config.zero_copy ? XDP_ZEROCOPY : 0)
+			| (config.need_wakeup ? XDP_USE_NEED_WAKEUP : 0));
+		if(bind(m_fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr))) {
+			fail(interface, "bind");
+		}
+
+		if(xsks_map_fd >= 0) {
+			const int value = m_fd;
+			MapUpdateAttr attr;
+			memset(&attr, 0, sizeof(attr));
+			attr.map_fd = uint32_t(xsks_map_fd);
+			attr.key = uint64_t(reinterpret_cast<uintptr_t>(&queue));
+			attr.value = uint64_t(reinterpret_cast<uintptr_t>(&value));
+			attr.flags = 0; // BPF_ANY
+			if(syscall(__NR_bpf, BPF_MAP_UPDATE_ELEM, &attr, sizeof(attr))) {
+				fail(interface, "XSKMAP");
+			}
+		}
+
+		// the first ring_size frames are given to the kernel for RX, the rest are for TX
+		for(uint32_t i = 0; i < config.ring_size; i++) {
+			m_fill.at<uint64_t>(m_fill.cached_prod + i) = uint64_t(i) * m_frame_bytes;
+		}
+		m_fill.produce(config.ring_size);
+		for(uint32_t i = config.frame_count; i-- > config.ring_size;) {
+			m_free.push_back(uint64_t(i) * m_frame_bytes);
+		}
+	}
+
+	/**
+	 * Free the frames of the last tx_alloc() from @first.
+	 */
+	inline void tx_free(uint32_t first) noexcept {
+		for(uint32_t i = first; i < m_tx_count; i++) {
+			m_free.push_back(m_tx_addrs[i]);
+		}
+		m_tx_count = 0;
+	}
+
+	/**
+	 * Take the frames which the kernel has sent back.
+	 */
+	inline void complete() noexcept {
+		const uint32_t count = m_comp.ready(m_comp.mask + 1);
+		for(uint32_t i = 0; i < count; i++) {
+			m_free.push_back(m_comp.at<uint64_t>(m_comp.cached_cons + i) & ~uint64_t(m_frame_bytes - 1));
+		}
+		m_comp.consume(count);
+	}
+
+};
+
+}; // namespace netio
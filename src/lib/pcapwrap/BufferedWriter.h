@@ -0,0 +1,296 @@
+#pragma once
+
+#include "Frame.h"
+#include "../containers/storage/Clock.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace pcapwrap {
+
+/**
+ * A pcap-ns writer which assembles the records in a large aligned buffer and writes it by one write() call,
+ * libpcap and stdio are not used. The timestamps of the frames are in nanoseconds as Reader and MappedReader
+ * yield them, so they are written as they are.
+ * The buffer is flushed when it is full, when flush_ms have passed since the last flush (it is checked by every
+ * write call) and by close(). O_DIRECT writes only the whole ALIGN blocks, the tail is kept in the buffer till
+ * the next flush, close() writes it without O_DIRECT.
+ * A frame longer than the buffer less ALIGN is dropped.
+ */
+class BufferedWriter {
+public:
+	constexpr static uint32_t MAGIC_NSEC = 0xa1b23c4d;
+	constexpr static uint16_t SNAPSHOT_LEN = 0xFFFF;
+	constexpr static size_t ALIGN = 4096;
+	constexpr static size_t BUFFER_BYTES = size_t(4) << 20;
+	constexpr static size_t BUFFER_BYTES_MIN = size_t(512) << 10; // a buffer holds the longest record and an ALIGN tail
+
+private:
+	struct FileHeader {
+		uint32_t magic;
+		uint16_t version_major;
+		uint16_t version_minor;
+		int32_t thiszone;
+		uint32_t sigfigs;
+		uint32_t snaplen;
+		uint32_t linktype;
+	};
+
+	struct RecordHeader {
+		uint32_t ts_sec;
+		uint32_t ts_nsec;
+		uint32_t caplen;
+		uint32_t len;
+	};
+
+	int m_fd;
+	uint8_t* m_buffer;
+	size_t m_capacity;
+	size_t m_size;
+	uint64_t m_frame_idx;
+	uint64_t m_bytes; // written to the file
+	uint64_t m_flush_ns;
+	uint64_t m_flush_last;
+	int m_error;
+	bool m_direct;
+	storage::CoarseClock m_clock;
+
+	BufferedWriter(int fd, uint8_t* buffer, size_t capacity, uint64_t flush_ns, bool direct) noexcept
+		: m_fd(fd)
+		, m_buffer(buffer)
+		, m_capacity(capacity)
+		, m_size(0)
+		, m_frame_idx(0)
+		, m_bytes(0)
+		, m_flush_ns(flush_ns)
+		, m_flush_last(0)
+		, m_error(0)
+		, m_direct(direct)
+		, m_clock() {
+		m_flush_last = m_clock.now();
+	}
+
+public:
+	BufferedWriter(const BufferedWriter&) = delete;
+	BufferedWriter& operator=(const BufferedWriter&) = delete;
+
+	BufferedWriter(BufferedWriter&& rvalue) noexcept
+		: m_fd(rvalue.m_fd)
+		, m_buffer(rvalue.m_buffer)
+		, m_capacity(rvalue.m_capacity)
+		, m_size(rvalue.m_size)
+		, m_frame_idx(rvalue.m_frame_idx)
+		, m_bytes(rvalue.m_bytes)
+		, m_flush_ns(rvalue.m_flush_ns)
+		, m_flush_last(rvalue.m_flush_last)
+		, m_error(rvalue.m_error)
+		, m_direct(rvalue.m_direct)
+		, m_clock() {
+		rvalue.clear();
+	}
+
+	BufferedWriter& operator=(BufferedWriter&& rvalue) noexcept {
+		if(this != &rvalue) {
+			close();
+			m_fd = rvalue.m_fd;
+			m_buffer = rvalue.m_buffer;
+			m_capacity = rvalue.m_capacity;
+			m_size = rvalue.m_size;
+			m_frame_idx = rvalue.m_frame_idx;
+			m_bytes = rvalue.m_bytes;
+			m_flush_ns = rvalue.m_flush_ns;
+			m_flush_last = rvalue.m_flush_last;
+			m_error = rvalue.m_error;
+			m_direct = rvalue.m_direct;
+			rvalue.clear();
+		}
+		return *this;
+	}
+
+	~BufferedWriter() noexcept {
+		close();
+	}
+
+	/**
+	 * Flush the buffer and close the file.
+	 * @return 0 - if all the frames have been written.
+	 */
+	int close() noexcept {
+		int result = 0;
+		if(m_fd >= 0) {
+			if(m_direct && m_size) {
+				flush_blocks();
+				const int flags = fcntl(m_fd, F_GETFL);
+				if(flags < 0 || fcntl(m_fd, F_SETFL, flags & ~O_DIRECT) != 0) {
+					m_error = errno;
+				}
+				m_direct = false;
+			}
+			if(m_size) {
+				flush_blocks();
+			}
+			if(::close(m_fd) != 0 && m_error == 0) {
+				m_error = errno;
+			}
+			result = m_error ? -1 : 0;
+		}
+		if(m_buffer) {
+			free(m_buffer);
+		}
+		clear();
+		return result;
+	}
+
+	inline void write(const Frame& frame) noexcept {
+		append(frame);
+		flush_by_time();
+	}
+
+	void write_bulk(const Frame* frames, size_t n) noexcept {
+		for(size_t i = 0; i < n; i++) {
+			append(frames[i]);
+		}
+		flush_by_time();
+	}
+
+	/**
+	 * Write the buffer, with O_DIRECT the tail of less than ALIGN bytes stays in the buffer.
+	 * @return 0 - if the buffer has been written.
+	 */
+	inline int flush() noexcept {
+		flush_blocks();
+		m_flush_last = m_clock.now();
+		return m_error ? -1 : 0;
+	}
+
+	inline uint64_t frame_index() const noexcept {
+		return m_frame_idx;
+	}
+
+	/**
+	 * @return the bytes written to the file so far, the buffered ones are not counted.
+	 */
+	inline uint64_t bytes() const noexcept {
+		return m_bytes;
+	}
+
+	/**
+	 * @return errno of the first failed write or 0, the frames are dropped after a failure.
+	 */
+	inline int error() const noexcept {
+		return m_error;
+	}
+
+	/**
+	 * @param buffer_bytes - the buffer size, it is rounded up to ALIGN and BUFFER_BYTES_MIN.
+	 * @param flush_ms - the buffer is flushed after this time, 0 - when the buffer is full only.
+	 * @param direct - true to write with O_DIRECT bypassing the page cache.
+	 */
+	static BufferedWriter open(
+		const std::string& file_name,
+		size_t buffer_bytes = BUFFER_BYTES,
+		unsigned flush_ms = 0,
+		bool direct = false,
+		uint32_t linktype = DLT_EN10MB) noexcept(false) {
+
+		size_t capacity = buffer_bytes < BUFFER_BYTES_MIN ? BUFFER_BYTES_MIN : buffer_bytes;
+		capacity = (capacity + ALIGN - 1) & ~(ALIGN - 1);
+		void* buffer = nullptr;
+		if(posix_memalign(&buffer, ALIGN, capacity) != 0) {
+			throw std::runtime_error(file_name + ": the buffer can't be allocated");
+		}
+		const int fd = ::open(file_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC | (direct ? O_DIRECT : 0), 0644);
+		if(fd < 0) {
+			const int error = errno;
+			free(buffer);
+			throw std::runtime_error(file_name + ": " + strerror(error));
+		}
+
+		BufferedWriter result(fd, static_cast<uint8_t*>(buffer), capacity, uint64_t(flush_ms) * 1000000, direct);
+		FileHeader header;
+		header.magic = MAGIC_NSEC;
+		header.version_major = 2;
+		header.version_minor = 4;
+		header.thiszone = 0;
+		header.sigfigs = 0;
+		header.snaplen = SNAPSHOT_LEN;
+		header.linktype = linktype;
+		memcpy(result.m_buffer, &header, sizeof(header));
+		result.m_size = sizeof(header);
+		return result;
+	}
+
+private:
+
+	inline void append(const Frame& frame) noexcept {
+		const size_t record_bytes = sizeof(RecordHeader) + frame.m_hdr.caplen;
+		if(m_error || record_bytes > m_capacity - ALIGN) {
+			return;
+		}
+		if(m_capacity - m_size < record_bytes && flush() != 0) {
+			return;
+		}
+
+		RecordHeader record;
+		record.ts_sec = uint32_t(frame.m_hdr.ts.tv_sec);
+		record.ts_nsec = uint32_t(frame.m_hdr.ts.tv_usec);
+		record.caplen = frame.m_hdr.caplen;
+		record.len = frame.m_hdr.len;
+		memcpy(m_buffer + m_size, &record, sizeof(record));
+		memcpy(m_buffer + m_size + sizeof(record), frame.m_data, frame.m_hdr.caplen);
+		m_size += record_bytes;
+		m_frame_idx++;
+	}
+
+	inline void flush_by_time() noexcept {
+		if(m_flush_ns && m_clock.now() - m_flush_last >= m_flush_ns) {
+			flush();
+		}
+	}
+
+	/**
+	 * Write the buffer (the whole ALIGN blocks of it with O_DIRECT) and move the tail to the front.
+	 */
+	void flush_blocks() noexcept {
+		const size_t bytes = m_direct ? m_size & ~(ALIGN - 1) : m_size;
+		size_t written = 0;
+		while(m_error == 0 && written < bytes) {
+			const ssize_t result = ::write(m_fd, m_buffer + written, bytes - written);
+			if(result > 0) {
+				written += size_t(result);
+			} else if(result == 0) {
+				m_error = EIO;
+			} else if(errno != EINTR) {
+				m_error = errno;
+			}
+		}
+		m_bytes += written;
+		if(m_error) {
+			m_size = 0;
+			return;
+		}
+		m_size -= bytes;
+		if(m_size) {
+			memmove(m_buffer, m_buffer + bytes, m_size);
+		}
+	}
+
+	inline void clear() noexcept {
+		m_fd = -1;
+		m_buffer = nullptr;
+		m_capacity = 0;
+		m_size = 0;
+		m_frame_idx = 0;
+		m_bytes = 0;
+	}
+
+};
+
+}; // namespace pcapwrap
@@ -1,24 +1,223 @@
 #pragma once
 
 #include "Frame.h"
+#include "../proto/Dumper.h"
+#include "../proto/parsers/HeaderParser.h"
+#include "../utils/TextBuffer.h"
 
 #include <cstdio>
 
 namespace pcapwrap {
 
+/**
+ * The dumpers of the frames, the text is formatted by utils::TextBuffer and written by one fwrite() per frame.
+ * record() writes a frame by one line with the outer headers of the frame decoded, either as text
+ * (proto::Dumper::header_line()) or for the machines: CSV (the columns of csv_header()) or JSON lines.
+ *
+ * Using sample:
+ * pcapwrap::Dumper::csv_header(stdout);
+ * while(reader.next(frame)) {
+ *     pcapwrap::Dumper::record(stdout, frame, pcapwrap::Dumper::CSV);
+ * }
+ */
 class Dumper {
 public:
+	using Text = utils::TextBuffer;
+
+	enum Format {
+		TEXT,
+		CSV,
+		JSON
+	};
+
+	constexpr static size_t PAYLOAD_WIDTH = 16; // bytes per line of the payload of frame()
 
 	static void frame(FILE* out, const Frame& frame, bool payload = false) {
-		fprintf(out, "[%zu] %u / %u bytes", frame.m_idx, frame.m_hdr.len, frame.m_hdr.caplen);
-		fprintf(out, " epoc=%ld.%ld sec", frame.m_hdr.ts.tv_sec, frame.m_hdr.ts.tv_usec);
-		fprintf(out, "\n");
-		if(payload){
-			//TODO: hex dump here
+		Text& text = Text::local(out);
+		text.chr('[').dec(frame.m_idx).str("] ").dec(frame.m_hdr.len).str(" / ").dec(frame.m_hdr.caplen).str(" bytes");
+		text.str(" epoc=").sdec(frame.m_hdr.ts.tv_sec).chr('.').sdec(frame.m_hdr.ts.tv_usec).str(" sec");
+		text.chr('\n');
+		if(payload) {
+			for(size_t offset = 0; offset < frame.m_hdr.caplen; offset += PAYLOAD_WIDTH) {
+				const size_t bytes = frame.m_hdr.caplen - offset < PAYLOAD_WIDTH ? frame.m_hdr.caplen - offset : PAYLOAD_WIDTH;
+				text.str("  ").hex(offset, 4).str("  ").hex(frame.m_data + offset, bytes, ' ').chr('\n');
+			}
+		}
+		text.flush();
+	}
+
+	static void csv_header(FILE* out) noexcept {
+		Text::local(out)
+			.str("index,time,interface,length,caplen,eth_src,eth_dst,vlan,ip_src,ip_dst,ip_proto,port_src,port_dst,tcp_flags\n")
+			.flush();
+	}
+
+	/**
+	 * Write a frame by one line, the timestamp is in seconds with 9 digits of nanoseconds past the point.
+	 * The absent fields are empty in CSV and they are skipped in JSON.
+	 */
+	static void record(FILE* out, const Frame& frame, Format format = CSV) noexcept {
+		Text& text = Text::local(out);
+		if(format == TEXT) {
+			text.chr('[').dec(frame.m_idx).str("] ");
+			time(text, frame);
+			text.chr(' ').dec(frame.m_hdr.len).str(" / ").dec(frame.m_hdr.caplen).str(" bytes  ");
+		}
+
+		Headers headers;
+		proto::HeaderParser hp(frame.m_data, frame.m_hdr.caplen);
+		while(hp.protocol() != proto::END) {
+			headers.add(hp, text, format == TEXT);
+			hp.next();
+		}
+
+		switch(format) {
+			case TEXT:
+				break;
+			case CSV:
+				csv(text, frame, headers);
+				break;
+			case JSON:
+				json(text, frame, headers);
+				break;
+		}
+		text.chr('\n');
+		text.flush();
+	}
+
+private:
+
+	/**
+	 * The first header of every layer.
+	 */
+	struct Headers {
+		const proto::Ethernet::Header* eth;
+		const proto::Vlan::Header* vlan;
+		const proto::IPv4::Header* ipv4;
+		const proto::IPv6::Header* ipv6;
+		const proto::Tcp::Header* tcp;
+		const proto::Udp::Header* udp;
+
+		Headers() noexcept : eth(nullptr), vlan(nullptr), ipv4(nullptr), ipv6(nullptr), tcp(nullptr), udp(nullptr) {}
+
+		// @line - append the header to the text line
+		void add(proto::HeaderParser& hp, Text& text, bool line) noexcept {
+			switch(hp.protocol()) {
+				case proto::L2_ETHERNET:
+					set(hp, eth, text, line);
+					break;
+				case proto::L2_VLAN:
+					set(hp, vlan, text, line);
+					break;
+				case proto::L3_IPv4:
+					if(not ipv6) {
+						set(hp, ipv4, text, line);
+					}
+					break;
+				case proto::L3_IPv6:
+					if(not ipv4) {
+						set(hp, ipv6, text, line);
+					}
+					break;
+				case proto::L4_TCP:
+					if(not udp) {
+						set(hp, tcp, text, line);
+					}
+					break;
+				case proto::L4_UDP:
+					if(not tcp) {
+						set(hp, udp, text, line);
+					}
+					break;
+				default:
+					break;
+			}
+		}
+
+		template <typename H>
+		static inline void set(proto::HeaderParser& hp, const H*& hdr, Text& text, bool line) noexcept {
+			if(hdr == nullptr) {
+				hp.assign(hdr);
+				if(line) {
+					proto::Dumper::header_line(text, hdr);
+				}
+			}
+		}
+	};
+
+	static void time(Text& text, const Frame& frame) noexcept {
+		text.sdec(frame.m_hdr.ts.tv_sec).chr('.');
+		const uint64_t nsec = uint64_t(frame.m_hdr.ts.tv_usec);
+		for(uint64_t digit = 100000000; digit > 1 && nsec < digit; digit /= 10) {
+			text.chr('0');
+		}
+		text.dec(nsec);
+	}
+
+	static void csv(Text& text, const Frame& frame, const Headers& h) noexcept {
+		text.dec(frame.m_idx).chr(',');
+		time(text, frame);
+		text.chr(',').dec(frame.m_interface).chr(',').dec(frame.m_hdr.len).chr(',').dec(frame.m_hdr.caplen).chr(',');
+		if(h.eth) {
+			text.mac(h.eth->h_source).chr(',').mac(h.eth->h_dest).chr(',');
+		} else {
+			text.str(",,");
+		}
+		if(h.vlan) {
+			text.dec(vid(h.vlan));
+		}
+		text.chr(',');
+		if(h.ipv4) {
+			text.ipv4(ntohl(h.ipv4->saddr)).chr(',').ipv4(ntohl(h.ipv4->daddr)).chr(',').dec(h.ipv4->protocol);
+		} else if(h.ipv6) {
+			text.ipv6(&h.ipv6->src).chr(',').ipv6(&h.ipv6->dst).chr(',').dec(h.ipv6->next_header);
+		} else {
+			text.str(",,");
+		}
+		text.chr(',');
+		if(h.tcp) {
+			text.dec(ntohs(h.tcp->src)).chr(',').dec(ntohs(h.tcp->dst)).chr(',');
+			proto::Dumper::tcp_flags(text, h.tcp, '|');
+		} else if(h.udp) {
+			text.dec(ntohs(h.udp->source)).chr(',').dec(ntohs(h.udp->dest)).chr(',');
+		} else {
+			text.str(",,");
 		}
 	}
 
+	static void json(Text& text, const Frame& frame, const Headers& h) noexcept {
+		text.str("{\"index\":").dec(frame.m_idx).str(",\"time\":");
+		time(text, frame);
+		text.str(",\"interface\":").dec(frame.m_interface);
+		text.str(",\"length\":").dec(frame.m_hdr.len).str(",\"caplen\":").dec(frame.m_hdr.caplen);
+		if(h.eth) {
+			text.str(",\"eth_src\":\"").mac(h.eth->h_source).str("\",\"eth_dst\":\"").mac(h.eth->h_dest).chr('"');
+		}
+		if(h.vlan) {
+			text.str(",\"vlan\":").dec(vid(h.vlan));
+		}
+		if(h.ipv4) {
+			text.str(",\"ip_src\":\"").ipv4(ntohl(h.ipv4->saddr)).str("\",\"ip_dst\":\"").ipv4(ntohl(h.ipv4->daddr));
+			text.str("\",\"ip_proto\":").dec(h.ipv4->protocol);
+		} else if(h.ipv6) {
+			text.str(",\"ip_src\":\"").ipv6(&h.ipv6->src).str("\",\"ip_dst\":\"").ipv6(&h.ipv6->dst);
+			text.str("\",\"ip_proto\":").dec(h.ipv6->next_header);
+		}
+		if(h.tcp) {
+			text.str(",\"port_src\":").dec(ntohs(h.tcp->src)).str(",\"port_dst\":").dec(ntohs(h.tcp->dst));
+			text.str(",\"tcp_flags\":\"");
+			proto::Dumper::tcp_flags(text, h.tcp, ' ');
+			text.chr('"');
+		} else if(h.udp) {
+			text.str(",\"port_src\":").dec(ntohs(h.udp->source)).str(",\"port_dst\":").dec(ntohs(h.udp->dest));
+		}
+		text.chr('}');
+	}
+
+	static inline unsigned vid(const proto::Vlan::Header* hdr) noexcept {
+		return ntohs(hdr->vlan_tci) & 0x0FFFu;
+	}
+
 };
 
 }; // namespace pcapwrap
-
@@ -0,0 +1,171 @@
+#pragma once
+
+#include "Frame.h"
+#include "../proto/FlowKey.h"
+
+#include <exception>
+#include <stdexcept>
+#include <string>
+
+namespace pcapwrap {
+
+struct FilterStat {
+	uint64_t passed;
+	uint64_t filtered; // by the BPF program
+	uint64_t unsampled;
+
+	FilterStat() noexcept : passed(0), filtered(0), unsampled(0) {}
+};
+
+/**
+ * A filter of the frames of Reader and MappedReader, which is applied before a frame is handed out,
+ * so the skipped frames are never parsed.
+ * A frame passes a compiled BPF program (pcap_offline_filter()) first and then it is sampled 1 in @rate
+ * of the passed frames. The sampling is either systematic (every rate-th frame) or by the hash of the first
+ * HASH_BYTES of the frame, which selects the same frames of a capture in every run and at every point
+ * which sees the same bytes (e.g. both taps of a link), whatever the order of the frames is.
+ *
+ * Using sample:
+ * auto reader = pcapwrap::Reader::open(file);
+ * reader.filter().compile("tcp port 443", reader.linktype(), reader.snaplen());
+ * reader.filter().sample(1000, pcapwrap::Filter::HASH);
+ * while(reader.next(frame)) {
+ *     ...
+ */
+class Filter {
+public:
+	enum Sampling {
+		COUNT,
+		HASH
+	};
+
+	static constexpr size_t HASH_BYTES = 64;
+
+private:
+	struct bpf_program m_program;
+	bool m_compiled;
+	uint64_t m_rate;
+	uint64_t m_threshold; // of the hash by 2^32
+	uint64_t m_count;
+	uint32_t m_seed;
+	Sampling m_sampling;
+	FilterStat m_stat;
+
+public:
+
+	/**
+	 * A filter which passes all the frames.
+	 */
+	Filter() noexcept
+		: m_program(), m_compiled(false), m_rate(1), m_threshold(uint64_t(1) << 32), m_count(0), m_seed(0)
+		, m_sampling(COUNT), m_stat() {}
+
+	Filter(const Filter&) = delete;
+	Filter& operator=(const Filter&) = delete;
+
+	Filter(Filter&& rvalue) noexcept
+		: m_program(rvalue.m_program), m_compiled(rvalue.m_compiled), m_rate(rvalue.m_rate)
+		, m_threshold(rvalue.m_threshold), m_count(rvalue.m_count), m_seed(rvalue.m_seed)
+		, m_sampling(rvalue.m_sampling), m_stat(rvalue.m_stat) {
+		rvalue.m_compiled = false;
+	}
+
+	Filter& operator=(Filter&& rvalue) noexcept {
+		if(this != &rvalue) {
+			free();
+			m_program = rvalue.m_program;
+			m_compiled = rvalue.m_compiled;
+			m_rate = rvalue.m_rate;
+			m_threshold = rvalue.m_threshold;
+			m_count = rvalue.m_count;
+			m_seed = rvalue.m_seed;
+			m_sampling = rvalue.m_sampling;
+			m_stat = rvalue.m_stat;
+			rvalue.m_compiled = false;
+		}
+		return *this;
+	}
+
+	~Filter() noexcept {
+		free();
+	}
+
+	/**
+	 * Sample 1 in @rate frames, 1 - no sampling.
+	 * @param seed - selects another set of the frames by HASH.
+	 */
+	void sample(uint64_t rate, Sampling sampling = COUNT, uint32_t seed = 0) noexcept {
+		m_rate = rate > 0 ? rate : 1;
+		m_threshold = (uint64_t(1) << 32) / m_rate;
+		m_sampling = sampling;
+		m_seed = seed;
+		m_count = 0;
+	}
+
+	/**
+	 * Compile a BPF expression (see pcap-filter(7)) for the frames of @linktype, it replaces the previous one.
+	 */
+	void compile(const std::string& expression, int linktype, int snaplen) noexcept(false) {
+		pcap_t* pcap_handler = pcap_open_dead(linktype, snaplen);
+		if(pcap_handler == nullptr) {
+			throw std::runtime_error(expression + ": pcap_open_dead() has failed");
+		}
+		struct bpf_program program;
+		if(pcap_compile(pcap_handler, &program, expression.c_str(), 1, PCAP_NETMASK_UNKNOWN) != 0) {
+			std::string error = expression + ": " + pcap_geterr(pcap_handler);
+			pcap_close(pcap_handler);
+			throw std::runtime_error(error);
+		}
+		pcap_close(pcap_handler);
+		free();
+		m_program = program;
+		m_compiled = true;
+	}
+
+	/**
+	 * @return true - if the frame passes the filter.
+	 */
+	inline bool accept(const Frame& frame) noexcept {
+		if(m_compiled && not pcap_offline_filter(&m_program, &frame.m_hdr, frame.m_data)) {
+			m_stat.filtered++;
+			return false;
+		}
+		if(m_rate > 1 && not sampled(frame)) {
+			m_stat.unsampled++;
+			return false;
+		}
+		m_stat.passed++;
+		return true;
+	}
+
+	/**
+	 * @return false - if the filter passes all the frames.
+	 */
+	inline bool active() const noexcept {
+		return m_compiled || m_rate > 1;
+	}
+
+	inline const FilterStat& stat() const noexcept {
+		return m_stat;
+	}
+
+private:
+
+	inline bool sampled(const Frame& frame) noexcept {
+		if(m_sampling == COUNT) {
+			return m_count++ % m_rate == 0;
+		}
+		const size_t bytes = frame.m_hdr.caplen < HASH_BYTES ? frame.m_hdr.caplen : HASH_BYTES;
+		return proto::Crc32c::extend(~m_seed, frame.m_data, bytes) < m_threshold;
+	}
+
+	inline void free() noexcept {
+		if(m_compiled) {
+			pcap_freecode(&m_program);
+			m_compiled = false;
+		}
+	}
+
+};
+
+}; // namespace pcapwrap
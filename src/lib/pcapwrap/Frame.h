@@ -10,10 +10,13 @@ struct Frame {
 	struct pcap_pkthdr m_hdr;
 	const uint8_t* m_data;
 	uint64_t m_idx;
+	uint32_t m_interface; // the interface ID of pcapng, 0 - of pcap
+	uint32_t m_flags; // epb_flags of pcapng
 
-	Frame() noexcept : m_hdr(), m_data(nullptr), m_idx(0) {}
+	Frame() noexcept : m_hdr(), m_data(nullptr), m_idx(0), m_interface(0), m_flags(0) {}
 
-	Frame(const struct pcap_pkthdr& hdr, const uint8_t* data) noexcept : m_hdr(hdr), m_data(data), m_idx(0) {}
+	Frame(const struct pcap_pkthdr& hdr, const uint8_t* data) noexcept
+		: m_hdr(hdr), m_data(data), m_idx(0), m_interface(0), m_flags(0) {}
 
 	virtual ~Frame() noexcept {};
 
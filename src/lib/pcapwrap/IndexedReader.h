@@ -0,0 +1,123 @@
+#pragma once
+
+#include "MappedReader.h"
+#include "PcapIndex.h"
+
+#include <cstdint>
+#include <string>
+#include <utility>
+
+namespace pcapwrap {
+
+/**
+ * A MappedReader which seeks by the PcapIndex of its file, so a time range or a frame is read without
+ * reading the file from its start: seek_time() maps the range to the chunks which may have its frames
+ * and the reader goes through them only, the frames out of the range are skipped before they are handed
+ * out. The frames keep their indices of the whole file. Until a seek the whole file is read.
+ *
+ * Using sample (the frames of a minute):
+ * auto reader = pcapwrap::IndexedReader::open(file); // by PcapIndex::sidecar(file)
+ * reader.seek_time(begin_ns, begin_ns + 60 * uint64_t(1000000000));
+ * while((burst = reader.next_burst(frames, 32))) {
+ *     ...
+ * }
+ */
+class IndexedReader {
+	MappedReader m_reader;
+	PcapIndex m_index;
+	uint64_t m_begin_ns; // the time range of the frames
+	uint64_t m_end_ns;
+
+	IndexedReader(MappedReader&& reader, PcapIndex&& index) noexcept
+		: m_reader(std::move(reader)), m_index(std::move(index)), m_begin_ns(0), m_end_ns(UINT64_MAX) {}
+
+public:
+	IndexedReader(const IndexedReader&) = delete;
+	IndexedReader& operator=(const IndexedReader&) = delete;
+
+	IndexedReader(IndexedReader&&) noexcept = default;
+	IndexedReader& operator=(IndexedReader&&) noexcept = default;
+
+	/**
+	 * Read the frames of [begin_ns, end_ns) from now on.
+	 * @return false - if no chunk may have them, nothing is read then.
+	 */
+	bool seek_time(uint64_t begin_ns, uint64_t end_ns = UINT64_MAX) noexcept {
+		m_begin_ns = begin_ns;
+		m_end_ns = end_ns;
+		const size_t first = m_index.find_time(begin_ns);
+		const size_t last = m_index.find_time_end(end_ns);
+		if(begin_ns >= end_ns || first == m_index.size() || last == m_index.size() || last < first) {
+			m_reader.seek(m_reader.bytes(), m_reader.bytes(), m_index.frames());
+			return false;
+		}
+		return m_reader.seek(m_index[first].offset, m_index.end_offset(last), m_index[first].frame_idx);
+	}
+
+	/**
+	 * Read from the frame @frame_idx (Frame::m_idx, from 1) to the end of the file, the time range is reset.
+	 * @return false - if there is no such frame, nothing is read then.
+	 */
+	bool seek_frame(uint64_t frame_idx) noexcept {
+		m_begin_ns = 0;
+		m_end_ns = UINT64_MAX;
+		const size_t chunk = m_index.find_frame(frame_idx);
+		if(chunk == m_index.size()) {
+			m_reader.seek(m_reader.bytes(), m_reader.bytes(), m_index.frames());
+			return false;
+		}
+		const PcapIndexEntry& entry = m_index[chunk];
+		const uint64_t skipped = frame_idx - 1 - entry.frame_idx;
+		return m_reader.seek(entry.offset, m_reader.bytes(), entry.frame_idx) && m_reader.skip(skipped) == skipped;
+	}
+
+	/**
+	 * Fill up to @n frames of the time range which pass the filter.
+	 * @return amount of the filled frames, 0 - at the end of the range, the file or at a broken record.
+	 */
+	size_t next_burst(Frame* frames, size_t n) noexcept {
+		size_t burst;
+		while((burst = m_reader.next_burst(frames, n))) {
+			if(m_begin_ns == 0 && m_end_ns == UINT64_MAX) {
+				return burst;
+			}
+			size_t result = 0;
+			for(size_t i = 0; i < burst; i++) {
+				const uint64_t ns = frames[i].nanosec();
+				if(ns >= m_begin_ns && ns < m_end_ns) {
+					frames[result++] = frames[i];
+				}
+			}
+			if(result) {
+				return result;
+			}
+		}
+		return 0;
+	}
+
+	inline bool next(Frame& frame) noexcept {
+		return next_burst(&frame, 1) == 1;
+	}
+
+	/**
+	 * @return the reader of the file, e.g. for its filter.
+	 */
+	inline MappedReader& reader() noexcept {
+		return m_reader;
+	}
+
+	inline const PcapIndex& index() const noexcept {
+		return m_index;
+	}
+
+	/**
+	 * @param index_file - empty - PcapIndex::sidecar(pcap_file).
+	 */
+	static IndexedReader open(const std::string& pcap_file, const std::string& index_file = std::string()) noexcept(false) {
+		MappedReader reader = MappedReader::open(pcap_file);
+		PcapIndex index = PcapIndex::load(index_file.empty() ? PcapIndex::sidecar(pcap_file) : index_file, reader.bytes());
+		return IndexedReader(std::move(reader), std::move(index));
+	}
+};
+
+}; // namespace pcapwrap
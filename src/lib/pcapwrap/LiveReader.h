@@ -0,0 +1,412 @@
+#pragma once
+
+#include "Frame.h"
+#include "Filter.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include <arpa/inet.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#include <net/if.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace pcapwrap {
+
+struct LiveReaderStat {
+	uint64_t packets; // received by the kernel for the socket
+	uint64_t drops; // by the kernel, the ring was full
+	uint64_t freezes; // the ring has been frozen as full
+	uint64_t blocks; // retired to the kernel
+
+	LiveReaderStat() noexcept : packets(0), drops(0), freezes(0), blocks(0) {}
+};
+
+/**
+ * The parameters of the ring of LiveReader.
+ */
+struct LiveConfig {
+	uint32_t block_bytes; // a power of two multiple of the page size
+	uint32_t block_count;
+	uint32_t frame_bytes; // the frame size hint of TPACKET_V3, the frames are packed into the blocks
+	uint32_t timeout_ms; // a block which is not full is retired after it, 0 - by the kernel
+	uint16_t fanout_group; // the sockets of the group share the traffic, 0 - no fanout
+	uint16_t fanout_mode; // e.g. PACKET_FANOUT_HASH or PACKET_FANOUT_CPU
+	bool promiscuous;
+	bool restore_vlan; // put the VLAN tag which the NIC has stripped back into the frame
+
+	LiveConfig() noexcept
+		: block_bytes(uint32_t(1) << 22)
+		, block_count(64)
+		, frame_bytes(2048)
+		, timeout_ms(10)
+		, fanout_group(0)
+		, fanout_mode(PACKET_FANOUT_HASH)
+		, promiscuous(true)
+		, restore_vlan(true) {}
+};
+
+/**
+ * A live capture of an interface by an AF_PACKET socket of TPACKET_V3: the kernel writes the frames into
+ * the blocks of a ring which is mapped into the process, so MappedReader style the frames of a burst point
+ * into the ring and nothing is copied.
+ * A block is handed back to the kernel by the next next_burst() after all its frames have been read,
+ * so the frames of a burst are valid until the next call and a burst never crosses a block.
+ * The threads of a fanout group (their readers are open with the same fanout_group) share the traffic
+ * of the interface, PACKET_FANOUT_HASH keeps both directions of a flow on the same reader, which fits
+ * a table per thread (e.g. storage::FlowTable).
+ * The NIC may strip the VLAN tag (rx VLAN offload), the tag is put back in place (there is a reserved
+ * headroom of a tag before every frame) unless restore_vlan is unset, so HeaderParser sees the frame
+ * as it has been on the wire. The frames which don't pass filter() are skipped before they are handed out,
+ * a timestamp is in nanoseconds as MappedReader does.
+ *
+ * Using sample:
+ * LiveConfig config;
+ * config.fanout_group = 7; // the same for all the threads
+ * auto reader = pcapwrap::LiveReader::open("eth0", config);
+ * for(;;) {
+ *     const size_t n = reader.next_burst(frames, BURST);
+ *     if(n == 0) {
+ *         reader.wait(100);
+ *         continue;
+ *     }
+ *     ...
+ */
+class LiveReader {
+public:
+	constexpr static uint32_t LINKTYPE_ETHERNET = 1; // DLT_EN10MB
+	constexpr static uint32_t VLAN_TAG_BYTES = 4;
+
+private:
+	constexpr static uint32_t MAC_BYTES = 2 * ETH_ALEN;
+
+	int m_fd;
+	uint8_t* m_ring;
+	size_t m_ring_bytes;
+	uint32_t m_block_bytes;
+	uint32_t m_block_count;
+	uint32_t m_block; // the current block
+	uint32_t m_left; // the frames left in the current block, 0 - the block is not taken
+	const struct tpacket3_hdr* m_next; // the next frame of the current block
+	bool m_release; // the current block has been read to the end, it is retired by the next call
+	bool m_restore_vlan;
+	uint32_t m_snaplen;
+	uint64_t m_frame_idx;
+	LiveReaderStat m_stat;
+	Filter m_filter;
+
+	LiveReader(int fd, uint8_t* ring, const LiveConfig& config) noexcept
+		: m_fd(fd)
+		, m_ring(ring)
+		, m_ring_bytes(size_t(config.block_bytes) * config.block_count)
+		, m_block_bytes(config.block_bytes)
+		, m_block_count(config.block_count)
+		, m_block(0)
+		, m_left(0)
+		, m_next(nullptr)
+		, m_release(false)
+		, m_restore_vlan(config.restore_vlan)
+		, m_snaplen(config.block_bytes)
+		, m_frame_idx(0)
+		, m_stat()
+		, m_filter() {}
+
+public:
+	LiveReader(const LiveReader&) = delete;
+	LiveReader& operator=(const LiveReader&) = delete;
+
+	LiveReader(LiveReader&& rvalue) noexcept
+		: m_fd(rvalue.m_fd)
+		, m_ring(rvalue.m_ring)
+		, m_ring_bytes(rvalue.m_ring_bytes)
+		, m_block_bytes(rvalue.m_block_bytes)
+		, m_block_count(rvalue.m_block_count)
+		, m_block(rvalue.m_block)
+		, m_left(rvalue.m_left)
+		, m_next(rvalue.m_next)
+		, m_release(rvalue.m_release)
+		, m_restore_vlan(rvalue.m_restore_vlan)
+		, m_snaplen(rvalue.m_snaplen)
+		, m_frame_idx(rvalue.m_frame_idx)
+		, m_stat(rvalue.m_stat)
+		, m_filter(std::move(rvalue.m_filter)) {
+		rvalue.clear();
+	}
+
+	LiveReader& operator=(LiveReader&& rvalue) noexcept {
+		if(this != &rvalue) {
+			close();
+			m_fd = rvalue.m_fd;
+			m_ring = rvalue.m_ring;
+			m_ring_bytes = rvalue.m_ring_bytes;
+			m_block_bytes = rvalue.m_block_bytes;
+			m_block_count = rvalue.m_block_count;
+			m_block = rvalue.m_block;
+			m_left = rvalue.m_left;
+			m_next = rvalue.m_next;
+			m_release = rvalue.m_release;
+			m_restore_vlan = rvalue.m_restore_vlan;
+			m_snaplen = rvalue.m_snaplen;
+			m_frame_idx = rvalue.m_frame_idx;
+			m_stat = rvalue.m_stat;
+			m_filter = std::move(rvalue.m_filter);
+			rvalue.clear();
+		}
+		return *this;
+	}
+
+	~LiveReader() noexcept {
+		close();
+	}
+
+	inline void close() noexcept {
+		if(m_fd >= 0) {
+			munmap(m_ring, m_ring_bytes);
+			::close(m_fd);
+			clear();
+		}
+	}
+
+	/**
+	 * Fill up to @n frames of the current block, the call doesn't block, see wait().
+	 * @return amount of the filled frames, 0 - if no block is ready.
+	 */
+	size_t next_burst(Frame* frames, size_t n) noexcept {
+		if(m_release) {
+			retire();
+		}
+		if(m_left == 0 && not take()) {
+			return 0;
+		}
+		size_t result = 0;
+		while(result < n && m_left) {
+			const struct tpacket3_hdr* hdr = m_next;
+			m_left--;
+			m_next = reinterpret_cast<const struct tpacket3_hdr*>(reinterpret_cast<const uint8_t*>(hdr)
+				+ hdr->tp_next_offset);
+
+			Frame& frame = frames[result++];
+			frame.m_hdr.ts.tv_sec = hdr->tp_sec;
+			frame.m_hdr.ts.tv_usec = hdr->tp_nsec;
+			frame.m_hdr.caplen = hdr->tp_snaplen;
+			frame.m_hdr.len = hdr->tp_len;
+			frame.m_data = reinterpret_cast<const uint8_t*>(hdr) + hdr->tp_mac;
+			if(m_restore_vlan && (hdr->tp_status & TP_STATUS_VLAN_VALID) && hdr->tp_mac >= VLAN_TAG_BYTES
+					&& hdr->tp_snaplen >= MAC_BYTES) {
+				frame.m_data = restore_vlan(hdr);
+				frame.m_hdr.caplen += VLAN_TAG_BYTES;
+				frame.m_hdr.len += VLAN_TAG_BYTES;
+			}
+			m_frame_idx++;
+			frame.m_idx = m_frame_idx;
+			if(not m_filter.accept(frame)) {
+				result--;
+			}
+		}
+		m_release = m_left == 0;
+		return result;
+	}
+
+	inline bool next(Frame& frame) noexcept {
+		return next_burst(&frame, 1) == 1;
+	}
+
+	/**
+	 * Wait for a block of the kernel, e.g. after next_burst() has returned 0.
+	 * @param timeout_ms - -1 - forever.
+	 * @return true - if a block is ready.
+	 */
+	bool wait(int timeout_ms) noexcept {
+		if(m_left || ready()) {
+			return true;
+		}
+		struct pollfd pfd;
+		pfd.fd = m_fd;
+		pfd.events = POLLIN | POLLERR;
+		pfd.revents = 0;
+		return poll(&pfd, 1, timeout_ms) > 0 && ready();
+	}
+
+	/**
+	 * @return the counters of the kernel since the previous call are added to the totals.
+	 */
+	const LiveReaderStat& stat() noexcept {
+		struct tpacket_stats_v3 stats;
+		socklen_t length = sizeof(stats);
+		if(m_fd >= 0 && getsockopt(m_fd, SOL_PACKET, PACKET_STATISTICS, &stats, &length) == 0) {
+			m_stat.packets += stats.tp_packets;
+			m_stat.drops += stats.tp_drops;
+			m_stat.freezes += stats.tp_freeze_q_cnt;
+		}
+		return m_stat;
+	}
+
+	inline uint64_t frame_index() const noexcept {
+		return m_frame_idx;
+	}
+
+	inline uint32_t snaplen() const noexcept {
+		return m_snaplen;
+	}
+
+	inline uint32_t linktype() const noexcept {
+		return LINKTYPE_ETHERNET;
+	}
+
+	/**
+	 * @return the filter of the frames, it passes all of them until it is set up.
+	 */
+	inline Filter& filter() noexcept {
+		return m_filter;
+	}
+
+	inline int fd() const noexcept {
+		return m_fd;
+	}
+
+	/**
+	 * Open the capture of @interface, "any" is not supported as it is not Ethernet.
+	 */
+	static LiveReader open(const std::string& interface, const LiveConfig& config = LiveConfig()) noexcept(false) {
+		const unsigned index = if_nametoindex(interface.c_str());
+		if(index == 0) {
+			throw std::runtime_error(interface + ": " + strerror(errno));
+		}
+		const int fd = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
+		if(fd < 0) {
+			throw std::runtime_error(interface + ": " + strerror(errno));
+		}
+
+		const int version = TPACKET_V3;
+		const unsigned reserve = VLAN_TAG_BYTES;
+		struct tpacket_req3 req;
+		memset(&req, 0, sizeof(req));
+		req.tp_block_size = config.block_bytes;
+		req.tp_block_nr = config.block_count;
+		req.tp_frame_size = config.frame_bytes;
+		req.tp_frame_nr = uint32_t(uint64_t(config.block_bytes) * config.block_count / config.frame_bytes);
+		req.tp_retire_blk_tov = config.timeout_ms;
+		req.tp_feature_req_word = TP_FT_REQ_FILL_RXHASH;
+		if(setsockopt(fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version))
+				|| setsockopt(fd, SOL_PACKET, PACKET_RESERVE, &reserve, sizeof(reserve))
+				|| setsockopt(fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req))) {
+			fail(fd, interface, "PACKET_RX_RING");
+		}
+
+		const size_t ring_bytes = size_t(config.block_bytes) * config.block_count;
+		void* ring = mmap(nullptr, ring_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+		if(ring == MAP_FAILED) {
+			fail(fd, interface, "mmap");
+		}
+
+		struct sockaddr_ll addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sll_family = AF_PACKET;
+		addr.sll_protocol = htons(ETH_P_ALL);
+		addr.sll_ifindex = int(index);
+		if(bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr))) {
+			munmap(ring, ring_bytes);
+			fail(fd, interface, "bind");
+		}
+
+		if(config.promiscuous) {
+			struct packet_mreq mreq;
+			memset(&mreq, 0, sizeof(mreq));
+			mreq.mr_ifindex = int(index);
+			mreq.mr_type = PACKET_MR_PROMISC;
+			if(setsockopt(fd, SOL_PACKET, PACKET_ADD_MEMBERSHIP, &mreq, sizeof(mreq))) {
+				munmap(ring, ring_bytes);
+				fail(fd, interface, "PACKET_MR_PROMISC");
+			}
+		}
+
+		if(config.fanout_group) {
+			const int fanout = int(config.fanout_group) | (int(config.fanout_mode) << 16);
+			if(setsockopt(fd, SOL_PACKET, PACKET_FANOUT, &fanout, sizeof(fanout))) {
+				munmap(ring, ring_bytes);
+				fail(fd, interface, "PACKET_FANOUT");
+			}
+		}
+
+		return LiveReader(fd, static_cast<uint8_t*>(ring), config);
+	}
+
+private:
+
+	inline void clear() noexcept {
+		m_fd = -1;
+		m_ring = nullptr;
+		m_ring_bytes = 0;
+		m_left = 0;
+		m_next = nullptr;
+		m_release = false;
+	}
+
+	static void fail(int fd, const std::string& interface, const char* what) noexcept(false) {
+		const int error = errno;
+		::close(fd);
+		throw std::runtime_error(interface + ": " + what + ": " + strerror(error));
+	}
+
+	inline struct tpacket_block_desc* block() const noexcept {
+		return reinterpret_cast<struct tpacket_block_desc*>(m_ring + size_t(m_block) * m_block_bytes);
+	}
+
+	inline bool ready() const noexcept {
+		return __atomic_load_n(&block()->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER;
+	}
+
+	/**
+	 * Take the current block from the kernel if it is ready.
+	 */
+	inline bool take() noexcept {
+		if(not ready()) {
+			return false;
+		}
+		const struct tpacket_block_desc* desc = block();
+		m_left = desc->hdr.bh1.num_pkts;
+		m_next = reinterpret_cast<const struct tpacket3_hdr*>(reinterpret_cast<const uint8_t*>(desc)
+			+ desc->hdr.bh1.offset_to_first_pkt);
+		if(m_left == 0) {
+			m_release = true; // an empty block retired by the timeout
+		}
+		return m_left != 0;
+	}
+
+	/**
+	 * Hand the current block back to the kernel and move to the next one.
+	 */
+	inline void retire() noexcept {
+		__atomic_store_n(&block()->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+		m_block = m_block + 1 == m_block_count ? 0 : m_block + 1;
+		m_release = false;
+		m_stat.blocks++;
+	}
+
+	/**
+	 * Move the MAC addresses into the headroom of a tag and put the stripped tag after them.
+	 * @return the new start of the frame.
+	 */
+	inline const uint8_t* restore_vlan(const struct tpacket3_hdr* hdr) noexcept {
+		uint8_t* data = const_cast<uint8_t*>(reinterpret_cast<const uint8_t*>(hdr)) + hdr->tp_mac;
+		uint8_t* start = data - VLAN_TAG_BYTES;
+		memmove(start, data, MAC_BYTES);
+		const uint16_t tpid = (hdr->tp_status & TP_STATUS_VLAN_TPID_VALID) && hdr->hv1.tp_vlan_tpid
+			? hdr->hv1.tp_vlan_tpid : uint16_t(ETH_P_8021Q);
+		const uint16_t tag[2] = {htons(tpid), htons(uint16_t(hdr->hv1.tp_vlan_tci))};
+		memcpy(start + MAC_BYTES, tag, sizeof(tag));
+		return start;
+	}
+
+};
+
+}; // namespace pcapwrap
@@ -0,0 +1,395 @@
+#pragma once
+
+#include "Frame.h"
+#include "Filter.h"
+
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace pcapwrap {
+
+/**
+ * A reader of the classic pcap and pcap-ns files which maps the whole file and yields the frames in bursts,
+ * the frame data points into the mapping, so nothing is copied and libpcap is not called.
+ * The frames are valid until the reader is closed, a timestamp is in nanoseconds as Reader does.
+ * The file is advised as sequential, the pages are read ahead by windows of a huge page size.
+ * A large file may be split into parts which are read by different threads, every part starts at the first
+ * record boundary after its byte offset, the boundary is found by SYNC_RECORDS valid record headers in a row.
+ * The frames which don't pass filter() are skipped before they are handed out.
+ */
+class MappedReader {
+public:
+	constexpr static uint32_t MAGIC_USEC = 0xa1b2c3d4;
+	constexpr static uint32_t MAGIC_NSEC = 0xa1b23c4d;
+	constexpr static uint32_t SNAPSHOT_LEN_MAX = 262144; // libpcap rejects the longer records
+	constexpr static size_t READAHEAD = size_t(2) << 20;
+	constexpr static unsigned SYNC_RECORDS = 8;
+	constexpr static uint32_t SYNC_SECONDS = 3600; // the timestamp spread of the records in a row
+
+private:
+	struct FileHeader {
+		uint32_t magic;
+		uint16_t version_major;
+		uint16_t version_minor;
+		int32_t thiszone;
+		uint32_t sigfigs;
+		uint32_t snaplen;
+		uint32_t linktype;
+	};
+
+	struct RecordHeader {
+		uint32_t ts_sec;
+		uint32_t ts_frac; // microseconds or nanoseconds
+		uint32_t caplen;
+		uint32_t len;
+	};
+
+	const uint8_t* m_mapping;
+	size_t m_bytes;
+	size_t m_offset; // of the next record
+	size_t m_end; // of the part
+	size_t m_readahead; // the end of the advised window
+	uint64_t m_frame_idx;
+	uint32_t m_snaplen;
+	uint32_t m_linktype;
+	bool m_swapped;
+	bool m_nanosec;
+	Filter m_filter;
+
+	MappedReader(const uint8_t* mapping, size_t bytes, const FileHeader& header, bool swapped, bool nanosec) noexcept
+		: m_mapping(mapping)
+		, m_bytes(bytes)
+		, m_offset(sizeof(FileHeader))
+		, m_end(bytes)
+		, m_readahead(0)
+		, m_frame_idx(0)
+		, m_snaplen(header.snaplen)
+		, m_linktype(header.linktype)
+		, m_swapped(swapped)
+		, m_nanosec(nanosec)
+		, m_filter() {
+		advise();
+	}
+
+public:
+	MappedReader(const MappedReader&) = delete;
+	MappedReader& operator=(const MappedReader&) = delete;
+
+	MappedReader(MappedReader&& rvalue) noexcept
+		: m_mapping(rvalue.m_mapping)
+		, m_bytes(rvalue.m_bytes)
+		, m_offset(rvalue.m_offset)
+		, m_end(rvalue.m_end)
+		, m_readahead(rvalue.m_readahead)
+		, m_frame_idx(rvalue.m_frame_idx)
+		, m_snaplen(rvalue.m_snaplen)
+		, m_linktype(rvalue.m_linktype)
+		, m_swapped(rvalue.m_swapped)
+		, m_nanosec(rvalue.m_nanosec)
+		, m_filter(std::move(rvalue.m_filter)) {
+		rvalue.clear();
+	}
+
+	MappedReader& operator=(MappedReader&& rvalue) noexcept {
+		if(this != &rvalue) {
+			close();
+			m_mapping = rvalue.m_mapping;
+			m_bytes = rvalue.m_bytes;
+			m_offset = rvalue.m_offset;
+			m_end = rvalue.m_end;
+			m_readahead = rvalue.m_readahead;
+			m_frame_idx = rvalue.m_frame_idx;
+			m_snaplen = rvalue.m_snaplen;
+			m_linktype = rvalue.m_linktype;
+			m_swapped = rvalue.m_swapped;
+			m_nanosec = rvalue.m_nanosec;
+			m_filter = std::move(rvalue.m_filter);
+			rvalue.clear();
+		}
+		return *this;
+	}
+
+	~MappedReader() noexcept {
+		close();
+	}
+
+	inline void close() noexcept {
+		if(m_mapping) {
+			munmap(const_cast<uint8_t*>(m_mapping), m_bytes);
+			clear();
+		}
+	}
+
+	/**
+	 * Fill up to @n frames, e.g. a burst for HeaderParser.
+	 * @return amount of the filled frames, 0 - at the end of the file (or the part) or at a truncated or broken record.
+	 */
+	size_t next_burst(Frame* frames, size_t n) noexcept {
+		size_t result = 0;
+		while(result < n && m_offset < m_end && m_bytes - m_offset >= sizeof(RecordHeader)) {
+			const RecordHeader record = record_at(m_offset);
+			const size_t data_offset = m_offset + sizeof(RecordHeader);
+			if(record.caplen > m_bytes - data_offset || record.caplen > caplen_max()) {
+				break;
+			}
+
+			Frame& frame = frames[result++];
+			frame.m_hdr.ts.tv_sec = record.ts_sec;
+			frame.m_hdr.ts.tv_usec = m_nanosec ? record.ts_frac : record.ts_frac * 1000u;
+			frame.m_hdr.caplen = record.caplen;
+			frame.m_hdr.len = record.len;
+			frame.m_data = m_mapping + data_offset;
+			m_frame_idx++;
+			frame.m_idx = m_frame_idx;
+			m_offset = data_offset + record.caplen;
+			if(not m_filter.accept(frame)) {
+				result--;
+				advise(); // a burst may skip far
+			}
+		}
+		advise();
+		return result;
+	}
+
+	inline bool next(Frame& frame) noexcept {
+		return next_burst(&frame, 1) == 1;
+	}
+
+	/**
+	 * Step over up to @n records without handing them out, the filter doesn't see them.
+	 * @return amount of the skipped records, less than @n - at the end of the file (or the part) or at a broken record.
+	 */
+	uint64_t skip(uint64_t n) noexcept {
+		uint64_t result = 0;
+		while(result < n && m_offset < m_end && m_bytes - m_offset >= sizeof(RecordHeader)) {
+			const RecordHeader record = record_at(m_offset);
+			const size_t data_offset = m_offset + sizeof(RecordHeader);
+			if(record.caplen > m_bytes - data_offset || record.caplen > caplen_max()) {
+				break;
+			}
+			m_offset = data_offset + record.caplen;
+			m_frame_idx++;
+			result++;
+		}
+		advise();
+		return result;
+	}
+
+	/**
+	 * @return true - if the reading has stopped before the end of the file (or the part) at a truncated or broken record.
+	 */
+	inline bool truncated() const noexcept {
+		return m_mapping && m_offset != m_end;
+	}
+
+	inline uint64_t frame_index() const noexcept {
+		return m_frame_idx;
+	}
+
+	/**
+	 * @return the offset of the next record, e.g. for PcapIndex.
+	 */
+	inline size_t offset() const noexcept {
+		return m_offset;
+	}
+
+	/**
+	 * @return the size of the file.
+	 */
+	inline size_t bytes() const noexcept {
+		return m_bytes;
+	}
+
+	/**
+	 * Continue with the record at @offset and stop at @end, e.g. at the offsets of PcapIndex.
+	 * The offsets must be the record boundaries, the readahead window moves to @offset.
+	 * @param frame_idx - the index of the frame before the record, the filter takes the next ones as they come.
+	 * @return false - if the range is out of the file, the position is not changed then.
+	 */
+	bool seek(size_t offset, size_t end, uint64_t frame_idx) noexcept {
+		if(m_mapping == nullptr || offset < sizeof(FileHeader) || offset > end || end > m_bytes)
+			return false;
+
+		m_offset = offset;
+		m_end = end;
+		m_frame_idx = frame_idx;
+		m_readahead = offset & ~(READAHEAD - 1);
+		advise();
+		return true;
+	}
+
+	inline uint32_t snaplen() const noexcept {
+		return m_snaplen;
+	}
+
+	inline uint32_t linktype() const noexcept {
+		return m_linktype;
+	}
+
+	/**
+	 * @return the filter of the frames, it passes all of them until it is set up.
+	 */
+	inline Filter& filter() noexcept {
+		return m_filter;
+	}
+
+	static MappedReader open(const std::string& file_name) noexcept(false) {
+		const int fd = ::open(file_name.c_str(), O_RDONLY);
+		if(fd < 0) {
+			throw std::runtime_error(file_name + ": " + strerror(errno));
+		}
+		struct stat st;
+		if(fstat(fd, &st) != 0) {
+			const int error = errno;
+			::close(fd);
+			throw std::runtime_error(file_name + ": " + strerror(error));
+		}
+		const size_t bytes = size_t(st.st_size);
+		if(bytes < sizeof(FileHeader)) {
+			::close(fd);
+			throw std::runtime_error(file_name + ": not a pcap file");
+		}
+		posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+		void* mapping = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+		const int error = errno;
+		::close(fd);
+		if(mapping == MAP_FAILED) {
+			throw std::runtime_error(file_name + ": " + strerror(error));
+		}
+
+		FileHeader header;
+		memcpy(&header, mapping, sizeof(header));
+		const uint32_t magic = __builtin_bswap32(header.magic);
+		const bool swapped = magic == MAGIC_USEC || magic == MAGIC_NSEC;
+		if(swapped) {
+			header.magic = magic;
+			header.version_major = __builtin_bswap16(header.version_major);
+			header.version_minor = __builtin_bswap16(header.version_minor);
+			header.snaplen = __builtin_bswap32(header.snaplen);
+			header.linktype = __builtin_bswap32(header.linktype);
+		}
+		if((header.magic != MAGIC_USEC && header.magic != MAGIC_NSEC) || header.version_major != 2) {
+			munmap(mapping, bytes);
+			throw std::runtime_error(file_name + ": not a pcap file");
+		}
+
+		madvise(mapping, bytes, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+		madvise(mapping, bytes, MADV_HUGEPAGE); // the page cache of a file may take huge pages, it is best effort
+#endif
+		return MappedReader(static_cast<const uint8_t*>(mapping), bytes, header, swapped, header.magic == MAGIC_NSEC);
+	}
+
+	/**
+	 * Open the part @part of @parts equal byte ranges of the file, the parts have no common records
+	 * and they cover all the records together.
+	 */
+	static MappedReader open(const std::string& file_name, size_t part, size_t parts) noexcept(false) {
+		if(parts == 0 || part >= parts) {
+			throw std::runtime_error(file_name + ": no such part");
+		}
+		MappedReader result = open(file_name);
+		const size_t step = (result.m_bytes - sizeof(FileHeader)) / parts;
+		const size_t begin = sizeof(FileHeader) + step * part;
+		const size_t end = part + 1 == parts ? result.m_bytes : begin + step;
+		result.m_offset = result.sync(begin);
+		result.m_end = result.sync(end);
+		result.m_readahead = result.m_offset & ~(READAHEAD - 1);
+		result.advise();
+		return result;
+	}
+
+private:
+
+	inline RecordHeader record_at(size_t offset) const noexcept {
+		RecordHeader record;
+		memcpy(&record, m_mapping + offset, sizeof(record));
+		if(m_swapped) {
+			record.ts_sec = __builtin_bswap32(record.ts_sec);
+			record.ts_frac = __builtin_bswap32(record.ts_frac);
+			record.caplen = __builtin_bswap32(record.caplen);
+			record.len = __builtin_bswap32(record.len);
+		}
+		return record;
+	}
+
+	inline uint32_t caplen_max() const noexcept {
+		return m_snaplen > SNAPSHOT_LEN_MAX ? m_snaplen : SNAPSHOT_LEN_MAX;
+	}
+
+	/**
+	 * @return the offset of the first record boundary at or after @offset, m_bytes - if there is none.
+	 */
+	size_t sync(size_t offset) const noexcept {
+		if(offset <= sizeof(FileHeader)) {
+			return sizeof(FileHeader);
+		}
+		for(; offset < m_bytes; offset++) {
+			if(boundary(offset)) {
+				return offset;
+			}
+		}
+		return m_bytes;
+	}
+
+	/**
+	 * @return true - if SYNC_RECORDS valid records (or the valid records up to the end of the file) start at @offset.
+	 */
+	bool boundary(size_t offset) const noexcept {
+		const uint32_t frac_max = m_nanosec ? 1000000000u : 1000000u;
+		uint32_t ts_first = 0;
+		for(unsigned i = 0; i < SYNC_RECORDS && offset < m_bytes; i++) {
+			if(m_bytes - offset < sizeof(RecordHeader)) {
+				return false;
+			}
+			const RecordHeader record = record_at(offset);
+			if(i == 0) {
+				ts_first = record.ts_sec;
+			}
+			if(record.caplen > record.len || record.caplen > caplen_max() || record.ts_frac >= frac_max
+			   || record.ts_sec - ts_first + SYNC_SECONDS > 2 * SYNC_SECONDS) {
+				return false;
+			}
+			offset += sizeof(RecordHeader) + record.caplen;
+			if(offset > m_bytes) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * Keep a window of READAHEAD bytes ahead of the next record in flight.
+	 */
+	inline void advise() noexcept {
+		if(m_readahead < m_offset) {
+			m_readahead = m_offset & ~(READAHEAD - 1);
+		}
+		if(m_readahead < m_end && m_offset + READAHEAD / 2 >= m_readahead) {
+			const size_t length = m_bytes - m_readahead < READAHEAD ? m_bytes - m_readahead : READAHEAD;
+			madvise(const_cast<uint8_t*>(m_mapping) + m_readahead, length, MADV_WILLNEED);
+			m_readahead += length;
+		}
+	}
+
+	inline void clear() noexcept {
+		m_mapping = nullptr;
+		m_bytes = 0;
+		m_offset = 0;
+		m_end = 0;
+		m_readahead = 0;
+		m_frame_idx = 0;
+	}
+
+};
+
+}; // namespace pcapwrap
@@ -0,0 +1,476 @@
+#pragma once
+
+#include "Frame.h"
+#include "Filter.h"
+
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace pcapwrap {
+
+/**
+ * The blocks and the options of pcapng (draft-ietf-opsawg-pcapng) which NgReader and NgWriter know.
+ */
+struct Pcapng {
+	constexpr static uint32_t BLOCK_SHB = 0x0A0D0D0A; // Section Header Block
+	constexpr static uint32_t BLOCK_IDB = 0x00000001; // Interface Description Block
+	constexpr static uint32_t BLOCK_SPB = 0x00000003; // Simple Packet Block
+	constexpr static uint32_t BLOCK_EPB = 0x00000006; // Enhanced Packet Block
+	constexpr static uint32_t BYTE_ORDER_MAGIC = 0x1A2B3C4D;
+
+	constexpr static uint16_t OPT_END = 0;
+	constexpr static uint16_t OPT_COMMENT = 1;
+	constexpr static uint16_t OPT_IF_NAME = 2;
+	constexpr static uint16_t OPT_IF_TSRESOL = 9;
+	constexpr static uint16_t OPT_IF_TSOFFSET = 14;
+	constexpr static uint16_t OPT_EPB_FLAGS = 2;
+
+	struct BlockHeader {
+		uint32_t type;
+		uint32_t length; // the total length of the block, it is repeated by its last 4 bytes
+	};
+
+	struct SectionHeader {
+		uint32_t magic;
+		uint16_t version_major;
+		uint16_t version_minor;
+		int64_t section_length; // -1 - unknown
+	} __attribute__ ((__packed__));
+
+	struct InterfaceHeader {
+		uint16_t linktype;
+		uint16_t reserved;
+		uint32_t snaplen;
+	};
+
+	struct PacketHeader {
+		uint32_t interface;
+		uint32_t ts_high;
+		uint32_t ts_low;
+		uint32_t caplen;
+		uint32_t len;
+	};
+
+	struct OptionHeader {
+		uint16_t code;
+		uint16_t length;
+	};
+
+	static inline constexpr size_t pad(size_t bytes) noexcept {
+		return (bytes + 3) & ~size_t(3);
+	}
+};
+
+/**
+ * A reader of pcapng files which maps the whole file (or reads a buffer of the caller) and yields the frames
+ * of the Enhanced and Simple Packet Blocks in bursts as MappedReader does, the frame data points into the mapping.
+ * Every frame keeps the ID of its interface and epb_flags, the interfaces of the current section are kept
+ * with their link types, names and timestamp resolutions, the timestamps are converted to nanoseconds.
+ * The sections may have the byte order of the writer each. The other blocks are skipped.
+ */
+class NgReader {
+public:
+	constexpr static uint32_t BLOCK_BYTES_MAX = uint32_t(16) << 20; // Wireshark rejects the longer blocks
+
+	struct Interface {
+		uint32_t linktype;
+		uint32_t snaplen;
+		uint64_t ticks; // per second, by if_tsresol
+		int64_t offset; // seconds, by if_tsoffset
+		std::string name;
+
+		Interface() noexcept : linktype(0), snaplen(0), ticks(1000000), offset(0), name() {}
+	};
+
+private:
+	const uint8_t* m_data;
+	size_t m_bytes;
+	size_t m_offset; // of the next block
+	uint64_t m_frame_idx;
+	bool m_mapped;
+	bool m_swapped;
+	bool m_broken;
+	std::string m_comment; // of the section
+	std::vector<Interface> m_interfaces;
+	Filter m_filter;
+
+	NgReader(const uint8_t* data, size_t bytes, bool mapped) noexcept
+		: m_data(data)
+		, m_bytes(bytes)
+		, m_offset(0)
+		, m_frame_idx(0)
+		, m_mapped(mapped)
+		, m_swapped(false)
+		, m_broken(false)
+		, m_comment()
+		, m_interfaces()
+		, m_filter() {}
+
+public:
+	NgReader(const NgReader&) = delete;
+	NgReader& operator=(const NgReader&) = delete;
+
+	NgReader(NgReader&& rvalue) noexcept
+		: m_data(rvalue.m_data)
+		, m_bytes(rvalue.m_bytes)
+		, m_offset(rvalue.m_offset)
+		, m_frame_idx(rvalue.m_frame_idx)
+		, m_mapped(rvalue.m_mapped)
+		, m_swapped(rvalue.m_swapped)
+		, m_broken(rvalue.m_broken)
+		, m_comment(std::move(rvalue.m_comment))
+		, m_interfaces(std::move(rvalue.m_interfaces))
+		, m_filter(std::move(rvalue.m_filter)) {
+		rvalue.clear();
+	}
+
+	NgReader& operator=(NgReader&& rvalue) noexcept {
+		if(this != &rvalue) {
+			close();
+			m_data = rvalue.m_data;
+			m_bytes = rvalue.m_bytes;
+			m_offset = rvalue.m_offset;
+			m_frame_idx = rvalue.m_frame_idx;
+			m_mapped = rvalue.m_mapped;
+			m_swapped = rvalue.m_swapped;
+			m_broken = rvalue.m_broken;
+			m_comment = std::move(rvalue.m_comment);
+			m_interfaces = std::move(rvalue.m_interfaces);
+			m_filter = std::move(rvalue.m_filter);
+			rvalue.clear();
+		}
+		return *this;
+	}
+
+	~NgReader() noexcept {
+		close();
+	}
+
+	inline void close() noexcept {
+		if(m_data) {
+			if(m_mapped) {
+				munmap(const_cast<uint8_t*>(m_data), m_bytes);
+			}
+			clear();
+		}
+	}
+
+	/**
+	 * Fill up to @n frames which pass filter(), the interfaces are updated by the blocks on the way.
+	 * @return amount of the filled frames, 0 - at the end of the file or at a truncated or broken block.
+	 */
+	size_t next_burst(Frame* frames, size_t n) noexcept {
+		size_t result = 0;
+		while(result < n && m_bytes - m_offset >= sizeof(Pcapng::BlockHeader)) {
+			Pcapng::BlockHeader block;
+			memcpy(&block, m_data + m_offset, sizeof(block));
+			if(block.type == Pcapng::BLOCK_SHB && not section(m_offset)) {
+				break;
+			}
+			block.length = u32(block.length);
+			if(not valid(block.length)) {
+				m_broken = true;
+				break;
+			}
+
+			const uint8_t* body = m_data + m_offset + sizeof(block);
+			const size_t body_bytes = block.length - sizeof(block) - sizeof(uint32_t);
+			m_offset += block.length;
+			switch(u32(block.type)) {
+				case Pcapng::BLOCK_IDB:
+					interface(body, body_bytes);
+					break;
+
+				case Pcapng::BLOCK_EPB:
+				case Pcapng::BLOCK_SPB: {
+					Frame& frame = frames[result];
+					if(not packet(u32(block.type), body, body_bytes, frame)) {
+						m_broken = true;
+						return result;
+					}
+					m_frame_idx++;
+					frame.m_idx = m_frame_idx;
+					result += m_filter.accept(frame);
+					break;
+				}
+
+				default:
+					break;
+			}
+		}
+		return result;
+	}
+
+	inline bool next(Frame& frame) noexcept {
+		return next_burst(&frame, 1) == 1;
+	}
+
+	/**
+	 * @return true - if the reading has stopped before the end of the file at a truncated or broken block.
+	 */
+	inline bool truncated() const noexcept {
+		return m_broken || (m_data && m_offset != m_bytes);
+	}
+
+	inline uint64_t frame_index() const noexcept {
+		return m_frame_idx;
+	}
+
+	/**
+	 * @return the interfaces of the current section by their IDs, see Frame::m_interface.
+	 */
+	inline const std::vector<Interface>& interfaces() const noexcept {
+		return m_interfaces;
+	}
+
+	/**
+	 * @return shb_comment of the current section.
+	 */
+	inline const std::string& comment() const noexcept {
+		return m_comment;
+	}
+
+	/**
+	 * @return the filter of the frames, see Filter, it passes all of them until it is set up.
+	 */
+	inline Filter& filter() noexcept {
+		return m_filter;
+	}
+
+	static NgReader open(const std::string& file_name) noexcept(false) {
+		const int fd = ::open(file_name.c_str(), O_RDONLY);
+		if(fd < 0) {
+			throw std::runtime_error(file_name + ": " + strerror(errno));
+		}
+		struct stat st;
+		if(fstat(fd, &st) != 0) {
+			const int error = errno;
+			::close(fd);
+			throw std::runtime_error(file_name + ": " + strerror(error));
+		}
+		const size_t bytes = size_t(st.st_size);
+		if(bytes < sizeof(Pcapng::BlockHeader) + sizeof(Pcapng::SectionHeader)) {
+			::close(fd);
+			throw std::runtime_error(file_name + ": not a pcapng file");
+		}
+		posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+		void* mapping = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+		const int error = errno;
+		::close(fd);
+		if(mapping == MAP_FAILED) {
+			throw std::runtime_error(file_name + ": " + strerror(error));
+		}
+		madvise(mapping, bytes, MADV_SEQUENTIAL);
+		NgReader result(static_cast<const uint8_t*>(mapping), bytes, true);
+		if(not result.section(0)) {
+			throw std::runtime_error(file_name + ": not a pcapng file");
+		}
+		return result;
+	}
+
+	/**
+	 * Read the pcapng data of a buffer, e.g. of a capture in memory, the buffer must outlive the reader.
+	 */
+	static NgReader open(const uint8_t* data, size_t bytes) noexcept(false) {
+		NgReader result(data, bytes, false);
+		if(bytes < sizeof(Pcapng::BlockHeader) + sizeof(Pcapng::SectionHeader) || not result.section(0)) {
+			throw std::runtime_error("not a pcapng buffer");
+		}
+		return result;
+	}
+
+private:
+
+	inline uint16_t u16(uint16_t value) const noexcept {
+		return m_swapped ? __builtin_bswap16(value) : value;
+	}
+
+	inline uint32_t u32(uint32_t value) const noexcept {
+		return m_swapped ? __builtin_bswap32(value) : value;
+	}
+
+	inline bool valid(uint32_t length) const noexcept {
+		return length >= sizeof(Pcapng::BlockHeader) + sizeof(uint32_t) && length % 4 == 0
+			&& length <= BLOCK_BYTES_MAX && length <= m_bytes - m_offset;
+	}
+
+	/**
+	 * Start a new section by the SHB at @offset, its byte order is of the byte-order magic.
+	 * @return false - if the block is not a valid SHB.
+	 */
+	bool section(size_t offset) noexcept {
+		if(m_bytes - offset < sizeof(Pcapng::BlockHeader) + sizeof(Pcapng::SectionHeader)) {
+			return false;
+		}
+		Pcapng::BlockHeader block;
+		Pcapng::SectionHeader header;
+		memcpy(&block, m_data + offset, sizeof(block));
+		memcpy(&header, m_data + offset + sizeof(block), sizeof(header));
+		if(block.type != Pcapng::BLOCK_SHB) {
+			return false;
+		}
+		if(header.magic == Pcapng::BYTE_ORDER_MAGIC) {
+			m_swapped = false;
+		} else if(header.magic == __builtin_bswap32(Pcapng::BYTE_ORDER_MAGIC)) {
+			m_swapped = true;
+		} else {
+			return false;
+		}
+		const uint32_t length = u32(block.length);
+		if(u16(header.version_major) != 1 || not valid(length)
+		   || length < sizeof(block) + sizeof(header) + sizeof(uint32_t)) {
+			m_broken = true;
+			return false;
+		}
+
+		m_interfaces.clear();
+		m_comment.clear();
+		const uint8_t* options = m_data + offset + sizeof(block) + sizeof(header);
+		const size_t options_bytes = length - sizeof(block) - sizeof(header) - sizeof(uint32_t);
+		for_options(options, options_bytes, [this](uint16_t code, const uint8_t* value, uint16_t bytes) {
+			if(code == Pcapng::OPT_COMMENT) {
+				m_comment.assign(reinterpret_cast<const char*>(value), bytes);
+			}
+		});
+		return true;
+	}
+
+	void interface(const uint8_t* body, size_t bytes) noexcept {
+		Interface result;
+		if(bytes >= sizeof(Pcapng::InterfaceHeader)) {
+			Pcapng::InterfaceHeader header;
+			memcpy(&header, body, sizeof(header));
+			result.linktype = u16(header.linktype);
+			result.snaplen = u32(header.snaplen);
+			for_options(body + sizeof(header), bytes - sizeof(header),
+			            [this, &result](uint16_t code, const uint8_t* value, uint16_t length) {
+				if(code == Pcapng::OPT_IF_NAME) {
+					result.name.assign(reinterpret_cast<const char*>(value), length);
+				} else if(code == Pcapng::OPT_IF_TSRESOL && length >= 1) {
+					result.ticks = tsresol(value[0]);
+				} else if(code == Pcapng::OPT_IF_TSOFFSET && length >= sizeof(int64_t)) {
+					uint64_t offset;
+					memcpy(&offset, value, sizeof(offset));
+					result.offset = int64_t(m_swapped ? __builtin_bswap64(offset) : offset);
+				}
+			});
+		}
+		m_interfaces.push_back(std::move(result));
+	}
+
+	/**
+	 * @return false - if the packet is longer than its block or its interface is unknown.
+	 */
+	bool packet(uint32_t type, const uint8_t* body, size_t bytes, Frame& frame) noexcept {
+		frame.m_flags = 0;
+		if(type == Pcapng::BLOCK_SPB) {
+			if(bytes < sizeof(uint32_t) || m_interfaces.empty()) {
+				return false;
+			}
+			uint32_t len;
+			memcpy(&len, body, sizeof(len));
+			len = u32(len);
+			const size_t caplen = bytes - sizeof(len) < len ? bytes - sizeof(len) : len;
+			frame.m_interface = 0;
+			frame.m_hdr.ts.tv_sec = 0;
+			frame.m_hdr.ts.tv_usec = 0;
+			frame.m_hdr.caplen = uint32_t(caplen);
+			frame.m_hdr.len = len;
+			frame.m_data = body + sizeof(len);
+			return true;
+		}
+
+		Pcapng::PacketHeader header;
+		if(bytes < sizeof(header)) {
+			return false;
+		}
+		memcpy(&header, body, sizeof(header));
+		const uint32_t caplen = u32(header.caplen);
+		const uint32_t iface = u32(header.interface);
+		if(caplen > bytes - sizeof(header) || iface >= m_interfaces.size()) {
+			return false;
+		}
+		const Interface& ifc = m_interfaces[iface];
+		const uint64_t ticks = (uint64_t(u32(header.ts_high)) << 32) | u32(header.ts_low);
+		frame.m_interface = iface;
+		frame.m_hdr.ts.tv_sec = time_t(int64_t(ticks / ifc.ticks) + ifc.offset);
+		frame.m_hdr.ts.tv_usec = suseconds_t((unsigned __int128)(ticks % ifc.ticks) * 1000000000u / ifc.ticks);
+		frame.m_hdr.caplen = caplen;
+		frame.m_hdr.len = u32(header.len);
+		frame.m_data = body + sizeof(header);
+
+		const size_t data_bytes = Pcapng::pad(caplen);
+		if(bytes - sizeof(header) > data_bytes) {
+			for_options(frame.m_data + data_bytes, bytes - sizeof(header) - data_bytes,
+			            [this, &frame](uint16_t code, const uint8_t* value, uint16_t length) {
+				if(code == Pcapng::OPT_EPB_FLAGS && length >= sizeof(uint32_t)) {
+					uint32_t flags;
+					memcpy(&flags, value, sizeof(flags));
+					frame.m_flags = u32(flags);
+				}
+			});
+		}
+		return true;
+	}
+
+	/**
+	 * Call @fn with every option of @bytes up to opt_endofopt, the truncated options are ignored.
+	 * @param fn - a functor which takes 'uint16_t code, const uint8_t* value, uint16_t length'.
+	 */
+	template<typename F>
+	inline void for_options(const uint8_t* options, size_t bytes, const F& fn) const {
+		while(bytes >= sizeof(Pcapng::OptionHeader)) {
+			Pcapng::OptionHeader option;
+			memcpy(&option, options, sizeof(option));
+			const uint16_t code = u16(option.code);
+			const uint16_t length = u16(option.length);
+			if(code == Pcapng::OPT_END || length > bytes - sizeof(option)) {
+				return;
+			}
+			fn(code, options + sizeof(option), length);
+			const size_t step = sizeof(option) + Pcapng::pad(length);
+			if(step > bytes) {
+				return;
+			}
+			options += step;
+			bytes -= step;
+		}
+	}
+
+	/**
+	 * @return the ticks per second of if_tsresol, the most significant bit selects a power of 2 instead of 10.
+	 */
+	static inline uint64_t tsresol(uint8_t value) noexcept {
+		const unsigned exponent = value & 0x7F;
+		if(value & 0x80) {
+			return exponent < 64 ? uint64_t(1) << exponent : 1;
+		}
+		uint64_t result = 1;
+		for(unsigned i = 0; i < exponent && i < 19; i++) {
+			result *= 10;
+		}
+		return result;
+	}
+
+	inline void clear() noexcept {
+		m_data = nullptr;
+		m_bytes = 0;
+		m_offset = 0;
+		m_frame_idx = 0;
+		m_broken = false;
+		m_interfaces.clear();
+	}
+
+};
+
+}; // namespace pcapwrap
@@ -0,0 +1,330 @@
+#pragma once
+
+#include "NgReader.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace pcapwrap {
+
+/**
+ * A pcapng writer which assembles the blocks in a buffer and writes it by one write() call as BufferedWriter
+ * does, libpcap and stdio are not used. The file has one section (SHB, with a comment) and the interfaces
+ * added by add_interface() (IDB), a frame is written by an EPB of its interface (Frame::m_interface) with
+ * its epb_flags and a comment. The timestamps of the frames are in nanoseconds as the readers yield them,
+ * so every interface has if_tsresol of 9.
+ * The buffer is flushed when it is full and by close(). A frame of an unknown interface or longer than
+ * the buffer is dropped, a comment or a name longer than OPTION_BYTES_MAX is cut to it.
+ *
+ * Using sample (a pcapng conversion with the interfaces kept):
+ * auto reader = pcapwrap::NgReader::open(fin);
+ * auto writer = pcapwrap::NgWriter::open(fout, reader.comment());
+ * while(reader.next(frame)) {
+ *     while(writer.interfaces() < reader.interfaces().size()) {
+ *         const auto& ifc = reader.interfaces()[writer.interfaces()];
+ *         writer.add_interface(ifc.linktype, ifc.snaplen, ifc.name);
+ *     }
+ *     writer.write(frame);
+ * }
+ */
+class NgWriter {
+public:
+	constexpr static size_t BUFFER_BYTES = size_t(1) << 20;
+	constexpr static uint8_t TSRESOL_NSEC = 9;
+	constexpr static size_t OPTION_BYTES_MAX = UINT16_MAX; // the length of an option is 16 bits
+
+private:
+	int m_fd;
+	uint8_t* m_buffer;
+	size_t m_capacity;
+	size_t m_size;
+	uint64_t m_frame_idx;
+	uint64_t m_bytes; // written to the file
+	uint32_t m_interfaces;
+	int m_error;
+
+	NgWriter(int fd, uint8_t* buffer, size_t capacity) noexcept
+		: m_fd(fd), m_buffer(buffer), m_capacity(capacity), m_size(0), m_frame_idx(0), m_bytes(0), m_interfaces(0)
+		, m_error(0) {}
+
+public:
+	NgWriter(const NgWriter&) = delete;
+	NgWriter& operator=(const NgWriter&) = delete;
+
+	NgWriter(NgWriter&& rvalue) noexcept
+		: m_fd(rvalue.m_fd)
+		, m_buffer(rvalue.m_buffer)
+		, m_capacity(rvalue.m_capacity)
+		, m_size(rvalue.m_size)
+		, m_frame_idx(rvalue.m_frame_idx)
+		, m_bytes(rvalue.m_bytes)
+		, m_interfaces(rvalue.m_interfaces)
+		, m_error(rvalue.m_error) {
+		rvalue.clear();
+	}
+
+	NgWriter& operator=(NgWriter&& rvalue) noexcept {
+		if(this != &rvalue) {
+			close();
+			m_fd = rvalue.m_fd;
+			m_buffer = rvalue.m_buffer;
+			m_capacity = rvalue.m_capacity;
+			m_size = rvalue.m_size;
+			m_frame_idx = rvalue.m_frame_idx;
+			m_bytes = rvalue.m_bytes;
+			m_interfaces = rvalue.m_interfaces;
+			m_error = rvalue.m_error;
+			rvalue.clear();
+		}
+		return *this;
+	}
+
+	~NgWriter() noexcept {
+		close();
+	}
+
+	/**
+	 * Flush the buffer and close the file.
+	 * @return 0 - if all the blocks have been written.
+	 */
+	int close() noexcept {
+		int result = 0;
+		if(m_fd >= 0) {
+			flush();
+			if(::close(m_fd) != 0 && m_error == 0) {
+				m_error = errno;
+			}
+			result = m_error ? -1 : 0;
+		}
+		if(m_buffer) {
+			free(m_buffer);
+		}
+		clear();
+		return result;
+	}
+
+	/**
+	 * Add an interface, the frames refer to it by the returned ID.
+	 * @param snaplen - 0 - no limit.
+	 * @param name - if_name, it is not written if it is empty.
+	 */
+	uint32_t add_interface(uint32_t linktype = DLT_EN10MB, uint32_t snaplen = 0, const std::string& name = std::string()) noexcept {
+		const uint8_t tsresol[1] = {TSRESOL_NSEC};
+		const size_t body = sizeof(Pcapng::InterfaceHeader) + option_bytes(name.size()) + option_bytes(sizeof(tsresol))
+			+ sizeof(Pcapng::OptionHeader);
+		uint8_t* ptr = block(Pcapng::BLOCK_IDB, body);
+		if(ptr) {
+			Pcapng::InterfaceHeader header;
+			header.linktype = uint16_t(linktype);
+			header.reserved = 0;
+			header.snaplen = snaplen;
+			ptr = put(ptr, &header, sizeof(header));
+			ptr = option(ptr, Pcapng::OPT_IF_NAME, name.data(), name.size());
+			ptr = option(ptr, Pcapng::OPT_IF_TSRESOL, tsresol, sizeof(tsresol));
+			option(ptr, Pcapng::OPT_END, nullptr, 0);
+		}
+		return m_interfaces++;
+	}
+
+	inline void write(const Frame& frame) noexcept {
+		write(frame, nullptr, 0);
+	}
+
+	inline void write(const Frame& frame, const std::string& comment) noexcept {
+		write(frame, comment.data(), comment.size());
+	}
+
+	/**
+	 * Write the buffer.
+	 * @return 0 - if the buffer has been written.
+	 */
+	int flush() noexcept {
+		size_t written = 0;
+		while(m_error == 0 && written < m_size) {
+			const ssize_t result = ::write(m_fd, m_buffer + written, m_size - written);
+			if(result > 0) {
+				written += size_t(result);
+			} else if(result == 0) {
+				m_error = EIO;
+			} else if(errno != EINTR) {
+				m_error = errno;
+			}
+		}
+		m_bytes += written;
+		m_size = 0;
+		return m_error ? -1 : 0;
+	}
+
+	inline uint64_t frame_index() const noexcept {
+		return m_frame_idx;
+	}
+
+	/**
+	 * @return amount of the interfaces, the next add_interface() returns it.
+	 */
+	inline uint32_t interfaces() const noexcept {
+		return m_interfaces;
+	}
+
+	/**
+	 * @return the bytes written to the file so far, the buffered ones are not counted.
+	 */
+	inline uint64_t bytes() const noexcept {
+		return m_bytes;
+	}
+
+	/**
+	 * @return errno of the first failed write or 0, the blocks are dropped after a failure.
+	 */
+	inline int error() const noexcept {
+		return m_error;
+	}
+
+	/**
+	 * @param comment - shb_comment, it is not written if it is empty.
+	 * @param buffer_bytes - at least BUFFER_BYTES.
+	 */
+	static NgWriter open(
+		const std::string& file_name,
+		const std::string& comment = std::string(),
+		size_t buffer_bytes = BUFFER_BYTES) noexcept(false) {
+
+		const size_t capacity = buffer_bytes < BUFFER_BYTES ? BUFFER_BYTES : buffer_bytes;
+		uint8_t* buffer = static_cast<uint8_t*>(malloc(capacity));
+		if(buffer == nullptr) {
+			throw std::runtime_error(file_name + ": the buffer can't be allocated");
+		}
+		const int fd = ::open(file_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if(fd < 0) {
+			const int error = errno;
+			free(buffer);
+			throw std::runtime_error(file_name + ": " + strerror(error));
+		}
+
+		NgWriter result(fd, buffer, capacity);
+		const size_t body = sizeof(Pcapng::SectionHeader) + option_bytes(comment.size()) + sizeof(Pcapng::OptionHeader);
+		uint8_t* ptr = result.block(Pcapng::BLOCK_SHB, body);
+		if(ptr == nullptr) {
+			throw std::runtime_error(file_name + ": the section header can't be written");
+		}
+		Pcapng::SectionHeader header;
+		header.magic = Pcapng::BYTE_ORDER_MAGIC;
+		header.version_major = 1;
+		header.version_minor = 0;
+		header.section_length = -1;
+		ptr = put(ptr, &header, sizeof(header));
+		ptr = option(ptr, Pcapng::OPT_COMMENT, comment.data(), comment.size());
+		option(ptr, Pcapng::OPT_END, nullptr, 0);
+		return result;
+	}
+
+private:
+
+	void write(const Frame& frame, const char* comment, size_t comment_bytes) noexcept {
+		if(frame.m_interface >= m_interfaces) {
+			return;
+		}
+		const bool options = frame.m_flags || comment_bytes;
+		const size_t body = sizeof(Pcapng::PacketHeader) + Pcapng::pad(frame.m_hdr.caplen)
+			+ (frame.m_flags ? option_bytes(sizeof(frame.m_flags)) : 0) + option_bytes(comment_bytes)
+			+ (options ? sizeof(Pcapng::OptionHeader) : 0);
+		uint8_t* ptr = block(Pcapng::BLOCK_EPB, body);
+		if(ptr == nullptr) {
+			return;
+		}
+
+		const uint64_t ticks = uint64_t(frame.m_hdr.ts.tv_sec) * 1000000000u + uint64_t(frame.m_hdr.ts.tv_usec);
+		Pcapng::PacketHeader header;
+		header.interface = frame.m_interface;
+		header.ts_high = uint32_t(ticks >> 32);
+		header.ts_low = uint32_t(ticks);
+		header.caplen = frame.m_hdr.caplen;
+		header.len = frame.m_hdr.len;
+		ptr = put(ptr, &header, sizeof(header));
+		ptr = put(ptr, frame.m_data, frame.m_hdr.caplen);
+		if(options) {
+			if(frame.m_flags) {
+				ptr = option(ptr, Pcapng::OPT_EPB_FLAGS, &frame.m_flags, sizeof(frame.m_flags));
+			}
+			ptr = option(ptr, Pcapng::OPT_COMMENT, comment, comment_bytes);
+			option(ptr, Pcapng::OPT_END, nullptr, 0);
+		}
+		m_frame_idx++;
+	}
+
+	/**
+	 * Reserve a block of @body bytes, its header and trailer are written.
+	 * @return the body, nullptr - if the block doesn't fit the buffer or a write has failed.
+	 */
+	uint8_t* block(uint32_t type, size_t body) noexcept {
+		const size_t length = sizeof(Pcapng::BlockHeader) + body + sizeof(uint32_t);
+		if(m_error || length > m_capacity || length > NgReader::BLOCK_BYTES_MAX) {
+			return nullptr;
+		}
+		if(m_capacity - m_size < length && flush() != 0) {
+			return nullptr;
+		}
+		uint8_t* ptr = m_buffer + m_size;
+		const Pcapng::BlockHeader header = {type, uint32_t(length)};
+		memcpy(ptr, &header, sizeof(header));
+		memcpy(ptr + length - sizeof(uint32_t), &header.length, sizeof(uint32_t));
+		m_size += length;
+		return ptr + sizeof(header);
+	}
+
+	/**
+	 * @return the bytes of an option of @bytes, 0 - if it is empty, it is not written then.
+	 */
+	static inline size_t option_bytes(size_t bytes) noexcept {
+		return bytes ? sizeof(Pcapng::OptionHeader) + Pcapng::pad(option_length(bytes)) : 0;
+	}
+
+	/**
+	 * @return the length of the value of an option of @bytes, the value is cut to OPTION_BYTES_MAX.
+	 */
+	static inline size_t option_length(size_t bytes) noexcept {
+		return bytes < OPTION_BYTES_MAX ? bytes : OPTION_BYTES_MAX;
+	}
+
+	static inline uint8_t* option(uint8_t* ptr, uint16_t code, const void* value, size_t bytes) noexcept {
+		if(bytes == 0 && code != Pcapng::OPT_END) {
+			return ptr;
+		}
+		bytes = option_length(bytes);
+		const Pcapng::OptionHeader header = {code, uint16_t(bytes)};
+		ptr = put(ptr, &header, sizeof(header));
+		return put(ptr, value, bytes);
+	}
+
+	/**
+	 * Copy @bytes and zero the padding up to 4 bytes.
+	 */
+	static inline uint8_t* put(uint8_t* ptr, const void* value, size_t bytes) noexcept {
+		if(bytes) {
+			memcpy(ptr, value, bytes);
+		}
+		memset(ptr + bytes, 0, Pcapng::pad(bytes) - bytes);
+		return ptr + Pcapng::pad(bytes);
+	}
+
+	inline void clear() noexcept {
+		m_fd = -1;
+		m_buffer = nullptr;
+		m_capacity = 0;
+		m_size = 0;
+		m_frame_idx = 0;
+		m_bytes = 0;
+		m_interfaces = 0;
+	}
+
+};
+
+}; // namespace pcapwrap
@@ -0,0 +1,322 @@
+#pragma once
+
+#include "MappedReader.h"
+
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace pcapwrap {
+
+/**
+ * A chunk of the records of a pcap file, see PcapIndex.
+ */
+struct PcapIndexEntry {
+	uint64_t offset; // of the first record
+	uint64_t frame_idx; // the index of the frame before the chunk
+	uint64_t ts_min; // nanoseconds, the timestamps of the chunk are within [ts_min, ts_max]
+	uint64_t ts_max;
+};
+
+/**
+ * PcapIndex splits a pcap file into chunks of every_frames records or of every_ns nanoseconds (whichever comes
+ * first), an entry keeps the file offset of a chunk, the frame index before it and the timestamp range of its
+ * records. The range is kept rather than the first timestamp since the records of the merged captures may be
+ * out of order a bit. A time range is read then from the first chunk which may have the frames of the range
+ * to the last one which may have them, a frame index is found within a chunk.
+ * The index is kept in a sidecar file (sidecar() by default), the header keeps the size of the pcap file,
+ * so the index of a file which has grown or has been replaced by one of another size is rejected.
+ * The numbers are in the host byte order, the index is built on the host which reads it.
+ *
+ * Using sample:
+ * PcapIndex::build(file).write(PcapIndex::sidecar(file));
+ * ...
+ * auto reader = IndexedReader::open(file);
+ */
+class PcapIndex {
+public:
+	constexpr static uint64_t MAGIC = 0x3158444950414351ull; // "QCAPIDX1"
+	constexpr static uint32_t EVERY_FRAMES = 4096;
+	constexpr static uint64_t EVERY_NS = 1000000000; // a second
+
+private:
+	struct FileHeader {
+		uint64_t magic;
+		uint64_t pcap_bytes; // the size of the file
+		uint64_t end; // the end of the last valid record
+		uint64_t frames;
+		uint64_t entries;
+		uint64_t every_ns;
+		uint32_t every_frames;
+		uint32_t reserved;
+	};
+
+	std::vector<PcapIndexEntry> m_entries;
+	uint64_t m_pcap_bytes;
+	uint64_t m_end;
+	uint64_t m_frames;
+	uint64_t m_every_ns;
+	uint32_t m_every_frames;
+
+	PcapIndex(uint64_t pcap_bytes, uint32_t every_frames, uint64_t every_ns) noexcept
+		: m_entries(), m_pcap_bytes(pcap_bytes), m_end(0), m_frames(0), m_every_ns(every_ns), m_every_frames(every_frames) {}
+
+public:
+
+	/**
+	 * Read a pcap file through and index it.
+	 * @param every_frames - the records of a chunk at most, 0 - no limit.
+	 * @param every_ns - the nanoseconds of a chunk at most (from its first record), 0 - no limit.
+	 */
+	static PcapIndex build(const std::string& pcap_file, uint32_t every_frames = EVERY_FRAMES,
+			uint64_t every_ns = EVERY_NS) noexcept(false) {
+		MappedReader reader = MappedReader::open(pcap_file);
+		return build(reader, every_frames, every_ns);
+	}
+
+	/**
+	 * Index the records of a reader from its position, the filter of the reader must pass all the frames.
+	 */
+	static PcapIndex build(MappedReader& reader, uint32_t every_frames = EVERY_FRAMES,
+			uint64_t every_ns = EVERY_NS) noexcept {
+		PcapIndex result(reader.bytes(), every_frames, every_ns);
+		PcapIndexEntry* chunk = nullptr;
+		uint64_t chunk_frames = 0;
+		uint64_t chunk_first = 0;
+		size_t offset = reader.offset();
+		Frame frame;
+		while(reader.next(frame)) {
+			const uint64_t ns = frame.nanosec();
+			if(chunk == nullptr || (every_frames && chunk_frames == every_frames) || (every_ns && ns > chunk_first && ns - chunk_first >= every_ns)) {
+				PcapIndexEntry entry;
+				entry.offset = offset;
+				entry.frame_idx = frame.m_idx - 1;
+				entry.ts_min = ns;
+				entry.ts_max = ns;
+				result.m_entries.push_back(entry);
+				chunk = &result.m_entries.back();
+				chunk_frames = 0;
+				chunk_first = ns;
+			}
+			chunk->ts_min = ns < chunk->ts_min ? ns : chunk->ts_min;
+			chunk->ts_max = ns > chunk->ts_max ? ns : chunk->ts_max;
+			chunk_frames++;
+			offset = reader.offset();
+		}
+		result.m_end = offset;
+		result.m_frames = reader.frame_index();
+		return result;
+	}
+
+	/**
+	 * @return the default name of the index file.
+	 */
+	static inline std::string sidecar(const std::string& pcap_file) noexcept {
+		return pcap_file + ".idx";
+	}
+
+	void write(const std::string& index_file) const noexcept(false) {
+		FileHeader header;
+		memset(&header, 0, sizeof(header));
+		header.magic = MAGIC;
+		header.pcap_bytes = m_pcap_bytes;
+		header.end = m_end;
+		header.frames = m_frames;
+		header.entries = m_entries.size();
+		header.every_ns = m_every_ns;
+		header.every_frames = m_every_frames;
+
+		const int fd = ::open(index_file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if(fd < 0) {
+			throw std::runtime_error(index_file + ": " + strerror(errno));
+		}
+		int error = write_all(fd, &header, sizeof(header));
+		if(error == 0 && not m_entries.empty()) {
+			error = write_all(fd, m_entries.data(), m_entries.size() * sizeof(PcapIndexEntry));
+		}
+		if(::close(fd) != 0 && error == 0) {
+			error = errno;
+		}
+		if(error) {
+			unlink(index_file.c_str()); // not a truncated index
+			throw std::runtime_error(index_file + ": " + strerror(error));
+		}
+	}
+
+	/**
+	 * Load the index of a pcap file.
+	 * @param pcap_bytes - the size of the pcap file, MappedReader::bytes().
+	 */
+	static PcapIndex load(const std::string& index_file, size_t pcap_bytes) noexcept(false) {
+		const int fd = ::open(index_file.c_str(), O_RDONLY);
+		if(fd < 0) {
+			throw std::runtime_error(index_file + ": " + strerror(errno));
+		}
+		FileHeader header;
+		struct stat st;
+		int error = read_all(fd, &header, sizeof(header));
+		if(error == 0 && fstat(fd, &st) != 0) {
+			error = errno;
+		}
+		if(error) {
+			::close(fd);
+			throw std::runtime_error(index_file + ": " + strerror(error));
+		}
+		if(header.magic != MAGIC || uint64_t(st.st_size) != sizeof(header) + header.entries * sizeof(PcapIndexEntry)) {
+			::close(fd);
+			throw std::runtime_error(index_file + ": not a pcap index");
+		}
+		if(header.pcap_bytes != pcap_bytes) {
+			::close(fd);
+			throw std::runtime_error(index_file + ": the index is stale");
+		}
+
+		PcapIndex result(header.pcap_bytes, header.every_frames, header.every_ns);
+		result.m_end = header.end;
+		result.m_frames = header.frames;
+		result.m_entries.resize(header.entries);
+		error = read_all(fd, result.m_entries.data(), header.entries * sizeof(PcapIndexEntry));
+		::close(fd);
+		if(error) {
+			throw std::runtime_error(index_file + ": " + strerror(error));
+		}
+		if(not result.valid()) {
+			throw std::runtime_error(index_file + ": not a pcap index");
+		}
+		return result;
+	}
+
+	/**
+	 * @return the first chunk which may have a frame of @ns or later, size() - if there is none.
+	 */
+	size_t find_time(uint64_t ns) const noexcept {
+		for(size_t i = 0; i < m_entries.size(); i++) {
+			if(m_entries[i].ts_max >= ns) {
+				return i;
+			}
+		}
+		return m_entries.size();
+	}
+
+	/**
+	 * @return the last chunk which may have a frame before @ns, size() - if there is none.
+	 */
+	size_t find_time_end(uint64_t ns) const noexcept {
+		for(size_t i = m_entries.size(); i > 0; i--) {
+			if(m_entries[i - 1].ts_min < ns) {
+				return i - 1;
+			}
+		}
+		return m_entries.size();
+	}
+
+	/**
+	 * @param frame_idx - as Frame::m_idx, from 1.
+	 * @return the chunk of the frame, size() - if there is no such frame.
+	 */
+	size_t find_frame(uint64_t frame_idx) const noexcept {
+		if(frame_idx == 0 || frame_idx > m_frames || m_entries.empty())
+			return m_entries.size();
+
+		size_t low = 0;
+		size_t high = m_entries.size(); // the chunk is the last one with frame_idx before the frame
+		while(high - low > 1) {
+			const size_t middle = low + (high - low) / 2;
+			if(m_entries[middle].frame_idx < frame_idx) {
+				low = middle;
+			} else {
+				high = middle;
+			}
+		}
+		return low;
+	}
+
+	inline const PcapIndexEntry& operator[](size_t chunk) const noexcept {
+		return m_entries[chunk];
+	}
+
+	/**
+	 * @return the offset past the last record of a chunk.
+	 */
+	inline uint64_t end_offset(size_t chunk) const noexcept {
+		return chunk + 1 < m_entries.size() ? m_entries[chunk + 1].offset : m_end;
+	}
+
+	/**
+	 * @return amount of the chunks.
+	 */
+	inline size_t size() const noexcept {
+		return m_entries.size();
+	}
+
+	inline uint64_t frames() const noexcept {
+		return m_frames;
+	}
+
+	/**
+	 * @return the size of the indexed file.
+	 */
+	inline uint64_t pcap_bytes() const noexcept {
+		return m_pcap_bytes;
+	}
+
+private:
+
+	/**
+	 * @return true - if the offsets and the frame indices grow and the timestamp ranges are not reversed.
+	 */
+	bool valid() const noexcept {
+		uint64_t offset = 0;
+		uint64_t frame_idx = 0;
+		for(size_t i = 0; i < m_entries.size(); i++) {
+			const PcapIndexEntry& entry = m_entries[i];
+			if((i && (entry.offset <= offset || entry.frame_idx <= frame_idx)) || entry.offset >= m_end || m_end > m_pcap_bytes
+			   || entry.frame_idx >= m_frames || entry.ts_min > entry.ts_max) {
+				return false;
+			}
+			offset = entry.offset;
+			frame_idx = entry.frame_idx;
+		}
+		return true;
+	}
+
+	static int write_all(int fd, const void* data, size_t bytes) noexcept {
+		size_t written = 0;
+		while(written < bytes) {
+			const ssize_t result = ::write(fd, static_cast<const uint8_t*>(data) + written, bytes - written);
+			if(result < 0) {
+				if(errno == EINTR)
+					continue;
+				return errno;
+			}
+			written += size_t(result);
+		}
+		return 0;
+	}
+
+	static int read_all(int fd, void* data, size_t bytes) noexcept {
+		size_t done = 0;
+		while(done < bytes) {
+			const ssize_t result = ::read(fd, static_cast<uint8_t*>(data) + done, bytes - done);
+			if(result < 0) {
+				if(errno == EINTR)
+					continue;
+				return errno;
+			}
+			if(result == 0) {
+				return EINVAL; // truncated
+			}
+			done += size_t(result);
+		}
+		return 0;
+	}
+};
+
+}; // namespace pcapwrap
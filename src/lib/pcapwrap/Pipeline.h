@@ -0,0 +1,322 @@
+#pragma once
+
+#include "MappedReader.h"
+#include "../proto/parsers/ParsedPacket.h"
+#include "../containers/intrusive_pool/ConcurrentPool.h"
+#include "../containers/storage/Sketch.h"
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/stat.h>
+
+namespace pcapwrap {
+
+struct PipelineStat {
+	uint64_t frames; // processed by the worker of the thread
+	uint64_t bytes; // captured bytes of the processed frames
+	uint64_t parts; // read by the thread
+	uint64_t forwarded; // to the workers of the other threads
+	double seconds;
+
+	PipelineStat() noexcept : frames(0), bytes(0), parts(0), forwarded(0), seconds(0) {}
+
+	inline double frames_per_second() const noexcept {
+		return seconds > 0 ? frames / seconds : 0;
+	}
+
+	inline double bits_per_second() const noexcept {
+		return seconds > 0 ? bytes * 8 / seconds : 0;
+	}
+};
+
+/**
+ * A multi-threaded reader of a set of pcap files, e.g. of rotated captures.
+ * The files larger than part_bytes are split into byte ranges (see MappedReader), the files and the parts
+ * are the tasks which the threads take one by one, so a long file doesn't hold up the others.
+ * Every thread has its own worker, the results of the workers are merged by merge() after run().
+ * The flow affinity mode forwards a frame to the worker selected by the symmetric hash of its 5-tuple,
+ * so both directions of a flow meet in the same worker. The frames are handed over by SpscRing of every
+ * pair of threads and they point into the mappings, which are kept until all the threads have finished.
+ *
+ * @tparam W - a default constructible worker with void process(const Frame&) noexcept and void merge(const W&).
+ */
+template<typename W>
+class Pipeline {
+public:
+	static constexpr size_t BURST = 32;
+	static constexpr size_t QUEUE = 1024; // the frames in flight from one thread to another
+
+private:
+	/**
+	 * The frames are kept in twice as many slots as the ring has, so a slot is overwritten
+	 * only after the consumer has copied the frame out of it.
+	 */
+	class FrameQueue {
+		intrusive::SpscRing<> m_ring;
+		std::vector<Frame> m_frames;
+		size_t m_pushed;
+
+	public:
+		FrameQueue(size_t capacity) noexcept : m_ring(capacity), m_frames(), m_pushed(0) {}
+
+		int allocate() noexcept(false) {
+			if(m_ring.allocate())
+				return -1;
+
+			m_frames.resize(m_ring.capacity() * 2);
+			return 0;
+		}
+
+		inline bool push(const Frame& frame) noexcept {
+			const uint32_t slot = uint32_t(m_pushed & (m_frames.size() - 1));
+			m_frames[slot] = frame;
+			if(not m_ring.push(slot))
+				return false;
+
+			m_pushed++;
+			return true;
+		}
+
+		inline bool pop(Frame& frame) noexcept {
+			uint32_t slot;
+			if(not m_ring.pop(slot))
+				return false;
+
+			frame = m_frames[slot];
+			return true;
+		}
+	};
+
+	struct Context {
+		W worker;
+		PipelineStat stat;
+
+		Context() : worker(), stat() {}
+	};
+
+	const unsigned m_threads;
+	const size_t m_part_bytes;
+	const bool m_affinity;
+	std::vector<std::string> m_files;
+	std::vector<MappedReader> m_readers;
+	std::vector<std::unique_ptr<Context> > m_contexts;
+	std::deque<FrameQueue> m_queues; // from * m_threads + to
+	std::atomic<size_t> m_next_reader;
+	std::atomic<unsigned> m_reading; // the threads which have not finished their tasks
+
+public:
+
+	/**
+	 * @param threads - amount of the threads, the calling thread is one of them.
+	 * @param part_bytes - a file is split into parts of this size at least, 0 - to read every file by one thread.
+	 * @param affinity - true to process every flow by one worker.
+	 */
+	Pipeline(unsigned threads, size_t part_bytes = 0, bool affinity = false) noexcept
+		: m_threads(threads ? threads : 1)
+		, m_part_bytes(part_bytes)
+		, m_affinity(affinity && m_threads > 1)
+		, m_files()
+		, m_readers()
+		, m_contexts()
+		, m_queues()
+		, m_next_reader(0)
+		, m_reading(0) {}
+
+	Pipeline(const Pipeline&) = delete;
+	Pipeline& operator=(const Pipeline&) = delete;
+
+	Pipeline(Pipeline&&) = delete;
+	Pipeline& operator=(Pipeline&&) = delete;
+
+	virtual ~Pipeline() noexcept {}
+
+	inline void add(const std::string& file_name) noexcept(false) {
+		m_files.push_back(file_name);
+	}
+
+	/**
+	 * Read all the added files, the workers of the previous run are dropped.
+	 * A file which can't be opened throws std::runtime_error before any thread has started.
+	 * @return amount of the processed frames.
+	 */
+	uint64_t run() noexcept(false) {
+		m_readers.clear();
+		for(const std::string& file_name : m_files) {
+			const size_t parts = split(file_name);
+			for(size_t part = 0; part < parts; part++) {
+				m_readers.push_back(MappedReader::open(file_name, part, parts));
+			}
+		}
+
+		m_contexts.clear();
+		for(unsigned i = 0; i < m_threads; i++) {
+			m_contexts.emplace_back(new Context());
+		}
+		m_queues.clear();
+		if(m_affinity) {
+			for(unsigned i = 0; i < m_threads * m_threads; i++) {
+				m_queues.emplace_back(size_t(QUEUE));
+				if(m_queues.back().allocate()) {
+					throw std::runtime_error("pipeline: the queues can't be allocated");
+				}
+			}
+		}
+		m_next_reader.store(0);
+		m_reading.store(m_threads);
+
+		std::vector<std::thread> threads;
+		for(unsigned i = 1; i < m_threads; i++) {
+			threads.emplace_back(&Pipeline::work, this, i);
+		}
+		work(0);
+		for(std::thread& thread : threads) {
+			thread.join();
+		}
+		m_readers.clear();
+
+		uint64_t result = 0;
+		for(const std::unique_ptr<Context>& context : m_contexts) {
+			result += context->stat.frames;
+		}
+		return result;
+	}
+
+	/**
+	 * Merge the results of all the workers of the last run().
+	 */
+	void merge(W& result) const noexcept {
+		for(const std::unique_ptr<Context>& context : m_contexts) {
+			result.merge(context->worker);
+		}
+	}
+
+	inline W& worker(unsigned thread) noexcept {
+		return m_contexts[thread]->worker;
+	}
+
+	inline const PipelineStat& stat(unsigned thread) const noexcept {
+		return m_contexts[thread]->stat;
+	}
+
+	inline unsigned threads() const noexcept {
+		return m_threads;
+	}
+
+	/**
+	 * The same hash for both directions of a flow, 0 - for the frames without IP.
+	 */
+	static inline uint64_t flow_hash(const Frame& frame) noexcept {
+		proto::ParsedPacket pkt;
+		proto::PacketParser::parse(frame.m_data, frame.m_hdr.caplen, pkt);
+		return flow_hash(pkt);
+	}
+
+	static uint64_t flow_hash(const proto::ParsedPacket& pkt) noexcept {
+		if(pkt.ip_version == 0) {
+			return 0;
+		}
+		const uint64_t src = ((pkt.src.addr64[0] ^ pkt.src.addr64[1]) << 16) | pkt.src_port;
+		const uint64_t dst = ((pkt.dst.addr64[0] ^ pkt.dst.addr64[1]) << 16) | pkt.dst_port;
+		const uint64_t low = src < dst ? src : dst;
+		const uint64_t high = src < dst ? dst : src;
+		return storage::SketchHash::mix(storage::SketchHash::mix(low ^ pkt.ip_protocol) + high);
+	}
+
+private:
+
+	size_t split(const std::string& file_name) const noexcept {
+		struct stat st;
+		if(m_part_bytes == 0 || ::stat(file_name.c_str(), &st) != 0) {
+			return 1;
+		}
+		const size_t parts = size_t(st.st_size) / m_part_bytes;
+		return parts ? parts : 1;
+	}
+
+	void work(unsigned self) noexcept {
+		Context& context = *m_contexts[self];
+		const auto start = std::chrono::steady_clock::now();
+		Frame frames[BURST];
+		proto::ParsedPacket packets[BURST];
+
+		for(size_t task = m_next_reader++; task < m_readers.size(); task = m_next_reader++) {
+			MappedReader& reader = m_readers[task];
+			context.stat.parts++;
+			size_t burst = 0;
+			while((burst = reader.next_burst(frames, BURST))) {
+				if(m_affinity) {
+					proto::PacketParser::parse_burst(frames, burst, packets);
+				}
+				for(size_t i = 0; i < burst; i++) {
+					dispatch(self, frames[i], packets[i]);
+				}
+				if(m_affinity) {
+					drain(self);
+				}
+			}
+		}
+
+		if(m_affinity) {
+			m_reading.fetch_sub(1, std::memory_order_release);
+			while(m_reading.load(std::memory_order_acquire)) {
+				if(drain(self) == 0) {
+					std::this_thread::yield();
+				}
+			}
+			drain(self);
+		}
+		context.stat.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	inline void dispatch(unsigned self, const Frame& frame, const proto::ParsedPacket& pkt) noexcept {
+		if(m_affinity) {
+			const unsigned owner = unsigned(flow_hash(pkt) % m_threads);
+			if(owner != self) {
+				FrameQueue& queue = m_queues[self * m_threads + owner];
+				while(not queue.push(frame)) {
+					if(drain(self) == 0) {
+						std::this_thread::yield();
+					}
+				}
+				m_contexts[self]->stat.forwarded++;
+				return;
+			}
+		}
+		process(self, frame);
+	}
+
+	/**
+	 * Process the frames forwarded to the worker of the thread.
+	 * @return amount of the processed frames.
+	 */
+	size_t drain(unsigned self) noexcept {
+		size_t result = 0;
+		Frame frame;
+		for(unsigned from = 0; from < m_threads; from++) {
+			if(from != self) {
+				FrameQueue& queue = m_queues[from * m_threads + self];
+				while(queue.pop(frame)) {
+					process(self, frame);
+					result++;
+				}
+			}
+		}
+		return result;
+	}
+
+	inline void process(unsigned self, const Frame& frame) noexcept {
+		Context& context = *m_contexts[self];
+		context.worker.process(frame);
+		context.stat.frames++;
+		context.stat.bytes += frame.m_hdr.caplen;
+	}
+
+};
+
+}; // namespace pcapwrap
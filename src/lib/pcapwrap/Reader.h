@@ -1,23 +1,27 @@
 #pragma once
 
 #include "Frame.h"
+#include "Filter.h"
 
 #include <exception>
 #include <stdexcept>
+#include <utility>
 
 namespace pcapwrap {
 
 class Reader {
 	pcap_t* m_pcap_hnd;
 	uint64_t m_frame_idx;
+	Filter m_filter;
 
-	explicit Reader(pcap_t* handler) noexcept : m_pcap_hnd(handler), m_frame_idx(0) {}
+	explicit Reader(pcap_t* handler) noexcept : m_pcap_hnd(handler), m_frame_idx(0), m_filter() {}
 
 public:
 	Reader(const Reader&) = delete;
 	Reader& operator=(const Reader&) = delete;
 
-	Reader(Reader&& rvalue) noexcept : m_pcap_hnd(rvalue.m_pcap_hnd), m_frame_idx(rvalue.m_frame_idx) {
+	Reader(Reader&& rvalue) noexcept
+		: m_pcap_hnd(rvalue.m_pcap_hnd), m_frame_idx(rvalue.m_frame_idx), m_filter(std::move(rvalue.m_filter)) {
 		rvalue.clear();
 	}
 
@@ -26,6 +30,7 @@ public:
 			close();
 			m_pcap_hnd = rvalue.m_pcap_hnd;
 			m_frame_idx = rvalue.m_frame_idx;
+			m_filter = std::move(rvalue.m_filter);
 			rvalue.clear();
 		}
 		return *this;
@@ -42,19 +47,40 @@ public:
 		}
 	}
 
+	/**
+	 * Read the next frame which passes filter(), the index of a frame counts the skipped frames too.
+	 */
 	inline bool next(Frame& frame) noexcept {
-		frame.m_data = pcap_next(m_pcap_hnd, &(frame.m_hdr));
-		if(frame.m_data) {
+		do {
+			frame.m_data = pcap_next(m_pcap_hnd, &(frame.m_hdr));
+			if(frame.m_data == nullptr) {
+				return false;
+			}
 			m_frame_idx++;
 			frame.m_idx = m_frame_idx;
-		}
-		return (frame.m_data != nullptr);
+		} while(not m_filter.accept(frame));
+		return true;
 	}
 
 	inline uint64_t frame_index() const noexcept {
 		return m_frame_idx;
 	}
 
+	/**
+	 * @return the filter of the frames, it passes all of them until it is set up.
+	 */
+	inline Filter& filter() noexcept {
+		return m_filter;
+	}
+
+	inline int linktype() const noexcept {
+		return pcap_datalink(m_pcap_hnd);
+	}
+
+	inline int snaplen() const noexcept {
+		return pcap_snapshot(m_pcap_hnd);
+	}
+
 	static Reader open(const std::string& file_name) noexcept(false) {
 		char error_buffer[PCAP_ERRBUF_SIZE];
 		auto pcap_handler = pcap_open_offline_with_tstamp_precision(file_name.c_str(), PCAP_TSTAMP_PRECISION_NANO, error_buffer);
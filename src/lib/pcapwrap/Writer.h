@@ -53,12 +53,20 @@ public:
 		return m_frame_idx;
 	}
 
-	static Writer open(const std::string& file_name) noexcept(false) {
-		char error_buffer[PCAP_ERRBUF_SIZE];
-		auto pcap_handler = pcap_open_dead_with_tstamp_precision(DLT_EN10MB, SNAPSHOT_LEN, PCAP_TSTAMP_PRECISION_NANO);
+	/**
+	 * @param linktype - of the frames, e.g. of Reader::linktype() or NgReader::Interface, see NgWriter for
+	 * several interfaces.
+	 */
+	static Writer open(const std::string& file_name, int linktype = DLT_EN10MB) noexcept(false) {
+		auto pcap_handler = pcap_open_dead_with_tstamp_precision(linktype, SNAPSHOT_LEN, PCAP_TSTAMP_PRECISION_NANO);
+		if(pcap_handler == nullptr) {
+			throw std::runtime_error(file_name + ": pcap_open_dead() has failed");
+		}
 		auto result = pcap_dump_open(pcap_handler, file_name.c_str());
 		if(result == nullptr) {
-			throw std::runtime_error(error_buffer);
+			std::string error = file_name + ": " + pcap_geterr(pcap_handler);
+			pcap_close(pcap_handler);
+			throw std::runtime_error(error);
 		}
 		return Writer(result);
 	}
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+namespace pipeline {
+
+/**
+ * A fixed-size batch of items, the unit which moves from one stage to another.
+ * @tparam T - a default constructible and copy assignable item, e.g. proto::ParsedPacket or storage::FlowRecord.
+ * @tparam N - the items of a batch.
+ */
+template<typename T, size_t N = 32>
+struct Batch {
+	static constexpr size_t CAPACITY = N;
+
+	size_t count;
+	T items[N];
+
+	Batch() : count(0), items() {}
+
+	inline bool full() const noexcept {
+		return count == N;
+	}
+
+	inline void push(const T& item) noexcept {
+		items[count++] = item;
+	}
+
+	inline const T* begin() const noexcept {
+		return items;
+	}
+
+	inline const T* end() const noexcept {
+		return items + count;
+	}
+};
+
+/**
+ * A single producer single consumer ring of batches, a batch is filled in its slot and read in place,
+ * so nothing is copied between the cores but the items themselves once.
+ * As intrusive::SpscRing does, the producer and the consumer keep their positions on their own cache lines
+ * and cache the position of the other side.
+ *
+ * Using sample:
+ * // the producer
+ * if(B* batch = ring.claim()) {
+ *     batch->count = 0;
+ *     ... fill
+ *     ring.publish();
+ * }
+ * // the consumer
+ * if(const B* batch = ring.front()) {
+ *     ... read
+ *     ring.pop();
+ * }
+ *
+ * @tparam B - a batch, e.g. Batch<T, N>.
+ */
+template<typename B, typename A = std::allocator<B> >
+class BatchRing {
+	const size_t m_capacity; // a power of two
+	const size_t m_mask;
+	B* m_slots;
+	A m_allocator;
+
+	alignas(64) std::atomic<size_t> m_tail; // the producer position
+	size_t m_head_cached;
+
+	alignas(64) std::atomic<size_t> m_head; // the consumer position
+	size_t m_tail_cached;
+
+public:
+
+	/**
+	 * @param capacity - amount of the batches, it is rounded up to a power of two.
+	 */
+	BatchRing(size_t capacity) noexcept
+		: m_capacity(round_up(capacity))
+		, m_mask(m_capacity - 1)
+		, m_slots(nullptr)
+		, m_allocator()
+		, m_tail(0)
+		, m_head_cached(0)
+		, m_head(0)
+		, m_tail_cached(0) {}
+
+	BatchRing(const BatchRing&) = delete;
+	BatchRing& operator=(const BatchRing&) = delete;
+
+	BatchRing(BatchRing&& rv) = delete;
+	BatchRing& operator=(BatchRing&&) = delete;
+
+	virtual ~BatchRing() noexcept {
+		if(m_slots) {
+			for(size_t i = 0; i < m_capacity; i++) {
+				m_allocator.destroy(m_slots + i);
+			}
+			m_allocator.deallocate(m_slots, m_capacity);
+			m_slots = nullptr;
+		}
+	}
+
+	/**
+	 * @return 0 - if the slots have been allocated successfully.
+	 */
+	int allocate() noexcept(false) {
+		if(m_slots)
+			return -1;
+
+		m_slots = m_allocator.allocate(m_capacity);
+		if(m_slots == nullptr)
+			return -1;
+
+		for(size_t i = 0; i < m_capacity; i++) {
+			m_allocator.construct(m_slots + i);
+		}
+		return 0;
+	}
+
+	/**
+	 * The producer side, the slot keeps the batch of the previous round.
+	 * @return the slot to fill, nullptr - if the ring is full.
+	 */
+	inline B* claim() noexcept {
+		const size_t tail = m_tail.load(std::memory_order_relaxed);
+		if(tail - m_head_cached == m_capacity) {
+			m_head_cached = m_head.load(std::memory_order_acquire);
+			if(tail - m_head_cached == m_capacity)
+				return nullptr;
+		}
+		return m_slots + (tail & m_mask);
+	}
+
+	/**
+	 * Hand the claimed slot over to the consumer.
+	 */
+	inline void publish() noexcept {
+		m_tail.store(m_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	/**
+	 * The consumer side.
+	 * @return the oldest batch, nullptr - if the ring is empty.
+	 */
+	inline const B* front() noexcept {
+		const size_t head = m_head.load(std::memory_order_relaxed);
+		if(head == m_tail_cached) {
+			m_tail_cached = m_tail.load(std::memory_order_acquire);
+			if(head == m_tail_cached)
+				return nullptr;
+		}
+		return m_slots + (head & m_mask);
+	}
+
+	/**
+	 * Give the slot of front() back to the producer.
+	 */
+	inline void pop() noexcept {
+		m_head.store(m_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	inline size_t capacity() const noexcept {
+		return m_capacity;
+	}
+
+	/**
+	 * @return amount of the batches in the ring, it is approximate while the ring is in use.
+	 */
+	inline size_t size() const noexcept {
+		return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+	}
+
+private:
+
+	static inline size_t round_up(size_t capacity) noexcept {
+		size_t result = 1;
+		while(result < capacity) {
+			result <<= 1;
+		}
+		return result;
+	}
+
+};
+
+}; // namespace pipeline
@@ -0,0 +1,319 @@
+#pragma once
+
+#include "Batch.h"
+
+#include <atomic>
+#include <deque>
+#include <thread>
+#include <vector>
+
+namespace pipeline {
+
+/**
+ * What a producer does when the ring to a consumer is full.
+ */
+enum class Backpressure {
+	BLOCK, // wait for the consumer, the stall propagates back to the source
+	DROP // drop the item, e.g. to keep the capture going while an exporter is slow
+};
+
+struct OutletStat {
+	uint64_t items; // accepted by emit()
+	uint64_t batches; // published
+	uint64_t stalls; // a ring has been full when a batch has been claimed
+	uint64_t dropped; // the items of Backpressure::DROP
+
+	OutletStat() noexcept : items(0), batches(0), stalls(0), dropped(0) {}
+};
+
+struct InletStat {
+	uint64_t items;
+	uint64_t batches;
+	uint64_t empty_polls;
+
+	InletStat() noexcept : items(0), batches(0), empty_polls(0) {}
+};
+
+/**
+ * The connection of two stages: every instance of the producer stage (an outlet, one per worker thread)
+ * has a BatchRing to every instance of the consumer stage (an inlet), so a ring has a single producer and
+ * a single consumer and the threads share nothing but the rings.
+ * An item is routed by its hash to one consumer, e.g. by the symmetric flow hash (pcapwrap::Pipeline::flow_hash),
+ * so both directions of a flow meet in the same table of the consumer stage without locks.
+ * The items are batched per consumer in the slot of the ring, a partial batch is published by flush(), which
+ * is called at the end of every burst of the producer. The stages must form no cycle with Backpressure::BLOCK.
+ * A producer which has finished calls close(), the consumers see finished() after the last batch.
+ *
+ * Using sample:
+ * pipeline::Link<proto::ParsedPacket> parsed(readers, tables);
+ * if(parsed.allocate()) {...}
+ * // a reader thread
+ * auto& out = parsed.outlet(id);
+ * for(size_t i = 0; i < n; i++) {
+ *     out.emit(packets[i], pcapwrap::Pipeline<W>::flow_hash(packets[i]));
+ * }
+ * out.flush();
+ * // a table thread
+ * parsed.inlet(id).poll([&](const pipeline::Batch<proto::ParsedPacket>& batch) {...});
+ *
+ * @tparam T - the item, see Batch.
+ * @tparam N - the items of a batch.
+ */
+template<typename T, size_t N = 32>
+class Link {
+public:
+	using Batch_t = Batch<T, N>;
+	using Ring = BatchRing<Batch_t>;
+
+	constexpr static unsigned BLOCK_SPINS = 64; // before a blocked producer yields
+
+	/**
+	 * The producer side of an instance of the producer stage.
+	 */
+	class Outlet {
+		friend class Link;
+
+		Link* m_link;
+		unsigned m_self;
+		std::vector<Batch_t*> m_batches; // the claimed slot of every consumer, nullptr - none
+		OutletStat m_stat;
+		bool m_closed;
+
+		Outlet(Link* link, unsigned self) noexcept(false)
+			: m_link(link)
+			, m_self(self)
+			, m_batches(link->m_consumers, nullptr)
+			, m_stat()
+			, m_closed(false) {}
+
+	public:
+
+		/**
+		 * Route @item to the consumer of @hash.
+		 * @return false - if the item has been dropped.
+		 */
+		inline bool emit(const T& item, uint64_t hash) noexcept {
+			return emit_to(unsigned(hash % m_link->m_consumers), item);
+		}
+
+		bool emit_to(unsigned consumer, const T& item) noexcept {
+			Batch_t*& batch = m_batches[consumer];
+			if(batch == nullptr) {
+				batch = claim(m_link->ring(m_self, consumer));
+				if(batch == nullptr) {
+					m_stat.dropped++;
+					return false;
+				}
+				batch->count = 0;
+			}
+			batch->push(item);
+			m_stat.items++;
+			if(batch->full()) {
+				m_link->ring(m_self, consumer).publish();
+				m_stat.batches++;
+				batch = nullptr;
+			}
+			return true;
+		}
+
+		/**
+		 * Publish the partial batches.
+		 */
+		void flush() noexcept {
+			for(unsigned consumer = 0; consumer < m_link->m_consumers; consumer++) {
+				if(m_batches[consumer]) {
+					m_link->ring(m_self, consumer).publish();
+					m_stat.batches++;
+					m_batches[consumer] = nullptr;
+				}
+			}
+		}
+
+		/**
+		 * Flush and finish the producer, it emits nothing after it.
+		 */
+		void close() noexcept {
+			if(not m_closed) {
+				flush();
+				m_closed = true;
+				m_link->m_open.fetch_sub(1, std::memory_order_release);
+			}
+		}
+
+		inline const OutletStat& stat() const noexcept {
+			return m_stat;
+		}
+
+	private:
+
+		Batch_t* claim(Ring& ring) noexcept {
+			Batch_t* result = ring.claim();
+			if(result) {
+				return result;
+			}
+			m_stat.stalls++;
+			if(m_link->m_backpressure == Backpressure::DROP) {
+				return nullptr;
+			}
+			for(unsigned spins = 0; (result = ring.claim()) == nullptr; spins++) {
+				if(spins < BLOCK_SPINS) {
+#if defined(__x86_64__) || defined(__i386__)
+					__builtin_ia32_pause();
+#endif
+				} else {
+					std::this_thread::yield();
+				}
+			}
+			return result;
+		}
+	};
+
+	/**
+	 * The consumer side of an instance of the consumer stage.
+	 */
+	class Inlet {
+		friend class Link;
+
+		Link* m_link;
+		unsigned m_self;
+		InletStat m_stat;
+
+		Inlet(Link* link, unsigned self) noexcept : m_link(link), m_self(self), m_stat() {}
+
+	public:
+
+		/**
+		 * Take a batch of every producer which has one.
+		 * @param consume - void(const Batch_t&), the batch is valid during the call.
+		 * @return amount of the consumed items.
+		 */
+		template<typename F>
+		size_t poll(F&& consume) noexcept {
+			size_t result = 0;
+			for(unsigned producer = 0; producer < m_link->m_producers; producer++) {
+				Ring& ring = m_link->ring(producer, m_self);
+				if(const Batch_t* batch = ring.front()) {
+					consume(*batch);
+					result += batch->count;
+					m_stat.batches++;
+					ring.pop();
+				}
+			}
+			m_stat.items += result;
+			m_stat.empty_polls += result == 0;
+			return result;
+		}
+
+		/**
+		 * @return true - if all the producers have been closed and their batches have been consumed.
+		 */
+		bool finished() noexcept {
+			if(m_link->m_open.load(std::memory_order_acquire)) {
+				return false;
+			}
+			for(unsigned producer = 0; producer < m_link->m_producers; producer++) {
+				if(m_link->ring(producer, m_self).front()) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		inline const InletStat& stat() const noexcept {
+			return m_stat;
+		}
+	};
+
+private:
+	const unsigned m_producers;
+	const unsigned m_consumers;
+	const size_t m_ring_batches;
+	const Backpressure m_backpressure;
+	std::deque<Ring> m_rings; // producer * m_consumers + consumer
+	std::vector<Outlet> m_outlets;
+	std::vector<Inlet> m_inlets;
+	std::atomic<unsigned> m_open; // the producers which have not been closed
+
+public:
+
+	/**
+	 * @param producers - the instances of the producer stage.
+	 * @param consumers - the instances of the consumer stage.
+	 * @param ring_batches - the batches in flight from a producer to a consumer.
+	 */
+	Link(unsigned producers, unsigned consumers, size_t ring_batches = 64,
+			Backpressure backpressure = Backpressure::BLOCK) noexcept
+		: m_producers(producers ? producers : 1)
+		, m_consumers(consumers ? consumers : 1)
+		, m_ring_batches(ring_batches)
+		, m_backpressure(backpressure)
+		, m_rings()
+		, m_outlets()
+		, m_inlets()
+		, m_open(m_producers) {}
+
+	Link(const Link&) = delete;
+	Link& operator=(const Link&) = delete;
+
+	Link(Link&&) = delete;
+	Link& operator=(Link&&) = delete;
+
+	virtual ~Link() noexcept {}
+
+	/**
+	 * @return 0 - if the rings have been allocated successfully.
+	 */
+	int allocate() noexcept(false) {
+		if(not m_rings.empty())
+			return -1;
+
+		for(unsigned i = 0; i < m_producers * m_consumers; i++) {
+			m_rings.emplace_back(m_ring_batches);
+			if(m_rings.back().allocate())
+				return -1;
+		}
+		for(unsigned i = 0; i < m_producers; i++) {
+			m_outlets.push_back(Outlet(this, i));
+		}
+		for(unsigned i = 0; i < m_consumers; i++) {
+			m_inlets.push_back(Inlet(this, i));
+		}
+		return 0;
+	}
+
+	inline Outlet& outlet(unsigned producer) noexcept {
+		return m_outlets[producer];
+	}
+
+	inline Inlet& inlet(unsigned consumer) noexcept {
+		return m_inlets[consumer];
+	}
+
+	inline unsigned producers() const noexcept {
+		return m_producers;
+	}
+
+	inline unsigned consumers() const noexcept {
+		return m_consumers;
+	}
+
+	/**
+	 * @return the batches waiting for @consumer, it is approximate while the link is in use.
+	 */
+	size_t backlog(unsigned consumer) const noexcept {
+		size_t result = 0;
+		for(unsigned producer = 0; producer < m_producers; producer++) {
+			result += m_rings[producer * m_consumers + consumer].size();
+		}
+		return result;
+	}
+
+private:
+
+	inline Ring& ring(unsigned producer, unsigned consumer) noexcept {
+		return m_rings[producer * m_consumers + consumer];
+	}
+
+};
+
+}; // namespace pipeline
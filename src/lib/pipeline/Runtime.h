@@ -0,0 +1,196 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <pthread.h>
+#include <sched.h>
+
+namespace pipeline {
+
+struct WorkerStat {
+	uint64_t steps;
+	uint64_t busy_steps; // the steps which have done some work
+	uint64_t items; // the sum of the results of the steps
+	double seconds;
+	bool pinned; // the thread runs on its CPU only
+
+	WorkerStat() noexcept : steps(0), busy_steps(0), items(0), seconds(0), pinned(false) {}
+
+	inline double utilization() const noexcept {
+		return steps ? double(busy_steps) / double(steps) : 0;
+	}
+};
+
+/**
+ * The worker threads of a run-to-completion pipeline: every worker runs the step of its stage instance
+ * in a loop on its own core, the stages exchange the batches through Link, so a multi-core analyzer is
+ * a set of steps and links rather than threading code.
+ * A step returns the amount of the items it has processed, 0 - if it has been idle, the worker spins and then
+ * yields while it is idle, or DONE when the stage instance has finished, e.g. a source at the end of its
+ * capture which has closed its outlet, or a consumer which sees finished() of its inlet.
+ * The stats of the workers are read after join().
+ *
+ * Using sample:
+ * pipeline::Link<proto::ParsedPacket> parsed(2, 2);
+ * parsed.allocate();
+ * pipeline::Runtime runtime;
+ * for(unsigned id = 0; id < 2; id++) {
+ *     runtime.add(int(id), [&, id]() {
+ *         const size_t n = readers[id].next_burst(frames, BURST);
+ *         if(n == 0) {
+ *             parsed.outlet(id).close();
+ *             return pipeline::Runtime::DONE;
+ *         }
+ *         ... parse and emit()
+ *         parsed.outlet(id).flush();
+ *         return int(n);
+ *     });
+ *     runtime.add(int(2 + id), [&, id]() {
+ *         pipeline::Link<proto::ParsedPacket>::Inlet& in = parsed.inlet(id);
+ *         const size_t n = in.poll([&](const pipeline::Batch<proto::ParsedPacket>& batch) {...});
+ *         return n == 0 && in.finished() ? pipeline::Runtime::DONE : int(n);
+ *     });
+ * }
+ * runtime.start();
+ * runtime.join();
+ */
+class Runtime {
+public:
+	constexpr static int DONE = -1;
+	constexpr static unsigned IDLE_SPINS = 64; // the idle steps before a worker yields
+
+	using Step = std::function<int()>;
+
+private:
+	struct Worker {
+		Step step;
+		int cpu; // -1 - not pinned
+		WorkerStat stat;
+		std::thread thread;
+
+		Worker(Step&& step_, int cpu_) : step(std::move(step_)), cpu(cpu_), stat(), thread() {}
+	};
+
+	std::vector<std::unique_ptr<Worker> > m_workers;
+	std::atomic<bool> m_stop;
+	std::atomic<unsigned> m_running;
+
+public:
+
+	Runtime() noexcept : m_workers(), m_stop(false), m_running(0) {}
+
+	Runtime(const Runtime&) = delete;
+	Runtime& operator=(const Runtime&) = delete;
+
+	Runtime(Runtime&&) = delete;
+	Runtime& operator=(Runtime&&) = delete;
+
+	virtual ~Runtime() noexcept {
+		stop();
+		join();
+	}
+
+	/**
+	 * Add a worker before start().
+	 * @param cpu - the CPU to pin the worker to, -1 - any.
+	 * @param step - int() noexcept, see DONE.
+	 * @return the index of the worker.
+	 */
+	template<typename F>
+	unsigned add(int cpu, F&& step) noexcept(false) {
+		m_workers.emplace_back(new Worker(Step(std::forward<F>(step)), cpu));
+		return unsigned(m_workers.size() - 1);
+	}
+
+	/**
+	 * Start the threads of all the workers.
+	 */
+	void start() noexcept(false) {
+		m_stop.store(false);
+		m_running.store(unsigned(m_workers.size()));
+		for(const std::unique_ptr<Worker>& worker : m_workers) {
+			worker->thread = std::thread(&Runtime::work, this, worker.get());
+		}
+	}
+
+	/**
+	 * Ask the workers to return after their current step, the ones which haven't finished lose their input.
+	 */
+	inline void stop() noexcept {
+		m_stop.store(true, std::memory_order_relaxed);
+	}
+
+	/**
+	 * Wait for all the workers, e.g. until every step has returned DONE.
+	 */
+	void join() noexcept {
+		for(const std::unique_ptr<Worker>& worker : m_workers) {
+			if(worker->thread.joinable()) {
+				worker->thread.join();
+			}
+		}
+	}
+
+	/**
+	 * @return true - while a worker has not returned.
+	 */
+	inline bool running() const noexcept {
+		return m_running.load(std::memory_order_acquire) != 0;
+	}
+
+	inline const WorkerStat& stat(unsigned worker) const noexcept {
+		return m_workers[worker]->stat;
+	}
+
+	inline size_t workers() const noexcept {
+		return m_workers.size();
+	}
+
+private:
+
+	static bool pin(int cpu) noexcept {
+		if(cpu < 0 || cpu >= CPU_SETSIZE) {
+			return false;
+		}
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(cpu, &set);
+		return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+	}
+
+	void work(Worker* worker) noexcept {
+		WorkerStat& stat = worker->stat;
+		stat.pinned = pin(worker->cpu);
+		const auto start = std::chrono::steady_clock::now();
+		unsigned idle = 0;
+		while(not m_stop.load(std::memory_order_relaxed)) {
+			const int result = worker->step();
+			stat.steps++;
+			if(result == DONE) {
+				break;
+			}
+			if(result > 0) {
+				stat.busy_steps++;
+				stat.items += uint64_t(result);
+				idle = 0;
+			} else if(++idle < IDLE_SPINS) {
+#if defined(__x86_64__) || defined(__i386__)
+				__builtin_ia32_pause();
+#endif
+			} else {
+				std::this_thread::yield();
+			}
+		}
+		stat.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		m_running.fetch_sub(1, std::memory_order_release);
+	}
+
+};
+
+}; // namespace pipeline
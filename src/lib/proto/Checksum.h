@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+namespace proto {
+
+/**
+ * The Internet checksum (RFC 1071) and its incremental update (RFC 1624).
+ * The words are summed in the memory order, so the sums and the checksums are in the network byte order
+ * as they are kept in the headers and the 16 and 32 bit values are taken as they are in the headers too.
+ * The data is read by 8 bytes into a 64-bit accumulator of the carries (the compiler vectorizes the loop),
+ * so no alignment is needed.
+ */
+class Checksum {
+public:
+
+	/**
+	 * Sum the data up to the previous @sum, e.g. to the sum of a pseudo header.
+	 * All the pieces but the last one must be of an even length.
+	 * @return the ones' complement sum folded to 16 bits.
+	 */
+	static uint32_t partial(const void* data, size_t length, uint32_t sum = 0) noexcept {
+		const uint8_t* ptr = static_cast<const uint8_t*>(data);
+		uint64_t acc = sum;
+		for(; length >= sizeof(uint64_t); length -= sizeof(uint64_t), ptr += sizeof(uint64_t)) {
+			uint64_t word;
+			memcpy(&word, ptr, sizeof(word));
+			acc += (word & 0xFFFFFFFF) + (word >> 32);
+		}
+		if(length >= sizeof(uint32_t)) {
+			uint32_t word;
+			memcpy(&word, ptr, sizeof(word));
+			acc += word;
+			ptr += sizeof(word);
+			length -= sizeof(word);
+		}
+		if(length >= sizeof(uint16_t)) {
+			uint16_t word;
+			memcpy(&word, ptr, sizeof(word));
+			acc += word;
+			ptr += sizeof(word);
+			length -= sizeof(word);
+		}
+		if(length) {
+			uint16_t word = 0; // the last byte is padded by zero
+			memcpy(&word, ptr, 1);
+			acc += word;
+		}
+		return fold(acc);
+	}
+
+	/**
+	 * @return the checksum of the @sum, see partial().
+	 */
+	static inline uint16_t finish(uint64_t sum) noexcept {
+		return uint16_t(~fold(sum));
+	}
+
+	static inline uint16_t compute(const void* data, size_t length) noexcept {
+		return finish(partial(data, length));
+	}
+
+	/**
+	 * RFC 1624 eqn. 3: HC' = ~(~HC + ~m + m').
+	 * @return @check after a 16-bit field has been changed from @old_value to @new_value.
+	 */
+	static inline uint16_t update16(uint16_t check, uint16_t old_value, uint16_t new_value) noexcept {
+		return finish(uint32_t(uint16_t(~check)) + uint16_t(~old_value) + new_value);
+	}
+
+	/**
+	 * @return @check after a 32-bit field (e.g. an IPv4 address) has been changed from @old_value to @new_value.
+	 */
+	static inline uint16_t update32(uint16_t check, uint32_t old_value, uint32_t new_value) noexcept {
+		const uint32_t old_inverted = ~old_value;
+		return finish(uint64_t(uint16_t(~check))
+			+ (old_inverted & 0xFFFF) + (old_inverted >> 16)
+			+ (new_value & 0xFFFF) + (new_value >> 16));
+	}
+
+	/**
+	 * @return @check after @length (even) bytes (e.g. an IPv6 address) have been changed from @old_data to @new_data.
+	 */
+	static uint16_t update(uint16_t check, const void* old_data, const void* new_data, size_t length) noexcept {
+		const uint32_t sum_old = partial(old_data, length);
+		const uint32_t sum_new = partial(new_data, length);
+		return finish(uint32_t(uint16_t(~check)) + uint16_t(~sum_old) + sum_new);
+	}
+
+private:
+
+	static inline uint32_t fold(uint64_t acc) noexcept {
+		acc = (acc & 0xFFFFFFFF) + (acc >> 32);
+		acc = (acc & 0xFFFFFFFF) + (acc >> 32);
+		acc = (acc & 0xFFFF) + (acc >> 16);
+		acc = (acc & 0xFFFF) + (acc >> 16);
+		acc = (acc & 0xFFFF) + (acc >> 16);
+		return uint32_t(acc);
+	}
+
+};
+
+}; // namespace proto
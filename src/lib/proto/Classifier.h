@@ -0,0 +1,388 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include <arpa/inet.h>
+
+#include "parsers/ParsedPacket.h"
+#include "../containers/dpdk/Allocator.h"
+
+namespace proto {
+
+/**
+ * A rule of Classifier, a packet matches it if every field is in its range.
+ * The addresses and the ports are in the host byte order.
+ */
+struct AclRule {
+	static constexpr uint16_t PROTOCOL_ANY = 256;
+	static constexpr uint16_t VLAN_NONE = 4096; // the VLAN id of an untagged packet
+	static constexpr uint16_t VLAN_ANY_HI = VLAN_NONE; // vlan_hi of a rule of any VLAN, including untagged
+
+	uint32_t src_net; // IPv4, the bits beyond the depth are ignored
+	uint8_t src_depth; // 0 - any, an IPv6 packet matches the rules of any address only
+	uint8_t dst_depth;
+	uint16_t protocol; // the IPv4 protocol or the IPv6 next header, PROTOCOL_ANY - any
+	uint32_t dst_net;
+	uint16_t src_port_lo;
+	uint16_t src_port_hi;
+	uint16_t dst_port_lo;
+	uint16_t dst_port_hi;
+	uint16_t vlan_lo; // of the outer tag, VLAN_NONE - untagged
+	uint16_t vlan_hi;
+	uint32_t action; // of the caller
+
+	/**
+	 * A rule which matches every IP packet.
+	 */
+	AclRule() noexcept
+		: src_net(0), src_depth(0), dst_depth(0), protocol(PROTOCOL_ANY), dst_net(0)
+		, src_port_lo(0), src_port_hi(UINT16_MAX), dst_port_lo(0), dst_port_hi(UINT16_MAX)
+		, vlan_lo(0), vlan_hi(VLAN_ANY_HI), action(0) {}
+};
+
+/**
+ * Classifier finds the first rule of a rule set which matches a packet, by the bit vectors
+ * of Lakshman, Stiliadis ("High-Speed Policy-based Packet Forwarding Using Efficient Multi-dimensional
+ * Range Matching"): the range of every field is split into the intervals by the bounds of the rules,
+ * every interval keeps the bitmap of the rules which cover it. A lookup is a binary search of the interval
+ * per field and the AND of FIELDS bitmaps, the lowest bit is the first rule, so it takes
+ * FIELDS * (log2(2 * rules) + rules / 64) operations whatever the rules are.
+ * The fields are the source and the destination IPv4 prefixes, the source and the destination port ranges,
+ * the protocol and the VLAN id range. The packets without the ports match the ranges which include 0.
+ *
+ * build() compiles a rule set into the memory of allocate(), the storage is capped by rules_max,
+ * so no build allocates. build() is deterministic, so Classifier fits storage::Snapshot to swap
+ * the rule sets under the lookups of the workers:
+ *
+ * Using sample:
+ * storage::Qsbr<> qsbr;
+ * storage::Snapshot<Classifier> acl(qsbr, rules_max);
+ * acl.allocate();
+ * // the control plane
+ * acl.update([&](Classifier& c) { c.build(rules, n); });
+ * // a worker
+ * acl.read().classify_bulk(pkts, n, out);
+ * qsbr.quiescent(worker_id);
+ */
+class Classifier {
+public:
+	static constexpr int NO_MATCH = -1;
+	static constexpr size_t BURST = 16; // the packets which are searched and prefetched at once by classify_bulk()
+
+	enum Field : unsigned {
+		SRC,
+		DST,
+		SRC_PORT,
+		DST_PORT,
+		PROTOCOL,
+		VLAN,
+		FIELDS
+	};
+
+private:
+	const size_t m_rules_max;
+	const size_t m_words_max; // of a bitmap
+	const size_t m_rows_max; // per field, the intervals and the row of an IPv6 address
+	size_t m_rules;
+	size_t m_words; // of the built rules
+	uint32_t* m_bounds; // FIELDS * m_rows_max, the lower bounds of the intervals
+	size_t m_intervals[FIELDS];
+	uint64_t* m_bitmaps; // FIELDS * m_rows_max * m_words_max
+	AclRule* m_set; // the built rules
+	dpdk::Allocator<uint32_t> m_bounds_allocator;
+	dpdk::Allocator<uint64_t> m_bitmaps_allocator;
+	dpdk::Allocator<AclRule> m_set_allocator;
+
+public:
+
+	/**
+	 * @param rules_max - the most rules of a rule set.
+	 */
+	explicit Classifier(size_t rules_max) noexcept
+		: m_rules_max(rules_max)
+		, m_words_max((rules_max + 63) / 64)
+		, m_rows_max(2 * rules_max + 2)
+		, m_rules(0)
+		, m_words(0)
+		, m_bounds(nullptr)
+		, m_intervals()
+		, m_bitmaps(nullptr)
+		, m_set(nullptr)
+		, m_bounds_allocator()
+		, m_bitmaps_allocator()
+		, m_set_allocator() {}
+
+	Classifier(const Classifier&) = delete;
+	Classifier& operator=(const Classifier&) = delete;
+
+	Classifier(Classifier&&) = delete;
+	Classifier& operator=(Classifier&&) = delete;
+
+	~Classifier() noexcept {
+		destroy();
+	}
+
+	/**
+	 * @return 0 - if the storage has been allocated successfully, the rule set is empty.
+	 */
+	int allocate() noexcept {
+		if(m_bounds) {
+			return -1;
+		}
+		m_bounds = m_bounds_allocator.allocate(FIELDS * m_rows_max);
+		m_bitmaps = m_bitmaps_allocator.allocate(FIELDS * m_rows_max * (m_words_max ? m_words_max : 1));
+		m_set = m_set_allocator.allocate(m_rules_max ? m_rules_max : 1);
+		if(m_bounds == nullptr || m_bitmaps == nullptr || m_set == nullptr) {
+			destroy();
+			return -1;
+		}
+		build(nullptr, 0);
+		return 0;
+	}
+
+	/**
+	 * Compile a rule set, the first matching rule wins.
+	 * @return false - if there are more than rules_max rules or a range is empty, the rule set is empty then.
+	 */
+	bool build(const AclRule* rules, size_t n) noexcept {
+		m_rules = 0;
+		m_words = 0;
+		bool result = n <= m_rules_max;
+		for(size_t i = 0; result && i < n; i++) {
+			const AclRule& rule = rules[i];
+			result = rule.src_depth <= 32 && rule.dst_depth <= 32
+				&& rule.src_port_lo <= rule.src_port_hi && rule.dst_port_lo <= rule.dst_port_hi
+				&& rule.vlan_lo <= rule.vlan_hi && rule.vlan_hi <= AclRule::VLAN_NONE
+				&& rule.protocol <= AclRule::PROTOCOL_ANY;
+		}
+		if(result) {
+			m_rules = n;
+			m_words = (n + 63) / 64;
+			if(n) {
+				memcpy(m_set, rules, n * sizeof(AclRule));
+			}
+		}
+		for(unsigned field = 0; field < FIELDS; field++) {
+			build_field(Field(field));
+		}
+		return result;
+	}
+
+	/**
+	 * @return the index of the first rule which matches the packet, NO_MATCH - if there is no one
+	 * or the packet is not IP.
+	 */
+	int classify(const ParsedPacket& pkt) const noexcept {
+		const uint64_t* rows[FIELDS];
+		if(not find_rows(pkt, rows)) {
+			return NO_MATCH;
+		}
+		return match(rows);
+	}
+
+	/**
+	 * classify() of n packets, the intervals of BURST packets are searched and their bitmaps are prefetched
+	 * before they are taken.
+	 * @param out - n indexes of the rules or NO_MATCH.
+	 */
+	void classify_bulk(const ParsedPacket* pkts, size_t n, int* out) const noexcept {
+		const uint64_t* rows[BURST][FIELDS];
+		bool found[BURST];
+		for(size_t offset = 0; offset < n; offset += BURST) {
+			const size_t burst = n - offset < BURST ? n - offset : BURST;
+			for(size_t i = 0; i < burst; i++) {
+				found[i] = find_rows(pkts[offset + i], rows[i]);
+				if(found[i]) {
+					for(unsigned field = 0; field < FIELDS; field++) {
+						__builtin_prefetch(rows[i][field]);
+					}
+				}
+			}
+			for(size_t i = 0; i < burst; i++) {
+				out[offset + i] = found[i] ? match(rows[i]) : NO_MATCH;
+			}
+		}
+	}
+
+	/**
+	 * @return a rule of the built set.
+	 */
+	inline const AclRule& rule(size_t index) const noexcept {
+		return m_set[index];
+	}
+
+	/**
+	 * @return amount of the rules of the built set.
+	 */
+	inline size_t size() const noexcept {
+		return m_rules;
+	}
+
+	inline size_t capacity() const noexcept {
+		return m_rules_max;
+	}
+
+	/**
+	 * @return amount of the intervals of a field of the built set.
+	 */
+	inline size_t intervals(Field field) const noexcept {
+		return m_intervals[field];
+	}
+
+	inline size_t storage_bytes() const noexcept {
+		return FIELDS * m_rows_max * (sizeof(uint32_t) + m_words_max * sizeof(uint64_t)) + m_rules_max * sizeof(AclRule);
+	}
+
+private:
+
+	/**
+	 * @return the range of a field of a rule, the IPv4 prefixes are the ranges of the addresses.
+	 */
+	static void range(const AclRule& rule, Field field, uint32_t& lo, uint32_t& hi) noexcept {
+		switch(field) {
+			case SRC:
+				prefix(rule.src_net, rule.src_depth, lo, hi);
+				break;
+			case DST:
+				prefix(rule.dst_net, rule.dst_depth, lo, hi);
+				break;
+			case SRC_PORT:
+				lo = rule.src_port_lo;
+				hi = rule.src_port_hi;
+				break;
+			case DST_PORT:
+				lo = rule.dst_port_lo;
+				hi = rule.dst_port_hi;
+				break;
+			case PROTOCOL:
+				lo = rule.protocol == AclRule::PROTOCOL_ANY ? 0 : rule.protocol;
+				hi = rule.protocol == AclRule::PROTOCOL_ANY ? UINT8_MAX : rule.protocol;
+				break;
+			default:
+				lo = rule.vlan_lo;
+				hi = rule.vlan_hi;
+				break;
+		}
+	}
+
+	static inline void prefix(uint32_t net, unsigned depth, uint32_t& lo, uint32_t& hi) noexcept {
+		const uint32_t mask = depth ? ~uint32_t(0) << (32 - depth) : 0;
+		lo = net & mask;
+		hi = lo | ~mask;
+	}
+
+	inline uint32_t* bounds(Field field) const noexcept {
+		return m_bounds + field * m_rows_max;
+	}
+
+	inline uint64_t* row(Field field, size_t index) const noexcept {
+		return m_bitmaps + (field * m_rows_max + index) * m_words_max;
+	}
+
+	/**
+	 * Split the range of a field by the bounds of the rules and set the bitmaps of the intervals,
+	 * the row past the intervals is of the IPv6 addresses: the rules of any address.
+	 */
+	void build_field(Field field) noexcept {
+		uint32_t* const starts = bounds(field);
+		size_t count = 0;
+		starts[count++] = 0;
+		for(size_t i = 0; i < m_rules; i++) {
+			uint32_t lo, hi;
+			range(m_set[i], field, lo, hi);
+			starts[count++] = lo;
+			if(hi != UINT32_MAX) {
+				starts[count++] = hi + 1;
+			}
+		}
+		std::sort(starts, starts + count);
+		count = size_t(std::unique(starts, starts + count) - starts);
+		m_intervals[field] = count;
+
+		for(size_t k = 0; k <= count; k++) {
+			memset(row(field, k), 0, m_words_max * sizeof(uint64_t));
+		}
+		for(size_t i = 0; i < m_rules; i++) {
+			uint32_t lo, hi;
+			range(m_set[i], field, lo, hi);
+			const uint64_t bit = uint64_t(1) << (i % 64);
+			for(size_t k = size_t(std::lower_bound(starts, starts + count, lo) - starts); k < count && starts[k] <= hi; k++) {
+				row(field, k)[i / 64] |= bit;
+			}
+			if(lo == 0 && hi == UINT32_MAX) {
+				row(field, count)[i / 64] |= bit;
+			}
+		}
+	}
+
+	/**
+	 * @return the bitmap of the interval of @value, the last bound which is not above it is searched
+	 * without the branches (the first bound is 0), so a search doesn't mispredict on the random values.
+	 */
+	inline const uint64_t* find_row(Field field, uint32_t value) const noexcept {
+		const uint32_t* const starts = bounds(field);
+		const uint32_t* base = starts;
+		for(size_t length = m_intervals[field]; length > 1; ) {
+			const size_t half = length / 2;
+			base = base[half] <= value ? base + half : base;
+			length -= half;
+		}
+		return row(field, size_t(base - starts));
+	}
+
+	/**
+	 * @return false - if the packet is not IP.
+	 */
+	inline bool find_rows(const ParsedPacket& pkt, const uint64_t** rows) const noexcept {
+		if(pkt.ip_version == 4) {
+			rows[SRC] = find_row(SRC, ntohl(pkt.src.addr32[0]));
+			rows[DST] = find_row(DST, ntohl(pkt.dst.addr32[0]));
+		} else if(pkt.ip_version == 6) {
+			rows[SRC] = row(SRC, m_intervals[SRC]);
+			rows[DST] = row(DST, m_intervals[DST]);
+		} else {
+			return false;
+		}
+		const bool ports = pkt.has_ports();
+		rows[SRC_PORT] = find_row(SRC_PORT, ports ? ntohs(pkt.src_port) : 0);
+		rows[DST_PORT] = find_row(DST_PORT, ports ? ntohs(pkt.dst_port) : 0);
+		rows[PROTOCOL] = find_row(PROTOCOL, pkt.ip_protocol);
+		rows[VLAN] = find_row(VLAN, pkt.vlan_count ? uint32_t(pkt.vlan[0]) : uint32_t(AclRule::VLAN_NONE));
+		return true;
+	}
+
+	inline int match(const uint64_t* const* rows) const noexcept {
+		for(size_t word = 0; word < m_words; word++) {
+			uint64_t bits = rows[0][word];
+			for(unsigned field = 1; field < FIELDS; field++) {
+				bits &= rows[field][word];
+			}
+			if(bits) {
+				return int(word * 64 + unsigned(__builtin_ctzll(bits)));
+			}
+		}
+		return NO_MATCH;
+	}
+
+	void destroy() noexcept {
+		if(m_bounds) {
+			m_bounds_allocator.deallocate(m_bounds, FIELDS * m_rows_max);
+			m_bounds = nullptr;
+		}
+		if(m_bitmaps) {
+			m_bitmaps_allocator.deallocate(m_bitmaps, FIELDS * m_rows_max * (m_words_max ? m_words_max : 1));
+			m_bitmaps = nullptr;
+		}
+		if(m_set) {
+			m_set_allocator.deallocate(m_set, m_rules_max ? m_rules_max : 1);
+			m_set = nullptr;
+		}
+		m_rules = 0;
+		m_words = 0;
+	}
+
+};
+
+}; // namespace proto
@@ -0,0 +1,310 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include "procotols/IPv4.h"
+#include "procotols/IPv6.h"
+#include "parsers/ParsedPacket.h"
+#include "../containers/BitArrayT.h"
+#include "../containers/storage/Clock.h"
+#include "../containers/storage/Sketch.h"
+
+namespace proto {
+
+struct DeduplicationStat {
+	uint64_t packets; // checked
+	uint64_t duplicates; // dropped
+	uint64_t skipped; // not IP, passed as they are
+	uint64_t rotations; // of the generations
+
+	DeduplicationStat() noexcept : packets(0), duplicates(0), skipped(0), rotations(0) {}
+};
+
+/**
+ * Deduplicator drops the second copy of a packet which a SPAN port or a TAP delivers twice (e.g. the ingress
+ * and the egress copies of a router), before the copies reach the flow tables.
+ * A packet is keyed by a 64-bit hash of its IP header with the fields a hop rewrites zeroed (the IPv4 TOS, TTL
+ * and checksum, the IPv6 traffic class and hop limit) and of PREFIX_BYTES which follow the fixed IP header
+ * (the options, the L4 header, the payload, a tunneled packet), so the L2 (MAC addresses, VLAN tags) may differ.
+ * The hashes are kept as Width-bit fingerprints in two generations of BitArrayT<Width> slots, a slot per hash:
+ * a packet is a duplicate if its fingerprint is in its slot of either generation, otherwise it is stored in
+ * the current one. The current generation becomes the previous one every window and the new current one is
+ * cleared, so a packet is remembered for a window at least and for two windows at most.
+ * A stored packet may be overwritten by a packet of the same slot, then its copy passes, and a packet matches
+ * the fingerprint of another one with the probability of about 2^-Width per stored slot, then it is dropped.
+ * Hence the slots are sized for a few times the packets of a window.
+ *
+ * Using sample:
+ * Deduplicator<16, storage::BurstClock<> > dedup(1 << 16, 1000);
+ * dedup.allocate();
+ * ...
+ * PacketParser::parse_burst(frames, n, pkts);
+ * dedup.clock().set(now);
+ * dedup.filter_burst(frames, pkts, n, keep); // the flow tables take the kept packets only
+ *
+ * @tparam Width - the fingerprint bits, a wider one has fewer false duplicates and takes more memory.
+ * @tparam C - the clock source, see storage/Clock.h.
+ */
+template<BitArrayTWidth_t Width = 16, typename C = storage::CoarseClock>
+class Deduplicator {
+public:
+	static constexpr unsigned WINDOW_US = 10000; // the copies of a mirror come within microseconds
+	static constexpr size_t PREFIX_BYTES = 64; // past the fixed IP header
+	static constexpr size_t BURST = 32; // the packets which are hashed and prefetched at once by filter_burst()
+
+	using Fingerprint_t = BitArrayTChunk_t;
+
+private:
+	static constexpr size_t INPUT_MAX = sizeof(IPv6::Header) + PREFIX_BYTES;
+
+	BitArrayT<Width> m_generations[2];
+	unsigned m_current;
+	const size_t m_slots; // a power of two
+	const uint64_t m_seed;
+	uint64_t m_window; // clock ticks
+	uint64_t m_rotated; // the time of the last rotation
+	C m_clock;
+	DeduplicationStat m_stat;
+
+public:
+
+	/**
+	 * @param slots - the fingerprints of a generation, it is rounded up to a power of two.
+	 * @param window_us - a generation lasts so long, a copy which is later than that may pass.
+	 * @param seed - of the hash, so the colliding packets can't be made without it.
+	 */
+	Deduplicator(size_t slots, unsigned window_us = WINDOW_US, uint64_t seed = 0) noexcept
+		: m_generations()
+		, m_current(0)
+		, m_slots(round_up(slots))
+		, m_seed(storage::SketchHash::mix(seed))
+		, m_window(0)
+		, m_rotated(0)
+		, m_clock()
+		, m_stat() {
+		m_window = uint64_t(window_us) * m_clock.hz() / 1000000;
+		if(m_window == 0) {
+			m_window = 1;
+		}
+	}
+
+	Deduplicator(const Deduplicator&) = delete;
+	Deduplicator& operator=(const Deduplicator&) = delete;
+
+	Deduplicator(Deduplicator&&) = delete;
+	Deduplicator& operator=(Deduplicator&&) = delete;
+
+	/**
+	 * @return 0 - if the generations have been allocated successfully.
+	 */
+	int allocate() noexcept {
+		if(m_generations[0].chunk_capacity())
+			return -1;
+
+		for(BitArrayT<Width>& generation : m_generations) {
+			generation.allocate(m_slots);
+			generation.fill(0);
+		}
+		m_rotated = m_clock.now();
+		return 0;
+	}
+
+	/**
+	 * Check a packet and remember it.
+	 * @param data - the frame which @pkt has been parsed from.
+	 * @return true - if it is a copy of a packet of the window, it should be dropped.
+	 */
+	bool duplicate(const uint8_t* data, size_t size, const ParsedPacket& pkt) noexcept {
+		rotate();
+		uint64_t hash;
+		if(not packet_hash(data, size, pkt, hash)) {
+			m_stat.skipped++;
+			return false;
+		}
+		return check(hash);
+	}
+
+	/**
+	 * Check the packets of a burst, e.g. after PacketParser::parse_burst(). The clock is read once.
+	 * The hashes of BURST packets are taken and their slots are prefetched before they are checked,
+	 * a copy within the burst is found too.
+	 * @tparam Frame - has m_data and m_hdr.caplen as pcapwrap::Frame does.
+	 * @param keep - false for the duplicates.
+	 * @return amount of the kept packets.
+	 */
+	template<typename Frame>
+	size_t filter_burst(const Frame* frames, const ParsedPacket* pkts, size_t n, bool* keep) noexcept {
+		rotate();
+		uint64_t hashes[BURST];
+		bool hashed[BURST];
+		size_t result = 0;
+		while(n) {
+			const size_t burst = n < BURST ? n : BURST;
+			for(size_t i = 0; i < burst; i++) {
+				hashed[i] = packet_hash(frames[i].m_data, frames[i].m_hdr.caplen, pkts[i], hashes[i]);
+				if(hashed[i]) {
+					m_generations[0].prefetch(index(hashes[i]));
+					m_generations[1].prefetch(index(hashes[i]));
+				}
+			}
+			for(size_t i = 0; i < burst; i++) {
+				if(hashed[i]) {
+					keep[i] = not check(hashes[i]);
+				} else {
+					m_stat.skipped++;
+					keep[i] = true;
+				}
+				result += keep[i];
+			}
+			frames += burst;
+			pkts += burst;
+			keep += burst;
+			n -= burst;
+		}
+		return result;
+	}
+
+	/**
+	 * Rotate the generations if the window has passed, duplicate() and filter_burst() do it themselves.
+	 */
+	void rotate() noexcept {
+		const uint64_t now = m_clock.now();
+		if(now - m_rotated < m_window)
+			return;
+
+		m_current ^= 1;
+		m_generations[m_current].fill(0);
+		if(now - m_rotated >= 2 * m_window) {
+			m_generations[m_current ^ 1].fill(0); // the previous one is older than a window too
+		}
+		m_rotated = now;
+		m_stat.rotations++;
+	}
+
+	/**
+	 * The hash of the invariant part of a packet, see Deduplicator.
+	 * @return false - if the packet is not IP or its IP header is truncated.
+	 */
+	bool packet_hash(const uint8_t* data, size_t size, const ParsedPacket& pkt, uint64_t& hash) const noexcept {
+		if(pkt.ip_version == 0 || pkt.l3 >= size) {
+			return false;
+		}
+		const uint8_t* l3 = data + pkt.l3;
+		size_t available = size - pkt.l3;
+		uint8_t input[INPUT_MAX];
+		size_t fixed;
+		if(pkt.ip_version == 4) {
+			IPv4::Header hdr;
+			if(available < sizeof(hdr)) {
+				return false;
+			}
+			memcpy(&hdr, l3, sizeof(hdr));
+			const size_t pkt_nb = IPv4::pkt_len(&hdr);
+			if(pkt_nb >= sizeof(hdr) && pkt_nb < available) {
+				available = pkt_nb; // not the padding of the frame
+			}
+			hdr.tos = 0;
+			hdr.ttl = 0;
+			hdr.check = 0;
+			memcpy(input, &hdr, sizeof(hdr));
+			fixed = sizeof(hdr);
+		} else {
+			IPv6::Header hdr;
+			if(available < sizeof(hdr)) {
+				return false;
+			}
+			memcpy(&hdr, l3, sizeof(hdr));
+			const size_t pkt_nb = sizeof(hdr) + utils::ByteOrder::load_be16(&hdr.payload_len);
+			available = pkt_nb < available ? pkt_nb : available;
+			hdr.traffic_class0 = 0;
+			hdr.traffic_class1 = 0;
+			hdr.hop_limit = 0;
+			memcpy(input, &hdr, sizeof(hdr));
+			fixed = sizeof(hdr);
+		}
+		const size_t prefix = available - fixed < PREFIX_BYTES ? available - fixed : PREFIX_BYTES;
+		memcpy(input + fixed, l3 + fixed, prefix);
+		hash = hash_bytes(input, fixed + prefix);
+		return true;
+	}
+
+	/**
+	 * @return the clock source, e.g. to set the time of a burst.
+	 */
+	inline C& clock() noexcept {
+		return m_clock;
+	}
+
+	inline size_t slots() const noexcept {
+		return m_slots;
+	}
+
+	inline const DeduplicationStat& stat() const noexcept {
+		return m_stat;
+	}
+
+	inline size_t storage_bytes() const noexcept {
+		return m_generations[0].byte_capacity() + m_generations[1].byte_capacity();
+	}
+
+private:
+
+	static inline size_t round_up(size_t slots) noexcept {
+		size_t result = 1;
+		while(result < slots) {
+			result <<= 1;
+		}
+		return result;
+	}
+
+	inline size_t index(uint64_t hash) const noexcept {
+		return size_t(hash) & (m_slots - 1);
+	}
+
+	/**
+	 * @return the high bits of the hash, 0 is an empty slot, so it is taken as 1.
+	 */
+	static inline Fingerprint_t fingerprint(uint64_t hash) noexcept {
+		const Fingerprint_t result = hash >> (64 - Width);
+		return result ? result : 1;
+	}
+
+	inline bool check(uint64_t hash) noexcept {
+		m_stat.packets++;
+		const size_t slot = index(hash);
+		const Fingerprint_t value = fingerprint(hash);
+		if(m_generations[m_current].load(slot) == value || m_generations[m_current ^ 1].load(slot) == value) {
+			m_stat.duplicates++;
+			return true;
+		}
+		m_generations[m_current].store(slot, value);
+		return false;
+	}
+
+	/**
+	 * A multiply-rotate hash of the 8-byte words, the tail is zero padded and the length is mixed in.
+	 */
+	inline uint64_t hash_bytes(const uint8_t* input, size_t length) const noexcept {
+		uint64_t hash = m_seed ^ length;
+		size_t offset = 0;
+		for(; offset + sizeof(uint64_t) <= length; offset += sizeof(uint64_t)) {
+			uint64_t word;
+			memcpy(&word, input + offset, sizeof(word));
+			hash = mix_word(hash, word);
+		}
+		if(offset < length) {
+			uint64_t word = 0;
+			memcpy(&word, input + offset, length - offset);
+			hash = mix_word(hash, word);
+		}
+		return storage::SketchHash::mix(hash);
+	}
+
+	static inline uint64_t mix_word(uint64_t hash, uint64_t word) noexcept {
+		hash ^= word * 0x9e3779b97f4a7c15ull;
+		return ((hash << 27) | (hash >> 37)) * 0xbf58476d1ce4e5b9ull;
+	}
+};
+
+}; // namespace proto
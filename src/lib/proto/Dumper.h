@@ -10,219 +10,197 @@
 #include "procotols/Tcp.h"
 #include "procotols/Udp.h"
 #include "procotols/Gre.h"
+#include "../utils/TextBuffer.h"
 
 namespace proto {
 
+/**
+ * The dumpers of the headers, a header is formatted by utils::TextBuffer of the thread and written by one
+ * fwrite(). The overloads which take a TextBuffer append to it and leave the flush to the caller, e.g. to
+ * write a whole line of a frame at once.
+ */
 class Dumper {
 public:
+	using Text = utils::TextBuffer;
 
 	template <typename MFrame>
 	static void mframe(FILE* out, const MFrame& mf) noexcept {
-		fprintf(out, "| %zu : %zu : %zu |\n", mf.offset(), mf.available(), mf.padding());
+		Text& text = Text::local(out);
+		text.str("| ").dec(mf.offset()).str(" : ").dec(mf.available()).str(" : ").dec(mf.padding()).str(" |\n");
+		text.flush();
 	}
 
 	//
 	// Header section
 	//
 
+	template <typename H>
+	static inline void header(FILE* out, const H* hdr) noexcept {
+		Text& text = Text::local(out);
+		header(text, hdr);
+		text.flush();
+	}
+
+	template <typename H>
+	static inline void header_line(FILE* out, const H* hdr) noexcept {
+		Text& text = Text::local(out);
+		header_line(text, hdr);
+		text.flush();
+	}
+
 	// ethernet
-	static void header(FILE* out, const Ethernet::Header* hdr) noexcept {
-		fprintf(out, "[ETH]\n");
-		uint16_t next_proto = ntohs(hdr->h_proto);
-		fprintf(out, "  |-Source      : ");
-		print_mac(out, hdr->h_source);
-		fprintf(out, "\n");
-		fprintf(out, "  |-Destination : ");
-		print_mac(out, hdr->h_dest);
-		fprintf(out, "\n");
-		fprintf(out, "  |-Protocol    : 0x%04X\n", next_proto);
-	}
-
-	static void header_line(FILE* out, const Ethernet::Header* hdr) noexcept {
-		fprintf(out, "[ETH]");
-		print_mac(out, hdr->h_source);
-		fprintf(out, "->");
-		print_mac(out, hdr->h_dest);
-		fprintf(out, "  ");
+	static void header(Text& text, const Ethernet::Header* hdr) noexcept {
+		text.str("[ETH]\n");
+		text.str("  |-Source      : ").mac(hdr->h_source).chr('\n');
+		text.str("  |-Destination : ").mac(hdr->h_dest).chr('\n');
+		text.str("  |-Protocol    : 0x").hex(ntohs(hdr->h_proto), 4, true).chr('\n');
+	}
+
+	static void header_line(Text& text, const Ethernet::Header* hdr) noexcept {
+		text.str("[ETH]").mac(hdr->h_source).str("->").mac(hdr->h_dest).str("  ");
 	}
 
 	// vlan
-	static void header(FILE* out, const Vlan::Header* hdr) noexcept {
+	static void header(Text& text, const Vlan::Header* hdr) noexcept {
 		Vlan::Header lhdr;
 		lhdr.vlan_tci = ntohs(hdr->vlan_tci);
-		uint16_t next_proto = ntohs(hdr->nextProto);
-
-		fprintf(out, "[VLAN]\n");
-		fprintf(out, "  |-VID      : 0x%03x\n", lhdr.tci_detailed.vid);
-		fprintf(out, "  |-DEI      : %u\n", lhdr.tci_detailed.dei);
-		fprintf(out, "  |-PCP      : %u\n", lhdr.tci_detailed.pcp);
-		fprintf(out, "  |-Protocol : 0x%04X\n", next_proto);
+		text.str("[VLAN]\n");
+		text.str("  |-VID      : 0x").hex(lhdr.tci_detailed.vid, 3).chr('\n');
+		text.str("  |-DEI      : ").dec(lhdr.tci_detailed.dei).chr('\n');
+		text.str("  |-PCP      : ").dec(lhdr.tci_detailed.pcp).chr('\n');
+		text.str("  |-Protocol : 0x").hex(ntohs(hdr->nextProto), 4, true).chr('\n');
 	}
 
-	static void header_line(FILE* out, const Vlan::Header* hdr) noexcept {
+	static void header_line(Text& text, const Vlan::Header* hdr) noexcept {
 		Vlan::Header lhdr;
 		lhdr.vlan_tci = ntohs(hdr->vlan_tci);
-		fprintf(out, "[VLAN]");
-		fprintf(out, "%u(0x%03x)", lhdr.tci_detailed.vid, lhdr.tci_detailed.vid);
-		fprintf(out, "  ");
+		text.str("[VLAN]").dec(lhdr.tci_detailed.vid).str("(0x").hex(lhdr.tci_detailed.vid, 3).str(")  ");
 	}
 
 	// ipv4
-	static void header(FILE* out, const IPv4::Header* hdr) noexcept {
-		u_int16_t packet_nb = ntohs(hdr->tot_len);
-		u_int16_t header_nb = hdr->ihl << 2;
-		uint16_t frag = ntohs(hdr->frag_off);
-		uint32_t src = ntohl(hdr->saddr);
-		uint32_t dst = ntohl(hdr->daddr);
-
-		fprintf(out, "[IPv4]\n");
-		fprintf(out, "  |-Source      : ");
-		print_ip(out, src);
-		fprintf(out, "\n");
-		fprintf(out, "  |-Destination : ");
-		print_ip(out, dst);
-		fprintf(out, "\n");
-
-		fprintf(out, "  |-Length      : %u\n", packet_nb);
-		fprintf(out, "  |-Hdr Length  : %u\n", header_nb);
-		fprintf(out, "  |-ID          : %u\n", ntohs(hdr->id));
-		fprintf(out, "  |-Offset      : %u\n", IPv4::offset(hdr));
-
-		fprintf(out, "  |-Flags       :%s%s%s\n",
-		        ((frag & IP_RF) ? " IP_RF" : ""),
-		        ((frag & IP_DF) ? " IP_DF" : ""),
-		        ((frag & IP_MF) ? " IP_MF" : "")
-		);
-
-		fprintf(out, "  |-Protocol    : %u\n", hdr->protocol);
-		fprintf(out, "  |-Checksum    : 0x%04X\n", ntohs(hdr->check));
-	}
-
-	static void header_line(FILE* out, const IPv4::Header* hdr) noexcept {
-		uint32_t src = ntohl(hdr->saddr);
-		uint32_t dst = ntohl(hdr->daddr);
-
-		fprintf(out, "[IPv4]");
-		print_ip(out, src);
-		fprintf(out, "->");
-		print_ip(out, dst);
-		fprintf(out, "  ");
+	static void header(Text& text, const IPv4::Header* hdr) noexcept {
+		const uint16_t frag = ntohs(hdr->frag_off);
+		text.str("[IPv4]\n");
+		text.str("  |-Source      : ").ipv4(ntohl(hdr->saddr)).chr('\n');
+		text.str("  |-Destination : ").ipv4(ntohl(hdr->daddr)).chr('\n');
+		text.str("  |-Length      : ").dec(ntohs(hdr->tot_len)).chr('\n');
+		text.str("  |-Hdr Length  : ").dec(IPv4::hdr_len(hdr)).chr('\n');
+		text.str("  |-ID          : ").dec(ntohs(hdr->id)).chr('\n');
+		text.str("  |-Offset      : ").dec(IPv4::offset(hdr)).chr('\n');
+		text.str("  |-Flags       :");
+		text.str((frag & IP_RF) ? " IP_RF" : "").str((frag & IP_DF) ? " IP_DF" : "").str((frag & IP_MF) ? " IP_MF" : "");
+		text.chr('\n');
+		text.str("  |-Protocol    : ").dec(hdr->protocol).chr('\n');
+		text.str("  |-Checksum    : 0x").hex(ntohs(hdr->check), 4, true).chr('\n');
+	}
+
+	static void header_line(Text& text, const IPv4::Header* hdr) noexcept {
+		text.str("[IPv4]").ipv4(ntohl(hdr->saddr)).str("->").ipv4(ntohl(hdr->daddr)).str("  ");
 	}
 
 	// ipv6
-	static void header(FILE* out, const IPv6::Header* hdr) noexcept {
-		fprintf(out, "[IPv6]\n");
-		fprintf(out, "  |-Protocol    : %u\n", hdr->next_header);
-		fprintf(out, "  |-Payload     : %u\n", ntohs(hdr->payload_len));
-		fprintf(out, "  |-Hop limit   : %u\n", hdr->hop_limit);
-		fprintf(out, "  |-Source      : ");
-		print_ip(out, hdr->src);
-		fprintf(out, "\n");
-		fprintf(out, "  |-Destination : ");
-		print_ip(out, hdr->dst);
-		fprintf(out, "\n");
-	}
-
-	static void header_line(FILE* out, const IPv6::Header* hdr) noexcept {
-		fprintf(out, "[IPv6]");
-		print_ip(out, hdr->src);
-		fprintf(out, "->");
-		print_ip(out, hdr->dst);
-		fprintf(out, "  ");
+	static void header(Text& text, const IPv6::Header* hdr) noexcept {
+		text.str("[IPv6]\n");
+		text.str("  |-Protocol    : ").dec(hdr->next_header).chr('\n');
+		text.str("  |-Payload     : ").dec(ntohs(hdr->payload_len)).chr('\n');
+		text.str("  |-Hop limit   : ").dec(hdr->hop_limit).chr('\n');
+		text.str("  |-Source      : ").ipv6(&hdr->src).chr('\n');
+		text.str("  |-Destination : ").ipv6(&hdr->dst).chr('\n');
+	}
+
+	static void header_line(Text& text, const IPv6::Header* hdr) noexcept {
+		text.str("[IPv6]").ipv6(&hdr->src).str("->").ipv6(&hdr->dst).str("  ");
 	}
 
 	// tcp
-	static void header(FILE* out, const Tcp::Header* hdr) noexcept {
-		uint16_t hdr_len = Tcp::hdr_len(hdr);
-		fprintf(out, "[TCP]\n");
-		fprintf(out, "  |-Source      : %u\n", ntohs(hdr->src));
-		fprintf(out, "  |-Destination : %u\n", ntohs(hdr->dst));
-		fprintf(out, "  |-Seq. number : %u\n", ntohl(hdr->seq_num));
-		fprintf(out, "  |-ACK number  : %u\n", ntohl(hdr->ack_num));
-		fprintf(out, "  |-Header len  : %u\n", hdr_len);
-		fprintf(out, "  |-Flags       : (0x%02x) ", hdr->flags);
-		fprintf(out, "%s", hdr->flag_ns ? "NS " : "");
-		fprintf(out, "%s", hdr->flag_cwr ? "CWR " : "");
-		fprintf(out, "%s", hdr->flag_ece ? "ECE " : "");
-		fprintf(out, "%s", hdr->flag_urg ? "URG " : "");
-		fprintf(out, "%s", hdr->flag_ack ? "ACK " : "");
-		fprintf(out, "%s", hdr->flag_psh ? "PSH " : "");
-		fprintf(out, "%s", hdr->flag_rst ? "RST " : "");
-		fprintf(out, "%s", hdr->flag_syn ? "SYN " : "");
-		fprintf(out, "%s", hdr->flag_fin ? "FIN " : "");
-		fprintf(out, "\n");
-		fprintf(out, "  |-Window size : %u\n", ntohs(hdr->win_size));
-		fprintf(out, "  |-CRC         : 0x%04x\n", ntohs(hdr->crc));
+	static void header(Text& text, const Tcp::Header* hdr) noexcept {
+		text.str("[TCP]\n");
+		text.str("  |-Source      : ").dec(ntohs(hdr->src)).chr('\n');
+		text.str("  |-Destination : ").dec(ntohs(hdr->dst)).chr('\n');
+		text.str("  |-Seq. number : ").dec(ntohl(hdr->seq_num)).chr('\n');
+		text.str("  |-ACK number  : ").dec(ntohl(hdr->ack_num)).chr('\n');
+		text.str("  |-Header len  : ").dec(Tcp::hdr_len(hdr)).chr('\n');
+		text.str("  |-Flags       : (0x").hex(hdr->flags, 2).str(") ");
+		if(tcp_flags(text, hdr, ' ')) {
+			text.chr(' ');
+		}
+		text.chr('\n');
+		text.str("  |-Window size : ").dec(ntohs(hdr->win_size)).chr('\n');
+		text.str("  |-CRC         : 0x").hex(ntohs(hdr->crc), 4).chr('\n');
 		if(hdr->flag_urg) {
-			fprintf(out, "  |-Urgent ptr. : %u\n", ntohs(hdr->urgent_pointer));
+			text.str("  |-Urgent ptr. : ").dec(ntohs(hdr->urgent_pointer)).chr('\n');
 		}
 	}
 
-	static void header_line(FILE* out, const Tcp::Header* hdr) noexcept {
-		fprintf(out, "[TCP]");
-		fprintf(out, "%u->%u  ", ntohs(hdr->src), ntohs(hdr->dst));
+	static void header_line(Text& text, const Tcp::Header* hdr) noexcept {
+		text.str("[TCP]").dec(ntohs(hdr->src)).str("->").dec(ntohs(hdr->dst)).str("  ");
+	}
+
+	/**
+	 * Append the names of the set flags split by @splitter.
+	 * @return amount of the set flags.
+	 */
+	static unsigned tcp_flags(Text& text, const Tcp::Header* hdr, char splitter) noexcept {
+		const struct {
+			bool set;
+			const char* name;
+		} flags[] = {
+			{bool(hdr->flag_ns), "NS"}, {bool(hdr->flag_cwr), "CWR"}, {bool(hdr->flag_ece), "ECE"},
+			{bool(hdr->flag_urg), "URG"}, {bool(hdr->flag_ack), "ACK"}, {bool(hdr->flag_psh), "PSH"},
+			{bool(hdr->flag_rst), "RST"}, {bool(hdr->flag_syn), "SYN"}, {bool(hdr->flag_fin), "FIN"}
+		};
+		unsigned result = 0;
+		for(const auto& flag : flags) {
+			if(flag.set) {
+				if(result++) {
+					text.chr(splitter);
+				}
+				text.str(flag.name);
+			}
+		}
+		return result;
 	}
 
 	// udp
-	static void header(FILE* out, const Udp::Header* hdr) noexcept {
-		uint16_t udp_nb = ntohs(hdr->len);
-		fprintf(out, "[UDP]\n");
-		fprintf(out, "  |-Source      : %u\n", ntohs(hdr->source));
-		fprintf(out, "  |-Destination : %u\n", ntohs(hdr->dest));
-		fprintf(out, "  |-Length      : %u\n", udp_nb);
-		fprintf(out, "  |-Checksum    : 0x%04X\n", ntohs(hdr->check));
+	static void header(Text& text, const Udp::Header* hdr) noexcept {
+		text.str("[UDP]\n");
+		text.str("  |-Source      : ").dec(ntohs(hdr->source)).chr('\n');
+		text.str("  |-Destination : ").dec(ntohs(hdr->dest)).chr('\n');
+		text.str("  |-Length      : ").dec(ntohs(hdr->len)).chr('\n');
+		text.str("  |-Checksum    : 0x").hex(ntohs(hdr->check), 4, true).chr('\n');
 	}
 
-	static void header_line(FILE* out, const Udp::Header* hdr) noexcept {
-		fprintf(out, "[UDP]");
-		fprintf(out, "%u->%u  ", ntohs(hdr->source), ntohs(hdr->dest));
+	static void header_line(Text& text, const Udp::Header* hdr) noexcept {
+		text.str("[UDP]").dec(ntohs(hdr->source)).str("->").dec(ntohs(hdr->dest)).str("  ");
 	}
 
 	// gre
-	static void header(FILE* out, const Gre::Header* hdr) noexcept {
-		fprintf(out, "    |-Bit Checksum        : %u\n", hdr->flag_bits.bit_checksum);
-		fprintf(out, "    |-Bit Routung         : %u\n", hdr->flag_bits.bit_routung);
-		fprintf(out, "    |-Bit Key             : %u\n", hdr->flag_bits.bit_key);
-		fprintf(out, "    |-Bit Sequence Number : %u\n", hdr->flag_bits.bit_seq_num);
-		fprintf(out, "    |-Bit SSR             : %u\n", hdr->flag_bits.bit_ssr);
-		fprintf(out, "    |-Version             : %u\n", hdr->flag_bits.version);
-		fprintf(out, "    |-Next Protocol       : 0x%04X\n", ntohs(hdr->next_proto));
+	static void header(Text& text, const Gre::Header* hdr) noexcept {
+		text.str("    |-Bit Checksum        : ").dec(hdr->flag_bits.bit_checksum).chr('\n');
+		text.str("    |-Bit Routung         : ").dec(hdr->flag_bits.bit_routung).chr('\n');
+		text.str("    |-Bit Key             : ").dec(hdr->flag_bits.bit_key).chr('\n');
+		text.str("    |-Bit Sequence Number : ").dec(hdr->flag_bits.bit_seq_num).chr('\n');
+		text.str("    |-Bit SSR             : ").dec(hdr->flag_bits.bit_ssr).chr('\n');
+		text.str("    |-Version             : ").dec(hdr->flag_bits.version).chr('\n');
+		text.str("    |-Next Protocol       : 0x").hex(ntohs(hdr->next_proto), 4, true).chr('\n');
 	}
 
 	static void header_short(FILE* out, const Gre::Header* hdr) noexcept {
-		fprintf(out, "[GRE]  ");
+		Text::local(out).str("[GRE]  ").flush();
 	}
 
 	static void print_mac(FILE* out, const unsigned char* mac) {
-		fprintf(out, "%02X:%02X:%02X:%02X:%02X:%02X", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+		Text::local(out).mac(mac).flush();
 	}
 
-	static inline void print_ip(FILE* file, IPv4::Addr ip) {
-		fprintf(file, "%01u.%01u.%01u.%01u", ((ip >> 24) & 0xFF), ((ip >> 16) & 0xFF), ((ip >> 8) & 0xFF),
-		        ((ip) & 0xFF));
+	static inline void print_ip(FILE* out, IPv4::Addr ip) {
+		Text::local(out).ipv4(ip).flush();
 	}
 
 	static inline void print_ip(FILE* out, IPv6::Addr ip) {
-		bool zeros = false;
-		for(unsigned i = 0; i < 8; ++i) {
-			if(ip.addr16[i]){
-				if(i > 0){
-					fprintf(out, ":");
-				}
-				if(zeros){
-					fprintf(out, ":");
-				}
-				fprintf(out, "%x", ntohs(ip.addr16[i]));
-				zeros = false;
-			} else {
-				zeros = true;
-			}
-
-
-		}
+		Text::local(out).ipv6(&ip).flush();
 	}
 
 };
 
 }; // namespace proto
-
@@ -0,0 +1,285 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+
+#include <arpa/inet.h>
+#if defined(__SSE4_2__)
+#include <nmmintrin.h>
+#endif
+
+#include "procotols/IPv6.h"
+#include "parsers/ParsedPacket.h"
+
+namespace proto {
+
+/**
+ * The 5-tuple of a flow, the addresses are kept as in ParsedFlow (IPv4 in addr32[0]),
+ * the addresses and the ports are in the network byte order. The key is compared as bytes.
+ */
+struct FlowKey {
+	IPv6::Addr src;
+	IPv6::Addr dst;
+	uint16_t src_port; // 0 - if the protocol has no ports
+	uint16_t dst_port;
+	uint8_t protocol;
+	uint8_t version; // 4 or 6
+	uint16_t reserved; // zero
+
+	bool operator==(const FlowKey& key) const noexcept {
+		return memcmp(this, &key, sizeof(key)) == 0;
+	}
+
+	/**
+	 * @return the key of @flow, e.g. of the packet or of its ParsedPacket::inner.
+	 */
+	static FlowKey of(const ParsedFlow& flow) noexcept {
+		FlowKey key;
+		memset(&key, 0, sizeof(key));
+		key.src = flow.src;
+		key.dst = flow.dst;
+		key.protocol = flow.ip_protocol;
+		key.version = flow.ip_version;
+		if(flow.has_ports()) {
+			key.src_port = flow.src_port;
+			key.dst_port = flow.dst_port;
+		}
+		return key;
+	}
+
+	/**
+	 * @return the key with the lower endpoint first, so both directions of a flow have the same key,
+	 * e.g. for a table of the bidirectional flows.
+	 */
+	FlowKey canonical() const noexcept {
+		const int order = memcmp(&src, &dst, sizeof(src));
+		if(order < 0 || (order == 0 && ntohs(src_port) <= ntohs(dst_port))) {
+			return *this;
+		}
+		FlowKey key = *this;
+		key.src = dst;
+		key.dst = src;
+		key.src_port = dst_port;
+		key.dst_port = src_port;
+		return key;
+	}
+};
+
+/**
+ * The Toeplitz hash of the Microsoft RSS specification, the one the NICs steer the packets to the queues by.
+ * The input of a FlowKey is as a NIC takes it: the source and destination addresses (4 or 16 bytes each)
+ * and the source and destination ports if the flow has them, in the network byte order.
+ * The hash is taken by a table of the input byte values, a lookup and a xor per byte.
+ * With SYMMETRIC_KEY the hash of both directions of a flow is the same, a NIC programmed with the same key
+ * gives the same value, so the software and the hardware steering agree.
+ */
+class Toeplitz {
+public:
+	static constexpr size_t KEY_BYTES = 40;
+	static constexpr size_t INPUT_MAX = 2 * sizeof(IPv6::Addr) + 2 * sizeof(uint16_t);
+
+	/**
+	 * @param key - KEY_BYTES of the RSS key, nullptr - SYMMETRIC_KEY.
+	 */
+	explicit Toeplitz(const uint8_t* key = nullptr) noexcept {
+		if(key == nullptr) {
+			key = symmetric_key();
+		}
+		for(size_t i = 0; i < INPUT_MAX; i++) {
+			for(unsigned value = 0; value < 256; value++) {
+				uint32_t result = 0;
+				for(unsigned bit = 0; bit < 8; bit++) {
+					if(value & (0x80u >> bit)) {
+						result ^= window(key, i * 8 + bit);
+					}
+				}
+				m_table[i][value] = result;
+			}
+		}
+	}
+
+	Toeplitz(const Toeplitz&) = delete;
+	Toeplitz& operator=(const Toeplitz&) = delete;
+
+	Toeplitz(Toeplitz&&) = delete;
+	Toeplitz& operator=(Toeplitz&&) = delete;
+
+	/**
+	 * @param length - INPUT_MAX at most.
+	 */
+	inline uint32_t hash(const uint8_t* input, size_t length) const noexcept {
+		uint32_t result = 0;
+		for(size_t i = 0; i < length; i++) {
+			result ^= m_table[i][input[i]];
+		}
+		return result;
+	}
+
+	uint32_t hash(const FlowKey& key) const noexcept {
+		uint8_t input[INPUT_MAX];
+		const size_t addr_nb = key.version == 4 ? sizeof(uint32_t) : sizeof(IPv6::Addr);
+		memcpy(input, &key.src, addr_nb);
+		memcpy(input + addr_nb, &key.dst, addr_nb);
+		size_t length = 2 * addr_nb;
+		if(key.src_port || key.dst_port) {
+			memcpy(input + length, &key.src_port, sizeof(key.src_port));
+			memcpy(input + length + sizeof(key.src_port), &key.dst_port, sizeof(key.dst_port));
+			length += 2 * sizeof(uint16_t);
+		}
+		return hash(input, length);
+	}
+
+	/**
+	 * @return the hash of SYMMETRIC_KEY, the table is built at the first call.
+	 */
+	static const Toeplitz& symmetric() noexcept {
+		static const Toeplitz instance;
+		return instance;
+	}
+
+	/**
+	 * 0x6d5a repeated, the bits of the key repeat every 16 bits, so swapping the addresses and the ports
+	 * doesn't change the hash (Woo, Park "Scalable TCP Session Monitoring with Symmetric Receive-side Scaling").
+	 */
+	static const uint8_t* symmetric_key() noexcept {
+		static const uint8_t key[KEY_BYTES] = {
+			0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a,
+			0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a,
+			0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a,
+			0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a, 0x6d, 0x5a
+		};
+		return key;
+	}
+
+private:
+	uint32_t m_table[INPUT_MAX][256];
+
+	/**
+	 * @return 32 bits of the key from the bit @pos, the most significant bit of the first byte is 0.
+	 */
+	static inline uint32_t window(const uint8_t* key, size_t pos) noexcept {
+		const size_t byte = pos / 8;
+		uint64_t bits = 0;
+		for(size_t i = 0; i < 5; i++) {
+			bits = (bits << 8) | (byte + i < KEY_BYTES ? key[byte + i] : 0);
+		}
+		return uint32_t(bits >> (8 - pos % 8));
+	}
+};
+
+/**
+ * CRC32C (Castagnoli), by the SSE 4.2 crc32 instruction if it is enabled (-msse4.2) or by a table.
+ */
+class Crc32c {
+public:
+
+	/**
+	 * @return @crc extended by @length bytes of @data, the initial value and the final inversion are of the caller.
+	 */
+	static uint32_t extend(uint32_t crc, const void* data, size_t length) noexcept {
+		const uint8_t* ptr = static_cast<const uint8_t*>(data);
+#if defined(__SSE4_2__)
+		uint64_t acc = crc;
+		for(; length >= sizeof(uint64_t); length -= sizeof(uint64_t), ptr += sizeof(uint64_t)) {
+			uint64_t word;
+			memcpy(&word, ptr, sizeof(word));
+			acc = _mm_crc32_u64(acc, word);
+		}
+		crc = uint32_t(acc);
+		if(length >= sizeof(uint32_t)) {
+			uint32_t word;
+			memcpy(&word, ptr, sizeof(word));
+			crc = _mm_crc32_u32(crc, word);
+			ptr += sizeof(word);
+			length -= sizeof(word);
+		}
+		for(; length; length--, ptr++) {
+			crc = _mm_crc32_u8(crc, *ptr);
+		}
+#else
+		const uint32_t* table = Crc32c::table();
+		for(; length; length--, ptr++) {
+			crc = table[(crc ^ *ptr) & 0xFF] ^ (crc >> 8);
+		}
+#endif
+		return crc;
+	}
+
+	static inline uint32_t compute(const void* data, size_t length) noexcept {
+		return ~extend(~uint32_t(0), data, length);
+	}
+
+private:
+
+	static const uint32_t* table() noexcept {
+		struct Table {
+			uint32_t value[256];
+
+			Table() noexcept {
+				for(uint32_t i = 0; i < 256; i++) {
+					uint32_t crc = i;
+					for(unsigned bit = 0; bit < 8; bit++) {
+						crc = (crc >> 1) ^ (0x82F63B78u & (0u - (crc & 1)));
+					}
+					value[i] = crc;
+				}
+			}
+		};
+		static const Table instance;
+		return instance.value;
+	}
+};
+
+/**
+ * The 32-bit hash is repeated in the high half of size_t, so the low bits are the NIC one (its RSS indirection
+ * takes them) and the high byte is good for the fingerprints of HashMapLineBucket.
+ */
+inline size_t flow_hash_spread(uint32_t hash) noexcept {
+	return size_t((uint64_t(hash) << 32) | hash);
+}
+
+/**
+ * The symmetric Toeplitz hash of a FlowKey, e.g. the H parameter of HashQueuePool and TimedQueue.
+ */
+struct ToeplitzFlowHash {
+	inline size_t operator()(const FlowKey& key) const noexcept {
+		return flow_hash_spread(Toeplitz::symmetric().hash(key));
+	}
+};
+
+/**
+ * The symmetric CRC32C hash of a FlowKey, faster than ToeplitzFlowHash with SSE 4.2 but not of the NICs.
+ * The endpoints are hashed apart and their CRCs are taken in order, so no key is swapped.
+ * The protocol goes between them: a CRC extended by 4 bytes only is of the xor of the two,
+ * which would be the same for the swapped ports.
+ */
+struct Crc32cFlowHash {
+	inline size_t operator()(const FlowKey& key) const noexcept {
+		const size_t addr_nb = key.version == 4 ? sizeof(uint32_t) : sizeof(IPv6::Addr);
+		const uint32_t src = endpoint(key.src, key.src_port, addr_nb);
+		const uint32_t dst = endpoint(key.dst, key.dst_port, addr_nb);
+		const uint32_t tail[2] = {uint32_t(key.protocol) | (uint32_t(key.version) << 8), src < dst ? dst : src};
+		return flow_hash_spread(~Crc32c::extend(src < dst ? src : dst, tail, sizeof(tail)));
+	}
+
+private:
+	static inline uint32_t endpoint(const IPv6::Addr& addr, uint16_t port, size_t addr_nb) noexcept {
+		uint8_t input[sizeof(IPv6::Addr) + sizeof(uint16_t)];
+		memcpy(input, &addr, addr_nb);
+		memcpy(input + addr_nb, &port, sizeof(port));
+		return Crc32c::extend(~uint32_t(0), input, addr_nb + sizeof(port));
+	}
+};
+
+}; // namespace proto
+
+namespace std {
+
+/**
+ * The containers default to std::hash<Key_t>.
+ */
+template<>
+struct hash<proto::FlowKey> : public proto::Crc32cFlowHash {};
+
+}; // namespace std
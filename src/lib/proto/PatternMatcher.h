@@ -0,0 +1,586 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE4_2__)
+#include <nmmintrin.h>
+#endif
+
+#include "procotols/IPv4.h"
+#include "procotols/IPv6.h"
+#include "mframe/MFrame.h"
+#include "parsers/ParsedPacket.h"
+#include "../containers/dpdk/Allocator.h"
+
+namespace proto {
+
+/**
+ * A byte pattern of PatternMatcher, the bytes are needed by build() only.
+ */
+struct MatchPattern {
+	const uint8_t* data;
+	size_t length; // 0 is not a pattern
+	uint32_t id; // of the caller, it is reported by the matches
+};
+
+/**
+ * The position of a stream within the automaton of PatternMatcher, e.g. of a direction of a TCP connection,
+ * so a pattern which spans the segments is found. The streams must be reset after a rebuild of their matcher.
+ */
+struct MatchStream {
+	uint32_t state;
+	uint64_t offset; // the bytes scanned
+
+	MatchStream() noexcept : state(0), offset(0) {}
+};
+
+/**
+ * PatternMatcher finds all the occurrences of a set of byte patterns in one pass over a payload by the Aho-Corasick
+ * automaton ("Efficient String Matching: An Aid to Bibliographic Search"): a trie of the patterns with the failure
+ * links, a byte is a transition of the trie or a walk of the failure links, so a scan takes O(bytes + matches)
+ * whatever the patterns are.
+ * The automaton is compact: the states are numbered in the breadth-first order, so the children of a state are
+ * consecutive and its edges are the run of their labels (a byte per edge, the target is implied). The root and
+ * its children have the full tables of 256 transitions with the failure links resolved, so the walk near the root,
+ * where the most bytes of a payload are scanned, is a load without the branches. A state keeps the first of its own patterns (the duplicates are chained) and
+ * the nearest state of its failure chain with the patterns, so the states without the matches are passed by one test.
+ * The first bytes of the patterns are compiled into the nibble tables as the char classes of CharClassifier are,
+ * when the automaton is at the root, pshufb finds the next candidate byte among 16 at a time with SSE4.2;
+ * it is used while there are PREFILTER_BYTES first bytes at most, the table of the root is the fallback.
+ *
+ * build() compiles a pattern set into the memory of allocate(), the storage is capped by patterns_max and
+ * bytes_max (the sum of the lengths), so no build allocates. build() is deterministic, so PatternMatcher fits
+ * storage::Snapshot as Classifier does. The matches are reported at the byte which ends them: the patterns
+ * which end at a byte are from the longest one, the duplicates in the order of the pattern set.
+ *
+ * Using sample:
+ * PatternMatcher matcher(patterns_max, bytes_max);
+ * matcher.allocate();
+ * matcher.build(patterns, n);
+ * ...
+ * matcher.match_burst(frames, pkts, n, ids); // the first match of the TCP/UDP payload of every packet
+ * ...
+ * matcher.scan(stream, segment, length, [&](uint32_t id, uint64_t end, uint32_t length) { ... });
+ */
+class PatternMatcher {
+public:
+	static constexpr uint32_t NO_MATCH = UINT32_MAX;
+	static constexpr unsigned LANES = 4; // the payloads which match_burst() scans in the lockstep
+	static constexpr unsigned PREFILTER_BYTES = 64; // the prefilter skips little if more bytes start the patterns
+
+private:
+	static constexpr uint32_t ROOT = 0;
+	static constexpr uint32_t NONE = UINT32_MAX;
+	static constexpr uint32_t LINEAR_EDGES = 16; // the edges of a state are searched linearly up to so many
+	static constexpr size_t ROWS_MAX = 257; // the root and its children
+
+	struct State {
+		uint32_t first; // the first child
+		uint32_t count; // of the children
+		uint32_t fail;
+		uint32_t match; // the first own pattern, NONE - none
+		uint32_t out; // the nearest state of the failure chain (itself including) with a pattern
+	};
+
+	struct Output {
+		uint32_t id;
+		uint32_t length;
+		uint32_t next; // a duplicate pattern
+	};
+
+	const size_t m_patterns_max;
+	const size_t m_states_max;
+	size_t m_patterns;
+	size_t m_states;
+	State* m_state_set;
+	uint8_t* m_labels; // of the edges to the states
+	Output* m_outputs;
+	uint32_t* m_scratch; // the sorted patterns and the pattern ranges of the states, for build()
+	uint32_t* m_rows; // the tables of the states [0, m_dense), 256 transitions each
+	size_t m_dense;
+	alignas(16) uint8_t m_prefilter_low[16]; // the low nibble -> the bits of the high nibbles 0-7 of the first bytes
+	alignas(16) uint8_t m_prefilter_high[16]; // of the high nibbles 8-15
+	bool m_prefilter;
+	dpdk::Allocator<State> m_state_allocator;
+	dpdk::Allocator<uint8_t> m_label_allocator;
+	dpdk::Allocator<Output> m_output_allocator;
+	dpdk::Allocator<uint32_t> m_scratch_allocator;
+	dpdk::Allocator<uint32_t> m_row_allocator;
+
+public:
+
+	/**
+	 * @param patterns_max - the most patterns of a pattern set.
+	 * @param bytes_max - the most bytes of all the patterns of a set.
+	 */
+	PatternMatcher(size_t patterns_max, size_t bytes_max) noexcept
+		: m_patterns_max(patterns_max)
+		, m_states_max(bytes_max < NONE - 1 ? bytes_max + 1 : NONE - 1)
+		, m_patterns(0)
+		, m_states(0)
+		, m_state_set(nullptr)
+		, m_labels(nullptr)
+		, m_outputs(nullptr)
+		, m_scratch(nullptr)
+		, m_rows(nullptr)
+		, m_dense(0)
+		, m_prefilter_low()
+		, m_prefilter_high()
+		, m_prefilter(false)
+		, m_state_allocator()
+		, m_label_allocator()
+		, m_output_allocator()
+		, m_scratch_allocator()
+		, m_row_allocator() {}
+
+	PatternMatcher(const PatternMatcher&) = delete;
+	PatternMatcher& operator=(const PatternMatcher&) = delete;
+
+	PatternMatcher(PatternMatcher&&) = delete;
+	PatternMatcher& operator=(PatternMatcher&&) = delete;
+
+	~PatternMatcher() noexcept {
+		destroy();
+	}
+
+	/**
+	 * @return 0 - if the storage has been allocated successfully, the pattern set is empty.
+	 */
+	int allocate() noexcept {
+		if(m_state_set) {
+			return -1;
+		}
+		m_state_set = m_state_allocator.allocate(m_states_max);
+		m_labels = m_label_allocator.allocate(m_states_max);
+		m_outputs = m_output_allocator.allocate(m_patterns_max ? m_patterns_max : 1);
+		m_scratch = m_scratch_allocator.allocate(scratch_size());
+		m_rows = m_row_allocator.allocate(rows_max() * 256);
+		if(m_state_set == nullptr || m_labels == nullptr || m_outputs == nullptr || m_scratch == nullptr
+		   || m_rows == nullptr) {
+			destroy();
+			return -1;
+		}
+		build(nullptr, 0);
+		return 0;
+	}
+
+	/**
+	 * Compile a pattern set.
+	 * @return false - if there are more than patterns_max patterns or bytes_max bytes or an empty pattern,
+	 * the pattern set is empty then.
+	 */
+	bool build(const MatchPattern* patterns, size_t n) noexcept {
+		size_t bytes = 0;
+		bool result = n <= m_patterns_max;
+		for(size_t i = 0; result && i < n; i++) {
+			result = patterns[i].length && patterns[i].length < m_states_max - bytes; // a state per byte and the root
+			bytes += patterns[i].length;
+		}
+		m_patterns = result ? n : 0;
+		for(size_t i = 0; i < m_patterns; i++) {
+			m_outputs[i].id = patterns[i].id;
+			m_outputs[i].length = uint32_t(patterns[i].length);
+			m_outputs[i].next = NONE;
+		}
+		build_trie(patterns);
+		build_links();
+		build_prefilter();
+		return result;
+	}
+
+	/**
+	 * Scan the next bytes of a stream.
+	 * @param on_match - on_match(uint32_t id, uint64_t end, uint32_t length) of every match, @end is the offset
+	 * in the stream past its last byte.
+	 * @return amount of the matches.
+	 */
+	template<typename F>
+	size_t scan(MatchStream& stream, const uint8_t* data, size_t length, F&& on_match) const noexcept {
+		const uint8_t* ptr = data;
+		const uint8_t* const end = data + length;
+		uint32_t state = stream.state;
+		size_t result = 0;
+		while(ptr != end) {
+			if(state == ROOT) {
+				ptr = skip(ptr, end);
+				if(ptr == end)
+					break;
+			}
+			state = step(state, *ptr++);
+			for(uint32_t s = m_state_set[state].out; s != NONE; s = m_state_set[m_state_set[s].fail].out) {
+				for(uint32_t k = m_state_set[s].match; k != NONE; k = m_outputs[k].next) {
+					on_match(m_outputs[k].id, stream.offset + uint64_t(ptr - data), m_outputs[k].length);
+					result++;
+				}
+			}
+		}
+		stream.state = state;
+		stream.offset += length;
+		return result;
+	}
+
+	/**
+	 * Scan a payload on its own.
+	 */
+	template<typename F>
+	inline size_t scan(const uint8_t* data, size_t length, F&& on_match) const noexcept {
+		MatchStream stream;
+		return scan(stream, data, length, on_match);
+	}
+
+	/**
+	 * Scan the bytes of a frame from its head to its tail, e.g. the payload which HeaderParser has stopped at.
+	 */
+	template<typename T, typename F>
+	inline size_t scan(MatchStream& stream, const MFrame<T>& frame, F&& on_match) const noexcept {
+		return scan(stream, reinterpret_cast<const uint8_t*>(frame.head()), frame.available(), on_match);
+	}
+
+	/**
+	 * @return the id of the match which ends first (the longest one of those which end at that byte),
+	 * NO_MATCH - if there is no one.
+	 */
+	uint32_t first(const uint8_t* data, size_t length) const noexcept {
+		const uint8_t* ptr = data;
+		const uint8_t* const end = data + length;
+		uint32_t state = ROOT;
+		while(ptr != end) {
+			if(state == ROOT) {
+				ptr = skip(ptr, end);
+				if(ptr == end)
+					break;
+			}
+			state = step(state, *ptr++);
+			if(m_state_set[state].out != NONE) {
+				return m_outputs[m_state_set[m_state_set[state].out].match].id;
+			}
+		}
+		return NO_MATCH;
+	}
+
+	/**
+	 * first() of the TCP or UDP payloads of n packets (the inner ones of the tunnels), e.g. after
+	 * PacketParser::parse_burst(). LANES payloads are scanned in the lockstep, so the state loads of one
+	 * payload overlap the ones of the others.
+	 * @tparam Frame - has m_data and m_hdr.caplen as pcapwrap::Frame does.
+	 * @param out - n ids of the first matches or NO_MATCH.
+	 * @return amount of the packets which have matched.
+	 */
+	template<typename Frame>
+	size_t match_burst(const Frame* frames, const ParsedPacket* pkts, size_t n, uint32_t* out) const noexcept {
+		struct Lane {
+			const uint8_t* ptr;
+			const uint8_t* end;
+			uint32_t state;
+			size_t packet;
+		};
+		Lane lanes[LANES];
+		size_t active = 0;
+		size_t next = 0;
+		size_t result = 0;
+		auto refill = [&](Lane& lane) noexcept {
+			for(; next < n; next++) {
+				out[next] = NO_MATCH;
+				size_t begin, end;
+				if(payload(frames[next].m_data, frames[next].m_hdr.caplen, pkts[next], begin, end) && begin < end) {
+					lane.ptr = frames[next].m_data + begin;
+					lane.end = frames[next].m_data + end;
+					lane.state = ROOT;
+					lane.packet = next++;
+					return true;
+				}
+			}
+			return false;
+		};
+		while(active < LANES && refill(lanes[active])) {
+			active++;
+		}
+		while(active) {
+			for(size_t i = 0; i < active; ) {
+				Lane& lane = lanes[i];
+				if(lane.state == ROOT) {
+					lane.ptr = skip(lane.ptr, lane.end);
+				}
+				bool done = lane.ptr == lane.end;
+				if(not done) {
+					lane.state = step(lane.state, *lane.ptr++);
+					const uint32_t state = m_state_set[lane.state].out;
+					if(state != NONE) {
+						out[lane.packet] = m_outputs[m_state_set[state].match].id;
+						result++;
+						done = true;
+					} else {
+						done = lane.ptr == lane.end;
+					}
+				}
+				if(done && not refill(lane)) {
+					lane = lanes[--active];
+					continue; // the moved lane takes its step
+				}
+				i++;
+			}
+		}
+		return result;
+	}
+
+	/**
+	 * Locate the TCP or UDP payload of a packet parsed by PacketParser, the payload of the inner packet
+	 * of a tunnel is taken. The payload ends by the IP length, so the padding of the frame is not taken.
+	 * @return false - if the packet has no such payload.
+	 */
+	static bool payload(const uint8_t* data, size_t size, const ParsedPacket& pkt, size_t& begin, size_t& end) noexcept {
+		const ParsedFlow& flow = pkt.tunneled() && pkt.inner.has_ports() ? pkt.inner : pkt;
+		if(not flow.has_ports() || flow.payload > size) {
+			return false;
+		}
+		end = size;
+		if(flow.ip_version == 4 && size - flow.l3 >= sizeof(IPv4::Header)) {
+			IPv4::Header ip;
+			memcpy(&ip, data + flow.l3, sizeof(ip));
+			const size_t pkt_nb = IPv4::pkt_len(&ip);
+			end = flow.l3 + pkt_nb < end ? flow.l3 + pkt_nb : end;
+		} else if(flow.ip_version == 6 && size - flow.l3 >= sizeof(IPv6::Header)) {
+			IPv6::Header ip;
+			memcpy(&ip, data + flow.l3, sizeof(ip));
+			const size_t pkt_nb = sizeof(ip) + ntohs(ip.payload_len);
+			end = flow.l3 + pkt_nb < end ? flow.l3 + pkt_nb : end;
+		}
+		begin = flow.payload;
+		return begin <= end;
+	}
+
+	/**
+	 * @return amount of the patterns of the built set.
+	 */
+	inline size_t size() const noexcept {
+		return m_patterns;
+	}
+
+	inline size_t capacity() const noexcept {
+		return m_patterns_max;
+	}
+
+	/**
+	 * @return amount of the states of the built automaton, the root including.
+	 */
+	inline size_t states() const noexcept {
+		return m_states;
+	}
+
+	/**
+	 * @return true - if the scans skip to the first bytes of the patterns by SSE4.2.
+	 */
+	inline bool prefiltered() const noexcept {
+		return m_prefilter;
+	}
+
+	inline size_t storage_bytes() const noexcept {
+		return m_states_max * (sizeof(State) + sizeof(uint8_t)) + m_patterns_max * sizeof(Output)
+			+ (scratch_size() + rows_max() * 256) * sizeof(uint32_t);
+	}
+
+private:
+
+	inline size_t scratch_size() const noexcept {
+		return m_patterns_max + 2 * m_states_max;
+	}
+
+	inline size_t rows_max() const noexcept {
+		return m_states_max < ROWS_MAX ? m_states_max : ROWS_MAX;
+	}
+
+	/**
+	 * @return the child of @state by @byte, NONE - if there is no one.
+	 */
+	inline uint32_t child(uint32_t state, uint8_t byte) const noexcept {
+		const State& parent = m_state_set[state];
+		const uint8_t* const labels = m_labels + parent.first;
+		if(parent.count <= LINEAR_EDGES) {
+			for(uint32_t i = 0; i < parent.count; i++) {
+				if(labels[i] >= byte) {
+					return labels[i] == byte ? parent.first + i : NONE;
+				}
+			}
+			return NONE;
+		}
+		const uint8_t* const label = std::lower_bound(labels, labels + parent.count, byte);
+		return label != labels + parent.count && *label == byte ? parent.first + uint32_t(label - labels) : NONE;
+	}
+
+	/**
+	 * @return the next state by @byte, the failure links are walked till a state with the table.
+	 */
+	inline uint32_t step(uint32_t state, uint8_t byte) const noexcept {
+		while(state >= m_dense) {
+			const uint32_t next = child(state, byte);
+			if(next != NONE) {
+				return next;
+			}
+			state = m_state_set[state].fail;
+		}
+		return m_rows[state * 256 + byte];
+	}
+
+	/**
+	 * @return the first byte of [@data, @end) which starts a pattern, @end - if none.
+	 */
+	inline const uint8_t* skip(const uint8_t* data, const uint8_t* end) const noexcept {
+#if defined(__SSE4_2__)
+		if(m_prefilter) {
+			const __m128i low = _mm_load_si128(reinterpret_cast<const __m128i*>(m_prefilter_low));
+			const __m128i high = _mm_load_si128(reinterpret_cast<const __m128i*>(m_prefilter_high));
+			const __m128i bits = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+			const __m128i nibble = _mm_set1_epi8(0x0F);
+			for(; end - data >= 16; data += 16) {
+				const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+				const __m128i lo = _mm_and_si128(chunk, nibble);
+				const __m128i hi = _mm_and_si128(_mm_srli_epi16(chunk, 4), nibble);
+				// the high bit of a byte selects the table of the high nibbles 8-15
+				const __m128i row = _mm_blendv_epi8(_mm_shuffle_epi8(low, lo), _mm_shuffle_epi8(high, lo), chunk);
+				const __m128i hit = _mm_and_si128(row, _mm_shuffle_epi8(bits, hi));
+				const unsigned mask = ~unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(hit, _mm_setzero_si128()))) & 0xFFFF;
+				if(mask) {
+					return data + __builtin_ctz(mask);
+				}
+			}
+		}
+#endif
+		while(data != end && m_rows[*data] == ROOT) {
+			data++;
+		}
+		return data;
+	}
+
+	/**
+	 * The states in the breadth-first order: a state stands for the range of the sorted patterns which share
+	 * its prefix, the patterns of the prefix length end at it and come first, the rest are split into its children
+	 * by their next byte.
+	 */
+	void build_trie(const MatchPattern* patterns) noexcept {
+		uint32_t* const order = m_scratch;
+		uint32_t* const lo = m_scratch + m_patterns_max;
+		uint32_t* const hi = lo + m_states_max;
+		for(size_t i = 0; i < m_patterns; i++) {
+			order[i] = uint32_t(i);
+		}
+		std::stable_sort(order, order + m_patterns, [patterns](uint32_t a, uint32_t b) noexcept {
+			const size_t length = patterns[a].length < patterns[b].length ? patterns[a].length : patterns[b].length;
+			const int diff = memcmp(patterns[a].data, patterns[b].data, length);
+			return diff ? diff < 0 : patterns[a].length < patterns[b].length;
+		});
+
+		m_states = 1;
+		lo[ROOT] = 0;
+		hi[ROOT] = uint32_t(m_patterns);
+		m_labels[ROOT] = 0;
+		for(size_t state = 0, depth_end = 1, depth = 0; state < m_states; state++) {
+			if(state == depth_end) {
+				depth_end = m_states;
+				depth++;
+			}
+			State& current = m_state_set[state];
+			current.match = NONE;
+			current.first = uint32_t(m_states);
+			current.count = 0;
+			uint32_t k = lo[state];
+			uint32_t* last = &current.match;
+			for(; k < hi[state] && patterns[order[k]].length == depth; k++) {
+				*last = order[k];
+				last = &m_outputs[order[k]].next;
+			}
+			while(k < hi[state]) {
+				const uint8_t byte = patterns[order[k]].data[depth];
+				const uint32_t begin = k;
+				while(k < hi[state] && patterns[order[k]].data[depth] == byte) {
+					k++;
+				}
+				lo[m_states] = begin;
+				hi[m_states] = k;
+				m_labels[m_states] = byte;
+				m_states++;
+				current.count++;
+			}
+		}
+	}
+
+	/**
+	 * The tables of the root and its children (the states [1, m_dense) fail to the root, so their tables are
+	 * the one of the root with their own edges), then the failure links in the breadth-first order, the links
+	 * of a state are of the shorter states, so they are set already.
+	 */
+	void build_links() noexcept {
+		const State& root = m_state_set[ROOT];
+		m_dense = 1 + root.count;
+		for(unsigned byte = 0; byte < 256; byte++) {
+			m_rows[byte] = ROOT;
+		}
+		for(uint32_t i = 0; i < root.count; i++) {
+			m_rows[m_labels[root.first + i]] = root.first + i;
+		}
+		for(uint32_t state = 1; state < m_dense; state++) {
+			uint32_t* const row = m_rows + state * 256;
+			memcpy(row, m_rows, 256 * sizeof(uint32_t));
+			const State& current = m_state_set[state];
+			for(uint32_t i = 0; i < current.count; i++) {
+				row[m_labels[current.first + i]] = current.first + i;
+			}
+		}
+		m_state_set[ROOT].fail = ROOT;
+		m_state_set[ROOT].out = NONE;
+		for(size_t state = 0; state < m_states; state++) {
+			const State& parent = m_state_set[state];
+			for(uint32_t i = 0; i < parent.count; i++) {
+				State& current = m_state_set[parent.first + i];
+				current.fail = state == ROOT ? ROOT : step(parent.fail, m_labels[parent.first + i]);
+				current.out = current.match != NONE ? parent.first + i : m_state_set[current.fail].out;
+			}
+		}
+	}
+
+	void build_prefilter() noexcept {
+		memset(m_prefilter_low, 0, sizeof(m_prefilter_low));
+		memset(m_prefilter_high, 0, sizeof(m_prefilter_high));
+		const State& root = m_state_set[ROOT];
+		for(uint32_t i = 0; i < root.count; i++) {
+			const uint8_t byte = m_labels[root.first + i];
+			uint8_t* const table = byte & 0x80 ? m_prefilter_high : m_prefilter_low;
+			table[byte & 0x0F] |= uint8_t(1u << ((byte >> 4) & 7));
+		}
+#if defined(__SSE4_2__)
+		m_prefilter = root.count && root.count <= PREFILTER_BYTES;
+#else
+		m_prefilter = false;
+#endif
+	}
+
+	void destroy() noexcept {
+		if(m_state_set) {
+			m_state_allocator.deallocate(m_state_set, m_states_max);
+			m_state_set = nullptr;
+		}
+		if(m_labels) {
+			m_label_allocator.deallocate(m_labels, m_states_max);
+			m_labels = nullptr;
+		}
+		if(m_outputs) {
+			m_output_allocator.deallocate(m_outputs, m_patterns_max ? m_patterns_max : 1);
+			m_outputs = nullptr;
+		}
+		if(m_scratch) {
+			m_scratch_allocator.deallocate(m_scratch, scratch_size());
+			m_scratch = nullptr;
+		}
+		if(m_rows) {
+			m_row_allocator.deallocate(m_rows, rows_max() * 256);
+			m_rows = nullptr;
+		}
+		m_patterns = 0;
+		m_states = 0;
+		m_dense = 0;
+	}
+
+};
+
+}; // namespace proto
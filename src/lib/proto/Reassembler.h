@@ -0,0 +1,463 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include "procotols/IPv4.h"
+#include "procotols/IPv6.h"
+#include "parsers/ParsedPacket.h"
+#include "../containers/storage/TimedQueue.h"
+#include "../containers/dpdk/Allocator.h"
+
+namespace proto {
+
+/**
+ * The fragments of a datagram, the addresses are kept as in ParsedPacket (IPv4 in addr32[0]).
+ */
+struct ReassemblyKey {
+	IPv6::Addr src;
+	IPv6::Addr dst;
+	uint32_t id;
+	uint8_t protocol;
+	uint8_t version;
+	uint16_t reserved; // zero, the key is compared as bytes
+
+	bool operator==(const ReassemblyKey& key) const noexcept {
+		return memcmp(this, &key, sizeof(key)) == 0;
+	}
+};
+
+struct ReassemblyKeyHash {
+	inline size_t operator()(const ReassemblyKey& key) const noexcept {
+		const uint64_t h = key.src.addr64[0] ^ key.src.addr64[1]
+			^ ((key.dst.addr64[0] ^ key.dst.addr64[1]) * 0x9e3779b97f4a7c15ull)
+			^ (uint64_t(key.id) << 16) ^ key.protocol;
+		return size_t(intrusive::HashMix<uint64_t>::mix(h));
+	}
+};
+
+struct ReassemblyStat {
+	uint64_t fragments; // stored
+	uint64_t datagrams; // reassembled
+	uint64_t expired; // the incomplete datagrams dropped by the timeout
+	uint64_t evicted; // the oldest incomplete datagrams dropped for the new ones when all the buffers are taken
+	uint64_t dropped; // the malformed or inconsistent fragments, their datagrams are dropped too
+
+	ReassemblyStat() noexcept : fragments(0), datagrams(0), expired(0), evicted(0), dropped(0) {}
+};
+
+/**
+ * The state of an incomplete datagram, see Reassembler.
+ */
+struct ReassemblyEntry {
+	uint32_t buffer;
+	uint32_t payload_bytes; // 0 - until the last fragment has come
+	uint32_t blocks; // the received BLOCK units of the payload
+	uint32_t end; // the farthest end of the received fragments
+	uint16_t header_bytes; // 0 - until the first fragment has come
+
+	ReassemblyEntry() noexcept : buffer(0), payload_bytes(0), blocks(0), end(0), header_bytes(0) {}
+};
+
+/**
+ * Reassembler collects the IPv4 and IPv6 fragments into datagrams, e.g. for the datagrams which HeaderParser stops at.
+ * The incomplete datagrams are kept in a TimedQueue keyed by (src, dst, id, protocol) and dropped after the timeout,
+ * the oldest one is dropped when all the buffers are taken.
+ * Every datagram takes one of the capacity buffers of datagram_bytes which are allocated at once, so the memory
+ * is capped by storage_bytes() and no fragment allocates. The payload is copied into the buffer at its offset,
+ * the received 8-byte blocks are marked in a bitmap, so the overlapping fragments are not counted twice.
+ * The header of the first fragment heads the reassembled datagram, its length, flags and checksum are updated.
+ * The IPv6 datagram is headed by the unfragmentable part of the first fragment, the fragment header is removed.
+ *
+ * Using sample:
+ * ParsedPacket pkt;
+ * if(PacketParser::parse(frame, caplen, pkt) && pkt.fragment) {
+ *     size_t bytes;
+ *     const uint8_t* datagram = reassembler.push(frame, caplen, pkt, bytes);
+ *     if(datagram) {
+ *         HeaderParser hp(datagram, bytes, pkt.ip_version == 4 ? Protocol::L3_IPv4 : Protocol::L3_IPv6);
+ *         ...
+ *     }
+ * }
+ *
+ * @tparam C - the clock source, see storage/Clock.h.
+ */
+template<typename C = storage::CoarseClock>
+class Reassembler {
+public:
+	static constexpr size_t BLOCK = 8; // the fragment offset unit
+	static constexpr size_t HEADER_MAX = 128; // the IPv4 header with options or the IPv6 unfragmentable part, the payload follows it in a buffer
+	static constexpr size_t DATAGRAM_BYTES = 65535;
+	static constexpr unsigned TIMEOUT_MS = 30000; // as net.ipv4.ipfrag_time of Linux
+
+private:
+	using Node_t = storage::TimedQueueNode<ReassemblyKey, ReassemblyEntry>;
+	using Queue_t = storage::TimedQueue<Node_t, ReassemblyKeyHash, intrusive::HashMapBucket<Node_t>, C>;
+	using Iterator_t = typename Queue_t::Iterator_t;
+
+	Queue_t m_queue;
+	const size_t m_capacity;
+	const size_t m_payload_max; // of a datagram
+	const size_t m_buffer_bytes;
+	const size_t m_bitmap_words; // per buffer
+	uint64_t m_timeout; // clock ticks
+	uint8_t* m_buffers;
+	uint64_t* m_bitmaps;
+	uint32_t* m_free; // the stack of the free buffers
+	size_t m_free_size;
+	ReassemblyStat m_stat;
+	dpdk::Allocator<uint8_t> m_buffer_allocator;
+	dpdk::Allocator<uint64_t> m_bitmap_allocator;
+	dpdk::Allocator<uint32_t> m_free_allocator;
+
+public:
+
+	/**
+	 * @param capacity - amount of the datagrams in reassembly.
+	 * @param timeout_ms - the datagram is dropped if it is not complete after this time since its first fragment.
+	 * @param datagram_bytes - the longest datagram, the longer ones are dropped.
+	 */
+	Reassembler(size_t capacity, unsigned timeout_ms = TIMEOUT_MS, size_t datagram_bytes = DATAGRAM_BYTES, float load_factor = 1.0f) noexcept
+		: m_queue(capacity, load_factor)
+		, m_capacity(capacity)
+		, m_payload_max(datagram_bytes > HEADER_MAX ? datagram_bytes - HEADER_MAX : BLOCK)
+		, m_buffer_bytes((HEADER_MAX + m_payload_max + 63) & ~size_t(63))
+		, m_bitmap_words((m_payload_max / BLOCK + 64) / 64)
+		, m_timeout(0)
+		, m_buffers(nullptr)
+		, m_bitmaps(nullptr)
+		, m_free(nullptr)
+		, m_free_size(0)
+		, m_stat()
+		, m_buffer_allocator()
+		, m_bitmap_allocator()
+		, m_free_allocator() {
+		m_timeout = uint64_t(timeout_ms) * m_queue.clock().hz() / 1000;
+	}
+
+	Reassembler(const Reassembler&) = delete;
+	Reassembler& operator=(const Reassembler&) = delete;
+
+	Reassembler(Reassembler&&) = delete;
+	Reassembler& operator=(Reassembler&&) = delete;
+
+	~Reassembler() noexcept {
+		destroy();
+	}
+
+	/**
+	 * @return 0 - if the buffers have been allocated successfully.
+	 */
+	int allocate() noexcept {
+		if(m_buffers)
+			return -1;
+
+		m_buffers = m_buffer_allocator.allocate(m_capacity * m_buffer_bytes);
+		m_bitmaps = m_bitmap_allocator.allocate(m_capacity * m_bitmap_words);
+		m_free = m_free_allocator.allocate(m_capacity);
+		if(m_buffers == nullptr || m_bitmaps == nullptr || m_free == nullptr || m_queue.allocate()) {
+			destroy();
+			return -1;
+		}
+		for(m_free_size = 0; m_free_size < m_capacity; m_free_size++) {
+			m_free[m_free_size] = uint32_t(m_capacity - 1 - m_free_size);
+		}
+		return 0;
+	}
+
+	/**
+	 * Take an IPv4 packet, a packet which is not a fragment is the datagram itself.
+	 * @param data - the IPv4 header.
+	 * @param size - available bytes from the header, the padding past the total length is ignored.
+	 * @param datagram_bytes - the length of the datagram.
+	 * @return the datagram, it is valid until the next push() - or nullptr if the datagram is not complete yet
+	 * or the fragment has been dropped.
+	 */
+	const uint8_t* push(const uint8_t* data, size_t size, size_t& datagram_bytes) noexcept {
+		datagram_bytes = 0;
+		IPv4::Header hdr;
+		if(size < sizeof(hdr)) {
+			m_stat.dropped++;
+			return nullptr;
+		}
+		memcpy(&hdr, data, sizeof(hdr));
+		const size_t hdr_nb = IPv4::hdr_len(&hdr);
+		const size_t pkt_nb = IPv4::pkt_len(&hdr);
+		if(hdr.version != 4 || hdr_nb < sizeof(hdr) || pkt_nb < hdr_nb || size < pkt_nb) {
+			m_stat.dropped++;
+			return nullptr;
+		}
+		if(not IPv4::fragmented(&hdr)) {
+			datagram_bytes = pkt_nb;
+			return data;
+		}
+
+		expire();
+		const size_t offset = IPv4::offset(&hdr);
+		const size_t length = pkt_nb - hdr_nb;
+		const bool last = not IPv4::flag_mf(&hdr);
+		if(length == 0 || (not last && length % BLOCK) || offset + length > m_payload_max) {
+			m_stat.dropped++;
+			return nullptr;
+		}
+
+		ReassemblyKey key;
+		memset(&key, 0, sizeof(key));
+		key.src.addr32[0] = hdr.saddr;
+		key.dst.addr32[0] = hdr.daddr;
+		key.id = hdr.id;
+		key.protocol = hdr.protocol;
+		key.version = 4;
+
+		uint8_t* result = collect(key, data, hdr_nb, data + hdr_nb, offset, length, last, UINT16_MAX, datagram_bytes);
+		if(result) {
+			IPv4::Header* out = reinterpret_cast<IPv4::Header*>(result); // the header is 4 bytes aligned in the buffer
+			out->tot_len = htons(uint16_t(datagram_bytes));
+			out->frag_off &= htons(IP_DF);
+			IPv4::update_checksum(out);
+		}
+		return result;
+	}
+
+	/**
+	 * Take an IPv6 packet, see push() of IPv4.
+	 * @param data - the IPv6 header.
+	 * @param fragment - the offset of the fragment header from @data as walked by IPv6::walk_extensions(),
+	 * 0 - if the packet is not a fragment.
+	 */
+	const uint8_t* push_ipv6(const uint8_t* data, size_t size, size_t fragment, size_t& datagram_bytes) noexcept {
+		datagram_bytes = 0;
+		IPv6::Header hdr;
+		if(size < sizeof(hdr)) {
+			m_stat.dropped++;
+			return nullptr;
+		}
+		memcpy(&hdr, data, sizeof(hdr));
+		const size_t pkt_nb = sizeof(hdr) + ntohs(hdr.payload_len);
+		if(hdr.version != 6 || size < pkt_nb || (fragment && (fragment < sizeof(hdr) || fragment + sizeof(IPv6::Fragment) > pkt_nb))) {
+			m_stat.dropped++;
+			return nullptr;
+		}
+		IPv6::Fragment frag;
+		if(fragment) {
+			memcpy(&frag, data + fragment, sizeof(frag));
+		}
+		if(fragment == 0 || not IPv6::fragmented(&frag)) {
+			datagram_bytes = pkt_nb;
+			return data;
+		}
+
+		expire();
+		const uint16_t offset_flags = ntohs(frag.offset_flags);
+		const size_t offset = offset_flags & 0xFFF8;
+		const size_t length = pkt_nb - fragment - sizeof(frag);
+		const bool last = not (offset_flags & 1);
+		if(fragment > HEADER_MAX || length == 0 || (not last && length % BLOCK) || offset + length > m_payload_max) {
+			m_stat.dropped++;
+			return nullptr;
+		}
+
+		ReassemblyKey key;
+		memset(&key, 0, sizeof(key));
+		key.src = hdr.src;
+		key.dst = hdr.dst;
+		key.id = frag.id;
+		key.version = 6;
+
+		uint8_t* result = collect(key, data, fragment, data + fragment + sizeof(frag), offset, length, last,
+			UINT16_MAX + sizeof(hdr), datagram_bytes);
+		if(result) {
+			// the header before the fragment header takes over its next header
+			size_t field = offsetof(IPv6::Header, next_header);
+			for(size_t pos = sizeof(hdr); pos < fragment; ) {
+				const uint8_t type = result[field];
+				field = pos;
+				pos += IPv6::extension_length(result + pos, type);
+			}
+			result[field] = frag.next_header;
+			const uint16_t payload_len = htons(uint16_t(datagram_bytes - sizeof(hdr)));
+			memcpy(result + offsetof(IPv6::Header, payload_len), &payload_len, sizeof(payload_len));
+		}
+		return result;
+	}
+
+	/**
+	 * Take the IP packet of a frame parsed by PacketParser, the fragment header is found by ParsedPacket::fragment.
+	 * @return nullptr - if the frame has no IP header too.
+	 */
+	const uint8_t* push(const uint8_t* frame, size_t size, const ParsedPacket& pkt, size_t& datagram_bytes) noexcept {
+		datagram_bytes = 0;
+		if(pkt.ip_version == 4) {
+			return push(frame + pkt.l3, size - pkt.l3, datagram_bytes);
+		}
+		if(pkt.ip_version == 6) {
+			return push_ipv6(frame + pkt.l3, size - pkt.l3, pkt.fragment ? pkt.fragment - pkt.l3 : 0, datagram_bytes);
+		}
+		return nullptr;
+	}
+
+	/**
+	 * Drop the datagrams which have timed out, push() calls it, so it is needed when the fragments stop coming only.
+	 */
+	void expire() noexcept {
+		Iterator_t it;
+		while((it = m_queue.pop_front(m_timeout))) {
+			m_free[m_free_size++] = it->value.buffer;
+			m_stat.expired++;
+		}
+	}
+
+	/**
+	 * @return the clock source, e.g. to set the time of a burst.
+	 */
+	inline C& clock() noexcept {
+		return m_queue.clock();
+	}
+
+	/**
+	 * @return amount of the incomplete datagrams.
+	 */
+	inline size_t size() const noexcept {
+		return m_queue.size();
+	}
+
+	inline size_t capacity() const noexcept {
+		return m_capacity;
+	}
+
+	inline const ReassemblyStat& stat() const noexcept {
+		return m_stat;
+	}
+
+	inline size_t storage_bytes() noexcept {
+		return m_capacity * (m_buffer_bytes + m_bitmap_words * sizeof(uint64_t) + sizeof(uint32_t))
+			+ m_queue.storage_bytes();
+	}
+
+private:
+
+	/**
+	 * Store a fragment of the datagram of @key, the header of the first fragment (@offset is 0) is kept.
+	 * @param datagram_max - the longest datagram, its header included.
+	 * @return the datagram (its header is to be updated) - if it is complete.
+	 */
+	uint8_t* collect(const ReassemblyKey& key, const uint8_t* header, size_t header_bytes, const uint8_t* payload,
+			size_t offset, size_t length, bool last, size_t datagram_max, size_t& datagram_bytes) noexcept {
+		Iterator_t it = m_queue.find(key);
+		if(not it) {
+			it = push_back(key);
+			if(not it) {
+				m_stat.dropped++;
+				return nullptr;
+			}
+		}
+
+		// the blocks past the end of the last fragment would be counted for the missed ones
+		ReassemblyEntry& entry = it->value;
+		if((last && entry.payload_bytes && entry.payload_bytes != offset + length)
+		   || (last && entry.end > offset + length)
+		   || (entry.payload_bytes && offset + length > entry.payload_bytes)) {
+			drop(it);
+			return nullptr;
+		}
+		if(last) {
+			entry.payload_bytes = uint32_t(offset + length);
+		}
+		if(offset + length > entry.end) {
+			entry.end = uint32_t(offset + length);
+		}
+
+		uint8_t* buffer = m_buffers + size_t(entry.buffer) * m_buffer_bytes;
+		if(offset == 0) {
+			entry.header_bytes = uint16_t(header_bytes);
+			memcpy(buffer + HEADER_MAX - header_bytes, header, header_bytes);
+		}
+		memcpy(buffer + HEADER_MAX + offset, payload, length);
+		entry.blocks += mark(entry.buffer, offset / BLOCK, (offset + length + BLOCK - 1) / BLOCK);
+		m_stat.fragments++;
+
+		if(entry.payload_bytes == 0 || entry.header_bytes == 0
+		   || entry.blocks < (entry.payload_bytes + BLOCK - 1) / BLOCK) {
+			return nullptr;
+		}
+		if(entry.header_bytes + entry.payload_bytes > datagram_max) {
+			drop(it);
+			return nullptr;
+		}
+
+		datagram_bytes = entry.header_bytes + entry.payload_bytes;
+		uint8_t* result = buffer + HEADER_MAX - entry.header_bytes;
+		release(it);
+		m_stat.datagrams++;
+		return result;
+	}
+
+	/**
+	 * Push a new datagram, the oldest one is evicted if all the buffers are taken.
+	 */
+	Iterator_t push_back(const ReassemblyKey& key) noexcept {
+		if(m_free_size == 0) {
+			Iterator_t oldest = m_queue.pop_front(0);
+			if(not oldest) {
+				return oldest;
+			}
+			m_free[m_free_size++] = oldest->value.buffer;
+			m_stat.evicted++;
+		}
+		Iterator_t it = m_queue.push_back(key);
+		if(it) {
+			it->value = ReassemblyEntry();
+			it->value.buffer = m_free[--m_free_size];
+			memset(m_bitmaps + size_t(it->value.buffer) * m_bitmap_words, 0, m_bitmap_words * sizeof(uint64_t));
+		}
+		return it;
+	}
+
+	/**
+	 * Mark the blocks [first, last) of the buffer.
+	 * @return amount of the blocks which have not been marked before.
+	 */
+	inline uint32_t mark(uint32_t buffer, size_t first, size_t last) noexcept {
+		uint64_t* bitmap = m_bitmaps + size_t(buffer) * m_bitmap_words;
+		uint32_t result = 0;
+		while(first < last) {
+			const size_t bit = first & 63;
+			const size_t bits = last - first < 64 - bit ? last - first : 64 - bit;
+			const uint64_t mask = (bits == 64 ? ~uint64_t(0) : ((uint64_t(1) << bits) - 1)) << bit;
+			uint64_t& word = bitmap[first >> 6];
+			result += uint32_t(__builtin_popcountll(mask & ~word));
+			word |= mask;
+			first += bits;
+		}
+		return result;
+	}
+
+	inline void release(Iterator_t it) noexcept {
+		m_free[m_free_size++] = it->value.buffer;
+		m_queue.remove(it);
+	}
+
+	inline void drop(Iterator_t it) noexcept {
+		release(it);
+		m_stat.dropped++;
+	}
+
+	void destroy() noexcept {
+		if(m_buffers) {
+			m_buffer_allocator.deallocate(m_buffers, m_capacity * m_buffer_bytes);
+			m_buffers = nullptr;
+		}
+		if(m_bitmaps) {
+			m_bitmap_allocator.deallocate(m_bitmaps, m_capacity * m_bitmap_words);
+			m_bitmaps = nullptr;
+		}
+		if(m_free) {
+			m_free_allocator.deallocate(m_free, m_capacity);
+			m_free = nullptr;
+		}
+		m_free_size = 0;
+	}
+
+};
+
+}; // namespace proto
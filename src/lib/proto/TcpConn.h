@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstdint>
+
+#include "procotols/Tcp.h"
+
+namespace proto {
+
+/**
+ * The state of a TCP connection, as seen by a middlebox which sees both directions, two bytes to keep
+ * inline in a flow entry (see storage::FlowEntry).
+ * The initiator is the side of the first packet, update() takes the TCP flags of every packet and its
+ * direction. The states are a coarse subset of the ones of the endpoints (and of nf_conntrack):
+ * NONE -SYN-> SYN_SENT -SYN+ACK-> SYN_RECV -ACK-> ESTABLISHED -FIN-> FIN_WAIT -FIN-> TIME_WAIT,
+ * RST -> CLOSE from any state. A connection picked up in the middle (an ACK without SYN first) is ESTABLISHED.
+ * A new SYN of the initiator reopens a TIME_WAIT or CLOSE connection (a reused port pair).
+ * The sequence numbers are not tracked.
+ */
+struct TcpConn {
+	enum State : uint8_t {
+		NONE,
+		SYN_SENT,
+		SYN_RECV,
+		ESTABLISHED,
+		FIN_WAIT, // one side has sent FIN
+		TIME_WAIT, // both sides have sent FIN
+		CLOSE, // reset
+		STATES
+	};
+
+	uint8_t state;
+	uint8_t fin; // the directions which have sent FIN, 1 - the initiator, 2 - the responder
+
+	TcpConn() noexcept : state(NONE), fin(0) {}
+
+	/**
+	 * @param flags - Tcp::Header::flags.
+	 * @param reverse - true for a packet of the responder.
+	 * @return false - if the packet is not valid in the state (e.g. SYN+ACK of the initiator, data before
+	 * the handshake is done), the state is not changed then.
+	 */
+	bool update(uint8_t flags, bool reverse) noexcept {
+		const uint8_t syn_ack = flags & (Tcp::FLAG_SYN | Tcp::FLAG_ACK);
+		if(flags & Tcp::FLAG_RST) {
+			if(state == NONE || state == CLOSE) {
+				return false;
+			}
+			state = CLOSE;
+			return true;
+		}
+
+		switch(state) {
+			case NONE:
+				if(syn_ack == Tcp::FLAG_SYN) {
+					state = SYN_SENT;
+					return true;
+				}
+				if(syn_ack != Tcp::FLAG_ACK) {
+					return false;
+				}
+				state = ESTABLISHED;
+				break;
+
+			case SYN_SENT:
+				if(reverse && syn_ack == (Tcp::FLAG_SYN | Tcp::FLAG_ACK)) {
+					state = SYN_RECV;
+					return true;
+				}
+				return not reverse && syn_ack == Tcp::FLAG_SYN; // a retransmitted SYN
+
+			case SYN_RECV:
+				if(not reverse && syn_ack == Tcp::FLAG_ACK) {
+					state = ESTABLISHED;
+					break;
+				}
+				// the retransmitted SYN or SYN+ACK
+				return syn_ack == (reverse ? (Tcp::FLAG_SYN | Tcp::FLAG_ACK) : Tcp::FLAG_SYN);
+
+			case ESTABLISHED:
+			case FIN_WAIT:
+				if(syn_ack != Tcp::FLAG_ACK) {
+					return false;
+				}
+				break;
+
+			case TIME_WAIT:
+			case CLOSE:
+				if(not reverse && syn_ack == Tcp::FLAG_SYN) {
+					state = SYN_SENT;
+					fin = 0;
+					return true;
+				}
+				// the last ACKs and the retransmitted FINs of TIME_WAIT, nothing is valid after RST
+				return state == TIME_WAIT && syn_ack == Tcp::FLAG_ACK;
+
+			default:
+				return false;
+		}
+
+		if(flags & Tcp::FLAG_FIN) {
+			fin |= reverse ? 2 : 1;
+			state = fin == 3 ? TIME_WAIT : FIN_WAIT;
+		}
+		return true;
+	}
+
+	inline bool established() const noexcept {
+		return state == ESTABLISHED || state == FIN_WAIT;
+	}
+};
+
+}; // namespace proto
@@ -0,0 +1,594 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include "FlowKey.h"
+#include "procotols/IPv4.h"
+#include "procotols/IPv6.h"
+#include "procotols/Tcp.h"
+#include "parsers/ParsedPacket.h"
+#include "../containers/binio/MArea.h"
+#include "../containers/intrusive_pool/PacketPool.h"
+#include "../containers/storage/TimedQueue.h"
+
+namespace proto {
+
+enum class TcpPushResult : uint8_t {
+	IN_ORDER, // the payload is readable
+	OUT_OF_ORDER, // the payload waits for the bytes before it
+	DUPLICATE, // no new bytes: a retransmission or a packet without payload
+	DROPPED, // the payload is beyond the caps and there is no stream to evict
+	CLOSED // RST, the stream has been released
+};
+
+struct TcpReassemblyStat {
+	uint64_t in_order; // the queued segments
+	uint64_t out_of_order;
+	uint64_t duplicates;
+	uint64_t dropped;
+	uint64_t evicted; // the oldest streams released for the new segments
+	uint64_t expired; // the idle streams released by the timeout
+
+	TcpReassemblyStat() noexcept : in_order(0), out_of_order(0), duplicates(0), dropped(0), evicted(0), expired(0) {}
+};
+
+/**
+ * The state of a direction of a TCP connection, see TcpReassembler.
+ */
+struct TcpStreamEntry {
+	uint32_t base; // the sequence number of the first byte which has not been consumed
+	uint32_t head; // the first segment in the sequence order, TcpReassembler::NONE - none
+	uint32_t bytes; // the buffered payload bytes
+	uint32_t fin; // the sequence number past the last byte, valid if 'finished'
+	uint16_t segments;
+	bool finished; // FIN has come
+
+	TcpStreamEntry() noexcept : base(0), head(UINT32_MAX), bytes(0), fin(0), segments(0), finished(false) {}
+};
+
+/**
+ * TcpReassembler orders the payload of the TCP streams, e.g. for a protocol analyzer which needs the bytes
+ * in order. A stream is one direction of a connection keyed by its FlowKey, so a connection is two streams.
+ * The payload is not copied: a segment is a reference of the pooled packet (PacketPool::clone()) and the range
+ * of its payload, the packet goes back to the pool when the last of its bytes has been consumed.
+ * The readable bytes (the ones from the stream position without a hole) are given as a chain of binio::MCArea
+ * views by areas(), read() copies them out when a parser needs them contiguous.
+ *
+ * The position of a stream is the sequence number next to its SYN or the one of its first segment with payload
+ * if the connection has been picked up in the middle. The segments are kept in the sequence order without
+ * overlaps: the bytes before the position and the bytes which are buffered already are trimmed off a new segment,
+ * a new segment which covers buffered ones replaces them. RST releases the stream.
+ *
+ * The memory is capped: a stream buffers stream_bytes at most (the out of order payload past the position
+ * by stream_bytes is dropped), all the streams buffer total_bytes at most and hold one packet per segment
+ * of the segments capacity. When a global cap is hit the streams idle for the longest are released.
+ * The streams are kept in a TimedQueue which every segment refreshes, the streams idle for the timeout are
+ * released by expire(), push() calls it.
+ *
+ * Using sample:
+ * TcpReassembler<Pool_t> streams(pool, 1 << 16, 1 << 18);
+ * streams.allocate();
+ * ...
+ * auto* pkt = pool.alloc(frame, caplen);
+ * PacketParser::parse(pkt->data(), pkt->length, parsed);
+ * const FlowKey key = FlowKey::of(parsed);
+ * if(parsed.ip_protocol == IPv4::PROTO_TCP && streams.push(key, pkt, parsed) == TcpPushResult::IN_ORDER) {
+ *     binio::MCArea areas[8];
+ *     size_t bytes;
+ *     const size_t n = streams.areas(key, areas, 8, bytes);
+ *     ... // analyze the areas
+ *     streams.consume(key, bytes);
+ * }
+ * pool.free(pkt); // the streams keep their own references
+ *
+ * @tparam P - the packet pool, intrusive::PacketPool.
+ * @tparam C - the clock source, see storage/Clock.h.
+ */
+template<typename P, typename C = storage::CoarseClock>
+class TcpReassembler {
+public:
+	using Packet_t = typename P::Packet_t;
+
+	static constexpr uint32_t NONE = UINT32_MAX;
+	static constexpr unsigned TIMEOUT_MS = 60000;
+	static constexpr size_t STREAM_BYTES = 1 << 20;
+
+private:
+	/**
+	 * The payload bytes [offset, offset + length) of the data of a packet.
+	 */
+	struct Segment {
+		Packet_t* packet;
+		uint32_t seq;
+		uint32_t next; // the next segment of the stream or of the free list
+		uint16_t offset;
+		uint16_t length;
+
+		inline uint32_t end() const noexcept {
+			return seq + length;
+		}
+	};
+
+	using Node_t = storage::TimedQueueNode<FlowKey, TcpStreamEntry>;
+	using Queue_t = storage::TimedQueue<Node_t, std::hash<FlowKey>, intrusive::HashMapBucket<Node_t>, C>;
+	using Iterator_t = typename Queue_t::Iterator_t;
+
+	P& m_pool;
+	Queue_t m_queue;
+	const size_t m_segment_capacity;
+	const size_t m_stream_bytes;
+	const size_t m_total_bytes;
+	uint64_t m_timeout; // clock ticks
+	Segment* m_segments;
+	uint32_t m_free; // the free list of the segments
+	size_t m_bytes; // buffered by all the streams
+	TcpReassemblyStat m_stat;
+	dpdk::Allocator<Segment> m_segment_allocator;
+
+public:
+
+	/**
+	 * @param pool - the pool of the pushed packets.
+	 * @param streams - amount of the streams.
+	 * @param segments - amount of the buffered segments, i.e. of the packets held.
+	 * @param stream_bytes - the buffered bytes of a stream.
+	 * @param total_bytes - the buffered bytes of all the streams, 0 - segments * the packet buffer size.
+	 * @param timeout_ms - a stream is released if there have been no segments for this time.
+	 */
+	TcpReassembler(P& pool, size_t streams, size_t segments, size_t stream_bytes = STREAM_BYTES,
+			size_t total_bytes = 0, unsigned timeout_ms = TIMEOUT_MS, float load_factor = 1.0f) noexcept
+		: m_pool(pool)
+		, m_queue(streams, load_factor)
+		, m_segment_capacity(segments < NONE ? segments : NONE - 1)
+		, m_stream_bytes(stream_bytes)
+		, m_total_bytes(total_bytes ? total_bytes : segments * Packet_t::BUFFER_SIZE)
+		, m_timeout(0)
+		, m_segments(nullptr)
+		, m_free(NONE)
+		, m_bytes(0)
+		, m_stat()
+		, m_segment_allocator() {
+		m_timeout = uint64_t(timeout_ms) * m_queue.clock().hz() / 1000;
+	}
+
+	TcpReassembler(const TcpReassembler&) = delete;
+	TcpReassembler& operator=(const TcpReassembler&) = delete;
+
+	TcpReassembler(TcpReassembler&&) = delete;
+	TcpReassembler& operator=(TcpReassembler&&) = delete;
+
+	/**
+	 * The held packets are freed back to the pool, so the pool must outlive the reassembler.
+	 */
+	~TcpReassembler() noexcept {
+		destroy();
+	}
+
+	/**
+	 * @return 0 - if the segments have been allocated successfully.
+	 */
+	int allocate() noexcept {
+		if(m_segments)
+			return -1;
+
+		m_segments = m_segment_allocator.allocate(m_segment_capacity ? m_segment_capacity : 1);
+		if(m_segments == nullptr)
+			return -1;
+
+		for(size_t i = 0; i < m_segment_capacity; i++) {
+			m_segments[i].packet = nullptr;
+			m_segments[i].next = i + 1 < m_segment_capacity ? uint32_t(i + 1) : NONE;
+		}
+		m_free = m_segment_capacity ? 0 : NONE;
+		if(m_queue.allocate()) {
+			destroy();
+			return -1;
+		}
+		return 0;
+	}
+
+	/**
+	 * Take the payload of a TCP packet parsed by PacketParser from the data of @packet.
+	 * The payload ends by the IP length, so the padding of the frame is not taken.
+	 */
+	TcpPushResult push(const FlowKey& key, Packet_t* packet, const ParsedFlow& flow) noexcept {
+		const uint8_t* data = static_cast<const Packet_t*>(packet)->data(); // the packet may be shared
+		const size_t size = packet->length;
+		if(not flow.has(Protocol::L4_TCP) || flow.payload > size) {
+			m_stat.dropped++;
+			return TcpPushResult::DROPPED;
+		}
+		Tcp::Header hdr;
+		memcpy(&hdr, data + flow.l4, sizeof(hdr));
+		size_t end = size;
+		if(flow.ip_version == 4) {
+			IPv4::Header ip;
+			memcpy(&ip, data + flow.l3, sizeof(ip));
+			const size_t pkt_nb = IPv4::pkt_len(&ip);
+			end = flow.l3 + pkt_nb < end ? flow.l3 + pkt_nb : end;
+		} else {
+			IPv6::Header ip;
+			memcpy(&ip, data + flow.l3, sizeof(ip));
+			const size_t pkt_nb = sizeof(ip) + ntohs(ip.payload_len);
+			end = flow.l3 + pkt_nb < end ? flow.l3 + pkt_nb : end;
+		}
+		const size_t length = end > flow.payload ? end - flow.payload : 0;
+		return push(key, ntohl(hdr.seq_num), hdr.flags, packet, flow.payload, length);
+	}
+
+	/**
+	 * Take a TCP segment.
+	 * @param seq - the sequence number of the segment, in the host byte order.
+	 * @param flags - Tcp::Header::flags.
+	 * @param offset - the payload from the data of @packet.
+	 * @param length - the payload bytes.
+	 */
+	TcpPushResult push(const FlowKey& key, uint32_t seq, uint8_t flags, Packet_t* packet, size_t offset,
+			size_t length) noexcept {
+		expire();
+		Iterator_t it = m_queue.find(key);
+		if(flags & Tcp::FLAG_RST) {
+			if(it) {
+				release(it);
+			}
+			return TcpPushResult::CLOSED;
+		}
+		if(flags & Tcp::FLAG_SYN) {
+			seq++; // SYN takes a sequence number
+		}
+		if(it) {
+			m_queue.touch(it);
+		} else {
+			if(length == 0 && not (flags & Tcp::FLAG_SYN)) {
+				m_stat.duplicates++;
+				return TcpPushResult::DUPLICATE;
+			}
+			it = push_back(key);
+			if(not it) {
+				m_stat.dropped++;
+				return TcpPushResult::DROPPED;
+			}
+			it->value.base = seq;
+		}
+		TcpStreamEntry& entry = it->value;
+		if(flags & Tcp::FLAG_SYN && entry.head == NONE && entry.base != seq) {
+			entry.base = seq; // a new SYN of a reused port pair
+		}
+		if(flags & Tcp::FLAG_FIN) {
+			entry.finished = true;
+			entry.fin = seq + uint32_t(length);
+		}
+
+		// the bytes which have been consumed
+		if(before(seq, entry.base)) {
+			const uint32_t cut = entry.base - seq;
+			if(cut >= length) {
+				m_stat.duplicates++;
+				return TcpPushResult::DUPLICATE;
+			}
+			seq += cut;
+			offset += cut;
+			length -= cut;
+		}
+		if(length == 0) {
+			m_stat.duplicates++;
+			return TcpPushResult::DUPLICATE;
+		}
+		if(seq - entry.base >= m_stream_bytes) {
+			m_stat.dropped++;
+			return TcpPushResult::DROPPED;
+		}
+
+		// the buffered bytes before the segment and the buffered segments it covers
+		uint32_t prev = NONE;
+		uint32_t current = entry.head;
+		uint32_t ready = entry.base; // the end of the readable bytes before the segment
+		bool hole = false;
+		while(current != NONE && not before(seq, m_segments[current].end())) {
+			hole |= m_segments[current].seq != ready;
+			ready = m_segments[current].end();
+			prev = current;
+			current = m_segments[current].next;
+		}
+		if(current != NONE && not before(seq, m_segments[current].seq)) {
+			hole |= m_segments[current].seq != ready;
+			ready = m_segments[current].end();
+			const uint32_t cut = m_segments[current].end() - seq;
+			if(cut >= length) {
+				m_stat.duplicates++;
+				return TcpPushResult::DUPLICATE;
+			}
+			seq += cut;
+			offset += cut;
+			length -= cut;
+			prev = current;
+			current = m_segments[current].next;
+		}
+		// the covered segments are freed once the segment is taken, a dropped one leaves the stream as it was
+		uint32_t last = current;
+		size_t covered = 0;
+		while(last != NONE && not before(seq + uint32_t(length), m_segments[last].end())) {
+			covered += m_segments[last].length;
+			last = m_segments[last].next;
+		}
+		if(last != NONE && before(m_segments[last].seq, seq + uint32_t(length))) {
+			length = m_segments[last].seq - seq;
+		}
+		if(entry.bytes - covered + length > m_stream_bytes || not reserve(it, length - covered, last != current)) {
+			m_stat.dropped++;
+			return TcpPushResult::DROPPED;
+		}
+		while(current != last) {
+			const uint32_t next = m_segments[current].next;
+			free_segment(entry, current);
+			current = next;
+		}
+		const uint32_t index = m_free;
+		Segment& segment = m_segments[index];
+		m_free = segment.next;
+		segment.packet = m_pool.clone(packet);
+		segment.seq = seq;
+		segment.offset = uint16_t(offset);
+		segment.length = uint16_t(length);
+		segment.next = current;
+		if(prev == NONE) {
+			entry.head = index;
+		} else {
+			m_segments[prev].next = index;
+		}
+		entry.bytes += uint32_t(length);
+		entry.segments++;
+		m_bytes += length;
+		if(not hole && seq == ready) {
+			m_stat.in_order++;
+			return TcpPushResult::IN_ORDER;
+		}
+		m_stat.out_of_order++;
+		return TcpPushResult::OUT_OF_ORDER;
+	}
+
+	/**
+	 * The readable bytes of a stream as views into the held packets, they are valid until the stream is changed.
+	 * @param areas - @n areas at most, the following readable bytes are in the next call after consume().
+	 * @param bytes - the bytes of the areas.
+	 * @return amount of the areas, 0 - if there is nothing to read or no stream.
+	 */
+	size_t areas(const FlowKey& key, binio::MCArea* areas, size_t n, size_t& bytes) noexcept {
+		bytes = 0;
+		Iterator_t it = m_queue.find(key);
+		if(not it)
+			return 0;
+
+		size_t result = 0;
+		uint32_t seq = it->value.base;
+		for(uint32_t i = it->value.head; i != NONE && result < n && m_segments[i].seq == seq; i = m_segments[i].next) {
+			const Segment& segment = m_segments[i];
+			areas[result++] = binio::as_const_area(payload(segment), size_t(segment.length));
+			bytes += segment.length;
+			seq = segment.end();
+		}
+		return result;
+	}
+
+	/**
+	 * @return amount of the readable bytes of a stream.
+	 */
+	size_t readable(const FlowKey& key) noexcept {
+		Iterator_t it = m_queue.find(key);
+		if(not it)
+			return 0;
+
+		size_t result = 0;
+		uint32_t seq = it->value.base;
+		for(uint32_t i = it->value.head; i != NONE && m_segments[i].seq == seq; i = m_segments[i].next) {
+			result += m_segments[i].length;
+			seq = m_segments[i].end();
+		}
+		return result;
+	}
+
+	/**
+	 * Move the position of a stream past @bytes of its readable bytes, the consumed packets are freed.
+	 */
+	void consume(const FlowKey& key, size_t bytes) noexcept {
+		Iterator_t it = m_queue.find(key);
+		if(it) {
+			consume(it->value, bytes, nullptr);
+		}
+	}
+
+	/**
+	 * Copy up to @bytes of the readable bytes to @out and consume them.
+	 * @return amount of the copied bytes.
+	 */
+	size_t read(const FlowKey& key, uint8_t* out, size_t bytes) noexcept {
+		Iterator_t it = m_queue.find(key);
+		return it ? consume(it->value, bytes, out) : 0;
+	}
+
+	/**
+	 * @return true - if the stream has got FIN and all its bytes have been consumed, it may be closed then.
+	 */
+	bool finished(const FlowKey& key) noexcept {
+		Iterator_t it = m_queue.find(key);
+		return it && it->value.finished && it->value.base == it->value.fin;
+	}
+
+	/**
+	 * Release a stream and its packets, e.g. when its connection is done.
+	 */
+	void close(const FlowKey& key) noexcept {
+		Iterator_t it = m_queue.find(key);
+		if(it) {
+			release(it);
+		}
+	}
+
+	/**
+	 * Release the streams which have timed out, push() calls it, so it is needed when the segments stop coming only.
+	 */
+	void expire() noexcept {
+		Iterator_t it;
+		while((it = m_queue.pop_front(m_timeout))) {
+			free_segments(it->value);
+			m_stat.expired++;
+		}
+	}
+
+	/**
+	 * @return the clock source, e.g. to set the time of a burst.
+	 */
+	inline C& clock() noexcept {
+		return m_queue.clock();
+	}
+
+	/**
+	 * @return amount of the streams.
+	 */
+	inline size_t size() const noexcept {
+		return m_queue.size();
+	}
+
+	/**
+	 * @return the payload bytes buffered by all the streams.
+	 */
+	inline size_t bytes() const noexcept {
+		return m_bytes;
+	}
+
+	inline const TcpReassemblyStat& stat() const noexcept {
+		return m_stat;
+	}
+
+	inline size_t storage_bytes() noexcept {
+		return m_segment_capacity * sizeof(Segment) + m_queue.storage_bytes();
+	}
+
+private:
+
+	static inline bool before(uint32_t a, uint32_t b) noexcept {
+		return int32_t(a - b) < 0;
+	}
+
+	/**
+	 * @return the payload of a segment, the held packets are shared, so they are read only.
+	 */
+	static inline const uint8_t* payload(const Segment& segment) noexcept {
+		return static_cast<const Packet_t*>(segment.packet)->data() + segment.offset;
+	}
+
+	void destroy() noexcept {
+		if(m_segments) {
+			for(size_t i = 0; i < m_segment_capacity; i++) {
+				if(m_segments[i].packet) {
+					m_pool.free(m_segments[i].packet);
+				}
+			}
+			m_segment_allocator.deallocate(m_segments, m_segment_capacity ? m_segment_capacity : 1);
+			m_segments = nullptr;
+		}
+		m_free = NONE;
+		m_bytes = 0;
+	}
+
+	/**
+	 * Push a new stream, the oldest one is evicted if all the streams are taken.
+	 */
+	Iterator_t push_back(const FlowKey& key) noexcept {
+		Iterator_t it = m_queue.push_back(key);
+		if(not it) {
+			if(not evict()) {
+				return it;
+			}
+			it = m_queue.push_back(key);
+		}
+		if(it) {
+			it->value = TcpStreamEntry();
+		}
+		return it;
+	}
+
+	/**
+	 * Make room for @bytes more bytes, the streams idle for the longest but @it are evicted.
+	 * @param reused - a segment of @it is going to be freed, so no free one is needed.
+	 * @return false - if only @it is left.
+	 */
+	bool reserve(Iterator_t it, size_t bytes, bool reused) noexcept {
+		while((m_free == NONE && not reused) || m_bytes + bytes > m_total_bytes) {
+			if(m_queue.size() < 2 || not evict()) {
+				return false;
+			}
+		}
+		(void) it; // @it has just been touched, so it is the newest one
+		return true;
+	}
+
+	bool evict() noexcept {
+		Iterator_t oldest = m_queue.pop_front(0);
+		if(not oldest)
+			return false;
+
+		free_segments(oldest->value);
+		m_stat.evicted++;
+		return true;
+	}
+
+	void release(Iterator_t it) noexcept {
+		free_segments(it->value);
+		m_queue.remove(it);
+	}
+
+	void free_segments(TcpStreamEntry& entry) noexcept {
+		while(entry.head != NONE) {
+			const uint32_t next = m_segments[entry.head].next;
+			free_segment(entry, entry.head);
+			entry.head = next;
+		}
+	}
+
+	/**
+	 * Free a segment, the caller unlinks it.
+	 */
+	inline void free_segment(TcpStreamEntry& entry, uint32_t index) noexcept {
+		Segment& segment = m_segments[index];
+		m_pool.free(segment.packet);
+		segment.packet = nullptr;
+		entry.bytes -= segment.length;
+		entry.segments--;
+		m_bytes -= segment.length;
+		segment.next = m_free;
+		m_free = index;
+	}
+
+	/**
+	 * Consume up to @bytes of the readable bytes, copy them to @out if it is not nullptr.
+	 * @return amount of the consumed bytes.
+	 */
+	size_t consume(TcpStreamEntry& entry, size_t bytes, uint8_t* out) noexcept {
+		size_t result = 0;
+		while(result < bytes && entry.head != NONE && m_segments[entry.head].seq == entry.base) {
+			Segment& segment = m_segments[entry.head];
+			const size_t taken = bytes - result < segment.length ? bytes - result : segment.length;
+			if(out) {
+				memcpy(out + result, payload(segment), taken);
+			}
+			result += taken;
+			entry.base += uint32_t(taken);
+			if(taken == segment.length) {
+				const uint32_t next = segment.next;
+				free_segment(entry, entry.head);
+				entry.head = next;
+			} else {
+				segment.seq += uint32_t(taken);
+				segment.offset += uint16_t(taken);
+				segment.length -= uint16_t(taken);
+				entry.bytes -= uint32_t(taken);
+				m_bytes -= taken;
+			}
+		}
+		return result;
+	}
+};
+
+}; // namespace proto
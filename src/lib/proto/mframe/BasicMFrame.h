@@ -51,14 +51,14 @@ public:
 	 * @return The 'begin' pointer.
 	 */
 	inline T* begin() const noexcept {
-		return m_head;
+		return m_head - offset();
 	}
 
 	/**
 	 * @return The 'head' pointer.
 	 */
 	inline T* head() const noexcept {
-		return m_head + offset();
+		return m_head;
 	}
 
 	/**
@@ -72,7 +72,7 @@ public:
 	 * @return The 'end' pointer.
 	 */
 	inline T* end() const noexcept {
-		return m_head + m_size;
+		return begin() + m_size;
 	}
 
 	/**
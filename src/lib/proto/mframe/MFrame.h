@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <cstring>
 
 #include "BasicMFrame.h"
 
@@ -24,6 +25,12 @@ class MFrame : public BasicMFrame<T> {
 
 public:
 
+	/**
+	 * An empty frame, e.g. an element of a burst before it is filled.
+	 */
+	MFrame() noexcept :
+		Base(static_cast<T*>(nullptr), 0) {}
+
 	template <typename Ptr>
 	MFrame(Ptr* buffer, size_t buffer_bytes) noexcept :
 		Base(buffer, buffer_bytes) {}
@@ -117,6 +124,27 @@ public:
 		pointer = reinterpret_cast<V*>(Base::m_head);
 	}
 
+	/**
+	 * Pass a view of @bytes at the head to @fn, the head moves as far as the head of the view has moved.
+	 * There is no check, it is for the code which takes both MFrame and SafeMFrame (see SafeMFrame::with_span()).
+	 * @param fn - a functor which takes 'MFrame&'.
+	 * @return true.
+	 */
+	template<typename F>
+	inline bool with_span(size_t bytes, const F& fn) noexcept {
+		MFrame view(Base::m_head, bytes);
+		fn(view);
+		head_move(view.offset());
+		return true;
+	}
+
+	template<typename F>
+	inline bool with_span(size_t bytes, const F& fn) const noexcept {
+		MFrame view(Base::m_head, bytes);
+		fn(view);
+		return true;
+	}
+
 	/**
 	 * Write @value to the packet.
 	 * The head moves to the new position.
@@ -142,7 +170,7 @@ protected:
 
 	template<typename V>
 	inline void read_impl(V& value) noexcept {
-		value = *(reinterpret_cast<const V*>(Base::m_head));
+		memcpy(&value, Base::m_head, sizeof(V)); // the head is at any alignment
 		Base::m_head += sizeof(V);
 		Base::m_available -= sizeof(V);
 	}
@@ -155,7 +183,7 @@ protected:
 
 	template<typename V>
 	inline void write_impl(const V& value) noexcept {
-		*reinterpret_cast<V*>(Base::m_head) = value;
+		memcpy(Base::m_head, &value, sizeof(V));
 		Base::m_head += sizeof(V);
 		Base::m_available -= sizeof(V);
 	}
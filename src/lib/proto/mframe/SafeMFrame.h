@@ -5,6 +5,7 @@
 #include <cstdint>
 
 #include "BasicMFrame.h"
+#include "MFrame.h"
 
 namespace proto {
 
@@ -30,6 +31,9 @@ namespace proto {
  * from 'Out of bounds' back to 'In bounds' state.
  * All the non-const methods return a state of the object they are called with.
  * All the read, write or assign operations work with the 'available' subarea of the Area object only.
+ *
+ * A header of a known length is checked once by with_span(), its fields are taken through an unchecked
+ * MFrame of the span, e.g. by next() of the protocols, instead of a check per read(), assign() and head_move().
  * 
  **/
 
@@ -179,11 +183,12 @@ public:
 	/**
 	 * Assign a pointer to the head.
 	 * The head moves to the new position.
-	 * @param pointer - a pointer to assign.
+	 * @param pointer - a pointer to assign, nullptr if the packet is out of its bounds.
 	 * @return true - if the packet is in its bounds after assigning.
 	 */
 	template<typename V>
 	inline bool assign(V*& pointer) noexcept {
+		pointer = nullptr;
 		if(m_in_bounds) {
 			if(sizeof(V) > Base::m_available) {
 				m_in_bounds = false;
@@ -199,11 +204,12 @@ public:
 	/**
 	 * Assign a pointer to the head.
 	 * The head doesn't move.
-	 * @param pointer - a pointer to assign.
+	 * @param pointer - a pointer to assign, nullptr if the packet is out of its bounds.
 	 * @return true - if the packet is in its bounds after assigning.
 	 */
 	template<typename V>
 	inline bool assign_stay(V*& pointer) noexcept {
+		pointer = nullptr;
 		if(m_in_bounds) {
 			if(sizeof(V) > Base::m_available) {
 				m_in_bounds = false;
@@ -214,6 +220,65 @@ public:
 		return m_in_bounds;
 	}
 
+	/**
+	 * Assign a pointer to the head of a const packet, e.g. by validate_header() of the protocols.
+	 * The head doesn't move, the packet doesn't go out of bounds if @pointer doesn't fit.
+	 * @param pointer - a pointer to assign, nullptr if it doesn't fit.
+	 * @return true - if @pointer has been assigned.
+	 */
+	template<typename V>
+	inline bool assign_stay(V*& pointer) const noexcept {
+		if(m_in_bounds && sizeof(V) <= Base::m_available) {
+			pointer = reinterpret_cast<V*>(Base::m_head);
+			return true;
+		}
+		pointer = nullptr;
+		return false;
+	}
+
+	/**
+	 * Check once that @bytes are available and pass an unchecked MFrame of them to @fn.
+	 * The head moves as far as the head of the view has moved, @fn must not read beyond the view.
+	 * The packet goes out of bounds if @bytes are not available (@fn is not called then)
+	 * or if the head of the view has been moved beyond it.
+	 * @param fn - a functor which takes 'MFrame<T>&'.
+	 * @return true - if the packet is in its bounds after the span.
+	 */
+	template<typename F>
+	inline bool with_span(size_t bytes, const F& fn) noexcept {
+		if(m_in_bounds) {
+			if(bytes > Base::m_available) {
+				m_in_bounds = false;
+			} else {
+				MFrame<T> view(Base::m_head, bytes);
+				fn(view);
+				const size_t used = view.offset();
+				if(used > bytes) {
+					m_in_bounds = false;
+				} else {
+					Base::m_head += used;
+					Base::m_available -= used;
+				}
+			}
+		}
+		return m_in_bounds;
+	}
+
+	/**
+	 * with_span() of a const packet, e.g. by validate_header() of the protocols, the head doesn't move
+	 * and the packet doesn't go out of bounds if @bytes are not available.
+	 * @return true - if @fn has been called.
+	 */
+	template<typename F>
+	inline bool with_span(size_t bytes, const F& fn) const noexcept {
+		if(m_in_bounds && bytes <= Base::m_available) {
+			MFrame<T> view(Base::m_head, bytes);
+			fn(view);
+			return true;
+		}
+		return false;
+	}
+
 	/**
 	 * Write @value to the packet.
 	 * The head moves to the new position.
@@ -264,7 +329,7 @@ protected:
 
 	template<typename V>
 	inline void read_impl(V& value) noexcept {
-		value = *reinterpret_cast<const V*>(Base::m_head);
+		memcpy(&value, Base::m_head, sizeof(V)); // the head is at any alignment
 		Base::m_head += sizeof(V);
 		Base::m_available -= sizeof(V);
 	}
@@ -277,7 +342,7 @@ protected:
 
 	template<typename V>
 	inline void write_impl(const V& value) noexcept {
-		*(reinterpret_cast<V*>(Base::m_head)) = value;
+		memcpy(Base::m_head, &value, sizeof(V));
 		Base::m_head += sizeof(V);
 		Base::m_available -= sizeof(V);
 	}
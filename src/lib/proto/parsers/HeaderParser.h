@@ -3,6 +3,7 @@
 #include <cstdlib>
 
 #include "../proto.h"
+#include "ParserMetrics.h"
 #include "../mframe/MFrame.h"
 #include "../mframe/SafeMFrame.h"
 
@@ -13,6 +14,9 @@
 #include "../procotols/Tcp.h"
 #include "../procotols/Udp.h"
 #include "../procotols/Gre.h"
+#include "../procotols/Mpls.h"
+#include "../procotols/Vxlan.h"
+#include "../procotols/GtpU.h"
 
 namespace proto {
 
@@ -50,6 +54,11 @@ namespace proto {
  *                           head
  *
  * and etc.
+ *
+ * The tunnels (GRE, VXLAN, GTP-U) are walked through, depth() tells the inner headers from the outer ones:
+ *
+ *  |--Ethernet--|--IPv4--|--UDP--|--GTP-U--|--IPv4--|--TCP--|
+ *   depth() == 0                            depth() == 1
  */
 
 template <typename MFrame>
@@ -57,12 +66,13 @@ class BasicHeaderParser {
 protected:
 	MFrame m_frame;
 	Protocol proto;
+	unsigned m_depth;
 
 public:
 
 	template <typename Ptr>
 	BasicHeaderParser(const Ptr* buffer, size_t size_bytes, Protocol proto_first = Protocol::L2_ETHERNET) noexcept :
-		m_frame(buffer, size_bytes), proto(validate_header(proto_first)) {}
+		m_frame(buffer, size_bytes), proto(validate_header(proto_first)), m_depth(0) {}
 
 	/**
 	 * Return a current protocol in the stack.
@@ -72,11 +82,19 @@ public:
 		return proto;
 	}
 
+	/**
+	 * @return amount of the tunnels the current protocol is encapsulated into, 0 - for the outer headers.
+	 */
+	inline unsigned depth() const noexcept {
+		return m_depth;
+	}
+
 	/**
 	 * Step to the next protocol in the stack.
 	 * @return - the next protocol.
 	 */
 	Protocol next() noexcept {
+		m_depth += tunnel(proto);
 		Protocol next_proto = Protocol::END;
 		switch(proto) {
 			case Protocol::L2_ETHERNET:
@@ -107,6 +125,18 @@ public:
 				next_proto = Gre::next(m_frame);
 				break;
 
+			case Protocol::L2_MPLS:
+				next_proto = Mpls::next(m_frame);
+				break;
+
+			case Protocol::L5_VXLAN:
+				next_proto = Vxlan::next(m_frame);
+				break;
+
+			case Protocol::L5_GTPU:
+				next_proto = GtpU::next(m_frame);
+				break;
+
 			default:
 				break;
 		}
@@ -153,9 +183,22 @@ private:
 				result = Gre::validate_header(m_frame);
 				break;
 
+			case Protocol::L2_MPLS:
+				result = Mpls::validate_header(m_frame);
+				break;
+
+			case Protocol::L5_VXLAN:
+				result = Vxlan::validate_header(m_frame);
+				break;
+
+			case Protocol::L5_GTPU:
+				result = GtpU::validate_header(m_frame);
+				break;
+
 			default:
 				break;
 		}
+		ParserMetrics::count(new_proto, result);
 		if(not result) {
 			new_proto = Protocol::END;
 		}
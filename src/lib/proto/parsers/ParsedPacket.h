@@ -0,0 +1,508 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <arpa/inet.h>
+#include <linux/if_ether.h>
+
+#include "../proto.h"
+#include "../procotols/Ethernet.h"
+#include "../procotols/Vlan.h"
+#include "../procotols/IPv4.h"
+#include "../procotols/IPv6.h"
+#include "../procotols/Tcp.h"
+#include "../procotols/Udp.h"
+#include "../procotols/Gre.h"
+#include "../procotols/Mpls.h"
+#include "../procotols/Vxlan.h"
+#include "../procotols/GtpU.h"
+
+namespace proto {
+
+/**
+ * The headers of an IP level of ParsedPacket: the outer packet or the packet inside a tunnel.
+ * The offsets are from the start of the frame, 0 - if the layer is absent.
+ * An IPv4 address is kept in addr32[0] of IPv6::Addr, the rest of it is zeroed, so the addresses of both
+ * versions are compared and hashed in the same way. The addresses and the ports are in the network byte order.
+ */
+struct ParsedFlow {
+	uint16_t l3; // offset of the IP header
+	uint16_t l4; // offset of the TCP, UDP or GRE header
+	uint16_t payload; // offset past the last parsed header
+	uint16_t fragment; // offset of the IPv4 header of a fragment or of the IPv6 fragment header, see Reassembler::push()
+	uint16_t protocols; // bitmask of (1 << Protocol)
+	uint8_t ip_protocol; // the IPv4 protocol or the IPv6 next header past the extension headers
+	uint8_t ip_version; // 4, 6 or 0
+	uint16_t src_port;
+	uint16_t dst_port;
+	IPv6::Addr src;
+	IPv6::Addr dst;
+
+	inline bool has(Protocol protocol) const noexcept {
+		return protocols & (1u << protocol);
+	}
+
+	/**
+	 * @return true - if the ports are valid, the addresses are valid for an IP packet.
+	 */
+	inline bool has_ports() const noexcept {
+		return protocols & ((1u << Protocol::L4_TCP) | (1u << Protocol::L4_UDP));
+	}
+};
+
+/**
+ * The flattened result of PacketParser::parse(), a POD which can be copied into a hash table key as it is.
+ * The fields of ParsedFlow are of the outer packet (the Ethernet header is always at 0), the packet inside
+ * the first tunnel (GRE, VXLAN, GTP-U) is in @inner, so both 5-tuples are taken in one pass.
+ */
+struct ParsedPacket : public ParsedFlow {
+	static constexpr unsigned VLAN_MAX = 2; // the outer VLAN ids kept, the inner tags are skipped
+
+	uint16_t ethertype; // of the L3, in the host byte order
+	uint16_t vlan[VLAN_MAX]; // VLAN ids, in the host byte order
+	uint8_t vlan_count; // amount of the VLAN tags, may be above VLAN_MAX
+	uint8_t tunnel; // the Protocol of the encapsulation (L4_GRE, L5_VXLAN or L5_GTPU), 0 - if there is no one
+	uint32_t tunnel_id; // the GRE key, the VXLAN VNI or the GTP-U TEID, in the host byte order
+	ParsedFlow inner; // the offsets are from the start of the frame too
+
+	inline bool tunneled() const noexcept {
+		return tunnel != 0;
+	}
+};
+
+/**
+ * PacketParser parses Ethernet -> VLAN/QinQ... -> MPLS... -> IPv4/IPv6 -> TCP/UDP/GRE in one pass without the per
+ * layer dispatching of BasicHeaderParser, it stops at the same headers as HeaderParser does (a fragment has no L4).
+ * The IPv6 extension headers are skipped by IPv6::walk_extensions(), so l4 and ip_protocol are of the upper layer.
+ * The payload of GRE, VXLAN (UDP port Vxlan::PORT) and a GTP-U G-PDU (UDP port GtpU::PORT) is parsed
+ * into ParsedPacket::inner the same way, a tunnel inside the inner packet is not descended.
+ * The headers are read by memcpy, so the frame data needs no alignment.
+ */
+class PacketParser {
+public:
+	static constexpr size_t LANES = 4; // the packets which parse_burst() takes through the common path together
+	static constexpr size_t PREFETCH = 8; // how far ahead parse_burst() prefetches the packets
+	static constexpr unsigned MPLS_MAX = 8; // the MPLS labels walked, the payload of a deeper stack is not parsed
+
+	/**
+	 * @return true - if an IP header has been found.
+	 */
+	static bool parse(const uint8_t* data, size_t size, ParsedPacket& pkt) noexcept {
+		memset(&pkt, 0, sizeof(pkt));
+		if(size > UINT16_MAX) {
+			size = UINT16_MAX; // the offsets are 16 bits, the headers are far below
+		}
+		if(size < sizeof(Ethernet::Header)) {
+			return false;
+		}
+		pkt.protocols = 1u << Protocol::L2_ETHERNET;
+		uint16_t ethertype = load16(data + offsetof(Ethernet::Header, h_proto));
+		const size_t offset = layer2(data, size, sizeof(Ethernet::Header), ethertype, pkt.protocols, &pkt);
+		pkt.ethertype = ethertype;
+		pkt.payload = uint16_t(offset);
+		if(not layer3(data, size, offset, ethertype, pkt)) {
+			return false;
+		}
+		if(pkt.l4) {
+			decapsulate(data, size, pkt);
+		}
+		return true;
+	}
+
+	/**
+	 * Parse @n frames, the result is the same as of parse() for every frame.
+	 * The first cache lines of the frames are prefetched PREFETCH frames ahead, the frames are taken by LANES
+	 * through Ethernet -> (one VLAN) -> IPv4/IPv6 -> TCP/UDP one layer at a time, so the loads of the lanes
+	 * overlap. A frame which leaves the common path (more VLAN tags, QinQ, MPLS, fragments, IPv6 extension headers,
+	 * GRE and the UDP tunnels, a non IP ethertype, a truncated header) is parsed again by parse().
+	 * @tparam Frame - has m_data and m_hdr.caplen as pcapwrap::Frame does.
+	 */
+	template <typename Frame>
+	static void parse_burst(const Frame* frames, size_t n, ParsedPacket* out) noexcept {
+		const size_t ahead = n < PREFETCH ? n : PREFETCH;
+		for(size_t i = 0; i < ahead; i++) {
+			__builtin_prefetch(frames[i].m_data);
+		}
+
+		Lane lanes[LANES];
+		size_t i = 0;
+		for(; i + LANES <= n; i += LANES) {
+			for(size_t k = 0; k < LANES; k++) {
+				if(i + k + PREFETCH < n) {
+					__builtin_prefetch(frames[i + k + PREFETCH].m_data);
+				}
+				lanes[k].data = frames[i + k].m_data;
+				lanes[k].size = frames[i + k].m_hdr.caplen;
+				lanes[k].slow = false;
+			}
+			for(size_t k = 0; k < LANES; k++) {
+				lane_l2(lanes[k], out[i + k]);
+			}
+			for(size_t k = 0; k < LANES; k++) {
+				lane_l3(lanes[k], out[i + k]);
+			}
+			for(size_t k = 0; k < LANES; k++) {
+				lane_l4(lanes[k], out[i + k]);
+			}
+			for(size_t k = 0; k < LANES; k++) {
+				if(lanes[k].slow) {
+					parse(lanes[k].data, lanes[k].size, out[i + k]);
+				}
+			}
+		}
+		for(; i < n; i++) {
+			if(i + PREFETCH < n) {
+				__builtin_prefetch(frames[i + PREFETCH].m_data);
+			}
+			parse(frames[i].m_data, frames[i].m_hdr.caplen, out[i]);
+		}
+	}
+
+private:
+
+	struct Lane {
+		const uint8_t* data;
+		size_t size;
+		size_t offset;
+		uint8_t next;
+		bool slow; // the lane has left the common path
+	};
+
+	static inline void lane_l2(Lane& lane, ParsedPacket& pkt) noexcept {
+		memset(&pkt, 0, sizeof(pkt));
+		if(lane.size > UINT16_MAX) {
+			lane.size = UINT16_MAX;
+		}
+		if(lane.size < sizeof(Ethernet::Header) + sizeof(Vlan::Header)) {
+			lane.slow = true;
+			return;
+		}
+		pkt.protocols = 1u << Protocol::L2_ETHERNET;
+		lane.offset = sizeof(Ethernet::Header);
+		uint16_t ethertype = load16(lane.data + offsetof(Ethernet::Header, h_proto));
+		if(ethertype == ETH_P_8021Q) {
+			pkt.vlan[0] = load16(lane.data + lane.offset) & 0x0FFF;
+			pkt.vlan_count = 1;
+			pkt.protocols |= 1u << Protocol::L2_VLAN;
+			ethertype = load16(lane.data + lane.offset + offsetof(Vlan::Header, nextProto));
+			lane.offset += sizeof(Vlan::Header);
+		}
+		if(ethertype != ETH_P_IP && ethertype != ETH_P_IPV6) {
+			lane.slow = true;
+			return;
+		}
+		pkt.ethertype = ethertype;
+	}
+
+	static inline void lane_l3(Lane& lane, ParsedPacket& pkt) noexcept {
+		if(lane.slow) {
+			return;
+		}
+		const uint8_t* ptr = lane.data + lane.offset;
+		const size_t available = lane.size - lane.offset;
+		if(pkt.ethertype == ETH_P_IP) {
+			IPv4::Header hdr;
+			if(available < sizeof(hdr)) {
+				lane.slow = true;
+				return;
+			}
+			memcpy(&hdr, ptr, sizeof(hdr));
+			const size_t hdr_nb = IPv4::hdr_len(&hdr);
+			lane.slow = hdr.version != 4 || hdr_nb < sizeof(hdr) || available < hdr_nb || IPv4::fragmented(&hdr);
+			pkt.ip_version = 4;
+			pkt.ip_protocol = hdr.protocol;
+			pkt.src.addr32[0] = hdr.saddr;
+			pkt.dst.addr32[0] = hdr.daddr;
+			pkt.protocols |= 1u << Protocol::L3_IPv4;
+			pkt.l3 = uint16_t(lane.offset);
+			lane.offset += hdr_nb;
+		} else {
+			IPv6::Header hdr;
+			if(available < sizeof(hdr)) {
+				lane.slow = true;
+				return;
+			}
+			memcpy(&hdr, ptr, sizeof(hdr));
+			lane.slow = hdr.version != 6 || IPv6::extension(hdr.next_header);
+			pkt.ip_version = 6;
+			pkt.ip_protocol = hdr.next_header;
+			pkt.src = hdr.src;
+			pkt.dst = hdr.dst;
+			pkt.protocols |= 1u << Protocol::L3_IPv6;
+			pkt.l3 = uint16_t(lane.offset);
+			lane.offset += sizeof(hdr);
+		}
+		pkt.payload = uint16_t(lane.offset);
+	}
+
+	static inline void lane_l4(Lane& lane, ParsedPacket& pkt) noexcept {
+		if(lane.slow) {
+			return;
+		}
+		const uint8_t* ptr = lane.data + lane.offset;
+		const size_t available = lane.size - lane.offset;
+		if(pkt.ip_protocol == IPv4::PROTO_TCP) {
+			Tcp::Header hdr;
+			if(available < sizeof(hdr)) {
+				lane.slow = true;
+				return;
+			}
+			memcpy(&hdr, ptr, sizeof(hdr));
+			const size_t hdr_nb = Tcp::hdr_len(&hdr);
+			if(hdr_nb < sizeof(hdr) || available < hdr_nb) {
+				lane.slow = true;
+				return;
+			}
+			layer4(pkt, lane.offset, hdr_nb, Protocol::L4_TCP);
+			pkt.src_port = hdr.src;
+			pkt.dst_port = hdr.dst;
+		} else if(pkt.ip_protocol == IPv4::PROTO_UDP) {
+			Udp::Header hdr;
+			if(available < sizeof(hdr)) {
+				lane.slow = true;
+				return;
+			}
+			memcpy(&hdr, ptr, sizeof(hdr));
+			layer4(pkt, lane.offset, sizeof(hdr), Protocol::L4_UDP);
+			pkt.src_port = hdr.source;
+			pkt.dst_port = hdr.dest;
+			lane.slow = hdr.dest == htons(Vxlan::PORT) || hdr.dest == htons(GtpU::PORT);
+		} else if(pkt.ip_protocol == IPv4::PROTO_GRE) {
+			lane.slow = true;
+		}
+	}
+
+	static inline uint16_t load16(const uint8_t* ptr) noexcept {
+		uint16_t value;
+		memcpy(&value, ptr, sizeof(value));
+		return ntohs(value);
+	}
+
+	/**
+	 * Skip the VLAN/QinQ tags and the MPLS stack from @offset, @ethertype becomes the L3 one.
+	 * @param vlans - the packet to keep the VLAN ids in, nullptr - for the inner Ethernet.
+	 * @return the offset of the L3, @ethertype is 0 if a header is truncated or the MPLS payload is unknown.
+	 */
+	static size_t layer2(const uint8_t* data, size_t size, size_t offset, uint16_t& ethertype, uint16_t& protocols,
+			ParsedPacket* vlans) noexcept {
+		while(ethertype == ETH_P_8021Q || ethertype == ETH_P_8021AD) {
+			if(size - offset < sizeof(Vlan::Header)) {
+				ethertype = 0;
+				return offset;
+			}
+			if(vlans) {
+				if(vlans->vlan_count < ParsedPacket::VLAN_MAX) {
+					vlans->vlan[vlans->vlan_count] = load16(data + offset) & 0x0FFF;
+				}
+				if(vlans->vlan_count < UINT8_MAX) {
+					vlans->vlan_count++;
+				}
+			}
+			protocols |= 1u << Protocol::L2_VLAN;
+			ethertype = load16(data + offset + offsetof(Vlan::Header, nextProto));
+			offset += sizeof(Vlan::Header);
+		}
+		if(ethertype != ETH_P_MPLS_UC) {
+			return offset;
+		}
+
+		ethertype = 0;
+		for(unsigned i = 0; i < MPLS_MAX && size - offset >= sizeof(Mpls::Header); i++) {
+			Mpls::Header hdr;
+			memcpy(&hdr, data + offset, sizeof(hdr));
+			protocols |= 1u << Protocol::L2_MPLS;
+			offset += sizeof(hdr);
+			if(Mpls::bottom(&hdr)) {
+				if(size > offset) {
+					ethertype = ip_ethertype(ip_by_version(data[offset]));
+				}
+				break;
+			}
+		}
+		return offset;
+	}
+
+	/**
+	 * Parse the IP header of @ethertype at @offset and the TCP/UDP/GRE header which follows it into @flow.
+	 * @return true - if an IP header has been found.
+	 */
+	static bool layer3(const uint8_t* data, size_t size, size_t offset, uint16_t ethertype, ParsedFlow& flow) noexcept {
+		uint8_t next = 0;
+		if(ethertype == ETH_P_IP) {
+			if(size - offset < sizeof(IPv4::Header)) {
+				return false;
+			}
+			IPv4::Header hdr;
+			memcpy(&hdr, data + offset, sizeof(hdr));
+			const size_t hdr_nb = IPv4::hdr_len(&hdr);
+			if(hdr.version != 4 || hdr_nb < sizeof(hdr) || size - offset < hdr_nb) {
+				return false;
+			}
+			flow.l3 = uint16_t(offset);
+			flow.protocols |= 1u << Protocol::L3_IPv4;
+			flow.ip_version = 4;
+			flow.ip_protocol = hdr.protocol;
+			flow.src.addr32[0] = hdr.saddr;
+			flow.dst.addr32[0] = hdr.daddr;
+			offset += hdr_nb;
+			flow.payload = uint16_t(offset);
+			if(IPv4::fragmented(&hdr)) {
+				flow.fragment = flow.l3;
+				return true;
+			}
+			next = hdr.protocol;
+		} else if(ethertype == ETH_P_IPV6) {
+			if(size - offset < sizeof(IPv6::Header)) {
+				return false;
+			}
+			IPv6::Header hdr;
+			memcpy(&hdr, data + offset, sizeof(hdr));
+			if(hdr.version != 6) {
+				return false;
+			}
+			flow.l3 = uint16_t(offset);
+			flow.protocols |= 1u << Protocol::L3_IPv6;
+			flow.ip_version = 6;
+			flow.ip_protocol = hdr.next_header;
+			flow.src = hdr.src;
+			flow.dst = hdr.dst;
+			offset += sizeof(hdr);
+			flow.payload = uint16_t(offset);
+			next = hdr.next_header;
+			if(IPv6::extension(next)) {
+				int fragment;
+				const int ext_nb = size > offset ? IPv6::walk_extensions(data + offset, size - offset, next, fragment) : -1;
+				if(ext_nb < 0) {
+					return true;
+				}
+				flow.ip_protocol = next;
+				if(fragment >= 0) {
+					IPv6::Fragment frag;
+					memcpy(&frag, data + offset + fragment, sizeof(frag));
+					if(IPv6::fragmented(&frag)) {
+						flow.fragment = uint16_t(offset + fragment);
+						flow.payload = uint16_t(offset + ext_nb);
+						return true;
+					}
+				}
+				offset += ext_nb;
+				flow.payload = uint16_t(offset);
+			}
+		} else {
+			return false;
+		}
+
+		switch(next) {
+			case IPv4::PROTO_TCP:
+				if(size - offset >= sizeof(Tcp::Header)) {
+					Tcp::Header hdr;
+					memcpy(&hdr, data + offset, sizeof(hdr));
+					const size_t hdr_nb = Tcp::hdr_len(&hdr);
+					if(hdr_nb >= sizeof(hdr) && size - offset >= hdr_nb) {
+						layer4(flow, offset, hdr_nb, Protocol::L4_TCP);
+						flow.src_port = hdr.src;
+						flow.dst_port = hdr.dst;
+					}
+				}
+				break;
+
+			case IPv4::PROTO_UDP:
+				if(size - offset >= sizeof(Udp::Header)) {
+					Udp::Header hdr;
+					memcpy(&hdr, data + offset, sizeof(hdr));
+					layer4(flow, offset, sizeof(hdr), Protocol::L4_UDP);
+					flow.src_port = hdr.source;
+					flow.dst_port = hdr.dest;
+				}
+				break;
+
+			case IPv4::PROTO_GRE:
+				if(size - offset >= sizeof(Gre::Header)) {
+					const size_t hdr_nb = Gre::hdr_len(reinterpret_cast<const Gre::Header*>(data + offset)); // packed
+					if(size - offset >= hdr_nb) {
+						layer4(flow, offset, hdr_nb, Protocol::L4_GRE);
+					}
+				}
+				break;
+
+			default:
+				break;
+		}
+		return true;
+	}
+
+	/**
+	 * Parse the tunnel header which follows the outer L4 and the packet inside it into ParsedPacket::inner.
+	 */
+	static void decapsulate(const uint8_t* data, size_t size, ParsedPacket& pkt) noexcept {
+		size_t offset = pkt.payload;
+		uint16_t ethertype = 0;
+		if(pkt.has(Protocol::L4_GRE)) {
+			const Gre::Header* hdr = reinterpret_cast<const Gre::Header*>(data + pkt.l4); // packed, no alignment
+			pkt.tunnel = Protocol::L4_GRE;
+			pkt.tunnel_id = Gre::key(hdr);
+			ethertype = ntohs(hdr->next_proto);
+		} else if(pkt.has(Protocol::L4_UDP) && pkt.dst_port == htons(Vxlan::PORT)) {
+			Vxlan::Header hdr;
+			if(size - offset < sizeof(hdr)) {
+				return;
+			}
+			memcpy(&hdr, data + offset, sizeof(hdr));
+			if(not (hdr.flags & Vxlan::FLAG_VNI)) {
+				return;
+			}
+			pkt.protocols |= 1u << Protocol::L5_VXLAN;
+			pkt.tunnel = Protocol::L5_VXLAN;
+			pkt.tunnel_id = Vxlan::vni(&hdr);
+			offset += sizeof(hdr);
+			ethertype = ETH_P_TEB;
+		} else if(pkt.has(Protocol::L4_UDP) && pkt.dst_port == htons(GtpU::PORT)) {
+			GtpU::Header hdr;
+			if(size - offset < sizeof(hdr)) {
+				return;
+			}
+			memcpy(&hdr, data + offset, sizeof(hdr));
+			const int hdr_nb = GtpU::hdr_len(data + offset, size - offset);
+			if((hdr.flags & 0xF0) != 0x30 || hdr_nb < 0 || hdr.type != GtpU::TYPE_GPDU) {
+				return;
+			}
+			pkt.protocols |= 1u << Protocol::L5_GTPU;
+			pkt.tunnel = Protocol::L5_GTPU;
+			pkt.tunnel_id = ntohl(hdr.teid);
+			offset += hdr_nb;
+			ethertype = size > offset ? ip_ethertype(ip_by_version(data[offset])) : 0;
+		} else {
+			return;
+		}
+		pkt.payload = uint16_t(offset);
+
+		ParsedFlow& inner = pkt.inner;
+		if(ethertype == ETH_P_TEB) {
+			if(size - offset < sizeof(Ethernet::Header)) {
+				return;
+			}
+			inner.protocols = 1u << Protocol::L2_ETHERNET;
+			ethertype = load16(data + offset + offsetof(Ethernet::Header, h_proto));
+			offset = layer2(data, size, offset + sizeof(Ethernet::Header), ethertype, inner.protocols, nullptr);
+		} else if(ethertype == ETH_P_MPLS_UC) {
+			offset = layer2(data, size, offset, ethertype, inner.protocols, nullptr);
+		}
+		inner.payload = uint16_t(offset);
+		layer3(data, size, offset, ethertype, inner);
+	}
+
+	static inline uint16_t ip_ethertype(Protocol protocol) noexcept {
+		return protocol == Protocol::L3_IPv4 ? ETH_P_IP : protocol == Protocol::L3_IPv6 ? ETH_P_IPV6 : 0;
+	}
+
+	static inline void layer4(ParsedFlow& flow, size_t offset, size_t hdr_nb, Protocol protocol) noexcept {
+		flow.l4 = uint16_t(offset);
+		flow.payload = uint16_t(offset + hdr_nb);
+		flow.protocols |= 1u << protocol;
+	}
+
+};
+
+}; // namespace proto
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "../proto.h"
+#include "../../utils/Metrics.h"
+
+namespace proto {
+
+/**
+ * The outcomes of the header checks of the parsers per protocol, they are shared by all the parsers
+ * and counted with METRICS_ENABLED only (see utils/Metrics.h).
+ * 'invalid' counts the headers which stop a stack, e.g. the truncated ones.
+ *
+ * Using sample:
+ * utils::MetricsWriter writer(stdout, "parser");
+ * proto::ParserMetrics::instance().write(writer);
+ */
+struct ParserMetrics {
+	static constexpr unsigned PROTOCOLS = unsigned(Protocol::L5_GTPU) + 1;
+
+	utils::Counter valid[PROTOCOLS];
+	utils::Counter invalid[PROTOCOLS];
+
+	static ParserMetrics& instance() noexcept {
+		static ParserMetrics metrics;
+		return metrics;
+	}
+
+	static inline void count(Protocol proto, bool result) noexcept {
+		if(utils::Metrics::ENABLED && unsigned(proto) < PROTOCOLS) {
+			ParserMetrics& metrics = instance();
+			(result ? metrics.valid : metrics.invalid)[proto].add();
+		}
+	}
+
+	static const char* name(Protocol proto) noexcept {
+		static const char* names[PROTOCOLS] = {
+			"ethernet", "vlan", "ipv4", "ipv6", "udp", "tcp", "gre", "mpls", "vxlan", "gtpu"
+		};
+		return unsigned(proto) < PROTOCOLS ? names[proto] : "end";
+	}
+
+	void write(utils::MetricsWriter& writer) const noexcept {
+		char label[32];
+		for(unsigned i = 0; i < PROTOCOLS; i++) {
+			snprintf(label, sizeof(label), "proto=\"%s\"", name(Protocol(i)));
+			writer.counter("headers_valid", valid[i], label);
+			writer.counter("headers_invalid", invalid[i], label);
+		}
+	}
+};
+
+}; // namespace proto
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <cstdlib>
+
+#include "../proto.h"
+#include "ParserMetrics.h"
+#include "../mframe/MFrame.h"
+#include "../mframe/SafeMFrame.h"
+
+#include "../procotols/Ethernet.h"
+#include "../procotols/Vlan.h"
+#include "../procotols/IPv4.h"
+#include "../procotols/IPv6.h"
+#include "../procotols/Tcp.h"
+#include "../procotols/Udp.h"
+#include "../procotols/Gre.h"
+#include "../procotols/Mpls.h"
+#include "../procotols/Vxlan.h"
+#include "../procotols/GtpU.h"
+
+namespace proto {
+
+/**
+ * The compile-time list of the protocol classes of BasicStaticHeaderParser.
+ * advance() and validate_header() compare the protocol with PROTOCOL of every class of the list,
+ * the calls are resolved at compile time and inlined.
+ */
+template <typename... Protocols>
+struct ProtocolStack;
+
+/**
+ * P::next() and the check of the next header of Stack on an unchecked view of the frame, see SafeMFrame::with_span().
+ */
+template <typename Stack, typename P>
+struct ProtocolStep {
+	Protocol& next;
+
+	template <typename View>
+	inline void operator()(View& view) const noexcept {
+		const Protocol proto = P::next(view);
+		next = Stack::validate_header(proto, view) ? proto : Protocol::END;
+	}
+};
+
+template <>
+struct ProtocolStack<> {
+
+	template <typename Stack, typename MFrame>
+	static inline Protocol advance(Protocol, MFrame&) noexcept {
+		return Protocol::END;
+	}
+
+	template <typename MFrame>
+	static inline bool validate_header(Protocol, const MFrame&) noexcept {
+		return false;
+	}
+};
+
+template <typename P, typename... Protocols>
+struct ProtocolStack<P, Protocols...> {
+
+	/**
+	 * Skip the header of @proto and validate the next one against the whole @Stack,
+	 * the protocol returned by P::next() is known after inlining, so its validation is folded in.
+	 */
+	template <typename Stack, typename MFrame>
+	static inline Protocol advance(Protocol proto, MFrame& frame) noexcept {
+		if(proto == P::PROTOCOL) {
+			// the header has been checked by validate_header(), so it is skipped and the next one is checked
+			// with a single check of SafeMFrame
+			Protocol next = Protocol::END;
+			frame.with_span(frame.available(), ProtocolStep<Stack, P>{next});
+			return next;
+		}
+		return ProtocolStack<Protocols...>::template advance<Stack>(proto, frame);
+	}
+
+	template <typename MFrame>
+	static inline bool validate_header(Protocol proto, const MFrame& frame) noexcept {
+		if(proto == P::PROTOCOL) {
+			const bool result = P::validate_header(frame);
+			ParserMetrics::count(proto, result);
+			return result;
+		}
+		return ProtocolStack<Protocols...>::validate_header(proto, frame);
+	}
+};
+
+/**
+ * BasicStaticHeaderParser is BasicHeaderParser for the protocols listed at compile time,
+ * e.g. StaticHeaderParser<Ethernet, Vlan, IPv4, Udp>. The stack starts with the first protocol of the list,
+ * a protocol which is not in the list is END, so the packets of the other protocols stop there.
+ * The branches of the unlisted protocols are not compiled, the interface is the same as of BasicHeaderParser.
+ */
+template <typename MFrame, typename First, typename... Protocols>
+class BasicStaticHeaderParser {
+	using Stack = ProtocolStack<First, Protocols...>;
+
+protected:
+	MFrame m_frame;
+	Protocol proto;
+	unsigned m_depth;
+
+public:
+
+	template <typename Ptr>
+	BasicStaticHeaderParser(const Ptr* buffer, size_t size_bytes, Protocol proto_first = First::PROTOCOL) noexcept :
+		m_frame(buffer, size_bytes), proto(validate_header(proto_first)), m_depth(0) {}
+
+	/**
+	 * Return a current protocol in the stack.
+	 * @return current protocol
+	 */
+	inline Protocol protocol() const noexcept {
+		return proto;
+	}
+
+	/**
+	 * @return amount of the tunnels the current protocol is encapsulated into, see BasicHeaderParser::depth().
+	 */
+	inline unsigned depth() const noexcept {
+		return m_depth;
+	}
+
+	/**
+	 * Step to the next protocol in the stack.
+	 * @return - the next protocol.
+	 */
+	inline Protocol next() noexcept {
+		m_depth += tunnel(proto);
+		proto = Stack::template advance<Stack>(proto, m_frame);
+		return proto;
+	}
+
+	template <typename Hdr>
+	inline void assign(const Hdr*& hdr) noexcept {
+		m_frame.assign_stay(hdr);
+	}
+
+private:
+
+	inline Protocol validate_header(Protocol new_proto) noexcept {
+		return Stack::validate_header(new_proto, m_frame) ? new_proto : Protocol::END;
+	}
+
+};
+
+template <typename... Protocols>
+using StaticHeaderParser = BasicStaticHeaderParser<RoMFrame, Protocols...>;
+
+template <typename... Protocols>
+using SafeStaticHeaderParser = BasicStaticHeaderParser<RoSafeMFrame, Protocols...>;
+
+}; // namespace proto
@@ -2,14 +2,18 @@
 
 #include <linux/if_ether.h>
 #include <arpa/inet.h>
+#include <cstring>
 
 #include "../proto.h"
+#include "../../utils/ByteOrder.h"
 
 namespace proto {
 
 class Ethernet {
 public:
 
+	static constexpr Protocol PROTOCOL = Protocol::L2_ETHERNET;
+
 	using Header = ethhdr;
 
 	/**
@@ -46,7 +50,7 @@ public:
 		pkt.assign(hdr);
 		Protocol result = Protocol::END;
 
-		switch(ntohs(hdr->h_proto)) {
+		switch(utils::ByteOrder::load_be16(&hdr->h_proto)) {
 			case ETH_P_IP:
 				result = Protocol::L3_IPv4;
 				break;
@@ -54,8 +58,12 @@ public:
 				result = Protocol::L3_IPv6;
 				break;
 			case ETH_P_8021Q:
+			case ETH_P_8021AD: // QinQ, the service tag has the VLAN header
 				result = Protocol::L2_VLAN;
 				break;
+			case ETH_P_MPLS_UC:
+				result = Protocol::L2_MPLS;
+				break;
 			default:
 				break;
 		}
@@ -73,6 +81,38 @@ public:
 		return pkt.available() - sizeof(Header);
 	}
 
+	// encapsulation, the head of the frame is at the outermost header and the headers are prepended
+	// to the headroom (the offset of the frame), so just the header is copied
+
+	/**
+	 * Prepend a copy of @hdr, e.g. after IPv4::encap().
+	 * @return the new header, nullptr - if the headroom is too short.
+	 */
+	template <typename MFrame>
+	static inline Header* encap(MFrame& pkt, const Header& hdr) noexcept {
+		if(pkt.offset() < sizeof(Header)) {
+			return nullptr;
+		}
+		pkt.head_move_back(sizeof(Header));
+		Header* result;
+		pkt.assign_stay(result);
+		memcpy(result, &hdr, sizeof(Header));
+		return result;
+	}
+
+	/**
+	 * Skip the header, there is no copy.
+	 * @return false - if the header is not available.
+	 */
+	template <typename MFrame>
+	static inline bool decap(MFrame& pkt) noexcept {
+		if(not pkt.available(sizeof(Header))) {
+			return false;
+		}
+		pkt.head_move(sizeof(Header));
+		return true;
+	}
+
 };
 
 }; // namespace proto
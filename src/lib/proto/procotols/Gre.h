@@ -1,9 +1,12 @@
 #pragma once
 
 #include "../proto.h"
+#include "../../utils/ByteOrder.h"
 
 #include <arpa/inet.h>
+#include <linux/if_ether.h>
 #include <cstdint>
+#include <cstring>
 
 namespace proto {
 
@@ -12,6 +15,8 @@ namespace proto {
 class Gre {
 public:
 
+	static constexpr Protocol PROTOCOL = Protocol::L4_GRE;
+
 	struct Header {
 
 		union {
@@ -31,6 +36,12 @@ public:
 
 	} __attribute__ ((__packed__));
 
+	static constexpr uint16_t FLAG_CHECKSUM = 0x8000;
+	static constexpr uint16_t FLAG_ROUTING = 0x4000;
+	static constexpr uint16_t FLAG_KEY = 0x2000;
+	static constexpr uint16_t FLAG_SEQ = 0x1000;
+	static constexpr uint16_t FLAG_VERSION = 0x0007;
+
 	template <typename MFrame>
 	static inline bool validate_packet(const MFrame& pkt) noexcept {
 		if(pkt.available(sizeof(Header))) {
@@ -50,13 +61,24 @@ public:
 	template <typename MFrame>
 	inline static Protocol next(MFrame& pkt) noexcept {
 		const Header* hdr;
-		pkt.assign(hdr);
+		pkt.assign_stay(hdr);
+		const uint16_t next_proto = utils::ByteOrder::load_be16(&hdr->next_proto);
+		pkt.head_move(length_header(pkt));
 		Protocol result = Protocol::END;
 
-		switch(ntohs(hdr->next_proto)) {
-			case 0x6558: // Transparent Ethernet Bridging
+		switch(next_proto) {
+			case ETH_P_TEB: // Transparent Ethernet Bridging
 				result = Protocol::L2_ETHERNET;
 				break;
+			case ETH_P_IP:
+				result = Protocol::L3_IPv4;
+				break;
+			case ETH_P_IPV6:
+				result = Protocol::L3_IPv6;
+				break;
+			case ETH_P_MPLS_UC:
+				result = Protocol::L2_MPLS;
+				break;
 			default:
 				break;
 		}
@@ -64,31 +86,80 @@ public:
 		return result;
 	}
 
+	/**
+	 * The flags are tested in the network byte order, the bit fields of Header::flag_bits are of the host one.
+	 */
 	template <typename MFrame>
 	static unsigned length_header(const MFrame& pkt) noexcept {
 		const Header* hdr;
 		pkt.assign_stay(hdr);
-		size_t hdr_size = 0;
-		if(hdr->flag_bits.version == 0) {
-			if(hdr->flag_bits.bit_checksum) {
-				hdr_size <<= 5;
-			}
-			if(hdr->flag_bits.bit_key) {
-				hdr_size <<= 5;
-			}
-			if(hdr->flag_bits.bit_seq_num) {
-				hdr_size <<= 5;
-			}
-			return sizeof(Header) + hdr_size;
+		return hdr_len(hdr);
+	}
+
+	static inline unsigned hdr_len(const Header* hdr) noexcept {
+		const uint16_t flags = utils::ByteOrder::load_be16(&hdr->flags);
+		if((flags & FLAG_VERSION) == 0) {
+			return sizeof(Header)
+				+ ((flags & (FLAG_CHECKSUM | FLAG_ROUTING)) ? 4 : 0)
+				+ ((flags & FLAG_KEY) ? 4 : 0)
+				+ ((flags & FLAG_SEQ) ? 4 : 0);
 		}
 		return sizeof(Header);
 	}
 
+	/**
+	 * @return the key in the host byte order, 0 - if there is no key, the header must be available.
+	 */
+	static inline uint32_t key(const Header* hdr) noexcept {
+		const uint16_t flags = utils::ByteOrder::load_be16(&hdr->flags);
+		if((flags & FLAG_VERSION) || not (flags & FLAG_KEY)) {
+			return 0;
+		}
+		return utils::ByteOrder::load_be32(reinterpret_cast<const uint8_t*>(hdr) + sizeof(Header)
+			+ ((flags & (FLAG_CHECKSUM | FLAG_ROUTING)) ? 4 : 0));
+	}
+
 	template <typename MFrame>
 	static inline unsigned length_payload(const MFrame& pkt) noexcept {
 		return pkt.available() - length_header(pkt);
 	}
 
+	/**
+	 * Prepend a header of version 0 to the payload at the head, see Ethernet::encap().
+	 * @param next_proto - the EtherType of the payload, e.g. ETH_P_IP or ETH_P_TEB, in the host byte order.
+	 * @param key - the key in the host byte order, the header has a key if @with_key is set.
+	 * @return the new header, nullptr - if the headroom is too short.
+	 */
+	template <typename MFrame>
+	static inline Header* encap(MFrame& pkt, uint16_t next_proto, uint32_t key = 0, bool with_key = false) noexcept {
+		const size_t header_nb = sizeof(Header) + (with_key ? sizeof(key) : 0);
+		if(pkt.offset() < header_nb) {
+			return nullptr;
+		}
+		pkt.head_move_back(header_nb);
+		Header* hdr;
+		pkt.assign_stay(hdr);
+		hdr->flags = with_key ? utils::ByteOrder::cpu_to_be16(FLAG_KEY) : 0;
+		utils::ByteOrder::store_be16(&hdr->next_proto, next_proto);
+		if(with_key) {
+			utils::ByteOrder::store_be32(hdr + 1, key);
+		}
+		return hdr;
+	}
+
+	/**
+	 * Skip the header with its options, there is no copy.
+	 * @return false - if the header is not available.
+	 */
+	template <typename MFrame>
+	static inline bool decap(MFrame& pkt) noexcept {
+		if(not validate_header(pkt)) {
+			return false;
+		}
+		pkt.head_move(length_header(pkt));
+		return true;
+	}
+
 };
 
 }; // namespace proto
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <arpa/inet.h>
+#include <cstdint>
+
+#include "../proto.h"
+#include "../../utils/ByteOrder.h"
+
+namespace proto {
+
+// see Ethernet.h for more details
+
+/**
+ * GTP-U v1 (3GPP TS 29.281) over UDP. The payload of a G-PDU is an IP packet, the other messages are END.
+ */
+class GtpU {
+public:
+
+	static constexpr Protocol PROTOCOL = Protocol::L5_GTPU;
+	static constexpr uint16_t PORT = 2152; // the UDP destination port
+	static constexpr uint8_t TYPE_GPDU = 255;
+	static constexpr uint8_t FLAG_E = 0x04; // an extension header follows
+	static constexpr uint8_t FLAG_S = 0x02; // the sequence number is valid
+	static constexpr uint8_t FLAG_PN = 0x01; // the N-PDU number is valid
+	static constexpr unsigned EXT_MAX = 4; // the extension headers walked, a longer chain is not parsed
+
+	struct Header {
+		uint8_t flags; // version : 3, PT : 1, reserved : 1, E : 1, S : 1, PN : 1
+		uint8_t type;
+		uint16_t length; // of the payload past the mandatory header
+		uint32_t teid;
+	} __attribute__ ((__packed__));
+
+	/**
+	 * The optional fields follow the mandatory header if any of E, S, PN is set.
+	 */
+	struct Optional {
+		uint16_t seq;
+		uint8_t npdu;
+		uint8_t next_ext; // the type of the next extension header, 0 - none
+	} __attribute__ ((__packed__));
+
+	/**
+	 * @param data - the GTP-U header, @available bytes are from it
+	 * @return the length of the header with the optional fields and the extension headers,
+	 * -1 - if they are truncated or are too many.
+	 * It is not inlined, so the walk doesn't bloat the next() switch of the parsers,
+	 * next() takes the header with no optional fields by itself.
+	 */
+	__attribute__ ((noinline)) static int hdr_len(const uint8_t* data, size_t available) noexcept {
+		if(available < sizeof(Header)) {
+			return -1;
+		}
+		if((data[0] & (FLAG_E | FLAG_S | FLAG_PN)) == 0) {
+			return sizeof(Header);
+		}
+		size_t length = sizeof(Header) + sizeof(Optional);
+		if(available < length) {
+			return -1;
+		}
+		uint8_t next_ext = (data[0] & FLAG_E) ? data[length - 1] : 0;
+		for(unsigned i = 0; i < EXT_MAX && next_ext; i++) {
+			// the length of an extension header is in 4 bytes units, its last byte is the next type
+			if(available - length < 4 || data[length] == 0 || available - length < size_t(data[length]) * 4) {
+				return -1;
+			}
+			length += size_t(data[length]) * 4;
+			next_ext = data[length - 1];
+		}
+		return next_ext ? -1 : int(length);
+	}
+
+	template <typename MFrame>
+	static inline bool validate_packet(const MFrame& pkt) noexcept {
+		return validate_header(pkt);
+	}
+
+	template <typename MFrame>
+	static inline bool validate_header(const MFrame& pkt) noexcept {
+		if(pkt.available(sizeof(Header))) {
+			const Header* hdr;
+			pkt.assign_stay(hdr);
+			return (hdr->flags & 0xF0) == 0x30; // version 1, PT 1
+		}
+		return false;
+	}
+
+	template <typename MFrame>
+	inline static Protocol next(MFrame& pkt) noexcept {
+		const uint8_t* data;
+		pkt.assign_stay(data);
+		const int hdr_nb = (data[0] & (FLAG_E | FLAG_S | FLAG_PN)) ? hdr_len(data, pkt.available()) : int(sizeof(Header));
+		if(hdr_nb < 0 || data[1] != TYPE_GPDU) {
+			return Protocol::END;
+		}
+		pkt.head_move(hdr_nb);
+		if(not pkt.available(sizeof(uint8_t))) {
+			return Protocol::END;
+		}
+		const uint8_t* first;
+		pkt.assign_stay(first);
+		return ip_by_version(*first);
+	}
+
+	template <typename MFrame>
+	static inline unsigned length_payload(const MFrame& pkt) noexcept {
+		const Header* hdr;
+		pkt.assign_stay(hdr);
+		return utils::ByteOrder::load_be16(&hdr->length);
+	}
+
+};
+
+}; // namespace proto
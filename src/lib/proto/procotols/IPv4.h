@@ -1,10 +1,15 @@
 #pragma once
 
+#include <cstdint>
 #include <cstdlib>
 #include <netinet/ip.h>
 #include <cstring>
 
 #include "../proto.h"
+#include "../../utils/ByteOrder.h"
+#include "../Checksum.h"
+#include "Tcp.h"
+#include "Udp.h"
 
 namespace proto {
 
@@ -13,6 +18,8 @@ namespace proto {
 class IPv4 {
 public:
 
+	static constexpr Protocol PROTOCOL = Protocol::L3_IPv4;
+
 	using Header = iphdr;
 	using Addr = uint32_t;
 	struct Net {
@@ -57,7 +64,7 @@ public:
 		if(pkt.available(sizeof(Header))) {
 			const Header* hdr;
 			pkt.assign_stay(hdr);
-			return hdr->version == 4/*IP_V4*/;
+			return hdr->version == 4/*IP_V4*/ && hdr_len(hdr) >= sizeof(Header) && pkt.available(hdr_len(hdr));
 		}
 		return false;
 	}
@@ -107,7 +114,7 @@ public:
 	// header manipulation
 
 	static inline uint16_t pkt_len(const Header* hdr) noexcept {
-		return ntohs(hdr->tot_len);
+		return utils::ByteOrder::load_be16(&hdr->tot_len);
 	}
 
 	static inline uint16_t hdr_len(const Header* hdr) noexcept {
@@ -115,66 +122,66 @@ public:
 	}
 
 	static inline uint16_t payload_len(const Header* hdr) noexcept {
-		return ntohs(hdr->tot_len) - uint16_t(hdr->ihl << 2u);
+		return utils::ByteOrder::load_be16(&hdr->tot_len) - uint16_t(hdr->ihl << 2u);
 	}
 
 	static inline bool fragmented(const Header* hdr) noexcept {
-		return (ntohs(hdr->frag_off) & FRAG_MASK) > 0;
+		return (utils::ByteOrder::load_be16(&hdr->frag_off) & FRAG_MASK) > 0;
 	}
 
 	static inline uint16_t offset(const Header* hdr) noexcept {
-		return (uint16_t(ntohs(hdr->frag_off) & uint16_t(IP_OFFMASK)) << 3u);
+		return (uint16_t(utils::ByteOrder::load_be16(&hdr->frag_off) & uint16_t(IP_OFFMASK)) << 3u);
 	}
 
 	// bit 0: Evil Bit. see rfc-3514
 	inline static bool flag_rf(const Header* hdr) noexcept {
-		return (ntohs(hdr->frag_off) & uint16_t(IP_RF)) > 0u;
+		return (utils::ByteOrder::load_be16(&hdr->frag_off) & uint16_t(IP_RF)) > 0u;
 	}
 
 	inline static void flag_rf_set(Header* hdr) noexcept {
-		uint16_t frag = ntohs(hdr->frag_off);
+		uint16_t frag = utils::ByteOrder::load_be16(&hdr->frag_off);
 		frag |= IP_RF;
-		hdr->frag_off = htons(frag);
+		frag_off_set(hdr, utils::ByteOrder::cpu_to_be16(frag));
 	}
 
 	inline static void flag_rf_rst(Header* hdr) noexcept {
-		uint16_t frag = ntohs(hdr->frag_off);
+		uint16_t frag = utils::ByteOrder::load_be16(&hdr->frag_off);
 		frag &= FLAG_MASK_RF;
-		hdr->frag_off = htons(frag);
+		frag_off_set(hdr, utils::ByteOrder::cpu_to_be16(frag));
 	}
 
 	// bit 1: Don't Fragment (DF)
 	inline static bool flag_df(const Header* hdr) noexcept {
-		return (ntohs(hdr->frag_off) & uint16_t(IP_DF)) > 0u;
+		return (utils::ByteOrder::load_be16(&hdr->frag_off) & uint16_t(IP_DF)) > 0u;
 	}
 
 	inline static void flag_df_set(Header* hdr) noexcept {
-		uint16_t frag = ntohs(hdr->frag_off);
+		uint16_t frag = utils::ByteOrder::load_be16(&hdr->frag_off);
 		frag |= IP_DF;
-		hdr->frag_off = htons(frag);
+		frag_off_set(hdr, utils::ByteOrder::cpu_to_be16(frag));
 	}
 
 	inline static void flag_df_rst(Header* hdr) noexcept {
-		uint16_t frag = ntohs(hdr->frag_off);
+		uint16_t frag = utils::ByteOrder::load_be16(&hdr->frag_off);
 		frag &= FLAG_MASK_DF;
-		hdr->frag_off = htons(frag);
+		frag_off_set(hdr, utils::ByteOrder::cpu_to_be16(frag));
 	}
 
 	// bit 2: More Fragments (MF)
 	inline static bool flag_mf(const Header* hdr) noexcept {
-		return (ntohs(hdr->frag_off) & uint16_t(IP_MF)) > 0u;
+		return (utils::ByteOrder::load_be16(&hdr->frag_off) & uint16_t(IP_MF)) > 0u;
 	}
 
 	inline static void flag_mf_set(Header* hdr) noexcept {
-		uint16_t frag = ntohs(hdr->frag_off);
+		uint16_t frag = utils::ByteOrder::load_be16(&hdr->frag_off);
 		frag |= IP_MF;
-		hdr->frag_off = htons(frag);
+		frag_off_set(hdr, utils::ByteOrder::cpu_to_be16(frag));
 	}
 
 	inline static void flag_mf_rst(Header* hdr) noexcept {
-		uint16_t frag = ntohs(hdr->frag_off);
+		uint16_t frag = utils::ByteOrder::load_be16(&hdr->frag_off);
 		frag &= FLAG_MASK_MF;
-		hdr->frag_off = htons(frag);
+		frag_off_set(hdr, utils::ByteOrder::cpu_to_be16(frag));
 	}
 
 	static IPv4::Addr addr_host(unsigned b0, unsigned b1, unsigned b2, unsigned b3) noexcept {
@@ -190,48 +197,153 @@ public:
 	}
 
 	inline static IPv4::Addr addr_net(unsigned b0, unsigned b1, unsigned b2, unsigned b3) noexcept {
-		return htonl(addr_host(b0, b1, b2, b3));
+		return utils::ByteOrder::cpu_to_be32(addr_host(b0, b1, b2, b3));
 	}
 
+	/**
+	 * Set the header checksum, the other setters update it incrementally.
+	 * @return the checksum in the host byte order.
+	 */
 	static inline uint16_t update_checksum(Header* hdr) noexcept {
-		const auto len_header = u_int16_t(hdr->ihl << 2u);
 		hdr->check = 0;
-		const auto check_summ = calc_checksum(hdr, len_header);
-		hdr->check = htons(check_summ);
-		return check_summ;
+		hdr->check = Checksum::compute(hdr, hdr_len(hdr));
+		return utils::ByteOrder::load_be16(&hdr->check);
 	}
 
-private:
+	static inline bool verify_checksum(const Header* hdr) noexcept {
+		return Checksum::compute(hdr, hdr_len(hdr)) == 0;
+	}
 
-	static uint16_t calc_checksum(const void* vdata, size_t length) noexcept {
-		// Cast the data pointer to one that can be indexed.
-		auto data = (const char*) vdata;
+	// @value is in the network byte order
+	static inline void frag_off_set(Header* hdr, uint16_t value) noexcept {
+		hdr->check = Checksum::update16(hdr->check, hdr->frag_off, value);
+		hdr->frag_off = value;
+	}
 
-		// Initialise the accumulator.
-		uint32_t acc = 0xffff;
+	/**
+	 * Set the source address, the header checksum and the TCP/UDP checksum (which covers the address by
+	 * the pseudo header) are updated incrementally. The TCP/UDP header of the first fragment is updated too.
+	 */
+	static inline void addr_src_set(Header* hdr, Addr addr) noexcept {
+		update_pseudo(hdr, hdr->saddr, addr);
+		hdr->check = Checksum::update32(hdr->check, hdr->saddr, addr);
+		hdr->saddr = addr;
+	}
 
-		// Handle complete 16-bit blocks.
-		for(size_t i = 0; i + 1 < length; i += 2) {
-			uint16_t word;
-			memcpy(&word, data + i, 2);
-			acc += ntohs(word);
-			if(acc > 0xffff) {
-				acc -= 0xffff;
-			}
+	static inline void addr_dst_set(Header* hdr, Addr addr) noexcept {
+		update_pseudo(hdr, hdr->daddr, addr);
+		hdr->check = Checksum::update32(hdr->check, hdr->daddr, addr);
+		hdr->daddr = addr;
+	}
+
+	/**
+	 * @return the sum of the TCP/UDP pseudo header, see Checksum::partial().
+	 */
+	static inline uint32_t pseudo_sum(const Header* hdr) noexcept {
+		const uint16_t tail[2] = {utils::ByteOrder::cpu_to_be16(hdr->protocol), utils::ByteOrder::cpu_to_be16(payload_len(hdr))};
+		return Checksum::partial(tail, sizeof(tail), Checksum::partial(&hdr->saddr, 2 * sizeof(Addr)));
+	}
+
+	/**
+	 * Set the TCP or UDP checksum of the datagram, the whole datagram (see validate_packet()) must follow
+	 * the header, e.g. in RwMFrame.
+	 * @return false - if the datagram is neither TCP nor UDP or it is a fragment.
+	 */
+	static bool update_l4_checksum(Header* hdr) noexcept {
+		if(fragmented(hdr)) {
+			return false;
+		}
+		uint8_t* l4 = reinterpret_cast<uint8_t*>(hdr) + hdr_len(hdr);
+		switch(hdr->protocol) {
+			case PROTO_TCP:
+				Tcp::update_checksum(reinterpret_cast<Tcp::Header*>(l4), payload_len(hdr), pseudo_sum(hdr));
+				return true;
+			case PROTO_UDP:
+				Udp::update_checksum(reinterpret_cast<Udp::Header*>(l4), payload_len(hdr), pseudo_sum(hdr));
+				return true;
+			default:
+				return false;
 		}
+	}
 
-		// Handle any partial block at the end of the data.
-		if(length & 1) {
-			uint16_t word = 0;
-			memcpy(&word, data + length - 1, 1);
-			acc += ntohs(word);
-			if(acc > 0xffff) {
-				acc -= 0xffff;
-			}
+	/**
+	 * @return false - if the TCP or UDP checksum of the datagram is wrong, true - for the other datagrams.
+	 */
+	static bool verify_l4_checksum(const Header* hdr) noexcept {
+		if(fragmented(hdr)) {
+			return true;
 		}
+		const uint8_t* l4 = reinterpret_cast<const uint8_t*>(hdr) + hdr_len(hdr);
+		switch(hdr->protocol) {
+			case PROTO_TCP:
+				return Tcp::verify_checksum(reinterpret_cast<const Tcp::Header*>(l4), payload_len(hdr), pseudo_sum(hdr));
+			case PROTO_UDP:
+				return Udp::verify_checksum(reinterpret_cast<const Udp::Header*>(l4), payload_len(hdr), pseudo_sum(hdr));
+			default:
+				return true;
+		}
+	}
+
+	/**
+	 * Set the total length, the header checksum is updated incrementally.
+	 * @param length - the length in the host byte order.
+	 */
+	static inline void pkt_len_set(Header* hdr, uint16_t length) noexcept {
+		const uint16_t value = utils::ByteOrder::cpu_to_be16(length);
+		hdr->check = Checksum::update16(hdr->check, hdr->tot_len, value);
+		hdr->tot_len = value;
+	}
+
+	/**
+	 * Prepend a copy of the outer header @outer to the datagram at the head (see Ethernet::encap()), its total
+	 * length is set to cover all the available bytes. The checksum of @outer must be set (update_checksum()),
+	 * as for a template of a tunnel which is built once, it is updated for the length incrementally.
+	 * @return the new header, nullptr - if the headroom is too short or the datagram is too long.
+	 */
+	template <typename MFrame>
+	static inline Header* encap(MFrame& pkt, const Header& outer) noexcept {
+		const size_t header_nb = hdr_len(&outer);
+		if(pkt.offset() < header_nb || header_nb + pkt.available() > UINT16_MAX) {
+			return nullptr;
+		}
+		pkt.head_move_back(header_nb);
+		Header* hdr;
+		pkt.assign_stay(hdr);
+		memcpy(hdr, &outer, header_nb);
+		pkt_len_set(hdr, uint16_t(pkt.available()));
+		return hdr;
+	}
 
-		// Return the checksum in addr byte order.
-		return uint16_t(~acc);
+	/**
+	 * Skip the outer header with its options, there is no copy.
+	 * @return false - if the header is not valid.
+	 */
+	template <typename MFrame>
+	static inline bool decap(MFrame& pkt) noexcept {
+		if(not validate_header(pkt)) {
+			return false;
+		}
+		pkt.head_move(length_header(pkt));
+		return true;
+	}
+
+private:
+
+	static inline void update_pseudo(Header* hdr, uint32_t old_value, uint32_t new_value) noexcept {
+		if(offset(hdr) != 0) {
+			return;
+		}
+		uint8_t* l4 = reinterpret_cast<uint8_t*>(hdr) + hdr_len(hdr);
+		switch(hdr->protocol) {
+			case PROTO_TCP:
+				Tcp::update_pseudo(reinterpret_cast<Tcp::Header*>(l4), old_value, new_value);
+				break;
+			case PROTO_UDP:
+				Udp::update_pseudo(reinterpret_cast<Udp::Header*>(l4), old_value, new_value);
+				break;
+			default:
+				break;
+		}
 	}
 
 };
@@ -4,6 +4,10 @@
 #include <cstring>
 
 #include "../proto.h"
+#include "../../utils/ByteOrder.h"
+#include "../Checksum.h"
+#include "Tcp.h"
+#include "Udp.h"
 
 namespace proto {
 
@@ -12,6 +16,8 @@ namespace proto {
 class IPv6 {
 public:
 
+	static constexpr Protocol PROTOCOL = Protocol::L3_IPv6;
+
 	struct Addr {
 		union {
 			uint8_t addr8[16];
@@ -59,19 +65,88 @@ public:
 
 	} __attribute__ ((__packed__));
 
+	struct Fragment {
+		uint8_t next_header;
+		uint8_t reserved;
+		uint16_t offset_flags; // the offset of 8 bytes units << 3 | M
+		uint32_t id;
+	} __attribute__ ((__packed__));
+
 
 	static constexpr uint8_t PROTO_TCP = 6;
 	static constexpr uint8_t PROTO_UDP = 17;
 	static constexpr uint8_t PROTO_GRE = 47;
 	static constexpr uint8_t PROTO_SCTP = 132;
 
+	static constexpr uint8_t EXT_HOP_BY_HOP = 0;
+	static constexpr uint8_t EXT_ROUTING = 43;
+	static constexpr uint8_t EXT_FRAGMENT = 44;
+	static constexpr uint8_t EXT_AUTH = 51;
+	static constexpr uint8_t EXT_DST_OPTIONS = 60;
+	static constexpr unsigned EXT_MAX = 8; // the extension headers walked, a longer chain is not parsed
+	static constexpr uint64_t EXT_MASK = (1ull << EXT_HOP_BY_HOP) | (1ull << EXT_ROUTING)
+		| (1ull << EXT_FRAGMENT) | (1ull << EXT_AUTH) | (1ull << EXT_DST_OPTIONS);
+
+	/**
+	 * @return true - if @next_header is an extension header which walk_extensions() skips.
+	 */
+	static inline constexpr bool extension(uint8_t next_header) noexcept {
+		return next_header < 64 && ((EXT_MASK >> next_header) & 1);
+	}
+
+	/**
+	 * @return true - if the fragment is not atomic (RFC 6946), i.e. the offset or M is set.
+	 */
+	static inline bool fragmented(const Fragment* frag) noexcept {
+		return frag->offset_flags & utils::ByteOrder::cpu_to_be16(0xFFF9);
+	}
+
+	/**
+	 * @return the length of the extension header @ext of the @type, the header has 2 bytes at least.
+	 */
+	static inline size_t extension_length(const uint8_t* ext, uint8_t type) noexcept {
+		return type == EXT_FRAGMENT ? sizeof(Fragment)
+			: type == EXT_AUTH ? (size_t(ext[1]) + 2) * 4 : (size_t(ext[1]) + 1) * 8;
+	}
+
+	/**
+	 * Skip the extension headers which follow the fixed header, EXT_MAX at most.
+	 * The walk stops past a fragment header which is not atomic, the rest is a data of the fragment.
+	 * @param data - the first extension header, @available bytes of the packet are from it.
+	 * @param next - the next header of the fixed header, it becomes the upper layer protocol.
+	 * @param fragment - the offset of the fragment header from @data, -1 - if there is no one.
+	 * @return the length of the extension headers, -1 - if they are truncated or are too many.
+	 */
+	static int walk_extensions(const uint8_t* data, size_t available, uint8_t& next, int& fragment) noexcept {
+		size_t offset = 0;
+		fragment = -1;
+		for(unsigned i = 0; i < EXT_MAX && extension(next); i++) {
+			if(available - offset < sizeof(Fragment)) {
+				return -1;
+			}
+			const uint8_t* ext = data + offset;
+			const size_t length = extension_length(ext, next);
+			if(available - offset < length) {
+				return -1;
+			}
+			const bool last = next == EXT_FRAGMENT && fragmented(reinterpret_cast<const Fragment*>(ext));
+			fragment = next == EXT_FRAGMENT ? int(offset) : fragment;
+			next = ext[0];
+			offset += length;
+			if(last) {
+				return int(offset);
+			}
+		}
+		return extension(next) ? -1 : int(offset);
+	}
+
 	template<typename MFrame>
 	static inline bool validate_packet(MFrame& frame) noexcept {
 		const unsigned available = frame.available();
 		if(available >= sizeof(Header)) {
 			const Header* hdr;
 			frame.assign_stay(hdr);
-			const auto pkt_size = ntohs(hdr->payload_len) + sizeof(Header);
+			const auto pkt_size = utils::ByteOrder::load_be16(&hdr->payload_len) + sizeof(Header);
 			if(hdr->version == 6/*IP_V4*/ && available >= pkt_size) {
 
 				// adjust padding if necessary
@@ -92,13 +167,34 @@ public:
 		return false;
 	}
 
+	/**
+	 * The extension headers are skipped by walk_extensions(), a fragment which is not atomic is END as
+	 * a fragmented IPv4 packet is. The fixed header followed by the upper layer takes a single check.
+	 */
 	template<typename MFrame>
 	inline static Protocol next(MFrame& pkt) noexcept {
 		const Header* hdr;
 		pkt.assign_stay(hdr);
+		uint8_t next_header = hdr->next_header;
+		pkt.head_move(sizeof(Header));
+
+		if(extension(next_header)) {
+			const size_t available = pkt.available();
+			if(available == 0) {
+				return Protocol::END;
+			}
+			const uint8_t* ext;
+			pkt.assign_stay(ext);
+			int fragment;
+			const int ext_nb = walk_extensions(ext, available, next_header, fragment);
+			if(ext_nb < 0 || (fragment >= 0 && fragmented(reinterpret_cast<const Fragment*>(ext + fragment)))) {
+				return Protocol::END;
+			}
+			pkt.head_move(ext_nb);
+		}
 
 		Protocol result = Protocol::END;
-		switch(hdr->next_header) {
+		switch(next_header) {
 			case PROTO_TCP:
 				result = Protocol::L4_TCP;
 				break;
@@ -110,7 +206,6 @@ public:
 				break;
 
 		}
-		pkt.head_move(sizeof(Header));
 		return result;
 	}
 
@@ -123,7 +218,53 @@ public:
 	static inline unsigned length_payload(const MFrame& pkt) noexcept {
 		const Header* hdr;
 		pkt.assign_stay(hdr);
-		return ntohs(hdr->payload_len);
+		return utils::ByteOrder::load_be16(&hdr->payload_len);
+	}
+
+	// header manipulation
+
+	/**
+	 * @return the sum of the TCP/UDP pseudo header, see Checksum::partial().
+	 * The upper layer is taken to follow the header with no extension headers.
+	 */
+	static inline uint32_t pseudo_sum(const Header* hdr) noexcept {
+		const uint32_t tail[2] = {utils::ByteOrder::cpu_to_be32(utils::ByteOrder::load_be16(&hdr->payload_len)), utils::ByteOrder::cpu_to_be32(hdr->next_header)};
+		return Checksum::partial(tail, sizeof(tail), Checksum::partial(&hdr->src, 2 * sizeof(Addr)));
+	}
+
+	/**
+	 * Set the TCP or UDP checksum, the whole packet (see validate_packet()) must follow the header, e.g. in RwMFrame.
+	 * @return false - if the next header is neither TCP nor UDP.
+	 */
+	static bool update_l4_checksum(Header* hdr) noexcept {
+		uint8_t* l4 = reinterpret_cast<uint8_t*>(hdr) + sizeof(Header);
+		switch(hdr->next_header) {
+			case PROTO_TCP:
+				Tcp::update_checksum(reinterpret_cast<Tcp::Header*>(l4), utils::ByteOrder::load_be16(&hdr->payload_len), pseudo_sum(hdr));
+				return true;
+			case PROTO_UDP:
+				Udp::update_checksum(reinterpret_cast<Udp::Header*>(l4), utils::ByteOrder::load_be16(&hdr->payload_len), pseudo_sum(hdr));
+				return true;
+			default:
+				return false;
+		}
+	}
+
+	/**
+	 * @return false - if the TCP or UDP checksum is wrong, true - for the other next headers.
+	 * UDP over IPv6 requires the checksum, so 0 is wrong.
+	 */
+	static bool verify_l4_checksum(const Header* hdr) noexcept {
+		const uint8_t* l4 = reinterpret_cast<const uint8_t*>(hdr) + sizeof(Header);
+		switch(hdr->next_header) {
+			case PROTO_TCP:
+				return Tcp::verify_checksum(reinterpret_cast<const Tcp::Header*>(l4), utils::ByteOrder::load_be16(&hdr->payload_len), pseudo_sum(hdr));
+			case PROTO_UDP:
+				return reinterpret_cast<const Udp::Header*>(l4)->check != 0
+					&& Udp::verify_checksum(reinterpret_cast<const Udp::Header*>(l4), utils::ByteOrder::load_be16(&hdr->payload_len), pseudo_sum(hdr));
+			default:
+				return true;
+		}
 	}
 
 };
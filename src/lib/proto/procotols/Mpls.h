@@ -0,0 +1,72 @@
+#pragma once
+
+#include <arpa/inet.h>
+#include <linux/if_ether.h>
+#include <cstdint>
+
+#include "../proto.h"
+#include "../../utils/ByteOrder.h"
+
+namespace proto {
+
+// see Ethernet.h for more details
+
+/**
+ * An MPLS label stack entry, the stack is walked an entry at a time as the VLAN tags are.
+ * The payload of the bottom entry has no type, it is taken by the IP version nibble.
+ */
+class Mpls {
+public:
+
+	static constexpr Protocol PROTOCOL = Protocol::L2_MPLS;
+
+	struct Header {
+		uint32_t entry; // label : 20, tc : 3, bottom : 1, ttl : 8 in the network byte order
+	} __attribute__ ((__packed__));
+
+	static inline uint32_t label(const Header* hdr) noexcept {
+		return utils::ByteOrder::load_be32(&hdr->entry) >> 12;
+	}
+
+	static inline bool bottom(const Header* hdr) noexcept {
+		return hdr->entry & utils::ByteOrder::cpu_to_be32(0x100);
+	}
+
+	template <typename MFrame>
+	static inline bool validate_packet(const MFrame& pkt) noexcept {
+		return pkt.available(sizeof(Header));
+	}
+
+	template <typename MFrame>
+	static inline bool validate_header(const MFrame& pkt) noexcept {
+		return pkt.available(sizeof(Header));
+	}
+
+	template <typename MFrame>
+	inline static Protocol next(MFrame& pkt) noexcept {
+		const Header* hdr;
+		pkt.assign(hdr);
+		if(not bottom(hdr)) {
+			return Protocol::L2_MPLS;
+		}
+		if(not pkt.available(sizeof(uint8_t))) {
+			return Protocol::END;
+		}
+		const uint8_t* first;
+		pkt.assign_stay(first);
+		return ip_by_version(*first);
+	}
+
+	template <typename MFrame>
+	static inline constexpr unsigned length_header(const MFrame&) noexcept {
+		return sizeof(Header);
+	}
+
+	template <typename MFrame>
+	static inline unsigned length_payload(const MFrame& pkt) noexcept {
+		return pkt.available() - sizeof(Header);
+	}
+
+};
+
+}; // namespace proto
@@ -4,6 +4,7 @@
 #include <netinet/udp.h>
 
 #include "../proto.h"
+#include "../Checksum.h"
 
 namespace proto {
 
@@ -12,6 +13,16 @@ namespace proto {
 class Tcp {
 public:
 
+	static constexpr Protocol PROTOCOL = Protocol::L4_TCP;
+
+	// the bits of Header::flags
+	static constexpr uint8_t FLAG_FIN = 0x01;
+	static constexpr uint8_t FLAG_SYN = 0x02;
+	static constexpr uint8_t FLAG_RST = 0x04;
+	static constexpr uint8_t FLAG_PSH = 0x08;
+	static constexpr uint8_t FLAG_ACK = 0x10;
+	static constexpr uint8_t FLAG_URG = 0x20;
+
 	struct Header {
 		uint16_t src;
 		uint16_t dst;
@@ -87,6 +98,37 @@ public:
 		return uint16_t(hdr->data_offset << 2u);
 	}
 
+	/**
+	 * Set the checksum of the segment of @length bytes which starts with @hdr.
+	 * @param pseudo - the sum of the pseudo header, see IPv4::pseudo_sum() and IPv6::pseudo_sum().
+	 */
+	static inline void update_checksum(Header* hdr, size_t length, uint32_t pseudo) noexcept {
+		hdr->crc = 0;
+		hdr->crc = Checksum::finish(Checksum::partial(hdr, length, pseudo));
+	}
+
+	static inline bool verify_checksum(const Header* hdr, size_t length, uint32_t pseudo) noexcept {
+		return Checksum::finish(Checksum::partial(hdr, length, pseudo)) == 0;
+	}
+
+	/**
+	 * Update the checksum after a 32-bit field of the pseudo header (an IPv4 address) has been changed.
+	 */
+	static inline void update_pseudo(Header* hdr, uint32_t old_value, uint32_t new_value) noexcept {
+		hdr->crc = Checksum::update32(hdr->crc, old_value, new_value);
+	}
+
+	// the ports are in the network byte order, the checksum is updated incrementally
+	static inline void port_src_set(Header* hdr, uint16_t port) noexcept {
+		hdr->crc = Checksum::update16(hdr->crc, hdr->src, port);
+		hdr->src = port;
+	}
+
+	static inline void port_dst_set(Header* hdr, uint16_t port) noexcept {
+		hdr->crc = Checksum::update16(hdr->crc, hdr->dst, port);
+		hdr->dst = port;
+	}
+
 };
 
 }; // namespace proto
@@ -4,6 +4,10 @@
 #include <netinet/udp.h>
 
 #include "../proto.h"
+#include "../../utils/ByteOrder.h"
+#include "../Checksum.h"
+#include "Vxlan.h"
+#include "GtpU.h"
 
 namespace proto {
 
@@ -12,13 +16,15 @@ namespace proto {
 class Udp {
 public:
 
+	static constexpr Protocol PROTOCOL = Protocol::L4_UDP;
+
 	using Header = udphdr;
 
 	template <typename MFrame>
 	static inline bool validate_packet(MFrame& pkt) noexcept {
 		const Header* hdr;
 		pkt.assign_stay(hdr);
-		uint16_t packet_nb = ntohs(hdr->len);
+		uint16_t packet_nb = utils::ByteOrder::load_be16(&hdr->len);
 		unsigned available = pkt.available();
 
 		if(
@@ -37,10 +43,21 @@ public:
 		return pkt.available(sizeof(Header));
 	}
 
+	/**
+	 * The tunnels are taken by the destination port, the payload of an other port is END.
+	 */
 	template <typename MFrame>
 	inline static Protocol next(MFrame& pkt) noexcept {
-		pkt.head_move(sizeof(Header));
-		return Protocol::END;
+		const Header* hdr;
+		pkt.assign(hdr);
+		switch(utils::ByteOrder::load_be16(&hdr->dest)) {
+			case Vxlan::PORT:
+				return Protocol::L5_VXLAN;
+			case GtpU::PORT:
+				return Protocol::L5_GTPU;
+			default:
+				return Protocol::END;
+		}
 	}
 
 	template <typename MFrame>
@@ -52,7 +69,56 @@ public:
 	static inline unsigned length_payload(const MFrame& pkt) noexcept {
 		const Header* hdr;
 		pkt.assign_stay(hdr);
-		return ntohs(hdr->len) - sizeof(Header);
+		return utils::ByteOrder::load_be16(&hdr->len) - sizeof(Header);
+	}
+
+	// header manipulation
+
+	/**
+	 * Set the checksum of the datagram of @length bytes which starts with @hdr,
+	 * a computed 0 is sent as 0xFFFF since 0 means no checksum.
+	 * @param pseudo - the sum of the pseudo header, see IPv4::pseudo_sum() and IPv6::pseudo_sum().
+	 */
+	static inline void update_checksum(Header* hdr, size_t length, uint32_t pseudo) noexcept {
+		hdr->check = 0;
+		hdr->check = nonzero(Checksum::finish(Checksum::partial(hdr, length, pseudo)));
+	}
+
+	/**
+	 * @return true - if the checksum is valid or absent (0).
+	 */
+	static inline bool verify_checksum(const Header* hdr, size_t length, uint32_t pseudo) noexcept {
+		return hdr->check == 0 || Checksum::finish(Checksum::partial(hdr, length, pseudo)) == 0;
+	}
+
+	/**
+	 * Update the checksum after a 32-bit field of the pseudo header (an IPv4 address) has been changed.
+	 */
+	static inline void update_pseudo(Header* hdr, uint32_t old_value, uint32_t new_value) noexcept {
+		if(hdr->check) {
+			hdr->check = nonzero(Checksum::update32(hdr->check, old_value, new_value));
+		}
+	}
+
+	// the ports are in the network byte order, the checksum is updated incrementally
+	static inline void port_src_set(Header* hdr, uint16_t port) noexcept {
+		if(hdr->check) {
+			hdr->check = nonzero(Checksum::update16(hdr->check, hdr->source, port));
+		}
+		hdr->source = port;
+	}
+
+	static inline void port_dst_set(Header* hdr, uint16_t port) noexcept {
+		if(hdr->check) {
+			hdr->check = nonzero(Checksum::update16(hdr->check, hdr->dest, port));
+		}
+		hdr->dest = port;
+	}
+
+private:
+
+	static inline uint16_t nonzero(uint16_t check) noexcept {
+		return check ? check : 0xFFFF;
 	}
 
 };
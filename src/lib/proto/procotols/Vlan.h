@@ -2,8 +2,10 @@
 
 #include <arpa/inet.h>
 #include <linux/if_ether.h>
+#include <cstring>
 
 #include "../proto.h"
+#include "../../utils/ByteOrder.h"
 
 namespace proto {
 
@@ -12,6 +14,8 @@ namespace proto {
 class Vlan {
 public:
 
+	static constexpr Protocol PROTOCOL = Protocol::L2_VLAN;
+
 	struct Header {
 
 		union {
@@ -42,7 +46,7 @@ public:
 		pkt.assign(hdr);
 		Protocol result = Protocol::END;
 
-		switch(ntohs(hdr->nextProto)) {
+		switch(utils::ByteOrder::load_be16(&hdr->nextProto)) {
 			case ETH_P_IP:
 				result = Protocol::L3_IPv4;
 				break;
@@ -50,8 +54,12 @@ public:
 				result = Protocol::L3_IPv6;
 				break;
 			case ETH_P_8021Q:
+			case ETH_P_8021AD: // QinQ, the service tag has the VLAN header
 				result = Protocol::L2_VLAN;
 				break;
+			case ETH_P_MPLS_UC:
+				result = Protocol::L2_MPLS;
+				break;
 			default:
 				break;
 		}
@@ -69,6 +77,78 @@ public:
 		return pkt.available() - sizeof(Header);
 	}
 
+	/**
+	 * Insert a tag after the MAC addresses of the Ethernet header at the head, the addresses (12 bytes) are moved
+	 * to the headroom and the EtherType of the frame becomes the one of the tag.
+	 * @param tci - the tag in the host byte order (PCP, DEI and VID).
+	 * @param tpid - ETH_P_8021Q, ETH_P_8021AD for the service tag of QinQ.
+	 * @return false - if the headroom is too short or the Ethernet header is not available.
+	 */
+	template <typename MFrame>
+	static inline bool push(MFrame& pkt, uint16_t tci, uint16_t tpid = ETH_P_8021Q) noexcept {
+		if(pkt.offset() < sizeof(Header) || not pkt.available(ADDRS + sizeof(uint16_t))) {
+			return false;
+		}
+		uint8_t* head;
+		pkt.assign_stay(head);
+		if(head == nullptr) { // SafeMFrame out of bounds, it also keeps -Warray-bounds off the memmove()
+			return false;
+		}
+		uint8_t* ptr = head - sizeof(Header);
+		memmove(ptr, head, ADDRS);
+		utils::ByteOrder::store_be16(ptr + ADDRS, tpid);
+		utils::ByteOrder::store_be16(ptr + ADDRS + sizeof(uint16_t), tci);
+		pkt.head_move_back(sizeof(Header));
+		return true;
+	}
+
+	/**
+	 * Remove the outer tag of the Ethernet header at the head, the MAC addresses are moved over the tag.
+	 * @param tci - takes the tag in the host byte order.
+	 * @return false - if the frame has no tag.
+	 */
+	template <typename MFrame>
+	static inline bool pop(MFrame& pkt, uint16_t& tci) noexcept {
+		if(not tagged(pkt)) {
+			return false;
+		}
+		uint8_t* ptr;
+		pkt.assign_stay(ptr);
+		if(ptr == nullptr) { // SafeMFrame out of bounds
+			return false;
+		}
+		const Header* hdr = reinterpret_cast<const Header*>(ptr + ADDRS + sizeof(uint16_t));
+		tci = utils::ByteOrder::load_be16(&hdr->vlan_tci);
+		memmove(ptr + sizeof(Header), ptr, ADDRS);
+		pkt.head_move(sizeof(Header));
+		return true;
+	}
+
+	template <typename MFrame>
+	static inline bool pop(MFrame& pkt) noexcept {
+		uint16_t tci;
+		return pop(pkt, tci);
+	}
+
+	/**
+	 * @return true - if the Ethernet header at the head has a tag.
+	 */
+	template <typename MFrame>
+	static inline bool tagged(const MFrame& pkt) noexcept {
+		if(not pkt.available(ADDRS + sizeof(uint16_t) + sizeof(Header))) {
+			return false;
+		}
+		const uint8_t* ptr;
+		pkt.assign_stay(ptr);
+		uint16_t tpid;
+		memcpy(&tpid, ptr + ADDRS, sizeof(tpid));
+		return tpid == utils::ByteOrder::cpu_to_be16(ETH_P_8021Q) || tpid == utils::ByteOrder::cpu_to_be16(ETH_P_8021AD);
+	}
+
+private:
+
+	static constexpr size_t ADDRS = 2 * ETH_ALEN; // the MAC addresses of the Ethernet header
+
 };
 
 }; // namespace proto
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+
+#include "../proto.h"
+
+namespace proto {
+
+// see Ethernet.h for more details
+
+/**
+ * VXLAN (RFC 7348) over UDP, the payload is an Ethernet frame.
+ */
+class Vxlan {
+public:
+
+	static constexpr Protocol PROTOCOL = Protocol::L5_VXLAN;
+	static constexpr uint16_t PORT = 4789; // the UDP destination port
+	static constexpr uint8_t FLAG_VNI = 0x08; // the I flag, the VNI is valid
+
+	struct Header {
+		uint8_t flags;
+		uint8_t reserved0[3];
+		uint8_t vni[3];
+		uint8_t reserved1;
+	} __attribute__ ((__packed__));
+
+	static inline uint32_t vni(const Header* hdr) noexcept {
+		return (uint32_t(hdr->vni[0]) << 16) | (uint32_t(hdr->vni[1]) << 8) | hdr->vni[2];
+	}
+
+	template <typename MFrame>
+	static inline bool validate_packet(const MFrame& pkt) noexcept {
+		return validate_header(pkt);
+	}
+
+	template <typename MFrame>
+	static inline bool validate_header(const MFrame& pkt) noexcept {
+		if(pkt.available(sizeof(Header))) {
+			const Header* hdr;
+			pkt.assign_stay(hdr);
+			return hdr->flags & FLAG_VNI;
+		}
+		return false;
+	}
+
+	template <typename MFrame>
+	inline static Protocol next(MFrame& pkt) noexcept {
+		pkt.head_move(sizeof(Header));
+		return Protocol::L2_ETHERNET;
+	}
+
+	template <typename MFrame>
+	static inline constexpr unsigned length_header(const MFrame&) noexcept {
+		return sizeof(Header);
+	}
+
+	template <typename MFrame>
+	static inline unsigned length_payload(const MFrame& pkt) noexcept {
+		return pkt.available() - sizeof(Header);
+	}
+
+};
+
+}; // namespace proto
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <cstdlib>
 
 namespace proto {
@@ -12,9 +13,28 @@ enum Protocol : unsigned char {
 	L4_UDP,
 	L4_TCP,
 	L4_GRE,
+	L2_MPLS,
+	L5_VXLAN,
+	L5_GTPU,
 
 	END = 100
 };
 
+/**
+ * @return true - if the payload of the protocol is an encapsulated packet, the parsers count such protocols
+ * as the depth of the headers which follow.
+ */
+inline constexpr bool tunnel(Protocol protocol) noexcept {
+	return protocol == Protocol::L4_GRE || protocol == Protocol::L5_VXLAN || protocol == Protocol::L5_GTPU;
+}
+
+/**
+ * @return the IP protocol by the version nibble of the first byte of a packet which has no type,
+ * e.g. below the MPLS stack or in GTP-U.
+ */
+inline constexpr Protocol ip_by_version(uint8_t first) noexcept {
+	return (first >> 4) == 4 ? Protocol::L3_IPv4 : (first >> 4) == 6 ? Protocol::L3_IPv6 : Protocol::END;
+}
+
 }; // namespace proto
 
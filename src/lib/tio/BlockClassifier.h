@@ -0,0 +1,236 @@
+#pragma once
+
+#include "CharSet.h"
+#include "stream/BlockInputStream.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+namespace tio {
+
+/**
+ * A CharClassifier over the blocks of a BlockInputStream, a chunk of chars is not copied,
+ * view() points it in the block. Only a chunk which reaches the end of a block is copied into the accumulator,
+ * as it may go on in the next block, e.g. the last chunk of an array or a mapped file.
+ * A view is valid until the next next().
+ * A run of a class is scanned by a CharSet of the chars which stop it or of the chars of the class,
+ * if one of them fits CharSet::CAPACITY and SSE4.2 is on, the scanners are prepared by the first next() after classify().
+ *
+ * Using sample:
+ * tio::MappedFileInputStream stream("netlist.v");
+ * tio::BlockClassifier bcf(&stream, EOS, UNKNOWN, true);
+ * bcf.classify(SEPARATOR, " \t\n", true);
+ * while((id = bcf.next()) != EOS) {
+ *     const auto view = bcf.view();
+ *     ...
+ * }
+ */
+class BlockClassifier {
+public:
+	using Char_t = char;
+	using CharClassId = unsigned;
+
+	struct View {
+		const Char_t* data;
+		size_t length;
+	};
+
+protected:
+
+	static constexpr size_t CharClassMapSize = 1ull << (sizeof(Char_t) << 3ull);
+
+	struct CharClass {
+		CharClassId id;
+		bool accumulate;
+	};
+
+	enum class ScanMode : uint8_t {
+		SCALAR,
+		FIND_ANY, // set - the chars of the other classes
+		FIND_OTHER // set - the chars of the class
+	};
+
+	struct Scanner {
+		CharClassId id;
+		ScanMode mode;
+		CharSet set;
+	};
+
+	const CharClassId m_cclass_eos;
+	BlockInputStream* m_stream;
+	const Char_t* m_data;
+	const Char_t* m_end;
+	std::vector<Char_t> m_accum;
+	View m_view;
+	CharClass m_char_class_map[CharClassMapSize];
+	std::vector<Scanner> m_scanners;
+	uint8_t m_scanner_map[CharClassMapSize]; // a char -> its class scanner in m_scanners
+	bool m_prepared;
+
+public:
+	BlockClassifier(const BlockClassifier&) = delete;
+	BlockClassifier(BlockClassifier&&) = delete;
+
+	BlockClassifier& operator=(const BlockClassifier&) = delete;
+	BlockClassifier& operator=(BlockClassifier&&) = delete;
+
+	virtual ~BlockClassifier() = default;
+
+	/**
+	 * @param stream - A tio::BlockInputStream instance pointer to read from.
+	 * @param cclass_eos - End of stream user identifier.
+	 * @param cclass_unknown - Unknown/default char class user identifier.
+	 * @param accumulate - enables accumulating unknown/default characters.
+	 */
+	BlockClassifier(
+		BlockInputStream* stream
+		, const CharClassId cclass_eos
+		, const CharClassId cclass_unknown
+		, bool accumulate
+	               ) noexcept
+		: m_cclass_eos(cclass_eos)
+		, m_stream(stream)
+		, m_data(nullptr)
+		, m_end(nullptr)
+		, m_accum()
+		, m_view{nullptr, 0}
+		, m_scanners()
+		, m_prepared(false) {
+		for(size_t i = 0; i < CharClassMapSize; ++i) {
+			m_char_class_map[i] = CharClass{cclass_unknown, accumulate};
+		}
+	}
+
+	/**
+	 * Append a new char class, see CharClassifier::classify().
+	 */
+	void classify(const CharClassId cclass_id, const Char_t* cclass_str, bool accumulate) noexcept {
+		const CharClass cclass{cclass_id, accumulate};
+		while(*cclass_str) {
+			const unsigned char idx = *cclass_str;
+			m_char_class_map[idx] = cclass;
+			cclass_str++;
+		}
+		m_prepared = false;
+	}
+
+	/**
+	 * @return char class identifier.
+	 */
+	CharClassId next() noexcept {
+		if(not m_prepared) {
+			prepare();
+		}
+		if(m_data == m_end && not refill()) {
+			m_view = View{m_data, 0};
+			return m_cclass_eos;
+		}
+		const Char_t* const start = m_data;
+		const auto cclass = class_of(*m_data);
+		if(cclass.accumulate) {
+			const Scanner& scanner = m_scanners[m_scanner_map[uint8_t(*m_data)]];
+			scan(scanner);
+			if(m_data == m_end) {
+				return accumulate(start, scanner);
+			}
+		} else {
+			m_data++;
+		}
+		m_view = View{start, size_t(m_data - start)};
+		return cclass.id;
+	}
+
+	/**
+	 * @return the chars of the last next(), they are not null-terminated.
+	 */
+	inline View view() const noexcept {
+		return m_view;
+	}
+
+protected:
+
+	inline CharClass class_of(Char_t ch) const noexcept {
+		const unsigned char idx = ch;
+		return m_char_class_map[idx];
+	}
+
+	inline void scan(const Scanner& scanner) noexcept {
+		switch(scanner.mode) {
+		case ScanMode::FIND_ANY:
+			m_data = scanner.set.find_any(m_data, m_end);
+			break;
+		case ScanMode::FIND_OTHER:
+			m_data = scanner.set.find_other(m_data, m_end);
+			break;
+		default:
+			while(m_data != m_end && class_of(*m_data).id == scanner.id) {
+				m_data++;
+			}
+		}
+	}
+
+	/**
+	 * Build a scanner per a class id.
+	 */
+	void prepare() noexcept {
+		m_scanners.clear();
+		for(size_t i = 0; i < CharClassMapSize; ++i) {
+			const CharClassId id = m_char_class_map[i].id;
+			size_t idx = 0;
+			while(idx < m_scanners.size() && m_scanners[idx].id != id) {
+				idx++;
+			}
+			m_scanner_map[i] = uint8_t(idx);
+			if(idx < m_scanners.size()) {
+				continue;
+			}
+#if defined(__SSE4_2__)
+			Scanner scanner{id, ScanMode::FIND_ANY, CharSet()};
+#else
+			Scanner scanner{id, ScanMode::SCALAR, CharSet()}; // the table lookup beats the scalar CharSet
+#endif
+			for(size_t ch = 0; ch < CharClassMapSize && scanner.mode == ScanMode::FIND_ANY; ++ch) {
+				if(m_char_class_map[ch].id != id && not scanner.set.insert(Char_t(ch))) {
+					scanner.mode = ScanMode::FIND_OTHER;
+				}
+			}
+			if(scanner.mode == ScanMode::FIND_OTHER) {
+				scanner.set = CharSet();
+				for(size_t ch = 0; ch < CharClassMapSize && scanner.mode == ScanMode::FIND_OTHER; ++ch) {
+					if(m_char_class_map[ch].id == id && not scanner.set.insert(Char_t(ch))) {
+						scanner.mode = ScanMode::SCALAR;
+					}
+				}
+			}
+			m_scanners.push_back(scanner);
+		}
+		m_prepared = true;
+	}
+
+	inline bool refill() noexcept {
+		const BlockInputStream::Block block = m_stream->fill();
+		m_data = block.data;
+		m_end = block.data + block.size;
+		return block.size != 0;
+	}
+
+	/**
+	 * The chunk from @start has reached the end of the block, it is copied, as it may go on in the next blocks.
+	 */
+	CharClassId accumulate(const Char_t* start, const Scanner& scanner) noexcept {
+		m_accum.assign(start, m_end);
+		while(refill()) {
+			const Char_t* const chunk = m_data;
+			scan(scanner);
+			m_accum.insert(m_accum.end(), chunk, m_data);
+			if(m_data != m_end) {
+				break;
+			}
+		}
+		m_view = View{m_accum.data(), m_accum.size()};
+		return scanner.id;
+	}
+};
+
+}; // namespace tio
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "BlockClassifier.h"
+#include "KeywordTable.h"
+
+namespace tio {
+
+/**
+ * A StreamTokenizer over the blocks of a BlockInputStream, the token chars are taken by view().
+ */
+class BlockTokenizer : public BlockClassifier {
+public:
+	using Token_t = BlockClassifier::CharClassId;
+
+protected:
+	using Base_t = BlockClassifier;
+	using TokenMap_t = KeywordTable<Token_t>;
+
+	TokenMap_t m_token_map;
+
+public:
+	BlockTokenizer(const BlockTokenizer&) = delete;
+	BlockTokenizer(BlockTokenizer&&) = delete;
+
+	BlockTokenizer& operator=(const BlockTokenizer&) = delete;
+	BlockTokenizer& operator=(BlockTokenizer&&) = delete;
+
+	virtual ~BlockTokenizer() = default;
+
+	BlockTokenizer(
+		BlockInputStream* stream
+		, const Token_t token_eos
+		, const Token_t token_unknown
+		, bool accumulate
+	              ) noexcept
+		: Base_t(stream, token_eos, token_unknown, accumulate)
+		, m_token_map() {}
+
+	void tokenize(const Token_t token, const char* token_str) noexcept {
+		m_token_map.insert(token_str, token);
+	}
+
+	inline Token_t next_token() noexcept {
+		if(not m_token_map.frozen()) {
+			m_token_map.freeze();
+		}
+		Token_t token = next();
+		m_token_map.find(m_view.data, m_view.length, token);
+		return token;
+	}
+};
+
+}; // namespace tio
@@ -99,6 +99,13 @@ public:
 		return m_accum.data();
 	}
 
+	/**
+	 * @return Accumulator length without the terminal zero.
+	 */
+	size_t length() const noexcept {
+		return m_accum.size() - 1;
+	}
+
 protected:
 
 	void accumulate(const CharClassId cclass_id) noexcept {
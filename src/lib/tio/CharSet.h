@@ -0,0 +1,188 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#if defined(__SSE4_2__)
+#include <nmmintrin.h>
+// the chunks of a string are read over its terminal zero, but not over its page
+#define TIO_CHARSET_STRING_SCAN __attribute__((no_sanitize_address))
+#else
+#define TIO_CHARSET_STRING_SCAN
+#endif
+
+namespace tio {
+
+/**
+ * A set of up to CAPACITY chars which finds the end of a run of its chars or of the other chars
+ * 16 bytes at a time by pcmpestri/pcmpistri with SSE4.2, the scalar loops are the fallback.
+ * The find_*() take a range, the span_*() take a null-terminated string, the terminal zero stops them
+ * and they never read 16 bytes over a page end, so a string may end at the end of a mapping.
+ */
+class CharSet {
+public:
+	static constexpr int CAPACITY = 16;
+
+private:
+	static constexpr uintptr_t PAGE_SIZE = 4096;
+	static constexpr uintptr_t VECTOR_SIZE = 16;
+
+	alignas(16) char m_chars[CAPACITY];
+	int m_length;
+
+public:
+	CharSet() noexcept : m_chars(), m_length(0) {}
+
+	/**
+	 * @return false - if the set is full, a char in the set already is not inserted again.
+	 */
+	bool insert(char ch) noexcept {
+		if(contains(ch)) {
+			return true;
+		}
+		if(m_length == CAPACITY) {
+			return false;
+		}
+		m_chars[m_length++] = ch;
+		return true;
+	}
+
+	inline bool contains(char ch) const noexcept {
+		for(int i = 0; i < m_length; i++) {
+			if(m_chars[i] == ch) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	inline int size() const noexcept {
+		return m_length;
+	}
+
+	/**
+	 * @return the first char of [@data, @end) which is in the set, @end - if none.
+	 */
+	inline const char* find_any(const char* data, const char* end) const noexcept {
+#if defined(__SSE4_2__)
+		const __m128i set = _mm_loadu_si128(reinterpret_cast<const __m128i*>(m_chars));
+		for(; end - data >= ptrdiff_t(VECTOR_SIZE); data += VECTOR_SIZE) {
+			const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+			const int idx = _mm_cmpestri(set, m_length, chunk, int(VECTOR_SIZE), _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY);
+			if(idx != int(VECTOR_SIZE)) {
+				return data + idx;
+			}
+		}
+#endif
+		while(data != end && not contains(*data)) {
+			data++;
+		}
+		return data;
+	}
+
+	/**
+	 * @return the first char of [@data, @end) which is not in the set, @end - if none.
+	 */
+	inline const char* find_other(const char* data, const char* end) const noexcept {
+#if defined(__SSE4_2__)
+		const __m128i set = _mm_loadu_si128(reinterpret_cast<const __m128i*>(m_chars));
+		for(; end - data >= ptrdiff_t(VECTOR_SIZE); data += VECTOR_SIZE) {
+			const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+			const int idx = _mm_cmpestri(set, m_length, chunk, int(VECTOR_SIZE),
+				_SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_NEGATIVE_POLARITY);
+			if(idx != int(VECTOR_SIZE)) {
+				return data + idx;
+			}
+		}
+#endif
+		while(data != end && contains(*data)) {
+			data++;
+		}
+		return data;
+	}
+
+	/**
+	 * The set must not take the zero char.
+	 * @return the first char of @str which is not in the set, it is the terminal zero at the end.
+	 */
+	TIO_CHARSET_STRING_SCAN inline const char* span_any(const char* str) const noexcept {
+#if defined(__SSE4_2__)
+		const __m128i set = _mm_loadu_si128(reinterpret_cast<const __m128i*>(m_chars));
+		while(true) {
+			if(not loadable(str)) {
+				if(contains(*str)) {
+					str++;
+					continue;
+				}
+				return str;
+			}
+			const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(str));
+			// the chars after the terminal zero aren't valid, the negative polarity counts them as the others
+			const int idx = _mm_cmpestri(set, m_length, chunk, implicit_length(chunk),
+				_SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_NEGATIVE_POLARITY);
+			if(idx != int(VECTOR_SIZE)) {
+				return str + idx;
+			}
+			str += VECTOR_SIZE;
+		}
+#else
+		while(*str && contains(*str)) {
+			str++;
+		}
+		return str;
+#endif
+	}
+
+	/**
+	 * The set must not take the zero char.
+	 * @return the first char of @str which is in the set or the terminal zero.
+	 */
+	TIO_CHARSET_STRING_SCAN inline const char* span_other(const char* str) const noexcept {
+#if defined(__SSE4_2__)
+		const __m128i set = _mm_loadu_si128(reinterpret_cast<const __m128i*>(m_chars));
+		while(true) {
+			if(not loadable(str)) {
+				if(*str && not contains(*str)) {
+					str++;
+					continue;
+				}
+				return str;
+			}
+			const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(str));
+			const int length = implicit_length(chunk);
+			const int idx = _mm_cmpestri(set, m_length, chunk, length, _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY);
+			if(idx != int(VECTOR_SIZE)) {
+				return str + idx;
+			}
+			if(length != int(VECTOR_SIZE)) {
+				return str + length;
+			}
+			str += VECTOR_SIZE;
+		}
+#else
+		while(*str && not contains(*str)) {
+			str++;
+		}
+		return str;
+#endif
+	}
+
+private:
+
+#if defined(__SSE4_2__)
+	static inline bool loadable(const char* str) noexcept {
+		return (uintptr_t(str) & (PAGE_SIZE - 1)) <= PAGE_SIZE - VECTOR_SIZE;
+	}
+
+	/**
+	 * @return the length of the chars before a zero in @chunk.
+	 */
+	static inline int implicit_length(__m128i chunk) noexcept {
+		const unsigned mask = unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_setzero_si128())));
+		return mask ? __builtin_ctz(mask) : int(VECTOR_SIZE);
+	}
+#endif
+};
+
+}; // namespace tio
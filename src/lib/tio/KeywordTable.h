@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace tio {
+
+/**
+ * A keyword -> token table which is filled by insert() and is frozen by freeze() into a perfect hash,
+ * so find() takes one slot and one memcmp() of the key bytes without an allocation.
+ * The hash is a seeded FNV-1a, freeze() tries the seeds until the keywords take distinct slots
+ * of a power of two table, the table is doubled if no seed of a round fits.
+ * The keywords and the slots take two arrays, the table is rebuilt by freeze() after every insert().
+ *
+ * Using sample:
+ * KeywordTable<unsigned> table;
+ * table.insert("module", TKN_MODULE);
+ * table.freeze();
+ * unsigned token;
+ * if(table.find(str, len, token)) {...}
+ */
+template<typename T>
+class KeywordTable {
+	static constexpr unsigned SEEDS = 64; // the seeds tried per a table size
+	static constexpr uint32_t EMPTY = ~uint32_t(0);
+
+	struct Keyword {
+		std::string str;
+		T token;
+	};
+
+	struct Slot {
+		uint32_t offset; // in m_chars, EMPTY - a free slot
+		uint32_t length;
+		T token;
+	};
+
+	std::vector<Keyword> m_keywords;
+	std::vector<Slot> m_slots;
+	std::vector<char> m_chars;
+	uint32_t m_seed;
+	size_t m_mask;
+	bool m_frozen;
+
+public:
+	KeywordTable() noexcept : m_keywords(), m_slots(), m_chars(), m_seed(0), m_mask(0), m_frozen(true) {}
+
+	/**
+	 * Add a keyword, a keyword which is in the table already keeps its token.
+	 * @return false - if the keyword is in the table already.
+	 */
+	bool insert(const char* str, T token) noexcept {
+		for(const auto& keyword : m_keywords) {
+			if(keyword.str == str) {
+				return false;
+			}
+		}
+		m_keywords.push_back(Keyword{std::string(str), token});
+		m_frozen = false;
+		return true;
+	}
+
+	/**
+	 * Build the perfect hash of the keywords.
+	 */
+	void freeze() noexcept {
+		m_chars.clear();
+		for(const auto& keyword : m_keywords) {
+			m_chars.insert(m_chars.end(), keyword.str.begin(), keyword.str.end());
+		}
+		size_t size = 4;
+		while(size < m_keywords.size() * 2) {
+			size <<= 1;
+		}
+		for(;; size <<= 1) {
+			for(uint32_t seed = 0; seed < SEEDS; seed++) {
+				if(build(size, seed)) {
+					m_frozen = true;
+					return;
+				}
+			}
+		}
+	}
+
+	inline bool frozen() const noexcept {
+		return m_frozen;
+	}
+
+	/**
+	 * @param length - the key bytes, the key needs no terminal zero.
+	 * @return false - if the key is not a keyword, @token is not changed then.
+	 */
+	inline bool find(const char* key, size_t length, T& token) const noexcept {
+		if(m_slots.empty()) {
+			return false;
+		}
+		const Slot& slot = m_slots[hash(key, length, m_seed) & m_mask];
+		if(slot.offset != EMPTY && slot.length == length && memcmp(m_chars.data() + slot.offset, key, length) == 0) {
+			token = slot.token;
+			return true;
+		}
+		return false;
+	}
+
+	inline size_t size() const noexcept {
+		return m_keywords.size();
+	}
+
+private:
+
+	bool build(size_t size, uint32_t seed) noexcept {
+		m_slots.assign(size, Slot{EMPTY, 0, T()});
+		m_seed = seed;
+		m_mask = size - 1;
+		uint32_t offset = 0;
+		for(const auto& keyword : m_keywords) {
+			Slot& slot = m_slots[hash(keyword.str.data(), keyword.str.size(), seed) & m_mask];
+			if(slot.offset != EMPTY) {
+				return false;
+			}
+			slot = Slot{offset, uint32_t(keyword.str.size()), keyword.token};
+			offset += uint32_t(keyword.str.size());
+		}
+		return true;
+	}
+
+	static inline uint32_t hash(const char* key, size_t length, uint32_t seed) noexcept {
+		uint32_t result = 2166136261u ^ (seed * 0x9E3779B9u);
+		for(size_t i = 0; i < length; i++) {
+			result = (result ^ uint8_t(key[i])) * 16777619u;
+		}
+		// FNV-1a is weak in the low bits the mask takes
+		return result ^ (result >> 15);
+	}
+};
+
+}; // namespace tio
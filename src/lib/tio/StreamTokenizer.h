@@ -1,18 +1,21 @@
 #pragma once
 
 #include "CharClassifier.h"
-
-#include <map>
+#include "KeywordTable.h"
 
 namespace tio {
 
+/**
+ * The keywords of tokenize() are frozen into a perfect hash by the first next_token() after them,
+ * so next_token() looks the accumulator up without building a string (see KeywordTable).
+ */
 class StreamTokenizer : public CharClassifier {
 public:
 	using Token_t = CharClassifier::CharClassId;
 
 protected:
 	using Base_t = CharClassifier;
-	using TokenMap_t = std::map<std::string, Token_t>;
+	using TokenMap_t = KeywordTable<Token_t>;
 
 	TokenMap_t m_token_map;
 
@@ -35,15 +38,15 @@ public:
 		, m_token_map() {}
 
 	void tokenize(const Token_t token, const char* token_str) noexcept {
-		m_token_map.insert(std::make_pair(token_str, token));
+		m_token_map.insert(token_str, token);
 	}
 
 	inline Token_t next_token() noexcept {
-		Token_t token = next();
-		const auto it = m_token_map.find(cstring());
-		if(it != m_token_map.end()) {
-			token = it->second;
+		if(not m_token_map.frozen()) {
+			m_token_map.freeze();
 		}
+		Token_t token = next();
+		m_token_map.find(cstring(), length(), token);
 		return token;
 	}
 };
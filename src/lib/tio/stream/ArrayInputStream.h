@@ -1,43 +1,38 @@
 #pragma once
 
-#include "InputStream.h"
+#include "BlockInputStream.h"
 
 #include <cstdlib>
 #include <cstring>
 
 namespace tio {
 
-class ArrayInputStream : public InputStream {
+/**
+ * The array is handed out as a single block.
+ */
+class ArrayInputStream : public BlockInputStream {
 	const char* const m_array;
 	const size_t m_array_nb;
-	size_t m_offset;
-	char m_char;
+	bool m_filled;
 public:
 
 	template<typename T>
 	ArrayInputStream(const T* array, size_t array_items) noexcept
 		: m_array(reinterpret_cast<const char*>(array))
 		, m_array_nb(sizeof(*array) * array_items)
-		, m_offset(0)
-		, m_char(0) {}
+		, m_filled(false) {}
 
 	ArrayInputStream(const char* str) noexcept
 		: m_array(str)
 		, m_array_nb(strlen(str))
-		, m_offset(0)
-		, m_char(0) {}
+		, m_filled(false) {}
 
-	inline char read() noexcept override {
-		return m_char;
-	}
-
-	inline bool next() noexcept override {
-		if(m_offset < m_array_nb) {
-			m_char = m_array[m_offset];
-			m_offset++;
-			return true;
+	inline Block fill() noexcept override {
+		if(m_filled) {
+			return Block{m_array + m_array_nb, 0};
 		}
-		return false;
+		m_filled = true;
+		return Block{m_array, m_array_nb};
 	}
 
 	virtual ~ArrayInputStream() = default;
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "InputStream.h"
+
+#include <cstdlib>
+
+namespace tio {
+
+/**
+ * A stream which hands its bytes out by blocks, a block is valid until the next fill().
+ * read() and next() go along the blocks, so a block stream serves CharClassifier too,
+ * BlockClassifier takes the blocks themselves. The two ways of reading should not be mixed on a stream.
+ */
+class BlockInputStream : public InputStream {
+public:
+	struct Block {
+		const char* data;
+		size_t size; // 0 - the end of the stream
+	};
+
+private:
+	const char* m_data;
+	const char* m_end;
+	char m_char;
+
+public:
+	BlockInputStream() noexcept : m_data(nullptr), m_end(nullptr), m_char(0) {}
+
+	/**
+	 * @return the next block of the stream, an empty one at the end.
+	 */
+	virtual Block fill() noexcept = 0;
+
+	inline char read() noexcept override {
+		return m_char;
+	}
+
+	inline bool next() noexcept override {
+		if(m_data == m_end) {
+			const Block block = fill();
+			if(block.size == 0) {
+				return false;
+			}
+			m_data = block.data;
+			m_end = block.data + block.size;
+		}
+		m_char = *m_data++;
+		return true;
+	}
+
+	virtual ~BlockInputStream() = default;
+};
+
+}; // namespace tio
@@ -1,28 +1,27 @@
 #pragma once
 
-#include "InputStream.h"
+#include "BlockInputStream.h"
 
 #include <cstdio>
+#include <vector>
 
 namespace tio {
 
-class FileInputStream : public InputStream {
+/**
+ * The file is read by fread() into a buffer of @buffer_size bytes, a block is the filled part of the buffer.
+ */
+class FileInputStream : public BlockInputStream {
+	static constexpr size_t BUFFER_SIZE = 1 << 16;
+
 	FILE* m_stream;
-	char m_char;
+	std::vector<char> m_buffer;
 public:
-	FileInputStream(FILE* stream) noexcept : m_stream(stream) {}
-
-	inline char read() noexcept override {
-		return m_char;
-	}
+	FileInputStream(FILE* stream, size_t buffer_size = BUFFER_SIZE) noexcept
+		: m_stream(stream)
+		, m_buffer(buffer_size ? buffer_size : 1) {}
 
-	inline bool next() noexcept override {
-		const auto ret = getc(m_stream);
-		if(ret >= 0) {
-			m_char = char(ret);
-			return true;
-		}
-		return false;
+	inline Block fill() noexcept override {
+		return Block{m_buffer.data(), fread(m_buffer.data(), 1, m_buffer.size(), m_stream)};
 	}
 
 	virtual ~FileInputStream() = default;
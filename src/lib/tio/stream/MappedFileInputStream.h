@@ -0,0 +1,77 @@
+#pragma once
+
+#include "BlockInputStream.h"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace tio {
+
+/**
+ * The whole file is mapped and handed out as a single block, so BlockClassifier copies nothing but the last chunk.
+ */
+class MappedFileInputStream : public BlockInputStream {
+	const char* m_mapping;
+	size_t m_bytes;
+	bool m_filled;
+public:
+	MappedFileInputStream(const MappedFileInputStream&) = delete;
+	MappedFileInputStream(MappedFileInputStream&&) = delete;
+
+	MappedFileInputStream& operator=(const MappedFileInputStream&) = delete;
+	MappedFileInputStream& operator=(MappedFileInputStream&&) = delete;
+
+	explicit MappedFileInputStream(const std::string& file_name) noexcept(false)
+		: m_mapping(nullptr), m_bytes(0), m_filled(false) {
+		const int fd = ::open(file_name.c_str(), O_RDONLY);
+		if(fd < 0) {
+			throw std::runtime_error(file_name + ": " + strerror(errno));
+		}
+		struct stat st;
+		if(fstat(fd, &st) != 0) {
+			const int error = errno;
+			::close(fd);
+			throw std::runtime_error(file_name + ": " + strerror(error));
+		}
+		m_bytes = size_t(st.st_size);
+		if(m_bytes == 0) { // an empty file can't be mapped
+			::close(fd);
+			return;
+		}
+		void* mapping = mmap(nullptr, m_bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+		const int error = errno;
+		::close(fd);
+		if(mapping == MAP_FAILED) {
+			throw std::runtime_error(file_name + ": " + strerror(error));
+		}
+		madvise(mapping, m_bytes, MADV_SEQUENTIAL);
+		m_mapping = static_cast<const char*>(mapping);
+	}
+
+	inline Block fill() noexcept override {
+		if(m_filled) {
+			return Block{m_mapping + m_bytes, 0};
+		}
+		m_filled = true;
+		return Block{m_mapping, m_bytes};
+	}
+
+	inline size_t size() const noexcept {
+		return m_bytes;
+	}
+
+	virtual ~MappedFileInputStream() noexcept {
+		if(m_mapping) {
+			munmap(const_cast<char*>(m_mapping), m_bytes);
+		}
+	}
+};
+
+}; // namespace tio
@@ -1,10 +1,22 @@
 #pragma once
 
 #include <cstdint>
+#include <cstring>
 #include <codecvt>
 
 namespace utils {
 
+/**
+ * The byte order conversions are constexpr, so they fold for the constants, e.g. the ports and the ethertypes
+ * to compare with, and they are single bswap instructions for the variables.
+ * The load/store helpers access the fields of the packet headers by memcpy(), as the headers are at
+ * any offset of a frame: it takes no alignment and no aliasing of the header structs, so the compiler is free
+ * to merge and vectorize the loads, and a big-endian load is a movbe (with -mmovbe) or a mov and a bswap.
+ *
+ * Using sample:
+ * const uint16_t length = ByteOrder::load_be16(&hdr->tot_len);
+ * if(ByteOrder::load<uint16_t>(&hdr->dest) == ByteOrder::cpu_to_be16(4789)) {...}
+ */
 class ByteOrder {
 public:
 
@@ -24,6 +36,95 @@ public:
 #endif
 	}
 
+	static inline constexpr uint16_t bswap16(uint16_t v) noexcept {
+		return __builtin_bswap16(v);
+	}
+
+	static inline constexpr uint32_t bswap32(uint32_t v) noexcept {
+		return __builtin_bswap32(v);
+	}
+
+	static inline constexpr uint64_t bswap64(uint64_t v) noexcept {
+		return __builtin_bswap64(v);
+	}
+
+	static inline constexpr uint16_t cpu_to_be16(uint16_t v) noexcept {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+		return bswap16(v);
+#else
+		return v;
+#endif
+	}
+
+	static inline constexpr uint32_t cpu_to_be32(uint32_t v) noexcept {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+		return bswap32(v);
+#else
+		return v;
+#endif
+	}
+
+	static inline constexpr uint64_t cpu_to_be64(uint64_t v) noexcept {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+		return bswap64(v);
+#else
+		return v;
+#endif
+	}
+
+	static inline constexpr uint16_t be16_to_cpu(uint16_t v) noexcept {
+		return cpu_to_be16(v);
+	}
+
+	static inline constexpr uint32_t be32_to_cpu(uint32_t v) noexcept {
+		return cpu_to_be32(v);
+	}
+
+	static inline constexpr uint64_t be64_to_cpu(uint64_t v) noexcept {
+		return cpu_to_be64(v);
+	}
+
+	/**
+	 * @return a value at any address, in the byte order of the memory.
+	 */
+	template<typename T>
+	static inline T load(const void* ptr) noexcept {
+		T value;
+		memcpy(&value, ptr, sizeof(T));
+		return value;
+	}
+
+	template<typename T>
+	static inline void store(void* ptr, const T& value) noexcept {
+		memcpy(ptr, &value, sizeof(T));
+	}
+
+	// the big-endian values at any address
+
+	static inline uint16_t load_be16(const void* ptr) noexcept {
+		return be16_to_cpu(load<uint16_t>(ptr));
+	}
+
+	static inline uint32_t load_be32(const void* ptr) noexcept {
+		return be32_to_cpu(load<uint32_t>(ptr));
+	}
+
+	static inline uint64_t load_be64(const void* ptr) noexcept {
+		return be64_to_cpu(load<uint64_t>(ptr));
+	}
+
+	static inline void store_be16(void* ptr, uint16_t value) noexcept {
+		store(ptr, cpu_to_be16(value));
+	}
+
+	static inline void store_be32(void* ptr, uint32_t value) noexcept {
+		store(ptr, cpu_to_be32(value));
+	}
+
+	static inline void store_be64(void* ptr, uint64_t value) noexcept {
+		store(ptr, cpu_to_be64(value));
+	}
+
 };
 
 }; // namespace utils
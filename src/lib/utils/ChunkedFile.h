@@ -1,9 +1,21 @@
 #pragma once
+#ifndef CHUNKED_FILE_H
+#define CHUNKED_FILE_H
 
+#include "SpscByteRing.h"
+
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
 #include <ctime>
+#include <thread>
 #include <unistd.h>
 #include <string>
 #include <cstring>
+#include <sys/uio.h>
 
 namespace utils {
 
@@ -132,7 +144,210 @@ private:
 
 };
 
+/**
+ * ChunkedFile which is written by a dedicated I/O thread, so the producer (e.g. a packet thread) never blocks
+ * on the disk or on a rotation. The producer copies the bytes into SpscByteRing, the I/O thread takes all the
+ * bytes of the ring by one writev() and rotates the file between the batches, so a write never spans two files.
+ * A write which doesn't fit into the ring is dropped and counted, or the producer waits for the room
+ * if the backpressure mode is set. All the methods but the counters are called by one producer thread.
+ */
+class AsyncChunkedFile {
+	static constexpr size_t DEFAULT_RING_BYTES = size_t(4) << 20;
+	static constexpr unsigned IDLE_SLEEP_US = 1000;
+	static constexpr size_t LINE_MAX_BYTES = 1024; // the longest line of printf()
+
+	ChunkedFile m_file; // is used by the I/O thread after open()
+	SpscByteRing m_ring;
+	const bool m_backpressure;
+	std::thread m_thread;
+	std::atomic<bool> m_stop;
+
+	std::atomic<uint64_t> m_dropped_writes;
+	std::atomic<uint64_t> m_dropped_bytes;
+	std::atomic<uint64_t> m_waits; // of the producer in the backpressure mode
+	std::atomic<uint64_t> m_written_bytes;
+	std::atomic<uint64_t> m_batches;
+	std::atomic<uint64_t> m_rotations;
+	std::atomic<uint64_t> m_errors; // of writev(), the batch is lost
+
+public:
+
+	/**
+	 * @param ring_bytes - the ring size, it is rounded up to a power of two.
+	 * @param backpressure - true to wait for the room in the ring instead of dropping a write.
+	 */
+	AsyncChunkedFile(const char* root_dir, const char* file_pref, const char* file_ext,
+	                 size_t ring_bytes = DEFAULT_RING_BYTES, bool backpressure = false) :
+		m_file(root_dir, file_pref, file_ext), m_ring(ring_bytes), m_backpressure(backpressure), m_thread(),
+		m_stop(false), m_dropped_writes(0), m_dropped_bytes(0), m_waits(0), m_written_bytes(0), m_batches(0),
+		m_rotations(0), m_errors(0) {}
+
+	AsyncChunkedFile(const AsyncChunkedFile&) = delete;
+	AsyncChunkedFile& operator=(const AsyncChunkedFile&) = delete;
+
+	AsyncChunkedFile(AsyncChunkedFile&&) = delete;
+	AsyncChunkedFile& operator=(AsyncChunkedFile&&) = delete;
+
+	~AsyncChunkedFile() {
+		close();
+	}
+
+	/**
+	 * It must be called before open().
+	 */
+	void set_split_time(long time_split_sec) noexcept {
+		m_file.set_split_time(time_split_sec);
+	}
+
+	/**
+	 * Open the first file and start the I/O thread.
+	 * @return 0 - if the file has been opened.
+	 */
+	int open() {
+		if(m_thread.joinable())
+			return -1;
+
+		if(not m_ring.allocated() && m_ring.allocate() != 0)
+			return -1;
+
+		if(m_file.open() != 0)
+			return -1;
+
+		m_stop.store(false);
+		m_thread = std::thread(&AsyncChunkedFile::run, this);
+		return 0;
+	}
+
+	/**
+	 * Write the remaining bytes, stop the I/O thread and close the file.
+	 */
+	void close() {
+		if(m_thread.joinable()) {
+			m_stop.store(true, std::memory_order_release);
+			m_thread.join();
+		}
+		m_file.close();
+	}
+
+	/**
+	 * @return false - if the bytes have been dropped.
+	 */
+	bool write(const void* data, size_t size) noexcept {
+		if(m_ring.write(data, size))
+			return true;
+
+		if(m_backpressure && size <= m_ring.capacity() && m_thread.joinable()) {
+			m_waits.fetch_add(1, std::memory_order_relaxed);
+			while(not m_ring.write(data, size)) {
+				std::this_thread::yield();
+			}
+			return true;
+		}
+		m_dropped_writes.fetch_add(1, std::memory_order_relaxed);
+		m_dropped_bytes.fetch_add(size, std::memory_order_relaxed);
+		return false;
+	}
+
+	/**
+	 * fprintf() to the file, the line is formatted by the producer and it is cut to LINE_MAX_BYTES.
+	 * @return false - if the line has been dropped.
+	 */
+	bool printf(const char* format, ...) noexcept __attribute__ ((format (printf, 2, 3))) {
+		char buffer[LINE_MAX_BYTES];
+		va_list args;
+		va_start(args, format);
+		const int size = vsnprintf(buffer, sizeof(buffer), format, args);
+		va_end(args);
+		if(size < 0)
+			return false;
+
+		return write(buffer, size_t(size) < sizeof(buffer) ? size_t(size) : sizeof(buffer) - 1);
+	}
+
+	inline uint64_t dropped_writes() const noexcept {
+		return m_dropped_writes.load(std::memory_order_relaxed);
+	}
+
+	inline uint64_t dropped_bytes() const noexcept {
+		return m_dropped_bytes.load(std::memory_order_relaxed);
+	}
+
+	inline uint64_t waits() const noexcept {
+		return m_waits.load(std::memory_order_relaxed);
+	}
+
+	inline uint64_t written_bytes() const noexcept {
+		return m_written_bytes.load(std::memory_order_relaxed);
+	}
+
+	inline uint64_t batches() const noexcept {
+		return m_batches.load(std::memory_order_relaxed);
+	}
+
+	inline uint64_t rotations() const noexcept {
+		return m_rotations.load(std::memory_order_relaxed);
+	}
+
+	inline uint64_t errors() const noexcept {
+		return m_errors.load(std::memory_order_relaxed);
+	}
+
+private:
+
+	void run() noexcept {
+		for(;;) {
+			const bool stop = m_stop.load(std::memory_order_acquire);
+			struct iovec iov[2];
+			int iov_count = 0;
+			const size_t size = m_ring.peek(iov, iov_count);
+			if(size) {
+				if(m_file.update()) {
+					m_rotations.fetch_add(1, std::memory_order_relaxed);
+				}
+				if(write_all(iov, iov_count)) {
+					m_written_bytes.fetch_add(size, std::memory_order_relaxed);
+				} else {
+					m_errors.fetch_add(1, std::memory_order_relaxed);
+				}
+				m_batches.fetch_add(1, std::memory_order_relaxed);
+				m_ring.consume(size);
+			} else if(stop) {
+				break;
+			} else {
+				std::this_thread::sleep_for(std::chrono::microseconds(unsigned(IDLE_SLEEP_US)));
+			}
+		}
+	}
+
+	bool write_all(struct iovec* iov, int iov_count) noexcept {
+		FILE* file = m_file.get();
+		if(file == nullptr)
+			return false;
+
+		const int fd = fileno(file);
+		while(iov_count) {
+			const ssize_t result = writev(fd, iov, iov_count);
+			if(result < 0) {
+				if(errno == EINTR)
+					continue;
+				return false;
+			}
+			size_t written = size_t(result);
+			while(iov_count && written >= iov->iov_len) {
+				written -= iov->iov_len;
+				iov++;
+				iov_count--;
+			}
+			if(iov_count) {
+				iov->iov_base = static_cast<uint8_t*>(iov->iov_base) + written;
+				iov->iov_len -= written;
+			}
+		}
+		return true;
+	}
+
+};
+
 }; // namespace utils
 
 #endif /* CHUNKED_FILE_H */
-
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../binio/MArea.h"
+#include "TextBuffer.h"
 
 #include <cstdint>
 #include <cstdio>
@@ -16,31 +17,32 @@ public:
 
 	static void memory(FILE* out, binio::MCArea area) {
 		const uint8_t* data = reinterpret_cast<const uint8_t*>(area.cbegin());
-		fprintf(out, "---- %p ---- %lu bytes\n", data, area.length());
-		unsigned offset = 0;
+		TextBuffer& text = TextBuffer::local(out);
+		text.str("---- 0x").hex(reinterpret_cast<uintptr_t>(data)).str(" ---- ").dec(area.length()).str(" bytes\n");
+		size_t offset = 0;
 		while(offset < area.length()) {
-			fprintf(out, "%p ", data + offset);
-			offset += print_hex_ascii(out, data + offset, area.length() - offset);
+			text.str("0x").hex(reinterpret_cast<uintptr_t>(data + offset)).chr(' ');
+			offset += print_hex_ascii(text, data + offset, area.length() - offset);
 		}
+		text.flush();
 	}
 
 	static void hex(FILE* out, binio::MCArea area) {
-		const uint8_t* data = reinterpret_cast<const uint8_t*>(area.cbegin());
-		size_t size = area.length();
-		for(unsigned i = 0; i < size; i++) {
-			fprintf(out, "%02x", data[i]);
-		}
-		fprintf(out, "\n");
+		TextBuffer& text = TextBuffer::local(out);
+		text.hex(reinterpret_cast<const uint8_t*>(area.cbegin()), area.length()).chr('\n');
+		text.flush();
 	}
 
 	static void hex_ascii(FILE* out, binio::MCArea area) {
 		const uint8_t* data = reinterpret_cast<const uint8_t*>(area.cbegin());
 		size_t size = area.length();
-		fprintf(out, "\n");
-		unsigned offset = 0;
+		TextBuffer& text = TextBuffer::local(out);
+		text.chr('\n');
+		size_t offset = 0;
 		while(offset < size) {
-			offset += print_hex_ascii(out, data + offset, size - offset);
+			offset += print_hex_ascii(text, data + offset, size - offset);
 		}
+		text.flush();
 	}
 
 	// aliases for raw pointers
@@ -63,30 +65,27 @@ public:
 
 private:
 
-	static int print_hex_ascii(FILE* out, const uint8_t* mem, unsigned size) {
-		unsigned width = (size > HEX_ASCII_DUMP_WIDTH) ? HEX_ASCII_DUMP_WIDTH : size;
-		for(unsigned i = 0; i < HEX_ASCII_DUMP_WIDTH; i++) {
+	static size_t print_hex_ascii(TextBuffer& text, const uint8_t* mem, size_t size) noexcept {
+		const size_t width = (size > HEX_ASCII_DUMP_WIDTH) ? HEX_ASCII_DUMP_WIDTH : size;
+		for(size_t i = 0; i < HEX_ASCII_DUMP_WIDTH; i++) {
 			if(i % HEX_ASCII_DUMP_SPLITTER_WIDTH == 0 && i > 0)
-				fprintf(out, " ");
+				text.chr(' ');
 			if(i < width) {
-				fprintf(out, "%02x ", mem[i]);
+				text.hex(mem[i], 2).chr(' ');
 			} else {
-				fprintf(out, "   ");
+				text.str("   ");
 			}
 		}
-		fprintf(out, " |");
+		text.str(" |");
 
-		for(unsigned i = 0; i < width; i++) {
+		for(size_t i = 0; i < width; i++) {
 			char ch = mem[i];
 			if(i > 0 && i % HEX_ASCII_DUMP_SPLITTER_WIDTH == 0)
-				fprintf(out, " ");
-			if(isprint(ch))
-				fprintf(out, "%c", ch);
-			else
-				fprintf(out, ".");
+				text.chr(' ');
+			text.chr(isprint(ch) ? ch : '.');
 		}
 
-		fprintf(out, "|\n");
+		text.str("|\n");
 		return width;
 	}
 
@@ -94,5 +93,3 @@ private:
 
 }; // namespace utils
 
-#endif /* UTILS_HEX_DUMPER_H */
-
@@ -0,0 +1,193 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+namespace utils {
+
+/**
+ * The parsers of the IPv4 and IPv6 addresses and of the prefix lengths in text, as inet_pton() takes them,
+ * but over a [str, end) range which needs no terminal zero, without the locale, allocations and exceptions.
+ * A parser moves @str over the parsed chars, at a failure @str points to the char which has broken the text,
+ * so the caller reports its column. A parser stops at the first char which can't continue the text,
+ * the caller checks the char, e.g. '/' or the end of a line.
+ *
+ * Using sample:
+ * uint32_t addr;
+ * const char* str = line;
+ * if(not utils::InetText::parse_ipv4(str, line_end, addr)) {
+ *     report(str - line);
+ * }
+ */
+class InetText {
+public:
+	static constexpr size_t IPV6_BYTES = 16;
+
+	/**
+	 * A dotted quad, a leading zero of a part is not accepted.
+	 * @param addr - the address in host byte order.
+	 */
+	static bool parse_ipv4(const char*& str, const char* end, uint32_t& addr) noexcept {
+		uint32_t result = 0;
+		for(unsigned part = 0; part < 4; part++) {
+			if(part) {
+				if(str == end || *str != '.') {
+					return false;
+				}
+				str++;
+			}
+			const char* start = str;
+			unsigned value;
+			if(not parse_decimal(str, end, 3, value)) {
+				return false;
+			}
+			if(value > 255) {
+				str = start;
+				return false;
+			}
+			result = (result << 8) | value;
+		}
+		addr = result;
+		return true;
+	}
+
+	/**
+	 * 8 groups of up to 4 hex digits, a single "::" of zero groups and a trailing dotted quad.
+	 * @param bytes - IPV6_BYTES bytes of the address in network byte order.
+	 */
+	static bool parse_ipv6(const char*& str, const char* end, uint8_t* bytes) noexcept {
+		uint8_t result[IPV6_BYTES] = {0};
+		size_t filled = 0;
+		size_t gap = IPV6_BYTES + 1; // the offset of "::", none
+		if(str != end && *str == ':') {
+			if(end - str < 2 || str[1] != ':') {
+				return false;
+			}
+			str += 2;
+			gap = 0;
+		}
+		while(filled < IPV6_BYTES && str != end && hex_digit(*str) >= 0) {
+			const char* group = str;
+			unsigned value = 0;
+			int digit;
+			while(str != end && str - group < 4 && (digit = hex_digit(*str)) >= 0) {
+				value = (value << 4) | unsigned(digit);
+				str++;
+			}
+			if(str != end && *str == '.') {
+				// the last 4 bytes are a dotted quad
+				str = group;
+				uint32_t addr;
+				if(filled + 4 > IPV6_BYTES || not parse_ipv4(str, end, addr)) {
+					return false;
+				}
+				for(unsigned i = 0; i < 4; i++) {
+					result[filled++] = uint8_t(addr >> (24 - 8 * i));
+				}
+				break;
+			}
+			if(str != end && hex_digit(*str) >= 0) {
+				return false; // more than 4 digits
+			}
+			result[filled++] = uint8_t(value >> 8);
+			result[filled++] = uint8_t(value);
+			if(str == end || *str != ':') {
+				break;
+			}
+			if(end - str >= 2 && str[1] == ':') {
+				if(gap <= IPV6_BYTES) {
+					return false; // the second "::"
+				}
+				gap = filled;
+				str += 2;
+				continue;
+			}
+			if(filled == IPV6_BYTES) {
+				return false;
+			}
+			str++;
+			if(str == end || hex_digit(*str) < 0) {
+				return false;
+			}
+		}
+		if(gap <= IPV6_BYTES) {
+			if(filled == IPV6_BYTES) {
+				return false; // "::" stands for no group
+			}
+			const size_t tail = filled - gap;
+			memmove(result + IPV6_BYTES - tail, result + gap, tail);
+			memset(result + gap, 0, IPV6_BYTES - tail - gap);
+		} else if(filled != IPV6_BYTES) {
+			return false;
+		}
+		memcpy(bytes, result, IPV6_BYTES);
+		return true;
+	}
+
+	/**
+	 * A prefix length of up to 3 digits, e.g. after '/'.
+	 */
+	static bool parse_depth(const char*& str, const char* end, unsigned depth_max, unsigned& depth) noexcept {
+		const char* start = str;
+		if(not parse_decimal(str, end, 3, depth)) {
+			return false;
+		}
+		if(depth > depth_max) {
+			str = start;
+			return false;
+		}
+		return true;
+	}
+
+	/**
+	 * @return 4 or 6 - the family which the text starts with, 0 - none.
+	 */
+	static unsigned family(const char* str, const char* end) noexcept {
+		for(const char* ch = str; ch != end && ch - str < 5; ch++) {
+			if(*ch == ':') {
+				return 6;
+			} else if(*ch == '.') {
+				return 4;
+			} else if(hex_digit(*ch) < 0) {
+				break;
+			}
+		}
+		return 0;
+	}
+
+private:
+
+	static inline int hex_digit(char ch) noexcept {
+		if(ch >= '0' && ch <= '9') {
+			return ch - '0';
+		}
+		const char lower = char(ch | 0x20);
+		if(lower >= 'a' && lower <= 'f') {
+			return lower - 'a' + 10;
+		}
+		return -1;
+	}
+
+	/**
+	 * Up to @digits_max decimal digits without a leading zero.
+	 */
+	static inline bool parse_decimal(const char*& str, const char* end, unsigned digits_max, unsigned& value) noexcept {
+		const char* start = str;
+		unsigned result = 0;
+		while(str != end && unsigned(*str - '0') < 10) {
+			if(unsigned(str - start) == digits_max || (str != start && *start == '0')) {
+				return false;
+			}
+			result = result * 10 + unsigned(*str - '0');
+			str++;
+		}
+		if(str == start) {
+			return false;
+		}
+		value = result;
+		return true;
+	}
+};
+
+}; // namespace utils
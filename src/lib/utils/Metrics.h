@@ -0,0 +1,269 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+/**
+ * The instrumentation of the containers and the parsers, it is compiled in by -DMETRICS_ENABLED only.
+ * Without it Counter and Histogram are empty and their add() is a no-op, so the instrumented code costs nothing.
+ * METRICS_THREADS - amount of the threads which have counter cells of their own, the other threads share one
+ * more cell by atomic increments.
+ */
+#ifndef METRICS_THREADS
+#define METRICS_THREADS 16
+#endif
+
+namespace utils {
+
+/**
+ * A log2 histogram: the bucket 0 counts the zeros, the bucket i - the values of [2^(i-1), 2^i),
+ * the last bucket - all the greater values.
+ */
+struct Log2Histogram {
+	static constexpr unsigned BUCKETS = 33;
+
+	uint64_t buckets[BUCKETS];
+	uint64_t sum;
+
+	Log2Histogram() noexcept : buckets(), sum(0) {}
+
+	static inline unsigned bucket(uint64_t value) noexcept {
+		const unsigned result = value ? 64 - unsigned(__builtin_clzll(value)) : 0;
+		return result < BUCKETS ? result : BUCKETS - 1;
+	}
+
+	/**
+	 * @return the upper bound of the bucket (exclusive), 0 - for the last bucket which has none.
+	 */
+	static inline uint64_t bound(unsigned bucket) noexcept {
+		return bucket + 1 < BUCKETS ? uint64_t(1) << bucket : 0;
+	}
+
+	inline void add(uint64_t value) noexcept {
+		buckets[bucket(value)]++;
+		sum += value;
+	}
+
+	uint64_t count() const noexcept {
+		uint64_t result = 0;
+		for(unsigned i = 0; i < BUCKETS; i++) {
+			result += buckets[i];
+		}
+		return result;
+	}
+
+	/**
+	 * @return the upper bound of the bucket which holds the quantile @q of [0, 1].
+	 */
+	uint64_t quantile(double q) const noexcept {
+		const uint64_t total = count();
+		uint64_t seen = 0;
+		for(unsigned i = 0; i < BUCKETS; i++) {
+			seen += buckets[i];
+			if(seen && double(seen) >= q * double(total)) {
+				return bound(i);
+			}
+		}
+		return 0;
+	}
+
+	void merge(const Log2Histogram& histogram) noexcept {
+		for(unsigned i = 0; i < BUCKETS; i++) {
+			buckets[i] += histogram.buckets[i];
+		}
+		sum += histogram.sum;
+	}
+};
+
+struct Metrics {
+#ifdef METRICS_ENABLED
+	static constexpr bool ENABLED = true;
+#else
+	static constexpr bool ENABLED = false;
+#endif
+	static constexpr unsigned THREADS = METRICS_THREADS;
+
+	/**
+	 * @return the cell of the calling thread, THREADS - for the threads which share the last cell.
+	 */
+	static inline unsigned thread() noexcept {
+		static std::atomic<unsigned> threads(0);
+		static thread_local unsigned id = threads.fetch_add(1, std::memory_order_relaxed);
+		return id < THREADS ? id : THREADS;
+	}
+};
+
+/**
+ * A cell of a thread, it is written by the thread without atomic increments.
+ */
+struct alignas(64) MetricsCell {
+	std::atomic<uint64_t> value;
+
+	MetricsCell() noexcept : value(0) {}
+
+	inline void add(uint64_t n, bool shared) noexcept {
+		if(shared) {
+			value.fetch_add(n, std::memory_order_relaxed);
+		} else {
+			value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+		}
+	}
+
+	inline uint64_t load() const noexcept {
+		return value.load(std::memory_order_relaxed);
+	}
+};
+
+#ifdef METRICS_ENABLED
+
+/**
+ * A counter of a hot path with a cache line per thread, load() sums up the threads.
+ */
+class Counter {
+	MetricsCell m_cells[Metrics::THREADS + 1];
+
+public:
+	Counter() noexcept : m_cells() {}
+
+	Counter(const Counter&) = delete;
+	Counter& operator=(const Counter&) = delete;
+
+	inline void add(uint64_t n = 1) noexcept {
+		const unsigned thread = Metrics::thread();
+		m_cells[thread].add(n, thread == Metrics::THREADS);
+	}
+
+	uint64_t load() const noexcept {
+		uint64_t result = 0;
+		for(const auto& cell : m_cells) {
+			result += cell.load();
+		}
+		return result;
+	}
+};
+
+/**
+ * A log2 histogram of a hot path with the buckets per thread, load() sums up the threads.
+ */
+class Histogram {
+	struct alignas(64) Cell {
+		std::atomic<uint64_t> buckets[Log2Histogram::BUCKETS];
+		std::atomic<uint64_t> sum;
+
+		Cell() noexcept : sum(0) {
+			for(auto& bucket : buckets) {
+				bucket.store(0, std::memory_order_relaxed);
+			}
+		}
+	};
+
+	Cell m_cells[Metrics::THREADS + 1];
+
+public:
+	Histogram() noexcept : m_cells() {}
+
+	Histogram(const Histogram&) = delete;
+	Histogram& operator=(const Histogram&) = delete;
+
+	inline void add(uint64_t value) noexcept {
+		const unsigned thread = Metrics::thread();
+		Cell& cell = m_cells[thread];
+		std::atomic<uint64_t>& bucket = cell.buckets[Log2Histogram::bucket(value)];
+		if(thread == Metrics::THREADS) {
+			bucket.fetch_add(1, std::memory_order_relaxed);
+			cell.sum.fetch_add(value, std::memory_order_relaxed);
+		} else {
+			bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			cell.sum.store(cell.sum.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+		}
+	}
+
+	Log2Histogram load() const noexcept {
+		Log2Histogram result;
+		for(const auto& cell : m_cells) {
+			for(unsigned i = 0; i < Log2Histogram::BUCKETS; i++) {
+				result.buckets[i] += cell.buckets[i].load(std::memory_order_relaxed);
+			}
+			result.sum += cell.sum.load(std::memory_order_relaxed);
+		}
+		return result;
+	}
+};
+
+#else
+
+class Counter {
+public:
+	inline void add(uint64_t = 1) noexcept {}
+
+	inline uint64_t load() const noexcept {
+		return 0;
+	}
+};
+
+class Histogram {
+public:
+	inline void add(uint64_t) noexcept {}
+
+	inline Log2Histogram load() const noexcept {
+		return Log2Histogram();
+	}
+};
+
+#endif
+
+/**
+ * Export of the metrics in the Prometheus text format, one metric per line:
+ * <prefix>_<name> <value>
+ * <prefix>_<name>_bucket{le="<bound>"} <cumulative count> ... <prefix>_<name>_sum, <prefix>_<name>_count
+ *
+ * Using sample:
+ * utils::MetricsWriter writer(stdout, "flows");
+ * map.metrics().write(writer);
+ * writer.value("size", map.size());
+ */
+class MetricsWriter {
+	FILE* m_out;
+	const char* m_prefix;
+
+public:
+	MetricsWriter(FILE* out, const char* prefix) noexcept : m_out(out), m_prefix(prefix) {}
+
+	/**
+	 * @param label - e.g. "proto=\"tcp\"", nullptr - none.
+	 */
+	void value(const char* name, uint64_t value, const char* label = nullptr) noexcept {
+		if(label) {
+			fprintf(m_out, "%s_%s{%s} %lu\n", m_prefix, name, label, (unsigned long)value);
+		} else {
+			fprintf(m_out, "%s_%s %lu\n", m_prefix, name, (unsigned long)value);
+		}
+	}
+
+	inline void counter(const char* name, const Counter& counter, const char* label = nullptr) noexcept {
+		value(name, counter.load(), label);
+	}
+
+	inline void histogram(const char* name, const Histogram& histogram) noexcept {
+		histogram_of(name, histogram.load());
+	}
+
+	void histogram_of(const char* name, const Log2Histogram& histogram) noexcept {
+		uint64_t cumulative = 0;
+		for(unsigned i = 0; i < Log2Histogram::BUCKETS; i++) {
+			cumulative += histogram.buckets[i];
+			if(Log2Histogram::bound(i)) {
+				fprintf(m_out, "%s_%s_bucket{le=\"%lu\"} %lu\n", m_prefix, name,
+				        (unsigned long)(Log2Histogram::bound(i) - 1), (unsigned long)cumulative);
+			} else {
+				fprintf(m_out, "%s_%s_bucket{le=\"+Inf\"} %lu\n", m_prefix, name, (unsigned long)cumulative);
+			}
+		}
+		fprintf(m_out, "%s_%s_sum %lu\n", m_prefix, name, (unsigned long)histogram.sum);
+		fprintf(m_out, "%s_%s_count %lu\n", m_prefix, name, (unsigned long)cumulative);
+	}
+};
+
+}; // namespace utils
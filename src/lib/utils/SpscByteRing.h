@@ -0,0 +1,143 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include <sys/uio.h>
+
+namespace utils {
+
+/**
+ * A single producer single consumer ring of bytes, e.g. of log lines from a packet thread to an I/O thread.
+ * A write is published as a whole, so the consumer never sees a part of it.
+ * The consumer takes the readable bytes as one or two iovec (where the ring wraps) which fit writev().
+ * The positions are kept on their own cache lines as intrusive::SpscRing does.
+ */
+class SpscByteRing {
+	const size_t m_capacity; // a power of two
+	const size_t m_mask;
+	uint8_t* m_bytes;
+
+	alignas(64) std::atomic<size_t> m_tail; // the producer position
+	size_t m_head_cached;
+
+	alignas(64) std::atomic<size_t> m_head; // the consumer position
+	size_t m_tail_cached;
+
+public:
+
+	/**
+	 * @param capacity - amount of bytes, it is rounded up to a power of two.
+	 */
+	SpscByteRing(size_t capacity) noexcept
+		: m_capacity(round_up(capacity))
+		, m_mask(m_capacity - 1)
+		, m_bytes(nullptr)
+		, m_tail(0)
+		, m_head_cached(0)
+		, m_head(0)
+		, m_tail_cached(0) {}
+
+	SpscByteRing(const SpscByteRing&) = delete;
+	SpscByteRing& operator=(const SpscByteRing&) = delete;
+
+	SpscByteRing(SpscByteRing&&) = delete;
+	SpscByteRing& operator=(SpscByteRing&&) = delete;
+
+	~SpscByteRing() noexcept {
+		free(m_bytes);
+	}
+
+	/**
+	 * @return 0 - if the bytes have been allocated successfully.
+	 */
+	int allocate() noexcept {
+		if(m_bytes)
+			return -1;
+
+		m_bytes = static_cast<uint8_t*>(malloc(m_capacity));
+		return m_bytes ? 0 : -1;
+	}
+
+	/**
+	 * The producer side, the bytes are written all or none.
+	 * @return false - if there is no room for @size bytes.
+	 */
+	bool write(const void* data, size_t size) noexcept {
+		const size_t tail = m_tail.load(std::memory_order_relaxed);
+		if(m_capacity - (tail - m_head_cached) < size) {
+			m_head_cached = m_head.load(std::memory_order_acquire);
+			if(m_capacity - (tail - m_head_cached) < size)
+				return false;
+		}
+		const size_t offset = tail & m_mask;
+		const size_t first = size < m_capacity - offset ? size : m_capacity - offset;
+		memcpy(m_bytes + offset, data, first);
+		memcpy(m_bytes, static_cast<const uint8_t*>(data) + first, size - first);
+		m_tail.store(tail + size, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	 * The consumer side, the readable bytes stay in the ring until consume().
+	 * @return amount of the readable bytes, @iov keeps them in @iov_count (0, 1 or 2) pieces.
+	 */
+	size_t peek(struct iovec iov[2], int& iov_count) noexcept {
+		const size_t head = m_head.load(std::memory_order_relaxed);
+		if(head == m_tail_cached) {
+			m_tail_cached = m_tail.load(std::memory_order_acquire);
+		}
+		const size_t size = m_tail_cached - head;
+		const size_t offset = head & m_mask;
+		const size_t first = size < m_capacity - offset ? size : m_capacity - offset;
+		iov_count = 0;
+		if(first) {
+			iov[iov_count].iov_base = m_bytes + offset;
+			iov[iov_count].iov_len = first;
+			iov_count++;
+		}
+		if(size - first) {
+			iov[iov_count].iov_base = m_bytes;
+			iov[iov_count].iov_len = size - first;
+			iov_count++;
+		}
+		return size;
+	}
+
+	/**
+	 * The consumer side, release @size of the peeked bytes.
+	 */
+	inline void consume(size_t size) noexcept {
+		m_head.store(m_head.load(std::memory_order_relaxed) + size, std::memory_order_release);
+	}
+
+	inline bool allocated() const noexcept {
+		return m_bytes != nullptr;
+	}
+
+	inline size_t capacity() const noexcept {
+		return m_capacity;
+	}
+
+	/**
+	 * @return amount of the bytes in the ring, it is approximate while the ring is in use.
+	 */
+	inline size_t size() const noexcept {
+		return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+	}
+
+private:
+
+	static inline size_t round_up(size_t capacity) noexcept {
+		size_t result = 1;
+		while(result < capacity) {
+			result <<= 1;
+		}
+		return result;
+	}
+
+};
+
+}; // namespace utils
@@ -0,0 +1,232 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+namespace utils {
+
+/**
+ * A text formatter of the dumpers which formats the integers, the hex, MAC and IP addresses by hand into
+ * a buffer and writes it by one fwrite(), there are neither printf() calls nor allocations.
+ * The buffer of a thread is taken by local(), a dumper appends a record and flushes it, so the records keep
+ * their order with the other output of the stream. The buffer is flushed if it is full as well.
+ *
+ * Using sample:
+ * utils::TextBuffer::local(out).str("[IPv4]").ipv4(src).str("->").ipv4(dst).chr('\n').flush();
+ */
+class TextBuffer {
+public:
+	constexpr static size_t CAPACITY = size_t(64) << 10;
+	constexpr static size_t FIELD_BYTES = 64; // the longest formatted field, an IPv6 address is 39 chars
+
+private:
+	FILE* m_out;
+	size_t m_size;
+	char m_data[CAPACITY];
+
+	TextBuffer() noexcept : m_out(nullptr), m_size(0) {}
+
+public:
+	TextBuffer(const TextBuffer&) = delete;
+	TextBuffer(TextBuffer&&) = delete;
+
+	TextBuffer& operator=(const TextBuffer&) = delete;
+	TextBuffer& operator=(TextBuffer&&) = delete;
+
+	~TextBuffer() noexcept {
+		flush();
+	}
+
+	/**
+	 * @return the buffer of the calling thread which writes to @out, the text for another stream is flushed.
+	 */
+	static TextBuffer& local(FILE* out) noexcept {
+		static thread_local TextBuffer buffer;
+		if(buffer.m_out != out) {
+			buffer.flush();
+			buffer.m_out = out;
+		}
+		return buffer;
+	}
+
+	inline TextBuffer& chr(char ch) noexcept {
+		reserve(1);
+		m_data[m_size++] = ch;
+		return *this;
+	}
+
+	inline TextBuffer& str(const char* string) noexcept {
+		return str(string, strlen(string));
+	}
+
+	TextBuffer& str(const char* string, size_t bytes) noexcept {
+		while(bytes) {
+			reserve(bytes < CAPACITY ? bytes : CAPACITY);
+			const size_t chunk = bytes < CAPACITY - m_size ? bytes : CAPACITY - m_size;
+			memcpy(m_data + m_size, string, chunk);
+			m_size += chunk;
+			string += chunk;
+			bytes -= chunk;
+		}
+		return *this;
+	}
+
+	TextBuffer& dec(uint64_t value) noexcept {
+		char digits[20];
+		size_t n = 0;
+		do {
+			digits[n++] = char('0' + value % 10);
+			value /= 10;
+		} while(value);
+		reserve(n);
+		while(n) {
+			m_data[m_size++] = digits[--n];
+		}
+		return *this;
+	}
+
+	inline TextBuffer& sdec(int64_t value) noexcept {
+		if(value < 0) {
+			chr('-');
+			return dec(~uint64_t(value) + 1);
+		}
+		return dec(uint64_t(value));
+	}
+
+	/**
+	 * Format @value by @width hex digits at least, without the "0x" prefix.
+	 */
+	TextBuffer& hex(uint64_t value, unsigned width = 1, bool upper = false) noexcept {
+		const char* digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+		unsigned n = 1;
+		while(n < 16 && (value >> (4 * n))) {
+			n++;
+		}
+		if(n < width) {
+			n = width < 16 ? width : 16;
+		}
+		reserve(n);
+		for(unsigned i = n; i > 0; i--) {
+			m_data[m_size + i - 1] = digits[value & 0xF];
+			value >>= 4;
+		}
+		m_size += n;
+		return *this;
+	}
+
+	/**
+	 * Format @bytes of @data by 2 hex digits each, @splitter follows every byte but the last one if not 0.
+	 */
+	TextBuffer& hex(const uint8_t* data, size_t bytes, char splitter = 0, bool upper = false) noexcept {
+		const char* digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+		const size_t step = splitter ? 3 : 2;
+		for(size_t i = 0; i < bytes; i++) {
+			reserve(step);
+			m_data[m_size++] = digits[data[i] >> 4];
+			m_data[m_size++] = digits[data[i] & 0xF];
+			if(splitter && i + 1 < bytes) {
+				m_data[m_size++] = splitter;
+			}
+		}
+		return *this;
+	}
+
+	inline TextBuffer& mac(const uint8_t* mac, bool upper = true) noexcept {
+		return hex(mac, 6, ':', upper);
+	}
+
+	/**
+	 * @param addr - in the host byte order.
+	 */
+	TextBuffer& ipv4(uint32_t addr) noexcept {
+		reserve(15);
+		for(int shift = 24; shift >= 0; shift -= 8) {
+			octet(uint8_t(addr >> shift));
+			if(shift) {
+				m_data[m_size++] = '.';
+			}
+		}
+		return *this;
+	}
+
+	/**
+	 * Format by RFC 5952: the longest run of 2 and more zero groups is replaced by "::".
+	 * @param addr - 16 bytes in the network byte order.
+	 */
+	TextBuffer& ipv6(const void* addr) noexcept {
+		const uint8_t* bytes = static_cast<const uint8_t*>(addr);
+		uint16_t groups[8];
+		for(unsigned i = 0; i < 8; i++) {
+			groups[i] = uint16_t((bytes[2 * i] << 8) | bytes[2 * i + 1]);
+		}
+		unsigned zeros_begin = 8, zeros_length = 1;
+		for(unsigned i = 0; i < 8;) {
+			unsigned j = i;
+			while(j < 8 && groups[j] == 0) {
+				j++;
+			}
+			if(j - i > zeros_length) {
+				zeros_begin = i;
+				zeros_length = j - i;
+			}
+			i = j > i ? j : i + 1;
+		}
+
+		reserve(FIELD_BYTES);
+		for(unsigned i = 0; i < 8; i++) {
+			if(i == zeros_begin) {
+				m_data[m_size++] = ':';
+				if(i == 0) {
+					m_data[m_size++] = ':';
+				}
+				i += zeros_length - 1;
+				continue;
+			}
+			hex(groups[i]);
+			if(i < 7) {
+				m_data[m_size++] = ':';
+			}
+		}
+		return *this;
+	}
+
+	/**
+	 * Write the text to the stream of local().
+	 */
+	inline void flush() noexcept {
+		if(m_size && m_out) {
+			fwrite(m_data, 1, m_size, m_out);
+		}
+		m_size = 0;
+	}
+
+	inline size_t size() const noexcept {
+		return m_size;
+	}
+
+private:
+
+	/**
+	 * Make room for @bytes (up to CAPACITY), the buffer is flushed if it is short.
+	 */
+	inline void reserve(size_t bytes) noexcept {
+		if(CAPACITY - m_size < bytes) {
+			flush();
+		}
+	}
+
+	inline void octet(uint8_t value) noexcept {
+		if(value >= 100) {
+			m_data[m_size++] = char('0' + value / 100);
+		}
+		if(value >= 10) {
+			m_data[m_size++] = char('0' + value / 10 % 10);
+		}
+		m_data[m_size++] = char('0' + value % 10);
+	}
+
+};
+
+}; // namespace utils
@@ -0,0 +1,438 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include "Metrics.h"
+#include "SpscByteRing.h"
+
+namespace utils {
+
+/**
+ * A sampled packet: the ticks of the stages it has passed, 64 bytes, so a ring holds whole records only.
+ */
+struct TraceRecord {
+	static constexpr unsigned STAGES = 12;
+
+	uint64_t start; // the tick of Tracer::begin()
+	uint32_t cycles[STAGES]; // the ticks of a stage, they saturate at UINT32_MAX
+	uint32_t stages; // the mask of the recorded stages
+	uint32_t thread;
+
+	TraceRecord() noexcept : start(0), cycles(), stages(0), thread(0) {}
+
+	inline uint64_t total() const noexcept {
+		uint64_t result = 0;
+		for(unsigned i = 0; i < STAGES; i++) {
+			result += cycles[i];
+		}
+		return result;
+	}
+};
+
+static_assert(sizeof(TraceRecord) == 64, "TraceRecord is a cache line");
+
+/**
+ * The counters of a Tracer, they are written by its thread and read by the collector.
+ */
+struct TracerStat {
+	std::atomic<uint64_t> sampled;
+	std::atomic<uint64_t> dropped; // the ring was full
+
+	TracerStat() noexcept : sampled(0), dropped(0) {}
+
+	inline void add(std::atomic<uint64_t>& counter) noexcept {
+		counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+
+	void print(FILE* out) const noexcept {
+		fprintf(out, "sampled=%lu dropped=%lu\n",
+		        (unsigned long)sampled.load(std::memory_order_relaxed),
+		        (unsigned long)dropped.load(std::memory_order_relaxed));
+	}
+};
+
+/**
+ * The per-packet tracing of one packet thread: one packet of about @sample_every ones is sampled,
+ * each stage() of it adds the ticks since the previous mark to the stage, end() writes the record
+ * to the ring of the thread which TraceCollector drains.
+ * A packet which isn't sampled costs a countdown in begin() and a branch per stage.
+ * The intervals are jittered in [N/2, 3N/2), so a periodic pattern of the traffic doesn't bias the samples.
+ *
+ * @tparam C - the clock of the ticks (see storage/Clock.h), e.g. storage::TscClock.
+ *
+ * Using sample:
+ * utils::Tracer<storage::TscClock> tracer(1 << 16, 1024, worker_id);
+ * tracer.allocate();
+ * collector.attach(tracer.ring());
+ * // per packet
+ * tracer.begin();
+ * parser.parse(frame); tracer.stage(PARSE);
+ * table.find(addr); tracer.stage(IPTABLE);
+ * tracer.end();
+ */
+template<typename C>
+class Tracer {
+	C m_clock;
+	SpscByteRing m_ring;
+	const uint32_t m_sample_every; // 0 - none
+	uint32_t m_countdown;
+	uint32_t m_random;
+	bool m_active;
+	uint64_t m_last;
+	TraceRecord m_record;
+	TracerStat m_stat;
+
+public:
+
+	/**
+	 * @param ring_bytes - the ring of the records, it is rounded up to a power of two.
+	 * @param sample_every - 1 - every packet, 0 - the tracing is off.
+	 * @param thread - the id of the thread which is kept in the records.
+	 */
+	Tracer(size_t ring_bytes, uint32_t sample_every, uint32_t thread) noexcept
+		: m_clock()
+		, m_ring(ring_bytes < sizeof(TraceRecord) ? sizeof(TraceRecord) : ring_bytes)
+		, m_sample_every(sample_every)
+		, m_countdown(0)
+		, m_random(thread * 0x9E3779B9u + 1)
+		, m_active(false)
+		, m_last(0)
+		, m_record()
+		, m_stat() {
+		m_record.thread = thread;
+		m_countdown = interval();
+	}
+
+	Tracer(const Tracer&) = delete;
+	Tracer(Tracer&&) = delete;
+
+	Tracer& operator=(const Tracer&) = delete;
+	Tracer& operator=(Tracer&&) = delete;
+
+	int allocate() noexcept {
+		return m_ring.allocate();
+	}
+
+	/**
+	 * Start a packet.
+	 * @return true - if the packet is sampled.
+	 */
+	inline bool begin() noexcept {
+		if(m_sample_every == 0 or --m_countdown)
+			return false;
+
+		m_countdown = interval();
+		m_active = true;
+		memset(m_record.cycles, 0, sizeof(m_record.cycles));
+		m_record.stages = 0;
+		m_last = m_record.start = m_clock.now();
+		return true;
+	}
+
+	/**
+	 * Close the stage @stage of [0, TraceRecord::STAGES), its ticks are the ones since the previous mark.
+	 * A stage which is passed twice (e.g. a lookup per header) sums the ticks.
+	 */
+	inline void stage(unsigned stage) noexcept {
+		if(not m_active)
+			return;
+
+		assert(stage < TraceRecord::STAGES);
+		const uint64_t now = m_clock.now();
+		const uint64_t cycles = uint64_t(m_record.cycles[stage]) + (now - m_last);
+		m_record.cycles[stage] = cycles < UINT32_MAX ? uint32_t(cycles) : UINT32_MAX;
+		m_record.stages |= 1u << stage;
+		m_last = now;
+	}
+
+	/**
+	 * Finish the packet, the record is dropped if the collector lags behind.
+	 */
+	inline void end() noexcept {
+		if(not m_active)
+			return;
+
+		m_active = false;
+		m_stat.add(m_stat.sampled);
+		if(not m_ring.write(&m_record, sizeof(m_record))) {
+			m_stat.add(m_stat.dropped);
+		}
+	}
+
+	inline bool active() const noexcept {
+		return m_active;
+	}
+
+	inline SpscByteRing& ring() noexcept {
+		return m_ring;
+	}
+
+	inline C& clock() noexcept {
+		return m_clock;
+	}
+
+	inline const TracerStat& stat() const noexcept {
+		return m_stat;
+	}
+
+private:
+
+	/**
+	 * @return the packets till the next sample: 1 for N <= 1 and a xorshift32 one of [N/2, 3N/2) otherwise.
+	 */
+	inline uint32_t interval() noexcept {
+		if(m_sample_every <= 1)
+			return 1;
+
+		m_random ^= m_random << 13;
+		m_random ^= m_random >> 17;
+		m_random ^= m_random << 5;
+		return m_sample_every / 2 + m_random % m_sample_every;
+	}
+};
+
+/**
+ * The reader of the Tracer rings: the per-stage log2 histograms of the ticks, the histogram of the whole packets
+ * and the ticks of the stages of the tail packets, i.e. the ones beyond the bucket of the tail quantile of the totals
+ * (the totals of the previous collect() calls, once there are enough samples for a quantile).
+ * The results are exported as the Prometheus histograms, a text table and the folded stacks for flamegraph.pl:
+ * "packet;<stage> <ticks>" - where the time of all the packets goes, "tail;<stage> <ticks>" - of the tail ones.
+ * One thread collects, e.g. the stats one every second.
+ *
+ * Using sample:
+ * utils::TraceCollector collector(storage::TscClock().hz());
+ * collector.set_stage_name(PARSE, "parse");
+ * collector.attach(tracer.ring());
+ * // the stats thread
+ * collector.collect();
+ * collector.print(stdout);
+ * collector.write_folded(file);
+ */
+class TraceCollector {
+public:
+	static constexpr unsigned RINGS_MAX = 64;
+	static constexpr uint64_t TAIL_SAMPLES_MIN = 100; // the samples before the tail threshold is trusted
+
+private:
+	const uint64_t m_hz;
+	SpscByteRing* m_rings[RINGS_MAX];
+	unsigned m_ring_count;
+	const char* m_names[TraceRecord::STAGES];
+	double m_tail_quantile;
+	Log2Histogram m_stages[TraceRecord::STAGES];
+	Log2Histogram m_total;
+	uint64_t m_tail_cycles[TraceRecord::STAGES];
+	uint64_t m_tail_samples;
+
+public:
+
+	/**
+	 * @param hz - ticks per second of the tracers, for the nanoseconds of print().
+	 */
+	TraceCollector(uint64_t hz) noexcept
+		: m_hz(hz ? hz : 1)
+		, m_rings()
+		, m_ring_count(0)
+		, m_names()
+		, m_tail_quantile(0.99)
+		, m_stages()
+		, m_total()
+		, m_tail_cycles()
+		, m_tail_samples(0) {}
+
+	TraceCollector(const TraceCollector&) = delete;
+	TraceCollector(TraceCollector&&) = delete;
+
+	TraceCollector& operator=(const TraceCollector&) = delete;
+	TraceCollector& operator=(TraceCollector&&) = delete;
+
+	/**
+	 * Attach the ring of a tracer, before the tracing starts.
+	 * @return false - if there are RINGS_MAX rings.
+	 */
+	bool attach(SpscByteRing& ring) noexcept {
+		if(m_ring_count == RINGS_MAX)
+			return false;
+
+		m_rings[m_ring_count++] = &ring;
+		return true;
+	}
+
+	/**
+	 * @param name - a static string, it is a Prometheus name part and a flame graph frame.
+	 */
+	inline void set_stage_name(unsigned stage, const char* name) noexcept {
+		assert(stage < TraceRecord::STAGES);
+		m_names[stage] = name;
+	}
+
+	/**
+	 * @param quantile - of (0, 1), 0.99 by default.
+	 */
+	inline void set_tail_quantile(double quantile) noexcept {
+		m_tail_quantile = quantile;
+	}
+
+	/**
+	 * Drain the rings.
+	 * @return amount of the collected records.
+	 */
+	size_t collect() noexcept {
+		const uint64_t threshold = tail_threshold();
+		size_t result = 0;
+		for(unsigned i = 0; i < m_ring_count; i++) {
+			struct iovec iov[2];
+			int iov_count = 0;
+			const size_t size = m_rings[i]->peek(iov, iov_count);
+			// the ring capacity is a power of two of at least one record, so a record doesn't wrap
+			for(int j = 0; j < iov_count; j++) {
+				const uint8_t* bytes = static_cast<const uint8_t*>(iov[j].iov_base);
+				for(size_t offset = 0; offset + sizeof(TraceRecord) <= iov[j].iov_len; offset += sizeof(TraceRecord)) {
+					TraceRecord record;
+					memcpy(&record, bytes + offset, sizeof(record));
+					add(record, threshold);
+					result++;
+				}
+			}
+			m_rings[i]->consume(size);
+		}
+		return result;
+	}
+
+	inline const Log2Histogram& stage(unsigned stage) const noexcept {
+		assert(stage < TraceRecord::STAGES);
+		return m_stages[stage];
+	}
+
+	inline const Log2Histogram& total() const noexcept {
+		return m_total;
+	}
+
+	inline uint64_t tail_cycles(unsigned stage) const noexcept {
+		assert(stage < TraceRecord::STAGES);
+		return m_tail_cycles[stage];
+	}
+
+	inline uint64_t tail_samples() const noexcept {
+		return m_tail_samples;
+	}
+
+	/**
+	 * The histograms of the ticks: <prefix>_packet_cycles and <prefix>_<stage>_cycles of the recorded stages.
+	 */
+	void write(MetricsWriter& writer) const noexcept {
+		char buffer[32];
+		char name[64];
+		writer.histogram_of("packet_cycles", m_total);
+		for(unsigned i = 0; i < TraceRecord::STAGES; i++) {
+			if(m_stages[i].count()) {
+				snprintf(name, sizeof(name), "%s_cycles", stage_name(i, buffer, sizeof(buffer)));
+				writer.histogram_of(name, m_stages[i]);
+			}
+		}
+		writer.value("tail_samples", m_tail_samples);
+	}
+
+	/**
+	 * The table of the stages in nanoseconds, the quantiles are the upper bounds of the log2 buckets.
+	 */
+	void print(FILE* out) const noexcept {
+		char buffer[32];
+		fprintf(out, "%-12s %10s %10s %10s %10s %10s %10s %6s\n",
+		        "stage", "samples", "mean_ns", "p50_ns", "p90_ns", "p99_ns", "p99.9_ns", "tail%");
+		const uint64_t tail_total = sum(m_tail_cycles);
+		for(unsigned i = 0; i < TraceRecord::STAGES; i++) {
+			if(m_stages[i].count()) {
+				print_row(out, stage_name(i, buffer, sizeof(buffer)), m_stages[i],
+				          tail_total ? 100.0 * double(m_tail_cycles[i]) / double(tail_total) : 0.0);
+			}
+		}
+		print_row(out, "packet", m_total, tail_total ? 100.0 : 0.0);
+		fprintf(out, "tail_samples=%lu\n", (unsigned long)m_tail_samples);
+	}
+
+	/**
+	 * The folded stacks of the stage ticks, e.g. flamegraph.pl trace.folded > trace.svg.
+	 */
+	void write_folded(FILE* out) const noexcept {
+		char buffer[32];
+		for(unsigned i = 0; i < TraceRecord::STAGES; i++) {
+			if(m_stages[i].sum) {
+				fprintf(out, "packet;%s %lu\n", stage_name(i, buffer, sizeof(buffer)), (unsigned long)m_stages[i].sum);
+			}
+		}
+		for(unsigned i = 0; i < TraceRecord::STAGES; i++) {
+			if(m_tail_cycles[i]) {
+				fprintf(out, "tail;%s %lu\n", stage_name(i, buffer, sizeof(buffer)), (unsigned long)m_tail_cycles[i]);
+			}
+		}
+	}
+
+	void reset() noexcept {
+		for(unsigned i = 0; i < TraceRecord::STAGES; i++) {
+			m_stages[i] = Log2Histogram();
+			m_tail_cycles[i] = 0;
+		}
+		m_total = Log2Histogram();
+		m_tail_samples = 0;
+	}
+
+private:
+
+	static inline uint64_t sum(const uint64_t (&cycles)[TraceRecord::STAGES]) noexcept {
+		uint64_t result = 0;
+		for(unsigned i = 0; i < TraceRecord::STAGES; i++) {
+			result += cycles[i];
+		}
+		return result;
+	}
+
+	/**
+	 * @return the upper bound of the bucket of the tail quantile, 0 - no tail yet.
+	 */
+	inline uint64_t tail_threshold() const noexcept {
+		return m_total.count() < TAIL_SAMPLES_MIN ? 0 : m_total.quantile(m_tail_quantile);
+	}
+
+	inline void add(const TraceRecord& record, uint64_t threshold) noexcept {
+		const uint64_t total = record.total();
+		m_total.add(total);
+		const bool tail = threshold && total >= threshold;
+		m_tail_samples += tail;
+		for(unsigned i = 0; i < TraceRecord::STAGES; i++) {
+			if(record.stages & (1u << i)) {
+				m_stages[i].add(record.cycles[i]);
+				if(tail) {
+					m_tail_cycles[i] += record.cycles[i];
+				}
+			}
+		}
+	}
+
+	inline const char* stage_name(unsigned stage, char* buffer, size_t size) const noexcept {
+		if(m_names[stage])
+			return m_names[stage];
+
+		snprintf(buffer, size, "stage%u", stage);
+		return buffer;
+	}
+
+	inline uint64_t nanosec(uint64_t cycles) const noexcept {
+		return uint64_t(double(cycles) * 1e9 / double(m_hz));
+	}
+
+	void print_row(FILE* out, const char* name, const Log2Histogram& histogram, double tail) const noexcept {
+		const uint64_t count = histogram.count();
+		fprintf(out, "%-12s %10lu %10lu %10lu %10lu %10lu %10lu %6.1f\n", name, (unsigned long)count,
+		        (unsigned long)nanosec(count ? histogram.sum / count : 0),
+		        (unsigned long)nanosec(histogram.quantile(0.5)), (unsigned long)nanosec(histogram.quantile(0.9)),
+		        (unsigned long)nanosec(histogram.quantile(0.99)), (unsigned long)nanosec(histogram.quantile(0.999)),
+		        tail);
+	}
+};
+
+}; // namespace utils
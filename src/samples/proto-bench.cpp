@@ -0,0 +1,104 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <proto/parsers/HeaderParser.h>
+#include <proto/parsers/StaticHeaderParser.h>
+
+using namespace proto;
+
+constexpr size_t PACKET_BYTES = 64;
+
+/**
+ * Ethernet -> VLAN -> IPv4 -> UDP frames of PACKET_BYTES with different ports.
+ */
+static std::vector<uint8_t> make_packets(size_t count) noexcept(false) {
+	std::vector<uint8_t> result(count * PACKET_BYTES, 0);
+	for(size_t i = 0; i < count; i++) {
+		uint8_t* pkt = &result[i * PACKET_BYTES];
+		const uint16_t eth_vlan = htons(ETH_P_8021Q);
+		memcpy(pkt + 12, &eth_vlan, sizeof(eth_vlan));
+		const uint16_t tci = htons(uint16_t(i & 0x0FFF));
+		const uint16_t vlan_ip = htons(ETH_P_IP);
+		memcpy(pkt + 14, &tci, sizeof(tci));
+		memcpy(pkt + 16, &vlan_ip, sizeof(vlan_ip));
+
+		IPv4::Header ip;
+		memset(&ip, 0, sizeof(ip));
+		ip.version = 4;
+		ip.ihl = 5;
+		ip.tot_len = htons(uint16_t(PACKET_BYTES - 18));
+		ip.ttl = 64;
+		ip.protocol = IPv4::PROTO_UDP;
+		ip.saddr = IPv4::addr_net(10, 0, 0, 1);
+		ip.daddr = IPv4::addr_net(10, 0, 0, 2);
+		memcpy(pkt + 18, &ip, sizeof(ip));
+
+		Udp::Header udp;
+		memset(&udp, 0, sizeof(udp));
+		udp.source = htons(uint16_t(1024 + i % 60000));
+		udp.dest = htons(53);
+		udp.len = htons(uint16_t(PACKET_BYTES - 18 - sizeof(ip)));
+		memcpy(pkt + 38, &udp, sizeof(udp));
+	}
+	return result;
+}
+
+template <typename Parser>
+static uint64_t walk(const std::vector<uint8_t>& packets) noexcept {
+	uint64_t result = 0;
+	for(size_t offset = 0; offset < packets.size(); offset += PACKET_BYTES) {
+		Parser hp(&packets[offset], PACKET_BYTES);
+		while(hp.protocol() != END) {
+			if(hp.protocol() == L4_UDP) {
+				const Udp::Header* hdr = nullptr;
+				hp.assign(hdr);
+				result += hdr->source;
+			}
+			hp.next();
+		}
+	}
+	return result;
+}
+
+/**
+ * The best round is taken, so the other load of the machine doesn't spoil the comparison.
+ */
+template <typename Parser>
+static void bench(const char* name, const std::vector<uint8_t>& packets, unsigned rounds) noexcept {
+	const double count = double(packets.size() / PACKET_BYTES);
+	uint64_t check = 0;
+	double best = 0;
+	for(unsigned round = 0; round < rounds; round++) {
+		const auto start = std::chrono::steady_clock::now();
+		check += walk<Parser>(packets);
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		if(round == 0 || seconds < best) {
+			best = seconds;
+		}
+	}
+	printf("%-28s %8.2f ns/packet %8.2f Mpps (check %llu)\n",
+		name, best * 1e9 / count, count / best / 1e6, (unsigned long long)check);
+}
+
+int main(int argc, char** argv) {
+	const size_t count = argc > 1 ? strtoul(argv[1], nullptr, 10) : 1024 * 1024;
+	const unsigned rounds = argc > 2 ? unsigned(strtoul(argv[2], nullptr, 10)) : 10;
+	if(count == 0 || rounds == 0) {
+		printf("qlibs::proto parser benchmark\n");
+		printf("usage: %s [packets] [rounds]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	const std::vector<uint8_t> packets = make_packets(count);
+	printf("%zu packets of %zu bytes (Ethernet/VLAN/IPv4/UDP), %u rounds\n", count, PACKET_BYTES, rounds);
+
+	bench<HeaderParser>("HeaderParser", packets, rounds);
+	bench<SafeHeaderParser>("SafeHeaderParser", packets, rounds);
+	bench<StaticHeaderParser<Ethernet, Vlan, IPv4, Udp> >("StaticHeaderParser", packets, rounds);
+	bench<SafeStaticHeaderParser<Ethernet, Vlan, IPv4, Udp> >("SafeStaticHeaderParser", packets, rounds);
+
+	printf("<---- the end of main() ---->\n");
+	return EXIT_SUCCESS;
+}
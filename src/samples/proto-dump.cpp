@@ -1,6 +1,7 @@
 #include <cstdio>
 #include <cstdlib>
-#include <pcapwrap/Reader.h>
+#include <string>
+#include <pcapwrap/MappedReader.h>
 #include <pcapwrap/Writer.h>
 #include <pcapwrap/Dumper.h>
 #include <proto/parsers/HeaderParser.h>
@@ -56,20 +57,44 @@ bool process(pcapwrap::Frame& frame) noexcept {
 }
 
 int main(int argc, char** argv) {
-	if(argc < 2) {
+	int first = 1;
+	bool records = false;
+	pcapwrap::Dumper::Format format = pcapwrap::Dumper::TEXT;
+	if(argc > 1 && (std::string(argv[1]) == "--csv" || std::string(argv[1]) == "--json")) {
+		records = true;
+		format = std::string(argv[1]) == "--csv" ? pcapwrap::Dumper::CSV : pcapwrap::Dumper::JSON;
+		first++;
+	}
+	if(argc <= first) {
 		printf("qlibs::proto sample application\n");
-		printf("usage: %s <pcap-file(s)>\n", argv[0]);
+		printf("usage: %s [--csv|--json] <pcap-file(s)>\n", argv[0]);
 		return EXIT_FAILURE;
 	}
 
-	std::string fin = argv[1];
-	auto reader = pcapwrap::Reader::open(fin);
-	pcapwrap::Frame frame;
-	while(reader.next(frame)) {
-		pcapwrap::Dumper::frame(stdout, frame);
-		process(frame);
+	if(format == pcapwrap::Dumper::CSV) {
+		pcapwrap::Dumper::csv_header(stdout);
+	}
+	for(int file = first; file < argc; file++) {
+		auto reader = pcapwrap::MappedReader::open(argv[file]);
+		pcapwrap::Frame frames[32];
+		size_t burst = 0;
+		while((burst = reader.next_burst(frames, 32))) {
+			for(size_t i = 0; i < burst; i++) {
+				if(records) {
+					pcapwrap::Dumper::record(stdout, frames[i], format);
+					continue;
+				}
+				pcapwrap::Dumper::frame(stdout, frames[i]);
+				process(frames[i]);
+			}
+		}
+		if(reader.truncated()) {
+			fprintf(records ? stderr : stdout, "%s is truncated after %zu frames\n", argv[file], size_t(reader.frame_index()));
+		}
 	}
 
-	printf("<---- the end of main() ---->\n");
+	if(not records) {
+		printf("<---- the end of main() ---->\n");
+	}
 	return EXIT_SUCCESS;
 }
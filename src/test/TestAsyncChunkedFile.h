@@ -0,0 +1,220 @@
+#pragma once
+
+#include "test_environment.h"
+#include <utils/ChunkedFile.h>
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+class TestAsyncChunkedFile {
+	static constexpr unsigned LINES = 100000;
+	static constexpr size_t RING_BYTES = 4096;
+
+	char m_root[40];
+
+public:
+	TestAsyncChunkedFile() noexcept : m_root("/tmp/TestAsyncChunkedFile.XXXXXX") {
+		assert(mkdtemp(m_root));
+		case_0();
+		case_1();
+		case_2();
+		remove_files(m_root);
+	}
+
+private:
+
+	/**
+	 * The files under @dir in the order of their names, i.e. of their time.
+	 */
+	static void list_files(const std::string& dir, std::vector<std::string>& files) noexcept {
+		DIR* handle = opendir(dir.c_str());
+		assert(handle);
+		std::vector<std::string> names;
+		while(const struct dirent* entry = readdir(handle)) {
+			if(strcmp(entry->d_name, ".") && strcmp(entry->d_name, "..")) {
+				names.push_back(entry->d_name);
+			}
+		}
+		closedir(handle);
+		std::sort(names.begin(), names.end());
+		for(const std::string& name : names) {
+			const std::string path = dir + "/" + name;
+			struct stat st;
+			assert(stat(path.c_str(), &st) == 0);
+			if(S_ISDIR(st.st_mode)) {
+				list_files(path, files);
+			} else {
+				files.push_back(path);
+			}
+		}
+	}
+
+	static void remove_files(const std::string& dir) noexcept {
+		std::vector<std::string> files;
+		list_files(dir, files);
+		for(const std::string& file : files) {
+			unlink(file.c_str());
+		}
+		DIR* handle = opendir(dir.c_str());
+		assert(handle);
+		std::vector<std::string> dirs;
+		while(const struct dirent* entry = readdir(handle)) {
+			if(strcmp(entry->d_name, ".") && strcmp(entry->d_name, "..")) {
+				dirs.push_back(dir + "/" + entry->d_name);
+			}
+		}
+		closedir(handle);
+		for(const std::string& sub : dirs) {
+			rmdir(sub.c_str());
+		}
+		rmdir(dir.c_str());
+	}
+
+	/**
+	 * The bytes of all the files of the root, the files are removed.
+	 */
+	std::string take_files() noexcept {
+		std::vector<std::string> files;
+		list_files(m_root, files);
+		std::string result;
+		for(const std::string& file : files) {
+			FILE* in = fopen(file.c_str(), "rb");
+			assert(in);
+			char buffer[4096];
+			size_t bytes;
+			while((bytes = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+				result.append(buffer, bytes);
+			}
+			fclose(in);
+			unlink(file.c_str());
+		}
+		return result;
+	}
+
+	/**
+	 * SpscByteRing: the writes are all or none, the readable bytes wrap into two pieces, a thread reads them in order.
+	 */
+	void case_0() noexcept {
+		TRACE_CALL;
+		utils::SpscByteRing ring(100);
+		assert(ring.capacity() == 128 && not ring.allocated());
+		assert(ring.allocate() == 0 && ring.allocate() != 0);
+		uint8_t data[128];
+		for(size_t i = 0; i < sizeof(data); i++) {
+			data[i] = uint8_t(i);
+		}
+		struct iovec iov[2];
+		int iov_count = -1;
+		assert(ring.peek(iov, iov_count) == 0 && iov_count == 0);
+		assert(ring.write(data, 100) && not ring.write(data, 29));
+		assert(ring.peek(iov, iov_count) == 100 && iov_count == 1 && memcmp(iov[0].iov_base, data, 100) == 0);
+		ring.consume(100);
+		// the writes wrap, the last one fills the ring
+		assert(ring.write(data, 100) && ring.write(data + 100, 28));
+		assert(ring.size() == 128 && not ring.write(data, 1));
+		assert(ring.peek(iov, iov_count) == 128 && iov_count == 2);
+		assert(iov[0].iov_len == 28 && iov[1].iov_len == 100);
+		assert(memcmp(iov[0].iov_base, data, 28) == 0 && memcmp(iov[1].iov_base, data + 28, 100) == 0);
+		ring.consume(128);
+		assert(ring.size() == 0 && ring.peek(iov, iov_count) == 0);
+
+		// the bytes of the counter come in order through the wraps
+		const size_t total = 1 << 18;
+		std::thread consumer([&ring, total]() {
+			size_t next = 0;
+			while(next < total) {
+				struct iovec pieces[2];
+				int pieces_count;
+				const size_t size = ring.peek(pieces, pieces_count);
+				for(int p = 0; p < pieces_count; p++) {
+					const uint8_t* bytes = static_cast<const uint8_t*>(pieces[p].iov_base);
+					for(size_t i = 0; i < pieces[p].iov_len; i++) {
+						assert(bytes[i] == uint8_t(next++ * 7));
+					}
+				}
+				ring.consume(size);
+				if(size == 0) {
+					std::this_thread::yield();
+				}
+			}
+		});
+		for(size_t sent = 0; sent < total; ) {
+			uint8_t chunk[37];
+			const size_t size = total - sent < sizeof(chunk) ? total - sent : sizeof(chunk);
+			for(size_t i = 0; i < size; i++) {
+				chunk[i] = uint8_t((sent + i) * 7);
+			}
+			if(ring.write(chunk, size)) {
+				sent += size;
+			} else {
+				std::this_thread::yield();
+			}
+		}
+		consumer.join();
+		assert(ring.size() == 0);
+	}
+
+	/**
+	 * The lines which don't fit into the ring are dropped and counted, the taken ones are written in order.
+	 */
+	void case_1() noexcept {
+		TRACE_CALL;
+		std::string expected;
+		uint64_t dropped_writes = 0;
+		uint64_t dropped_bytes = 0;
+		{
+			utils::AsyncChunkedFile file(m_root, "drop_", "log", RING_BYTES);
+			assert(file.open() == 0 && file.open() != 0);
+			for(unsigned i = 0; i < LINES; i++) {
+				char line[32];
+				const int size = snprintf(line, sizeof(line), "line %u\n", i);
+				if(file.printf("line %u\n", i)) {
+					expected.append(line, size_t(size));
+				} else {
+					dropped_writes++;
+					dropped_bytes += size_t(size);
+				}
+			}
+			const std::string longest(RING_BYTES + 1, 'x');
+			assert(not file.write(longest.data(), longest.size()));
+			file.close();
+			assert(file.written_bytes() == expected.size() && file.errors() == 0 && file.waits() == 0);
+			assert(file.dropped_writes() == dropped_writes + 1 && file.dropped_bytes() == dropped_bytes + longest.size());
+			assert(dropped_writes > 0 && file.batches() > 0);
+		}
+		assert(take_files() == expected);
+	}
+
+	/**
+	 * The producer waits for the room in the backpressure mode, no line is dropped.
+	 */
+	void case_2() noexcept {
+		TRACE_CALL;
+		std::string expected;
+		{
+			utils::AsyncChunkedFile file(m_root, "wait_", "log", RING_BYTES, true);
+			assert(file.open() == 0);
+			for(unsigned i = 0; i < LINES; i++) {
+				char line[32];
+				const int size = snprintf(line, sizeof(line), "line %u\n", i);
+				expected.append(line, size_t(size));
+				assert(file.write(line, size_t(size)));
+			}
+			const std::string longest(RING_BYTES + 1, 'x');
+			assert(not file.write(longest.data(), longest.size()));
+			file.close();
+			assert(file.written_bytes() == expected.size() && file.errors() == 0);
+			assert(file.dropped_writes() == 1 && file.dropped_bytes() == longest.size());
+			assert(file.waits() > 0 && file.batches() > 1);
+		}
+		assert(take_files() == expected);
+	}
+};
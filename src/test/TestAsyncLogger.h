@@ -0,0 +1,178 @@
+#pragma once
+
+#include "test_environment.h"
+#include <logger/AsyncLogger.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+class TestAsyncLogger {
+	static constexpr unsigned THREADS = 4;
+	static constexpr unsigned RECORDS = 2000; // per thread
+
+public:
+	TestAsyncLogger() noexcept {
+		case_0();
+		case_1();
+		case_2();
+	}
+
+private:
+
+	static AsyncLogger& logger() noexcept {
+		return AsyncLogger::instance();
+	}
+
+	static std::vector<std::string> lines(FILE* file) noexcept {
+		std::vector<std::string> result;
+		rewind(file);
+		std::string line;
+		int c;
+		while((c = fgetc(file)) != EOF) {
+			if(c == '\n') {
+				result.push_back(line);
+				line.clear();
+			} else {
+				line.push_back(char(c));
+			}
+		}
+		if(not line.empty()) {
+			result.push_back(line);
+		}
+		return result;
+	}
+
+	/**
+	 * The conversions are formatted by the printf() rules with the kept arguments, the levels have their prefixes.
+	 */
+	void case_0() noexcept {
+		TRACE_CALL;
+		assert(not logger().running());
+		assert(not logger().log(AsyncLogger::RAW, __FUNCTION__, __FILE__, __LINE__, "not taken"));
+		assert(logger().start(nullptr) != 0);
+		FILE* file = tmpfile();
+		assert(file);
+		assert(logger().start(file) == 0);
+		assert(logger().start(file) != 0 && logger().running());
+
+		const std::string text("a string");
+		const char* none = nullptr;
+		const uint8_t byte = 200;
+		const int64_t negative = -5000000000ll;
+		assert(logger().log(AsyncLogger::RAW, __FUNCTION__, __FILE__, __LINE__, "%d %u %s %5.2f %x %c %%",
+			-7, 7u, "str", 3.14159, 255, 'z'));
+		logger().log(AsyncLogger::RAW, __FUNCTION__, __FILE__, __LINE__, "%hhu %hd %lld %zu %lu", 300, 70000, negative,
+			size_t(42), byte);
+		logger().log(AsyncLogger::RAW, __FUNCTION__, __FILE__, __LINE__, "[%*d] [%-4s] [%.3s]", 5, 12, "ab", text);
+		logger().log(AsyncLogger::RAW, __FUNCTION__, __FILE__, __LINE__, "%s %d %s", none, 1);
+		logger().log(AsyncLogger::TEXT, __FUNCTION__, __FILE__, __LINE__, "text ");
+		logger().log(AsyncLogger::TEXT, __FUNCTION__, __FILE__, __LINE__, "and more\n");
+		logger().log(AsyncLogger::INFO, "function", "file.cpp", 10, "info %u", 1u);
+		logger().log(AsyncLogger::CRITICAL, "function", "file.cpp", 11, "critical");
+		logger().log(AsyncLogger::DEBUG, "function", "file.cpp", 12, "debug %s", text);
+		logger().log(AsyncLogger::RAW, __FUNCTION__, __FILE__, __LINE__, "%p %p", reinterpret_cast<void*>(0x1234), nullptr);
+		logger().stop();
+		assert(not logger().running());
+
+		const std::vector<std::string> result = lines(file);
+		char pointer[64];
+		snprintf(pointer, sizeof(pointer), "%p %p", reinterpret_cast<void*>(0x1234), static_cast<void*>(nullptr));
+		assert(result.size() == 9);
+		assert(result[0] == "-7 7 str  3.14 ff z %");
+		assert(result[1] == "44 4464 -5000000000 42 200");
+		assert(result[2] == "[   12] [ab  ] [a s]");
+		assert(result[3] == "(null) 1 %s");
+		assert(result[4] == "text and more");
+		assert(result[5] == "[info] function() file.cpp:10 info 1");
+		assert(result[6] == "[critical] function() file.cpp:11 critical");
+		assert(result[7] == "[debug] function() file.cpp:12 debug a string");
+		assert(result[8] == pointer);
+		fclose(file);
+	}
+
+	/**
+	 * The records of the threads are merged by their time, so the records of every thread stay in order.
+	 */
+	void case_1() noexcept {
+		TRACE_CALL;
+		FILE* file = tmpfile();
+		assert(file);
+		const AsyncLoggerStat before = logger().stat();
+		assert(logger().start(file) == 0);
+		std::vector<std::thread> threads;
+		for(unsigned t = 0; t < THREADS; t++) {
+			threads.emplace_back([t]() {
+				for(unsigned i = 0; i < RECORDS; i++) {
+					logger().log(AsyncLogger::RAW, __FUNCTION__, __FILE__, __LINE__, "%u %u", t, i);
+				}
+			});
+		}
+		for(std::thread& thread : threads) {
+			thread.join();
+		}
+		logger().stop();
+
+		const AsyncLoggerStat stat = logger().stat();
+		assert(stat.logged - before.logged == THREADS * RECORDS && stat.dropped == before.dropped);
+		assert(stat.written - before.written == THREADS * RECORDS && stat.batches > before.batches);
+		unsigned next[THREADS] = {};
+		for(const std::string& line : lines(file)) {
+			unsigned t, i;
+			assert(sscanf(line.c_str(), "%u %u", &t, &i) == 2);
+			assert(t < THREADS && i == next[t]);
+			next[t]++;
+		}
+		for(unsigned t = 0; t < THREADS; t++) {
+			assert(next[t] == RECORDS);
+		}
+		fclose(file);
+	}
+
+	/**
+	 * A record longer than the ring is dropped and the drop is reported, a string is cut to RECORD_BYTES.
+	 */
+	void case_2() noexcept {
+		TRACE_CALL;
+		FILE* file = tmpfile();
+		assert(file);
+		const AsyncLoggerStat before = logger().stat();
+		const std::string text(2 * AsyncLogger::RECORD_BYTES, 'x');
+		// the threads of case_1() have freed their rings, one more thread takes a new ring of this start()
+		assert(logger().start(file, 512) == 0);
+		std::atomic<unsigned> ready(0);
+		std::vector<std::thread> threads;
+		for(unsigned t = 0; t < THREADS + 1; t++) {
+			threads.emplace_back([&text, &ready]() {
+				logger().log(AsyncLogger::RAW, __FUNCTION__, __FILE__, __LINE__, "%s", text);
+				logger().log(AsyncLogger::RAW, __FUNCTION__, __FILE__, __LINE__, "short");
+				// no ring is freed until every thread has taken one
+				ready++;
+				while(ready.load() < THREADS + 1) {
+					std::this_thread::yield();
+				}
+			});
+		}
+		for(std::thread& thread : threads) {
+			thread.join();
+		}
+		logger().stop();
+
+		const AsyncLoggerStat stat = logger().stat();
+		assert(stat.dropped - before.dropped == 1 && stat.logged - before.logged == 2 * (THREADS + 1) - 1);
+		size_t reported = 0;
+		size_t cut = 0;
+		size_t short_lines = 0;
+		for(const std::string& line : lines(file)) {
+			reported += line == "[critical] AsyncLogger: 1 records have been dropped";
+			cut += line.size() > AsyncLogger::RECORD_BYTES / 2 && line.size() < AsyncLogger::RECORD_BYTES
+				&& line.find_first_not_of('x') == std::string::npos;
+			short_lines += line == "short";
+		}
+		assert(reported == 1 && cut == THREADS && short_lines == THREADS + 1);
+		fclose(file);
+	}
+};
@@ -4,6 +4,9 @@
 #include "test_environment.h"
 #include <containers/BitArrayT.h>
 
+#include <chrono>
+#include <cstdlib>
+
 template <uint8_t Width>
 class TestBitArrayTInternal {
 	BitArrayT<Width> m_bat;
@@ -22,13 +25,15 @@ public:
 		m_bat.allocate(capacity);
 		store_load_seq(step++);
 		store_load_rnd(step++);
+		store_load_range(step++);
+		fill_value(step++);
 //		perf(99 * 1000 * 1000);
 	}
 
 private:
 
 	void store_load_seq(unsigned step) {
-		TRACE_CALL_CPP;
+		TRACE_CALL;
 		const auto range = m_bat.range();
 		const auto item_nb = m_bat.items_capacity();
 		assert(range);
@@ -58,7 +63,7 @@ private:
 	}
 
 	void store_load_rnd(unsigned step) {
-		TRACE_CALL_CPP;
+		TRACE_CALL;
 		const auto range = m_bat.range();
 		const auto item_nb = m_bat.items_capacity();
 		assert(range);
@@ -90,28 +95,86 @@ private:
 		assert(sum_in == sum_out);
 	}
 
+	void store_load_range(unsigned step) {
+		TRACE_CALL;
+		const auto range = m_bat.range();
+		const auto item_nb = m_bat.items_capacity();
+		assert(range);
+		assert(item_nb);
+
+		BitArrayTChunk_t* values = new BitArrayTChunk_t[item_nb];
+		BitArrayTChunk_t* loaded = new BitArrayTChunk_t[item_nb];
+
+		// the whole array is stored by the items and loaded by the range
+		m_bat.fill(0);
+		for(size_t i = 0; i < item_nb; ++i) {
+			values[i] = (i * 7 + step) % range;
+			m_bat.store(i, values[i]);
+		}
+		m_bat.load_range(0, item_nb, loaded);
+		for(size_t i = 0; i < item_nb; ++i) {
+			assert(loaded[i] == values[i]);
+		}
+
+		// the ranges which start and end inside the periods keep their neighbours
+		const size_t offsets[] = {0, 1, 3, 17, item_nb / 3};
+		for(size_t offset : offsets) {
+			if(offset >= item_nb)
+				continue;
+			const size_t number = (item_nb - offset) / 2 + 1;
+			for(size_t i = 0; i < number; ++i) {
+				values[offset + i] = (values[offset + i] + 1) % range;
+			}
+			m_bat.store_range(offset, number, values + offset);
+			for(size_t i = 0; i < item_nb; ++i) {
+				assert(m_bat.load(i) == values[i]);
+			}
+			m_bat.load_range(offset, number, loaded);
+			for(size_t i = 0; i < number; ++i) {
+				assert(loaded[i] == values[offset + i]);
+			}
+		}
+		m_bat.load_range(item_nb, 0, loaded);
+		m_bat.store_range(item_nb, 0, values);
+
+		delete[] values;
+		delete[] loaded;
+	}
+
+	void fill_value(unsigned step) {
+		TRACE_CALL;
+		const auto item_nb = m_bat.items_capacity();
+		const BitArrayTChunk_t fills[] = {0, m_bat.value_max(), (step * 5) % m_bat.range(), 1};
+		for(auto value : fills) {
+			m_bat.fill(value);
+			for(size_t i = 0; i < item_nb; ++i) {
+				assert(m_bat.load(i) == value);
+			}
+		}
+	}
+
 	void perf(size_t rounds) {
-		TRACE_CALL_CPP;
-		char buffer[999];
-		const size_t buffer_nb = sizeof(buffer) / sizeof(*buffer);
+		TRACE_CALL;
+		BitArrayTChunk_t buffer[999 / sizeof(BitArrayTChunk_t)];
 
-		BitArrayT<Width> barray(buffer, buffer_nb);
+		BitArrayT<Width> barray;
+		barray.allocate(buffer, sizeof(buffer));
 		barray.fill(0);
-		const BitArrayChunk_t range = barray.range();
+		const BitArrayTChunk_t range = barray.range();
 
-		uint64_t before = rdtsc();
+		const auto before = std::chrono::steady_clock::now();
 		uint64_t sum = 0;
 		for(size_t i = 0; i < rounds; ++i){
 			const size_t index = i % barray.items_capacity();
-			const BitArrayChunk_t val = barray.load(index);
+			const BitArrayTChunk_t val = barray.load(index);
 			barray.store(index, (val + 1) % range);
 			sum += val;
 		}
-		uint64_t spent = rdtsc() - before;
+		const double spent = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - before).count();
 		printf("width=%u", Width);
 		printf(" rounds=%zu", rounds);
 		printf(" sum=0x%zx\n", sum);
-		printf("perf=%f clocks per one store/load\n\n", spent / double(rounds));
+		printf("perf=%f ns per one store/load\n\n", spent / double(rounds));
 	}
 
 };
@@ -123,6 +186,7 @@ public:
 		TestBitArrayTInternal<3> bit_arrayt3(capacity);
 		TestBitArrayTInternal<4> bit_arrayt4(capacity);
 		TestBitArrayTInternal<5> bit_arrayt5(capacity);
+		TestBitArrayTInternal<12> bit_arrayt12(capacity);
 		TestBitArrayTInternal<15> bit_arrayt15(capacity);
 		TestBitArrayTInternal<16> bit_arrayt16(capacity);
 		TestBitArrayTInternal<31> bit_arrayt31(capacity);
@@ -0,0 +1,179 @@
+#pragma once
+
+#include "test_environment.h"
+#include <tio/BlockTokenizer.h>
+#include <tio/CharClassifier.h>
+#include <tio/stream/ArrayInputStream.h>
+#include <tio/stream/FileInputStream.h>
+#include <tio/stream/MappedFileInputStream.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+class TestBlockTokenizer {
+	enum CClassId : tio::BlockClassifier::CharClassId {
+		EOS,
+		UNKNOWN,
+		SEPARATOR,
+		OPERATOR,
+		TKN_MODULE,
+		TKN_INPUT,
+		TKN_WIRE
+	};
+
+	static constexpr const char* TEXT = "module RsNor(input wire Set, output wire Q);\n"
+		"  // a=b/c; /*neither_it_does*/\n  wire nQ;\nendmodule";
+
+public:
+	TestBlockTokenizer() noexcept {
+		case_0();
+		case_1();
+		case_2();
+		case_3();
+	}
+
+private:
+
+	template<typename T>
+	static void setup(T& classifier) noexcept {
+		classifier.classify(SEPARATOR, " ;,\t\n", true);
+		classifier.classify(OPERATOR, "=/*()", true);
+	}
+
+	/**
+	 * The chunks of @stream are the same as the ones of CharClassifier over the text.
+	 */
+	static void check_chunks(tio::BlockInputStream& stream, bool trace) noexcept {
+		tio::ArrayInputStream ais(TEXT);
+		tio::CharClassifier ccf(&ais, EOS, UNKNOWN, true);
+		setup(ccf);
+		tio::BlockClassifier bcf(&stream, EOS, UNKNOWN, true);
+		setup(bcf);
+
+		tio::CharClassifier::CharClassId id;
+		do {
+			id = ccf.next();
+			assert(bcf.next() == id);
+			const auto view = bcf.view();
+			if(trace) {
+				printf("%u '%.*s'\n", id, int(view.length), view.data);
+			}
+			assert(view.length == strlen(ccf.cstring()));
+			assert(memcmp(view.data, ccf.cstring(), view.length) == 0);
+		} while(id != EOS);
+		assert(bcf.next() == EOS);
+	}
+
+	void case_0() noexcept {
+		TRACE_CALL;
+		tio::ArrayInputStream ais(TEXT);
+		check_chunks(ais, false);
+
+		const char* const text = TEXT;
+		tio::BlockClassifier bcf(&ais, EOS, UNKNOWN, true);
+		assert(bcf.next() == EOS);
+		tio::ArrayInputStream ais_array(text, 6);
+		tio::BlockClassifier bcf_array(&ais_array, EOS, UNKNOWN, true);
+		assert(bcf_array.next() == UNKNOWN);
+		assert(bcf_array.view().length == 6); // the last chunk of the block
+		assert(bcf_array.next() == EOS);
+
+		// the chunks inside the block are not copied
+		tio::ArrayInputStream ais_view(text);
+		tio::BlockClassifier bcf_view(&ais_view, EOS, UNKNOWN, true);
+		setup(bcf_view);
+		assert(bcf_view.next() == UNKNOWN);
+		assert(bcf_view.view().data == text);
+		assert(bcf_view.next() == SEPARATOR);
+		assert(bcf_view.view().data == text + 6);
+	}
+
+	void case_1() noexcept {
+		TRACE_CALL;
+		FILE* file = tmpfile();
+		assert(file);
+		fputs(TEXT, file);
+		for(const size_t buffer_size : {1, 2, 3, 7, 64, 4096}) {
+			rewind(file);
+			tio::FileInputStream fis(file, buffer_size);
+			check_chunks(fis, false);
+		}
+		fclose(file);
+
+		char file_name[] = "/tmp/TestBlockTokenizer.XXXXXX";
+		const int fd = mkstemp(file_name);
+		assert(fd >= 0);
+		assert(write(fd, TEXT, strlen(TEXT)) == ssize_t(strlen(TEXT)));
+		close(fd);
+		{
+			tio::MappedFileInputStream mfis(file_name);
+			assert(mfis.size() == strlen(TEXT));
+			check_chunks(mfis, false);
+		}
+		unlink(file_name);
+
+		bool thrown = false;
+		try {
+			tio::MappedFileInputStream mfis(file_name);
+		} catch(const std::runtime_error&) {
+			thrown = true;
+		}
+		assert(thrown);
+	}
+
+	void case_2() noexcept {
+		TRACE_CALL;
+		tio::ArrayInputStream ais("module RsNor(input wire Set)");
+		tio::BlockTokenizer btk(&ais, EOS, UNKNOWN, true);
+		btk.classify(SEPARATOR, " \n\t", true);
+		btk.classify(OPERATOR, "(),;", false);
+
+		btk.tokenize(TKN_MODULE, "module");
+		btk.tokenize(TKN_INPUT, "input");
+		btk.tokenize(TKN_WIRE, "wire");
+
+		for(const auto token : {
+			TKN_MODULE, SEPARATOR, UNKNOWN, OPERATOR, TKN_INPUT, SEPARATOR,
+			TKN_WIRE, SEPARATOR, UNKNOWN, OPERATOR, EOS
+		}) {
+			assert(btk.next_token() == token);
+		}
+	}
+
+	/**
+	 * The long runs of the classes which are scanned by CharSet and of the ones which are scanned by the scalar loop.
+	 */
+	void case_3() noexcept {
+		TRACE_CALL;
+		std::string text;
+		for(size_t i = 1; i < 80; i++) {
+			text += std::string(i % 23 + 1, " \t;"[i % 3]);
+			text += std::string(i, "azAZ09=("[i % 8]);
+		}
+		for(const size_t buffer_size : {5, 16, 17, 4096}) {
+			tio::ArrayInputStream ais(text.c_str());
+			tio::CharClassifier ccf(&ais, EOS, UNKNOWN, true);
+			FILE* file = tmpfile();
+			assert(file);
+			fputs(text.c_str(), file);
+			rewind(file);
+			tio::FileInputStream fis(file, buffer_size);
+			tio::BlockClassifier bcf(&fis, EOS, UNKNOWN, true);
+			ccf.classify(SEPARATOR, " \t;", true);
+			bcf.classify(SEPARATOR, " \t;", true);
+			ccf.classify(OPERATOR, "0123456789=(ABCDEFGHIJKLMNOPQRSTUVWXYZ", true); // over CharSet::CAPACITY
+			bcf.classify(OPERATOR, "0123456789=(ABCDEFGHIJKLMNOPQRSTUVWXYZ", true);
+
+			tio::CharClassifier::CharClassId id;
+			do {
+				id = ccf.next();
+				assert(bcf.next() == id);
+				assert(std::string(bcf.view().data, bcf.view().length) == ccf.cstring());
+			} while(id != EOS);
+			fclose(file);
+		}
+	}
+
+};
@@ -0,0 +1,153 @@
+#pragma once
+
+#include "test_environment.h"
+#include <pcapwrap/BufferedWriter.h>
+#include <pcapwrap/MappedReader.h>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+class TestBufferedWriter {
+	using BufferedWriter = pcapwrap::BufferedWriter;
+
+	static constexpr uint32_t FRAMES = 2000; // of 1 MB about, so the buffer is flushed several times
+
+	char m_file_name[32];
+	std::vector<uint8_t> m_data;
+
+public:
+	TestBufferedWriter() noexcept : m_file_name("/tmp/TestBufferedWriter.XXXXXX"), m_data(BufferedWriter::BUFFER_BYTES_MIN * 2) {
+		const int fd = mkstemp(m_file_name);
+		assert(fd >= 0);
+		close(fd);
+		for(size_t i = 0; i < m_data.size(); i++) {
+			m_data[i] = uint8_t(i * 31 + (i >> 8));
+		}
+		case_0();
+		case_1();
+		case_2();
+		unlink(m_file_name);
+	}
+
+private:
+
+	/**
+	 * The frame @i of the data from the offset @i, of 1..1000 bytes.
+	 */
+	pcapwrap::Frame frame(uint32_t i) const noexcept {
+		pcapwrap::Frame result;
+		result.m_hdr.caplen = 1 + i * 7919 % 1000;
+		result.m_hdr.len = result.m_hdr.caplen + (i % 5 ? 0 : 100);
+		result.nanosec(uint64_t(1600000000) * 1000000000 + uint64_t(i) * 1000003);
+		result.m_data = m_data.data() + i;
+		return result;
+	}
+
+	size_t file_bytes() const noexcept {
+		struct stat st;
+		assert(stat(m_file_name, &st) == 0);
+		return size_t(st.st_size);
+	}
+
+	/**
+	 * The frames are read back by MappedReader as they have been written.
+	 */
+	void read_back(uint32_t frames) const noexcept {
+		pcapwrap::MappedReader reader = pcapwrap::MappedReader::open(m_file_name);
+		assert(reader.linktype() == DLT_EN10MB && reader.snaplen() == BufferedWriter::SNAPSHOT_LEN);
+		pcapwrap::Frame read;
+		for(uint32_t i = 0; i < frames; i++) {
+			const pcapwrap::Frame written = frame(i);
+			assert(reader.next(read));
+			assert(read.m_idx == i + 1 && read.nanosec() == written.nanosec());
+			assert(read.m_hdr.caplen == written.m_hdr.caplen && read.m_hdr.len == written.m_hdr.len);
+			assert(memcmp(read.m_data, written.m_data, written.m_hdr.caplen) == 0);
+		}
+		assert(not reader.next(read) && not reader.truncated());
+	}
+
+	static size_t records_bytes(uint32_t frames) noexcept {
+		size_t result = 24;
+		for(uint32_t i = 0; i < frames; i++) {
+			result += 16 + 1 + i * 7919 % 1000;
+		}
+		return result;
+	}
+
+	/**
+	 * The buffer is written when it is full and by flush(), close() writes the rest.
+	 */
+	void case_0() noexcept {
+		TRACE_CALL;
+		{
+			BufferedWriter writer = BufferedWriter::open(m_file_name, 0);
+			for(uint32_t i = 0; i < FRAMES / 2; i++) {
+				writer.write(frame(i));
+			}
+			std::vector<pcapwrap::Frame> frames;
+			for(uint32_t i = FRAMES / 2; i < FRAMES; i++) {
+				frames.push_back(frame(i));
+			}
+			writer.write_bulk(frames.data(), frames.size());
+			assert(writer.frame_index() == FRAMES && writer.error() == 0);
+			assert(writer.bytes() > 0 && writer.bytes() < records_bytes(FRAMES));
+			assert(file_bytes() == writer.bytes());
+			assert(writer.flush() == 0 && writer.bytes() == records_bytes(FRAMES));
+			writer.write(frame(FRAMES));
+			// a move keeps the buffered frame
+			BufferedWriter moved(std::move(writer));
+			assert(moved.frame_index() == FRAMES + 1 && moved.close() == 0);
+		}
+		assert(file_bytes() == records_bytes(FRAMES + 1));
+		read_back(FRAMES + 1);
+	}
+
+	/**
+	 * O_DIRECT writes the whole ALIGN blocks only, close() writes the tail.
+	 */
+	void case_1() noexcept {
+		TRACE_CALL;
+		BufferedWriter writer = BufferedWriter::open(m_file_name, 0);
+		try {
+			writer = BufferedWriter::open(m_file_name, 0, 0, true);
+		} catch(const std::runtime_error& e) {
+			printf("O_DIRECT is not supported: %s\n", e.what()); // e.g. tmpfs
+			return;
+		}
+		for(uint32_t i = 0; i < FRAMES; i++) {
+			writer.write(frame(i));
+		}
+		assert(writer.bytes() > 0 && writer.bytes() % BufferedWriter::ALIGN == 0);
+		assert(writer.flush() == 0 && writer.error() == 0);
+		assert(writer.bytes() % BufferedWriter::ALIGN == 0);
+		assert(records_bytes(FRAMES) - writer.bytes() < BufferedWriter::ALIGN);
+		assert(file_bytes() == writer.bytes());
+		assert(writer.close() == 0);
+		assert(file_bytes() == records_bytes(FRAMES));
+		read_back(FRAMES);
+	}
+
+	/**
+	 * A frame longer than the buffer less ALIGN is dropped, the flushes by the time.
+	 */
+	void case_2() noexcept {
+		TRACE_CALL;
+		BufferedWriter writer = BufferedWriter::open(m_file_name, 0, 1);
+		writer.write(frame(0));
+		pcapwrap::Frame longest = frame(1);
+		longest.m_hdr.caplen = uint32_t(BufferedWriter::BUFFER_BYTES_MIN - BufferedWriter::ALIGN);
+		longest.m_hdr.len = longest.m_hdr.caplen;
+		writer.write(longest);
+		assert(writer.frame_index() == 1);
+		usleep(10000); // past flush_ms by the coarse clock
+		writer.write(frame(1));
+		assert(writer.frame_index() == 2 && writer.bytes() == records_bytes(2));
+		assert(writer.close() == 0 && writer.close() == 0);
+		read_back(2);
+	}
+};
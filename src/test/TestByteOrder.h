@@ -0,0 +1,96 @@
+#pragma once
+
+#include "test_environment.h"
+#include <utils/ByteOrder.h>
+#include <proto/procotols/IPv4.h>
+#include <proto/mframe/MFrame.h>
+
+#include <cstring>
+
+class TestByteOrder {
+	using ByteOrder = utils::ByteOrder;
+
+	static_assert(ByteOrder::bswap16(0x1234) == 0x3412, "bswap16");
+	static_assert(ByteOrder::bswap32(0x12345678u) == 0x78563412u, "bswap32");
+	static_assert(ByteOrder::bswap64(0x0102030405060708ull) == 0x0807060504030201ull, "bswap64");
+	static_assert(ByteOrder::be16_to_cpu(ByteOrder::cpu_to_be16(0xABCD)) == 0xABCD, "be16");
+	static_assert(ByteOrder::cpu_to_be32(0x0A000001u) == ByteOrder::ct_cpu_to_be32(0x0A000001u), "be32");
+
+public:
+	TestByteOrder() noexcept {
+		case_0();
+		case_1();
+		case_2();
+	}
+
+private:
+
+	/**
+	 * The loads and the stores at every alignment.
+	 */
+	void case_0() noexcept {
+		TRACE_CALL;
+		uint8_t data[24];
+		for(unsigned i = 0; i < sizeof(data); i++) {
+			data[i] = uint8_t(i + 1);
+		}
+		for(unsigned offset = 0; offset < 8; offset++) {
+			const uint8_t* ptr = data + offset;
+			const uint16_t v16 = uint16_t((ptr[0] << 8) | ptr[1]);
+			const uint32_t v32 = (uint32_t(ptr[0]) << 24) | (uint32_t(ptr[1]) << 16) | (uint32_t(ptr[2]) << 8) | ptr[3];
+			const uint64_t v64 = (uint64_t(v32) << 32) | ((uint32_t(ptr[4]) << 24) | (uint32_t(ptr[5]) << 16)
+				| (uint32_t(ptr[6]) << 8) | ptr[7]);
+			assert(ByteOrder::load_be16(ptr) == v16);
+			assert(ByteOrder::load_be32(ptr) == v32);
+			assert(ByteOrder::load_be64(ptr) == v64);
+			assert(ByteOrder::load<uint32_t>(ptr) == ByteOrder::cpu_to_be32(v32));
+
+			uint8_t copy[sizeof(data)] = {0};
+			ByteOrder::store_be64(copy + offset, v64);
+			assert(memcmp(copy + offset, ptr, 8) == 0);
+			ByteOrder::store_be32(copy + offset + 8, v32);
+			assert(memcmp(copy + offset + 8, ptr, 4) == 0);
+			ByteOrder::store_be16(copy + offset + 12, v16);
+			assert(memcmp(copy + offset + 12, ptr, 2) == 0);
+		}
+	}
+
+	/**
+	 * The header accessors over the fields which are written by the byte stores.
+	 */
+	void case_1() noexcept {
+		TRACE_CALL;
+		proto::IPv4::Header header;
+		memset(&header, 0, sizeof(header));
+		uint8_t* const raw = reinterpret_cast<uint8_t*>(&header);
+		raw[0] = 0x45;
+		ByteOrder::store_be16(raw + 2, 1500);
+		ByteOrder::store_be16(raw + 6, IP_DF | 10);
+		const proto::IPv4::Header* hdr = reinterpret_cast<const proto::IPv4::Header*>(raw);
+		assert(proto::IPv4::pkt_len(hdr) == 1500);
+		assert(proto::IPv4::payload_len(hdr) == 1480);
+		assert(proto::IPv4::flag_df(hdr));
+		assert(not proto::IPv4::flag_mf(hdr));
+		assert(proto::IPv4::offset(hdr) == 80);
+	}
+
+	/**
+	 * MFrame reads and writes at an odd head.
+	 */
+	void case_2() noexcept {
+		TRACE_CALL;
+		uint8_t buffer[16] = {0};
+		proto::MFrame<uint8_t> pkt(buffer, sizeof(buffer));
+		pkt.head_move(1);
+		const uint32_t a = 0x01020304u;
+		const uint64_t b = 0x05060708090A0B0Cull;
+		pkt.write(a, b);
+		pkt.reset();
+		pkt.head_move(1);
+		uint32_t a_read = 0;
+		uint64_t b_read = 0;
+		pkt.read(a_read, b_read);
+		assert(a_read == a && b_read == b);
+		assert(memcmp(buffer + 1, &a, sizeof(a)) == 0);
+	}
+};
@@ -0,0 +1,234 @@
+#pragma once
+
+#include "test_environment.h"
+#include <proto/Checksum.h>
+#include <proto/procotols/IPv4.h>
+#include <proto/procotols/IPv6.h>
+
+#include <cstring>
+#include <vector>
+
+class TestChecksum {
+	using Checksum = proto::Checksum;
+	using IPv4 = proto::IPv4;
+	using IPv6 = proto::IPv6;
+
+	uint32_t m_seed;
+
+public:
+	TestChecksum() noexcept : m_seed(1) {
+		case_0();
+		case_1();
+		case_2();
+		case_3();
+	}
+
+private:
+
+	uint8_t random() noexcept {
+		m_seed = m_seed * 1103515245u + 12345u;
+		return uint8_t(m_seed >> 16);
+	}
+
+	/**
+	 * The RFC 1071 sum of big-endian words, the result in the host byte order.
+	 */
+	static uint16_t reference(const uint8_t* data, size_t length) noexcept {
+		uint32_t acc = 0;
+		for(size_t i = 0; i < length; i += 2) {
+			acc += uint32_t(data[i]) << 8;
+			if(i + 1 < length) {
+				acc += data[i + 1];
+			}
+			acc = (acc & 0xFFFF) + (acc >> 16);
+		}
+		return uint16_t(~acc);
+	}
+
+	static uint16_t host(uint16_t check) noexcept {
+		return utils::ByteOrder::be16_to_cpu(check);
+	}
+
+	/**
+	 * The known vectors and the wide-word loop at every length and alignment.
+	 */
+	void case_0() noexcept {
+		TRACE_CALL;
+		// RFC 1071, 3: the sum of 00 01 f2 03 f4 f5 f6 f7 is ddf2
+		const uint8_t rfc[] = {0x00, 0x01, 0xf2, 0x03, 0xf4, 0xf5, 0xf6, 0xf7};
+		assert(host(Checksum::compute(rfc, sizeof(rfc))) == uint16_t(~0xddf2));
+		// an IPv4 header with the checksum b861
+		uint8_t ip[] = {0x45, 0x00, 0x00, 0x73, 0x00, 0x00, 0x40, 0x00, 0x40, 0x11,
+			0xb8, 0x61, 0xc0, 0xa8, 0x00, 0x01, 0xc0, 0xa8, 0x00, 0xc7};
+		assert(Checksum::compute(ip, sizeof(ip)) == 0);
+		ip[10] = ip[11] = 0;
+		assert(host(Checksum::compute(ip, sizeof(ip))) == 0xb861);
+		// the odd length is padded by zero
+		const uint8_t odd[] = {0x12, 0x34, 0x56};
+		assert(host(Checksum::compute(odd, sizeof(odd))) == uint16_t(~(0x1234 + 0x5600)));
+		assert(Checksum::compute(odd, 0) == 0xFFFF);
+
+		uint8_t buffer[1024 + 8];
+		for(size_t length = 0; length < 1024; length += 1 + length / 8) {
+			for(size_t offset = 0; offset < 8; offset++) {
+				for(size_t i = 0; i < length + offset; i++) {
+					buffer[i] = random();
+				}
+				const uint16_t expected = reference(buffer + offset, length);
+				assert(host(Checksum::compute(buffer + offset, length)) == expected);
+				// the pieces of even lengths sum up to the whole
+				const size_t half = (length / 2) & ~size_t(1);
+				const uint32_t sum = Checksum::partial(buffer + offset, half);
+				assert(host(Checksum::finish(Checksum::partial(buffer + offset + half, length - half, sum))) == expected);
+			}
+		}
+		// the carries of all-ones data
+		memset(buffer, 0xFF, sizeof(buffer));
+		assert(Checksum::compute(buffer, 1024) == 0);
+	}
+
+	/**
+	 * RFC 1624: the incremental updates match a recomputation.
+	 */
+	void case_1() noexcept {
+		TRACE_CALL;
+		uint8_t data[64];
+		for(unsigned round = 0; round < 1000; round++) {
+			for(size_t i = 0; i < sizeof(data); i++) {
+				data[i] = random();
+			}
+			uint16_t check = Checksum::compute(data, sizeof(data));
+			const size_t offset = 2 * (random() % 24);
+
+			uint16_t value16;
+			memcpy(&value16, data + offset, sizeof(value16));
+			const uint16_t new16 = uint16_t(random() << 8 | random());
+			check = Checksum::update16(check, value16, new16);
+			memcpy(data + offset, &new16, sizeof(new16));
+			assert(Checksum::finish(Checksum::partial(data, sizeof(data), check)) == 0);
+
+			uint32_t value32;
+			memcpy(&value32, data + offset + 2, sizeof(value32));
+			const uint32_t new32 = uint32_t(random()) << 24 | uint32_t(random()) << 8 | random();
+			check = Checksum::update32(check, value32, new32);
+			memcpy(data + offset + 2, &new32, sizeof(new32));
+			assert(Checksum::finish(Checksum::partial(data, sizeof(data), check)) == 0);
+
+			uint8_t block[16];
+			for(size_t i = 0; i < sizeof(block); i++) {
+				block[i] = random();
+			}
+			check = Checksum::update(check, data + offset, block, sizeof(block));
+			memcpy(data + offset, block, sizeof(block));
+			assert(Checksum::finish(Checksum::partial(data, sizeof(data), check)) == 0);
+		}
+	}
+
+	/**
+	 * IPv4 -> TCP/UDP: the setters keep both checksums valid.
+	 */
+	void case_2() noexcept {
+		TRACE_CALL;
+		for(unsigned round = 0; round < 400; round++) {
+			const bool tcp = round % 2;
+			const size_t payload = 1 + random() % 200; // the last byte is of the payload
+			const size_t l4_len = (tcp ? 20 : 8) + payload;
+			std::vector<uint8_t> pkt(20 + l4_len);
+			for(size_t i = 0; i < pkt.size(); i++) {
+				pkt[i] = random();
+			}
+			IPv4::Header* ip = reinterpret_cast<IPv4::Header*>(pkt.data());
+			pkt[0] = 0x45;
+			utils::ByteOrder::store_be16(pkt.data() + 2, uint16_t(pkt.size()));
+			utils::ByteOrder::store_be16(pkt.data() + 6, 0);
+			pkt[9] = tcp ? IPv4::PROTO_TCP : IPv4::PROTO_UDP;
+			uint8_t* l4 = pkt.data() + 20;
+			if(tcp) {
+				l4[12] = 5 << 4;
+			} else {
+				utils::ByteOrder::store_be16(l4 + 4, uint16_t(l4_len));
+			}
+			IPv4::update_checksum(ip);
+			assert(IPv4::verify_checksum(ip));
+			assert(IPv4::update_l4_checksum(ip));
+			assert(IPv4::verify_l4_checksum(ip));
+
+			switch(round % 8) {
+				case 0:
+				case 1:
+					IPv4::addr_src_set(ip, uint32_t(random()) << 24 | random());
+					break;
+				case 2:
+				case 3:
+					IPv4::addr_dst_set(ip, uint32_t(random()) << 16 | random());
+					break;
+				case 4:
+				case 5:
+					IPv4::flag_df_set(ip);
+					IPv4::flag_rf_set(ip);
+					break;
+				default:
+					if(tcp) {
+						proto::Tcp::port_src_set(reinterpret_cast<proto::Tcp::Header*>(l4), uint16_t(random()));
+						proto::Tcp::port_dst_set(reinterpret_cast<proto::Tcp::Header*>(l4), uint16_t(random()));
+					} else {
+						proto::Udp::port_src_set(reinterpret_cast<proto::Udp::Header*>(l4), uint16_t(random()));
+						proto::Udp::port_dst_set(reinterpret_cast<proto::Udp::Header*>(l4), uint16_t(random()));
+					}
+			}
+			assert(IPv4::verify_checksum(ip));
+			assert(IPv4::verify_l4_checksum(ip));
+			pkt.back() ^= 0x01;
+			assert(not IPv4::verify_l4_checksum(ip));
+			pkt[8] ^= 0x01; // TTL
+			assert(not IPv4::verify_checksum(ip));
+		}
+
+		// UDP: 0 is no checksum, a computed 0 is sent as 0xFFFF
+		uint8_t udp[20 + 8] = {0x45};
+		IPv4::Header* ip = reinterpret_cast<IPv4::Header*>(udp);
+		utils::ByteOrder::store_be16(udp + 2, sizeof(udp));
+		udp[9] = IPv4::PROTO_UDP;
+		utils::ByteOrder::store_be16(udp + 20 + 4, 8);
+		assert(IPv4::verify_l4_checksum(ip));
+		IPv4::addr_src_set(ip, 0x01020304);
+		assert(udp[26] == 0 && udp[27] == 0);
+		// the pseudo header sums to ~0x0011 + length, the ports make the sum 0xFFFF
+		IPv4::addr_src_set(ip, 0);
+		utils::ByteOrder::store_be16(udp + 20, uint16_t(0xFFFF - IPv4::PROTO_UDP - 8 - 8));
+		assert(IPv4::update_l4_checksum(ip));
+		assert(udp[26] == 0xFF && udp[27] == 0xFF);
+		assert(IPv4::verify_l4_checksum(ip));
+	}
+
+	/**
+	 * IPv6 -> TCP/UDP, UDP over IPv6 requires the checksum.
+	 */
+	void case_3() noexcept {
+		TRACE_CALL;
+		for(unsigned round = 0; round < 200; round++) {
+			const bool tcp = round % 2;
+			const size_t l4_len = (tcp ? 20 : 8) + random() % 200;
+			std::vector<uint8_t> pkt(40 + l4_len);
+			for(size_t i = 0; i < pkt.size(); i++) {
+				pkt[i] = random();
+			}
+			IPv6::Header* ip = reinterpret_cast<IPv6::Header*>(pkt.data());
+			pkt[0] = 0x60;
+			utils::ByteOrder::store_be16(pkt.data() + 4, uint16_t(l4_len));
+			pkt[6] = tcp ? IPv4::PROTO_TCP : IPv4::PROTO_UDP;
+			uint8_t* l4 = pkt.data() + 40;
+			if(not tcp) {
+				utils::ByteOrder::store_be16(l4 + 4, uint16_t(l4_len));
+			}
+			assert(IPv6::update_l4_checksum(ip));
+			assert(IPv6::verify_l4_checksum(ip));
+			l4[random() % l4_len] ^= 0x10;
+			assert(not IPv6::verify_l4_checksum(ip));
+			if(not tcp) {
+				l4[6] = l4[7] = 0;
+				assert(not IPv6::verify_l4_checksum(ip));
+			}
+		}
+	}
+};
@@ -0,0 +1,250 @@
+#pragma once
+
+#include "test_environment.h"
+#include <proto/Classifier.h>
+
+#include <arpa/inet.h>
+
+#include <cstring>
+#include <vector>
+
+class TestClassifier {
+	using Classifier = proto::Classifier;
+	using AclRule = proto::AclRule;
+	using ParsedPacket = proto::ParsedPacket;
+
+	static constexpr uint8_t PROTO_ICMP = 1;
+
+	uint32_t m_seed;
+
+public:
+	TestClassifier() noexcept : m_seed(7) {
+		case_0();
+		case_1();
+		case_2();
+	}
+
+private:
+
+	uint32_t random() noexcept {
+		m_seed = m_seed * 1103515245u + 12345u;
+		return (m_seed >> 16) ^ (m_seed << 16);
+	}
+
+	static ParsedPacket packet(uint32_t src, uint32_t dst, uint8_t protocol, uint16_t src_port, uint16_t dst_port) noexcept {
+		ParsedPacket pkt;
+		memset(&pkt, 0, sizeof(pkt));
+		pkt.ip_version = 4;
+		pkt.ip_protocol = protocol;
+		pkt.src.addr32[0] = htonl(src);
+		pkt.dst.addr32[0] = htonl(dst);
+		if(protocol == proto::IPv4::PROTO_TCP || protocol == proto::IPv4::PROTO_UDP) {
+			pkt.protocols |= 1u << (protocol == proto::IPv4::PROTO_TCP ? proto::Protocol::L4_TCP : proto::Protocol::L4_UDP);
+			pkt.src_port = htons(src_port);
+			pkt.dst_port = htons(dst_port);
+		}
+		return pkt;
+	}
+
+	/**
+	 * The rules in the order of Classifier, one by one.
+	 */
+	static bool matches(const AclRule& rule, const ParsedPacket& pkt) noexcept {
+		if(pkt.ip_version == 0) {
+			return false;
+		}
+		if(pkt.ip_version == 4) {
+			if(not in_prefix(ntohl(pkt.src.addr32[0]), rule.src_net, rule.src_depth)
+					|| not in_prefix(ntohl(pkt.dst.addr32[0]), rule.dst_net, rule.dst_depth)) {
+				return false;
+			}
+		} else if(rule.src_depth || rule.dst_depth) {
+			return false;
+		}
+		const uint16_t src_port = pkt.has_ports() ? ntohs(pkt.src_port) : 0;
+		const uint16_t dst_port = pkt.has_ports() ? ntohs(pkt.dst_port) : 0;
+		if(src_port < rule.src_port_lo || src_port > rule.src_port_hi
+				|| dst_port < rule.dst_port_lo || dst_port > rule.dst_port_hi) {
+			return false;
+		}
+		if(rule.protocol != AclRule::PROTOCOL_ANY && rule.protocol != pkt.ip_protocol) {
+			return false;
+		}
+		const uint32_t vlan = pkt.vlan_count ? pkt.vlan[0] : AclRule::VLAN_NONE;
+		return vlan >= rule.vlan_lo && vlan <= rule.vlan_hi;
+	}
+
+	static bool in_prefix(uint32_t addr, uint32_t net, unsigned depth) noexcept {
+		const uint32_t mask = depth ? ~uint32_t(0) << (32 - depth) : 0;
+		return (addr & mask) == (net & mask);
+	}
+
+	static int linear(const std::vector<AclRule>& rules, const ParsedPacket& pkt) noexcept {
+		for(size_t i = 0; i < rules.size(); i++) {
+			if(matches(rules[i], pkt)) {
+				return int(i);
+			}
+		}
+		return Classifier::NO_MATCH;
+	}
+
+	/**
+	 * The first matching rule wins, the packets without the ports, the untagged, IPv6 and non IP ones.
+	 */
+	void case_0() noexcept {
+		TRACE_CALL;
+		std::vector<AclRule> rules(5);
+		rules[0].src_net = 0x0A000000; // 10.0.0.0/8 -> tcp/80
+		rules[0].src_depth = 8;
+		rules[0].protocol = proto::IPv4::PROTO_TCP;
+		rules[0].dst_port_lo = rules[0].dst_port_hi = 80;
+		rules[1].dst_net = 0xC0A80100; // -> 192.168.1.0/24 of VLAN 10-20
+		rules[1].dst_depth = 24;
+		rules[1].vlan_lo = 10;
+		rules[1].vlan_hi = 20;
+		rules[2].src_port_lo = 1024; // the ports of 1024 and above, no packet without the ports
+		rules[3].vlan_lo = rules[3].vlan_hi = AclRule::VLAN_NONE; // untagged
+		rules[3].protocol = PROTO_ICMP;
+		// any, the default
+
+		Classifier classifier(8);
+		assert(classifier.allocate() == 0);
+		assert(classifier.allocate() != 0);
+		assert(classifier.classify(packet(1, 2, proto::IPv4::PROTO_TCP, 1, 2)) == Classifier::NO_MATCH);
+		assert(classifier.build(rules.data(), rules.size()));
+		assert(classifier.size() == 5 && classifier.rule(1).vlan_lo == 10);
+
+		ParsedPacket pkt = packet(0x0A010203, 0xC0A80105, proto::IPv4::PROTO_TCP, 2000, 80);
+		assert(classifier.classify(pkt) == 0);
+		pkt.dst_port = htons(81);
+		assert(classifier.classify(pkt) == 2);
+		pkt.vlan_count = 1;
+		pkt.vlan[0] = 15;
+		assert(classifier.classify(pkt) == 1);
+		pkt.vlan[0] = 21;
+		assert(classifier.classify(pkt) == 2);
+		pkt.src_port = htons(1023);
+		assert(classifier.classify(pkt) == 4);
+
+		pkt = packet(0x0B000001, 0x0B000002, PROTO_ICMP, 0, 0);
+		assert(classifier.classify(pkt) == 3);
+		pkt.vlan_count = 1;
+		pkt.vlan[0] = 0;
+		assert(classifier.classify(pkt) == 4);
+		// the ports of a packet without them are 0
+		pkt = packet(0x0B000001, 0x0B000002, proto::IPv4::PROTO_GRE, 0, 0);
+		pkt.src_port = htons(5000);
+		assert(classifier.classify(pkt) == 4);
+
+		// IPv6 matches the rules of any address only
+		pkt = packet(0, 0, proto::IPv4::PROTO_TCP, 5000, 80);
+		pkt.ip_version = 6;
+		assert(classifier.classify(pkt) == 2);
+		pkt.ip_version = 0;
+		assert(classifier.classify(pkt) == Classifier::NO_MATCH);
+	}
+
+	/**
+	 * The random rule sets of more than a bitmap word against the linear search, classify() and classify_bulk().
+	 */
+	void case_1() noexcept {
+		TRACE_CALL;
+		const size_t rules_n = 300;
+		Classifier classifier(rules_n);
+		assert(classifier.allocate() == 0);
+		uint32_t nets[8];
+		for(uint32_t& net : nets) {
+			net = random();
+		}
+		for(unsigned round = 0; round < 4; round++) {
+			std::vector<AclRule> rules(round == 3 ? 64 : rules_n);
+			for(AclRule& rule : rules) {
+				if(random() % 3) {
+					rule.src_net = nets[random() % 8];
+					rule.src_depth = uint8_t(8 + random() % 25);
+				}
+				if(random() % 2) {
+					rule.dst_net = nets[random() % 8];
+					rule.dst_depth = uint8_t(random() % 33);
+				}
+				if(random() % 2) {
+					rule.dst_port_lo = uint16_t(random() % 2000);
+					rule.dst_port_hi = uint16_t(rule.dst_port_lo + random() % 100);
+				}
+				if(random() % 4 == 0) {
+					rule.src_port_lo = rule.src_port_hi = uint16_t(random() % 2000);
+				}
+				const unsigned protocol = random() % 4;
+				if(protocol < 2) {
+					rule.protocol = protocol ? proto::IPv4::PROTO_UDP : proto::IPv4::PROTO_TCP;
+				}
+				if(random() % 4 == 0) {
+					rule.vlan_lo = uint16_t(random() % 10);
+					rule.vlan_hi = uint16_t(rule.vlan_lo + random() % 3);
+				} else if(random() % 8 == 0) {
+					rule.vlan_lo = rule.vlan_hi = AclRule::VLAN_NONE;
+				}
+			}
+			assert(classifier.build(rules.data(), rules.size()));
+			for(unsigned field = 0; field < Classifier::FIELDS; field++) {
+				assert(classifier.intervals(Classifier::Field(field)) <= 2 * rules.size() + 1);
+			}
+
+			std::vector<ParsedPacket> pkts(5000);
+			for(ParsedPacket& pkt : pkts) {
+				const unsigned protocol = random() % 3;
+				const uint8_t ip_protocol = protocol == 0 ? proto::IPv4::PROTO_TCP
+					: protocol == 1 ? proto::IPv4::PROTO_UDP : PROTO_ICMP;
+				pkt = packet(nets[random() % 8] ^ (random() % 4 ? (random() & 0xFFFF) : random()),
+					nets[random() % 8] ^ (random() & 0xFFF), ip_protocol, uint16_t(random() % 2100), uint16_t(random() % 2100));
+				const unsigned version = random() % 10;
+				pkt.ip_version = version == 0 ? 0 : version == 1 ? 6 : 4;
+				if(random() % 2) {
+					pkt.vlan_count = 1;
+					pkt.vlan[0] = uint16_t(random() % 12);
+				}
+			}
+			std::vector<int> out(pkts.size());
+			// a length which is not of the bursts
+			classifier.classify_bulk(pkts.data(), pkts.size() - 3, out.data());
+			size_t hits = 0;
+			for(size_t i = 0; i < pkts.size(); i++) {
+				const int expected = linear(rules, pkts[i]);
+				assert(classifier.classify(pkts[i]) == expected);
+				assert(i >= pkts.size() - 3 || out[i] == expected);
+				hits += expected != Classifier::NO_MATCH;
+			}
+			assert(hits > 0);
+		}
+	}
+
+	/**
+	 * The invalid rules and too many rules leave the rule set empty.
+	 */
+	void case_2() noexcept {
+		TRACE_CALL;
+		Classifier classifier(2);
+		assert(classifier.allocate() == 0);
+		const ParsedPacket pkt = packet(1, 2, proto::IPv4::PROTO_UDP, 10, 20);
+		std::vector<AclRule> rules(3);
+		assert(not classifier.build(rules.data(), rules.size()));
+		assert(classifier.size() == 0 && classifier.classify(pkt) == Classifier::NO_MATCH);
+		assert(classifier.build(rules.data(), 2) && classifier.classify(pkt) == 0);
+
+		AclRule& bad = rules[1];
+		bad.src_port_lo = 10;
+		bad.src_port_hi = 1;
+		assert(not classifier.build(rules.data(), 2) && classifier.classify(pkt) == Classifier::NO_MATCH);
+		bad = AclRule();
+		bad.src_depth = 33;
+		assert(not classifier.build(rules.data(), 2));
+		bad = AclRule();
+		bad.vlan_hi = AclRule::VLAN_NONE + 1;
+		assert(not classifier.build(rules.data(), 2));
+		bad = AclRule();
+		bad.protocol = AclRule::PROTOCOL_ANY + 1;
+		assert(not classifier.build(rules.data(), 2));
+		assert(classifier.build(rules.data(), 0) && classifier.size() == 0);
+		assert(classifier.classify(pkt) == Classifier::NO_MATCH);
+	}
+};
@@ -0,0 +1,142 @@
+#ifndef TOP_N_PROBLEM_TESTCONCURRENTBITARRAYT_H
+#define TOP_N_PROBLEM_TESTCONCURRENTBITARRAYT_H
+
+#include "test_environment.h"
+#include <containers/ConcurrentBitArrayT.h>
+
+#include <thread>
+#include <vector>
+
+template <uint8_t Width>
+class TestConcurrentBitArrayTInternal {
+	ConcurrentBitArrayT<Width> m_bat;
+
+public:
+	TestConcurrentBitArrayTInternal(const TestConcurrentBitArrayTInternal&) = delete;
+	TestConcurrentBitArrayTInternal(TestConcurrentBitArrayTInternal&&) = delete;
+
+	TestConcurrentBitArrayTInternal& operator=(const TestConcurrentBitArrayTInternal&) = delete;
+	TestConcurrentBitArrayTInternal& operator=(TestConcurrentBitArrayTInternal&&) = delete;
+
+	virtual ~TestConcurrentBitArrayTInternal() = default;
+
+	TestConcurrentBitArrayTInternal(size_t capacity) noexcept {
+		unsigned step = 1;
+		m_bat.allocate(capacity);
+		store_load_seq(step++);
+		add_sat(step++);
+		add_sat_threads(step++);
+	}
+
+private:
+
+	void store_load_seq(unsigned step) {
+		TRACE_CALL;
+		const auto range = m_bat.range();
+		const auto item_nb = m_bat.items_capacity();
+		assert(range);
+		assert(item_nb);
+		m_bat.fill(0);
+		for(size_t i = 0; i < item_nb; ++i) {
+			const auto value = (i + step) % range;
+			m_bat.store(i, value);
+			assert(m_bat.load(i) == value);
+		}
+		for(size_t i = 0; i < item_nb; ++i) {
+			const auto value = (i + step) % range;
+			assert(m_bat.load(i) == value);
+		}
+		m_bat.fill(m_bat.value_max());
+		for(size_t i = 0; i < item_nb; ++i) {
+			assert(m_bat.load(i) == m_bat.value_max());
+		}
+	}
+
+	void add_sat(unsigned step) {
+		TRACE_CALL;
+		const auto item_nb = m_bat.items_capacity();
+		m_bat.fill(0);
+		for(size_t i = 0; i < item_nb; ++i) {
+			assert(m_bat.fetch_add_sat(i, step) == 0);
+		}
+		for(size_t i = 0; i < item_nb; ++i) {
+			const auto expected = step < m_bat.value_max() ? step : m_bat.value_max();
+			assert(m_bat.load(i) == expected);
+		}
+
+		// the items saturate and keep their neighbours
+		for(size_t i = 0; i < item_nb; i += 2) {
+			m_bat.fetch_add_sat(i, m_bat.value_max());
+			assert(m_bat.load(i) == m_bat.value_max());
+			assert(m_bat.fetch_add_sat(i, 1) == m_bat.value_max());
+			assert(m_bat.load(i) == m_bat.value_max());
+		}
+		for(size_t i = 1; i < item_nb; i += 2) {
+			const auto expected = step < m_bat.value_max() ? step : m_bat.value_max();
+			assert(m_bat.load(i) == expected);
+		}
+	}
+
+	/**
+	 * The threads increment the same items, all the increments must reach the items.
+	 */
+	void add_sat_threads(unsigned step) {
+		TRACE_CALL;
+		const auto item_nb = m_bat.items_capacity();
+		const unsigned threads = 4;
+		const size_t rounds = m_bat.value_max() / threads;
+		m_bat.fill(0);
+
+		std::vector<std::thread> workers;
+		for(unsigned t = 0; t < threads; ++t) {
+			workers.emplace_back([this, item_nb, rounds, t]() {
+				for(size_t round = 0; round < rounds; ++round) {
+					for(size_t i = 0; i < item_nb; ++i) {
+						m_bat.fetch_add_sat((i + t) % item_nb, 1);
+					}
+					if(round % 64 == 0) {
+						std::this_thread::yield();
+					}
+				}
+			});
+		}
+		for(auto& worker : workers) {
+			worker.join();
+		}
+		for(size_t i = 0; i < item_nb; ++i) {
+			assert(m_bat.load(i) == rounds * threads);
+		}
+
+		// the concurrent increments saturate
+		workers.clear();
+		for(unsigned t = 0; t < threads; ++t) {
+			workers.emplace_back([this, item_nb, step]() {
+				for(size_t i = 0; i < item_nb; ++i) {
+					m_bat.fetch_add_sat(i, m_bat.value_max() / 2 + step);
+				}
+			});
+		}
+		for(auto& worker : workers) {
+			worker.join();
+		}
+		for(size_t i = 0; i < item_nb; ++i) {
+			assert(m_bat.load(i) == m_bat.value_max());
+		}
+	}
+
+};
+
+class TestConcurrentBitArrayT {
+public:
+	explicit TestConcurrentBitArrayT(size_t capacity) noexcept {
+		TestConcurrentBitArrayTInternal<1> bit_arrayt1(capacity);
+		TestConcurrentBitArrayTInternal<3> bit_arrayt3(capacity);
+		TestConcurrentBitArrayTInternal<4> bit_arrayt4(capacity);
+		TestConcurrentBitArrayTInternal<5> bit_arrayt5(capacity);
+		TestConcurrentBitArrayTInternal<8> bit_arrayt8(capacity);
+		TestConcurrentBitArrayTInternal<12> bit_arrayt12(capacity);
+	}
+};
+
+
+#endif //TOP_N_PROBLEM_TESTCONCURRENTBITARRAYT_H
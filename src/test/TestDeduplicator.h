@@ -0,0 +1,205 @@
+#pragma once
+
+#include "test_environment.h"
+#include <proto/Deduplicator.h>
+
+#include <cstring>
+#include <vector>
+
+class TestDeduplicator {
+	/**
+	 * A frame as pcapwrap::Frame keeps it.
+	 */
+	struct Frame {
+		struct {
+			uint32_t caplen;
+		} m_hdr;
+		const uint8_t* m_data;
+	};
+
+	using Packet = std::vector<uint8_t>;
+	using Dedup = proto::Deduplicator<16, storage::BurstClock<1000000> >; // microseconds
+
+public:
+	TestDeduplicator() noexcept {
+		case_0();
+		case_1();
+		case_2();
+		case_3();
+	}
+
+private:
+
+	/**
+	 * Ethernet (with a VLAN tag if @vlan) -> IPv4 -> UDP -> @payload bytes.
+	 */
+	static Packet udp4(uint32_t seq, unsigned payload, bool vlan = false, uint8_t ttl = 64) noexcept {
+		Packet pkt(14 + (vlan ? 4 : 0) + 20 + 8 + payload, 0);
+		uint8_t* ptr = pkt.data();
+		memset(ptr, 0x02, 12); // the MAC addresses
+		ptr += 12;
+		if(vlan) {
+			utils::ByteOrder::store_be16(ptr, 0x8100);
+			utils::ByteOrder::store_be16(ptr + 2, 100);
+			ptr += 4;
+		}
+		utils::ByteOrder::store_be16(ptr, 0x0800);
+		ptr += 2;
+		ptr[0] = 0x45;
+		utils::ByteOrder::store_be16(ptr + 2, uint16_t(20 + 8 + payload));
+		utils::ByteOrder::store_be16(ptr + 4, uint16_t(seq));
+		ptr[8] = ttl;
+		ptr[9] = proto::IPv4::PROTO_UDP;
+		utils::ByteOrder::store_be16(ptr + 10, uint16_t(0xBEEF - ttl)); // a checksum of the hop
+		utils::ByteOrder::store_be32(ptr + 12, 0x0A000001);
+		utils::ByteOrder::store_be32(ptr + 16, 0x0A000002);
+		ptr += 20;
+		utils::ByteOrder::store_be16(ptr, 1234);
+		utils::ByteOrder::store_be16(ptr + 2, 53);
+		utils::ByteOrder::store_be16(ptr + 4, uint16_t(8 + payload));
+		ptr += 8;
+		for(unsigned i = 0; i < payload; i++) {
+			ptr[i] = uint8_t(seq >> (8 * (i % 4)));
+		}
+		return pkt;
+	}
+
+	static Packet udp6(uint32_t seq, uint8_t hop_limit) noexcept {
+		Packet pkt(14 + 40 + 8 + 4, 0);
+		uint8_t* ptr = pkt.data();
+		utils::ByteOrder::store_be16(ptr + 12, 0x86DD);
+		ptr += 14;
+		ptr[0] = 0x60;
+		ptr[1] = hop_limit == 64 ? 0 : 0xA0; // the traffic class is remarked by the hop
+		utils::ByteOrder::store_be16(ptr + 4, 8 + 4);
+		ptr[6] = proto::IPv4::PROTO_UDP;
+		ptr[7] = hop_limit;
+		ptr[8] = 0x20;
+		ptr[24] = 0x20;
+		ptr[39] = 1;
+		ptr += 40;
+		utils::ByteOrder::store_be16(ptr + 4, 8 + 4);
+		utils::ByteOrder::store_be32(ptr + 8, seq);
+		return pkt;
+	}
+
+	static bool duplicate(Dedup& dedup, const Packet& pkt) noexcept {
+		proto::ParsedPacket parsed;
+		proto::PacketParser::parse(pkt.data(), pkt.size(), parsed);
+		return dedup.duplicate(pkt.data(), pkt.size(), parsed);
+	}
+
+	/**
+	 * The copies of a hop are the duplicates: the MAC addresses, a VLAN tag, the TTL, the TOS, the
+	 * checksum and the padding of the frame differ. The other packets pass.
+	 */
+	void case_0() noexcept {
+		TRACE_CALL;
+		Dedup dedup(1024);
+		assert(dedup.allocate() == 0);
+		assert(dedup.allocate() != 0);
+		assert(dedup.slots() == 1024 && dedup.storage_bytes() == 2 * 1024 * 2);
+
+		Packet first = udp4(1, 100);
+		assert(not duplicate(dedup, first));
+		Packet copy = udp4(1, 100, true, 63);
+		copy[6] = 0x04; // the source MAC of the egress
+		copy[18 + 1] = 0x20; // the TOS
+		copy.resize(copy.size() + 6, 0xFF); // the padding of a frame
+		assert(duplicate(dedup, copy));
+		assert(duplicate(dedup, first)); // a third copy is found too
+
+		assert(not duplicate(dedup, udp4(2, 100))); // the IP id
+		Packet payload = udp4(3, 100);
+		assert(not duplicate(dedup, payload));
+		payload[14 + 20 + 8 + 40] ^= 1; // within the prefix
+		assert(not duplicate(dedup, payload));
+		payload[payload.size() - 1] ^= 1; // past the prefix, it is not hashed
+		assert(duplicate(dedup, payload));
+
+		assert(not duplicate(dedup, udp6(1, 64)));
+		assert(duplicate(dedup, udp6(1, 63)));
+		assert(not duplicate(dedup, udp6(2, 64)));
+
+		Packet arp(60, 0);
+		utils::ByteOrder::store_be16(arp.data() + 12, 0x0806);
+		assert(not duplicate(dedup, arp));
+		assert(not duplicate(dedup, arp));
+
+		const proto::DeduplicationStat& stat = dedup.stat();
+		assert(stat.packets == 10 && stat.duplicates == 4 && stat.skipped == 2);
+	}
+
+	/**
+	 * A packet is remembered for a window at least and for two windows at most.
+	 */
+	void case_1() noexcept {
+		TRACE_CALL;
+		Dedup dedup(1024, 1000);
+		dedup.clock().set(5000);
+		assert(dedup.allocate() == 0);
+
+		const Packet pkt = udp4(7, 20);
+		assert(not duplicate(dedup, pkt));
+		dedup.clock().set(5900);
+		assert(duplicate(dedup, pkt)); // the same generation
+		dedup.clock().set(6500);
+		assert(duplicate(dedup, pkt)); // the previous generation
+		assert(dedup.stat().rotations == 1);
+		dedup.clock().set(7600);
+		assert(not duplicate(dedup, pkt)); // two windows, it is stored again
+		dedup.clock().set(7700);
+		assert(duplicate(dedup, pkt));
+		dedup.clock().set(10000);
+		assert(not duplicate(dedup, pkt)); // both generations are cleared after a gap
+		assert(dedup.stat().rotations == 3);
+	}
+
+	/**
+	 * A burst of the pairs of the copies keeps the first ones.
+	 */
+	void case_2() noexcept {
+		TRACE_CALL;
+		Dedup dedup(4096);
+		assert(dedup.allocate() == 0);
+		const size_t n = 2 * Dedup::BURST + 10;
+		std::vector<Packet> packets;
+		for(size_t i = 0; i < n; i++) {
+			packets.push_back(udp4(uint32_t(i / 2), 32, i % 2, uint8_t(64 - i % 2)));
+		}
+		std::vector<Frame> frames(n);
+		std::vector<proto::ParsedPacket> parsed(n);
+		for(size_t i = 0; i < n; i++) {
+			frames[i].m_data = packets[i].data();
+			frames[i].m_hdr.caplen = uint32_t(packets[i].size());
+		}
+		proto::PacketParser::parse_burst(frames.data(), n, parsed.data());
+		bool keep[n];
+		assert(dedup.filter_burst(frames.data(), parsed.data(), n, keep) == n / 2);
+		for(size_t i = 0; i < n; i++) {
+			assert(keep[i] == (i % 2 == 0));
+		}
+		assert(dedup.filter_burst(frames.data(), parsed.data(), n, keep) == 0);
+		assert(dedup.stat().duplicates == n / 2 + n);
+	}
+
+	/**
+	 * The distinct packets of a window are rarely taken for the duplicates.
+	 */
+	void case_3() noexcept {
+		TRACE_CALL;
+		const uint32_t packets = 100000;
+		Dedup dedup(size_t(1) << 18, 1000000);
+		assert(dedup.allocate() == 0);
+		proto::ParsedPacket parsed;
+		Packet pkt = udp4(0, 16);
+		proto::PacketParser::parse(pkt.data(), pkt.size(), parsed);
+		for(uint32_t i = 0; i < packets; i++) {
+			memcpy(pkt.data() + 14 + 20 + 8, &i, sizeof(i)); // the IP id wraps, the payload doesn't
+			utils::ByteOrder::store_be16(pkt.data() + 14 + 4, uint16_t(i));
+			dedup.duplicate(pkt.data(), pkt.size(), parsed);
+		}
+		printf("packets=%u false duplicates=%lu\n", packets, (unsigned long)dedup.stat().duplicates);
+		assert(dedup.stat().duplicates <= 5);
+	}
+};
@@ -0,0 +1,211 @@
+#pragma once
+
+#include "test_environment.h"
+#include <proto/mframe/MFrame.h>
+#include <proto/mframe/SafeMFrame.h>
+#include <proto/parsers/ParsedPacket.h>
+#include <proto/procotols/Ethernet.h>
+#include <proto/procotols/Gre.h>
+#include <proto/procotols/IPv4.h>
+#include <proto/procotols/Vlan.h>
+
+#include <cstring>
+#include <vector>
+
+class TestEncap {
+	using Packet = std::vector<uint8_t>;
+	using IPv4 = proto::IPv4;
+
+	static constexpr size_t HEADROOM = 64;
+
+public:
+	TestEncap() noexcept {
+		case_0<proto::MFrame<uint8_t> >();
+		case_0<proto::SafeMFrame<uint8_t> >();
+		case_1<proto::MFrame<uint8_t> >();
+		case_1<proto::SafeMFrame<uint8_t> >();
+		case_2<proto::MFrame<uint8_t> >();
+		case_2<proto::SafeMFrame<uint8_t> >();
+	}
+
+private:
+
+	/**
+	 * Ethernet -> IPv4 -> UDP with a payload, the IPv4 checksum is set.
+	 */
+	static Packet udp_frame() noexcept {
+		Packet pkt(14 + 20 + 8 + 10);
+		for(size_t i = 0; i < 12; i++) {
+			pkt[i] = uint8_t(0xA0 + i);
+		}
+		utils::ByteOrder::store_be16(&pkt[12], ETH_P_IP);
+		uint8_t* ip = &pkt[14];
+		ip[0] = 0x45;
+		utils::ByteOrder::store_be16(ip + 2, uint16_t(pkt.size() - 14));
+		ip[8] = 64;
+		ip[9] = IPv4::PROTO_UDP;
+		utils::ByteOrder::store_be32(ip + 12, 0x0A000001);
+		utils::ByteOrder::store_be32(ip + 16, 0x0A000002);
+		utils::ByteOrder::store_be16(ip + 20, 1000);
+		utils::ByteOrder::store_be16(ip + 22, 2000);
+		utils::ByteOrder::store_be16(ip + 24, uint16_t(pkt.size() - 34));
+		for(size_t i = 42; i < pkt.size(); i++) {
+			pkt[i] = uint8_t(i);
+		}
+		IPv4::update_checksum(reinterpret_cast<IPv4::Header*>(ip));
+		return pkt;
+	}
+
+	/**
+	 * A frame of @pkt with @headroom bytes in front of its head.
+	 */
+	template<typename MFrame>
+	static MFrame frame(Packet& buffer, const Packet& pkt, size_t headroom) noexcept {
+		buffer.assign(headroom, 0xEE);
+		buffer.insert(buffer.end(), pkt.begin(), pkt.end());
+		MFrame result(buffer.data(), buffer.size());
+		result.head_move(headroom);
+		return result;
+	}
+
+	template<typename MFrame>
+	static Packet bytes(const MFrame& pkt) noexcept {
+		const uint8_t* head;
+		pkt.assign_stay(head);
+		return Packet(head, head + pkt.available());
+	}
+
+	/**
+	 * Vlan::push() and pop() of 802.1Q and QinQ, the parser sees the tags and the frame is restored.
+	 */
+	template<typename MFrame>
+	void case_0() noexcept {
+		TRACE_CALL;
+		const Packet original = udp_frame();
+		Packet buffer;
+		MFrame pkt = frame<MFrame>(buffer, original, HEADROOM);
+		assert(not proto::Vlan::tagged(pkt));
+		assert(not proto::Vlan::pop(pkt));
+
+		assert(proto::Vlan::push(pkt, 0x2064)); // PCP 1, VID 100
+		assert(pkt.offset() == HEADROOM - 4 && pkt.available() == original.size() + 4);
+		assert(proto::Vlan::tagged(pkt));
+		Packet tagged = bytes(pkt);
+		assert(memcmp(tagged.data(), original.data(), 12) == 0);
+		assert(utils::ByteOrder::load_be16(&tagged[12]) == ETH_P_8021Q && utils::ByteOrder::load_be16(&tagged[14]) == 0x2064);
+		assert(memcmp(&tagged[16], &original[12], original.size() - 12) == 0);
+
+		assert(proto::Vlan::push(pkt, 200, ETH_P_8021AD));
+		tagged = bytes(pkt);
+		assert(utils::ByteOrder::load_be16(&tagged[12]) == ETH_P_8021AD);
+		proto::ParsedPacket parsed;
+		assert(proto::PacketParser::parse(tagged.data(), tagged.size(), parsed));
+		assert(parsed.vlan_count == 2 && parsed.vlan[0] == 200 && parsed.vlan[1] == 100);
+		assert(parsed.ip_version == 4 && parsed.src_port == htons(1000) && parsed.l3 == 14 + 8);
+
+		uint16_t tci = 0;
+		assert(proto::Vlan::pop(pkt, tci) && tci == 200);
+		assert(proto::Vlan::pop(pkt, tci) && tci == 0x2064);
+		assert(not proto::Vlan::pop(pkt, tci));
+		assert(pkt.offset() == HEADROOM && bytes(pkt) == original);
+
+		// no headroom for a tag
+		pkt = frame<MFrame>(buffer, original, 3);
+		assert(not proto::Vlan::push(pkt, 1));
+		assert(pkt.offset() == 3 && bytes(pkt) == original);
+	}
+
+	/**
+	 * Ethernet -> IPv4 -> UDP is carried by Ethernet -> IPv4 -> GRE, with and without the key,
+	 * the outer header is valid for the length of the frame and the decap restores the frame.
+	 */
+	template<typename MFrame>
+	void case_1() noexcept {
+		TRACE_CALL;
+		const Packet original = udp_frame();
+		Packet outer_bytes(20);
+		outer_bytes[0] = 0x45;
+		outer_bytes[8] = 32;
+		outer_bytes[9] = IPv4::PROTO_GRE;
+		utils::ByteOrder::store_be32(&outer_bytes[12], 0xC0A80001);
+		utils::ByteOrder::store_be32(&outer_bytes[16], 0xC0A80002);
+		IPv4::Header outer;
+		memcpy(&outer, outer_bytes.data(), sizeof(outer));
+		IPv4::update_checksum(&outer);
+
+		for(unsigned with_key = 0; with_key < 2; with_key++) {
+			Packet buffer;
+			MFrame pkt = frame<MFrame>(buffer, original, HEADROOM);
+			proto::Ethernet::Header eth;
+			memcpy(&eth, original.data(), sizeof(eth));
+			assert(proto::Ethernet::decap(pkt));
+			assert(proto::Gre::encap(pkt, ETH_P_IP, 0xABCD, with_key) != nullptr);
+			IPv4::Header* ip = IPv4::encap(pkt, outer);
+			assert(ip != nullptr);
+			assert(proto::Ethernet::encap(pkt, eth) != nullptr);
+			const size_t gre_nb = with_key ? 8 : 4;
+			assert(pkt.offset() == HEADROOM - 20 - gre_nb && pkt.available() == original.size() + 20 + gre_nb);
+
+			assert(ntohs(ip->tot_len) == pkt.available() - 14);
+			assert(IPv4::verify_checksum(ip));
+			const Packet tunneled = bytes(pkt);
+			proto::ParsedPacket parsed;
+			assert(proto::PacketParser::parse(tunneled.data(), tunneled.size(), parsed));
+			assert(parsed.tunnel == proto::Protocol::L4_GRE && parsed.tunnel_id == (with_key ? 0xABCD : 0));
+			assert(parsed.l4 == 14 + 20 && parsed.inner.l3 == 14 + 20 + gre_nb);
+			assert(parsed.inner.ip_protocol == IPv4::PROTO_UDP && parsed.inner.dst_port == htons(2000));
+
+			assert(proto::Ethernet::decap(pkt));
+			assert(IPv4::decap(pkt));
+			assert(proto::Gre::decap(pkt));
+			assert(proto::Ethernet::encap(pkt, eth) != nullptr);
+			assert(pkt.offset() == HEADROOM && bytes(pkt) == original);
+		}
+
+		// GRE TEB: the whole Ethernet frame is the payload
+		Packet buffer;
+		MFrame pkt = frame<MFrame>(buffer, original, HEADROOM);
+		assert(proto::Gre::encap(pkt, ETH_P_TEB, 7, true) != nullptr);
+		assert(IPv4::encap(pkt, outer) != nullptr);
+		const Packet tunneled = bytes(pkt);
+		assert(IPv4::verify_checksum(reinterpret_cast<const IPv4::Header*>(tunneled.data())));
+		assert(utils::ByteOrder::load_be16(&tunneled[2]) == original.size() + 28);
+		assert(memcmp(&tunneled[28], original.data(), original.size()) == 0);
+		assert(IPv4::decap(pkt) && proto::Gre::decap(pkt));
+		assert(bytes(pkt) == original);
+	}
+
+	/**
+	 * The headroom or the header is too short, the frame is not changed.
+	 */
+	template<typename MFrame>
+	void case_2() noexcept {
+		TRACE_CALL;
+		const Packet original = udp_frame();
+		IPv4::Header outer;
+		memcpy(&outer, &original[14], sizeof(outer));
+
+		Packet buffer;
+		MFrame pkt = frame<MFrame>(buffer, original, 19);
+		assert(IPv4::encap(pkt, outer) == nullptr);
+		assert(proto::Gre::encap(pkt, ETH_P_IP, 1, true) != nullptr);
+		assert(proto::Gre::encap(pkt, ETH_P_IP, 1, true) != nullptr);
+		assert(proto::Gre::encap(pkt, ETH_P_IP, 1, true) == nullptr);
+		assert(proto::Gre::encap(pkt, ETH_P_IP) == nullptr);
+		assert(pkt.offset() == 19 - 8 - 8);
+		assert(proto::Ethernet::encap(pkt, proto::Ethernet::Header()) == nullptr);
+
+		// not an IPv4 header at the head, the headers past the end
+		pkt = frame<MFrame>(buffer, original, HEADROOM);
+		assert(not IPv4::decap(pkt));
+		assert(pkt.offset() == HEADROOM);
+		pkt = frame<MFrame>(buffer, Packet(original.begin(), original.begin() + 13), HEADROOM);
+		assert(not proto::Ethernet::decap(pkt));
+		assert(not proto::Vlan::push(pkt, 1));
+		pkt = frame<MFrame>(buffer, Packet(original.begin() + 14, original.begin() + 14 + 19), HEADROOM);
+		assert(not IPv4::decap(pkt));
+		pkt = frame<MFrame>(buffer, Packet(3, 0), HEADROOM);
+		assert(not proto::Gre::decap(pkt));
+		assert(pkt.offset() == HEADROOM && pkt.available() == 3);
+	}
+};
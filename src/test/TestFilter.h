@@ -0,0 +1,152 @@
+#pragma once
+
+#include "test_environment.h"
+#include <pcapwrap/Filter.h>
+
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+class TestFilter {
+	using Filter = pcapwrap::Filter;
+	using Packet = std::vector<uint8_t>;
+
+	uint32_t m_seed;
+
+public:
+	TestFilter() noexcept : m_seed(5) {
+		case_0();
+		case_1();
+		case_2();
+	}
+
+private:
+
+	uint32_t random() noexcept {
+		m_seed = m_seed * 1103515245u + 12345u;
+		return m_seed >> 8;
+	}
+
+	/**
+	 * Ethernet -> IPv4 of @protocol with the random addresses and payload.
+	 */
+	Packet packet(uint8_t protocol, size_t length) noexcept {
+		Packet pkt(length);
+		for(uint8_t& byte : pkt) {
+			byte = uint8_t(random());
+		}
+		pkt[12] = 0x08;
+		pkt[13] = 0x00;
+		pkt[14] = 0x45;
+		pkt[23] = protocol;
+		return pkt;
+	}
+
+	static pcapwrap::Frame frame(const Packet& pkt) noexcept {
+		struct pcap_pkthdr hdr;
+		memset(&hdr, 0, sizeof(hdr));
+		hdr.caplen = uint32_t(pkt.size());
+		hdr.len = uint32_t(pkt.size());
+		return pcapwrap::Frame(hdr, pkt.data());
+	}
+
+	/**
+	 * The default filter passes all, COUNT takes every rate-th frame.
+	 */
+	void case_0() noexcept {
+		TRACE_CALL;
+		const Packet pkt = packet(proto::IPv4::PROTO_UDP, 60);
+		Filter filter;
+		assert(not filter.active());
+		for(unsigned i = 0; i < 10; i++) {
+			assert(filter.accept(frame(pkt)));
+		}
+		assert(filter.stat().passed == 10 && filter.stat().filtered == 0 && filter.stat().unsampled == 0);
+
+		filter.sample(4);
+		assert(filter.active());
+		for(unsigned i = 0; i < 100; i++) {
+			assert(filter.accept(frame(pkt)) == (i % 4 == 0));
+		}
+		assert(filter.stat().passed == 10 + 25 && filter.stat().unsampled == 75);
+		filter.sample(0);
+		assert(not filter.active() && filter.accept(frame(pkt)));
+	}
+
+	/**
+	 * HASH takes the same frames in any order, another seed takes another set, about 1 in rate.
+	 */
+	void case_1() noexcept {
+		TRACE_CALL;
+		std::vector<Packet> pkts;
+		for(unsigned i = 0; i < 10000; i++) {
+			// the bytes past HASH_BYTES don't select the frame
+			pkts.push_back(packet(proto::IPv4::PROTO_TCP, Filter::HASH_BYTES + (i % 2 ? 100 : 0) - (i % 3 ? 10 : 0)));
+		}
+		Filter forward;
+		Filter backward;
+		Filter other;
+		forward.sample(10, Filter::HASH);
+		backward.sample(10, Filter::HASH);
+		other.sample(10, Filter::HASH, 1);
+		std::vector<bool> taken(pkts.size());
+		size_t passed = 0;
+		size_t same = 0;
+		for(size_t i = 0; i < pkts.size(); i++) {
+			taken[i] = forward.accept(frame(pkts[i]));
+			passed += taken[i];
+			same += taken[i] && other.accept(frame(pkts[i]));
+		}
+		assert(passed > 800 && passed < 1200);
+		assert(same < passed);
+		for(size_t i = pkts.size(); i-- > 0; ) {
+			assert(backward.accept(frame(pkts[i])) == taken[i]);
+		}
+		assert(backward.stat().passed == passed && backward.stat().unsampled == pkts.size() - passed);
+
+		Packet& pkt = pkts[0];
+		const bool first = taken[0];
+		pkt.resize(Filter::HASH_BYTES + 100);
+		pkt.back() ^= 0xFF;
+		assert(backward.accept(frame(pkt)) == first);
+	}
+
+	/**
+	 * The BPF program runs before the sampling, a bad expression throws, a move takes the program.
+	 */
+	void case_2() noexcept {
+		TRACE_CALL;
+		const Packet udp = packet(proto::IPv4::PROTO_UDP, 60);
+		const Packet tcp = packet(proto::IPv4::PROTO_TCP, 60);
+		Filter filter;
+		filter.compile("udp", DLT_EN10MB, 65535);
+		assert(filter.active());
+		assert(filter.accept(frame(udp)) && not filter.accept(frame(tcp)));
+		filter.sample(2);
+		for(unsigned i = 0; i < 10; i++) {
+			assert(not filter.accept(frame(tcp)));
+			assert(filter.accept(frame(udp)) == (i % 2 == 0));
+		}
+		assert(filter.stat().passed == 1 + 5 && filter.stat().filtered == 1 + 10 && filter.stat().unsampled == 5);
+
+		bool thrown = false;
+		try {
+			filter.compile("udp and (", DLT_EN10MB, 65535);
+		} catch(const std::runtime_error& e) {
+			thrown = strstr(e.what(), "udp and (") != nullptr;
+		}
+		assert(thrown);
+		// the previous program stays
+		filter.sample(1);
+		assert(filter.accept(frame(udp)) && not filter.accept(frame(tcp)));
+
+		filter.compile("tcp", DLT_EN10MB, 65535);
+		Filter moved(std::move(filter));
+		assert(moved.accept(frame(tcp)) && not moved.accept(frame(udp)));
+		Filter assigned;
+		assigned.compile("udp", DLT_EN10MB, 65535);
+		assigned = std::move(moved);
+		assert(assigned.accept(frame(tcp)) && not assigned.accept(frame(udp)));
+	}
+};
@@ -0,0 +1,269 @@
+#pragma once
+
+#include "test_environment.h"
+#include <netflow/FlowExporter.h>
+
+#include <cstring>
+#include <thread>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+class TestFlowExporter {
+	using ByteOrder = utils::ByteOrder;
+	using FlowEncoder = netflow::FlowEncoder;
+	using FlowFormat = netflow::FlowFormat;
+
+	static constexpr uint64_t HZ = 1000; // the flow times are in milliseconds
+	static constexpr int64_t OFFSET_MS = 1700000000000ll;
+	static constexpr size_t IPFIX_V4_BYTES = 47;
+	static constexpr size_t IPFIX_V6_BYTES = 71;
+	static constexpr size_t V9_V4_BYTES = 38;
+
+	/**
+	 * The sets of a datagram.
+	 */
+	struct Decoded {
+		unsigned templates; // the template records
+		unsigned records[2]; // IPv4 and IPv6 data records
+		const uint8_t* first[2]; // the first data record of a family
+	};
+
+public:
+	TestFlowExporter() noexcept {
+		case_0();
+		case_1();
+		case_2();
+	}
+
+private:
+
+	static storage::FlowRecord record(unsigned version, uint32_t id, uint64_t forward, uint64_t reverse) noexcept {
+		storage::FlowRecord result; // FlowEntry() zeroes the flow
+		proto::FlowKey& key = result.flow.key;
+		key.version = uint8_t(version);
+		key.protocol = 6;
+		if(version == 4) {
+			key.src.addr32[0] = htonl(0x0A000000u | id);
+			key.dst.addr32[0] = htonl(0xC0A80001u);
+		} else {
+			key.src.addr8[0] = 0x20;
+			key.src.addr32[3] = htonl(id);
+			key.dst.addr8[15] = 1;
+		}
+		key.src_port = htons(uint16_t(1024 + id));
+		key.dst_port = htons(443);
+		result.flow.first = 1000;
+		result.flow.last = 2500;
+		result.flow.forward.packets = forward;
+		result.flow.forward.bytes = forward * 100;
+		result.flow.forward.tcp_flags = 0x12;
+		result.flow.reverse.packets = reverse;
+		result.flow.reverse.bytes = reverse * 1000;
+		result.reason = storage::FlowEnd::IDLE;
+		return result;
+	}
+
+	static Decoded decode(const uint8_t* datagram, size_t bytes, FlowFormat format) noexcept {
+		Decoded result;
+		memset(&result, 0, sizeof(result));
+		assert(ByteOrder::load_be16(datagram) == uint16_t(format));
+		const bool ipfix = format == FlowFormat::IPFIX;
+		if(ipfix) {
+			assert(ByteOrder::load_be16(datagram + 2) == bytes);
+		}
+		const size_t record_bytes[2] = {ipfix ? IPFIX_V4_BYTES : V9_V4_BYTES, ipfix ? IPFIX_V6_BYTES : 62};
+		size_t offset = ipfix ? 16 : 20;
+		unsigned count = 0;
+		while(offset < bytes) {
+			const uint16_t id = ByteOrder::load_be16(datagram + offset);
+			const uint16_t length = ByteOrder::load_be16(datagram + offset + 2);
+			assert(length > 4 && offset + length <= bytes);
+			if(id == (ipfix ? 2 : 0)) {
+				size_t field = offset + 4;
+				while(field < offset + length) {
+					const uint16_t fields = ByteOrder::load_be16(datagram + field + 2);
+					field += 4 + 4 * fields;
+					result.templates++;
+				}
+				assert(field == offset + length);
+			} else {
+				assert(id == FlowEncoder::TEMPLATE_IPV4 || id == FlowEncoder::TEMPLATE_IPV6);
+				const unsigned family = id == FlowEncoder::TEMPLATE_IPV6;
+				const unsigned records = unsigned((length - 4) / record_bytes[family]);
+				if(ipfix) {
+					assert(size_t(length - 4) == records * record_bytes[family]);
+				}
+				if(result.records[family] == 0) {
+					result.first[family] = datagram + offset + 4;
+				}
+				result.records[family] += records;
+			}
+			offset += length;
+		}
+		assert(offset == bytes);
+		count = result.templates + result.records[0] + result.records[1];
+		if(not ipfix) {
+			assert(ByteOrder::load_be16(datagram + 2) == count);
+		}
+		return result;
+	}
+
+	/**
+	 * The records of IPFIX field by field.
+	 */
+	void case_0() noexcept {
+		TRACE_CALL;
+		FlowEncoder encoder(FlowFormat::IPFIX, 7, HZ, OFFSET_MS);
+		storage::FlowRecord records[2] = {record(4, 1, 3, 2), record(6, 2, 5, 0)};
+		uint8_t datagram[FlowEncoder::MTU];
+		const storage::FlowRecord* next = records;
+		const size_t bytes = encoder.encode(next, records + 2, datagram, uint64_t(OFFSET_MS) + 5000);
+		assert(next == records + 2);
+		assert(ByteOrder::load_be32(datagram + 4) == uint32_t((OFFSET_MS + 5000) / 1000));
+		assert(ByteOrder::load_be32(datagram + 8) == 0); // the sequence
+		assert(ByteOrder::load_be32(datagram + 12) == 7);
+		const Decoded decoded = decode(datagram, bytes, FlowFormat::IPFIX);
+		assert(decoded.templates == 2);
+		assert(decoded.records[0] == 2 && decoded.records[1] == 1);
+
+		// the forward record and the reverse one of the IPv4 flow
+		const uint8_t* ptr = decoded.first[0];
+		assert(ByteOrder::load_be32(ptr) == 0x0A000001u);
+		assert(ByteOrder::load_be32(ptr + 4) == 0xC0A80001u);
+		assert(ByteOrder::load_be16(ptr + 8) == 1025);
+		assert(ByteOrder::load_be16(ptr + 10) == 443);
+		assert(ptr[12] == 6 && ptr[13] == 0x12);
+		assert(ByteOrder::load_be64(ptr + 14) == 3);
+		assert(ByteOrder::load_be64(ptr + 22) == 300);
+		assert(ByteOrder::load_be64(ptr + 30) == uint64_t(OFFSET_MS) + 1000);
+		assert(ByteOrder::load_be64(ptr + 38) == uint64_t(OFFSET_MS) + 2500);
+		assert(ptr[46] == FlowEncoder::END_IDLE);
+		ptr += IPFIX_V4_BYTES;
+		assert(ByteOrder::load_be32(ptr) == 0xC0A80001u);
+		assert(ByteOrder::load_be16(ptr + 8) == 443);
+		assert(ByteOrder::load_be64(ptr + 14) == 2);
+		assert(ByteOrder::load_be64(ptr + 22) == 2000);
+
+		ptr = decoded.first[1];
+		assert(ptr[0] == 0x20 && ByteOrder::load_be32(ptr + 12) == 2);
+		assert(ptr[31] == 1);
+		assert(ByteOrder::load_be64(ptr + 38) == 5);
+
+		// the next datagram has no templates and the sequence counts the data records
+		next = records;
+		const size_t second = encoder.encode(next, records + 1, datagram, uint64_t(OFFSET_MS) + 6000);
+		assert(ByteOrder::load_be32(datagram + 8) == 3);
+		assert(decode(datagram, second, FlowFormat::IPFIX).templates == 0);
+		assert(encoder.records() == 5);
+		next = records;
+		assert(encoder.encode(next, next, datagram, 0) == 0);
+	}
+
+	/**
+	 * NetFlow v9 datagrams of many flows, the templates are sent again every template_every datagrams.
+	 */
+	void case_1() noexcept {
+		TRACE_CALL;
+		const unsigned every = 4;
+		FlowEncoder encoder(FlowFormat::NETFLOW_V9, 1, HZ, OFFSET_MS, 512, every);
+		const size_t n = 300;
+		storage::FlowRecord records[n];
+		for(size_t i = 0; i < n; i++) {
+			records[i] = record(i % 5 ? 4 : 6, uint32_t(i), 1 + i % 3, i % 2);
+		}
+		size_t expected = 0;
+		for(const auto& rec : records) {
+			expected += (rec.flow.forward.packets != 0) + (rec.flow.reverse.packets != 0);
+		}
+		uint8_t datagram[512];
+		const storage::FlowRecord* next = records;
+		size_t encoded = 0;
+		uint32_t sequence = 0;
+		const uint64_t now_ms = uint64_t(OFFSET_MS) + 10000;
+		while(next != records + n) {
+			const size_t bytes = encoder.encode(next, records + n, datagram, now_ms);
+			assert(bytes > 0 && bytes <= 512);
+			assert(ByteOrder::load_be32(datagram + 12) == sequence);
+			const Decoded decoded = decode(datagram, bytes, FlowFormat::NETFLOW_V9);
+			assert(decoded.templates == (sequence % every == 0 ? 2u : 0u));
+			if(decoded.records[0]) {
+				// FIRST_SWITCHED is relative to the first datagram
+				assert(ByteOrder::load_be32(decoded.first[0] + 30) == 0);
+			}
+			encoded += decoded.records[0] + decoded.records[1];
+			sequence++;
+		}
+		assert(encoded == expected);
+		const size_t bytes = encoder.encode_templates(datagram, now_ms);
+		assert(decode(datagram, bytes, FlowFormat::NETFLOW_V9).templates == 2);
+	}
+
+	/**
+	 * Two packet threads export to a collector on the loopback.
+	 */
+	void case_2() noexcept {
+		TRACE_CALL;
+		const int collector = socket(AF_INET, SOCK_DGRAM, 0);
+		assert(collector >= 0);
+		const int rcvbuf = 4 << 20;
+		setsockopt(collector, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+		struct sockaddr_in addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		assert(bind(collector, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == 0);
+		socklen_t length = sizeof(addr);
+		assert(getsockname(collector, reinterpret_cast<struct sockaddr*>(&addr), &length) == 0);
+
+		const unsigned threads = 2;
+		const uint32_t flows = 500;
+		netflow::FlowExporter* exporter = new netflow::FlowExporter(FlowFormat::IPFIX, 3, HZ, OFFSET_MS, threads,
+			64 << 10);
+		assert(exporter->allocate() == 0);
+		assert(exporter->start(reinterpret_cast<struct sockaddr*>(&addr), length) == 0);
+		std::thread producers[threads];
+		for(unsigned id = 0; id < threads; id++) {
+			producers[id] = std::thread([exporter, id, flows]() {
+				netflow::FlowExporter::Sink sink = exporter->sink(id);
+				storage::FlowRecord batch[32]; // as FlowTable::BATCH
+				const size_t batch_size = sizeof(batch) / sizeof(batch[0]);
+				size_t filled = 0;
+				for(uint32_t i = 0; i < flows; i++) {
+					batch[filled++] = record(4, id * flows + i, 1, 0);
+					if(filled == batch_size || i + 1 == flows) {
+						while(not sink(batch, filled)) {
+							std::this_thread::yield();
+						}
+						filled = 0;
+					}
+				}
+			});
+		}
+		for(std::thread& producer : producers) {
+			producer.join();
+		}
+		exporter->stop();
+		const netflow::FlowExporterStat stat = exporter->stat();
+		assert(stat.pushed == threads * flows);
+		assert(stat.errors == 0);
+
+		uint8_t datagram[FlowEncoder::MTU];
+		unsigned received = 0;
+		uint64_t datagrams = 0;
+		for(;;) {
+			const ssize_t bytes = recv(collector, datagram, sizeof(datagram), MSG_DONTWAIT);
+			if(bytes <= 0) {
+				break;
+			}
+			received += decode(datagram, size_t(bytes), FlowFormat::IPFIX).records[0];
+			datagrams++;
+		}
+		assert(datagrams == stat.datagrams);
+		assert(received == threads * flows);
+		delete exporter;
+		close(collector);
+	}
+};
@@ -0,0 +1,190 @@
+#pragma once
+
+#include "test_environment.h"
+#include <proto/FlowKey.h>
+#include <containers/storage/TimedQueue.h>
+
+#include <arpa/inet.h>
+
+#include <cstring>
+#include <utility>
+
+class TestFlowKey {
+	using FlowKey = proto::FlowKey;
+
+	uint64_t m_seed;
+
+public:
+	TestFlowKey() noexcept : m_seed(1) {
+		case_0();
+		case_1();
+		case_2();
+		case_3();
+	}
+
+private:
+
+	static FlowKey key4(const char* src, uint16_t src_port, const char* dst, uint16_t dst_port) noexcept {
+		FlowKey key;
+		memset(&key, 0, sizeof(key));
+		assert(inet_pton(AF_INET, src, &key.src.addr32[0]) == 1);
+		assert(inet_pton(AF_INET, dst, &key.dst.addr32[0]) == 1);
+		key.src_port = htons(src_port);
+		key.dst_port = htons(dst_port);
+		key.protocol = proto::IPv4::PROTO_TCP;
+		key.version = 4;
+		return key;
+	}
+
+	static FlowKey key6(const char* src, uint16_t src_port, const char* dst, uint16_t dst_port) noexcept {
+		FlowKey key;
+		memset(&key, 0, sizeof(key));
+		assert(inet_pton(AF_INET6, src, &key.src) == 1);
+		assert(inet_pton(AF_INET6, dst, &key.dst) == 1);
+		key.src_port = htons(src_port);
+		key.dst_port = htons(dst_port);
+		key.protocol = proto::IPv4::PROTO_TCP;
+		key.version = 6;
+		return key;
+	}
+
+	static FlowKey reversed(const FlowKey& key) noexcept {
+		FlowKey result = key;
+		std::swap(result.src, result.dst);
+		std::swap(result.src_port, result.dst_port);
+		return result;
+	}
+
+	uint64_t random() noexcept {
+		m_seed = m_seed * 6364136223846793005ull + 1442695040888963407ull;
+		return m_seed >> 16;
+	}
+
+	FlowKey random_key(unsigned version) noexcept {
+		FlowKey key;
+		memset(&key, 0, sizeof(key));
+		key.version = uint8_t(version);
+		key.protocol = proto::IPv4::PROTO_UDP;
+		if(version == 4) {
+			key.src.addr32[0] = uint32_t(random());
+			key.dst.addr32[0] = uint32_t(random());
+		} else {
+			key.src.addr64[0] = random() ^ (random() << 32);
+			key.src.addr64[1] = random() ^ (random() << 32);
+			key.dst.addr64[0] = random() ^ (random() << 32);
+			key.dst.addr64[1] = random() ^ (random() << 32);
+		}
+		key.src_port = uint16_t(random());
+		key.dst_port = uint16_t(random());
+		return key;
+	}
+
+	/**
+	 * The verification vectors of the Microsoft RSS specification, with and without the ports.
+	 */
+	void case_0() noexcept {
+		TRACE_CALL;
+		static const uint8_t rss_key[proto::Toeplitz::KEY_BYTES] = {
+			0x6d, 0x5a, 0x56, 0xda, 0x25, 0x5b, 0x0e, 0xc2, 0x41, 0x67, 0x25, 0x3d, 0x43, 0xa3, 0x8f, 0xb0,
+			0xd0, 0xca, 0x2b, 0xcb, 0xae, 0x7b, 0x30, 0xb4, 0x77, 0xcb, 0x2d, 0xa3, 0x80, 0x30, 0xf2, 0x0c,
+			0x6a, 0x42, 0xb7, 0x3b, 0xbe, 0xac, 0x01, 0xfa
+		};
+		const proto::Toeplitz toeplitz(rss_key);
+
+		FlowKey key = key4("66.9.149.187", 2794, "161.142.100.80", 1766);
+		assert(toeplitz.hash(key) == 0x51ccc178);
+		key.src_port = key.dst_port = 0;
+		assert(toeplitz.hash(key) == 0x323e8fc2);
+		key = key4("199.92.111.2", 14230, "65.69.140.83", 4739);
+		assert(toeplitz.hash(key) == 0xc626b0ea);
+		key.src_port = key.dst_port = 0;
+		assert(toeplitz.hash(key) == 0xd718262a);
+
+		key = key6("3ffe:2501:200:1fff::7", 2794, "3ffe:2501:200:3::1", 1766);
+		assert(toeplitz.hash(key) == 0x40207d3d);
+		key.src_port = key.dst_port = 0;
+		assert(toeplitz.hash(key) == 0x2cc18cd5);
+		key = key6("3ffe:501:8::260:97ff:fe40:efab", 14230, "ff02::1", 4739);
+		assert(toeplitz.hash(key) == 0xdde51bbf);
+	}
+
+	/**
+	 * The CRC32C check values of the table or of the SSE 4.2 instruction (-msse4.2), at any split of the data.
+	 */
+	void case_1() noexcept {
+		TRACE_CALL;
+		assert(proto::Crc32c::compute("123456789", 9) == 0xE3069283);
+		assert(proto::Crc32c::compute("", 0) == 0);
+		// the CRC extends over the pieces at any split
+		const char* text = "The quick brown fox jumps over the lazy dog";
+		const size_t length = strlen(text);
+		const uint32_t whole = proto::Crc32c::compute(text, length);
+		assert(whole == 0x22620404);
+		for(size_t split = 0; split <= length; split++) {
+			const uint32_t head = proto::Crc32c::extend(~uint32_t(0), text, split);
+			assert(~proto::Crc32c::extend(head, text + split, length - split) == whole);
+		}
+	}
+
+	/**
+	 * The symmetric hashes give the same value to both directions, canonical() gives them the same key.
+	 */
+	void case_2() noexcept {
+		TRACE_CALL;
+		const proto::ToeplitzFlowHash toeplitz;
+		const proto::Crc32cFlowHash crc;
+		const std::hash<FlowKey> hash;
+		for(unsigned i = 0; i < 10000; i++) {
+			const FlowKey key = random_key(i % 2 ? 4 : 6);
+			const FlowKey back = reversed(key);
+			assert(toeplitz(key) == toeplitz(back));
+			assert(crc(key) == crc(back) && hash(key) == crc(key));
+			assert(key.canonical() == back.canonical());
+			assert(key.canonical() == key || key.canonical() == back);
+			// the 32-bit value is repeated in the high half
+			assert((uint64_t(toeplitz(key)) >> 32) == (uint64_t(toeplitz(key)) & 0xFFFFFFFF));
+		}
+
+		// the same endpoints with the swapped ports are another flow
+		const FlowKey key = key4("10.0.0.1", 1000, "10.0.0.2", 2000);
+		FlowKey other = key;
+		std::swap(other.src_port, other.dst_port);
+		assert(not (key == other) && crc(key) != crc(other));
+		// an endpoint of the same address orders by the port
+		const FlowKey loop = key4("10.0.0.1", 2000, "10.0.0.1", 1000);
+		assert(loop.canonical().src_port == htons(1000) && reversed(loop).canonical() == loop.canonical());
+	}
+
+	/**
+	 * FlowKey::of() takes the ports of TCP and UDP only, the hashes serve a TimedQueue.
+	 */
+	void case_3() noexcept {
+		TRACE_CALL;
+		proto::ParsedFlow flow;
+		memset(&flow, 0, sizeof(flow));
+		flow.ip_version = 4;
+		flow.ip_protocol = proto::IPv4::PROTO_GRE;
+		flow.src.addr32[0] = htonl(0x0A000001);
+		flow.dst.addr32[0] = htonl(0x0A000002);
+		flow.src_port = 1;
+		flow.dst_port = 2;
+		flow.protocols = 1u << proto::Protocol::L4_GRE;
+		FlowKey key = FlowKey::of(flow);
+		assert(key.src_port == 0 && key.dst_port == 0 && key.protocol == proto::IPv4::PROTO_GRE);
+		flow.protocols = 1u << proto::Protocol::L4_UDP;
+		key = FlowKey::of(flow);
+		assert(key.src_port == 1 && key.dst_port == 2 && key.version == 4 && key.reserved == 0);
+
+		using Node_t = storage::TimedQueueNode<FlowKey, unsigned>;
+		storage::TimedQueue<Node_t, proto::ToeplitzFlowHash> queue(256, 1.0f);
+		assert(queue.allocate() == 0);
+		for(unsigned i = 0; i < 256; i++) {
+			auto it = queue.push_back(random_key(4).canonical());
+			assert(it);
+			it->value = i;
+		}
+		const FlowKey first = queue.pop_front(0)->im_key;
+		assert(not queue.find(first));
+		assert(queue.size() == 255);
+	}
+};
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "test_environment.h"
+#include <cli/types/MacAddress.h>
+
+#include <cstring>
+#include <unordered_set>
+
+class TestMacAddress {
+public:
+	TestMacAddress() noexcept {
+		case_0();
+		case_1();
+		case_2();
+	}
+
+private:
+
+	void case_0() noexcept {
+		TRACE_CALL;
+		cli::MacAddress mac;
+		assert(mac.empty());
+		assert(mac.parse("00:1B:44:11:3a:b7") == 17);
+		assert(mac.value() == 0x001B44113AB7ull);
+		assert(cli::MacAddress::from_value(mac.value()) == mac);
+		assert(not mac.empty());
+
+		cli::MacAddress other;
+		assert(other.parse("1.1b.44.11.3A.B7") == 16);
+		assert(other.value() == 0x011B44113AB7ull);
+		assert(mac != other);
+		assert(mac.parse("001b44113ab7") == 12);
+		assert(mac.value() == 0x001B44113AB7ull);
+		assert(mac.parse("00:1b:44:11:3a") < 0);
+		assert(mac.parse("zz:1b:44:11:3a:b7") < 0);
+	}
+
+	/**
+	 * The addresses are ordered as their bytes.
+	 */
+	void case_1() noexcept {
+		TRACE_CALL;
+		const uint8_t a[] = {0x00, 0xff, 0x00, 0x00, 0x00, 0x00};
+		const uint8_t b[] = {0x01, 0x00, 0x00, 0x00, 0x00, 0x00};
+		const cli::MacAddress mac_a(a, sizeof(a));
+		const cli::MacAddress mac_b(b, sizeof(b));
+		assert(mac_a < mac_b);
+		assert(not (mac_b < mac_a));
+		assert(not (mac_a < mac_a));
+		uint32_t seed = 7;
+		for(unsigned i = 0; i < 1000; i++) {
+			uint8_t x[cli::MacAddress::ADDR_SIZE];
+			uint8_t y[cli::MacAddress::ADDR_SIZE];
+			for(size_t j = 0; j < sizeof(x); j++) {
+				seed = seed * 1103515245u + 12345u;
+				x[j] = uint8_t(seed >> 16) & 3;
+				y[j] = uint8_t(seed >> 24) & 3;
+			}
+			const cli::MacAddress mac_x(x, sizeof(x));
+			const cli::MacAddress mac_y(y, sizeof(y));
+			assert((mac_x < mac_y) == (memcmp(x, y, sizeof(x)) < 0));
+			assert((mac_x == mac_y) == (memcmp(x, y, sizeof(x)) == 0));
+		}
+	}
+
+	void case_2() noexcept {
+		TRACE_CALL;
+		cli::MacAddress macs[4];
+		size_t offset;
+		const char* list = " 00:00:00:00:00:01,00:00:00:00:00:02\n00:00:00:00:00:03 \n";
+		assert(cli::MacAddress::parse_list(list, macs, 4, offset) == 3);
+		assert(list[offset] == 0);
+		assert(macs[2].value() == 3);
+		assert(cli::MacAddress::parse_list(list, macs, 2, offset) == 2);
+		assert(offset == 37);
+
+		const char* broken = "00:00:00:00:00:01, 00:00:00:00:00:0x";
+		assert(cli::MacAddress::parse_list(broken, macs, 4, offset) == 1);
+		assert(offset == 19);
+
+		std::unordered_set<cli::MacAddress> set;
+		for(uint64_t i = 0; i < 1000; i++) {
+			set.insert(cli::MacAddress::from_value(i << 24));
+		}
+		assert(set.size() == 1000);
+		assert(set.count(cli::MacAddress::from_value(999ull << 24)));
+		assert(not set.count(cli::MacAddress::from_value(1000ull << 24)));
+	}
+
+};
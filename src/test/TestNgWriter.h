@@ -0,0 +1,176 @@
+#pragma once
+
+#include "test_environment.h"
+#include <pcapwrap/NgWriter.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+class TestNgWriter {
+	using NgReader = pcapwrap::NgReader;
+	using NgWriter = pcapwrap::NgWriter;
+
+	/**
+	 * A frame and its bytes as they are written.
+	 */
+	struct Record {
+		pcapwrap::Frame frame;
+		std::vector<uint8_t> data;
+	};
+
+	char m_file_name[32];
+	std::vector<Record> m_records;
+	std::vector<size_t> m_ends; // of the blocks of the file
+	std::vector<uint8_t> m_file;
+
+public:
+	TestNgWriter() noexcept : m_file_name("/tmp/TestNgWriter.XXXXXX"), m_records(), m_ends(), m_file() {
+		const int fd = mkstemp(m_file_name);
+		assert(fd >= 0);
+		close(fd);
+		case_0();
+		case_1();
+		case_2();
+		unlink(m_file_name);
+	}
+
+private:
+
+	static bool same(const pcapwrap::Frame& frame, const Record& record) noexcept {
+		return frame.m_hdr.caplen == record.frame.m_hdr.caplen && frame.m_hdr.len == record.frame.m_hdr.len
+			&& frame.nanosec() == record.frame.nanosec() && frame.m_interface == record.frame.m_interface
+			&& frame.m_flags == record.frame.m_flags
+			&& (record.data.empty() || memcmp(frame.m_data, record.data.data(), record.data.size()) == 0);
+	}
+
+	/**
+	 * The section, the interfaces and the frames of all the lengths are read back, a frame of an unknown
+	 * interface is dropped.
+	 */
+	void case_0() noexcept {
+		TRACE_CALL;
+		for(uint32_t i = 0; i < 64; i++) {
+			Record record;
+			record.data.resize(i * 7 % 101);
+			for(size_t k = 0; k < record.data.size(); k++) {
+				record.data[k] = uint8_t(i + k);
+			}
+			record.frame.m_hdr.caplen = uint32_t(record.data.size());
+			record.frame.m_hdr.len = record.frame.m_hdr.caplen + (i % 3 ? 0 : 1000);
+			record.frame.nanosec(uint64_t(1500000000) * 1000000000 + i * 1234567ull);
+			record.frame.m_interface = i % 2;
+			record.frame.m_flags = i % 4 ? 0 : 0x00000001 | (i << 16);
+			m_records.push_back(record);
+		}
+
+		{
+			NgWriter writer = NgWriter::open(m_file_name, "the section");
+			assert(writer.add_interface(DLT_EN10MB, 65535, "eth0") == 0);
+			assert(writer.add_interface(DLT_EN10MB + 100, 0) == 1);
+			for(Record& record : m_records) {
+				record.frame.m_data = record.data.data();
+				if(record.frame.m_hdr.caplen % 5 == 0) {
+					writer.write(record.frame, "a comment of the frame");
+				} else {
+					writer.write(record.frame);
+				}
+			}
+			pcapwrap::Frame unknown = m_records[0].frame;
+			unknown.m_interface = 2;
+			writer.write(unknown);
+			assert(writer.frame_index() == m_records.size());
+			assert(writer.bytes() == 0);
+			assert(writer.close() == 0 && writer.error() == 0);
+		}
+
+		NgReader reader = NgReader::open(m_file_name);
+		assert(reader.comment() == "the section");
+		pcapwrap::Frame frame;
+		for(const Record& record : m_records) {
+			assert(reader.next(frame));
+			assert(same(frame, record));
+		}
+		assert(not reader.next(frame) && not reader.truncated());
+		assert(reader.frame_index() == m_records.size());
+		assert(reader.interfaces().size() == 2);
+		assert(reader.interfaces()[0].name == "eth0" && reader.interfaces()[0].snaplen == 65535);
+		assert(reader.interfaces()[1].linktype == DLT_EN10MB + 100 && reader.interfaces()[1].name.empty());
+		assert(reader.interfaces()[0].ticks == 1000000000 && reader.interfaces()[1].ticks == 1000000000);
+	}
+
+	/**
+	 * Every prefix of the file is read up to its last whole block, the rest is truncated.
+	 */
+	void case_1() noexcept {
+		TRACE_CALL;
+		const int fd = open(m_file_name, O_RDONLY);
+		assert(fd >= 0);
+		uint8_t buffer[4096];
+		ssize_t bytes;
+		while((bytes = read(fd, buffer, sizeof(buffer))) > 0) {
+			m_file.insert(m_file.end(), buffer, buffer + bytes);
+		}
+		close(fd);
+		for(size_t offset = 0; offset < m_file.size(); ) {
+			uint32_t length;
+			memcpy(&length, &m_file[offset + sizeof(uint32_t)], sizeof(length));
+			offset += length;
+			m_ends.push_back(offset);
+		}
+		assert(m_ends.back() == m_file.size());
+		assert(m_ends.size() == 1 + 2 + m_records.size());
+
+		for(size_t bytes = 0; bytes <= m_file.size(); bytes++) {
+			if(bytes < m_ends[0]) {
+				bool thrown = false;
+				try {
+					NgReader::open(m_file.data(), bytes);
+				} catch(const std::runtime_error&) {
+					thrown = true;
+				}
+				assert(thrown);
+				continue;
+			}
+			size_t blocks = 0;
+			while(blocks < m_ends.size() && m_ends[blocks] <= bytes) {
+				blocks++;
+			}
+			NgReader reader = NgReader::open(m_file.data(), bytes);
+			pcapwrap::Frame frame;
+			size_t frames = 0;
+			while(reader.next(frame)) {
+				assert(same(frame, m_records[frames]));
+				frames++;
+			}
+			assert(frames == (blocks > 3 ? blocks - 3 : 0));
+			assert(reader.truncated() == (m_ends[blocks - 1] != bytes));
+		}
+	}
+
+	/**
+	 * A comment and a name longer than an option can hold are cut to OPTION_BYTES_MAX.
+	 */
+	void case_2() noexcept {
+		TRACE_CALL;
+		const std::string comment(NgWriter::OPTION_BYTES_MAX + 1000, 'c');
+		const std::string name(NgWriter::OPTION_BYTES_MAX + 1, 'n');
+		{
+			NgWriter writer = NgWriter::open(m_file_name, comment);
+			assert(writer.add_interface(DLT_EN10MB, 0, name) == 0);
+			writer.write(m_records[2].frame, comment);
+			assert(writer.close() == 0);
+		}
+		NgReader reader = NgReader::open(m_file_name);
+		assert(reader.comment() == comment.substr(0, NgWriter::OPTION_BYTES_MAX));
+		pcapwrap::Frame frame;
+		assert(reader.next(frame) && same(frame, m_records[2]));
+		assert(reader.interfaces()[0].name == name.substr(0, NgWriter::OPTION_BYTES_MAX));
+		assert(reader.interfaces()[0].ticks == 1000000000);
+		assert(not reader.next(frame) && not reader.truncated());
+	}
+};
@@ -0,0 +1,283 @@
+#pragma once
+
+#include "test_environment.h"
+#include <proto/PatternMatcher.h>
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+class TestPatternMatcher {
+	/**
+	 * A frame as pcapwrap::Frame keeps it.
+	 */
+	struct Frame {
+		struct {
+			uint32_t caplen;
+		} m_hdr;
+		const uint8_t* m_data;
+	};
+
+	using Matcher = proto::PatternMatcher;
+	using Match = std::tuple<uint64_t, uint32_t, uint32_t>; // the end, the id, the length
+
+public:
+	TestPatternMatcher() noexcept {
+		case_0();
+		case_1();
+		case_2();
+		case_3();
+	}
+
+private:
+
+	static std::vector<proto::MatchPattern> of(const std::vector<std::string>& strings) noexcept {
+		std::vector<proto::MatchPattern> result;
+		for(size_t i = 0; i < strings.size(); i++) {
+			result.push_back({reinterpret_cast<const uint8_t*>(strings[i].data()), strings[i].size(), uint32_t(100 + i)});
+		}
+		return result;
+	}
+
+	/**
+	 * The matches of memmem loops over each pattern, in the order of PatternMatcher.
+	 */
+	static std::vector<Match> naive(const std::vector<std::string>& strings, const std::string& text) noexcept {
+		std::vector<Match> result;
+		for(size_t i = 0; i < strings.size(); i++) {
+			const char* from = text.data();
+			const char* const end = text.data() + text.size();
+			while(const void* found = memmem(from, size_t(end - from), strings[i].data(), strings[i].size())) {
+				const char* at = static_cast<const char*>(found);
+				result.emplace_back(uint64_t(at - text.data() + strings[i].size()), uint32_t(100 + i), uint32_t(strings[i].size()));
+				from = at + 1;
+			}
+		}
+		std::stable_sort(result.begin(), result.end(), [](const Match& a, const Match& b) {
+			return std::get<0>(a) != std::get<0>(b) ? std::get<0>(a) < std::get<0>(b) : std::get<2>(a) > std::get<2>(b);
+		});
+		return result;
+	}
+
+	static std::vector<Match> scan(const Matcher& matcher, proto::MatchStream& stream, const std::string& text) noexcept {
+		std::vector<Match> result;
+		const size_t count = matcher.scan(stream, reinterpret_cast<const uint8_t*>(text.data()), text.size(),
+			[&](uint32_t id, uint64_t end, uint32_t length) { result.emplace_back(end, id, length); });
+		assert(count == result.size());
+		return result;
+	}
+
+	/**
+	 * The overlapping patterns, the prefixes, the suffixes and the duplicates are found as memmem finds them.
+	 */
+	void case_0() noexcept {
+		TRACE_CALL;
+		const std::vector<std::string> strings = {"he", "she", "his", "hers", "e", "she", "usher", std::string("\x00\xff", 2)};
+		const std::vector<proto::MatchPattern> patterns = of(strings);
+		Matcher matcher(16, 64);
+		assert(matcher.allocate() == 0);
+		assert(matcher.allocate() != 0);
+		assert(matcher.size() == 0 && matcher.first(reinterpret_cast<const uint8_t*>("he"), 2) == Matcher::NO_MATCH);
+		assert(matcher.build(patterns.data(), patterns.size()));
+		assert(matcher.size() == strings.size() && matcher.states() == 18);
+
+		const std::string text = std::string("ushers his hershe ") + std::string("\x00\xff\x00", 3) + "usher";
+		proto::MatchStream stream;
+		const std::vector<Match> matches = scan(matcher, stream, text);
+		assert(matches == naive(strings, text));
+		assert(stream.offset == text.size());
+		// the longest first, the duplicates in the order of the set
+		assert(std::get<1>(matches[0]) == 101 && std::get<1>(matches[1]) == 105 && std::get<1>(matches[2]) == 100);
+		assert(std::get<1>(matches[3]) == 104 && std::get<0>(matches[3]) == 4);
+		assert(matcher.first(reinterpret_cast<const uint8_t*>(text.data()), text.size()) == 101); // "she" of "ushe"
+		assert(matcher.first(reinterpret_cast<const uint8_t*>("xyz"), 3) == Matcher::NO_MATCH);
+
+		// the caps leave the set empty
+		const std::vector<std::string> large(17, "x");
+		assert(not matcher.build(of(large).data(), large.size()));
+		assert(matcher.size() == 0 && matcher.states() == 1);
+		const std::vector<std::string> long_ones = {std::string(40, 'a'), std::string(25, 'b')};
+		assert(not matcher.build(of(long_ones).data(), 2));
+		const std::vector<std::string> empty = {"a", ""};
+		assert(not matcher.build(of(empty).data(), 2));
+		const std::vector<std::string> fit = {std::string(40, 'a'), std::string(24, 'b')};
+		assert(matcher.build(of(fit).data(), 2) && matcher.states() == 65);
+	}
+
+	/**
+	 * Thousands of random patterns over a random text, the text is scanned at once and in the segments
+	 * of a stream, the matches which span the segments are found too.
+	 */
+	void case_1() noexcept {
+		TRACE_CALL;
+		std::mt19937 random(7);
+		for(const unsigned alphabet : {4u, 26u, 256u}) {
+			std::vector<std::string> strings;
+			size_t bytes = 0;
+			for(unsigned i = 0; i < 2000; i++) {
+				std::string pattern(1 + random() % 8, 0);
+				for(char& ch : pattern) {
+					ch = char(alphabet == 26 ? 'a' + random() % 26 : random() % alphabet);
+				}
+				strings.push_back(pattern);
+				bytes += pattern.size();
+			}
+			std::string text(20000, 0);
+			for(char& ch : text) {
+				ch = char(alphabet == 26 ? 'a' + random() % 26 : random() % alphabet);
+			}
+			const std::vector<proto::MatchPattern> patterns = of(strings);
+			Matcher matcher(strings.size(), bytes);
+			assert(matcher.allocate() == 0);
+			assert(matcher.build(patterns.data(), patterns.size()));
+			printf("alphabet=%u states=%zu prefiltered=%d storage=%zu\n", alphabet, matcher.states(), matcher.prefiltered(),
+			       matcher.storage_bytes());
+
+			const std::vector<Match> expected = naive(strings, text);
+			proto::MatchStream stream;
+			assert(scan(matcher, stream, text) == expected);
+
+			proto::MatchStream segments;
+			std::vector<Match> streamed;
+			for(size_t offset = 0; offset < text.size(); ) {
+				const size_t length = std::min<size_t>(1 + random() % 1500, text.size() - offset);
+				const std::vector<Match> part = scan(matcher, segments, text.substr(offset, length));
+				streamed.insert(streamed.end(), part.begin(), part.end());
+				offset += length;
+			}
+			assert(streamed == expected && segments.offset == text.size());
+		}
+
+		// a sparse set of the first bytes takes the prefilter, the candidates are in every position of a chunk
+		const std::vector<std::string> strings = {"GET /", "POST /", "HTTP/1.", "\r\n\r\n"};
+		const std::vector<proto::MatchPattern> patterns = of(strings);
+		Matcher matcher(4, 32);
+		assert(matcher.allocate() == 0 && matcher.build(patterns.data(), patterns.size()));
+		std::string text;
+		for(unsigned i = 0; i < 200; i++) {
+			text += std::string(i % 37, char(0x80 + i % 64)) + strings[i % 4];
+		}
+		proto::MatchStream stream;
+		assert(scan(matcher, stream, text) == naive(strings, text));
+	}
+
+	/**
+	 * Ethernet -> IPv4 -> UDP/TCP -> @payload with 6 bytes of the frame padding, or IPv6 if @v6.
+	 */
+	static std::vector<uint8_t> packet(const std::string& payload, bool tcp, bool v6 = false) noexcept {
+		const size_t l3 = v6 ? 40 : 20;
+		const size_t l4 = tcp ? 20 : 8;
+		std::vector<uint8_t> pkt(14 + l3 + l4 + payload.size() + 6, 0xAA);
+		uint8_t* ptr = pkt.data();
+		memset(ptr, 0x02, 12);
+		utils::ByteOrder::store_be16(ptr + 12, v6 ? 0x86DD : 0x0800);
+		ptr += 14;
+		memset(ptr, 0, l3 + l4);
+		if(v6) {
+			ptr[0] = 0x60;
+			utils::ByteOrder::store_be16(ptr + 4, uint16_t(l4 + payload.size()));
+			ptr[6] = tcp ? proto::IPv4::PROTO_TCP : proto::IPv4::PROTO_UDP;
+			ptr[7] = 64;
+		} else {
+			ptr[0] = 0x45;
+			utils::ByteOrder::store_be16(ptr + 2, uint16_t(l3 + l4 + payload.size()));
+			ptr[8] = 64;
+			ptr[9] = tcp ? proto::IPv4::PROTO_TCP : proto::IPv4::PROTO_UDP;
+			utils::ByteOrder::store_be32(ptr + 12, 0x0A000001);
+			utils::ByteOrder::store_be32(ptr + 16, 0x0A000002);
+		}
+		ptr += l3;
+		utils::ByteOrder::store_be16(ptr, 1234);
+		utils::ByteOrder::store_be16(ptr + 2, 80);
+		if(tcp) {
+			ptr[12] = 5 << 4;
+		} else {
+			utils::ByteOrder::store_be16(ptr + 4, uint16_t(l4 + payload.size()));
+		}
+		memcpy(ptr + l4, payload.data(), payload.size());
+		return pkt;
+	}
+
+	/**
+	 * A burst: the first match of every payload, the headers and the padding are not scanned.
+	 */
+	void case_2() noexcept {
+		TRACE_CALL;
+		const std::vector<std::string> strings = {"attack", "tack", "\xAA\xAA", "evil.example"};
+		const std::vector<proto::MatchPattern> patterns = of(strings);
+		Matcher matcher(8, 64);
+		assert(matcher.allocate() == 0 && matcher.build(patterns.data(), patterns.size()));
+
+		const std::string payloads[] = {"GET /attack HTTP/1.1", "nothing here", "", "attack", "host: evil.example\r\n",
+			"stack", "ck", "\x01\x02"};
+		const uint32_t expected[] = {100, Matcher::NO_MATCH, Matcher::NO_MATCH, 100, 103, 101, Matcher::NO_MATCH,
+			Matcher::NO_MATCH, Matcher::NO_MATCH}; // the padding of the last one and the headers aren't payloads
+		std::vector<std::vector<uint8_t> > packets;
+		for(size_t i = 0; i < 8; i++) {
+			packets.push_back(packet(payloads[i], i % 2, i == 4));
+		}
+		packets.push_back(std::vector<uint8_t>(60, 0xAA)); // not IP
+		const size_t n = packets.size();
+		std::vector<Frame> frames(n);
+		std::vector<proto::ParsedPacket> parsed(n);
+		for(size_t i = 0; i < n; i++) {
+			frames[i].m_data = packets[i].data();
+			frames[i].m_hdr.caplen = uint32_t(packets[i].size());
+		}
+		proto::PacketParser::parse_burst(frames.data(), n, parsed.data());
+		std::vector<uint32_t> ids(n, 0);
+		assert(matcher.match_burst(frames.data(), parsed.data(), n, ids.data()) == 4);
+		for(size_t i = 0; i < n; i++) {
+			assert(ids[i] == expected[i]);
+		}
+		size_t begin, end;
+		assert(Matcher::payload(packets[0].data(), packets[0].size(), parsed[0], begin, end));
+		assert(begin == 14 + 20 + 8 && end - begin == payloads[0].size());
+		assert(not Matcher::payload(packets[8].data(), packets[8].size(), parsed[8], begin, end));
+
+		// the frame head of a parser
+		proto::RoMFrame frame(packets[4].data() + 14 + 40 + 8, payloads[4].size());
+		proto::MatchStream stream;
+		uint32_t found = 0;
+		assert(matcher.scan(stream, frame, [&](uint32_t id, uint64_t, uint32_t) { found = id; }) == 1 && found == 103);
+	}
+
+	/**
+	 * A rebuild replaces the set, the burst of many payloads refills the lanes.
+	 */
+	void case_3() noexcept {
+		TRACE_CALL;
+		Matcher matcher(4, 16);
+		assert(matcher.allocate() == 0);
+		const std::vector<std::string> first = {"abc"};
+		const std::vector<std::string> second = {"xyz", "bc"};
+		assert(matcher.build(of(first).data(), 1));
+		assert(matcher.first(reinterpret_cast<const uint8_t*>("zabcz"), 5) == 100);
+		assert(matcher.build(of(second).data(), 2));
+		assert(matcher.first(reinterpret_cast<const uint8_t*>("zabcz"), 5) == 101);
+
+		std::vector<std::vector<uint8_t> > packets;
+		for(unsigned i = 0; i < 100; i++) {
+			std::string payload(i % 50, 'q');
+			if(i % 3 == 0) {
+				payload.insert(payload.size() / 2, "xyz");
+			}
+			packets.push_back(packet(payload, i % 2));
+		}
+		std::vector<Frame> frames(packets.size());
+		std::vector<proto::ParsedPacket> parsed(packets.size());
+		for(size_t i = 0; i < packets.size(); i++) {
+			frames[i].m_data = packets[i].data();
+			frames[i].m_hdr.caplen = uint32_t(packets[i].size());
+			proto::PacketParser::parse(frames[i].m_data, frames[i].m_hdr.caplen, parsed[i]);
+		}
+		std::vector<uint32_t> ids(packets.size(), 0);
+		assert(matcher.match_burst(frames.data(), parsed.data(), packets.size(), ids.data()) == 34);
+		for(size_t i = 0; i < packets.size(); i++) {
+			assert(ids[i] == (i % 3 == 0 ? 100 : Matcher::NO_MATCH));
+		}
+	}
+};
@@ -0,0 +1,214 @@
+#pragma once
+
+#include "test_environment.h"
+#include <pcapwrap/IndexedReader.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+class TestPcapIndex {
+	using PcapIndex = pcapwrap::PcapIndex;
+	using IndexedReader = pcapwrap::IndexedReader;
+	using PcapIndexEntry = pcapwrap::PcapIndexEntry;
+
+	static constexpr uint32_t FRAMES = 3000;
+	static constexpr uint64_t START_NS = uint64_t(1000000000) * 100;
+
+	char m_file_name[32];
+	std::vector<uint64_t> m_ns; // of the frames
+	size_t m_end; // the end of the last record
+
+public:
+	TestPcapIndex() noexcept : m_file_name("/tmp/TestPcapIndex.XXXXXX"), m_ns(), m_end(0) {
+		const int fd = mkstemp(m_file_name);
+		assert(fd >= 0);
+		close(fd);
+		write_pcap();
+		case_0();
+		case_1();
+		case_2();
+		unlink(PcapIndex::sidecar(m_file_name).c_str());
+		unlink(m_file_name);
+	}
+
+private:
+
+	static void append(const std::string& file_name, const void* data, size_t bytes) noexcept {
+		FILE* out = fopen(file_name.c_str(), "ab");
+		assert(out);
+		assert(fwrite(data, 1, bytes, out) == bytes);
+		fclose(out);
+	}
+
+	/**
+	 * The frames of a millisecond each, most of them lag by 5 ms as of a merged capture, the frame index is
+	 * the first bytes of the data. A torn record header follows the last record.
+	 */
+	void write_pcap() noexcept {
+		FILE* out = fopen(m_file_name, "wb");
+		assert(out);
+		const uint32_t header[6] = {pcapwrap::MappedReader::MAGIC_NSEC, 0x00040002, 0, 0, 65535, DLT_EN10MB};
+		fwrite(header, sizeof(header), 1, out);
+		m_end = sizeof(header);
+		for(uint32_t i = 0; i < FRAMES; i++) {
+			const uint64_t ns = START_NS + uint64_t(i) * 1000000 + (i % 37 ? 5000000 : 0);
+			m_ns.push_back(ns);
+			const uint32_t record[4] = {uint32_t(ns / 1000000000), uint32_t(ns % 1000000000), 20 + i % 7, 60};
+			uint8_t data[32] = {0};
+			memcpy(data, &i, sizeof(i));
+			fwrite(record, sizeof(record), 1, out);
+			fwrite(data, record[2], 1, out);
+			m_end += sizeof(record) + record[2];
+		}
+		fwrite("torn", 4, 1, out);
+		fclose(out);
+	}
+
+	static uint32_t number(const pcapwrap::Frame& frame) noexcept {
+		uint32_t result;
+		memcpy(&result, frame.m_data, sizeof(result));
+		return result;
+	}
+
+	/**
+	 * The chunks are cut by the frames and by the time, their ranges hold their frames, the index is loaded back.
+	 */
+	void case_0() noexcept {
+		TRACE_CALL;
+		const PcapIndex index = PcapIndex::build(m_file_name, 100, 50000000);
+		assert(index.frames() == FRAMES && index.end_offset(index.size() - 1) == m_end);
+		assert(index.size() > FRAMES / 100);
+		size_t frames = 0;
+		for(size_t i = 0; i < index.size(); i++) {
+			const PcapIndexEntry& entry = index[i];
+			const uint64_t last = i + 1 < index.size() ? index[i + 1].frame_idx : FRAMES;
+			assert(entry.frame_idx == frames && last > entry.frame_idx && last - entry.frame_idx <= 100);
+			assert(entry.offset < index.end_offset(i));
+			for(uint64_t frame = entry.frame_idx; frame < last; frame++) {
+				assert(m_ns[frame] >= entry.ts_min && m_ns[frame] <= entry.ts_max);
+			}
+			frames = last;
+		}
+
+		for(uint64_t frame = 1; frame <= FRAMES; frame++) {
+			const size_t chunk = index.find_frame(frame);
+			assert(chunk < index.size() && index[chunk].frame_idx < frame);
+			assert(chunk + 1 == index.size() || index[chunk + 1].frame_idx >= frame);
+		}
+		assert(index.find_frame(0) == index.size() && index.find_frame(FRAMES + 1) == index.size());
+		assert(index.find_time(0) == 0 && index.find_time(m_ns.back() + 1) == index.size());
+		assert(index.find_time_end(START_NS) == index.size() && index.find_time_end(UINT64_MAX) == index.size() - 1);
+
+		index.write(PcapIndex::sidecar(m_file_name));
+		const PcapIndex loaded = PcapIndex::load(PcapIndex::sidecar(m_file_name), index.pcap_bytes());
+		assert(loaded.size() == index.size() && loaded.frames() == FRAMES && loaded.pcap_bytes() == index.pcap_bytes());
+		for(size_t i = 0; i < index.size(); i++) {
+			assert(memcmp(&loaded[i], &index[i], sizeof(PcapIndexEntry)) == 0);
+		}
+	}
+
+	/**
+	 * A time range gives its frames only, the lagged ones too, a frame seek keeps the indices of the file.
+	 */
+	void case_1() noexcept {
+		TRACE_CALL;
+		IndexedReader reader = IndexedReader::open(m_file_name);
+		const uint64_t ranges[][2] = {
+			{START_NS + 500 * 1000000ull, START_NS + 700 * 1000000ull},
+			{START_NS + 37 * 1000000ull, START_NS + 37 * 1000000ull + 1}, // a lagged frame and one before it
+			{START_NS, START_NS + 1}, // the first frame
+			{m_ns.back(), UINT64_MAX}, // the last one
+			{0, UINT64_MAX}
+		};
+		for(const auto& range : ranges) {
+			assert(reader.seek_time(range[0], range[1]));
+			pcapwrap::Frame frames[32];
+			size_t burst;
+			size_t got = 0;
+			uint64_t previous = 0;
+			while((burst = reader.next_burst(frames, 32))) {
+				for(size_t i = 0; i < burst; i++) {
+					const uint32_t frame = number(frames[i]);
+					assert(frames[i].m_idx == frame + 1 && frames[i].m_idx > previous);
+					assert(frames[i].nanosec() == m_ns[frame] && m_ns[frame] >= range[0] && m_ns[frame] < range[1]);
+					previous = frames[i].m_idx;
+					got++;
+				}
+			}
+			size_t expected = 0;
+			for(const uint64_t ns : m_ns) {
+				expected += ns >= range[0] && ns < range[1];
+			}
+			assert(got == expected && got > 0);
+		}
+		pcapwrap::Frame frame;
+		assert(not reader.seek_time(0, START_NS) && not reader.next(frame));
+		assert(not reader.seek_time(m_ns.back() + 1) && not reader.next(frame));
+		assert(not reader.seek_time(START_NS + 10, START_NS + 10));
+
+		for(const uint64_t idx : {uint64_t(1), uint64_t(100), uint64_t(101), uint64_t(1234), uint64_t(FRAMES)}) {
+			assert(reader.seek_frame(idx) && reader.next(frame));
+			assert(frame.m_idx == idx && number(frame) == idx - 1);
+		}
+		assert(not reader.next(frame) && reader.reader().offset() == m_end);
+		assert(not reader.seek_frame(0) && not reader.next(frame));
+		assert(not reader.seek_frame(FRAMES + 1) && not reader.next(frame));
+		// a frame seek resets the time range
+		assert(reader.seek_time(START_NS, START_NS + 1) && reader.seek_frame(FRAMES - 1));
+		assert(reader.next(frame) && reader.next(frame) && not reader.next(frame));
+	}
+
+	/**
+	 * The index of a file which has grown, a broken or truncated index and a missing one are rejected.
+	 */
+	void case_2() noexcept {
+		TRACE_CALL;
+		const std::string sidecar = PcapIndex::sidecar(m_file_name);
+		std::vector<uint8_t> saved;
+		{
+			FILE* in = fopen(sidecar.c_str(), "rb");
+			assert(in);
+			int c;
+			while((c = fgetc(in)) != EOF) {
+				saved.push_back(uint8_t(c));
+			}
+			fclose(in);
+		}
+		const auto rejected = [this](const char* reason) noexcept -> bool {
+			try {
+				IndexedReader::open(m_file_name);
+			} catch(const std::runtime_error& e) {
+				return strstr(e.what(), reason) != nullptr;
+			}
+			return false;
+		};
+		const auto rewrite = [&sidecar](const std::vector<uint8_t>& bytes) noexcept {
+			unlink(sidecar.c_str());
+			append(sidecar, bytes.data(), bytes.size());
+		};
+
+		append(m_file_name, "x", 1);
+		assert(rejected("the index is stale"));
+		PcapIndex::build(m_file_name, 100, 50000000).write(sidecar);
+		assert(IndexedReader::open(m_file_name).index().frames() == FRAMES);
+
+		rewrite(std::vector<uint8_t>(saved.begin(), saved.end() - 1));
+		assert(rejected("not a pcap index"));
+		std::vector<uint8_t> broken(saved);
+		broken[0] ^= 0xFF;
+		rewrite(broken);
+		assert(rejected("not a pcap index"));
+		rewrite(saved);
+		assert(rejected("the index is stale"));
+		unlink(sidecar.c_str());
+		assert(rejected(sidecar.c_str()));
+		PcapIndex::build(m_file_name).write(sidecar);
+		assert(IndexedReader::open(m_file_name).index().frames() == FRAMES);
+	}
+};
@@ -0,0 +1,181 @@
+#pragma once
+
+#include "test_environment.h"
+#include <pipeline/Link.h>
+#include <pipeline/Runtime.h>
+
+#include <vector>
+
+class TestPipelineRuntime {
+	/**
+	 * A flow id and its sequence number within the flow.
+	 */
+	struct Item {
+		uint32_t flow;
+		uint32_t seq;
+
+		Item() noexcept : flow(0), seq(0) {}
+		Item(uint32_t flow_, uint32_t seq_) noexcept : flow(flow_), seq(seq_) {}
+	};
+
+	using Link = pipeline::Link<Item, 8>;
+	using Runtime = pipeline::Runtime;
+
+public:
+	TestPipelineRuntime() noexcept {
+		case_0();
+		case_1();
+		case_2();
+	}
+
+private:
+
+	/**
+	 * BatchRing in one thread: claim, publish, front, pop around the ring.
+	 */
+	void case_0() noexcept {
+		TRACE_CALL;
+		pipeline::BatchRing<pipeline::Batch<int, 4> > ring(3);
+		assert(ring.capacity() == 4);
+		assert(ring.allocate() == 0);
+		assert(ring.allocate() != 0);
+		assert(ring.front() == nullptr);
+		for(int round = 0; round < 3; round++) {
+			for(int i = 0; i < 4; i++) {
+				pipeline::Batch<int, 4>* batch = ring.claim();
+				assert(batch);
+				batch->count = 0;
+				batch->push(round * 10 + i);
+				ring.publish();
+			}
+			assert(ring.claim() == nullptr);
+			assert(ring.size() == 4);
+			for(int i = 0; i < 4; i++) {
+				const pipeline::Batch<int, 4>* batch = ring.front();
+				assert(batch && batch->count == 1 && batch->items[0] == round * 10 + i);
+				ring.pop();
+			}
+			assert(ring.front() == nullptr);
+		}
+	}
+
+	/**
+	 * Backpressure::DROP without a consumer, a full ring drops the items.
+	 */
+	void case_1() noexcept {
+		TRACE_CALL;
+		Link link(1, 2, 2, pipeline::Backpressure::DROP);
+		assert(link.allocate() == 0);
+		Link::Outlet& out = link.outlet(0);
+		unsigned accepted = 0;
+		for(uint32_t i = 0; i < 40; i++) {
+			accepted += out.emit(Item(0, i), 0); // all to the consumer 0
+		}
+		assert(accepted == 2 * 8);
+		assert(out.stat().dropped == 40 - accepted);
+		assert(out.stat().stalls == out.stat().dropped);
+		assert(out.emit(Item(1, 0), 1));
+		assert(link.backlog(0) == 2 && link.backlog(1) == 0);
+		out.close();
+		assert(link.backlog(1) == 1);
+		Link::Inlet& in = link.inlet(0);
+		assert(not in.finished());
+		unsigned seen = 0;
+		while(in.poll([&](const Link::Batch_t& batch) {
+				for(const Item& item : batch) {
+					assert(item.seq == seen);
+					seen++;
+				}
+			})) {}
+		assert(seen == accepted);
+		assert(in.finished());
+		assert(not link.inlet(1).finished());
+	}
+
+	/**
+	 * Sources -> a relay stage -> sinks, the flows keep their consumer and their order with tiny rings.
+	 */
+	void case_2() noexcept {
+		TRACE_CALL;
+		const unsigned sources = 2;
+		const unsigned relays = 2;
+		const unsigned sinks = 3;
+		const uint32_t flows = 50;
+		const uint32_t per_flow = 200;
+		Link first(sources, relays, 2);
+		Link second(relays, sinks, 2);
+		assert(first.allocate() == 0 && second.allocate() == 0);
+
+		// every source emits its own flows, a flow is routed by its id
+		std::vector<uint32_t> next(sources, 0);
+		std::vector<std::vector<uint32_t> > last(sinks, std::vector<uint32_t>(sources * flows, 0));
+		std::vector<uint64_t> received(sinks, 0);
+		Runtime runtime;
+		for(unsigned id = 0; id < sources; id++) {
+			runtime.add(-1, [&, id]() {
+				Link::Outlet& out = first.outlet(id);
+				if(next[id] == flows * per_flow) {
+					out.close();
+					return Runtime::DONE;
+				}
+				int result = 0;
+				for(; result < 32 && next[id] < flows * per_flow; result++, next[id]++) {
+					const uint32_t flow = id * flows + next[id] % flows;
+					out.emit(Item(flow, next[id] / flows + 1), flow);
+				}
+				out.flush();
+				return result;
+			});
+		}
+		for(unsigned id = 0; id < relays; id++) {
+			runtime.add(-1, [&, id]() {
+				Link::Inlet& in = first.inlet(id);
+				Link::Outlet& out = second.outlet(id);
+				const size_t n = in.poll([&](const Link::Batch_t& batch) {
+					for(const Item& item : batch) {
+						assert(item.flow % relays == id);
+						out.emit(item, item.flow);
+					}
+				});
+				out.flush();
+				if(n == 0 && in.finished()) {
+					out.close();
+					return Runtime::DONE;
+				}
+				return int(n);
+			});
+		}
+		for(unsigned id = 0; id < sinks; id++) {
+			runtime.add(int(id), [&, id]() {
+				Link::Inlet& in = second.inlet(id);
+				const size_t n = in.poll([&](const Link::Batch_t& batch) {
+					for(const Item& item : batch) {
+						assert(item.flow % sinks == id);
+						assert(last[id][item.flow] + 1 == item.seq); // the order of a flow is kept
+						last[id][item.flow] = item.seq;
+						received[id]++;
+					}
+				});
+				return n == 0 && in.finished() ? Runtime::DONE : int(n);
+			});
+		}
+		runtime.start();
+		runtime.join();
+		assert(not runtime.running());
+
+		uint64_t total = 0;
+		for(unsigned id = 0; id < sinks; id++) {
+			total += received[id];
+			assert(second.inlet(id).stat().items == received[id]);
+		}
+		assert(total == uint64_t(sources) * flows * per_flow);
+		uint64_t items = 0;
+		for(unsigned i = 0; i < runtime.workers(); i++) {
+			items += runtime.stat(i).items;
+		}
+		assert(items == 3 * total); // every stage has counted every item
+		for(unsigned id = 0; id < sources; id++) {
+			assert(first.outlet(id).stat().dropped == 0);
+		}
+	}
+};
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "test_environment.h"
+#include <cli/types/RangeSet.h>
+
+#include <set>
+
+class TestRangeSet {
+public:
+	TestRangeSet() noexcept {
+		case_0();
+		case_1();
+		case_2();
+	}
+
+private:
+
+	void case_0() noexcept {
+		TRACE_CALL;
+		cli::RangeSet rs;
+		assert(rs.parse("80,1-1024,8080-8090,443,1025-2000,9000") > 0);
+		assert(rs.ranges.size() == 3); // 1-2000, 8080-8090, 9000
+		assert(rs.size() == 2000 + 11 + 1);
+		for(const uint32_t item : {1u, 80u, 1024u, 1025u, 2000u, 8080u, 8085u, 8090u, 9000u}) {
+			assert(rs.contains(item));
+		}
+		for(const uint32_t item : {0u, 2001u, 8079u, 8091u, 8999u, 9001u, 65535u}) {
+			assert(not rs.contains(item));
+		}
+
+		assert(rs.parse("0-4294967295") > 0); // the last item doesn't overflow a range
+		assert(rs.ranges.size() == 1 && rs.size() == (1ull << 32));
+		assert(rs.contains(0) && rs.contains(4294967295u));
+
+		assert(rs.parse("") == 0 && rs.empty());
+		assert(not rs.contains(0));
+		assert(rs.parse("5-3") < 0);
+	}
+
+	/**
+	 * contains() agrees with a set of the items.
+	 */
+	void case_1() noexcept {
+		TRACE_CALL;
+		cli::RangeSet rs;
+		std::set<uint32_t> items;
+		uint32_t seed = 1;
+		for(unsigned i = 0; i < 200; i++) {
+			seed = seed * 1103515245u + 12345u;
+			const uint32_t lo = (seed >> 8) % 5000;
+			const uint32_t hi = lo + (seed >> 4) % 30;
+			rs.insert(lo, hi);
+			for(uint32_t item = lo; item <= hi; item++) {
+				items.insert(item);
+			}
+		}
+		assert(rs.size() == items.size());
+		for(uint32_t item = 0; item < 5100; item++) {
+			assert(rs.contains(item) == (items.count(item) != 0));
+		}
+		for(size_t i = 1; i < rs.ranges.size(); i++) {
+			assert(uint64_t(rs.ranges[i - 1].hi) + 1 < rs.ranges[i].lo);
+		}
+	}
+
+	void case_2() noexcept {
+		TRACE_CALL;
+		cli::RangeSet rs;
+		assert(rs.parse("22,80-90,65535,70000") > 0);
+		BitArrayT<1> ports;
+		ports.allocate(65536);
+		rs.fill(ports);
+		for(uint32_t port = 0; port < 65536; port++) {
+			assert(ports.load(port) == (rs.contains(port) ? 1u : 0u));
+		}
+
+		// the items over the capacity are dropped, a bitmap of no capacity takes none
+		BitArrayT<1> small;
+		small.allocate(64);
+		rs.fill(small);
+		for(uint32_t item = 0; item < small.items_capacity(); item++) {
+			assert(small.load(item) == (rs.contains(item) ? 1u : 0u));
+		}
+		BitArrayT<1> none;
+		rs.fill(none);
+		assert(none.items_capacity() == 0);
+	}
+
+};
@@ -0,0 +1,318 @@
+#pragma once
+
+#include "test_environment.h"
+#include <proto/Reassembler.h>
+#include <proto/parsers/ParsedPacket.h>
+
+#include <cstring>
+#include <vector>
+
+class TestReassembler {
+	using Packet = std::vector<uint8_t>;
+	using Reassembler = proto::Reassembler<storage::BurstClock<1000> >; // milliseconds
+	using IPv4 = proto::IPv4;
+	using IPv6 = proto::IPv6;
+
+public:
+	TestReassembler() noexcept {
+		case_0();
+		case_1();
+		case_2();
+		case_3();
+		case_4();
+		case_5();
+	}
+
+private:
+
+	/**
+	 * The byte @i of the payload of the datagram @id.
+	 */
+	static uint8_t payload_byte(uint16_t id, size_t i) noexcept {
+		return uint8_t(i * 7 + id);
+	}
+
+	/**
+	 * An IPv4 fragment of the datagram @id, the payload [offset, offset + length).
+	 */
+	static Packet fragment(uint16_t id, size_t offset, size_t length, bool more) noexcept {
+		Packet pkt(20 + length, 0);
+		uint8_t* ip = pkt.data();
+		ip[0] = 0x45;
+		utils::ByteOrder::store_be16(ip + 2, uint16_t(pkt.size()));
+		utils::ByteOrder::store_be16(ip + 4, id);
+		utils::ByteOrder::store_be16(ip + 6, uint16_t((offset / 8) | (more ? IP_MF : 0)));
+		ip[8] = 64;
+		ip[9] = IPv4::PROTO_UDP;
+		utils::ByteOrder::store_be32(ip + 12, 0x0A000001);
+		utils::ByteOrder::store_be32(ip + 16, 0x0A000002);
+		for(size_t i = 0; i < length; i++) {
+			ip[20 + i] = payload_byte(id, offset + i);
+		}
+		IPv4::update_checksum(reinterpret_cast<IPv4::Header*>(ip));
+		return pkt;
+	}
+
+	static const uint8_t* push(Reassembler& reassembler, const Packet& pkt, size_t& bytes) noexcept {
+		return reassembler.push(pkt.data(), pkt.size(), bytes);
+	}
+
+	/**
+	 * Ethernet -> IPv6 -> hop-by-hop options -> fragment header -> the payload [offset, offset + length)
+	 * of the UDP datagram @id.
+	 */
+	static Packet fragment6(uint16_t id, size_t offset, size_t length, bool more) noexcept {
+		Packet pkt(14 + 40 + 8 + 8 + length, 0);
+		uint8_t* ptr = pkt.data();
+		utils::ByteOrder::store_be16(ptr + 12, 0x86DD);
+		ptr += 14;
+		ptr[0] = 0x60;
+		utils::ByteOrder::store_be16(ptr + 4, uint16_t(8 + 8 + length));
+		ptr[6] = IPv6::EXT_HOP_BY_HOP;
+		ptr[7] = 64;
+		ptr[8] = 0x20;
+		ptr[23] = 1;
+		ptr[24] = 0x20;
+		ptr[39] = 2;
+		ptr += 40;
+		ptr[0] = IPv6::EXT_FRAGMENT; // hop-by-hop, 8 bytes of the padding
+		ptr[2] = 1; // PadN of 4 bytes
+		ptr[3] = 4;
+		ptr += 8;
+		ptr[0] = IPv6::PROTO_UDP;
+		utils::ByteOrder::store_be16(ptr + 2, uint16_t(offset | (more ? 1 : 0)));
+		utils::ByteOrder::store_be32(ptr + 4, 0x10000u + id);
+		ptr += 8;
+		for(size_t i = 0; i < length; i++) {
+			ptr[i] = payload_byte(id, offset + i);
+		}
+		return pkt;
+	}
+
+	/**
+	 * @return true - if @datagram is the whole datagram @id of @payload bytes with the updated header.
+	 */
+	static bool whole(const uint8_t* datagram, size_t bytes, uint16_t id, size_t payload) noexcept {
+		const IPv4::Header* hdr = reinterpret_cast<const IPv4::Header*>(datagram);
+		if(bytes != 20 + payload || IPv4::pkt_len(hdr) != bytes || IPv4::fragmented(hdr) || not IPv4::verify_checksum(hdr)) {
+			return false;
+		}
+		for(size_t i = 0; i < payload; i++) {
+			if(datagram[20 + i] != payload_byte(id, i)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * In order, out of order and a packet which is not a fragment.
+	 */
+	void case_0() noexcept {
+		TRACE_CALL;
+		Reassembler reassembler(4, 1000);
+		assert(reassembler.allocate() == 0);
+		assert(reassembler.allocate() != 0);
+		size_t bytes;
+
+		assert(push(reassembler, fragment(1, 0, 16, true), bytes) == nullptr && bytes == 0);
+		assert(push(reassembler, fragment(1, 16, 16, true), bytes) == nullptr);
+		const uint8_t* datagram = push(reassembler, fragment(1, 32, 5, false), bytes);
+		assert(datagram && whole(datagram, bytes, 1, 37));
+		assert(reassembler.size() == 0);
+
+		assert(push(reassembler, fragment(2, 40, 3, false), bytes) == nullptr);
+		assert(push(reassembler, fragment(2, 16, 24, true), bytes) == nullptr);
+		assert(push(reassembler, fragment(3, 0, 8, true), bytes) == nullptr); // another datagram meanwhile
+		assert(reassembler.size() == 2);
+		datagram = push(reassembler, fragment(2, 0, 16, true), bytes);
+		assert(datagram && whole(datagram, bytes, 2, 43));
+		assert(reassembler.size() == 1);
+
+		Packet single = fragment(4, 0, 10, false);
+		assert(push(reassembler, single, bytes) == single.data() && bytes == single.size());
+		single.resize(single.size() + 6); // the frame padding
+		assert(push(reassembler, single, bytes) == single.data() && bytes == single.size() - 6);
+		single.resize(24);
+		assert(push(reassembler, single, bytes) == nullptr); // truncated
+		assert(reassembler.stat().datagrams == 2 && reassembler.stat().fragments == 7);
+		assert(reassembler.stat().dropped == 1);
+	}
+
+	/**
+	 * The overlaps and the duplicates are counted once, an inconsistent last fragment drops the datagram.
+	 */
+	void case_1() noexcept {
+		TRACE_CALL;
+		Reassembler reassembler(4, 1000);
+		assert(reassembler.allocate() == 0);
+		size_t bytes;
+
+		assert(push(reassembler, fragment(10, 0, 24, true), bytes) == nullptr);
+		assert(push(reassembler, fragment(10, 0, 24, true), bytes) == nullptr); // a duplicate
+		assert(push(reassembler, fragment(10, 16, 24, true), bytes) == nullptr); // [16, 24) again
+		assert(push(reassembler, fragment(10, 8, 8, true), bytes) == nullptr);
+		const uint8_t* datagram = push(reassembler, fragment(10, 32, 12, false), bytes);
+		assert(datagram && whole(datagram, bytes, 10, 44));
+
+		// the last fragments disagree
+		assert(push(reassembler, fragment(11, 16, 8, false), bytes) == nullptr);
+		assert(push(reassembler, fragment(11, 16, 16, false), bytes) == nullptr);
+		assert(reassembler.size() == 0 && reassembler.stat().dropped == 1);
+		// a fragment past the last one
+		assert(push(reassembler, fragment(12, 16, 8, false), bytes) == nullptr);
+		assert(push(reassembler, fragment(12, 24, 8, true), bytes) == nullptr);
+		assert(reassembler.size() == 0 && reassembler.stat().dropped == 2);
+		// a fragment which is not of BLOCK units before the last one
+		assert(push(reassembler, fragment(13, 0, 12, true), bytes) == nullptr);
+		assert(reassembler.stat().dropped == 3);
+	}
+
+	/**
+	 * A hole is never reported as complete, whatever the order of the fragments.
+	 */
+	void case_2() noexcept {
+		TRACE_CALL;
+		Reassembler reassembler(4, 1000);
+		assert(reassembler.allocate() == 0);
+		size_t bytes;
+
+		// the last fragment comes after a fragment past its end: [8, 16) is missed
+		assert(push(reassembler, fragment(20, 0, 8, true), bytes) == nullptr);
+		assert(push(reassembler, fragment(20, 24, 24, true), bytes) == nullptr);
+		assert(push(reassembler, fragment(20, 16, 8, false), bytes) == nullptr);
+		assert(reassembler.size() == 0 && reassembler.stat().dropped == 1);
+		assert(push(reassembler, fragment(20, 8, 8, true), bytes) == nullptr); // a new datagram then
+		assert(reassembler.size() == 1);
+
+		// the middle block is missed
+		assert(push(reassembler, fragment(21, 0, 8, true), bytes) == nullptr);
+		assert(push(reassembler, fragment(21, 16, 8, false), bytes) == nullptr);
+		assert(push(reassembler, fragment(21, 0, 8, true), bytes) == nullptr);
+		const uint8_t* datagram = push(reassembler, fragment(21, 8, 8, true), bytes);
+		assert(datagram && whole(datagram, bytes, 21, 24));
+
+		// the first fragment is missed
+		assert(push(reassembler, fragment(22, 8, 8, true), bytes) == nullptr);
+		assert(push(reassembler, fragment(22, 16, 4, false), bytes) == nullptr);
+		assert(reassembler.size() == 2 && reassembler.stat().datagrams == 1);
+	}
+
+	/**
+	 * The incomplete datagrams time out, the oldest one is evicted when all the buffers are taken,
+	 * the longer datagrams are dropped.
+	 */
+	void case_3() noexcept {
+		TRACE_CALL;
+		Reassembler reassembler(2, 1000, 1024);
+		assert(reassembler.allocate() == 0);
+		size_t bytes;
+
+		reassembler.clock().set(100);
+		assert(push(reassembler, fragment(30, 0, 8, true), bytes) == nullptr);
+		reassembler.clock().set(600);
+		assert(push(reassembler, fragment(31, 0, 8, true), bytes) == nullptr);
+		reassembler.clock().set(1099);
+		reassembler.expire();
+		assert(reassembler.size() == 2);
+		reassembler.clock().set(1100);
+		reassembler.expire();
+		assert(reassembler.size() == 1 && reassembler.stat().expired == 1);
+		assert(push(reassembler, fragment(30, 8, 8, false), bytes) == nullptr); // a new datagram, 30 has expired
+		assert(reassembler.size() == 2);
+
+		reassembler.clock().set(1200);
+		assert(push(reassembler, fragment(32, 0, 8, true), bytes) == nullptr); // 31 is evicted
+		assert(reassembler.size() == 2 && reassembler.stat().evicted == 1);
+		assert(push(reassembler, fragment(31, 8, 8, false), bytes) == nullptr);
+		assert(reassembler.stat().evicted == 2); // 30 is evicted for it
+
+		const uint8_t* datagram = push(reassembler, fragment(32, 8, 8, false), bytes);
+		assert(datagram && whole(datagram, bytes, 32, 16));
+
+		assert(push(reassembler, fragment(33, 1024, 8, false), bytes) == nullptr); // too long
+		assert(reassembler.stat().dropped == 1);
+		reassembler.clock().set(5000);
+		reassembler.expire();
+		assert(reassembler.size() == 0 && reassembler.stat().expired == 2);
+	}
+
+	/**
+	 * The IPv6 extension headers are walked to the upper layer, a walk stops past a fragment header.
+	 */
+	void case_4() noexcept {
+		TRACE_CALL;
+		uint8_t ext[64] = {0};
+		ext[0] = IPv6::EXT_DST_OPTIONS; // hop-by-hop of 16 bytes
+		ext[1] = 1;
+		ext[16] = IPv6::EXT_AUTH; // destination options of 8 bytes
+		ext[24] = IPv6::PROTO_TCP; // AH of (1 + 2) * 4 bytes
+		ext[25] = 1;
+		uint8_t next = IPv6::EXT_HOP_BY_HOP;
+		int fragment;
+		assert(IPv6::walk_extensions(ext, sizeof(ext), next, fragment) == 36);
+		assert(next == IPv6::PROTO_TCP && fragment == -1);
+		next = IPv6::EXT_HOP_BY_HOP;
+		assert(IPv6::walk_extensions(ext, 30, next, fragment) == -1); // truncated
+
+		// an atomic fragment is walked through, a fragment stops the walk
+		memset(ext, 0, sizeof(ext));
+		ext[0] = IPv6::PROTO_UDP;
+		next = IPv6::EXT_FRAGMENT;
+		assert(IPv6::walk_extensions(ext, sizeof(ext), next, fragment) == 8);
+		assert(next == IPv6::PROTO_UDP && fragment == 0);
+		ext[0] = IPv6::EXT_DST_OPTIONS;
+		ext[3] = 1; // M
+		next = IPv6::EXT_FRAGMENT;
+		assert(IPv6::walk_extensions(ext, sizeof(ext), next, fragment) == 8);
+		assert(next == IPv6::EXT_DST_OPTIONS && fragment == 0);
+
+		// too many extension headers
+		memset(ext, 0, sizeof(ext));
+		next = IPv6::EXT_HOP_BY_HOP;
+		assert(IPv6::walk_extensions(ext, sizeof(ext), next, fragment) == -1);
+
+		proto::ParsedPacket pkt;
+		const Packet frame = fragment6(1, 8, 16, true);
+		assert(proto::PacketParser::parse(frame.data(), frame.size(), pkt));
+		assert(pkt.ip_version == 6 && pkt.ip_protocol == IPv6::PROTO_UDP);
+		assert(pkt.fragment == 14 + 40 + 8 && pkt.payload == 14 + 40 + 16);
+	}
+
+	/**
+	 * An IPv6 datagram is headed by the unfragmentable part, the fragment header is removed.
+	 */
+	void case_5() noexcept {
+		TRACE_CALL;
+		Reassembler reassembler(4, 1000);
+		assert(reassembler.allocate() == 0);
+		const Packet fragments[] = {fragment6(7, 16, 5, false), fragment6(7, 0, 16, true)};
+		const uint8_t* datagram = nullptr;
+		size_t bytes = 0;
+		for(const Packet& frame : fragments) {
+			proto::ParsedPacket pkt;
+			assert(proto::PacketParser::parse(frame.data(), frame.size(), pkt) && pkt.fragment);
+			datagram = reassembler.push(frame.data(), frame.size(), pkt, bytes);
+		}
+		assert(datagram && bytes == 40 + 8 + 21);
+		assert(utils::ByteOrder::load_be16(datagram + 4) == 8 + 21);
+		assert(datagram[6] == IPv6::EXT_HOP_BY_HOP && datagram[40] == IPv6::PROTO_UDP);
+		uint8_t next = datagram[6];
+		int fragment;
+		assert(IPv6::walk_extensions(datagram + 40, bytes - 40, next, fragment) == 8);
+		assert(next == IPv6::PROTO_UDP && fragment == -1);
+		for(size_t i = 0; i < 21; i++) {
+			assert(datagram[48 + i] == payload_byte(7, i));
+		}
+
+		// not a fragment, an atomic fragment and an inconsistent one
+		Packet frame = fragment6(8, 0, 12, false);
+		proto::ParsedPacket pkt;
+		assert(proto::PacketParser::parse(frame.data(), frame.size(), pkt) && pkt.fragment == 0);
+		assert(reassembler.push(frame.data(), frame.size(), pkt, bytes) == frame.data() + 14 && bytes == frame.size() - 14);
+		frame = fragment6(9, 0, 12, true);
+		assert(proto::PacketParser::parse(frame.data(), frame.size(), pkt) && pkt.fragment);
+		assert(reassembler.push(frame.data(), frame.size(), pkt, bytes) == nullptr); // not of BLOCK units
+		assert(reassembler.stat().datagrams == 1 && reassembler.stat().dropped == 1 && reassembler.size() == 0);
+	}
+};
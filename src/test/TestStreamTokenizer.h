@@ -8,6 +8,7 @@ class TestStreamTokenizer {
 public:
 	TestStreamTokenizer() noexcept {
 		case_0();
+		case_1();
 	}
 
 private:
@@ -63,4 +64,43 @@ private:
 		});
 	}
 
+	void case_1() noexcept {
+		TRACE_CALL;
+		enum Token : tio::StreamTokenizer::Token_t {
+			CL_EOS,
+			CL_UNKNOWN,
+			CL_SPACE,
+			TKN_FIRST
+		};
+
+		tio::ArrayInputStream ais(
+			"k0 k1 k12 k123 k k199 k200 k1234 late");
+		tio::StreamTokenizer stk(&ais, CL_EOS, CL_UNKNOWN, true);
+		stk.classify(CL_SPACE, " ", true);
+
+		char str[16];
+		for(unsigned i = 0; i < 200; i++) {
+			snprintf(str, sizeof(str), "k%u", i);
+			stk.tokenize(TKN_FIRST + i, str);
+		}
+		stk.tokenize(CL_UNKNOWN, "k0"); // keeps the first token
+
+		check_list(stk, false, {
+			TKN_FIRST + 0, CL_SPACE, // 'k0'
+			TKN_FIRST + 1, CL_SPACE, // 'k1'
+			TKN_FIRST + 12, CL_SPACE, // 'k12'
+			TKN_FIRST + 123, CL_SPACE, // 'k123'
+			CL_UNKNOWN, CL_SPACE, // 'k'
+			TKN_FIRST + 199, CL_SPACE, // 'k199'
+			CL_UNKNOWN, CL_SPACE, // 'k200'
+			CL_UNKNOWN, CL_SPACE // 'k1234'
+		});
+
+		stk.tokenize(TKN_FIRST + 200, "late"); // refreezes the table
+		check_list(stk, false, {
+			TKN_FIRST + 200, // 'late'
+			CL_EOS
+		});
+	}
+
 };
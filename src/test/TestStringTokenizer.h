@@ -3,6 +3,10 @@
 #include "test_environment.h"
 #include <tio/StringTokenizer.h>
 #include <cstring>
+#include <string>
+
+#include <sys/mman.h>
+#include <unistd.h>
 
 class TestStringTokenizer {
 
@@ -13,6 +17,9 @@ public:
 		test_empty_separator_seq();
 		test_overflow_accumulator();
 		test_separators();
+		test_long_runs();
+		test_many_separators();
+		test_page_end();
 	}
 
 private:
@@ -96,4 +103,74 @@ private:
 		assert(not stk.next());
 	}
 
+	/**
+	 * The runs cross the 16 chars chunks of CharSet.
+	 */
+	void test_long_runs() noexcept {
+		TRACE_CALL;
+
+		constexpr size_t Capacity = 64;
+		std::string input;
+		for(size_t i = 1; i < 40; i++) {
+			input += std::string(i % 19 + 1, i % 2 ? ' ' : '\t');
+			input += std::string(i, char('a' + i % 26));
+		}
+		const char* separators = " \t";
+
+		tio::StringTokenizer<Capacity> stk(input.c_str(), separators);
+		for(size_t i = 1; i < 40; i++) {
+			assert(stk.next());
+			assert(std::string(stk.token()) == std::string(i, char('a' + i % 26)));
+			assert(not stk.overflown());
+		}
+		assert(not stk.next());
+	}
+
+	/**
+	 * The separators which don't fit CharSet are scanned by the scalar loops.
+	 */
+	void test_many_separators() noexcept {
+		TRACE_CALL;
+
+		constexpr size_t Capacity = 32;
+		const char* input = "a0b1c2d3e4f5g6h7i8j9k";
+		const char* separators = "0123456789:;<=>?@";
+
+		tio::StringTokenizer<Capacity> stk(input, separators);
+		for(const char* token : {"a", "b", "c", "d", "e", "f", "g", "h", "i", "j", "k"}) {
+			assert(stk.next());
+			assert(strcmp(stk.token(), token) == 0);
+		}
+		assert(not stk.next());
+	}
+
+	/**
+	 * A string which ends at the end of a page followed by an unmapped one.
+	 */
+	void test_page_end() noexcept {
+		TRACE_CALL;
+
+		constexpr size_t Capacity = 32;
+		const size_t page = size_t(sysconf(_SC_PAGESIZE));
+		char* pages = static_cast<char*>(mmap(nullptr, page * 2, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+		assert(pages != MAP_FAILED);
+		assert(mprotect(pages + page, page, PROT_NONE) == 0);
+		const char* text = "first  second\tthird ";
+		for(size_t length = strlen(text); length; length--) {
+			char* input = pages + page - length - 1;
+			memcpy(input, text + strlen(text) - length, length + 1);
+			tio::StringTokenizer<Capacity> stk(input, " \t");
+			size_t chars = 0;
+			while(stk.next()) {
+				chars += strlen(stk.token());
+			}
+			size_t expected = 0;
+			for(const char* ch = input; *ch; ch++) {
+				expected += *ch != ' ' && *ch != '\t';
+			}
+			assert(chars == expected);
+		}
+		munmap(pages, page * 2);
+	}
+
 };
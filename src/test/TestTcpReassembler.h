@@ -0,0 +1,232 @@
+#pragma once
+
+#include "test_environment.h"
+#include <proto/TcpReassembler.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+class TestTcpReassembler {
+	using Pool = intrusive::PacketPool<256, 64>;
+	using Packet = Pool::Packet_t;
+	using Streams = proto::TcpReassembler<Pool, storage::BurstClock<1000> >; // milliseconds
+	using Result = proto::TcpPushResult;
+
+	Pool m_pool;
+
+public:
+	TestTcpReassembler() noexcept : m_pool(64) {
+		assert(m_pool.allocate() == 0);
+		case_0();
+		case_1();
+		case_2();
+		case_3();
+		case_4();
+		assert(m_pool.size() == 0);
+	}
+
+private:
+
+	/**
+	 * A pooled Ethernet -> IPv4 -> TCP packet of @port with @payload and 4 bytes of the frame padding.
+	 */
+	Packet* segment(uint16_t port, uint32_t seq, uint8_t flags, const std::string& payload) noexcept {
+		uint8_t frame[14 + 20 + 20 + 128] = {0};
+		utils::ByteOrder::store_be16(frame + 12, 0x0800);
+		uint8_t* ip = frame + 14;
+		ip[0] = 0x45;
+		utils::ByteOrder::store_be16(ip + 2, uint16_t(20 + 20 + payload.size()));
+		ip[8] = 64;
+		ip[9] = proto::IPv4::PROTO_TCP;
+		utils::ByteOrder::store_be32(ip + 12, 0x0A000001);
+		utils::ByteOrder::store_be32(ip + 16, 0x0A000002);
+		uint8_t* tcp = ip + 20;
+		utils::ByteOrder::store_be16(tcp, port);
+		utils::ByteOrder::store_be16(tcp + 2, 80);
+		utils::ByteOrder::store_be32(tcp + 4, seq);
+		tcp[12] = 5 << 4;
+		tcp[13] = flags;
+		memcpy(tcp + 20, payload.data(), payload.size());
+		memset(tcp + 20 + payload.size(), 0xEE, 4);
+		Packet* pkt = m_pool.alloc(frame, 14 + 20 + 20 + payload.size() + 4);
+		assert(pkt);
+		return pkt;
+	}
+
+	/**
+	 * Push a segment as a receive path does: the packet is parsed and freed after the push.
+	 */
+	Result push(Streams& streams, uint16_t port, uint32_t seq, uint8_t flags, const std::string& payload) noexcept {
+		Packet* pkt = segment(port, seq, flags, payload);
+		proto::ParsedPacket parsed;
+		assert(proto::PacketParser::parse(static_cast<const Packet*>(pkt)->data(), pkt->length, parsed));
+		const Result result = streams.push(proto::FlowKey::of(parsed), pkt, parsed);
+		m_pool.free(pkt);
+		return result;
+	}
+
+	static proto::FlowKey key(uint16_t port) noexcept {
+		proto::FlowKey result;
+		memset(&result, 0, sizeof(result));
+		result.src.addr32[0] = htonl(0x0A000001);
+		result.dst.addr32[0] = htonl(0x0A000002);
+		result.src_port = htons(port);
+		result.dst_port = htons(80);
+		result.protocol = proto::IPv4::PROTO_TCP;
+		result.version = 4;
+		return result;
+	}
+
+	static std::string text(Streams& streams, uint16_t port) noexcept {
+		binio::MCArea areas[8];
+		size_t bytes;
+		const size_t n = streams.areas(key(port), areas, 8, bytes);
+		std::string result;
+		for(size_t i = 0; i < n; i++) {
+			result.append(static_cast<const char*>(areas[i].cbegin()), areas[i].length());
+		}
+		assert(result.size() == bytes);
+		return result;
+	}
+
+	/**
+	 * The in-order stream: the areas point into the held packets, consume() and read() free them.
+	 */
+	void case_0() noexcept {
+		TRACE_CALL;
+		Streams streams(m_pool, 16, 32);
+		assert(streams.allocate() == 0);
+		assert(streams.allocate() != 0);
+
+		assert(push(streams, 1000, 5000, proto::Tcp::FLAG_SYN, "") == Result::DUPLICATE);
+		assert(streams.size() == 1 && m_pool.size() == 0);
+		assert(push(streams, 1000, 5001, proto::Tcp::FLAG_ACK, "GET ") == Result::IN_ORDER);
+		assert(push(streams, 1000, 5005, proto::Tcp::FLAG_ACK, "/index") == Result::IN_ORDER);
+		assert(push(streams, 1000, 5011, proto::Tcp::FLAG_ACK | proto::Tcp::FLAG_FIN, ".html") == Result::IN_ORDER);
+		assert(m_pool.size() == 3 && streams.bytes() == 15);
+		assert(text(streams, 1000) == "GET /index.html"); // not the padding
+
+		binio::MCArea areas[2];
+		size_t bytes;
+		assert(streams.areas(key(1000), areas, 2, bytes) == 2 && bytes == 10);
+		const uint8_t* first = static_cast<const uint8_t*>(areas[0].cbegin());
+		assert(first >= m_pool.at(0)->buffer && first < m_pool.at(uint32_t(m_pool.capacity() - 1))->buffer + 256);
+
+		streams.consume(key(1000), 5); // "GET /"
+		assert(m_pool.size() == 2 && streams.bytes() == 10);
+		assert(text(streams, 1000) == "index.html");
+		char out[16] = {0};
+		assert(streams.read(key(1000), reinterpret_cast<uint8_t*>(out), sizeof(out)) == 10);
+		assert(std::string(out) == "index.html");
+		assert(m_pool.size() == 0 && streams.bytes() == 0);
+		assert(streams.finished(key(1000)));
+		streams.close(key(1000));
+		assert(streams.size() == 0 && streams.readable(key(1000)) == 0);
+	}
+
+	/**
+	 * The out of order segments, the retransmissions and the overlaps, across the sequence number wrap.
+	 */
+	void case_1() noexcept {
+		TRACE_CALL;
+		Streams streams(m_pool, 16, 32);
+		assert(streams.allocate() == 0);
+		const uint32_t isn = 0xFFFFFFF8u;
+
+		assert(push(streams, 2000, isn, proto::Tcp::FLAG_SYN, "") == Result::DUPLICATE);
+		assert(push(streams, 2000, isn + 1 + 8, 0, "IJKL") == Result::OUT_OF_ORDER);
+		assert(push(streams, 2000, isn + 1 + 16, 0, "QRST") == Result::OUT_OF_ORDER);
+		assert(streams.readable(key(2000)) == 0);
+		assert(push(streams, 2000, isn + 1 + 8, 0, "IJ") == Result::DUPLICATE); // buffered
+		assert(push(streams, 2000, isn + 1 + 6, 0, "GHIJKLMN") == Result::OUT_OF_ORDER); // "GH" and "MN" are new
+		assert(push(streams, 2000, isn + 1, 0, "ABCDEF") == Result::IN_ORDER);
+		assert(text(streams, 2000) == "ABCDEFGHIJKLMN");
+		assert(push(streams, 2000, isn + 1 + 12, 0, "MNOPQRSTUV") == Result::IN_ORDER); // "OP" and "UV", "QRST" is replaced
+		assert(text(streams, 2000) == "ABCDEFGHIJKLMNOPQRSTUV");
+		assert(streams.bytes() == 22);
+
+		streams.consume(key(2000), 10);
+		assert(push(streams, 2000, isn + 1, 0, "ABCDEFGHIJ") == Result::DUPLICATE); // consumed
+		assert(push(streams, 2000, isn + 1 + 8, 0, "IJKL") == Result::DUPLICATE);
+		assert(text(streams, 2000) == "KLMNOPQRSTUV");
+		assert(streams.stat().duplicates == 4 && streams.stat().out_of_order == 3);
+		streams.close(key(2000));
+		assert(m_pool.size() == 0 && streams.bytes() == 0);
+	}
+
+	/**
+	 * The caps: a stream, the segments and the bytes of all the streams, the idle streams are evicted.
+	 */
+	void case_2() noexcept {
+		TRACE_CALL;
+		Streams streams(m_pool, 4, 4, 16, 24);
+		assert(streams.allocate() == 0);
+
+		assert(push(streams, 3000, 100, 0, "0123456789") == Result::IN_ORDER);
+		assert(push(streams, 3000, 110, 0, "0123456789") == Result::DROPPED); // the stream cap
+		assert(push(streams, 3000, 200, 0, "x") == Result::DROPPED); // far past the position
+		assert(push(streams, 3000, 110, 0, "012345") == Result::IN_ORDER);
+		assert(streams.bytes() == 16);
+		streams.clock().set(1);
+		assert(push(streams, 3001, 100, 0, "01234567") == Result::IN_ORDER);
+		assert(streams.size() == 2 && streams.bytes() == 24);
+		streams.clock().set(2);
+		assert(push(streams, 3002, 100, 0, "0") == Result::IN_ORDER); // the total cap evicts 3000
+		assert(streams.size() == 2 && streams.stat().evicted == 1 && streams.readable(key(3000)) == 0);
+		assert(push(streams, 3002, 101, 0, "1") == Result::IN_ORDER);
+		assert(push(streams, 3002, 102, 0, "2") == Result::IN_ORDER);
+		assert(push(streams, 3002, 103, 0, "3") == Result::IN_ORDER); // the segments cap evicts 3001
+		assert(streams.size() == 1 && streams.stat().evicted == 2);
+		assert(push(streams, 3002, 104, 0, "4") == Result::DROPPED); // the only stream is not evicted
+		assert(text(streams, 3002) == "0123" && m_pool.size() == 4);
+		assert(streams.stat().dropped == 3);
+	}
+
+	/**
+	 * The idle streams time out, RST releases a stream, the reassembler frees the packets it holds.
+	 */
+	void case_3() noexcept {
+		TRACE_CALL;
+		{
+			Streams streams(m_pool, 16, 32, Streams::STREAM_BYTES, 0, 1000);
+			assert(streams.allocate() == 0);
+			streams.clock().set(10);
+			assert(push(streams, 4000, 1, 0, "abc") == Result::IN_ORDER);
+			assert(push(streams, 4001, 1, 0, "abc") == Result::IN_ORDER);
+			streams.clock().set(600);
+			assert(push(streams, 4001, 5, 0, "e") == Result::OUT_OF_ORDER);
+			streams.clock().set(1100);
+			streams.expire();
+			assert(streams.size() == 1 && streams.stat().expired == 1 && m_pool.size() == 2);
+			assert(push(streams, 4001, 4, proto::Tcp::FLAG_RST, "") == Result::CLOSED);
+			assert(streams.size() == 0 && m_pool.size() == 0);
+
+			assert(push(streams, 4002, 1, 0, "held") == Result::IN_ORDER);
+			assert(m_pool.size() == 1);
+		}
+		assert(m_pool.size() == 0);
+	}
+
+	/**
+	 * A segment over the caps keeps the buffered segments it covers, a taken one reuses their room.
+	 */
+	void case_4() noexcept {
+		TRACE_CALL;
+		Streams streams(m_pool, 4, 1, 16, 8);
+		assert(streams.allocate() == 0);
+		assert(push(streams, 5000, 100, 0, "0") == Result::IN_ORDER);
+		streams.consume(key(5000), 1);
+		assert(push(streams, 5000, 105, 0, "AB") == Result::OUT_OF_ORDER);
+		assert(push(streams, 5000, 102, 0, std::string(17, 'x')) == Result::DROPPED); // the stream cap
+		assert(push(streams, 5000, 102, 0, std::string(9, 'x')) == Result::DROPPED); // the total cap
+		assert(streams.bytes() == 2 && m_pool.size() == 1);
+		assert(push(streams, 5000, 101, 0, "1234") == Result::DROPPED); // no segment for it
+		assert(push(streams, 5000, 104, 0, "4ABC") == Result::OUT_OF_ORDER); // takes the segment of "AB"
+		assert(streams.bytes() == 4 && m_pool.size() == 1 && streams.stat().evicted == 0);
+		assert(push(streams, 5000, 101, 0, "123") == Result::DROPPED);
+		streams.close(key(5000));
+		assert(m_pool.size() == 0);
+		assert(streams.stat().dropped == 4);
+	}
+};
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "test_environment.h"
+#include <utils/TextBuffer.h>
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+class TestTextBuffer {
+	using TextBuffer = utils::TextBuffer;
+
+	char m_text[512];
+	FILE* m_out;
+
+public:
+	TestTextBuffer() noexcept : m_text(), m_out(nullptr) {
+		case_0();
+		case_1();
+		case_2();
+	}
+
+private:
+
+	/**
+	 * The buffer of this thread which writes to m_text from its beginning, text() takes the result.
+	 */
+	TextBuffer& begin() noexcept {
+		memset(m_text, 0, sizeof(m_text));
+		m_out = fmemopen(m_text, sizeof(m_text) - 1, "w");
+		assert(m_out);
+		return TextBuffer::local(m_out);
+	}
+
+	const char* text() noexcept {
+		TextBuffer::local(m_out).flush();
+		fclose(m_out);
+		return m_text;
+	}
+
+	static void ipv6_addr(const uint16_t (&groups)[8], uint8_t (&addr)[16]) noexcept {
+		for(unsigned i = 0; i < 8; i++) {
+			addr[2 * i] = uint8_t(groups[i] >> 8);
+			addr[2 * i + 1] = uint8_t(groups[i]);
+		}
+	}
+
+	/**
+	 * The integers by dec(), sdec() and hex(), the bytes by hex() and mac(), the IPv4 addresses.
+	 */
+	void case_0() noexcept {
+		TRACE_CALL;
+		begin().dec(0).chr(' ').dec(7).chr(' ').dec(1234567890).chr(' ').dec(UINT64_MAX);
+		assert(strcmp(text(), "0 7 1234567890 18446744073709551615") == 0);
+
+		begin().sdec(0).chr(' ').sdec(-1).chr(' ').sdec(INT64_MAX).chr(' ').sdec(INT64_MIN);
+		assert(strcmp(text(), "0 -1 9223372036854775807 -9223372036854775808") == 0);
+
+		begin().hex(0).chr(' ').hex(0xabc).chr(' ').hex(0xabc, 6, true).chr(' ').hex(0x12345, 2).chr(' ')
+			.hex(1, 20).chr(' ').hex(UINT64_MAX);
+		assert(strcmp(text(), "0 abc 000ABC 12345 0000000000000001 ffffffffffffffff") == 0);
+
+		const uint8_t bytes[6] = {0x00, 0x1f, 0xa0, 0x0b, 0xcd, 0xef};
+		begin().hex(bytes, 3).chr(' ').hex(bytes, 3, '-').chr(' ').hex(bytes, 0, ':').chr(' ').mac(bytes).chr(' ')
+			.mac(bytes, false);
+		assert(strcmp(text(), "001fa0 00-1f-a0  00:1F:A0:0B:CD:EF 00:1f:a0:0b:cd:ef") == 0);
+
+		begin().ipv4(0).chr(' ').ipv4(0xC0A80001).chr(' ').ipv4(0x0A00640B).chr(' ').ipv4(UINT32_MAX);
+		assert(strcmp(text(), "0.0.0.0 192.168.0.1 10.0.100.11 255.255.255.255") == 0);
+	}
+
+	/**
+	 * IPv6 by RFC 5952: the longest zero run, the first one of the equal ones, becomes "::", a single zero
+	 * group stays, the leading and the trailing runs and the all-zero address.
+	 */
+	void case_1() noexcept {
+		TRACE_CALL;
+		const struct {
+			uint16_t groups[8];
+			const char* text;
+		} samples[] = {
+			{{0, 0, 0, 0, 0, 0, 0, 0}, "::"},
+			{{0, 0, 0, 0, 0, 0, 0, 1}, "::1"},
+			{{1, 0, 0, 0, 0, 0, 0, 0}, "1::"},
+			{{0x2001, 0xdb8, 0, 0, 0, 0, 0, 0}, "2001:db8::"},
+			{{0, 0, 0, 0, 0, 0xffff, 0xc000, 0x201}, "::ffff:c000:201"},
+			{{0x2001, 0xdb8, 0, 0, 0, 0, 0, 1}, "2001:db8::1"},
+			{{0x2001, 0xdb8, 0, 1, 1, 1, 1, 1}, "2001:db8:0:1:1:1:1:1"},
+			{{0x2001, 0, 0, 1, 0, 0, 0, 1}, "2001:0:0:1::1"},
+			{{0x2001, 0xdb8, 0, 0, 1, 0, 0, 1}, "2001:db8::1:0:0:1"},
+			{{0, 1, 0, 1, 0, 1, 0, 1}, "0:1:0:1:0:1:0:1"},
+			{{0xfe80, 0, 0, 0, 0x1a2b, 0x3c4d, 0x5e6f, 0x7080}, "fe80::1a2b:3c4d:5e6f:7080"},
+			{{0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff, 0xffff}, "ffff:ffff:ffff:ffff:ffff:ffff:ffff:ffff"}
+		};
+		for(const auto& sample : samples) {
+			uint8_t addr[16];
+			ipv6_addr(sample.groups, addr);
+			begin().ipv6(addr);
+			assert(strcmp(text(), sample.text) == 0);
+		}
+	}
+
+	/**
+	 * A text longer than the buffer is flushed by parts, the stream gets it whole and in order.
+	 */
+	void case_2() noexcept {
+		TRACE_CALL;
+		std::string expected;
+		for(unsigned i = 0; expected.size() < TextBuffer::CAPACITY * 3; i++) {
+			expected += std::to_string(i) + ' ';
+		}
+		std::vector<char> data(expected.size() + 1 + TextBuffer::CAPACITY, 0);
+		FILE* out = fmemopen(data.data(), data.size() - 1, "w");
+		assert(out);
+		TextBuffer& buffer = TextBuffer::local(out);
+		buffer.str(expected.data(), TextBuffer::CAPACITY + 1);
+		assert(buffer.size() < TextBuffer::CAPACITY);
+		size_t offset = TextBuffer::CAPACITY + 1;
+		for(unsigned i = 0; offset < expected.size(); i++) {
+			const size_t sliver = i % 5 + 1 < expected.size() - offset ? i % 5 + 1 : expected.size() - offset;
+			buffer.str(expected.data() + offset, sliver);
+			offset += sliver;
+		}
+		buffer.flush();
+		assert(buffer.size() == 0);
+		fclose(out);
+		assert(expected == data.data());
+	}
+};
@@ -0,0 +1,229 @@
+#pragma once
+
+#include "test_environment.h"
+#include <utils/Trace.h>
+
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+class TestTrace {
+	/**
+	 * The ticks are set by the test.
+	 */
+	struct ManualClock {
+		uint64_t ticks;
+
+		ManualClock() noexcept : ticks(0) {}
+
+		inline uint64_t now() noexcept {
+			return ticks;
+		}
+
+		inline uint64_t hz() const noexcept {
+			return 1000000000;
+		}
+	};
+
+	using Tracer = utils::Tracer<ManualClock>;
+	using Collector = utils::TraceCollector;
+
+	enum Stage : unsigned { PARSE, IPTABLE, RATELIMIT };
+
+public:
+	TestTrace() noexcept {
+		case_0();
+		case_1();
+		case_2();
+		case_3();
+	}
+
+private:
+
+	/**
+	 * The sampling: every packet, none and about 1/N with the jittered intervals.
+	 */
+	void case_0() noexcept {
+		TRACE_CALL;
+		Tracer all(4096, 1, 0);
+		Tracer none(4096, 0, 1);
+		Tracer some(1 << 16, 100, 2);
+		assert(all.allocate() == 0 && none.allocate() == 0 && some.allocate() == 0);
+		unsigned last = 0;
+		unsigned gap_min = ~0u;
+		unsigned gap_max = 0;
+		unsigned sampled = 0;
+		for(unsigned i = 1; i <= 100000; i++) {
+			assert(all.begin());
+			all.end();
+			assert(not none.begin());
+			none.stage(PARSE);
+			none.end();
+			if(some.begin()) {
+				if(last) {
+					gap_min = i - last < gap_min ? i - last : gap_min;
+					gap_max = i - last > gap_max ? i - last : gap_max;
+				}
+				last = i;
+				sampled++;
+				some.end();
+			}
+			assert(not some.active());
+		}
+		printf("sampled=%u gap_min=%u gap_max=%u\n", sampled, gap_min, gap_max);
+		assert(all.stat().sampled.load() == 100000);
+		assert(none.stat().sampled.load() == 0 && none.ring().size() == 0);
+		assert(sampled > 800 && sampled < 1250);
+		assert(gap_min >= 50 && gap_max < 150 && gap_min < gap_max);
+	}
+
+	/**
+	 * The stage ticks, the histograms and the tail: the slow packets spend their time in the lookup.
+	 */
+	void case_1() noexcept {
+		TRACE_CALL;
+		Tracer tracer(1 << 16, 1, 7);
+		assert(tracer.allocate() == 0);
+		Collector collector(tracer.clock().hz());
+		collector.set_stage_name(PARSE, "parse");
+		collector.set_stage_name(IPTABLE, "iptable");
+		assert(collector.attach(tracer.ring()));
+
+		for(unsigned round = 0; round < 2; round++) {
+			for(unsigned i = 0; i < 500; i++) {
+				const bool slow = i % 100 == 99;
+				tracer.clock().ticks += 5;
+				assert(tracer.begin());
+				tracer.clock().ticks += 100; // [64, 128)
+				tracer.stage(PARSE);
+				tracer.clock().ticks += slow ? 100000 : 200;
+				tracer.stage(IPTABLE);
+				tracer.clock().ticks += 30;
+				tracer.stage(IPTABLE); // the second lookup sums up
+				tracer.clock().ticks += 40; // [32, 64)
+				tracer.stage(RATELIMIT);
+				tracer.end();
+			}
+			assert(collector.collect() == 500);
+		}
+		assert(tracer.ring().size() == 0);
+
+		const utils::Log2Histogram& parse = collector.stage(PARSE);
+		assert(parse.count() == 1000 && parse.sum == 100000);
+		assert(parse.quantile(0.5) == 128 && parse.quantile(0.999) == 128);
+		assert(collector.stage(IPTABLE).count() == 1000);
+		assert(collector.stage(IPTABLE).sum == 990 * 230 + 10 * 100030);
+		assert(collector.stage(RATELIMIT).quantile(1.0) == 64);
+		assert(collector.stage(3).count() == 0);
+		assert(collector.total().count() == 1000 && collector.total().quantile(0.5) == 512);
+		// the first round has no threshold yet, the slow packets of the second one are beyond the p99 bucket
+		assert(collector.tail_samples() == 5);
+		assert(collector.tail_cycles(PARSE) == 5 * 100);
+		assert(collector.tail_cycles(IPTABLE) == 5 * 100030);
+
+		char text[16384] = {0};
+		FILE* out = fmemopen(text, sizeof(text) - 1, "w");
+		assert(out);
+		collector.write_folded(out);
+		fclose(out);
+		assert(strstr(text, "packet;parse 100000\n"));
+		assert(strstr(text, "packet;stage2 40000\n"));
+		assert(strstr(text, "tail;iptable 500150\n"));
+
+		memset(text, 0, sizeof(text));
+		out = fmemopen(text, sizeof(text) - 1, "w");
+		assert(out);
+		utils::MetricsWriter writer(out, "trace");
+		collector.write(writer);
+		fclose(out);
+		assert(strstr(text, "trace_parse_cycles_count 1000\n"));
+		assert(strstr(text, "trace_packet_cycles_bucket{le=\"+Inf\"} 1000\n"));
+		assert(strstr(text, "trace_tail_samples 5\n"));
+		assert(not strstr(text, "stage3"));
+		collector.print(stdout);
+
+		collector.reset();
+		assert(collector.total().count() == 0 && collector.tail_samples() == 0);
+	}
+
+	/**
+	 * A lagging collector: the records beyond the ring are dropped and counted.
+	 */
+	void case_2() noexcept {
+		TRACE_CALL;
+		Tracer tracer(4 * sizeof(utils::TraceRecord), 1, 0);
+		assert(tracer.allocate() == 0);
+		Collector collector(1);
+		assert(collector.attach(tracer.ring()));
+		for(unsigned i = 0; i < 10; i++) {
+			tracer.begin();
+			tracer.clock().ticks += i;
+			tracer.stage(PARSE);
+			tracer.end();
+		}
+		assert(tracer.stat().sampled.load() == 10 && tracer.stat().dropped.load() == 6);
+		assert(collector.collect() == 4);
+		assert(collector.stage(PARSE).sum == 0 + 1 + 2 + 3);
+		// the ring wraps
+		for(unsigned round = 0; round < 5; round++) {
+			for(unsigned i = 0; i < 3; i++) {
+				tracer.begin();
+				tracer.stage(PARSE);
+				tracer.end();
+			}
+			assert(collector.collect() == 3);
+		}
+		assert(tracer.stat().dropped.load() == 6);
+		assert(collector.stage(PARSE).count() == 4 + 15);
+	}
+
+	/**
+	 * The packet threads trace while the collector drains their rings.
+	 */
+	void case_3() noexcept {
+		TRACE_CALL;
+		const unsigned threads = 3;
+		const unsigned packets = 20000;
+		Collector collector(1);
+		const size_t ring_bytes = 64 * sizeof(utils::TraceRecord);
+		Tracer tracers[threads] = {{ring_bytes, 4, 0}, {ring_bytes, 4, 1}, {ring_bytes, 4, 2}};
+		for(unsigned t = 0; t < threads; t++) {
+			assert(tracers[t].allocate() == 0);
+			assert(collector.attach(tracers[t].ring()));
+		}
+		std::atomic<unsigned> running(threads);
+		std::thread workers[threads];
+		for(unsigned t = 0; t < threads; t++) {
+			workers[t] = std::thread([&, t]() {
+				Tracer& tracer = tracers[t];
+				for(unsigned i = 0; i < packets; i++) {
+					tracer.begin();
+					tracer.clock().ticks += 1 + t;
+					tracer.stage(IPTABLE);
+					tracer.end();
+				}
+				running.fetch_sub(1, std::memory_order_release);
+			});
+		}
+		uint64_t collected = 0;
+		while(running.load(std::memory_order_acquire)) {
+			collected += collector.collect();
+			std::this_thread::yield();
+		}
+		for(unsigned t = 0; t < threads; t++) {
+			workers[t].join();
+		}
+		collected += collector.collect();
+		uint64_t sampled = 0;
+		uint64_t dropped = 0;
+		for(unsigned t = 0; t < threads; t++) {
+			sampled += tracers[t].stat().sampled.load();
+			dropped += tracers[t].stat().dropped.load();
+		}
+		printf("sampled=%lu collected=%lu dropped=%lu\n", (unsigned long)sampled, (unsigned long)collected,
+		       (unsigned long)dropped);
+		assert(collected + dropped == sampled);
+		assert(collector.stage(IPTABLE).count() == collected);
+		assert(collector.stage(IPTABLE).quantile(1.0) <= 4);
+	}
+};
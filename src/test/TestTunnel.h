@@ -0,0 +1,341 @@
+#pragma once
+
+#include "test_environment.h"
+#include <proto/parsers/ParsedPacket.h>
+#include <proto/parsers/HeaderParser.h>
+#include <proto/parsers/StaticHeaderParser.h>
+
+#include <cstring>
+#include <vector>
+
+class TestTunnel {
+	using Packet = std::vector<uint8_t>;
+
+	/**
+	 * A frame as pcapwrap::Frame keeps it, for parse_burst().
+	 */
+	struct Frame {
+		struct {
+			uint32_t caplen;
+		} m_hdr;
+		const uint8_t* m_data;
+	};
+
+	/**
+	 * The expected tunnel of a frame.
+	 */
+	struct Expected {
+		uint8_t tunnel;
+		uint32_t tunnel_id;
+		size_t inner_l3;
+		size_t inner_l4;
+		uint16_t inner_src_port;
+		uint16_t inner_dst_port;
+		size_t outer_l4;
+	};
+
+	uint32_t m_seed;
+
+public:
+	TestTunnel() noexcept : m_seed(3) {
+		case_0();
+		case_1();
+		case_2();
+		case_3();
+		case_4();
+	}
+
+private:
+
+	static void put16(Packet& pkt, uint16_t value) noexcept {
+		pkt.push_back(uint8_t(value >> 8));
+		pkt.push_back(uint8_t(value));
+	}
+
+	static void put32(Packet& pkt, uint32_t value) noexcept {
+		put16(pkt, uint16_t(value >> 16));
+		put16(pkt, uint16_t(value));
+	}
+
+	static void ethernet(Packet& pkt, uint16_t ethertype) noexcept {
+		for(uint8_t i = 0; i < 12; i++) {
+			pkt.push_back(i);
+		}
+		put16(pkt, ethertype);
+	}
+
+	static size_t ipv4(Packet& pkt, uint8_t protocol, uint32_t src, uint32_t dst) noexcept {
+		const size_t offset = pkt.size();
+		pkt.insert(pkt.end(), 20, 0);
+		pkt[offset] = 0x45;
+		pkt[offset + 8] = 64;
+		pkt[offset + 9] = protocol;
+		utils::ByteOrder::store_be32(&pkt[offset + 12], src);
+		utils::ByteOrder::store_be32(&pkt[offset + 16], dst);
+		return offset;
+	}
+
+	static size_t ipv6(Packet& pkt, uint8_t next_header) noexcept {
+		const size_t offset = pkt.size();
+		pkt.insert(pkt.end(), 40, 0);
+		pkt[offset] = 0x60;
+		pkt[offset + 6] = next_header;
+		for(size_t i = 0; i < 32; i++) {
+			pkt[offset + 8 + i] = uint8_t(i * 7);
+		}
+		return offset;
+	}
+
+	static size_t tcp(Packet& pkt, uint16_t src, uint16_t dst) noexcept {
+		const size_t offset = pkt.size();
+		put16(pkt, src);
+		put16(pkt, dst);
+		pkt.insert(pkt.end(), 16, 0);
+		pkt[offset + 12] = 5 << 4;
+		return offset;
+	}
+
+	static size_t udp(Packet& pkt, uint16_t src, uint16_t dst) noexcept {
+		const size_t offset = pkt.size();
+		put16(pkt, src);
+		put16(pkt, dst);
+		put32(pkt, 0);
+		return offset;
+	}
+
+	/**
+	 * Set the length of the IP packet at @ip to the end of the frame.
+	 */
+	static void finish(Packet& pkt, size_t ip) noexcept {
+		if((pkt[ip] >> 4) == 4) {
+			utils::ByteOrder::store_be16(&pkt[ip + 2], uint16_t(pkt.size() - ip));
+		} else {
+			utils::ByteOrder::store_be16(&pkt[ip + 4], uint16_t(pkt.size() - ip - 40));
+		}
+	}
+
+	/**
+	 * PacketParser::parse() and parse_burst() agree, the header parsers walk the same headers
+	 * and take the inner TCP/UDP header at depth() 1.
+	 */
+	static void check(const Packet& pkt, const Expected& expected) noexcept {
+		proto::ParsedPacket parsed;
+		assert(proto::PacketParser::parse(pkt.data(), pkt.size(), parsed));
+		assert(parsed.tunnel == expected.tunnel && parsed.tunnel_id == expected.tunnel_id);
+		assert(parsed.l4 == expected.outer_l4);
+		assert(parsed.inner.l3 == expected.inner_l3 && parsed.inner.l4 == expected.inner_l4);
+		assert(parsed.inner.src_port == htons(expected.inner_src_port));
+		assert(parsed.inner.dst_port == htons(expected.inner_dst_port));
+		burst(pkt, parsed);
+
+		proto::HeaderParser hp(pkt.data(), pkt.size());
+		proto::SafeHeaderParser sp(pkt.data(), pkt.size());
+		proto::StaticHeaderParser<proto::Ethernet, proto::Vlan, proto::Mpls, proto::IPv4, proto::IPv6, proto::Udp,
+			proto::Tcp, proto::Gre, proto::Vxlan, proto::GtpU> st(pkt.data(), pkt.size());
+		size_t inner_l4 = 0;
+		for(unsigned steps = 0; hp.protocol() != proto::Protocol::END; steps++) {
+			assert(steps < 32);
+			assert(sp.protocol() == hp.protocol() && st.protocol() == hp.protocol());
+			assert(sp.depth() == hp.depth() && st.depth() == hp.depth());
+			const uint8_t* header;
+			hp.assign(header);
+			if(hp.depth() == 1 && (hp.protocol() == proto::Protocol::L4_TCP || hp.protocol() == proto::Protocol::L4_UDP)) {
+				inner_l4 = size_t(header - pkt.data());
+			}
+			hp.next();
+			sp.next();
+			st.next();
+		}
+		assert(sp.protocol() == proto::Protocol::END && st.protocol() == proto::Protocol::END);
+		assert(inner_l4 == expected.inner_l4);
+	}
+
+	/**
+	 * The lanes of parse_burst() give what parse() does.
+	 */
+	static void burst(const Packet& pkt, const proto::ParsedPacket& parsed) noexcept {
+		Frame frames[4];
+		for(Frame& frame : frames) {
+			frame.m_data = pkt.data();
+			frame.m_hdr.caplen = uint32_t(pkt.size());
+		}
+		proto::ParsedPacket out[4];
+		proto::PacketParser::parse_burst(frames, 4, out);
+		for(const proto::ParsedPacket& lane : out) {
+			assert(memcmp(&lane, &parsed, sizeof(parsed)) == 0);
+		}
+	}
+
+	/**
+	 * GRE with the checksum and the key -> IPv4 -> TCP, GRE TEB -> Ethernet -> IPv4 -> UDP.
+	 */
+	void case_0() noexcept {
+		TRACE_CALL;
+		Packet pkt;
+		ethernet(pkt, 0x0800);
+		size_t outer = ipv4(pkt, proto::IPv4::PROTO_GRE, 1, 2);
+		size_t gre = pkt.size();
+		put16(pkt, 0xA000); // C, K
+		put16(pkt, 0x0800);
+		put32(pkt, 0);
+		put32(pkt, 0xABCDEF01);
+		size_t inner = ipv4(pkt, proto::IPv4::PROTO_TCP, 3, 4);
+		size_t l4 = tcp(pkt, 1000, 80);
+		finish(pkt, inner);
+		finish(pkt, outer);
+		check(pkt, {proto::Protocol::L4_GRE, 0xABCDEF01, inner, l4, 1000, 80, gre});
+
+		pkt.clear();
+		ethernet(pkt, 0x0800);
+		outer = ipv4(pkt, proto::IPv4::PROTO_GRE, 1, 2);
+		gre = pkt.size();
+		put16(pkt, 0x2000); // K
+		put16(pkt, 0x6558);
+		put32(pkt, 77);
+		ethernet(pkt, 0x0800);
+		inner = ipv4(pkt, proto::IPv4::PROTO_UDP, 5, 6);
+		l4 = udp(pkt, 10, 20);
+		finish(pkt, inner);
+		finish(pkt, outer);
+		check(pkt, {proto::Protocol::L4_GRE, 77, inner, l4, 10, 20, gre});
+	}
+
+	/**
+	 * QinQ -> IPv4 -> UDP -> VXLAN -> Ethernet -> VLAN -> IPv6 -> UDP.
+	 */
+	void case_1() noexcept {
+		TRACE_CALL;
+		Packet pkt;
+		ethernet(pkt, 0x88A8);
+		put16(pkt, 100);
+		put16(pkt, 0x8100);
+		put16(pkt, 200);
+		put16(pkt, 0x0800);
+		const size_t outer = ipv4(pkt, proto::IPv4::PROTO_UDP, 1, 2);
+		const size_t vxlan = udp(pkt, 5555, proto::Vxlan::PORT);
+		put32(pkt, 0x08000000);
+		put32(pkt, 0x12345600);
+		ethernet(pkt, 0x8100);
+		put16(pkt, 7);
+		put16(pkt, 0x86DD);
+		const size_t inner = ipv6(pkt, proto::IPv6::PROTO_UDP);
+		const size_t l4 = udp(pkt, 53, 5353);
+		finish(pkt, inner);
+		finish(pkt, outer);
+		check(pkt, {proto::Protocol::L5_VXLAN, 0x123456, inner, l4, 53, 5353, vxlan});
+
+		proto::ParsedPacket parsed;
+		assert(proto::PacketParser::parse(pkt.data(), pkt.size(), parsed));
+		assert(parsed.vlan_count == 2 && parsed.vlan[0] == 100 && parsed.vlan[1] == 200);
+		assert(parsed.inner.ip_version == 6 && parsed.inner.has(proto::Protocol::L2_VLAN));
+		assert(parsed.src.addr32[0] == htonl(1) && parsed.inner.src.addr8[1] == 7);
+	}
+
+	/**
+	 * IPv6 -> UDP -> GTP-U with the sequence number and an extension header -> IPv4 -> TCP,
+	 * a GTP-U message which is not a G-PDU is not a tunnel.
+	 */
+	void case_2() noexcept {
+		TRACE_CALL;
+		Packet pkt;
+		ethernet(pkt, 0x86DD);
+		size_t outer = ipv6(pkt, proto::IPv6::PROTO_UDP);
+		size_t gtpu = udp(pkt, proto::GtpU::PORT, proto::GtpU::PORT);
+		pkt.push_back(0x36); // version 1, PT, E, S
+		pkt.push_back(255); // G-PDU
+		put16(pkt, 0);
+		put32(pkt, 0xDEAD0001);
+		put16(pkt, 1); // the sequence number
+		pkt.push_back(0);
+		pkt.push_back(0x85); // the PDU session container
+		pkt.push_back(1);
+		pkt.push_back(0x09);
+		pkt.push_back(0x01);
+		pkt.push_back(0); // no next extension header
+		const size_t inner = ipv4(pkt, proto::IPv4::PROTO_TCP, 9, 10);
+		const size_t l4 = tcp(pkt, 40000, 443);
+		finish(pkt, inner);
+		finish(pkt, outer);
+		check(pkt, {proto::Protocol::L5_GTPU, 0xDEAD0001, inner, l4, 40000, 443, gtpu});
+
+		pkt.clear();
+		ethernet(pkt, 0x0800);
+		outer = ipv4(pkt, proto::IPv4::PROTO_UDP, 1, 2);
+		gtpu = udp(pkt, proto::GtpU::PORT, proto::GtpU::PORT);
+		pkt.push_back(0x32);
+		pkt.push_back(1); // an echo request
+		put16(pkt, 4);
+		put32(pkt, 0);
+		put32(pkt, 0);
+		finish(pkt, outer);
+		check(pkt, {0, 0, 0, 0, 0, 0, gtpu});
+	}
+
+	/**
+	 * MPLS -> IPv4 -> GRE without the key -> MPLS -> IPv6 -> TCP.
+	 */
+	void case_3() noexcept {
+		TRACE_CALL;
+		Packet pkt;
+		ethernet(pkt, 0x8847);
+		put32(pkt, (16 << 12) | 64);
+		put32(pkt, (17 << 12) | 0x100 | 64); // the bottom of the stack
+		const size_t outer = ipv4(pkt, proto::IPv4::PROTO_GRE, 1, 2);
+		const size_t gre = pkt.size();
+		put16(pkt, 0);
+		put16(pkt, 0x8847);
+		put32(pkt, (99 << 12) | 0x100 | 1);
+		const size_t inner = ipv6(pkt, proto::IPv6::PROTO_TCP);
+		const size_t l4 = tcp(pkt, 1, 2);
+		finish(pkt, inner);
+		finish(pkt, outer);
+		check(pkt, {proto::Protocol::L4_GRE, 0, inner, l4, 1, 2, gre});
+
+		proto::ParsedPacket parsed;
+		assert(proto::PacketParser::parse(pkt.data(), pkt.size(), parsed));
+		assert(parsed.has(proto::Protocol::L2_MPLS) && parsed.inner.has(proto::Protocol::L2_MPLS));
+		assert(parsed.l3 == 14 + 8);
+	}
+
+	uint8_t random() noexcept {
+		m_seed = m_seed * 1103515245u + 12345u;
+		return uint8_t(m_seed >> 16);
+	}
+
+	/**
+	 * The truncated and the damaged tunnels: parse() and parse_burst() agree, the parsers stay in the frame.
+	 */
+	void case_4() noexcept {
+		TRACE_CALL;
+		Packet base;
+		ethernet(base, 0x0800);
+		const size_t outer = ipv4(base, proto::IPv4::PROTO_UDP, 1, 2);
+		udp(base, 5555, proto::Vxlan::PORT);
+		put32(base, 0x08000000);
+		put32(base, 0);
+		ethernet(base, 0x0800);
+		const size_t inner = ipv4(base, proto::IPv4::PROTO_TCP, 3, 4);
+		tcp(base, 1, 2);
+		finish(base, inner);
+		finish(base, outer);
+
+		for(unsigned round = 0; round < 20000; round++) {
+			Packet pkt(base);
+			for(unsigned flips = random() % 4; flips; flips--) {
+				pkt[random() % pkt.size()] = random();
+			}
+			pkt.resize((size_t(random()) << 8 | random()) % (pkt.size() + 1));
+			// a copy of the exact size, so ASan sees the reads past the frame
+			uint8_t* frame = new uint8_t[pkt.size()];
+			memcpy(frame, pkt.data(), pkt.size());
+			proto::ParsedPacket parsed;
+			proto::PacketParser::parse(frame, pkt.size(), parsed);
+			burst(Packet(frame, frame + pkt.size()), parsed);
+			proto::SafeHeaderParser sp(frame, pkt.size());
+			for(unsigned steps = 0; sp.protocol() != proto::Protocol::END && steps < 32; steps++) {
+				sp.next();
+			}
+			delete[] frame;
+		}
+	}
+};
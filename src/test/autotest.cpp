@@ -1,6 +1,31 @@
+#include "TestAsyncChunkedFile.h"
+#include "TestAsyncLogger.h"
+#include "TestBitArrayT.h"
+#include "TestBlockTokenizer.h"
+#include "TestBufferedWriter.h"
+#include "TestByteOrder.h"
+#include "TestChecksum.h"
+#include "TestClassifier.h"
+#include "TestConcurrentBitArrayT.h"
+#include "TestDeduplicator.h"
+#include "TestEncap.h"
+#include "TestFilter.h"
+#include "TestFlowExporter.h"
 #include "TestCharClassifier.h"
+#include "TestFlowKey.h"
+#include "TestMacAddress.h"
+#include "TestNgWriter.h"
+#include "TestPcapIndex.h"
+#include "TestPipelineRuntime.h"
+#include "TestRangeSet.h"
+#include "TestReassembler.h"
 #include "TestStreamTokenizer.h"
 #include "TestStringTokenizer.h"
+#include "TestTcpReassembler.h"
+#include "TestPatternMatcher.h"
+#include "TestTextBuffer.h"
+#include "TestTrace.h"
+#include "TestTunnel.h"
 
 #include <cstdio>
 #include <cstdlib>
@@ -8,8 +33,33 @@
 int main(int argc, char** argv) {
 
 	TestCharClassifier test_char_classifier;
+	TestBlockTokenizer test_block_tokenizer;
 	TestStreamTokenizer test_stream_tokenizer;
 	TestStringTokenizer test_string_tokenizer;
+	TestRangeSet test_range_set;
+	TestMacAddress test_mac_address;
+	TestByteOrder test_byte_order;
+	TestFlowExporter test_flow_exporter;
+	TestPipelineRuntime test_pipeline_runtime;
+	TestTrace test_trace;
+	TestDeduplicator test_deduplicator;
+	TestTcpReassembler test_tcp_reassembler;
+	TestPatternMatcher test_pattern_matcher;
+	TestChecksum test_checksum;
+	TestReassembler test_reassembler;
+	TestTunnel test_tunnel;
+	TestFlowKey test_flow_key;
+	TestClassifier test_classifier;
+	TestEncap test_encap;
+	TestFilter test_filter;
+	TestNgWriter test_ng_writer;
+	TestAsyncLogger test_async_logger;
+	TestAsyncChunkedFile test_async_chunked_file;
+	TestPcapIndex test_pcap_index;
+	TestBufferedWriter test_buffered_writer;
+	TestBitArrayT test_bit_arrayt(1001);
+	TestConcurrentBitArrayT test_concurrent_bit_arrayt(1001);
+	TestTextBuffer test_text_buffer;
 
 	printf("<---- the end of main() ---->\n");
 	return EXIT_SUCCESS;